@@ -96,6 +96,15 @@ class rrel_fm_problem : public rrel_estimation_problem
   void compute_residuals( const vnl_vector<double>& params,
                           std::vector<double>& residuals ) const;
 
+  // The fundamental matrix, so that it is computed once per hypothesis.
+  void prepare_subset( const vnl_vector<double>& params,
+                       vnl_vector<double>& prepared ) const;
+
+  // Compute the residuals of the correspondences with the given indices.
+  void compute_residuals_subset( const vnl_vector<double>& prepared,
+                                 const std::vector<int>& indices,
+                                 std::vector<double>& residuals ) const;
+
   // Convert a fundamental matrix into a parameter vector.
   virtual void  fm_to_params( const vpgl_fundamental_matrix<double>&  fm,
                               vnl_vector<double>& p) const;
@@ -12,6 +12,8 @@
 #include <vgl/vgl_homg_point_2d.h>
 #include <vgl/vgl_homg_line_2d.h>
 #include <vgl/algo/vgl_homg_operators_2d.h>
+#include <vnl/vnl_matrix_fixed.h>
+#include <vnl/vnl_vector_fixed.h>
 #include <rrel/rrel_ran_sam_search.h>
 #include <rrel/rrel_muset_obj.h>
 
@@ -82,6 +84,21 @@ bpgl_fm_compute_reg_ransac_params::bpgl_fm_compute_reg_ransac_params() :
 }
 
 
+//: Sum of the squared distances of pr and pl from their epipolar lines under F.
+// As vpgl_fundamental_matrix::r_epipolar_line() and l_epipolar_line().
+static double
+rrel_fm_reg_problem_residual( const vnl_matrix_fixed<double,3,3>& F,
+                               const vgl_point_2d<double>& pr, const vgl_point_2d<double>& pl )
+{
+  vnl_vector_fixed<double,3> lr = F.transpose() * vnl_vector_fixed<double,3>( pl.x(), pl.y(), 1.0 );
+  vnl_vector_fixed<double,3> ll = F * vnl_vector_fixed<double,3>( pr.x(), pr.y(), 1.0 );
+  return vgl_homg_operators_2d<double>::perp_dist_squared( vgl_homg_line_2d<double>( lr(0), lr(1), lr(2) ),
+                                                           vgl_homg_point_2d<double>( pr ) )
+       + vgl_homg_operators_2d<double>::perp_dist_squared( vgl_homg_line_2d<double>( ll(0), ll(1), ll(2) ),
+                                                           vgl_homg_point_2d<double>( pl ) );
+}
+
+
 //------------------------------------------
 rrel_fm_reg_problem::rrel_fm_reg_problem(
   const std::vector< vgl_point_2d<double> >& pr,
@@ -128,6 +145,7 @@ rrel_fm_reg_problem::compute_residuals(
 
   bpgl_reg_fundamental_matrix<double> fm;
   params_to_fm(params, fm);
+  const vnl_matrix_fixed<double,3,3> F = fm.get_matrix();
 
   if ( residuals.size() != pr_.size() )
     residuals.resize( pr_.size() );
@@ -135,18 +153,40 @@ rrel_fm_reg_problem::compute_residuals(
   // The residual for each correspondence is the sum of the squared distances from
   // the points to their epipolar lines.
   for ( unsigned i = 0; i < pr_.size(); i++ ){
-    vgl_homg_line_2d<double> lr =
-      fm.r_epipolar_line( vgl_homg_point_2d<double>( pl_[i] ) );
-    vgl_homg_line_2d<double> ll =
-      fm.l_epipolar_line( vgl_homg_point_2d<double>( pr_[i] ) );
-    residuals[i] = vgl_homg_operators_2d<double>::perp_dist_squared( lr,
-                                                                     vgl_homg_point_2d<double>( pr_[i] ) )
-                 + vgl_homg_operators_2d<double>::perp_dist_squared( ll,
-                                                                     vgl_homg_point_2d<double>( pl_[i] ) );
+    residuals[i] = rrel_fm_reg_problem_residual( F, pr_[i], pl_[i] );
   }
 }
 
 
+//-------------------------------------------
+void
+rrel_fm_reg_problem::prepare_subset(
+  const vnl_vector<double>& params,
+  vnl_vector<double>& prepared ) const
+{
+  bpgl_reg_fundamental_matrix<double> fm;
+  params_to_fm(params, fm);
+  const vnl_matrix_fixed<double,3,3> F = fm.get_matrix();
+  prepared.set_size(9);
+  prepared.copy_in( F.data_block() );
+}
+
+
+//-------------------------------------------
+void
+rrel_fm_reg_problem::compute_residuals_subset(
+  const vnl_vector<double>& prepared,
+  const std::vector<int>& indices,
+  std::vector<double>& residuals ) const
+{
+  assert( prepared.size() == 9 );
+  const vnl_matrix_fixed<double,3,3> F( prepared.data_block() );
+  residuals.resize( indices.size() );
+  for ( unsigned k = 0; k < indices.size(); k++ )
+    residuals[k] = rrel_fm_reg_problem_residual( F, pr_[indices[k]], pl_[indices[k]] );
+}
+
+
 //-------------------------------------------
 void
 rrel_fm_reg_problem::fm_to_params(
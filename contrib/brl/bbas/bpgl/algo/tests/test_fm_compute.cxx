@@ -8,7 +8,9 @@
 #include <bpgl/bpgl_reg_fundamental_matrix.h>
 #include <vpgl/vpgl_fundamental_matrix.h>
 #include <bpgl/algo/bpgl_fm_compute_affine_ransac.h>
+#include <vector>
 #include <vnl/vnl_fwd.h>
+#include <vnl/vnl_vector.h>
 #include <vnl/vnl_vector_fixed.h>
 #include <vnl/vnl_double_3x3.h>
 #include <vgl/vgl_point_2d.h>
@@ -115,6 +117,36 @@ static void test_fm_compute()
            << "\nEstimated fundamental matrix:\n" << fm2est_vnl << '\n';
   TEST_NEAR( "fm compute ransac from perfect correspondences",
              (fm2_vnl-fm2est_vnl).frobenius_norm(), 0, 2.5 );
+
+  // The residuals of some correspondences, from the prepared fundamental matrix
+  {
+    rrel_fm_problem problem( p2r, p2l );
+    vnl_vector<double> params, prepared;
+    problem.fm_to_params( fm2, params );
+    std::vector<double> all( problem.num_samples() ), some;
+    problem.compute_residuals( params, all );
+    std::vector<int> idx;
+    idx.push_back( 15 ); idx.push_back( 0 ); idx.push_back( 3 );
+    problem.prepare_subset( params, prepared );
+    problem.compute_residuals_subset( prepared, idx, some );
+    TEST( "fm compute_residuals_subset", some.size() == 3 && some[0] == all[15] &&
+                                         some[1] == all[0] && some[2] == all[3], true );
+  }
+  {
+    rrel_fm_affine_problem problem( rp_aff, lp_aff );
+    vnl_vector<double> params, prepared;
+    std::vector<int> minimal;
+    for ( int i = 0; i < 4; i++ ) minimal.push_back( i );
+    problem.fit_from_minimal_set( minimal, params );
+    std::vector<double> all( problem.num_samples() ), some;
+    problem.compute_residuals( params, all );
+    std::vector<int> idx;
+    idx.push_back( 12 ); idx.push_back( 1 );
+    problem.prepare_subset( params, prepared );
+    problem.compute_residuals_subset( prepared, idx, some );
+    TEST( "affine fm compute_residuals_subset", some.size() == 2 && some[0] == all[12] &&
+                                                some[1] == all[1], true );
+  }
 }
 
 TESTMAIN(test_fm_compute);
@@ -272,6 +272,9 @@ class bsta_mg_grimson_window_updater : public bsta_mg_grimson_statistical_update
     this->update(mix, sample, T(1)/mix.num_observations);
   }
 
+  //: The number of observations after which the learning rate stays fixed
+  unsigned int window_size() const { return window_size_; }
+
  protected:
   unsigned int window_size_;
 };
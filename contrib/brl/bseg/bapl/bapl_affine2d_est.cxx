@@ -77,12 +77,13 @@ bapl_affine2d_est::fit_from_minimal_set( const std::vector<int>& point_indices,
   }
 }
 
-void
-bapl_affine2d_est :: compute_residuals( const vnl_vector<double>& params,
-                                              std::vector<double>& residuals ) const
+//: The affine map with parameters "params", and the inverse of its matrix.
+static void
+bapl_affine2d_matrices( const vnl_vector<double>& params, vnl_matrix<double>& A,
+                        vnl_vector<double>& t, vnl_matrix<double>& A_inv )
 {
-  vnl_matrix< double > A(2,2);
-  vnl_vector< double > t(2);
+  A.set_size(2,2);
+  t.set_size(2);
   int r,c;
   for ( r=0; r<2; ++r )
     for ( c=0; c<2; ++c )
@@ -93,26 +94,67 @@ bapl_affine2d_est :: compute_residuals( const vnl_vector<double>& params,
   vnl_svd< double > svd_A( A );
   if ( svd_A.rank() < 2 )
     std::cerr << "bapl_affine2d_est :: compute_residuals  rank(A) < 2!!";
-  vnl_matrix< double > A_inv( svd_A.inverse() );
+  A_inv = svd_A.inverse();
+}
+
+//: The symmetric transfer error of one correspondence.
+static double
+bapl_affine2d_residual( const vnl_matrix<double>& A, const vnl_vector<double>& t,
+                        const vnl_matrix<double>& A_inv,
+                        const vnl_vector<double>& from_pt, const vnl_vector<double>& to_pt )
+{
+  vnl_vector< double > trans_pt = (A * from_pt) + t;
+  vnl_vector< double > inv_trans_pt = A_inv * (to_pt - t);
+
+  double del_x = trans_pt[ 0 ] - to_pt[ 0 ];
+  double del_y = trans_pt[ 1 ] - to_pt[ 1 ];
+  double inv_del_x = inv_trans_pt[ 0 ] - from_pt[ 0 ];
+  double inv_del_y = inv_trans_pt[ 1 ] - from_pt[ 1 ];
+  return std::sqrt( vnl_math::sqr(del_x)     + vnl_math::sqr(del_y)
+                  + vnl_math::sqr(inv_del_x) + vnl_math::sqr(inv_del_y) );
+}
+
+void
+bapl_affine2d_est :: compute_residuals( const vnl_vector<double>& params,
+                                              std::vector<double>& residuals ) const
+{
+  vnl_matrix< double > A, A_inv;
+  vnl_vector< double > t;
+  bapl_affine2d_matrices( params, A, t, A_inv );
 
   if ( residuals.size() != from_pts_.size() )
     residuals.resize( from_pts_.size() );
 
-  vnl_vector< double > trans_pt( 2 ), inv_trans_pt( 2 );
-  double del_x, del_y, inv_del_x, inv_del_y;
-
-  for ( unsigned int i=0; i<from_pts_.size(); ++i ) {
-    trans_pt = (A * from_pts_[ i ]) + t;
-    inv_trans_pt = A_inv * (to_pts_[ i ] - t);
+  for ( unsigned int i=0; i<from_pts_.size(); ++i )
+    residuals [ i ] = bapl_affine2d_residual( A, t, A_inv, from_pts_[ i ], to_pts_[ i ] );
+}
 
+void
+bapl_affine2d_est :: prepare_subset( const vnl_vector<double>& params,
+                                     vnl_vector<double>& prepared ) const
+{
+  // A and t as in params, then the inverse of A
+  vnl_matrix< double > A, A_inv;
+  vnl_vector< double > t;
+  bapl_affine2d_matrices( params, A, t, A_inv );
+  prepared.set_size( 10 );
+  prepared.update( params.extract( 6 ), 0 );
+  prepared.update( vnl_vector<double>( A_inv.data_block(), 4 ), 6 );
+}
 
-    del_x = trans_pt[ 0 ] - to_pts_[ i ][ 0 ];
-    del_y = trans_pt[ 1 ] - to_pts_[ i ][ 1 ];
-    inv_del_x = inv_trans_pt[ 0 ] - from_pts_[ i ][ 0 ];
-    inv_del_y = inv_trans_pt[ 1 ] - from_pts_[ i ][ 1 ];
-    residuals [ i ] = std::sqrt( vnl_math::sqr(del_x)     + vnl_math::sqr(del_y)
-                              + vnl_math::sqr(inv_del_x) + vnl_math::sqr(inv_del_y) );
-  }
+void
+bapl_affine2d_est :: compute_residuals_subset( const vnl_vector<double>& prepared,
+                                               const std::vector<int>& indices,
+                                               std::vector<double>& residuals ) const
+{
+  assert( prepared.size() == 10 );
+  const vnl_matrix< double > A( prepared.data_block(), 2, 2 );
+  const vnl_vector< double > t( prepared.data_block() + 4, 2 );
+  const vnl_matrix< double > A_inv( prepared.data_block() + 6, 2, 2 );
+
+  residuals.resize( indices.size() );
+  for ( unsigned int k=0; k<indices.size(); ++k )
+    residuals[ k ] = bapl_affine2d_residual( A, t, A_inv, from_pts_[ indices[k] ], to_pts_[ indices[k] ] );
 }
 
 
@@ -0,0 +1,4 @@
+#include <bbgm/bbgm_soa_mixture_image.hxx>
+#include <bsta/bsta_gauss_sf1.h>
+
+BBGM_SOA_MIXTURE_IMAGE_INSTANTIATE(bsta_gauss_sf1,3);
@@ -0,0 +1,196 @@
+// This is brl/bseg/bbgm/bbgm_soa_mixture_image.h
+#ifndef bbgm_soa_mixture_image_h_
+#define bbgm_soa_mixture_image_h_
+//:
+// \file
+// \brief An image of fixed size Gaussian mixtures, stored as planes
+//
+// bbgm_soa_mixture_image<gauss_,s> holds the same data as
+// bbgm_image_of<bsta_num_obs<bsta_mixture_fixed<bsta_num_obs<gauss_>,s> > >,
+// but each scalar of the mixture (the number of observations, and for
+// each component the weight, number of observations, mean and variances)
+// is kept in its own ni x nj plane of floats.  The update in
+// bbgm_soa_update.h can then process several neighbouring pixels at once.
+//
+// Only the active components of a pixel hold meaningful values; the
+// planes of the components past num_components are left as they were.
+//
+// b_write() writes exactly what bbgm_image_of writes for the mixture type,
+// and b_read() reads it, so saved models can be loaded into either image.
+//
+// The gaussian_ type must be bsta_gaussian_indep<float,n> or
+// bsta_gaussian_sphere<float,1>.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <iostream>
+#include <vector>
+#include <typeinfo>
+#include <vcl_compiler.h>
+#include <vnl/vnl_vector_fixed.h>
+#include <bsta/bsta_attributes.h>
+#include <bsta/bsta_mixture_fixed.h>
+#include <bsta/bsta_gaussian_indep.h>
+#include <bsta/bsta_gaussian_sphere.h>
+#include "bbgm_image_of.h"
+
+//: Access to the scalars of the Gaussian types a bbgm_soa_mixture_image can hold
+template <class gauss_>
+struct bbgm_soa_gauss_traits;
+
+//: Gaussians with independent (diagonal) covariance
+template <unsigned n>
+struct bbgm_soa_gauss_traits<bsta_gaussian_indep<float,n> >
+{
+  typedef bsta_gaussian_indep<float,n> gauss_type;
+  typedef vnl_vector_fixed<float,n> vector_type;
+  enum { dimension = n, covar_size = n };
+
+  static void get(const gauss_type& g, float* mean, float* covar)
+  {
+    for (unsigned d=0; d<n; ++d) {
+      mean[d] = g.mean()[d];
+      covar[d] = g.diag_covar()[d];
+    }
+  }
+
+  static gauss_type make(const float* mean, const float* covar)
+  { return gauss_type(vector_type(mean), vector_type(covar)); }
+
+  static vector_type sample(const float* x) { return vector_type(x); }
+};
+
+//: One dimensional Gaussians
+template <>
+struct bbgm_soa_gauss_traits<bsta_gaussian_sphere<float,1> >
+{
+  typedef bsta_gaussian_sphere<float,1> gauss_type;
+  typedef float vector_type;
+  enum { dimension = 1, covar_size = 1 };
+
+  static void get(const gauss_type& g, float* mean, float* covar)
+  {
+    mean[0] = g.mean();
+    covar[0] = g.var();
+  }
+
+  static gauss_type make(const float* mean, const float* covar)
+  { return gauss_type(mean[0], covar[0]); }
+
+  static vector_type sample(const float* x) { return x[0]; }
+};
+
+
+//: An image of mixtures of at most s Gaussians, with one plane per scalar
+template <class gauss_, unsigned s>
+class bbgm_soa_mixture_image : public bbgm_image_base
+{
+ public:
+  typedef bbgm_soa_gauss_traits<gauss_> traits;
+  typedef bsta_num_obs<gauss_> obs_gauss_type;
+  typedef bsta_mixture_fixed<obs_gauss_type,s> mix_type;
+  //: The distribution at each pixel, as held by bbgm_image_of
+  typedef bsta_num_obs<mix_type> dist_type;
+
+  enum { dimension = traits::dimension,
+         covar_size = traits::covar_size,
+         max_components = s,
+         //: the planes of each component: weight, observations, mean and variances
+         component_planes = 2 + traits::dimension + traits::covar_size,
+         //: the planes of the mixture: observations, number of components, then the components
+         num_planes = 2 + s*component_planes };
+
+  //: Constructor
+  bbgm_soa_mixture_image() : ni_(0), nj_(0) {}
+
+  //: Constructor - every pixel is set to \p model
+  bbgm_soa_mixture_image(unsigned int ni, unsigned int nj, const dist_type& model);
+
+  //: Constructor - a copy of the distributions of \p image
+  explicit bbgm_soa_mixture_image(const bbgm_image_of<dist_type>& image);
+
+  //: return the type_info for the distribution type
+  virtual const std::type_info& dist_typeid() const { return typeid(dist_type); }
+
+  //: Return the width of the image
+  unsigned int ni() const { return ni_; }
+
+  //: Return the height
+  unsigned int nj() const { return nj_; }
+
+  //: resize to ni x nj
+  // If already correct size, this function returns quickly
+  void set_size(unsigned ni, unsigned nj);
+
+  //: A copy of the distribution at (i,j)
+  dist_type operator() (unsigned int i, unsigned int j) const;
+
+  //: Set the distribution at (i,j) to a copy of d
+  void set(unsigned int i, unsigned int j, const dist_type& d);
+
+  //: Copy the distributions into \p image, resizing it if needed
+  void copy_to(bbgm_image_of<dist_type>& image) const;
+
+  //: Copy the distributions of \p image, resizing this image if needed
+  void copy_from(const bbgm_image_of<dist_type>& image);
+
+  //: Pixel (0,j) of the plane of the numbers of observations of the mixtures
+  float* obs_row(unsigned j) { return plane_row(0,j); }
+  const float* obs_row(unsigned j) const { return plane_row(0,j); }
+
+  //: Pixel (0,j) of the plane of the numbers of components
+  // The counts are kept as floats so they can be loaded along with the other planes.
+  float* num_components_row(unsigned j) { return plane_row(1,j); }
+  const float* num_components_row(unsigned j) const { return plane_row(1,j); }
+
+  //: Pixel (0,j) of the plane of the weights of component k
+  float* weight_row(unsigned k, unsigned j) { return plane_row(component_plane(k),j); }
+  const float* weight_row(unsigned k, unsigned j) const { return plane_row(component_plane(k),j); }
+
+  //: Pixel (0,j) of the plane of the numbers of observations of component k
+  float* component_obs_row(unsigned k, unsigned j) { return plane_row(component_plane(k)+1,j); }
+  const float* component_obs_row(unsigned k, unsigned j) const { return plane_row(component_plane(k)+1,j); }
+
+  //: Pixel (0,j) of the plane of element d of the means of component k
+  float* mean_row(unsigned k, unsigned d, unsigned j) { return plane_row(component_plane(k)+2+d,j); }
+  const float* mean_row(unsigned k, unsigned d, unsigned j) const { return plane_row(component_plane(k)+2+d,j); }
+
+  //: Pixel (0,j) of the plane of variance c of component k
+  float* covar_row(unsigned k, unsigned c, unsigned j) { return plane_row(component_plane(k)+2+dimension+c,j); }
+  const float* covar_row(unsigned k, unsigned c, unsigned j) const { return plane_row(component_plane(k)+2+dimension+c,j); }
+
+  //===========================================================================
+  // Binary I/O Methods
+
+  //: Return a string name
+  // This is the name of the equivalent bbgm_image_of, whose stream format is used
+  virtual std::string is_a() const;
+
+  virtual bbgm_image_base* clone() const;
+
+  //: Return IO version number;
+  short version() const;
+
+  //: Binary save self to stream, in the format of bbgm_image_of<dist_type>
+  virtual void b_write(vsl_b_ostream &os) const;
+
+  //: Binary load self from stream, in the format of bbgm_image_of<dist_type>
+  virtual void b_read(vsl_b_istream &is);
+
+ private:
+  static unsigned component_plane(unsigned k) { return 2 + k*component_planes; }
+
+  float* plane_row(unsigned p, unsigned j)
+  { return &data_[0] + (std::size_t(p)*nj_ + j)*ni_; }
+  const float* plane_row(unsigned p, unsigned j) const
+  { return &data_[0] + (std::size_t(p)*nj_ + j)*ni_; }
+
+  unsigned int ni_, nj_;
+  //: the planes, one after the other
+  std::vector<float> data_;
+};
+
+
+#endif // bbgm_soa_mixture_image_h_
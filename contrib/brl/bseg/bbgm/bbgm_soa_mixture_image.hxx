@@ -0,0 +1,212 @@
+// This is brl/bseg/bbgm/bbgm_soa_mixture_image.hxx
+#ifndef bbgm_soa_mixture_image_hxx_
+#define bbgm_soa_mixture_image_hxx_
+//:
+// \file
+
+#include <iostream>
+#include <typeinfo>
+#include "bbgm_soa_mixture_image.h"
+#include <vcl_compiler.h>
+#include <vbl/vbl_array_2d.h>
+#include <vsl/vsl_binary_io.h>
+#include <bsta/io/bsta_io_attributes.h>
+#include <bsta/io/bsta_io_mixture_fixed.h>
+#include <bsta/io/bsta_io_gaussian_indep.h>
+#include <bsta/io/bsta_io_gaussian_sphere.h>
+
+
+//: Constructor - every pixel is set to \p model
+template <class gauss_, unsigned s>
+bbgm_soa_mixture_image<gauss_,s>::bbgm_soa_mixture_image(unsigned int ni, unsigned int nj,
+                                                         const dist_type& model)
+  : ni_(0), nj_(0)
+{
+  set_size(ni,nj);
+  for (unsigned j=0; j<nj; ++j)
+    for (unsigned i=0; i<ni; ++i)
+      set(i,j,model);
+}
+
+
+//: Constructor - a copy of the distributions of \p image
+template <class gauss_, unsigned s>
+bbgm_soa_mixture_image<gauss_,s>::bbgm_soa_mixture_image(const bbgm_image_of<dist_type>& image)
+  : ni_(0), nj_(0)
+{
+  copy_from(image);
+}
+
+
+//: resize to ni x nj
+template <class gauss_, unsigned s>
+void
+bbgm_soa_mixture_image<gauss_,s>::set_size(unsigned ni, unsigned nj)
+{
+  if (ni == ni_ && nj == nj_)
+    return;
+  ni_ = ni;
+  nj_ = nj;
+  data_.assign(std::size_t(num_planes)*ni*nj, 0.0f);
+}
+
+
+//: A copy of the distribution at (i,j)
+template <class gauss_, unsigned s>
+typename bbgm_soa_mixture_image<gauss_,s>::dist_type
+bbgm_soa_mixture_image<gauss_,s>::operator() (unsigned int i, unsigned int j) const
+{
+  dist_type d;
+  d.num_observations = obs_row(j)[i];
+  const unsigned nc = static_cast<unsigned>(num_components_row(j)[i]);
+  float mean[dimension], covar[covar_size];
+  for (unsigned k=0; k<nc; ++k) {
+    for (unsigned m=0; m<dimension; ++m)
+      mean[m] = mean_row(k,m,j)[i];
+    for (unsigned c=0; c<covar_size; ++c)
+      covar[c] = covar_row(k,c,j)[i];
+    d.insert(obs_gauss_type(traits::make(mean,covar), component_obs_row(k,j)[i]),
+             weight_row(k,j)[i]);
+  }
+  return d;
+}
+
+
+//: Set the distribution at (i,j) to a copy of d
+template <class gauss_, unsigned s>
+void
+bbgm_soa_mixture_image<gauss_,s>::set(unsigned int i, unsigned int j, const dist_type& d)
+{
+  obs_row(j)[i] = d.num_observations;
+  const unsigned nc = d.num_components();
+  num_components_row(j)[i] = static_cast<float>(nc);
+  float mean[dimension], covar[covar_size];
+  for (unsigned k=0; k<nc; ++k) {
+    const obs_gauss_type& g = d.distribution(k);
+    traits::get(g,mean,covar);
+    for (unsigned m=0; m<dimension; ++m)
+      mean_row(k,m,j)[i] = mean[m];
+    for (unsigned c=0; c<covar_size; ++c)
+      covar_row(k,c,j)[i] = covar[c];
+    component_obs_row(k,j)[i] = g.num_observations;
+    weight_row(k,j)[i] = d.weight(k);
+  }
+}
+
+
+//: Copy the distributions into \p image, resizing it if needed
+template <class gauss_, unsigned s>
+void
+bbgm_soa_mixture_image<gauss_,s>::copy_to(bbgm_image_of<dist_type>& image) const
+{
+  image.set_size(ni_,nj_);
+  for (unsigned j=0; j<nj_; ++j)
+    for (unsigned i=0; i<ni_; ++i)
+      image(i,j) = (*this)(i,j);
+}
+
+
+//: Copy the distributions of \p image, resizing this image if needed
+template <class gauss_, unsigned s>
+void
+bbgm_soa_mixture_image<gauss_,s>::copy_from(const bbgm_image_of<dist_type>& image)
+{
+  set_size(image.ni(),image.nj());
+  for (unsigned j=0; j<nj_; ++j)
+    for (unsigned i=0; i<ni_; ++i)
+      set(i,j,image(i,j));
+}
+
+
+//===========================================================================
+// Binary I/O Methods
+
+
+//: Return a string name
+template <class gauss_, unsigned s>
+std::string
+bbgm_soa_mixture_image<gauss_,s>::is_a() const
+{
+  return "bbgm_image_of<"+std::string(typeid(dist_type).name())+">";
+}
+
+
+template <class gauss_, unsigned s>
+bbgm_image_base*
+bbgm_soa_mixture_image<gauss_,s>::clone() const
+{
+  return new bbgm_soa_mixture_image<gauss_,s>(*this);
+}
+
+
+//: Return IO version number;
+template <class gauss_, unsigned s>
+short
+bbgm_soa_mixture_image<gauss_,s>::version() const
+{
+  return 1;
+}
+
+
+//: Binary save self to stream.
+// The pixels are converted one at a time and written as bbgm_image_of
+// writes its vbl_array_2d.
+template <class gauss_, unsigned s>
+void
+bbgm_soa_mixture_image<gauss_,s>::b_write(vsl_b_ostream &os) const
+{
+  typedef typename vbl_array_2d<dist_type>::size_type size_type;
+  vsl_b_write(os, version());
+  const short array_version = 1;
+  vsl_b_write(os, array_version);
+  vsl_b_write(os, size_type(nj_));
+  vsl_b_write(os, size_type(ni_));
+  for (unsigned j=0; j<nj_; ++j)
+    for (unsigned i=0; i<ni_; ++i)
+      vsl_b_write(os, (*this)(i,j));
+}
+
+
+//: Binary load self from stream.
+template <class gauss_, unsigned s>
+void
+bbgm_soa_mixture_image<gauss_,s>::b_read(vsl_b_istream &is)
+{
+  if (!is)
+    return;
+  short ver;
+  vsl_b_read(is, ver);
+  switch (ver)
+  {
+    case 1:
+    {
+      typedef typename vbl_array_2d<dist_type>::size_type size_type;
+      short array_version;
+      vsl_b_read(is, array_version);
+      if (array_version != 1) {
+        std::cerr << "bbgm_soa_mixture_image: unknown array I/O version " << array_version << '\n';
+        is.is().clear(std::ios::badbit);
+        return;
+      }
+      size_type rows, cols;
+      vsl_b_read(is, rows);
+      vsl_b_read(is, cols);
+      set_size(unsigned(cols),unsigned(rows));
+      for (unsigned j=0; j<nj_; ++j)
+        for (unsigned i=0; i<ni_; ++i) {
+          dist_type d;
+          vsl_b_read(is, d);
+          set(i,j,d);
+        }
+      break;
+    }
+    default:
+      std::cerr << "bbgm_soa_mixture_image: unknown I/O version " << ver << '\n';
+  }
+}
+
+
+#define BBGM_SOA_MIXTURE_IMAGE_INSTANTIATE(G,s) \
+template class bbgm_soa_mixture_image<G,s >
+
+#endif // bbgm_soa_mixture_image_hxx_
@@ -0,0 +1,352 @@
+// This is brl/bseg/bbgm/bbgm_soa_update.h
+#ifndef bbgm_soa_update_h_
+#define bbgm_soa_update_h_
+//:
+// \file
+// \brief Row-parallel update of a bbgm_soa_mixture_image with the Grimson updaters
+//
+// update(dimg, image, updater) gives the same mixtures, bit for bit, as
+// update() of bbgm_update.h applied to the equivalent bbgm_image_of, for
+// bsta_mg_grimson_statistical_updater and bsta_mg_grimson_window_updater.
+//
+// The rows are split across threads with vnl_parallel_for.  Along a row,
+// four pixels at a time (with SSE2, otherwise one) go through a kernel
+// that handles the common case, a sample that matches the first
+// component: it updates that component and decays the weights of the
+// others in all lanes at once.  A pixel whose sample does not match the
+// first component may need a new component and a new ordering; it is
+// copied out to a bsta mixture, updated by the updater itself, and
+// copied back.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <vxl_config.h>
+#include <vcl_cassert.h>
+#include <vcl_compiler.h>
+#include <vil/vil_image_view.h>
+#include <vnl/vnl_parallel_for.h>
+#include <bsta/algo/bsta_adaptive_updater.h>
+#include "bbgm_soa_mixture_image.h"
+
+#if VXL_HAS_EMMINTRIN_H && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+# include <emmintrin.h>
+# define BBGM_SOA_SSE2 1
+#endif
+
+//: The operations of the update kernel, on one float
+struct bbgm_soa_lane1
+{
+  typedef float value;
+  typedef bool mask;
+  enum { width = 1 };
+
+  static value load(const float* p) { return *p; }
+  static void store(float* p, value v) { *p = v; }
+  static value set(float v) { return v; }
+  static value add(value a, value b) { return a+b; }
+  static value sub(value a, value b) { return a-b; }
+  static value mul(value a, value b) { return a*b; }
+  static value div(value a, value b) { return a/b; }
+  //: std::max(a,b)
+  static value max(value a, value b) { return std::max(a,b); }
+  static mask less(value a, value b) { return a<b; }
+  static mask less_equal(value a, value b) { return a<=b; }
+  static mask both(mask a, mask b) { return a && b; }
+  //: m ? a : b
+  static value select(mask m, value a, value b) { return m ? a : b; }
+  //: bit l is set if lane l of m is set
+  static unsigned bits(mask m) { return m ? 1u : 0u; }
+};
+
+#ifdef BBGM_SOA_SSE2
+//: The operations of the update kernel, on four floats
+struct bbgm_soa_lane4
+{
+  typedef __m128 value;
+  typedef __m128 mask;
+  enum { width = 4 };
+
+  static value load(const float* p) { return _mm_loadu_ps(p); }
+  static void store(float* p, value v) { _mm_storeu_ps(p,v); }
+  static value set(float v) { return _mm_set1_ps(v); }
+  static value add(value a, value b) { return _mm_add_ps(a,b); }
+  static value sub(value a, value b) { return _mm_sub_ps(a,b); }
+  static value mul(value a, value b) { return _mm_mul_ps(a,b); }
+  static value div(value a, value b) { return _mm_div_ps(a,b); }
+  //: std::max(a,b), which returns a unless a<b; maxps returns its second operand unless the first is larger
+  static value max(value a, value b) { return _mm_max_ps(b,a); }
+  static mask less(value a, value b) { return _mm_cmplt_ps(a,b); }
+  static mask less_equal(value a, value b) { return _mm_cmple_ps(a,b); }
+  static mask both(mask a, mask b) { return _mm_and_ps(a,b); }
+  //: m ? a : b
+  static value select(mask m, value a, value b)
+  { return _mm_or_ps(_mm_and_ps(m,a), _mm_andnot_ps(m,b)); }
+  //: bit l is set if lane l of m is set
+  static unsigned bits(mask m) { return unsigned(_mm_movemask_ps(m)); }
+};
+#endif // BBGM_SOA_SSE2
+
+
+//: The Gaussian calculations of the update kernel
+// These repeat the operations of the bsta code in the same order, so the
+// results are the same.
+template <class gauss_>
+struct bbgm_soa_gauss_kernel;
+
+//: Gaussians with independent (diagonal) covariance
+template <unsigned n>
+struct bbgm_soa_gauss_kernel<bsta_gaussian_indep<float,n> >
+{
+  //: As bsta_gaussian_indep<float,n>::sqr_mahalanobis_dist()
+  template <class L>
+  static typename L::value sqr_mahalanobis(const typename L::value* mean,
+                                           const typename L::value* covar,
+                                           const typename L::value* x)
+  {
+    typename L::value det = covar[0];
+    for (unsigned c=1; c<n; ++c)
+      det = L::mul(covar[c],det);
+    typename L::value sum = L::set(0.0f);
+    for (unsigned d=0; d<n; ++d) {
+      typename L::value diff = L::sub(mean[d],x[d]);
+      sum = L::add(L::div(L::mul(diff,diff),covar[d]),sum);
+    }
+    return L::select(L::less_equal(det,L::set(0.0f)),
+                     L::set(std::numeric_limits<float>::infinity()), sum);
+  }
+
+  //: As bsta_update_gaussian() with a minimum variance
+  template <class L>
+  static void update(typename L::value* mean, typename L::value* covar,
+                     typename L::value rho, const typename L::value* x,
+                     typename L::value min_var)
+  {
+    const typename L::value rho_comp = L::sub(L::set(1.0f),rho);
+    const typename L::value rr = L::mul(rho,rho_comp);
+    for (unsigned d=0; d<n; ++d) {
+      typename L::value diff = L::sub(x[d],mean[d]);
+      typename L::value c = L::add(L::mul(rho_comp,covar[d]), L::mul(rr,L::mul(diff,diff)));
+      mean[d] = L::add(mean[d],L::mul(rho,diff));
+      covar[d] = L::max(c,min_var);
+    }
+  }
+};
+
+//: One dimensional Gaussians
+template <>
+struct bbgm_soa_gauss_kernel<bsta_gaussian_sphere<float,1> >
+{
+  //: As bsta_gaussian_sphere<float,1>::sqr_mahalanobis_dist()
+  template <class L>
+  static typename L::value sqr_mahalanobis(const typename L::value* mean,
+                                           const typename L::value* var,
+                                           const typename L::value* x)
+  {
+    typename L::value diff = L::sub(mean[0],x[0]);
+    return L::select(L::less_equal(var[0],L::set(0.0f)),
+                     L::set(std::numeric_limits<float>::infinity()),
+                     L::div(L::mul(diff,diff),var[0]));
+  }
+
+  //: As bsta_update_gaussian() with a minimum variance
+  template <class L>
+  static void update(typename L::value* mean, typename L::value* var,
+                     typename L::value rho, const typename L::value* x,
+                     typename L::value min_var)
+  {
+    const typename L::value rho_comp = L::sub(L::set(1.0f),rho);
+    typename L::value diff = L::sub(x[0],mean[0]);
+    typename L::value v = L::add(L::mul(rho_comp,var[0]),
+                                 L::mul(L::mul(L::mul(rho,rho_comp),diff),diff));
+    mean[0] = L::add(mean[0],L::mul(rho,diff));
+    var[0] = L::max(v,min_var);
+  }
+};
+
+
+//: Update the pixels i to i+L::width-1 of row j whose samples match their first component
+// \p x_rows holds a pointer to row j of each sample plane, and \p window the
+// window size of the updater.  Returns a bit for each lane left to
+// bbgm_soa_update_pixel().
+template <class L, class gauss_, unsigned s>
+unsigned bbgm_soa_update_lanes(bbgm_soa_mixture_image<gauss_,s>& dimg,
+                               unsigned i, unsigned j, const float* const* x_rows,
+                               float window, float gt2, float min_var)
+{
+  typedef typename L::value V;
+  typedef typename L::mask M;
+  typedef bbgm_soa_gauss_kernel<gauss_> kernel;
+  const unsigned n = bbgm_soa_mixture_image<gauss_,s>::dimension;
+  const unsigned nv = bbgm_soa_mixture_image<gauss_,s>::covar_size;
+  const unsigned all_lanes = (1u << L::width) - 1;
+  const V one = L::set(1.0f);
+
+  const V nc = L::load(dimg.num_components_row(j)+i);
+  V x[n], mean[n], covar[nv];
+  for (unsigned d=0; d<n; ++d) {
+    x[d] = L::load(x_rows[d]+i);
+    mean[d] = L::load(dimg.mean_row(0,d,j)+i);
+  }
+  for (unsigned c=0; c<nv; ++c)
+    covar[c] = L::load(dimg.covar_row(0,c,j)+i);
+
+  const M match = L::both(L::less(L::set(0.0f),nc),
+                          L::less(kernel::template sqr_mahalanobis<L>(mean,covar,x), L::set(gt2)));
+  const unsigned match_bits = L::bits(match);
+  if (!match_bits)
+    return all_lanes;
+
+  float* obs = dimg.obs_row(j)+i;
+  const V n_obs = L::load(obs);
+  const V new_n_obs = L::select(L::less(n_obs,L::set(window)), L::add(n_obs,one), n_obs);
+  L::store(obs, L::select(match,new_n_obs,n_obs));
+  const V alpha = L::div(one,new_n_obs);
+  const V decay = L::sub(one,alpha);
+
+  // the first component takes the sample
+  float* w0 = dimg.weight_row(0,j)+i;
+  const V w = L::load(w0);
+  L::store(w0, L::select(match, L::add(L::mul(decay,w),alpha), w));
+  float* g_obs = dimg.component_obs_row(0,j)+i;
+  const V old_g_obs = L::load(g_obs);
+  const V new_g_obs = L::add(old_g_obs,one);
+  L::store(g_obs, L::select(match,new_g_obs,old_g_obs));
+  const V rho = L::add(L::div(decay,new_g_obs),alpha);
+  V new_mean[n], new_covar[nv];
+  std::copy(mean, mean+n, new_mean);
+  std::copy(covar, covar+nv, new_covar);
+  kernel::template update<L>(new_mean,new_covar,rho,x,L::set(min_var));
+  for (unsigned d=0; d<n; ++d)
+    L::store(dimg.mean_row(0,d,j)+i, L::select(match,new_mean[d],mean[d]));
+  for (unsigned c=0; c<nv; ++c)
+    L::store(dimg.covar_row(0,c,j)+i, L::select(match,new_covar[c],covar[c]));
+
+  // the other components only lose weight
+  for (unsigned k=1; k<s; ++k) {
+    const M active = L::both(match, L::less(L::set(float(k)),nc));
+    float* wk = dimg.weight_row(k,j)+i;
+    const V old_w = L::load(wk);
+    L::store(wk, L::select(active,L::mul(decay,old_w),old_w));
+  }
+  return all_lanes & ~match_bits;
+}
+
+
+//: Update pixel (i,j) with the updater itself
+template <class gauss_, unsigned s, class updater_>
+void bbgm_soa_update_pixel(bbgm_soa_mixture_image<gauss_,s>& dimg,
+                           unsigned i, unsigned j, const float* const* x_rows,
+                           const updater_& updater)
+{
+  typedef bbgm_soa_mixture_image<gauss_,s> image_type;
+  float x[image_type::dimension];
+  for (unsigned d=0; d<image_type::dimension; ++d)
+    x[d] = x_rows[d][i];
+  typename image_type::dist_type mix = dimg(i,j);
+  updater(mix, image_type::traits::sample(x));
+  dimg.set(i,j,mix);
+}
+
+
+//: Updates a range of rows of a bbgm_soa_mixture_image, for vnl_parallel_for
+template <class gauss_, unsigned s, class T, class updater_>
+class bbgm_soa_row_updater
+{
+ public:
+  typedef bbgm_soa_mixture_image<gauss_,s> image_type;
+
+  bbgm_soa_row_updater(image_type& dimg, const vil_image_view<T>& image,
+                       const updater_& updater, float window)
+  : dimg_(dimg), image_(image), shared_updater_(updater), window_(window) {}
+
+  void operator()(unsigned j0, unsigned j1) const
+  {
+    const unsigned n = image_type::dimension;
+    const unsigned ni = dimg_.ni();
+    // insert() changes the model Gaussian kept by the updater, so each range has its own copy
+    updater_ updater(shared_updater_);
+    std::vector<float> samples(n*ni);
+    const float* x_rows[n];
+    for (unsigned d=0; d<n; ++d)
+      x_rows[d] = &samples[0] + d*ni;
+
+    for (unsigned j=j0; j<j1; ++j)
+    {
+      const T* row = image_.top_left_ptr() + j*image_.jstep();
+      for (unsigned d=0; d<n; ++d) {
+        const T* p = row + d*image_.planestep();
+        float* x = &samples[0] + d*ni;
+        for (unsigned i=0; i<ni; ++i, p+=image_.istep())
+          x[i] = static_cast<float>(*p);
+      }
+
+      unsigned i = 0;
+#ifdef BBGM_SOA_SSE2
+      for (; i+4<=ni; i+=4) {
+        unsigned left = bbgm_soa_update_lanes<bbgm_soa_lane4>(dimg_,i,j,x_rows,window_,
+                                                              updater.gt2_,updater.min_var_);
+        for (unsigned l=0; left; ++l, left>>=1)
+          if (left & 1)
+            bbgm_soa_update_pixel(dimg_,i+l,j,x_rows,updater);
+      }
+#endif
+      for (; i<ni; ++i)
+        if (bbgm_soa_update_lanes<bbgm_soa_lane1>(dimg_,i,j,x_rows,window_,
+                                                  updater.gt2_,updater.min_var_))
+          bbgm_soa_update_pixel(dimg_,i,j,x_rows,updater);
+    }
+  }
+
+ private:
+  image_type& dimg_;
+  const vil_image_view<T>& image_;
+  const updater_& shared_updater_;
+  //: the number of observations after which the learning rate stays fixed
+  float window_;
+};
+
+
+//: Update with a new sample image, splitting the rows across threads
+template <class gauss_, unsigned s, class T, class updater_>
+void bbgm_soa_update(bbgm_soa_mixture_image<gauss_,s>& dimg,
+                     const vil_image_view<T>& image,
+                     const updater_& updater, float window)
+{
+  typedef bbgm_soa_row_updater<gauss_,s,T,updater_> row_updater_type;
+  assert(dimg.ni() == image.ni());
+  assert(dimg.nj() == image.nj());
+  assert(row_updater_type::image_type::dimension == image.nplanes());
+  if (image.ni() == 0)
+    return;
+  row_updater_type row_updater(dimg,image,updater,window);
+  // several rows per thread, so small images are not split up
+  vnl_parallel_for(0, image.nj(), row_updater, 16);
+}
+
+
+//: Update with a new sample image
+template <class gauss_, unsigned s, class T>
+void update(bbgm_soa_mixture_image<gauss_,s>& dimg,
+            const vil_image_view<T>& image,
+            const bsta_mg_grimson_statistical_updater<bsta_mixture_fixed<bsta_num_obs<gauss_>,s> >& updater)
+{
+  bbgm_soa_update(dimg, image, updater, std::numeric_limits<float>::infinity());
+}
+
+
+//: Update with a new sample image
+template <class gauss_, unsigned s, class T>
+void update(bbgm_soa_mixture_image<gauss_,s>& dimg,
+            const vil_image_view<T>& image,
+            const bsta_mg_grimson_window_updater<bsta_mixture_fixed<bsta_num_obs<gauss_>,s> >& updater)
+{
+  bbgm_soa_update(dimg, image, updater, float(updater.window_size()));
+}
+
+
+#endif // bbgm_soa_update_h_
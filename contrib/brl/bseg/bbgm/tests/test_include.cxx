@@ -11,6 +11,8 @@
 #include <bbgm/bbgm_loader.h>
 #include <bbgm/bbgm_measure.h>
 #include <bbgm/bbgm_planes_to_sample.h>
+#include <bbgm/bbgm_soa_mixture_image.h>
+#include <bbgm/bbgm_soa_update.h>
 #include <bbgm/bbgm_update.h>
 #include <bbgm/bbgm_view_maker.h>
 #include <bbgm/bbgm_viewer.h>
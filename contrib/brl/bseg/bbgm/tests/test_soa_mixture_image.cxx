@@ -0,0 +1,193 @@
+//:
+// \file
+// \brief Tests that the planar mixture image updates and saves exactly like bbgm_image_of
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <vector>
+#include <testlib/testlib_test.h>
+#include <vcl_compiler.h>
+
+#include <bbgm/bbgm_image_of.h>
+#include <bbgm/bbgm_update.h>
+#include <bbgm/bbgm_soa_mixture_image.h>
+#include <bbgm/bbgm_soa_update.h>
+#include <bsta/bsta_attributes.h>
+#include <bsta/bsta_mixture_fixed.h>
+#include <bsta/bsta_gauss_if3.h>
+#include <bsta/bsta_gauss_sf1.h>
+#include <bsta/algo/bsta_adaptive_updater.h>
+#include <vil/vil_image_view.h>
+#include <vnl/vnl_random.h>
+#include <vnl/vnl_parallel_for.h>
+#include <vsl/vsl_binary_io.h>
+#include <vul/vul_timer.h>
+
+namespace
+{
+
+//: A background with noise, and a square moving across it that matches nothing
+template <class T>
+std::vector<vil_image_view<T> > make_sequence(unsigned ni, unsigned nj, unsigned np,
+                                              unsigned n_frames, float scale)
+{
+  vnl_random rand(9876);
+  vil_image_view<T> background(ni,nj,np);
+  for (unsigned p=0; p<np; ++p)
+    for (unsigned j=0; j<nj; ++j)
+      for (unsigned i=0; i<ni; ++i)
+        background(i,j,p) = T(scale*float(rand.drand32(0.2,0.8)));
+
+  std::vector<vil_image_view<T> > frames;
+  for (unsigned t=0; t<n_frames; ++t) {
+    vil_image_view<T> frame(ni,nj,np);
+    for (unsigned p=0; p<np; ++p)
+      for (unsigned j=0; j<nj; ++j)
+        for (unsigned i=0; i<ni; ++i) {
+          float v = float(background(i,j,p)) + scale*float(rand.normal()*0.02);
+          // now and then a pixel flickers
+          if (rand.drand32() < 0.03)
+            v = scale*float(rand.drand32());
+          // the square
+          if (t > 3 && i >= 2*t && i < 2*t+9 && j >= t && j < t+7)
+            v = scale*0.95f;
+          frame(i,j,p) = T(std::min(std::max(v,0.0f),scale));
+        }
+    frames.push_back(frame);
+  }
+  return frames;
+}
+
+//: The bytes written by b_write()
+std::string saved(const bbgm_image_base& image)
+{
+  std::ostringstream s;
+  vsl_b_ostream os(&s);
+  image.b_write(os);
+  return s.str();
+}
+
+//: Update both images with every frame, checking that they stay equal
+template <class gauss_, class T, class updater_>
+void test_update(const char* name, const std::vector<vil_image_view<T> >& frames,
+                 const updater_& updater, unsigned max_components)
+{
+  typedef bbgm_soa_mixture_image<gauss_,3> soa_type;
+  typedef typename soa_type::dist_type dist_type;
+  const unsigned ni = frames[0].ni(), nj = frames[0].nj();
+
+  bbgm_image_of<dist_type> model(ni,nj,dist_type());
+  soa_type soa_model(model);
+  bool same = saved(model) == saved(soa_model);
+  for (unsigned t=0; t<frames.size(); ++t) {
+    update(model,frames[t],updater);
+    update(soa_model,frames[t],updater);
+    same = same && saved(model) == saved(soa_model);
+  }
+  std::cout << name << '\n';
+  TEST("same mixtures after each frame", same, true);
+
+  unsigned n_mixed = 0, n_full = 0;
+  for (unsigned j=0; j<nj; ++j)
+    for (unsigned i=0; i<ni; ++i) {
+      dist_type d = soa_model(i,j);
+      if (d.num_components() > 1) ++n_mixed;
+      if (d.num_components() == max_components) ++n_full;
+      if (d.num_components() != model(i,j).num_components() ||
+          d.num_observations != model(i,j).num_observations)
+        same = false;
+    }
+  std::cout << n_mixed << " pixels with several components, " << n_full << " with " << max_components << '\n';
+  TEST("pixels are read back", same, true);
+  TEST("new components are inserted", n_mixed > 0 && n_full > 0, true);
+}
+
+} // namespace
+
+static void test_soa_mixture_image()
+{
+  const unsigned saved_threads = vnl_parallel::max_threads();
+  vnl_parallel::set_max_threads(4);
+
+  // colour, with a width that is not a multiple of the lanes
+  const unsigned ni = 39, nj = 34;
+  std::vector<vil_image_view<float> > colour = make_sequence<float>(ni,nj,3,12,1.0f);
+  bsta_gauss_if3 init_if3(vnl_vector_fixed<float,3>(0.0f), vnl_vector_fixed<float,3>(0.01f));
+  typedef bsta_mixture_fixed<bsta_num_obs<bsta_gauss_if3>,3> mix_if3;
+  test_update<bsta_gauss_if3>("window updater", colour,
+                              bsta_mg_grimson_window_updater<mix_if3>(init_if3,3,3.0f,0.02f,5), 3);
+  test_update<bsta_gauss_if3>("statistical updater", colour,
+                              bsta_mg_grimson_statistical_updater<mix_if3>(init_if3,3,2.5f,0.0f), 3);
+  // fewer components than the mixture can hold
+  test_update<bsta_gauss_if3>("two component updater", colour,
+                              bsta_mg_grimson_window_updater<mix_if3>(init_if3,2,3.0f,0.02f,5), 2);
+
+  // grey bytes
+  std::vector<vil_image_view<vxl_byte> > grey = make_sequence<vxl_byte>(ni,nj,1,12,255.0f);
+  bsta_gauss_sf1 init_sf1(0.0f, 100.0f);
+  typedef bsta_mixture_fixed<bsta_num_obs<bsta_gauss_sf1>,3> mix_sf1;
+  test_update<bsta_gauss_sf1>("grey window updater", grey,
+                              bsta_mg_grimson_window_updater<mix_sf1>(init_sf1,3,3.0f,1.0f,8), 3);
+
+  // binary io
+  {
+    typedef bbgm_soa_mixture_image<bsta_gauss_if3,3> soa_type;
+    typedef soa_type::dist_type dist_type;
+    bsta_mg_grimson_window_updater<mix_if3> updater(init_if3,3,3.0f,0.02f,5);
+    bbgm_image_of<dist_type> model(ni,nj,dist_type());
+    for (unsigned t=0; t<colour.size(); ++t)
+      update(model,colour[t],updater);
+
+    std::stringstream s;
+    vsl_b_ostream os(&s);
+    model.b_write(os);
+    vsl_b_istream is(&s);
+    soa_type soa_model;
+    soa_model.b_read(is);
+    TEST("read a bbgm_image_of", !is, false);
+    TEST("size read", soa_model.ni() == ni && soa_model.nj() == nj, true);
+    TEST("written back unchanged", saved(soa_model) == saved(model), true);
+
+    std::stringstream s2;
+    vsl_b_ostream os2(&s2);
+    soa_model.b_write(os2);
+    vsl_b_istream is2(&s2);
+    bbgm_image_of<dist_type> model2;
+    model2.b_read(is2);
+    TEST("bbgm_image_of reads it", !is2, false);
+    TEST("same mixtures read", saved(model2) == saved(model), true);
+    TEST("same is_a()", soa_model.is_a(), model.is_a());
+
+    soa_type copy(soa_model);
+    copy.copy_to(model2);
+    TEST("copy_to", saved(model2) == saved(model), true);
+  }
+
+  // timing
+  {
+    const unsigned big_ni = 640, big_nj = 480;
+    std::vector<vil_image_view<float> > frames = make_sequence<float>(big_ni,big_nj,3,5,1.0f);
+    typedef bbgm_soa_mixture_image<bsta_gauss_if3,3> soa_type;
+    typedef soa_type::dist_type dist_type;
+    bsta_mg_grimson_window_updater<mix_if3> updater(init_if3,3,3.0f,0.02f,50);
+    bbgm_image_of<dist_type> model(big_ni,big_nj,dist_type());
+    soa_type soa_model(model);
+    double aos_time = 0.0, soa_time = 0.0;
+    for (unsigned t=0; t<frames.size(); ++t) {
+      vul_timer time;
+      update(model,frames[t],updater);
+      aos_time += time.real();
+      time.mark();
+      update(soa_model,frames[t],updater);
+      soa_time += time.real();
+    }
+    std::cout << big_ni << 'x' << big_nj << " colour frames: bbgm_image_of "
+              << aos_time/frames.size() << " ms, planes " << soa_time/frames.size()
+              << " ms (" << vnl_parallel::max_threads() << " threads)\n";
+    TEST("same mixtures for a large image", saved(model) == saved(soa_model), true);
+  }
+
+  vnl_parallel::set_max_threads(saved_threads);
+}
+
+TESTMAIN(test_soa_mixture_image);
@@ -1,4 +1,5 @@
 #include <bbgm/bbgm_feature_image.hxx>
 #include <bbgm/bbgm_image_of.hxx>
+#include <bbgm/bbgm_soa_mixture_image.hxx>
 
 int main() { return 0; }
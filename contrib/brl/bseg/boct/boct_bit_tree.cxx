@@ -6,6 +6,12 @@
 #include <cstring>
 #include "boct_bit_tree.h"
 #include "boct_tree_cell.h"
+#include <vxl_config.h>
+
+#if VXL_HAS_EMMINTRIN_H && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+# define BOCT_BIT_TREE_SSE2 1
+# include <emmintrin.h>
+#endif
 
 //: default constructor
 boct_bit_tree::boct_bit_tree()
@@ -77,6 +83,49 @@ int boct_bit_tree::traverse(const vgl_point_3d<double> p, int deepest)
   return bit_index;
 }
 
+//: Child indices c_index (binary zyx) at depths 1, 2 and 3 of the point (x,y,z).
+//  The x code at depth d is floor(2^d x) & 1, which is bit 3-d of floor(8x),
+//  so a single floor per axis gives the path to the deepest level.
+static inline void boct_bit_tree_child_indices(float x, float y, float z, int c_index[3])
+{
+#if BOCT_BIT_TREE_SSE2
+  __m128 p = _mm_mul_ps(_mm_set_ps(0.0f, z, y, x), _mm_set1_ps(8.0f));
+  __m128i f = _mm_cvttps_epi32(p);
+  // truncation rounds negative values up: subtract 1 (add the all-ones mask) where it did
+  f = _mm_add_epi32(f, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(f), p)));
+  // move bit 3-d of each axis into the sign bit, and gather the signs as zyx
+  c_index[0] = _mm_movemask_ps(_mm_castsi128_ps(_mm_slli_epi32(f, 29))) & 7;
+  c_index[1] = _mm_movemask_ps(_mm_castsi128_ps(_mm_slli_epi32(f, 30))) & 7;
+  c_index[2] = _mm_movemask_ps(_mm_castsi128_ps(_mm_slli_epi32(f, 31))) & 7;
+#else
+  int fx = (int)std::floor(8.0f*x);
+  int fy = (int)std::floor(8.0f*y);
+  int fz = (int)std::floor(8.0f*z);
+  for (int d=0; d<3; ++d)
+    c_index[d] = ((fx>>(2-d)) & 1) + (((fy>>(2-d)) & 1)<<1) + (((fz>>(2-d)) & 1)<<2);
+#endif
+}
+
+//: traverse the 16 byte tree \a bits to the leaf that contains the point
+int boct_bit_tree::traverse_bits(unsigned char const* bits, float x, float y, float z, int& depth)
+{
+  int c_index[3];
+  boct_bit_tree_child_indices(x, y, z, c_index);
+
+  //same descent as traverse(), which always stops at depth 3
+  int curr_bit = (int)(bits[0]);
+  int child_offset = 0;
+  int bit_index = 0;
+  depth = 0;
+  while (curr_bit && depth < 3) {
+    bit_index = (8*bit_index + 1) + c_index[depth];
+    curr_bit = (1<<c_index[depth]) & bits[(depth+1 + child_offset)];
+    child_offset = c_index[depth];
+    depth++;
+  }
+  return bit_index;
+}
+
 int boct_bit_tree::traverse_to_level(const vgl_point_3d<double> p, int deepest)
 {
   //deepest level to traverse is either
@@ -270,8 +319,21 @@ int boct_bit_tree::get_data_index(int bit_index, bool is_random) const
   return count_offset + this->get_relative_index(bit_index);
 }
 
+//: Return cell with a particular locational code of the 16 byte tree \a bits
+int boct_bit_tree::data_index_bits(unsigned char const* bits, int bit_index)
+{
+  int count_offset = (int) (bits[13]<<24) | (bits[12]<<16) | (bits[11]<<8) | (bits[10]);
+  return count_offset + relative_index_bits(bits, bit_index);
+}
+
 //: returns bit index assuming root data is located at 0
 int  boct_bit_tree::get_relative_index(int bit_index) const
+{
+  return relative_index_bits(bits_, bit_index);
+}
+
+//: returns bit index of the 16 byte tree \a bits assuming root data is located at 0
+int boct_bit_tree::relative_index_bits(unsigned char const* bits, int bit_index)
 {
   if (bit_index < 9)
     return bit_index;
@@ -283,11 +345,11 @@ int  boct_bit_tree::get_relative_index(int bit_index) const
   //count pre parent bits
   int count=0;
   for (int i=0; i<byte_index; ++i)
-    count += bit_lookup[bits_[i]];
+    count += bit_lookup[bits[i]];
 
   //dont forget parent bits occurring the parent BYTE
   unsigned char sub_bit_index = 8-((oneuplevel-1)&(8-1));
-  unsigned char temp = bits_[byte_index]<<sub_bit_index;
+  unsigned char temp = bits[byte_index]<<sub_bit_index;
 
   count = count + bit_lookup[temp];
   unsigned char finestleveloffset=(bit_index-1)&(8-1);
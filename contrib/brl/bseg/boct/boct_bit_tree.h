@@ -46,6 +46,16 @@ class boct_bit_tree
   //: traverse tree to get leaf index that contains point
   int traverse(const vgl_point_3d<double> p, int deepest=4);
 
+  //: traverse the 16 byte tree \a bits to the leaf that contains point (x,y,z)
+  //  Gives the same leaf as traverse() with the default \a deepest, without
+  //  copying the tree, and uses SSE2 where available.
+  //  \a depth is set to the depth of the leaf.
+  static int traverse_bits(unsigned char const* bits, float x, float y, float z, int& depth);
+
+  //: Returns index of data for given bit of the 16 byte tree \a bits
+  //  Same as get_data_index(bit_index), without copying the tree.
+  static int data_index_bits(unsigned char const* bits, int bit_index);
+
   //: traverse tree to get leaf index that contains point
 
   int traverse_to_level(const vgl_point_3d<double> p, int deepest=4);
@@ -119,6 +129,9 @@ class boct_bit_tree
   static float         centerZ[585];
  private:
 
+  //: bit index relative to the root data of the tree \a bits
+  static int relative_index_bits(unsigned char const* bits, int bit_index);
+
   //: Tree structure stored as "bits" = really a char array
   unsigned char* bits_;
   //: Maximum number of levels in the octree
@@ -2,6 +2,7 @@
 #include <testlib/testlib_test.h>
 
 #include <boct/boct_bit_tree.h>
+#include <vnl/vnl_random.h>
 #include <vcl_compiler.h>
 
 void test_print_centers()
@@ -78,6 +79,44 @@ void test_print_centers()
   std::cout<<centerZ[584]<<"};"<<std::endl;
 }
 
+//: traverse_bits() and data_index_bits() agree with traverse() and get_data_index() on random trees
+static void test_traverse_bits()
+{
+  vnl_random rand(9667566);
+  bool same_leaf = true, same_depth = true, same_data = true;
+  for (int t=0; t<200; ++t)
+  {
+    // a random, valid tree: a cell can only be split if its parent is
+    unsigned char init[16] = {0};
+    init[0] = rand.drand32() < 0.9 ? 1 : 0;
+    int data_ptr = rand.lrand32(0, 100000);
+    init[10] = (unsigned char)(data_ptr & 0xff);
+    init[11] = (unsigned char)((data_ptr>>8) & 0xff);
+    init[12] = (unsigned char)((data_ptr>>16) & 0xff);
+    boct_bit_tree tree(init, 4);
+    for (int i=1; i<73; ++i)
+      tree.set_bit_at(i, tree.bit_at(tree.parent_index(i)) && rand.drand32() < 0.5);
+    unsigned char const* bits = tree.get_bits();
+
+    for (int p=0; p<200; ++p)
+    {
+      // include points on cell boundaries and slightly outside the tree, as in ray casting
+      float x = p < 20 ? float(rand.lrand32(0, 8))/8.0f : float(rand.drand32(-0.01, 1.01));
+      float y = p < 20 ? float(rand.lrand32(0, 8))/8.0f : float(rand.drand32(-0.01, 1.01));
+      float z = float(rand.drand32(-0.01, 1.01));
+      int bit_index = tree.traverse(vgl_point_3d<double>(x,y,z));
+      int depth;
+      int fast_index = boct_bit_tree::traverse_bits(bits, x, y, z, depth);
+      same_leaf = same_leaf && fast_index == bit_index;
+      same_depth = same_depth && depth == tree.depth_at(bit_index);
+      same_data = same_data && boct_bit_tree::data_index_bits(bits, fast_index) == tree.get_data_index(bit_index);
+    }
+  }
+  TEST("traverse_bits finds the same leaf as traverse", same_leaf, true);
+  TEST("traverse_bits returns the depth of the leaf", same_depth, true);
+  TEST("data_index_bits is the same as get_data_index", same_data, true);
+}
+
 static void test_bit_tree()
 {
     unsigned char bits[73] = {  1,
@@ -151,6 +190,8 @@ static void test_bit_tree()
   TEST("Size of tree = 89", size, 89);
 
   test_print_centers();
+
+  test_traverse_bits();
 }
 
 TESTMAIN(test_bit_tree);
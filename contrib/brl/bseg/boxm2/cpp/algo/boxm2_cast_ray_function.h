@@ -5,6 +5,7 @@
 
 #include <iostream>
 #include <algorithm>
+#include <cmath>
 #include <vgl/vgl_ray_3d.h>
 
 #include <vcl_cassert.h>
@@ -48,8 +49,6 @@ void boxm2_cast_ray_function(vgl_ray_3d<double> & ray_ij,
     vgl_vector_3d<float> direction(dray_ij_x,dray_ij_y,dray_ij_z);
     vgl_ray_3d<float> ray(block_origin,direction);
 
-    typedef vnl_vector_fixed<unsigned char, 16> uchar16;    //defines a bit tree
-
     float ray_dx=ray.direction().x();
     float ray_dy=ray.direction().y();
     float ray_dz=ray.direction().z();
@@ -102,10 +101,8 @@ void boxm2_cast_ray_function(vgl_ray_3d<double> & ray_ij,
     float cell_miny = boxm2_util::clamp(std::floor(posy), 0.0f, linfo->scene_dims[1]-1.0f);
     float cell_minz = boxm2_util::clamp(std::floor(posz), 0.0f, linfo->scene_dims[2]-1.0f);
 
-    //load current block/tree
-    uchar16 tree=blk_sptr->trees()((unsigned short)cell_minx,(unsigned short)cell_miny,(unsigned short)cell_minz);
-
-    boct_bit_tree bit_tree((unsigned char*)tree.data_block(),linfo->root_level+1);
+    //current block/tree, used in place
+    unsigned char const* tree=blk_sptr->trees()((unsigned short)cell_minx,(unsigned short)cell_miny,(unsigned short)cell_minz).data_block();
 
     //local ray origin is entry point (point should be in [0,1])
     //(note that cell_min is the current block index at this point)
@@ -135,15 +132,15 @@ void boxm2_cast_ray_function(vgl_ray_3d<double> & ray_ij,
       // traverse to leaf cell that contains the entry point, set bounding box
       //data offset is ushort pointed to by tree + bit offset
 
-      int bit_index=bit_tree.traverse(vgl_point_3d<double>(posx,posy,posz));
-      int depth =bit_tree.depth_at(bit_index);
-      float cell_len=std::pow((float)2,(float)-depth);
+      int depth;
+      int bit_index=boct_bit_tree::traverse_bits(tree,posx,posy,posz,depth);
+      float cell_len=std::ldexp(1.0f,-depth);
 
       cell_minx=std::floor(posx/cell_len)* cell_len;
       cell_miny=std::floor(posy/cell_len)* cell_len;
       cell_minz=std::floor(posz/cell_len)* cell_len;
 
-      int data_offset=bit_tree.get_data_index(bit_index);
+      int data_offset=boct_bit_tree::data_index_bits(tree,bit_index);
 
       // check to see how close tnear and tfar are
       cell_minx = (ray_dx > 0.0f) ? cell_minx+cell_len : cell_minx;
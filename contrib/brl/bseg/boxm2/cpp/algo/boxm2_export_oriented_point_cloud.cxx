@@ -48,6 +48,7 @@ export_oriented_point_cloud(boxm2_scene_sptr scene, boxm2_cache_sptr cache,
       continue;
 
     std::cout << "Processing Block: "<<id<< " with prob t: " << prob_t << ", vis t: " << vis_t << " and nmag_t: " << nmag_t << " finest cell length: " << finest_cell_length << std::endl;
+    boxm2_block_pin pin(cache, scene, id);
     boxm2_block *     blk     = cache->get_block(scene,id);
 
     //get data sizes
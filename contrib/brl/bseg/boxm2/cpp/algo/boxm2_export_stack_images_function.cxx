@@ -56,6 +56,7 @@ void boxm2_export_stack_images_function::export_opacity_stack_images(const boxm2
   for (blk_iter = blocks.begin(); blk_iter != blocks.end(); ++blk_iter)
   {
     std::cout << "Block id " << blk_iter->first << std::endl;
+    boxm2_block_pin pin(cache, nc_scene, blk_iter->first);
     boxm2_block  * blk = cache->get_block(nc_scene, blk_iter->first);
     boxm2_data_base *  alpha_base = cache->get_data_base(nc_scene, blk_iter->first, boxm2_data_traits<BOXM2_ALPHA>::prefix());
     boxm2_data<BOXM2_ALPHA> *alpha_data = new boxm2_data<BOXM2_ALPHA>(alpha_base->data_buffer(), alpha_base->buffer_length(), alpha_base->block_id());
@@ -168,6 +169,7 @@ void boxm2_export_stack_images_function  ::export_greyscale_stack_images(const b
 
   for (blk_iter= blocks.begin(); blk_iter!=blocks.end(); ++blk_iter)
   {
+    boxm2_block_pin pin(cache, nc_scene, blk_iter->first);
     boxm2_block  * blk = cache->get_block(nc_scene,blk_iter->first);
     boxm2_data_base *  alpha_base  = cache->get_data_base(nc_scene, blk_iter->first,boxm2_data_traits<BOXM2_ALPHA>::prefix());
     boxm2_data<BOXM2_ALPHA> *alpha_data=new boxm2_data<BOXM2_ALPHA>(alpha_base->data_buffer(),alpha_base->buffer_length(),alpha_base->block_id());
@@ -279,6 +281,7 @@ void boxm2_export_stack_images_function::export_color_stack_images(const boxm2_s
 
   for (blk_iter= blocks.begin(); blk_iter!=blocks.end(); ++blk_iter)
   {
+    boxm2_block_pin pin(cache, nc_scene, blk_iter->first);
     boxm2_block  * blk = cache->get_block(nc_scene, blk_iter->first);
     boxm2_data_base *  alpha_base  = cache->get_data_base(nc_scene, blk_iter->first,boxm2_data_traits<BOXM2_ALPHA>::prefix());
     boxm2_data<BOXM2_ALPHA> *alpha_data=new boxm2_data<BOXM2_ALPHA>(alpha_base->data_buffer(),alpha_base->buffer_length(),alpha_base->block_id());
@@ -387,6 +390,7 @@ void boxm2_export_stack_images_function::export_float_images(const boxm2_scene_s
 
     for (blk_iter = blocks.begin(); blk_iter != blocks.end(); ++blk_iter)
     {
+        boxm2_block_pin pin(cache, nc_scene, blk_iter->first);
         boxm2_block  * blk = cache->get_block(nc_scene, blk_iter->first);
         boxm2_data_type dtype = boxm2_data_info::data_type(ident);
         boxm2_data_base *  float_base = cache->get_data_base(nc_scene, blk_iter->first, ident);
@@ -22,6 +22,7 @@ bool boxm2_extract_point_cloud::extract_point_cloud(boxm2_scene_sptr scene, boxm
     boxm2_block_metadata data = blk_iter->second;
 
     //get data from cache
+    boxm2_block_pin pin(cache, scene, id);
     boxm2_data_base * alpha = cache->get_data_base(scene, id,boxm2_data_traits<BOXM2_ALPHA>::prefix());
 
     std::size_t alphaTypeSize = (int)boxm2_data_info::datasize(boxm2_data_traits<BOXM2_ALPHA>::prefix());
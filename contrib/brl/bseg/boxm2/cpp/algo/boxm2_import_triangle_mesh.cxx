@@ -32,6 +32,7 @@ bool boxm2_import_triangle_mesh(boxm2_scene_sptr scene, boxm2_cache_sptr cache,
   {
     boxm2_block_id id = iter->first;
     boxm2_block_metadata mdata = iter->second;
+    boxm2_block_pin pin(cache, scene, id);
     boxm2_block * blk = cache->get_block(scene,id);
 
     // assume cells are cubes, i.e. subblock_dim_.x() == subblock_dim_.y() == subblock_dim_.z()
@@ -0,0 +1,288 @@
+#ifndef boxm2_parallel_cast_ray_function_h_
+#define boxm2_parallel_cast_ray_function_h_
+//:
+// \file
+// \brief Casts the rays of an image through a block on several threads
+//
+// cast_ray_per_block_parallel() and cast_ray_per_block_ordered() give the
+// same results as cast_ray_per_block(), which casts the rays one after the
+// other.  Blocks are still processed one at a time, so callers keep
+// casting through the blocks in visibility order; only the rays through
+// one block are split across threads.
+//
+// cast_ray_per_block_parallel() is for functors whose step_cell() only
+// writes to the pixel of its ray (e.g. rendering, or the update pass that
+// computes pre and vis images).  The image is split into square tiles,
+// which the threads take one at a time from a shared counter, so a
+// thread that finishes its tiles early takes on the remaining ones.
+//
+// cast_ray_per_block_ordered() is for functors whose step_cell() adds to
+// cell data shared by several rays (e.g. the update passes that fill the
+// aux data).  The threads only trace the rays, recording the cells each
+// ray passes through, a band of image columns at a time; the calling
+// thread then calls step_cell() for the recorded cells in the serial
+// order, so floating point sums come out the same.
+//
+// With one thread (vnl_parallel::max_threads()==1), or when called from
+// inside another parallel loop, both simply call cast_ray_per_block().
+//
+// The threads use the block and its data for the whole call, so callers
+// that get them from the cache hold a boxm2_block_pin around the call.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <vcl_compiler.h>
+#if VXL_FULLCXX11SUPPORT
+# include <atomic>
+#endif
+#include <vnl/vnl_parallel_for.h>
+#include <vpgl/vpgl_perspective_camera.h>
+#include <vpgl/vpgl_generic_camera.h>
+#include <boxm2/cpp/algo/boxm2_cast_ray_function.h>
+
+//: Side of the square image tiles handed out to the threads
+const unsigned boxm2_ray_tile_size = 16;
+
+//: The camera rays of pixels, for the camera types cast_ray_per_block() supports
+class boxm2_camera_rays
+{
+ public:
+  boxm2_camera_rays(vpgl_camera_double_sptr const& cam)
+  : gcam_(dynamic_cast<vpgl_generic_camera<double>*>(cam.ptr())), pcam_(VXL_NULLPTR)
+  {
+    if (!gcam_ && cam->type_name()== "vpgl_perspective_camera") {
+      pcam_ = (vpgl_perspective_camera<double>*) cam.ptr();
+      // backproject() computes and caches the svd on first use; do it before the threads start
+      pcam_->svd();
+    }
+  }
+
+  //: false if the camera type is not supported
+  bool valid() const { return gcam_ || pcam_; }
+
+  //: the ray through pixel (i,j)
+  vgl_ray_3d<double> ray(unsigned i, unsigned j) const
+  {
+    if (gcam_)
+      return gcam_->ray(i,j);
+    return pcam_->backproject(i,j);
+  }
+
+ private:
+  vpgl_generic_camera<double>* gcam_;
+  vpgl_perspective_camera<double>* pcam_;
+};
+
+//: Hands out 0, 1, 2, ... to the threads of a vnl_parallel_for, each value once
+class boxm2_ray_work_counter
+{
+ public:
+  boxm2_ray_work_counter() : next_(0) {}
+
+  //: the next value
+#if VXL_FULLCXX11SUPPORT
+  unsigned take() { return next_.fetch_add(1); }
+#else
+  // without C++11 threads, vnl_parallel_for runs on the calling thread only
+  unsigned take() { return next_++; }
+#endif
+
+ private:
+#if VXL_FULLCXX11SUPPORT
+  std::atomic<unsigned> next_;
+#else
+  unsigned next_;
+#endif
+};
+
+//: Casts the rays of each tile of the region, taking tiles from a shared counter
+template <class functor_type>
+class boxm2_ray_tile_caster
+{
+ public:
+  boxm2_ray_tile_caster(functor_type const& functor, boxm2_scene_info* linfo, boxm2_block* blk,
+                        boxm2_camera_rays const& rays, unsigned ni0, unsigned ni, unsigned nj0, unsigned nj)
+  : functor_(functor), linfo_(linfo), blk_(blk), rays_(rays), ni0_(ni0), ni_(ni), nj0_(nj0), nj_(nj),
+    tiles_i_((ni-ni0+boxm2_ray_tile_size-1)/boxm2_ray_tile_size),
+    n_tiles_(tiles_i_*((nj-nj0+boxm2_ray_tile_size-1)/boxm2_ray_tile_size)) {}
+
+  unsigned n_tiles() const { return n_tiles_; }
+
+  //: each thread runs this, until no tile is left
+  void operator()(unsigned, unsigned) const
+  {
+    for (unsigned t = next_tile_.take(); t < n_tiles_; t = next_tile_.take())
+    {
+      unsigned i0 = ni0_ + (t % tiles_i_) * boxm2_ray_tile_size;
+      unsigned j0 = nj0_ + (t / tiles_i_) * boxm2_ray_tile_size;
+      unsigned i1 = std::min(i0 + boxm2_ray_tile_size, ni_);
+      unsigned j1 = std::min(j0 + boxm2_ray_tile_size, nj_);
+      for (unsigned i=i0; i<i1; ++i)
+        for (unsigned j=j0; j<j1; ++j) {
+          vgl_ray_3d<double> ray_ij = rays_.ray(i,j);
+          boxm2_cast_ray_function<functor_type>(ray_ij,linfo_,blk_,i,j,functor_);
+        }
+    }
+  }
+
+ private:
+  functor_type const& functor_;
+  boxm2_scene_info* linfo_;
+  boxm2_block* blk_;
+  boxm2_camera_rays const& rays_;
+  unsigned ni0_, ni_, nj0_, nj_;
+  unsigned tiles_i_, n_tiles_;
+  //: the next tile to be taken by a thread
+  mutable boxm2_ray_work_counter next_tile_;
+};
+
+template <class functor_type>
+bool cast_ray_per_block_parallel(functor_type functor,
+                                 boxm2_scene_info * linfo,
+                                 boxm2_block * blk_sptr,
+                                 vpgl_camera_double_sptr cam ,
+                                 unsigned int roi_ni,
+                                 unsigned int roi_nj,
+                                 unsigned int roi_ni0=0,
+                                 unsigned int roi_nj0=0)
+{
+  if (vnl_parallel::max_threads() <= 1 || vnl_parallel::in_parallel_region())
+    return cast_ray_per_block<functor_type>(functor,linfo,blk_sptr,cam,roi_ni,roi_nj,roi_ni0,roi_nj0);
+
+  boxm2_camera_rays rays(cam);
+  if (!rays.valid()) {
+    std::cout<<"boxm2_cast_ray_function cannot dynamic cast camera"<<std::endl;
+    return false;
+  }
+  if (roi_ni <= roi_ni0 || roi_nj <= roi_nj0)
+    return true;
+
+  boxm2_ray_tile_caster<functor_type> caster(functor,linfo,blk_sptr,rays,roi_ni0,roi_ni,roi_nj0,roi_nj);
+  vnl_parallel_for(0, std::min(vnl_parallel::max_threads(), caster.n_tiles()), caster);
+  return true;
+}
+
+//: A cell a ray passes through, recorded by boxm2_ray_segment_recorder
+struct boxm2_ray_segment
+{
+  float seg_len;
+  int   data_offset;
+  float abs_depth;
+};
+
+//: The cells passed through by the rays of one image column, in ray order
+struct boxm2_ray_column
+{
+  //: the segments of all rays, one ray after the other
+  std::vector<boxm2_ray_segment> segments;
+  //: the number of segments of each ray
+  std::vector<unsigned> counts;
+};
+
+//: A functor which records the cells a ray passes through, instead of processing them
+class boxm2_ray_segment_recorder
+{
+ public:
+  boxm2_ray_segment_recorder(std::vector<boxm2_ray_segment>* segments) : segments_(segments) {}
+
+  inline bool step_cell(float seg_len, int data_offset, unsigned /*i*/, unsigned /*j*/, float abs_depth)
+  {
+    boxm2_ray_segment s = { seg_len, data_offset, abs_depth };
+    segments_->push_back(s);
+    return true;
+  }
+
+ private:
+  std::vector<boxm2_ray_segment>* segments_;
+};
+
+//: Traces the rays of a band of image columns, taking columns from a shared counter
+class boxm2_ray_column_tracer
+{
+ public:
+  boxm2_ray_column_tracer(std::vector<boxm2_ray_column>& columns, boxm2_scene_info* linfo, boxm2_block* blk,
+                          boxm2_camera_rays const& rays, unsigned i0, unsigned n_columns, unsigned nj0, unsigned nj)
+  : columns_(columns), linfo_(linfo), blk_(blk), rays_(rays), i0_(i0), n_columns_(n_columns),
+    nj0_(nj0), nj_(nj) {}
+
+  //: each thread runs this, until no column is left
+  void operator()(unsigned, unsigned) const
+  {
+    for (unsigned c = next_column_.take(); c < n_columns_; c = next_column_.take())
+    {
+      boxm2_ray_column& column = columns_[c];
+      column.segments.clear();
+      column.counts.clear();
+      boxm2_ray_segment_recorder recorder(&column.segments);
+      unsigned i = i0_ + c;
+      for (unsigned j=nj0_; j<nj_; ++j) {
+        std::size_t before = column.segments.size();
+        vgl_ray_3d<double> ray_ij = rays_.ray(i,j);
+        boxm2_cast_ray_function<boxm2_ray_segment_recorder>(ray_ij,linfo_,blk_,i,j,recorder);
+        column.counts.push_back(unsigned(column.segments.size() - before));
+      }
+    }
+  }
+
+ private:
+  std::vector<boxm2_ray_column>& columns_;
+  boxm2_scene_info* linfo_;
+  boxm2_block* blk_;
+  boxm2_camera_rays const& rays_;
+  unsigned i0_, n_columns_, nj0_, nj_;
+  //: the next column to be taken by a thread
+  mutable boxm2_ray_work_counter next_column_;
+};
+
+template <class functor_type>
+bool cast_ray_per_block_ordered(functor_type functor,
+                                boxm2_scene_info * linfo,
+                                boxm2_block * blk_sptr,
+                                vpgl_camera_double_sptr cam ,
+                                unsigned int roi_ni,
+                                unsigned int roi_nj,
+                                unsigned int roi_ni0=0,
+                                unsigned int roi_nj0=0)
+{
+  const unsigned n_threads = vnl_parallel::in_parallel_region() ? 1 : vnl_parallel::max_threads();
+  if (n_threads <= 1)
+    return cast_ray_per_block<functor_type>(functor,linfo,blk_sptr,cam,roi_ni,roi_nj,roi_ni0,roi_nj0);
+
+  boxm2_camera_rays rays(cam);
+  if (!rays.valid()) {
+    std::cout<<"boxm2_cast_ray_function cannot dynamic cast camera"<<std::endl;
+    return false;
+  }
+  if (roi_ni <= roi_ni0 || roi_nj <= roi_nj0)
+    return true;
+
+  // a few columns per thread, so the recorded cells take a bounded amount of memory
+  std::vector<boxm2_ray_column> columns(4*n_threads);
+  for (unsigned i0=roi_ni0; i0<roi_ni; i0+=unsigned(columns.size()))
+  {
+    unsigned n_columns = std::min(unsigned(columns.size()), roi_ni-i0);
+    boxm2_ray_column_tracer tracer(columns,linfo,blk_sptr,rays,i0,n_columns,roi_nj0,roi_nj);
+    vnl_parallel_for(0, std::min(n_threads, n_columns), tracer);
+
+    // process the cells in the order cast_ray_per_block() does, with one functor per ray
+    for (unsigned c=0; c<n_columns; ++c)
+    {
+      boxm2_ray_column const& column = columns[c];
+      std::vector<boxm2_ray_segment>::const_iterator s = column.segments.begin();
+      for (unsigned j=roi_nj0; j<roi_nj; ++j)
+      {
+        functor_type ray_functor(functor);
+        for (unsigned n=column.counts[j-roi_nj0]; n>0; --n, ++s)
+          ray_functor.step_cell(s->seg_len,s->data_offset,i0+c,j,s->abs_depth);
+      }
+    }
+  }
+  return true;
+}
+
+#endif // boxm2_parallel_cast_ray_function_h_
@@ -56,6 +56,7 @@ void boxm2_points_to_volume::fillVolume()
   {
     boxm2_block_id id = blk_iter->first;
     std::cout<<"Converting Block: "<<id<<std::endl;
+    boxm2_block_pin pin(cache_, scene_, id);
     boxm2_block *        blk   = cache_->get_block(scene_, id);
     boxm2_block_metadata data  = blk_iter->second;
     std::size_t           nTrees= blk->trees().size();
@@ -2,6 +2,7 @@
 #include "boxm2_render_cone_functor.h"
 #include "boxm2_render_depth_of_max_prob_functor.h"
 #include "boxm2_cast_cone_ray_function.h"
+#include "boxm2_parallel_cast_ray_function.h"
 #include <vul/vul_timer.h>
 
 void boxm2_render_expected_image( boxm2_scene_info * linfo,
@@ -19,14 +20,14 @@ void boxm2_render_expected_image( boxm2_scene_info * linfo,
   {
     boxm2_render_exp_image_functor<BOXM2_MOG3_GREY> render_functor;
     render_functor.init_data(datas,expected,vis);
-    cast_ray_per_block<boxm2_render_exp_image_functor<BOXM2_MOG3_GREY> >
+    cast_ray_per_block_parallel<boxm2_render_exp_image_functor<BOXM2_MOG3_GREY> >
       (render_functor,linfo,blk_sptr,cam,roi_ni,roi_nj,roi_ni0,roi_nj0);
   }
   else if (data_type.find(boxm2_data_traits<BOXM2_GAUSS_GREY>::prefix()) != std::string::npos )
   {
     boxm2_render_exp_image_functor<BOXM2_GAUSS_GREY> render_functor;
     render_functor.init_data(datas,expected,vis);
-    cast_ray_per_block<boxm2_render_exp_image_functor<BOXM2_GAUSS_GREY> >
+    cast_ray_per_block_parallel<boxm2_render_exp_image_functor<BOXM2_GAUSS_GREY> >
       (render_functor,linfo,blk_sptr,cam,roi_ni,roi_nj,roi_ni0,roi_nj0);
   }
 }
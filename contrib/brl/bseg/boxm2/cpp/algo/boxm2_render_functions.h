@@ -3,6 +3,9 @@
 
 // Render block functions (make use of the render functor classes)
 //
+// The block and data must stay in memory during the call; callers that get
+// them from the cache hold a boxm2_block_pin around each block.
+//
 #include "boxm2_render_exp_image_functor.h"
 #include "boxm2_render_exp_depth_functor.h"
 #include <boxm2/io/boxm2_cache.h>
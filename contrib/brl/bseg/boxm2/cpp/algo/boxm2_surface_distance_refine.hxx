@@ -21,6 +21,7 @@ void boxm2_surface_distance_refine(D const& dist_functor, boxm2_scene_sptr scene
     {
       boxm2_block_id id = iter->first;
       boxm2_block_metadata mdata = iter->second;
+      boxm2_block_pin pin(boxm2_cache::instance(), scene, id);
       boxm2_block_sptr blk = boxm2_cache::instance()->get_block(scene,id);
       // multiply by 0.99 since split is triggered by alpha > max_alpha, not >=
       boxm2_refine_block_multi_data_function(scene, blk, prefixes, static_cast<float>(0.99*occupied_prob));
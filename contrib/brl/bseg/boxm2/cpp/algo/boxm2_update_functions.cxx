@@ -1,6 +1,7 @@
 #include "boxm2_update_functions.h"
 #include <boxm2/cpp/algo/boxm2_cone_update_image_functor.h>
 #include "boxm2_cast_cone_ray_function.h"
+#include "boxm2_parallel_cast_ray_function.h"
 #include <boxm2/cpp/algo/boxm2_data_serial_iterator.h>
 #include <boxm2/cpp/algo/boxm2_update_image_functor.h>
 #include <boxm2/cpp/algo/boxm2_update_with_shadow_functor.h>
@@ -55,6 +56,7 @@ bool boxm2_update_cone_image(boxm2_scene_sptr & scene,
         for (id = vis_order.begin(); id != vis_order.end(); ++id)
         {
             std::cout<<"Block id "<<(*id)<<' ';
+            boxm2_block_pin pin(cache, scene, *id);
             boxm2_block     *  blk   = cache->get_block(scene,*id);
             boxm2_data_base *  alph = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_GAMMA>::prefix(),0,false);
             boxm2_data_base *  mog  = cache->get_data_base(scene,*id,data_type,0,false);
@@ -126,6 +128,7 @@ bool boxm2_update_cone_image(boxm2_scene_sptr & scene,
     std::vector<boxm2_block_id>::iterator id;
     for (id = vis_order.begin(); id != vis_order.end(); ++id)
     {
+        boxm2_block_pin pin(cache, scene, *id);
         boxm2_block     *  blk   = cache->get_block(scene,*id);
         boxm2_data_base *  alph  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_GAMMA>::prefix(),0,false);
         boxm2_data_base *  mog   = cache->get_data_base(scene,*id,data_type,0,false);
@@ -194,6 +197,7 @@ bool boxm2_update_image(boxm2_scene_sptr & scene,
         for (id = vis_order.begin(); id != vis_order.end(); ++id)
         {
             std::cout<<"Block id "<<(*id)<<' ';
+            boxm2_block_pin pin(cache, scene, *id);
             boxm2_block *     blk   = cache->get_block(scene,*id);
             boxm2_data_base *  alph = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
             boxm2_data_base *  mog  = cache->get_data_base(scene,*id,data_type,alph->buffer_length()/alphaTypeSize*appTypeSize,false);
@@ -213,7 +217,7 @@ bool boxm2_update_image(boxm2_scene_sptr & scene,
             {
                 boxm2_update_pass0_functor pass0;
                 pass0.init_data(datas,input_image);
-                success=success && cast_ray_per_block<boxm2_update_pass0_functor>
+                success=success && cast_ray_per_block_ordered<boxm2_update_pass0_functor>
                                        (pass0,
                                         scene_info_wrapper->info,
                                         blk,
@@ -228,14 +232,14 @@ bool boxm2_update_image(boxm2_scene_sptr & scene,
               {
                 boxm2_update_pass1_functor<BOXM2_GAUSS_GREY> pass1;
                 pass1.init_data(datas,&pre_img,&vis_img);
-                success=success&&cast_ray_per_block<boxm2_update_pass1_functor<BOXM2_GAUSS_GREY> >
+                success=success&&cast_ray_per_block_parallel<boxm2_update_pass1_functor<BOXM2_GAUSS_GREY> >
                   (pass1,scene_info_wrapper->info,blk,cam,input_image->ni(),input_image->nj());
               }
               else if (data_type.find(boxm2_data_traits<BOXM2_MOG3_GREY>::prefix()) != std::string::npos)
               {
                 boxm2_update_pass1_functor<BOXM2_MOG3_GREY> pass1;
                 pass1.init_data(datas,&pre_img,&vis_img);
-                success=success&&cast_ray_per_block<boxm2_update_pass1_functor<BOXM2_MOG3_GREY> >
+                success=success&&cast_ray_per_block_parallel<boxm2_update_pass1_functor<BOXM2_MOG3_GREY> >
                   (pass1,scene_info_wrapper->info,blk,cam,input_image->ni(),input_image->nj());
               }
             }
@@ -246,14 +250,14 @@ bool boxm2_update_image(boxm2_scene_sptr & scene,
               {
                 boxm2_update_pass2_functor<BOXM2_GAUSS_GREY> pass2;
                 pass2.init_data(datas,&pre_img,&vis_img, & proc_norm_img);
-                success=success&&cast_ray_per_block<boxm2_update_pass2_functor<BOXM2_GAUSS_GREY> >
+                success=success&&cast_ray_per_block_ordered<boxm2_update_pass2_functor<BOXM2_GAUSS_GREY> >
                   (pass2,scene_info_wrapper->info,blk,cam,input_image->ni(),input_image->nj());
               }
               else if (data_type.find(boxm2_data_traits<BOXM2_MOG3_GREY>::prefix()) != std::string::npos)
               {
                 boxm2_update_pass2_functor<BOXM2_MOG3_GREY> pass2;
                 pass2.init_data(datas,&pre_img,&vis_img, & proc_norm_img);
-                success=success&&cast_ray_per_block<boxm2_update_pass2_functor<BOXM2_MOG3_GREY> >
+                success=success&&cast_ray_per_block_ordered<boxm2_update_pass2_functor<BOXM2_MOG3_GREY> >
                   (pass2,scene_info_wrapper->info,blk,cam,input_image->ni(),input_image->nj());
               }
             }
@@ -273,6 +277,7 @@ bool boxm2_update_image(boxm2_scene_sptr & scene,
     std::vector<boxm2_block_id>::iterator id;
     for (id = vis_order.begin(); id != vis_order.end(); ++id)
     {
+        boxm2_block_pin pin(cache, scene, *id);
         boxm2_block     *  blk   = cache->get_block(scene,*id);
         boxm2_data_base *  alph  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
         boxm2_data_base *  mog   = cache->get_data_base(scene,*id,data_type,0,false);
@@ -360,6 +365,7 @@ bool boxm2_update_with_shadow(boxm2_scene_sptr & scene,
         for (id = vis_order.begin(); id != vis_order.end(); ++id)
         {
             std::cout<<"Block id "<<(*id)<<' ';
+            boxm2_block_pin pin(cache, scene, *id);
             boxm2_block *     blk   = cache->get_block(scene,*id);
             boxm2_data_base *  alph = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
             boxm2_data_base *  mog  = cache->get_data_base(scene,*id,data_type,alph->buffer_length()/alphaTypeSize*appTypeSize,false);
@@ -439,6 +445,7 @@ bool boxm2_update_with_shadow(boxm2_scene_sptr & scene,
     std::vector<boxm2_block_id>::iterator id;
     for (id = vis_order.begin(); id != vis_order.end(); ++id)
     {
+        boxm2_block_pin pin(cache, scene, *id);
         boxm2_block     *  blk   = cache->get_block(scene,*id);
         boxm2_data_base *  alph  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
         boxm2_data_base *  mog   = cache->get_data_base(scene,*id,data_type,0,false);
@@ -509,6 +516,7 @@ bool boxm2_update_using_quality(boxm2_scene_sptr & scene,
         for (id = vis_order.begin(); id != vis_order.end(); ++id)
         {
             std::cout<<"Block id "<<(*id)<<' ';
+            boxm2_block_pin pin(cache, scene, *id);
             boxm2_block *     blk   = cache->get_block(scene,*id);
             boxm2_data_base *  alph = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
             boxm2_data_base *  mog  = cache->get_data_base(scene,*id,data_type,alph->buffer_length()/alphaTypeSize*appTypeSize,false);
@@ -586,6 +594,7 @@ bool boxm2_update_using_quality(boxm2_scene_sptr & scene,
     std::vector<boxm2_block_id>::iterator id;
     for (id = vis_order.begin(); id != vis_order.end(); ++id)
     {
+        boxm2_block_pin pin(cache, scene, *id);
         boxm2_block     *  blk   = cache->get_block(scene,*id);
         boxm2_data_base *  alph  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
         boxm2_data_base *  mog   = cache->get_data_base(scene,*id,data_type,0,false);
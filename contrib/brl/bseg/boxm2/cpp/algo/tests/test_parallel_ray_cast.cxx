@@ -0,0 +1,219 @@
+//:
+// \file
+// \brief Tests that multithreaded rendering and updating give the same results as casting the rays one by one
+#include <iostream>
+#include <vector>
+#include <map>
+#include <cstring>
+#include <testlib/testlib_test.h>
+#include <vnl/vnl_random.h>
+#include <vnl/vnl_parallel_for.h>
+#include <vpgl/vpgl_perspective_camera.h>
+#include <vil/vil_image_view.h>
+#include <vul/vul_file.h>
+#include <boct/boct_bit_tree.h>
+#include <boxm2/boxm2_scene.h>
+#include <boxm2/boxm2_block.h>
+#include <boxm2/boxm2_data_base.h>
+#include <boxm2/boxm2_block_metadata.h>
+#include <boxm2/io/boxm2_lru_cache.h>
+#include <boxm2/cpp/algo/boxm2_render_functions.h>
+#include <boxm2/cpp/algo/boxm2_update_functions.h>
+#include <vcl_compiler.h>
+
+typedef boxm2_data_traits<BOXM2_MOG3_GREY> mog3_traits;
+
+//: A camera above the scene, looking down at it at an angle
+static vpgl_camera_double_sptr oblique_camera(unsigned ni, unsigned nj)
+{
+  vpgl_calibration_matrix<double> K(60.0, vgl_point_2d<double>(ni/2.0, nj/2.0));
+  vpgl_perspective_camera<double>* cam = new vpgl_perspective_camera<double>();
+  cam->set_calibration(K);
+  cam->set_camera_center(vgl_point_3d<double>(-0.5, 0.3, 2.5));
+  cam->look_at(vgl_homg_point_3d<double>(1.0, 0.5, 0.3));
+  return cam;
+}
+
+//: Refine the trees of \p blk at random, and fill its alpha and appearance data with random values
+static void randomize_block(boxm2_scene_sptr& scene, boxm2_block_id const& id, vnl_random& rand)
+{
+  boxm2_cache_sptr cache = boxm2_cache::instance();
+  boxm2_block* blk = cache->get_block(scene, id);
+  boxm2_array_3d<boxm2_block::uchar16> trees = blk->trees_copy();
+  int data_ptr = 0;
+  for (boxm2_block::uchar16* t = trees.begin(); t != trees.end(); ++t)
+  {
+    unsigned char bits[16] = {0};
+    bits[0] = rand.drand32() < 0.8 ? 1 : 0;
+    boct_bit_tree tree(bits, 4);
+    for (int i=1; i<73; ++i)
+      tree.set_bit_at(i, tree.bit_at(tree.parent_index(i)) && rand.drand32() < 0.4);
+    tree.set_data_ptr(data_ptr);
+    data_ptr += tree.num_cells();
+    std::memcpy(t->data_block(), tree.get_bits(), 16);
+  }
+  blk->set_trees(trees);
+  delete [] trees.data_block();
+
+  boxm2_data_base* alpha = cache->get_data_base(scene, id, boxm2_data_traits<BOXM2_ALPHA>::prefix(), 0, false);
+  float* a = reinterpret_cast<float*>(alpha->data_buffer());
+  for (std::size_t c = 0; c < alpha->buffer_length()/sizeof(float); ++c)
+    a[c] = float(rand.drand32(0.0, 4.0));
+  boxm2_data_base* mog = cache->get_data_base(scene, id, mog3_traits::prefix(), 0, false);
+  unsigned char* m = reinterpret_cast<unsigned char*>(mog->data_buffer());
+  for (std::size_t c = 0; c < mog->buffer_length(); c += 8) {
+    m[c] = (unsigned char)rand.lrand32(0, 255);   // mean
+    m[c+1] = (unsigned char)rand.lrand32(5, 60);  // sigma
+    m[c+2] = 255;                                // weight
+    for (int k = 3; k < 8; ++k)
+      m[c+k] = 0;
+  }
+}
+
+//: Copies of the data of type \p type of all blocks
+static std::map<boxm2_block_id, std::vector<char> > save_data(boxm2_scene_sptr& scene, std::string const& type)
+{
+  std::map<boxm2_block_id, std::vector<char> > saved;
+  std::vector<boxm2_block_id> ids = scene->get_block_ids();
+  for (unsigned b = 0; b < ids.size(); ++b) {
+    boxm2_data_base* data = boxm2_cache::instance()->get_data_base(scene, ids[b], type, 0, false);
+    saved[ids[b]].assign(data->data_buffer(), data->data_buffer() + data->buffer_length());
+  }
+  return saved;
+}
+
+static void restore_data(boxm2_scene_sptr& scene, std::string const& type, std::map<boxm2_block_id, std::vector<char> > const& saved)
+{
+  std::map<boxm2_block_id, std::vector<char> >::const_iterator s;
+  for (s = saved.begin(); s != saved.end(); ++s) {
+    boxm2_data_base* data = boxm2_cache::instance()->get_data_base(scene, s->first, type, 0, false);
+    std::memcpy(data->data_buffer(), &s->second[0], s->second.size());
+  }
+}
+
+static bool same_image(vil_image_view<float> const& a, vil_image_view<float> const& b)
+{
+  for (unsigned j = 0; j < a.nj(); ++j)
+    for (unsigned i = 0; i < a.ni(); ++i)
+      if (std::memcmp(&a(i,j), &b(i,j), sizeof(float)) != 0)
+        return false;
+  return true;
+}
+
+//: Render the scene block by block, in visibility order
+static void render(boxm2_scene_sptr& scene, vpgl_camera_double_sptr& cam, bool serial,
+                   vil_image_view<float>& expected, vil_image_view<float>& vis,
+                   unsigned roi_ni, unsigned roi_nj, unsigned roi_ni0, unsigned roi_nj0)
+{
+  expected.fill(0.0f);
+  vis.fill(1.0f);
+  boxm2_cache_sptr cache = boxm2_cache::instance();
+  std::vector<boxm2_block_id> vis_order = scene->get_vis_blocks(cam);
+  for (unsigned b = 0; b < vis_order.size(); ++b) {
+    boxm2_block_pin pin(cache, scene, vis_order[b]);
+    boxm2_block* blk = cache->get_block(scene, vis_order[b]);
+    std::vector<boxm2_data_base*> datas;
+    datas.push_back(cache->get_data_base(scene, vis_order[b], boxm2_data_traits<BOXM2_ALPHA>::prefix()));
+    datas.push_back(cache->get_data_base(scene, vis_order[b], mog3_traits::prefix()));
+    boxm2_scene_info* info = scene->get_blk_metadata(vis_order[b]);
+    if (serial) {
+      boxm2_render_exp_image_functor<BOXM2_MOG3_GREY> render_functor;
+      render_functor.init_data(datas, &expected, &vis);
+      cast_ray_per_block<boxm2_render_exp_image_functor<BOXM2_MOG3_GREY> >
+        (render_functor, info, blk, cam, roi_ni, roi_nj, roi_ni0, roi_nj0);
+    }
+    else
+      boxm2_render_expected_image(info, blk, datas, cam, &expected, &vis, roi_ni, roi_nj, roi_ni0, roi_nj0);
+    delete info;
+  }
+}
+
+void test_parallel_ray_cast()
+{
+  std::string dir = vul_file::get_cwd() + "/boxm2_parallel_ray_cast_test/";
+  vul_file::make_directory(dir);
+  vul_file::delete_file_glob(dir + "*.bin");
+
+  // two blocks of 4x4x4 trees, side by side
+  boxm2_scene_sptr scene = new boxm2_scene();
+  scene->set_local_origin(vgl_point_3d<double>(0,0,0));
+  scene->set_data_path(dir);
+  std::map<boxm2_block_id, boxm2_block_metadata> blocks;
+  for (int b = 0; b < 2; ++b) {
+    boxm2_block_id id(b,0,0);
+    blocks[id] = boxm2_block_metadata(id, vgl_point_3d<double>(b,0,0), vgl_vector_3d<double>(0.25,0.25,0.25),
+                                      vgl_vector_3d<unsigned>(4,4,4), 1, 4, 100, 0.001);
+  }
+  scene->set_blocks(blocks);
+  std::vector<std::string> appearances;
+  appearances.push_back(mog3_traits::prefix());
+  appearances.push_back(boxm2_data_traits<BOXM2_NUM_OBS>::prefix());
+  scene->set_appearances(appearances);
+
+  boxm2_lru_cache::create(scene);
+  vnl_random rand(123456);
+  std::vector<boxm2_block_id> ids = scene->get_block_ids();
+  for (unsigned b = 0; b < ids.size(); ++b)
+    randomize_block(scene, ids[b], rand);
+
+  const unsigned ni = 50, nj = 37;  // not a multiple of the tile size
+  vpgl_camera_double_sptr cam = oblique_camera(ni, nj);
+  TEST("both blocks visible", scene->get_vis_blocks(cam).size(), 2);
+  const unsigned saved_threads = vnl_parallel::max_threads();
+
+  // rendering
+  vil_image_view<float> exp_serial(ni,nj), vis_serial(ni,nj), exp_par(ni,nj), vis_par(ni,nj);
+  render(scene, cam, true, exp_serial, vis_serial, ni, nj, 0, 0);
+  vnl_parallel::set_max_threads(4);
+  render(scene, cam, false, exp_par, vis_par, ni, nj, 0, 0);
+  unsigned seen = 0;
+  for (unsigned j = 0; j < nj; ++j)
+    for (unsigned i = 0; i < ni; ++i)
+      if (vis_serial(i,j) < 0.5f) ++seen;
+  std::cout << seen << " of " << ni*nj << " pixels see the scene\n";
+  TEST("the rays hit the scene", seen > ni*nj/4, true);
+  TEST("parallel render gives the same expected image", same_image(exp_serial, exp_par), true);
+  TEST("parallel render gives the same visibility image", same_image(vis_serial, vis_par), true);
+
+  render(scene, cam, true, exp_serial, vis_serial, 41, 30, 3, 5);
+  render(scene, cam, false, exp_par, vis_par, 41, 30, 3, 5);
+  TEST("same results for a region of interest", same_image(exp_serial, exp_par) && same_image(vis_serial, vis_par) &&
+                                                exp_par(2,10) == 0.0f && exp_par(10,4) == 0.0f && exp_par(41,10) == 0.0f, true);
+
+  // updating
+  vil_image_view<float> img(ni,nj);
+  for (unsigned j = 0; j < nj; ++j)
+    for (unsigned i = 0; i < ni; ++i)
+      img(i,j) = float(rand.drand32());
+  std::string alpha_type = boxm2_data_traits<BOXM2_ALPHA>::prefix();
+  std::string nobs_type = boxm2_data_traits<BOXM2_NUM_OBS>::prefix();
+  int app_size = (int)boxm2_data_info::datasize(mog3_traits::prefix());
+  std::map<boxm2_block_id, std::vector<char> > alpha0 = save_data(scene, alpha_type);
+  std::map<boxm2_block_id, std::vector<char> > mog0 = save_data(scene, mog3_traits::prefix());
+  std::map<boxm2_block_id, std::vector<char> > nobs0 = save_data(scene, nobs_type);
+
+  vnl_parallel::set_max_threads(1);
+  TEST("serial update", boxm2_update_image(scene, mog3_traits::prefix(), app_size, nobs_type, cam, &img, ni, nj), true);
+  std::map<boxm2_block_id, std::vector<char> > alpha_serial = save_data(scene, alpha_type);
+  std::map<boxm2_block_id, std::vector<char> > mog_serial = save_data(scene, mog3_traits::prefix());
+  std::map<boxm2_block_id, std::vector<char> > nobs_serial = save_data(scene, nobs_type);
+
+  restore_data(scene, alpha_type, alpha0);
+  restore_data(scene, mog3_traits::prefix(), mog0);
+  restore_data(scene, nobs_type, nobs0);
+  vul_file::delete_file_glob(dir + "*.bin");  // the aux data written by the first update
+  vnl_parallel::set_max_threads(4);
+  TEST("parallel update", boxm2_update_image(scene, mog3_traits::prefix(), app_size, nobs_type, cam, &img, ni, nj), true);
+  std::cout << '\n';
+  TEST("the update changes alpha", save_data(scene, alpha_type) != alpha0, true);
+  TEST("parallel update gives the same alpha", save_data(scene, alpha_type) == alpha_serial, true);
+  TEST("parallel update gives the same appearance", save_data(scene, mog3_traits::prefix()) == mog_serial, true);
+  TEST("parallel update gives the same observation counts", save_data(scene, nobs_type) == nobs_serial, true);
+
+  vnl_parallel::set_max_threads(saved_threads);
+  boxm2_cache::instance()->clear_cache();
+  vul_file::delete_file_glob(dir + "*.bin");
+}
+
+
+TESTMAIN(test_parallel_ray_cast);
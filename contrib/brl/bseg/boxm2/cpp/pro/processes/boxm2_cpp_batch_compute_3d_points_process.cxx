@@ -90,6 +90,7 @@ bool boxm2_cpp_batch_compute_3d_points_process(bprb_func_process& pro)
       continue;
 
     //: alpha is only retrieved to get buf len, there is a problem in get_data_base_new: TODO: fix this, there should be no need to retrieve alpha
+    boxm2_block_pin pin(cache, scene, *id);
     boxm2_data_base *  alph = cache->get_data_base(scene, *id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
     std::size_t buf_len = alph->buffer_length();
     std::cout << "\nin blk: " << *id << " data buf len: " << buf_len/alphaTypeSize << "\n";
@@ -132,6 +132,7 @@ bool boxm2_cpp_batch_compute_normal_albedo_process(bprb_func_process& pro)
   std::vector<boxm2_block_id>::iterator id;
   id = blk_ids.begin();
   for (id = blk_ids.begin(); id != blk_ids.end(); id++) {
+    boxm2_block_pin pin(cache, scene, *id);
     boxm2_block *     blk     = cache->get_block(scene,*id);
     boxm2_data_base *  alpha  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0, false);
     unsigned int n_cells = alpha->buffer_length() / boxm2_data_info::datasize(boxm2_data_traits<BOXM2_ALPHA>::prefix());
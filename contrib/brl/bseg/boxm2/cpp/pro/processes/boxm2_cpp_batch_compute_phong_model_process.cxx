@@ -74,6 +74,7 @@ bool boxm2_cpp_batch_compute_phong_model_process(bprb_func_process& pro)
   std::vector<boxm2_block_id>::iterator id;
   id = blk_ids.begin();
   for (id = blk_ids.begin(); id != blk_ids.end(); id++) {
+    boxm2_block_pin pin(cache, scene, *id);
     boxm2_block *     blk     = cache->get_block(scene,*id);
     boxm2_data_base *  alpha  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,true);
     boxm2_data_base *  phongs_model_data  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_FLOAT8>::prefix("phongs_model"),alpha->buffer_length()* 8 ,false);
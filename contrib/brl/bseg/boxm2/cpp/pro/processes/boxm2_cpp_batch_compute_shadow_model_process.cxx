@@ -88,6 +88,7 @@ bool boxm2_cpp_batch_compute_shadow_model_process(bprb_func_process& pro)
   float weighted_intensities=0.0;
   float ambient_light=0.0;
   for (id = blk_ids.begin(); id != blk_ids.end(); id++) {
+    boxm2_block_pin pin(cache, scene, *id);
     boxm2_block     *  blk   = cache->get_block(scene,*id);
     // pass num_bytes = 0 to make sure disc is read if not already in memory
     boxm2_data_base *  sunvis  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_AUX0>::prefix("sunvis"),0,true);
@@ -67,6 +67,7 @@ bool boxm2_cpp_batch_update_nonsurface_model_process(bprb_func_process& pro)
   std::vector<boxm2_block_id> blk_ids = scene->get_block_ids();
   std::vector<boxm2_block_id>::iterator id;
   for (id = blk_ids.begin(); id != blk_ids.end(); id++) {
+    boxm2_block_pin pin(cache, scene, *id);
     boxm2_data_base *  alpha  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,true);
 
     // pass num_bytes = 0 to make sure disc is read if not already in memory
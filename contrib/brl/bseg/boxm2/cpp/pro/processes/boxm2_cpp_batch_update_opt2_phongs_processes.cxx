@@ -101,6 +101,7 @@ bool boxm2_cpp_pre_infinity_opt2_phongs_process(bprb_func_process& pro)
     for (id = vis_order.begin(); id != vis_order.end(); ++id)
     {
         std::cout<<"Block id "<<(*id)<<' ';
+        boxm2_block_pin pin(cache, scene, *id);
         boxm2_block *     blk   = cache->get_block(scene,*id);
         boxm2_data_base *  alph  = cache->get_data_base(scene, *id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,true);
         boxm2_data_base *  float8_phongs   = cache->get_data_base(scene, *id,boxm2_data_traits<BOXM2_FLOAT8>::prefix(),0,true);
@@ -157,6 +158,7 @@ bool boxm2_cpp_pre_infinity_opt2_phongs_process(bprb_func_process& pro)
     for (id = vis_order.begin(); id != vis_order.end(); ++id)
     {
         std::cout<<"Block id "<<(*id)<<' ';
+        boxm2_block_pin pin(cache, scene, *id);
         boxm2_block *     blk   = cache->get_block(scene,*id);
         boxm2_data_base *  alph  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,true);
         boxm2_data_base *  phongs_model_base   = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_FLOAT8>::prefix(),0,false);
@@ -263,6 +265,7 @@ bool boxm2_cpp_batch_update_opt2_phongs_process(bprb_func_process& pro)
     id = blk_ids.begin();
     for (id = blk_ids.begin(); id != blk_ids.end(); ++id) {
         // pass num_bytes = 0 to make sure disc is read if not already in memory
+        boxm2_block_pin pin(cache, scene, *id);
         boxm2_data_base *  alph  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
         boxm2_data_base *  phongs  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_FLOAT8>::prefix(),0,false);
         std::cout << "buffer length of alpha: " << alph->buffer_length() << '\n'
@@ -335,6 +338,7 @@ bool boxm2_cpp_batch_update_nonray_process(bprb_func_process& pro)
     id = blk_ids.begin();
     for (id = blk_ids.begin(); id != blk_ids.end(); ++id) {
         // pass num_bytes = 0 to make sure disc is read if not already in memory
+        boxm2_block_pin pin(cache, scene, *id);
         boxm2_data_base *  alph  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
         boxm2_data_base *  phongs  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_FLOAT8>::prefix("phongs_model"),0,false);
         boxm2_data_base *  air  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_AUX0>::prefix("entropy_histo_air"),0,false);
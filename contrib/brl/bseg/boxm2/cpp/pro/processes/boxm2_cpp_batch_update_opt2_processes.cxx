@@ -135,6 +135,7 @@ bool boxm2_cpp_create_aux_data_opt2_process(bprb_func_process& pro)
     for (id = vis_order.begin(); id != vis_order.end(); ++id)
     {
       std::cout<<"Block id "<<(*id)<<' ';
+      boxm2_block_pin pin(cache, scene, *id);
       boxm2_block *     blk   = cache->get_block(scene,*id);
       boxm2_data_base *  alph  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
       boxm2_data_base *  mog   = cache->get_data_base(scene,*id,data_type,0,false);
@@ -209,6 +210,7 @@ bool boxm2_cpp_create_aux_data_opt2_process(bprb_func_process& pro)
     for (id = vis_order.begin(); id != vis_order.end(); ++id)
     {
       std::cout<<"Block id "<<(*id)<<' ';
+      boxm2_block_pin pin(cache, scene, *id);
       boxm2_block *     blk   = cache->get_block(scene,*id);
       boxm2_data_base *  alph  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
       boxm2_data_base *  mog   = cache->get_data_base(scene,*id,data_type,0,false);
@@ -332,6 +334,7 @@ bool boxm2_cpp_batch_update_opt2_process(bprb_func_process& pro)
   std::vector<boxm2_block_id>::iterator id;
   id = blk_ids.begin();
   for (id = blk_ids.begin(); id != blk_ids.end(); ++id) {
+    boxm2_block_pin pin(cache, scene, *id);
     boxm2_data_base *  alph  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
     boxm2_data_base *  mog  = cache->get_data_base(scene,*id,data_type,0,false);
 
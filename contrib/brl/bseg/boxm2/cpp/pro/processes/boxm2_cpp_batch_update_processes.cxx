@@ -84,6 +84,7 @@ bool boxm2_cpp_create_norm_intensities_process(bprb_func_process& pro)
     for (id = vis_order.begin(); id != vis_order.end(); ++id)
     {
       std::cout<<"Block id "<<(*id)<<' ';
+      boxm2_block_pin pin(cache, scene, *id);
       boxm2_block *     blk   = cache->get_block(scene,*id);
       boxm2_block_metadata mdata = scene->get_block_metadata(*id);
       // first remove from memory just in case to ensure proper initialization
@@ -210,6 +211,7 @@ bool boxm2_cpp_create_aux_data_process(bprb_func_process& pro)
     for (id = vis_order.begin(); id != vis_order.end(); ++id)
     {
       std::cout<<"Block id "<<(*id)<<' ';
+      boxm2_block_pin pin(cache, scene, *id);
       boxm2_block *     blk   = cache->get_block(scene,*id);
       boxm2_data_base *  alph  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
       boxm2_data_base *  mog   = cache->get_data_base(scene,*id,data_type,0,false);
@@ -260,6 +262,7 @@ bool boxm2_cpp_create_aux_data_process(bprb_func_process& pro)
     for (id = vis_order.begin(); id != vis_order.end(); ++id)
     {
       std::cout<<"Block id "<<(*id)<<' ';
+      boxm2_block_pin pin(cache, scene, *id);
       boxm2_block *     blk   = cache->get_block(scene,*id);
       boxm2_data_base *  alph  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
       boxm2_data_base *  mog   = cache->get_data_base(scene,*id,data_type,0,false);
@@ -387,6 +390,7 @@ bool boxm2_cpp_batch_update_process(bprb_func_process& pro)
   id = blk_ids.begin();
   for (id = blk_ids.begin(); id != blk_ids.end(); ++id) {
     // reads disc if not already in memory
+    boxm2_block_pin pin(cache, scene, *id);
     boxm2_data_base *  alph  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
     boxm2_data_base *  mog  = cache->get_data_base(scene,*id,data_type,0,false);
 
@@ -491,6 +495,7 @@ bool boxm2_cpp_batch_update_app_process(bprb_func_process& pro)
     std::cout<<" block "<<bid<<std::endl;
 
     // reads from disc if not already in memory
+    boxm2_block_pin pin(cache, scene, *id);
     boxm2_data_base *  alph  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
     int numData = alph->buffer_length() / alphaTypeSize;
     boxm2_data_base *  mog   = cache->get_data_base(scene,*id,data_type,numData*appTypeSize,false);
@@ -592,6 +597,7 @@ bool boxm2_cpp_batch_update_alpha_process(bprb_func_process& pro)
   id = blk_ids.begin();
   for (id = blk_ids.begin(); id != blk_ids.end(); ++id) {
     // reads from disc if not already in memory
+    boxm2_block_pin pin(cache, scene, *id);
     boxm2_data_base *  alph  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
     boxm2_data_base *  mog  = cache->get_data_base(scene,*id,data_type,0,false);
 
@@ -127,6 +127,7 @@ bool boxm2_cpp_cast_3d_point_hypothesis_process(bprb_func_process& pro)
   for (id = vis_order.begin(); id != vis_order.end(); ++id)
   {
     std::cout<<"Block id "<<(*id)<<' ';
+    boxm2_block_pin pin(cache, scene, *id);
     boxm2_block *   blk   = cache->get_block(scene,*id);
 
     boxm2_data_base *  alph = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
@@ -257,6 +258,7 @@ bool boxm2_cpp_cast_3d_point_hypothesis_process2(bprb_func_process& pro)
   for (id = vis_order.begin(); id != vis_order.end(); ++id)
   {
     std::cout<<"Block id "<<(*id)<<' ';
+    boxm2_block_pin pin(cache, scene, *id);
     boxm2_block *   blk   = cache->get_block(scene,*id);
 
     boxm2_data_base *  alph = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
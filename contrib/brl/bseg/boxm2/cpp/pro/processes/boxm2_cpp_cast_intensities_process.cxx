@@ -85,6 +85,7 @@ bool boxm2_cpp_cast_intensities_process(bprb_func_process& pro)
     for (id = vis_order.begin(); id != vis_order.end(); ++id)
     {
       std::cout<<"Block id "<<(*id)<<' ';
+      boxm2_block_pin pin(cache, scene, *id);
       boxm2_block *   blk   = cache->get_block(scene,*id);
 
       //: first make sure that the database is removed from memory if it already exists
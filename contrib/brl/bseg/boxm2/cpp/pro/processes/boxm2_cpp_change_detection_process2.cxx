@@ -112,6 +112,7 @@ bool boxm2_cpp_change_detection_process2(bprb_func_process& pro)
           std::vector<boxm2_block_id>::iterator id;
           for (id = vis_order.begin(); id != vis_order.end(); ++id)
           {
+              boxm2_block_pin pin(cache, scene, *id);
               boxm2_block *     blk  = cache->get_block(scene,*id);
               boxm2_data_base *  alph = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix());
               boxm2_data_base *  mog  = cache->get_data_base(scene,*id,data_type);
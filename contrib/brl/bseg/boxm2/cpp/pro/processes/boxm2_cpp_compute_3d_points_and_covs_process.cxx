@@ -72,6 +72,7 @@ bool boxm2_cpp_compute_3d_points_and_covs_process(bprb_func_process& pro)
     // we're assuming that we have enough RAM to store the whole output blocks
 
     //: alpha is only retrieved to get buf len, there is a problem in get_data_base_new: TODO: fix this, there should be no need to retrieve alpha
+    boxm2_block_pin pin(cache, scene, *id);
     boxm2_data_base *  alph = cache->get_data_base(scene, *id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
     std::size_t buf_len = alph->buffer_length();
     std::cout << "\nin blk: " << *id << " data buf len: " << buf_len/alphaTypeSize << "\n";
@@ -143,6 +144,7 @@ bool boxm2_cpp_compute_3d_points_and_covs_normalize_process(bprb_func_process& p
     // we're assuming that we have enough RAM to store the whole output blocks
 
     //: alpha is only retrieved to get buf len, there is a problem in get_data_base_new: TODO: fix this, there should be no need to retrieve alpha
+    boxm2_block_pin pin(cache, scene, *id);
     boxm2_data_base *  alph = cache->get_data_base(scene, *id,boxm2_data_traits<BOXM2_ALPHA>::prefix(),0,false);
     std::size_t buf_len = alph->buffer_length();
     std::cout << "\nin blk: " << *id << " data buf len: " << buf_len/alphaTypeSize << "\n";
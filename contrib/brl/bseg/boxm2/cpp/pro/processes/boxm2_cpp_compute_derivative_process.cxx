@@ -116,6 +116,7 @@ bool boxm2_cpp_compute_derivative_process(bprb_func_process& pro)
     boxm2_block_id id = blk_iter->first;
     std::cout<<"Filtering Block: "<<id<<std::endl;
 
+    boxm2_block_pin pin(cache, scene, id);
     boxm2_block *     blk     = cache->get_block(scene,id);
     boxm2_data_base * alph    = cache->get_data_base(scene,id,boxm2_data_traits<BOXM2_ALPHA>::prefix());
 
@@ -112,6 +112,7 @@ bool  boxm2_cpp_get_index_from_3d_point_process(bprb_func_process& pro)
   int index_x=(int)std::floor(local.x());
   int index_y=(int)std::floor(local.y());
   int index_z=(int)std::floor(local.z());
+  boxm2_block_pin pin(cache, scene, id);
   boxm2_block * blk=cache->get_block(scene, id);
   boxm2_block_metadata mdata = scene->get_block_metadata_const(id);
   vnl_vector_fixed<unsigned char,16> treebits=blk->trees()(index_x,index_y,index_z);
@@ -146,6 +147,7 @@ bool  boxm2_cpp_get_3d_point_from_index_process(bprb_func_process& pro)
 
   vgl_point_3d<double> local;
   boxm2_block_id id(bi, bj, bk);
+  boxm2_block_pin pin(cache, scene, id);
   boxm2_block * blk = cache->get_block(scene,id);
   boxm2_block_metadata mdata = scene->get_block_metadata_const(id);
   vgl_box_3d<double> bbox = mdata.bbox();
@@ -123,6 +123,7 @@ bool boxm2_cpp_image_density_process(bprb_func_process& pro)
     for (id = vis_order.begin(); id != vis_order.end(); ++id)
     {
       std::cout<<"Block Id "<<(*id)<<std::endl;
+      boxm2_block_pin pin(cache, scene, *id);
       boxm2_block *     blk  =  cache->get_block(scene,*id);
       boxm2_data_base *  alph = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix());
       boxm2_data_base *  mog  = cache->get_data_base(scene,*id,data_type);
@@ -268,6 +269,7 @@ bool boxm2_cpp_image_density_masked_process(bprb_func_process& pro)
     for (id = vis_order.begin(); id != vis_order.end(); ++id)
     {
       std::cout<<"Block Id "<<(*id)<<std::endl;
+      boxm2_block_pin pin(cache, scene, *id);
       boxm2_block *     blk  =  cache->get_block(scene,*id);
       boxm2_data_base *  alph = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix());
       boxm2_data_base *  mog  = cache->get_data_base(scene,*id,data_type);
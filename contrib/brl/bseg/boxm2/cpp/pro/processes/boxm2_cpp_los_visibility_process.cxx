@@ -94,6 +94,7 @@ bool boxm2_cpp_los_visibility_process(bprb_func_process& pro)
     for (id = vis_order.begin(); id != vis_order.end(); ++id)
     {
         std::cout<<(*id)<<std::endl;
+        boxm2_block_pin pin(cache, scene, *id);
         boxm2_block *      blk  =  cache->get_block(scene,*id);
         boxm2_data_base *  alph = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix());
         std::vector<boxm2_data_base*> datas;
@@ -70,6 +70,7 @@ bool boxm2_cpp_mean_intensities_batch_process(bprb_func_process& pro)
   id = blk_ids.begin();
   for (id = blk_ids.begin(); id != blk_ids.end(); ++id) {
     // we're assuming that we have enough RAM to store the whole output block for alpha
+    boxm2_block_pin pin(cache, scene, *id);
     boxm2_data_base *  output_alph  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_AUX0>::prefix(),0,false);
     boxm2_mean_intensities_batch_functor data_functor;
     data_functor.init_data(output_alph, str_cache);
@@ -125,6 +126,7 @@ bool boxm2_cpp_mean_intensities_print_process(bprb_func_process& pro)
   for (std::vector<boxm2_block_id>::iterator id = blk_ids.begin(); id != blk_ids.end(); ++id)
   {
     // we're assuming that we have enough RAM to store the whole output block for alpha
+    boxm2_block_pin pin(cache, scene, *id);
     boxm2_data_base * output_alph  = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_AUX0>::prefix());
     boxm2_mean_intensities_print_functor data_functor;
     data_functor.init_data(output_alph,str_cache);
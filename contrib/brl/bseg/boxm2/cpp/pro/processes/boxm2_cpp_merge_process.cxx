@@ -87,6 +87,7 @@ bool boxm2_cpp_merge_process(bprb_func_process& pro)
   {
     boxm2_block_id id = blk_iter->first;
     std::cout<<"Merging Block: "<<id<<std::endl;
+    boxm2_block_pin pin(cache, scene, id);
     boxm2_block *     blk     = cache->get_block(scene, id);
     boxm2_data_base * alph    = cache->get_data_base(scene,id,boxm2_data_traits<BOXM2_ALPHA>::prefix(), 0, false);
     boxm2_data_base * mog     = cache->get_data_base(scene,id,data_type, 0, false);
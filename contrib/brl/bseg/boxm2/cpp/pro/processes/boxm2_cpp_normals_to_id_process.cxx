@@ -74,6 +74,7 @@ bool boxm2_cpp_normals_to_id_process(bprb_func_process& pro)
         std::size_t labelshortSize = boxm2_data_info::datasize(boxm2_data_traits<BOXM2_LABEL_SHORT>::prefix());
 
 
+        boxm2_block_pin pin(cache, scene, *id);
         boxm2_data_base * alpha =        cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix());
         int data_buff_length    = (int) (alpha->buffer_length()/alphaTypeSize);
 
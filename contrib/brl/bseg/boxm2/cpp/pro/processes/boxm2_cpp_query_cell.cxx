@@ -107,6 +107,7 @@ bool  boxm2_cpp_query_cell_process(bprb_func_process& pro)
   // int bit_index=tree.traverse(local);
   // int index=tree.get_data_index(bit_index,false);
   
+  boxm2_block_pin pin(cache, scene, id);
   boxm2_data_base* data_base = cache->get_data_base(scene, id,ident);
   
   std::vector<float> return_data;
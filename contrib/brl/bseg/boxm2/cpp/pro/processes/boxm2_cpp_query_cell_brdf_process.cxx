@@ -81,6 +81,7 @@ bool  boxm2_cpp_query_cell_brdf_process(bprb_func_process& pro)
   int index_x=(int)std::floor(local.x());
   int index_y=(int)std::floor(local.y());
   int index_z=(int)std::floor(local.z());
+  boxm2_block_pin pin(cache, scene, id);
   boxm2_block * blk=cache->get_block(scene, id);
   boxm2_block_metadata mdata = scene->get_block_metadata_const(id);
   vnl_vector_fixed<unsigned char,16> treebits=blk->trees()(index_x,index_y,index_z);
@@ -108,6 +108,7 @@ bool boxm2_cpp_ray_probe_process(bprb_func_process& pro)
     int nelems = 0; // initialise here, in case the "for" loop is empty
     for (id = vis_order.begin(); id != vis_order.end(); ++id)
     {
+        boxm2_block_pin pin(cache, scene, *id);
         boxm2_block *     blk  =  cache->get_block(scene,*id);
         boxm2_data_base *  alph = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_ALPHA>::prefix());
 
@@ -96,6 +96,7 @@ bool boxm2_cpp_refine_process2(bprb_func_process& pro)
     boxm2_block_id id = blk_iter->first;
     std::cout<<"Refining Block: "<<id<<std::endl;
 
+    boxm2_block_pin pin(cache, scene, id);
     boxm2_block *     blk     = cache->get_block(scene,id);
     boxm2_data_base * alph    = cache->get_data_base(scene,id,boxm2_data_traits<BOXM2_ALPHA>::prefix());
     boxm2_data_base * mog     = cache->get_data_base(scene,id,data_type);
@@ -93,6 +93,7 @@ bool boxm2_cpp_render_cone_expected_image_process(bprb_func_process& pro)
   for (id = vis_order.begin(); id != vis_order.end(); ++id)
   {
     std::cout<<"Cone Rendering Block Id "<<(*id)<<std::endl;
+    boxm2_block_pin pin(cache, scene, *id);
     boxm2_block *      blk  = cache->get_block(scene,*id);
     boxm2_data_base *  alph = cache->get_data_base(scene,*id,boxm2_data_traits<BOXM2_GAMMA>::prefix());
     boxm2_data_base *  mog  = cache->get_data_base(scene,*id,data_type);
@@ -104,6 +104,7 @@ bool  boxm2_cpp_render_z_images_process(bprb_func_process& pro)
         int index_y=(int)std::floor(local.y());
         int index_z=(int)std::floor(local.z());
 
+        boxm2_block_pin pin(cache, scene, id);
         boxm2_block * blk=cache->get_block(scene,id);
         boxm2_block_metadata mdata = scene->get_block_metadata_const(id);
 
@@ -65,6 +65,14 @@ class boxm2_cache: public vbl_ref_count
   // -- generic method: does not do anything; see specialisations
   virtual void disable_write() {}
 
+  //: keep the block and data of block \a id in memory until unpin_block()
+  // -- generic method: does not do anything; see specialisations
+  virtual void pin_block(boxm2_scene_sptr & /*scene*/, boxm2_block_id /*id*/) {}
+
+  //: undo one pin_block()
+  // -- generic method: does not do anything; see specialisations
+  virtual void unpin_block(boxm2_scene_sptr & /*scene*/, boxm2_block_id /*id*/) {}
+
   virtual bool add_scene(boxm2_scene_sptr & scene) = 0;
 
   virtual bool remove_scene(boxm2_scene_sptr & scene) = 0;
@@ -104,6 +112,28 @@ boxm2_data<T>* boxm2_cache::get_data(boxm2_scene_sptr & scene , boxm2_block_id i
   return static_cast<boxm2_data<T>* >(base);
 }
 
+//: Keeps block \a id of \a scene and its data in memory while in scope
+//  Hold one around each block being processed, from before asking the
+//  cache for the block and its data until done with them, so that a cache
+//  with a memory budget does not evict them meanwhile.
+class boxm2_block_pin
+{
+ public:
+  boxm2_block_pin(boxm2_cache_sptr const& cache, boxm2_scene_sptr const& scene, boxm2_block_id const& id)
+  : cache_(cache), scene_(scene), id_(id) { cache_->pin_block(scene_, id_); }
+
+  ~boxm2_block_pin() { cache_->unpin_block(scene_, id_); }
+
+ private:
+  //: not copyable
+  boxm2_block_pin(boxm2_block_pin const&);
+  boxm2_block_pin& operator=(boxm2_block_pin const&);
+
+  boxm2_cache_sptr cache_;
+  boxm2_scene_sptr scene_;
+  boxm2_block_id id_;
+};
+
 //: Binary write boxm2_cache  to stream
 void vsl_b_write(vsl_b_ostream& os, boxm2_cache const& scene);
 //: Binary write boxm2_cache  to stream
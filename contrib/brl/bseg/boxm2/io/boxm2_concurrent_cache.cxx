@@ -0,0 +1,825 @@
+#include <sstream>
+#include <iostream>
+#include <deque>
+#include <list>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include "boxm2_concurrent_cache.h"
+//:
+// \file
+#include <boxm2/boxm2_block_metadata.h>
+#include <vcl_compiler.h>
+#include <boxm2/boxm2_data_traits.h>
+#include <vul/vul_tracing.h>
+#if VXL_FULLCXX11SUPPORT
+# include <condition_variable>
+# include <mutex>
+# include <thread>
+#endif
+
+//: The cached blocks and data, and the state shared with the writer thread
+//  A block is kept under an empty type name.  An entry that is loading or
+//  being written is not deleted or changed, other than by whoever set the
+//  flag; others wait for the flag to be cleared.  An entry taken out of the
+//  cache while requests are using it is deleted by the last of them.
+struct boxm2_concurrent_cache::state
+{
+  struct key
+  {
+    boxm2_scene* scene;
+    std::string type;
+    boxm2_block_id id;
+
+    bool operator<(key const& k) const
+    {
+      if (scene != k.scene) return scene < k.scene;
+      if (type != k.type) return type < k.type;
+      return id < k.id;
+    }
+  };
+
+  struct entry
+  {
+    key k;
+    std::string data_path;
+    boxm2_block* block;
+    boxm2_data_base* data;
+    std::size_t bytes;
+    //: Being loaded from disk, without the lock
+    bool loading;
+    //: Waiting in the write queue
+    bool queued;
+    //: Being written to disk, without the lock
+    bool writing;
+    //: Evicted; deleted once written, unless asked for again first
+    bool evicted;
+    //: Number of requests in progress that use the entry
+    unsigned users;
+    //: Taken out of the cache; deleted once it has no users
+    bool removed;
+    //: Position in the lru list, unless evicted or loading
+    std::list<entry*>::iterator lru_pos;
+    bool in_lru;
+  };
+
+  std::map<key, entry*> entries;
+  //: Entries in memory, most recently used first
+  std::list<entry*> lru;
+  std::deque<entry*> write_queue;
+  std::map<std::pair<boxm2_scene*, boxm2_block_id>, unsigned> pins;
+  std::vector<boxm2_scene_sptr> scenes;
+
+  std::size_t max_bytes;
+  //: Bytes of entries in the lru list, or loading
+  std::size_t resident_bytes;
+  //: Bytes of evicted entries waiting to be written
+  std::size_t pending_bytes;
+  unsigned num_writing;
+
+  unsigned long hits;
+  unsigned long misses;
+  unsigned long evictions;
+  unsigned long write_backs;
+
+  //: True when the writer thread should finish
+  bool stop;
+
+#if VXL_FULLCXX11SUPPORT
+  std::mutex mutex;
+  //: Notified when an entry has finished loading or being written
+  std::condition_variable changed;
+  //: Notified when there is something to write, or the writer should stop
+  std::condition_variable work;
+  std::thread writer;
+#endif
+
+  void notify_changed()
+  {
+#if VXL_FULLCXX11SUPPORT
+    changed.notify_all();
+#endif
+  }
+
+  void notify_work()
+  {
+#if VXL_FULLCXX11SUPPORT
+    work.notify_one();
+#endif
+  }
+};
+
+typedef boxm2_concurrent_cache::state boxm2_cc_state;
+typedef boxm2_concurrent_cache::state::entry boxm2_cc_entry;
+
+//: Holds the lock of the cache (does nothing without C++11 threads)
+class boxm2_concurrent_cache_lock
+{
+ public:
+  explicit boxm2_concurrent_cache_lock(boxm2_cc_state& s)
+#if VXL_FULLCXX11SUPPORT
+    : s_(s), lock_(s.mutex) {}
+#else
+    : s_(s) {}
+#endif
+
+  void lock()
+  {
+#if VXL_FULLCXX11SUPPORT
+    lock_.lock();
+#endif
+  }
+
+  void unlock()
+  {
+#if VXL_FULLCXX11SUPPORT
+    lock_.unlock();
+#endif
+  }
+
+  //: Wait until an entry has finished loading or being written
+  void wait_changed()
+  {
+#if VXL_FULLCXX11SUPPORT
+    s_.changed.wait(lock_);
+#endif
+  }
+
+  //: Wait until there is something to write
+  void wait_work()
+  {
+#if VXL_FULLCXX11SUPPORT
+    s_.work.wait(lock_);
+#endif
+  }
+
+ private:
+  boxm2_cc_state& s_;
+#if VXL_FULLCXX11SUPPORT
+  std::unique_lock<std::mutex> lock_;
+#endif
+};
+
+//--------------------------------------------------------------------------------
+// Helpers; all are called with the lock held.
+
+static bool boxm2_cc_dirty(boxm2_cc_entry const* e)
+{
+  return (e->block && !e->block->read_only()) || (e->data && !e->data->read_only_);
+}
+
+static bool boxm2_cc_pinned(boxm2_cc_state const& s, boxm2_cc_entry const* e)
+{
+  return s.pins.find(std::make_pair(e->k.scene, e->k.id)) != s.pins.end();
+}
+
+static boxm2_cc_entry* boxm2_cc_find(boxm2_cc_state& s, boxm2_cc_state::key const& k)
+{
+  std::map<boxm2_cc_state::key, boxm2_cc_entry*>::iterator it = s.entries.find(k);
+  return it == s.entries.end() ? VXL_NULLPTR : it->second;
+}
+
+static void boxm2_cc_add_scene(boxm2_cc_state& s, boxm2_scene_sptr const& scene)
+{
+  for (unsigned i = 0; i < s.scenes.size(); ++i)
+    if (s.scenes[i] == scene)
+      return;
+  s.scenes.push_back(scene);
+}
+
+//: A new entry, loading, in use by the caller
+static boxm2_cc_entry* boxm2_cc_new_entry(boxm2_cc_state& s, boxm2_cc_state::key const& k,
+                                           std::string const& data_path)
+{
+  boxm2_cc_entry* e = new boxm2_cc_entry;
+  e->k = k;
+  e->data_path = data_path;
+  e->block = VXL_NULLPTR;
+  e->data = VXL_NULLPTR;
+  e->bytes = 0;
+  e->loading = true;
+  e->queued = false;
+  e->writing = false;
+  e->evicted = false;
+  e->users = 1;
+  e->removed = false;
+  e->in_lru = false;
+  s.entries[k] = e;
+  return e;
+}
+
+//: Put a loaded entry in the lru list
+static void boxm2_cc_finish_load(boxm2_cc_state& s, boxm2_cc_entry* e)
+{
+  e->bytes = e->block ? std::size_t(e->block->byte_count()) : e->data ? e->data->buffer_length() : 0;
+  s.resident_bytes += e->bytes;
+  e->loading = false;
+  s.lru.push_front(e);
+  e->lru_pos = s.lru.begin();
+  e->in_lru = true;
+  s.notify_changed();
+}
+
+//: Mark an entry as most recently used, taking it back if it was evicted
+static void boxm2_cc_touch(boxm2_cc_state& s, boxm2_cc_entry* e)
+{
+  if (e->evicted) {
+    e->evicted = false;
+    s.pending_bytes -= e->bytes;
+    s.resident_bytes += e->bytes;
+  }
+  if (e->in_lru)
+    s.lru.erase(e->lru_pos);
+  s.lru.push_front(e);
+  e->lru_pos = s.lru.begin();
+  e->in_lru = true;
+}
+
+//: Wait until an entry is neither loading nor being written
+static void boxm2_cc_wait_idle(boxm2_concurrent_cache_lock& lock, boxm2_cc_entry* e)
+{
+  while (e->loading || e->writing)
+    lock.wait_changed();
+}
+
+//: Take an entry out of the write queue
+static void boxm2_cc_unqueue(boxm2_cc_state& s, boxm2_cc_entry* e)
+{
+  if (!e->queued)
+    return;
+  for (std::deque<boxm2_cc_entry*>::iterator it = s.write_queue.begin(); it != s.write_queue.end(); ++it)
+    if (*it == e) {
+      s.write_queue.erase(it);
+      break;
+    }
+  e->queued = false;
+}
+
+//: Take an entry out of the cache, and delete it and its block or data
+//  If requests in progress use the entry, the last of them deletes it.
+static void boxm2_cc_release(boxm2_cc_state& s, boxm2_cc_entry* e)
+{
+  if (!e->removed) {
+    boxm2_cc_unqueue(s, e);
+    if (e->evicted)
+      s.pending_bytes -= e->bytes;
+    else
+      s.resident_bytes -= e->bytes;
+    if (e->in_lru)
+      s.lru.erase(e->lru_pos);
+    e->in_lru = false;
+    s.entries.erase(e->k);
+    e->removed = true;
+  }
+  if (e->users > 0)
+    return;
+  delete e->block;
+  delete e->data;
+  delete e;
+}
+
+//: Finish a request that used an entry, deleting the entry if it was removed meanwhile
+static void boxm2_cc_done(boxm2_cc_state& s, boxm2_cc_entry* e)
+{
+  --e->users;
+  if (e->removed && e->users == 0)
+    boxm2_cc_release(s, e);
+}
+
+//: Start a request that uses an entry, once it is neither loading nor being written
+//  \return false if the entry was removed meanwhile; it must not be used then.
+static bool boxm2_cc_use(boxm2_cc_state& s, boxm2_concurrent_cache_lock& lock, boxm2_cc_entry* e)
+{
+  ++e->users;
+  boxm2_cc_wait_idle(lock, e);
+  if (!e->removed)
+    return true;
+  boxm2_cc_done(s, e);
+  return false;
+}
+
+//: Add a pin to block \a id of \a scene
+static void boxm2_cc_pin(boxm2_cc_state& s, boxm2_scene* scene, boxm2_block_id const& id)
+{
+  ++s.pins[std::make_pair(scene, id)];
+}
+
+//: Write an entry to disk; called without the lock
+static void boxm2_cc_write(boxm2_cc_entry const* e)
+{
+  if (e->block)
+    boxm2_sio_mgr::save_block(e->data_path, e->block);
+  if (e->data)
+    boxm2_sio_mgr::save_block_data_base(e->data_path, e->k.id, e->data, e->k.type);
+}
+
+static void boxm2_cc_finish_write(boxm2_cc_state& s, boxm2_cc_entry* e)
+{
+  e->writing = false;
+  --s.num_writing;
+  ++s.write_backs;
+  // an evicted entry that is being asked for again is kept
+  if (e->evicted && !e->queued && e->users == 0)
+    boxm2_cc_release(s, e);
+  s.notify_changed();
+}
+
+//: Hand an entry to the writer thread, or write it now if there is none
+static void boxm2_cc_queue(boxm2_cc_state& s, boxm2_cc_entry* e)
+{
+  if (e->queued)
+    return;
+#if VXL_FULLCXX11SUPPORT
+  e->queued = true;
+  s.write_queue.push_back(e);
+  s.notify_work();
+#else
+  e->writing = true;
+  ++s.num_writing;
+  boxm2_cc_write(e);
+  boxm2_cc_finish_write(s, e);
+#endif
+}
+
+//: Evict least recently used entries until within budget
+//  \a keep, the entry just asked for, is never evicted.
+static void boxm2_cc_enforce_budget(boxm2_cc_state& s, boxm2_cc_entry const* keep)
+{
+  if (s.max_bytes == 0)
+    return;
+  std::list<boxm2_cc_entry*>::iterator it = s.lru.end();
+  while (s.resident_bytes > s.max_bytes && it != s.lru.begin()) {
+    --it;
+    boxm2_cc_entry* e = *it;
+    if (e == keep || e->users > 0 || e->writing || boxm2_cc_pinned(s, e))
+      continue;
+    std::list<boxm2_cc_entry*>::iterator next = it;
+    ++next;
+    ++s.evictions;
+    VUL_TRACE_COUNTER("boxm2_concurrent_cache.evictions", 1);
+    s.lru.erase(e->lru_pos);
+    e->in_lru = false;
+    if (boxm2_cc_dirty(e)) {
+      e->evicted = true;
+      s.resident_bytes -= e->bytes;
+      s.pending_bytes += e->bytes;
+      boxm2_cc_queue(s, e);
+    }
+    else
+      boxm2_cc_release(s, e);
+    it = next;
+  }
+}
+
+//: The entry of a block, loaded if need be, in use by the caller
+static boxm2_cc_entry* boxm2_cc_block(boxm2_cc_state& s, boxm2_concurrent_cache_lock& lock,
+                                      boxm2_scene_sptr& scene, boxm2_block_id id)
+{
+  boxm2_cc_state::key k;
+  k.scene = scene.ptr();
+  k.id = id;
+  boxm2_cc_entry* e;
+  while ((e = boxm2_cc_find(s, k)) != VXL_NULLPTR) {
+    if (!boxm2_cc_use(s, lock, e))
+      continue;
+    boxm2_cc_touch(s, e);
+    ++s.hits;
+    return e;
+  }
+  VUL_TRACE_COUNTER("boxm2_concurrent_cache.block_misses", 1);
+  ++s.misses;
+  boxm2_cc_add_scene(s, scene);
+  e = boxm2_cc_new_entry(s, k, scene->data_path());
+  lock.unlock();
+  boxm2_block_metadata mdata = scene->get_block_metadata(id);
+  boxm2_block* loaded = boxm2_sio_mgr::load_block(scene->data_path(), id, mdata);
+  // if the block is null then initialize an empty one
+  if (!loaded && scene->block_exists(id))
+    loaded = new boxm2_block(mdata);
+  lock.lock();
+  e->block = loaded;
+  boxm2_cc_finish_load(s, e);
+  return e;
+}
+
+//--------------------------------------------------------------------------------
+
+#if VXL_FULLCXX11SUPPORT
+//: The writer thread: write queued entries until told to stop, and the queue is empty
+static void boxm2_cc_write_back(boxm2_cc_state* s)
+{
+  boxm2_concurrent_cache_lock lock(*s);
+  while (true) {
+    while (!s->stop && s->write_queue.empty())
+      lock.wait_work();
+    if (s->write_queue.empty())
+      return;
+    boxm2_cc_entry* e = s->write_queue.front();
+    s->write_queue.pop_front();
+    e->queued = false;
+    e->writing = true;
+    ++s->num_writing;
+    lock.unlock();
+    boxm2_cc_write(e);
+    lock.lock();
+    boxm2_cc_finish_write(*s, e);
+  }
+}
+#endif // VXL_FULLCXX11SUPPORT
+
+//: PUBLIC create method, for creating singleton instance of boxm2_cache
+void boxm2_concurrent_cache::create(boxm2_scene_sptr scene, BOXM2_IO_FS_TYPE fs_type, std::size_t max_bytes)
+{
+  if (!boxm2_cache::exists())
+    instance_ = new boxm2_concurrent_cache(scene, fs_type, max_bytes);
+}
+
+//: constructor, starts the writer thread
+boxm2_concurrent_cache::boxm2_concurrent_cache(boxm2_scene_sptr scene, BOXM2_IO_FS_TYPE fs_type, std::size_t max_bytes)
+  : boxm2_cache(fs_type), state_(new state)
+{
+  state_->max_bytes = max_bytes;
+  state_->resident_bytes = 0;
+  state_->pending_bytes = 0;
+  state_->num_writing = 0;
+  state_->stop = false;
+  if (scene)
+    state_->scenes.push_back(scene);
+  this->reset_stats();
+#if VXL_FULLCXX11SUPPORT
+  state_->writer = std::thread(boxm2_cc_write_back, state_);
+#endif
+}
+
+//: destructor waits for the writer thread, then frees the memory
+boxm2_concurrent_cache::~boxm2_concurrent_cache()
+{
+#if VXL_FULLCXX11SUPPORT
+  {
+    boxm2_concurrent_cache_lock lock(*state_);
+    state_->stop = true;
+    state_->notify_work();
+  }
+  state_->writer.join();
+#endif
+  this->clear_cache();
+  delete state_;
+}
+
+//: realization of abstract "get_block(block_id)"
+boxm2_block* boxm2_concurrent_cache::get_block(boxm2_scene_sptr & scene, boxm2_block_id id)
+{
+  boxm2_concurrent_cache_lock lock(*state_);
+  boxm2_cc_entry* e = boxm2_cc_block(*state_, lock, scene, id);
+  boxm2_cc_done(*state_, e);
+  boxm2_cc_enforce_budget(*state_, e);
+  return e->block;
+}
+
+//: get data by type and id
+boxm2_data_base* boxm2_concurrent_cache::get_data_base(boxm2_scene_sptr & scene, boxm2_block_id id, std::string type, std::size_t num_bytes, bool read_only)
+{
+  if (!scene->block_exists(id))
+    return VXL_NULLPTR;
+
+  boxm2_concurrent_cache_lock lock(*state_);
+  boxm2_cc_state::key k;
+  k.scene = scene.ptr();
+  k.type = type;
+  k.id = id;
+  while (true) {
+    boxm2_cc_entry* e = boxm2_cc_find(*state_, k);
+    if (!e) {
+      // the number of cells of the block determines the size of the data
+      boxm2_cc_entry* blk = boxm2_cc_block(*state_, lock, scene, id);
+      unsigned n_cells = blk->block ? blk->block->num_cells() : 0;
+      boxm2_cc_done(*state_, blk);
+      std::size_t byte_length = n_cells * boxm2_data_info::datasize(type);
+      if (num_bytes > 0 && num_bytes != byte_length) {
+        std::stringstream ss;
+        ss<<"Attempting to retrieve "<<num_bytes<<" bytes for datatype " << type <<" when actual buffer size should be "<<byte_length;
+        throw std::runtime_error(ss.str());
+      }
+
+      // another thread may have asked for the same data meanwhile
+      e = boxm2_cc_find(*state_, k);
+      if (!e) {
+        VUL_TRACE_COUNTER("boxm2_concurrent_cache.data_misses", 1);
+        ++state_->misses;
+        e = boxm2_cc_new_entry(*state_, k, scene->data_path());
+        lock.unlock();
+        boxm2_data_base* loaded = boxm2_sio_mgr::load_block_data_generic(scene->data_path(), id, type, filesystem_);
+        if (loaded && num_bytes > 0 && loaded->buffer_length() != byte_length) {
+          delete loaded;
+          loaded = VXL_NULLPTR;
+        }
+        if (!loaded) {
+          loaded = new boxm2_data_base(new char[byte_length], byte_length, id, read_only);
+          loaded->set_default_value(type, scene->get_block_metadata(id));
+        }
+        if (!read_only)  // write-enable is enforced
+          loaded->enable_write();
+        lock.lock();
+        e->data = loaded;
+        boxm2_cc_finish_load(*state_, e);
+        boxm2_cc_done(*state_, e);
+        boxm2_cc_enforce_budget(*state_, e);
+        return e->data;
+      }
+    }
+
+    // congrats you've found the data block in cache, unless it is removed while waiting for it
+    if (!boxm2_cc_use(*state_, lock, e))
+      continue;
+    boxm2_cc_touch(*state_, e);
+    boxm2_cc_done(*state_, e);
+    VUL_TRACE_COUNTER("boxm2_concurrent_cache.data_hits", 1);
+    ++state_->hits;
+    if (!read_only)  // write-enable is enforced
+      e->data->enable_write();
+    return e->data;
+  }
+}
+
+//: Put \a replacement in the cache in place of the data of type \a type of block \a id
+//  If \a copy_status, the read_only/write status of the old data is copied.
+static void boxm2_cc_replace(boxm2_cc_state& s, boxm2_concurrent_cache_lock& lock,
+                             boxm2_scene_sptr& scene, boxm2_block_id id, std::string const& type,
+                             boxm2_data_base* replacement, bool copy_status)
+{
+  boxm2_cc_state::key k;
+  k.scene = scene.ptr();
+  k.type = type;
+  k.id = id;
+  boxm2_cc_entry* e;
+  while ((e = boxm2_cc_find(s, k)) != VXL_NULLPTR && !boxm2_cc_use(s, lock, e))
+    ;
+  if (e) {
+    boxm2_cc_unqueue(s, e);
+    boxm2_cc_touch(s, e);
+    if (e->data) {
+      if (copy_status)
+        replacement->read_only_ = e->data->read_only_;
+      delete e->data;
+    }
+    s.resident_bytes -= e->bytes;
+    e->data = replacement;
+    e->bytes = replacement->buffer_length();
+    s.resident_bytes += e->bytes;
+  }
+  else {
+    boxm2_cc_add_scene(s, scene);
+    e = boxm2_cc_new_entry(s, k, scene->data_path());
+    e->data = replacement;
+    boxm2_cc_finish_load(s, e);
+  }
+  boxm2_cc_done(s, e);
+  boxm2_cc_enforce_budget(s, e);
+}
+
+//: returns a data_base pointer which is initialized to the default value of the type.
+//  If a block for this type exists on the cache, it is removed and replaced with the new one.
+//  This method does not check whether a block of this type already exists on the disk nor writes it to the disk
+boxm2_data_base* boxm2_concurrent_cache::get_data_base_new(boxm2_scene_sptr & scene, boxm2_block_id id, std::string type, std::size_t num_bytes, bool read_only)
+{
+  boxm2_block_metadata data = scene->get_block_metadata(id);
+  boxm2_data_base* block_data;
+  if (num_bytes > 0) {
+    block_data = new boxm2_data_base(new char[num_bytes], num_bytes, id, read_only);
+    block_data->set_default_value(type, data);
+  }
+  else {
+    // the following constructor also sets the default values
+    block_data = new boxm2_data_base(data, type, read_only);
+  }
+  boxm2_concurrent_cache_lock lock(*state_);
+  boxm2_cc_replace(*state_, lock, scene, id, type, block_data, false);
+  return block_data;
+}
+
+//: removes data from this cache (may or may not write to disk first)
+void boxm2_concurrent_cache::remove_data_base(boxm2_scene_sptr & scene, boxm2_block_id id, std::string type, bool write_out)
+{
+  boxm2_concurrent_cache_lock lock(*state_);
+  boxm2_cc_state::key k;
+  k.scene = scene.ptr();
+  k.type = type;
+  k.id = id;
+  boxm2_cc_entry* e = boxm2_cc_find(*state_, k);
+  if (!e || !boxm2_cc_use(*state_, lock, e))
+    return;
+  boxm2_cc_unqueue(*state_, e);
+  if (write_out && e->data)
+    boxm2_sio_mgr::save_block_data_base(e->data_path, id, e->data, type);
+  // other requests waiting for the data delete it when they are done
+  --e->users;
+  boxm2_cc_release(*state_, e);
+}
+
+//: replaces data in the cache with one here
+void boxm2_concurrent_cache::replace_data_base(boxm2_scene_sptr & scene, boxm2_block_id id, std::string type, boxm2_data_base* replacement)
+{
+  boxm2_concurrent_cache_lock lock(*state_);
+  boxm2_cc_replace(*state_, lock, scene, id, type, replacement, true);
+}
+
+//: Hand the writable entries of \a scene (or of all scenes if null) to the writer
+static void boxm2_cc_write_dirty(boxm2_cc_state& s, boxm2_scene const* scene)
+{
+  for (std::map<boxm2_cc_state::key, boxm2_cc_entry*>::iterator it = s.entries.begin(); it != s.entries.end(); ) {
+    // writing without threads may delete the entry
+    boxm2_cc_entry* e = it->second;
+    ++it;
+    if ((!scene || e->k.scene == scene) && !e->loading && !e->writing && boxm2_cc_dirty(e))
+      boxm2_cc_queue(s, e);
+  }
+}
+
+//: hands all writable blocks and data to the background writer, without waiting
+void boxm2_concurrent_cache::start_write_back()
+{
+  boxm2_concurrent_cache_lock lock(*state_);
+  boxm2_cc_write_dirty(*state_, VXL_NULLPTR);
+}
+
+//: waits until the background writer has nothing left to write
+void boxm2_concurrent_cache::wait_for_write_back()
+{
+  boxm2_concurrent_cache_lock lock(*state_);
+  while (!state_->write_queue.empty() || state_->num_writing > 0)
+    lock.wait_changed();
+}
+
+//: dumps all data onto disk
+void boxm2_concurrent_cache::write_to_disk()
+{
+  this->start_write_back();
+  this->wait_for_write_back();
+}
+
+//: dumps all data of the scene onto disk
+void boxm2_concurrent_cache::write_to_disk(boxm2_scene_sptr & scene)
+{
+  {
+    boxm2_concurrent_cache_lock lock(*state_);
+    boxm2_cc_write_dirty(*state_, scene.ptr());
+  }
+  this->wait_for_write_back();
+}
+
+//: keep the block and data of block \a id of \a scene in memory until unpin_block()
+void boxm2_concurrent_cache::pin_block(boxm2_scene_sptr & scene, boxm2_block_id id)
+{
+  boxm2_concurrent_cache_lock lock(*state_);
+  boxm2_cc_pin(*state_, scene.ptr(), id);
+}
+
+//: undo one pin_block()
+void boxm2_concurrent_cache::unpin_block(boxm2_scene_sptr & scene, boxm2_block_id id)
+{
+  boxm2_concurrent_cache_lock lock(*state_);
+  std::map<std::pair<boxm2_scene*, boxm2_block_id>, unsigned>::iterator it =
+    state_->pins.find(std::make_pair(scene.ptr(), id));
+  if (it == state_->pins.end()) {
+    std::cerr << "boxm2_concurrent_cache::unpin_block: block " << id << " is not pinned\n";
+    return;
+  }
+  if (--it->second == 0) {
+    state_->pins.erase(it);
+    boxm2_cc_enforce_budget(*state_, VXL_NULLPTR);
+  }
+}
+
+//: add a new scene to the cache
+bool boxm2_concurrent_cache::add_scene(boxm2_scene_sptr & scene)
+{
+  boxm2_concurrent_cache_lock lock(*state_);
+  for (unsigned i = 0; i < state_->scenes.size(); ++i)
+    if (state_->scenes[i] == scene) {
+      std::cout<<"The scene Already exists "<<std::endl;
+      return false;
+    }
+  state_->scenes.push_back(scene);
+  return true;
+}
+
+//: remove a scene, and its blocks and data, from the cache, without writing them
+bool boxm2_concurrent_cache::remove_scene(boxm2_scene_sptr & scene)
+{
+  boxm2_concurrent_cache_lock lock(*state_);
+  std::vector<boxm2_scene_sptr>::iterator sit = state_->scenes.begin();
+  while (sit != state_->scenes.end() && *sit != scene)
+    ++sit;
+  if (sit == state_->scenes.end())
+    return false;
+
+  // evicted blocks and data can not be dropped without losing changes
+  while (true) {
+    bool pending = false;
+    for (std::map<boxm2_cc_state::key, boxm2_cc_entry*>::iterator it = state_->entries.begin();
+         it != state_->entries.end() && !pending; ++it)
+      pending = it->first.scene == scene.ptr() && (it->second->evicted || it->second->loading || it->second->writing);
+    if (!pending)
+      break;
+    lock.wait_changed();
+  }
+  for (std::map<boxm2_cc_state::key, boxm2_cc_entry*>::iterator it = state_->entries.begin(); it != state_->entries.end(); ) {
+    boxm2_cc_entry* e = it->second;
+    ++it;
+    if (e->k.scene == scene.ptr())
+      boxm2_cc_release(*state_, e);
+  }
+  state_->scenes.erase(sit);
+  return true;
+}
+
+//: delete all the memory
+//  Caution: make sure to call write to disk methods not to loose writable data
+void boxm2_concurrent_cache::clear_cache()
+{
+  this->wait_for_write_back();
+  boxm2_concurrent_cache_lock lock(*state_);
+  // entries still in use by requests are deleted when those are done
+  while (!state_->entries.empty()) {
+    boxm2_cc_entry* e = state_->entries.begin()->second;
+    if (e->loading || e->writing)
+      lock.wait_changed();
+    else
+      boxm2_cc_release(*state_, e);
+  }
+  state_->scenes.clear();
+}
+
+//: return list of scenes with data in the cache
+std::vector<boxm2_scene_sptr> boxm2_concurrent_cache::get_scenes()
+{
+  boxm2_concurrent_cache_lock lock(*state_);
+  return state_->scenes;
+}
+
+//: set the memory budget in bytes; 0 means no budget
+void boxm2_concurrent_cache::set_max_bytes(std::size_t max_bytes)
+{
+  boxm2_concurrent_cache_lock lock(*state_);
+  state_->max_bytes = max_bytes;
+  boxm2_cc_enforce_budget(*state_, VXL_NULLPTR);
+}
+
+//: the counts of hits, misses, evictions and write-backs, and the memory used
+boxm2_cache_stats boxm2_concurrent_cache::stats() const
+{
+  boxm2_concurrent_cache_lock lock(*state_);
+  boxm2_cache_stats st;
+  st.hits = state_->hits;
+  st.misses = state_->misses;
+  st.evictions = state_->evictions;
+  st.write_backs = state_->write_backs;
+  st.bytes_in_use = state_->resident_bytes + state_->pending_bytes;
+  st.max_bytes = state_->max_bytes;
+  return st;
+}
+
+//: reset the counts of hits, misses, evictions and write-backs
+void boxm2_concurrent_cache::reset_stats()
+{
+  boxm2_concurrent_cache_lock lock(*state_);
+  state_->hits = 0;
+  state_->misses = 0;
+  state_->evictions = 0;
+  state_->write_backs = 0;
+}
+
+//: Summarizes this cache's data
+std::string boxm2_concurrent_cache::to_string()
+{
+  boxm2_concurrent_cache_lock lock(*state_);
+  std::stringstream stream;
+  boxm2_scene const* scene = VXL_NULLPTR;
+  std::string type = "-";
+  for (std::map<boxm2_cc_state::key, boxm2_cc_entry*>::const_iterator it = state_->entries.begin();
+       it != state_->entries.end(); ++it) {
+    if (it->first.scene != scene) {
+      scene = it->first.scene;
+      type = "-";
+      stream << "boxm2_concurrent_cache:: scene dir=" << it->second->data_path << '\n';
+    }
+    if (it->first.type != type) {
+      type = it->first.type;
+      if (type.empty())
+        stream << "  blocks: ";
+      else
+        stream << "\n  data: " << type << ' ';
+    }
+    stream << '(' << it->first.id << (it->second->evicted ? ", evicted" : "") << ")  ";
+  }
+  stream << "\n  hits: " << state_->hits << "  misses: " << state_->misses
+         << "  evictions: " << state_->evictions << "  write backs: " << state_->write_backs
+         << "\n  bytes: " << state_->resident_bytes + state_->pending_bytes << " of " << state_->max_bytes << '\n';
+  return stream.str();
+}
+
+//: shows elements in cache
+std::ostream& operator<<(std::ostream &s, boxm2_concurrent_cache& cache)
+{
+  return s << cache.to_string();
+}
@@ -0,0 +1,142 @@
+#ifndef boxm2_concurrent_cache_h_
+#define boxm2_concurrent_cache_h_
+//:
+// \file
+// \brief A thread-safe boxm2_cache with a memory budget and background write-back
+//
+// boxm2_concurrent_cache keeps blocks and data of any number of scenes
+// under one budget of bytes, shared by all blocks and data types.  When
+// the budget is exceeded, the least recently used blocks and data are
+// evicted.  Writable blocks and data are handed to a background thread
+// that writes them to disk before their memory is released; until then
+// they are still counted against the budget, and asking for them again
+// takes them back without going to disk.
+//
+// All methods may be called from several threads at once.  Loading from
+// disk is done without holding the cache's lock, so threads asking for
+// different blocks do not wait for each other.
+//
+// Pinned blocks and data are never evicted, even if that means going over
+// budget.  Pointers returned by get_block(), get_data_base() and
+// get_data_base_new() stay valid only until what they point to is evicted,
+// which may happen on the next request, so callers hold a boxm2_block_pin
+// around each block they process.  Removing data, a scene, or clearing the
+// cache deletes what is pinned, but not while another thread is in the
+// middle of asking for it.
+//
+// Blocks and data are written back if they are writable, that is, if the
+// block was not loaded from disk or the data was asked for with
+// read_only=false.  Without C++11 threads, they are written when evicted.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <iostream>
+#include <boxm2/io/boxm2_cache.h>
+#include <vcl_compiler.h>
+
+//: Counts of the work done by a boxm2_concurrent_cache
+struct boxm2_cache_stats
+{
+  //: Requests for blocks and data found in memory
+  unsigned long hits;
+  //: Requests for blocks and data that had to be loaded or initialized
+  unsigned long misses;
+  //: Blocks and data evicted to stay within the budget
+  unsigned long evictions;
+  //: Blocks and data written to disk by the background writer
+  unsigned long write_backs;
+  //: Bytes of blocks and data held, including those waiting to be written
+  std::size_t bytes_in_use;
+  //: The budget; 0 if there is none
+  std::size_t max_bytes;
+};
+
+class boxm2_concurrent_cache : public boxm2_cache
+{
+ public:
+
+  //: create function used instead of constructor.
+  //  \a max_bytes is the memory budget; 0 means no budget.
+  static void create(boxm2_scene_sptr scene, BOXM2_IO_FS_TYPE fs_type=LOCAL, std::size_t max_bytes=0);
+
+  //: returns block pointer to block specified by ID
+  virtual boxm2_block* get_block(boxm2_scene_sptr & scene, boxm2_block_id id);
+
+  //: returns data_base pointer (THIS IS NECESSARY BECAUSE TEMPLATED FUNCTIONS CANNOT BE VIRTUAL)
+  virtual boxm2_data_base* get_data_base(boxm2_scene_sptr & scene, boxm2_block_id id, std::string type, std::size_t num_bytes=0, bool read_only = true);
+
+  //: returns a data_base pointer which is initialized to the default value of the type.
+  //  If a block for this type exists on the cache, it is removed and replaced with the new one.
+  //  This method does not check whether a block of this type already exists on the disc nor writes it to the disc
+  virtual boxm2_data_base* get_data_base_new(boxm2_scene_sptr & scene, boxm2_block_id id, std::string type, std::size_t num_bytes=0, bool read_only = true);
+
+  //: removes data from this cache (may or may not write to disk first)
+  virtual void remove_data_base(boxm2_scene_sptr & scene, boxm2_block_id id, std::string type, bool write_out=true);
+
+  //: replaces a database in the cache, deletes it
+  virtual void replace_data_base(boxm2_scene_sptr & scene, boxm2_block_id id, std::string type, boxm2_data_base* replacement);
+
+  //: writes all writable blocks and data to disk, and waits until they are written
+  virtual void write_to_disk();
+
+  //: writes the writable blocks and data of the scene to disk, and waits until they are written
+  virtual void write_to_disk(boxm2_scene_sptr & scene);
+
+  //: hands all writable blocks and data to the background writer, without waiting
+  void start_write_back();
+
+  //: waits until the background writer has nothing left to write
+  void wait_for_write_back();
+
+  //: keep the block and data of block \a id of \a scene in memory until unpin_block()
+  //  Pins are counted, so each call needs a matching unpin_block().
+  virtual void pin_block(boxm2_scene_sptr & scene, boxm2_block_id id);
+
+  //: undo one pin_block()
+  virtual void unpin_block(boxm2_scene_sptr & scene, boxm2_block_id id);
+
+  //: add a new scene to the cache
+  virtual bool add_scene(boxm2_scene_sptr & scene);
+
+  //: remove an existing scene from the cache
+  virtual bool remove_scene(boxm2_scene_sptr & scene);
+
+  //: delete all the memory, after waiting for the background writer
+  //  Caution: make sure to call write to disc methods not to loose writable data.
+  virtual void clear_cache();
+
+  //: return the list of scenes with any data in the cache
+  virtual std::vector<boxm2_scene_sptr> get_scenes();
+
+  //: set the memory budget in bytes; 0 means no budget
+  void set_max_bytes(std::size_t max_bytes);
+
+  //: the counts of hits, misses, evictions and write-backs, and the memory used
+  boxm2_cache_stats stats() const;
+
+  //: reset the counts of hits, misses, evictions and write-backs
+  void reset_stats();
+
+  //: to string method returns a string describing the cache's current state
+  std::string to_string();
+
+  //: The cached blocks and data, and the state shared with the writer thread
+  struct state;
+
+ private:
+
+  //: hidden constructor (private so it cannot be called -- forces the class to be singleton)
+  boxm2_concurrent_cache(boxm2_scene_sptr scene, BOXM2_IO_FS_TYPE fs_type, std::size_t max_bytes);
+
+  //: hidden destructor (private so it cannot be called -- forces the class to be singleton)
+  virtual ~boxm2_concurrent_cache();
+
+  state* state_;
+};
+
+//: shows elements in cache
+std::ostream& operator<<(std::ostream &s, boxm2_concurrent_cache& cache);
+
+#endif // boxm2_concurrent_cache_h_
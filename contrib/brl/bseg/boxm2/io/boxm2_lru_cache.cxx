@@ -8,6 +8,7 @@
 #include <boxm2/boxm2_block_metadata.h>
 #include <vcl_compiler.h>
 #include <boxm2/boxm2_data_traits.h>
+#include <vul/vul_tracing.h>
 //: PUBLIC create method, for creating singleton instance of boxm2_cache
 void boxm2_lru_cache::create(boxm2_scene_sptr scene, BOXM2_IO_FS_TYPE fs_type)
 {
@@ -101,6 +102,7 @@ boxm2_block* boxm2_lru_cache::get_block(boxm2_scene_sptr & scene, boxm2_block_id
   //: add a block
   if ( cached_blocks_[scene].find(id) == cached_blocks_[scene].end() )
   {
+      VUL_TRACE_COUNTER("boxm2_lru_cache.block_misses", 1);
       boxm2_block* loaded = boxm2_sio_mgr::load_block(scene->data_path(), id, mdata );
 
       // if the block is null then initialize an empty one
@@ -131,12 +133,14 @@ boxm2_data_base* boxm2_lru_cache::get_data_base(boxm2_scene_sptr & scene, boxm2_
   if ( iter != data_map.end() )
   {
     // congrats you've found the data block in cache, update cache and return block
+    VUL_TRACE_COUNTER("boxm2_lru_cache.data_hits", 1);
     if (!read_only)  // write-enable is enforced
       iter->second->enable_write();
     return iter->second;
   }
 
   // grab from disk
+  VUL_TRACE_COUNTER("boxm2_lru_cache.data_misses", 1);
   boxm2_data_base* loaded = boxm2_sio_mgr::load_block_data_generic(scene->data_path(), id, type, filesystem_);
   boxm2_block_metadata data = scene->get_block_metadata(id);
 
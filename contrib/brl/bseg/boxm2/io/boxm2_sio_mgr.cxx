@@ -3,6 +3,7 @@
 #include "boxm2_sio_mgr.h"
 #include <vcl_compiler.h>
 #include <sys/stat.h>  //for getting file sizes
+#include <vul/vul_tracing.h>
 
 #if defined(HAS_HDFS) && HAS_HDFS
 #include <bhdfs/bhdfs_manager.h>
@@ -11,6 +12,7 @@
 
 boxm2_block* boxm2_sio_mgr::load_block(std::string dir, boxm2_block_id block_id, BOXM2_IO_FS_TYPE fs_type)
 {
+  VUL_TRACE_SCOPE("boxm2_sio_mgr::load_block");
   std::string filepath = dir + block_id.to_string() + ".bin";
   unsigned long numBytes = 0;
   char* bytes=VXL_NULLPTR;
@@ -46,12 +48,14 @@ boxm2_block* boxm2_sio_mgr::load_block(std::string dir, boxm2_block_id block_id,
     std::cerr << "boxm2_sio_mgr:: FileSystem -" << fs_type << " is not implemented, yet!\n";
     return VXL_NULLPTR;
   }
+  VUL_TRACE_COUNTER("boxm2_sio_mgr.block_bytes_read", numBytes);
   //instantiate new block
   return new boxm2_block(block_id, bytes);
 }
 
 boxm2_block* boxm2_sio_mgr::load_block(std::string dir, boxm2_block_id block_id,boxm2_block_metadata data, BOXM2_IO_FS_TYPE fs_type)
 {
+  VUL_TRACE_SCOPE("boxm2_sio_mgr::load_block");
   std::string filepath = dir + block_id.to_string() + ".bin";
   unsigned long numBytes = 0;
   char* bytes=VXL_NULLPTR;
@@ -86,6 +90,7 @@ boxm2_block* boxm2_sio_mgr::load_block(std::string dir, boxm2_block_id block_id,
     std::cerr << "boxm2_sio_mgr:: FileSystem -" << fs_type << " is not implemented, yet!\n";
     return VXL_NULLPTR;
   }
+  VUL_TRACE_COUNTER("boxm2_sio_mgr.block_bytes_read", numBytes);
   //instantiate new block
   boxm2_block * returnboxm2_block = new boxm2_block(block_id,data, bytes);
   return returnboxm2_block;
@@ -93,6 +98,7 @@ boxm2_block* boxm2_sio_mgr::load_block(std::string dir, boxm2_block_id block_id,
 
 void boxm2_sio_mgr::save_block(std::string dir, boxm2_block* block)
 {
+  VUL_TRACE_SCOPE("boxm2_sio_mgr::save_block");
   std::string filepath = dir + block->block_id().to_string() + ".bin";
   //std::cout<<"boxm2_sio_mgr::write save to file: "<<filepath<<std::endl;
   char * bytes = block->buffer();
@@ -107,6 +113,7 @@ void boxm2_sio_mgr::save_block(std::string dir, boxm2_block* block)
 // loads a generic boxm2_data_base* from disk (given data_type string prefix)
 boxm2_data_base* boxm2_sio_mgr::load_block_data_generic(std::string dir, boxm2_block_id id, std::string data_type, BOXM2_IO_FS_TYPE fs_type)
 {
+  VUL_TRACE_SCOPE("boxm2_sio_mgr::load_block_data_generic");
   // file name
   std::string filename = dir + data_type + "_" + id.to_string() + ".bin";
   unsigned long numBytes = 0;
@@ -141,6 +148,7 @@ boxm2_data_base* boxm2_sio_mgr::load_block_data_generic(std::string dir, boxm2_b
     std::cerr << "boxm2_sio_mgr:: FileSystem -" << fs_type << " is not implemented, yet!\n";
     return VXL_NULLPTR;
   }
+  VUL_TRACE_COUNTER("boxm2_sio_mgr.data_bytes_read", numBytes);
   //instantiate new block
   return new boxm2_data_base(bytes,numBytes,id);
 }
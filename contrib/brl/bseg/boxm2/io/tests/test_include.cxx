@@ -1,5 +1,6 @@
 #include <boxm2/io/boxm2_asio_mgr.h>
 #include <boxm2/io/boxm2_cache.h>
+#include <boxm2/io/boxm2_concurrent_cache.h>
 #include <boxm2/io/boxm2_dumb_cache.h>
 #include <boxm2/io/boxm2_lru_cache.h>
 #include <boxm2/io/boxm2_nn_cache.h>
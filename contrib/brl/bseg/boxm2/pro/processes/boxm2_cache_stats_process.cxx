@@ -0,0 +1,79 @@
+// This is brl/bseg/boxm2/pro/processes/boxm2_cache_stats_process.cxx
+//:
+// \file
+// \brief  A process to report the hits, misses, evictions and memory use of a concurrent cache.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <iostream>
+#include <bprb/bprb_func_process.h>
+
+#include <vcl_compiler.h>
+#include <boxm2/io/boxm2_cache.h>
+#include <boxm2/io/boxm2_concurrent_cache.h>
+
+
+namespace boxm2_cache_stats_process_globals
+{
+  const unsigned n_inputs_ = 2;
+  const unsigned n_outputs_ = 5;
+}
+
+bool boxm2_cache_stats_process_cons(bprb_func_process& pro)
+{
+  using namespace boxm2_cache_stats_process_globals;
+
+  //process takes 2 inputs
+  std::vector<std::string> input_types_(n_inputs_);
+  input_types_[0] = "boxm2_cache_sptr";
+  input_types_[1] = "bool";     // reset the counts afterwards
+
+  // process has 5 outputs
+  std::vector<std::string>  output_types_(n_outputs_);
+  output_types_[0] = "unsigned";  // hits
+  output_types_[1] = "unsigned";  // misses
+  output_types_[2] = "unsigned";  // evictions
+  output_types_[3] = "unsigned";  // blocks and data written back
+  output_types_[4] = "float";     // memory in use, in MB
+
+  bool good = pro.set_input_types(input_types_)
+           && pro.set_output_types(output_types_);
+
+  // in case the 2nd input is not set
+  brdb_value_sptr idx = new brdb_value_t<bool>(false);
+  pro.set_input(1, idx);
+  return good;
+}
+
+bool boxm2_cache_stats_process(bprb_func_process& pro)
+{
+  using namespace boxm2_cache_stats_process_globals;
+
+  if ( pro.n_inputs() < n_inputs_ ){
+    std::cout << pro.name() << ": The number of inputs should be " << n_inputs_<< std::endl;
+    return false;
+  }
+  //get the inputs
+  unsigned i = 0;
+  boxm2_cache_sptr cache = pro.get_input<boxm2_cache_sptr>(i++);
+  bool reset = pro.get_input<bool>(i++);
+
+  boxm2_concurrent_cache* ccache = dynamic_cast<boxm2_concurrent_cache*>(cache.ptr());
+  if (!ccache) {
+    std::cout << pro.name() << ": only a concurrent cache keeps statistics" << std::endl;
+    return false;
+  }
+  boxm2_cache_stats stats = ccache->stats();
+  if (reset)
+    ccache->reset_stats();
+
+  i = 0;
+  pro.set_output_val<unsigned>(i++, unsigned(stats.hits));
+  pro.set_output_val<unsigned>(i++, unsigned(stats.misses));
+  pro.set_output_val<unsigned>(i++, unsigned(stats.evictions));
+  pro.set_output_val<unsigned>(i++, unsigned(stats.write_backs));
+  pro.set_output_val<float>(i++, float(stats.bytes_in_use / (1024.0*1024.0)));
+  return true;
+}
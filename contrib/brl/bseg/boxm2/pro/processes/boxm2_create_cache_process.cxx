@@ -81,27 +81,31 @@ bool boxm2_create_cache1_process(bprb_func_process& pro)
 
 #include <boxm2/io/boxm2_cache.h>
 #include <boxm2/io/boxm2_lru_cache.h>
+#include <boxm2/io/boxm2_concurrent_cache.h>
 
 namespace boxm2_create_cache_process_globals
 {
-  const unsigned n_inputs_ = 3;
+  const unsigned n_inputs_ = 4;
   const unsigned n_outputs_ = 1;
 }
 bool boxm2_create_cache_process_cons(bprb_func_process& pro)
 {
   using namespace boxm2_create_cache_process_globals;
 
-  //process takes 3 inputs
+  //process takes 4 inputs
   std::vector<std::string> input_types_(n_inputs_);
   input_types_[0] = "boxm2_scene_sptr";
-  input_types_[1] = "vcl_string";
+  input_types_[1] = "vcl_string";  // "lru" or "concurrent"
   input_types_[2] = "bool";
+  input_types_[3] = "unsigned";    // memory budget of a "concurrent" cache in MB, 0 for none; pinned blocks are not evicted
   // process has 1 output:
   // output[0]: scene sptr
   std::vector<std::string>  output_types_(n_outputs_);
   output_types_[0] = "boxm2_cache_sptr";
   brdb_value_sptr idx = new brdb_value_t<bool>(true);
   pro.set_input(2, idx);
+  brdb_value_sptr max_mb = new brdb_value_t<unsigned>(0);
+  pro.set_input(3, max_mb);
   return pro.set_input_types(input_types_) && pro.set_output_types(output_types_);
 }
 
@@ -118,6 +122,7 @@ bool boxm2_create_cache_process(bprb_func_process& pro)
   boxm2_scene_sptr scene= pro.get_input<boxm2_scene_sptr>(i++);
   std::string cache_type= pro.get_input<std::string>(i++);
   bool islocal= pro.get_input<bool>(i++);
+  unsigned max_mb= pro.get_input<unsigned>(i++);
   if(cache_type=="lru")
   {
       std::cout<<"Create Cache"<<std::endl;
@@ -127,6 +132,10 @@ bool boxm2_create_cache_process(bprb_func_process& pro)
           boxm2_lru_cache::create(scene,LOCAL);
 
   }
+  else if (cache_type=="concurrent")
+  {
+      boxm2_concurrent_cache::create(scene, islocal ? LOCAL : HDFS, std::size_t(max_mb)*1024*1024);
+  }
   else if (cache_type=="nn")
   {
      // boxm2_nn_cache::create(scene);
@@ -1022,6 +1022,25 @@ def clear_cache(cache):
     else:
         print "ERROR: Cache type needs to be boxm2_cache_sptr, not ", cache.type
 
+# hits, misses, evictions, write backs and MB in use of a concurrent cache
+
+
+def cache_stats(cache, do_reset=False):
+    boxm2_batch.init_process("boxm2CacheStatsProcess")
+    boxm2_batch.set_input_from_db(0, cache)
+    boxm2_batch.set_input_bool(1, do_reset)
+    if not boxm2_batch.run_process():
+        return None
+    stats = []
+    for i in range(4):
+        (id, type) = boxm2_batch.commit_output(i)
+        stats.append(boxm2_batch.get_output_unsigned(id))
+        boxm2_batch.remove_data(id)
+    (id, type) = boxm2_batch.commit_output(4)
+    stats.append(boxm2_batch.get_output_float(id))
+    boxm2_batch.remove_data(id)
+    return stats
+
 
 ######################################################################
 # trajectory methods
@@ -0,0 +1,184 @@
+//:
+// \file
+// \brief Tests the memory budget, pinning, write-back and thread safety of boxm2_concurrent_cache
+#include <iostream>
+#include <vector>
+#include <boxm2/boxm2_scene.h>
+#include <boxm2/boxm2_block.h>
+#include <boxm2/boxm2_data.h>
+#include <boxm2/basic/boxm2_block_id.h>
+#include <boxm2/io/boxm2_concurrent_cache.h>
+#include <testlib/testlib_test.h>
+#include <vul/vul_file.h>
+#include <vcl_compiler.h>
+#if VXL_FULLCXX11SUPPORT
+# include <thread>
+#endif
+#include "test_utils.h"
+
+typedef boxm2_data_traits<BOXM2_ALPHA>::datatype alpha_t;
+
+//: The value written to every cell of the alpha data of block \p id
+static alpha_t test_alpha(boxm2_block_id const& id)
+{
+  return alpha_t(1 + id.i() + 2*id.j() + 4*id.k());
+}
+
+//: True if every cell of \p data has value \p v
+static bool all_equal(boxm2_data_base* data, alpha_t v)
+{
+  if (!data)
+    return false;
+  alpha_t const* a = reinterpret_cast<alpha_t const*>(data->data_buffer());
+  std::size_t n = data->buffer_length() / sizeof(alpha_t);
+  for (std::size_t c = 0; c < n; ++c)
+    if (a[c] != v)
+      return false;
+  return n > 0;
+}
+
+#if VXL_FULLCXX11SUPPORT
+//: Read the alpha data of every block, over and over, checking the values
+//  Each block is pinned while its data is checked.
+static void read_all(boxm2_cache_sptr cache, boxm2_scene_sptr scene, std::vector<boxm2_block_id> ids,
+                     unsigned rounds, unsigned offset, bool* ok)
+{
+  *ok = true;
+  for (unsigned r = 0; r < rounds; ++r)
+    for (unsigned b = 0; b < ids.size(); ++b) {
+      boxm2_block_id id = ids[(b + offset) % ids.size()];
+      boxm2_block_pin pin(cache, scene, id);
+      boxm2_data_base* alpha = cache->get_data_base(scene, id, boxm2_data_traits<BOXM2_ALPHA>::prefix());
+      *ok = all_equal(alpha, test_alpha(id)) && *ok;
+    }
+}
+#endif
+
+void test_concurrent_cache()
+{
+  std::string dir = vul_file::get_cwd() + "/boxm2_concurrent_cache_test/";
+  vul_file::make_directory(dir);
+  boxm2_test_utils::delete_test_scene_from_disk(dir);
+
+  boxm2_scene_sptr scene;
+  boxm2_test_utils::create_test_simple_scene(scene);
+  scene->set_data_path(dir);
+  std::vector<boxm2_block_id> ids = scene->get_block_ids();
+
+  boxm2_concurrent_cache::create(scene);
+  boxm2_concurrent_cache* cache = dynamic_cast<boxm2_concurrent_cache*>(boxm2_cache::instance().ptr());
+  TEST("create", cache != VXL_NULLPTR && ids.size() == 8, true);
+  if (!cache)
+    return;
+
+  // Fill the scene: 8 new blocks, and their alpha data
+  for (unsigned b = 0; b < ids.size(); ++b) {
+    boxm2_block_pin pin(cache, scene, ids[b]);
+    boxm2_data_base* alpha = cache->get_data_base(scene, ids[b], boxm2_data_traits<BOXM2_ALPHA>::prefix(), 0, false);
+    alpha_t* a = reinterpret_cast<alpha_t*>(alpha->data_buffer());
+    for (std::size_t c = 0; c < alpha->buffer_length() / sizeof(alpha_t); ++c)
+      a[c] = test_alpha(ids[b]);
+  }
+  boxm2_cache_stats st = cache->stats();
+  TEST("misses for new blocks and data", st.misses, 16);
+  TEST("no budget, no evictions", st.evictions, 0);
+  std::size_t block_bytes = cache->get_block(scene, ids[0])->byte_count();
+  std::size_t alpha_bytes = cache->get_data_base(scene, ids[0], boxm2_data_traits<BOXM2_ALPHA>::prefix())->buffer_length();
+  st = cache->stats();
+  TEST("hits", st.hits >= 2, true);
+  TEST("bytes in use", st.bytes_in_use, 8*(block_bytes + alpha_bytes));
+
+  // A budget of about three blocks and their data
+  std::size_t budget = 3*(block_bytes + alpha_bytes) + 1;
+  cache->pin_block(scene, ids[7]);
+  boxm2_data_base* pinned = cache->get_data_base(scene, ids[7], boxm2_data_traits<BOXM2_ALPHA>::prefix());
+  cache->reset_stats();
+  cache->set_max_bytes(budget);
+  cache->wait_for_write_back();
+  st = cache->stats();
+  std::cout << *cache;
+  TEST("evictions to meet the budget", st.evictions >= 10, true);
+  TEST("evicted blocks and data are written back", st.write_backs, st.evictions);
+  TEST("within budget", st.bytes_in_use <= budget, true);
+  TEST("files written", vul_file::exists(dir + ids[1].to_string() + ".bin") &&
+                        vul_file::exists(dir + boxm2_data_traits<BOXM2_ALPHA>::prefix() + "_" + ids[1].to_string() + ".bin"), true);
+  TEST("pinned data is kept", cache->get_data_base(scene, ids[7], boxm2_data_traits<BOXM2_ALPHA>::prefix()) == pinned &&
+                              all_equal(pinned, test_alpha(ids[7])), true);
+
+  // Evicted data is read back from disk
+  cache->reset_stats();
+  bool ok = true;
+  for (unsigned b = 0; b < ids.size(); ++b) {
+    boxm2_block_pin pin(cache, scene, ids[b]);
+    ok = all_equal(cache->get_data_base(scene, ids[b], boxm2_data_traits<BOXM2_ALPHA>::prefix()), test_alpha(ids[b])) && ok;
+  }
+  st = cache->stats();
+  TEST("evicted data read back", ok, true);
+  TEST("misses for evicted data", st.misses > 0, true);
+  cache->unpin_block(scene, ids[7]);
+
+  // Taking back data that was evicted before it was written
+  cache->set_max_bytes(0);
+  boxm2_data_base* alpha0 = cache->get_data_base(scene, ids[0], boxm2_data_traits<BOXM2_ALPHA>::prefix(), 0, false);
+  cache->reset_stats();
+  cache->set_max_bytes(1);
+  {
+    boxm2_block_pin pin(cache, scene, ids[0]);
+    boxm2_data_base* again = cache->get_data_base(scene, ids[0], boxm2_data_traits<BOXM2_ALPHA>::prefix());
+    cache->wait_for_write_back();
+    TEST("data asked for again is valid", all_equal(again, test_alpha(ids[0])), true);
+    std::cout << "taken back before written: " << (again == alpha0 ? "yes" : "no") << '\n';
+  }
+
+  // The getters do not pin: without a pin, each request may evict what the previous one returned
+  cache->set_max_bytes(1);
+  cache->get_block(scene, ids[2]);
+  cache->get_block(scene, ids[5]);
+  cache->wait_for_write_back();
+  TEST("unpinned blocks are evicted", cache->stats().bytes_in_use, block_bytes);
+
+  // A block held by a boxm2_block_pin is kept with its data until the pin goes out of scope
+  cache->set_max_bytes(0);
+  {
+    boxm2_block_pin pin(cache, scene, ids[3]);
+    boxm2_block* kept_block = cache->get_block(scene, ids[3]);
+    boxm2_data_base* kept = cache->get_data_base(scene, ids[3], boxm2_data_traits<BOXM2_ALPHA>::prefix());
+    cache->set_max_bytes(1);
+    cache->get_block(scene, ids[4]);
+    cache->wait_for_write_back();
+    TEST("pinned block and data are kept", cache->get_block(scene, ids[3]) == kept_block &&
+                                           cache->get_data_base(scene, ids[3], boxm2_data_traits<BOXM2_ALPHA>::prefix()) == kept &&
+                                           all_equal(kept, test_alpha(ids[3])), true);
+  }
+  cache->wait_for_write_back();
+  TEST("released block and data are evicted", cache->stats().bytes_in_use <= block_bytes + alpha_bytes, true);
+
+#if VXL_FULLCXX11SUPPORT
+  // Several threads reading with a small budget
+  cache->set_max_bytes(budget);
+  cache->reset_stats();
+  const unsigned n_threads = 4;
+  bool thread_ok[n_threads];
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < n_threads; ++t)
+    threads.push_back(std::thread(read_all, boxm2_cache::instance(), scene, ids, 5, 2*t, &thread_ok[t]));
+  for (unsigned t = 0; t < n_threads; ++t)
+    threads[t].join();
+  cache->wait_for_write_back();
+  ok = true;
+  for (unsigned t = 0; t < n_threads; ++t)
+    ok = ok && thread_ok[t];
+  st = cache->stats();
+  std::cout << "threads: hits " << st.hits << ", misses " << st.misses << ", evictions " << st.evictions << '\n';
+  TEST("concurrent reads see the right data", ok, true);
+  TEST("concurrent reads evict", st.evictions > 0 && st.bytes_in_use <= budget + block_bytes + alpha_bytes, true);
+#endif
+
+  cache->write_to_disk();
+  cache->clear_cache();
+  TEST("cleared", cache->stats().bytes_in_use, 0);
+  boxm2_test_utils::delete_test_scene_from_disk(dir);
+}
+
+
+TESTMAIN(test_concurrent_cache);
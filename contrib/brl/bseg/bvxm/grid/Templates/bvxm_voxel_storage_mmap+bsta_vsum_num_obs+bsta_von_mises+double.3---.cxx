@@ -0,0 +1,8 @@
+#include <bvxm/grid/bvxm_voxel_storage_mmap.hxx>
+#include <bsta/bsta_attributes.h>
+#include <bsta/bsta_von_mises.h>
+#include <bsta/io/bsta_io_attributes.h>
+#include <bsta/io/bsta_io_von_mises.h>
+
+typedef bsta_vsum_num_obs<bsta_von_mises<double,3> > gauss_type;
+BVXM_VOXEL_STORAGE_MMAP_INSTANTIATE(gauss_type);
@@ -0,0 +1,5 @@
+#include <bvxm/grid/bvxm_voxel_storage_mmap.hxx>
+#include <bvxm/grid/bvxm_opinion.h>
+
+BVXM_VOXEL_STORAGE_MMAP_INSTANTIATE(bvxm_opinion);
+
@@ -0,0 +1,3 @@
+#include <bvxm/grid/bvxm_voxel_storage_mmap.hxx>
+
+BVXM_VOXEL_STORAGE_MMAP_INSTANTIATE(unsigned int);
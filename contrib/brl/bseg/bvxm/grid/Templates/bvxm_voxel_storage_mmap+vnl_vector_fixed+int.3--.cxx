@@ -0,0 +1,5 @@
+#include <bvxm/grid/bvxm_voxel_storage_mmap.hxx>
+#include <vnl/vnl_vector_fixed.h>
+
+typedef vnl_vector_fixed<int,3> vector;
+BVXM_VOXEL_STORAGE_MMAP_INSTANTIATE(vector);
@@ -9,6 +9,7 @@
 
 class bvxm_memory_chunk : public vbl_ref_count
 {
+ protected:
   //: Data
   void *data_;
 
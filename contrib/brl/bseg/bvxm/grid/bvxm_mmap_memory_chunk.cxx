@@ -0,0 +1,74 @@
+#include <iostream>
+#include <cstddef>
+#include "bvxm_mmap_memory_chunk.h"
+//:
+// \file
+
+#include <vcl_compiler.h>
+#ifdef VCL_WIN32
+# include <windows.h>
+#else
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+bvxm_mmap_memory_chunk::bvxm_mmap_memory_chunk(char const* filename)
+: bvxm_memory_chunk()
+{
+#ifdef VCL_WIN32
+  HANDLE file = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                            VXL_NULLPTR, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, VXL_NULLPTR);
+  if (file == INVALID_HANDLE_VALUE) return;
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0 ||
+      vxl_uint_64(std::size_t(file_size.QuadPart)) != vxl_uint_64(file_size.QuadPart))
+  { CloseHandle(file); return; }
+  HANDLE mapping = CreateFileMappingA(file, VXL_NULLPTR, PAGE_READWRITE, 0, 0, VXL_NULLPTR);
+  CloseHandle(file);
+  if (!mapping) return;
+  data_ = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+  CloseHandle(mapping); // the view keeps the mapping alive
+  if (!data_) return;
+  size_ = vxl_uint_64(file_size.QuadPart);
+#else
+  int fd = ::open(filename, O_RDWR);
+  if (fd < 0) return;
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size <= 0 ||
+      vxl_uint_64(std::size_t(st.st_size)) != vxl_uint_64(st.st_size))
+  { ::close(fd); return; }
+  void* p = ::mmap(VXL_NULLPTR, std::size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd); // the mapping keeps the file open
+  if (p == MAP_FAILED) return;
+  data_ = p;
+  size_ = vxl_uint_64(st.st_size);
+#endif
+}
+
+bvxm_mmap_memory_chunk::~bvxm_mmap_memory_chunk()
+{
+  if (data_) {
+#ifdef VCL_WIN32
+    UnmapViewOfFile(data_);
+#else
+    ::munmap(data_, std::size_t(size_));
+#endif
+  }
+  // nothing left for bvxm_memory_chunk to delete
+  data_ = VXL_NULLPTR;
+  size_ = 0;
+}
+
+bool bvxm_mmap_memory_chunk::flush()
+{
+  if (!data_)
+    return false;
+#ifdef VCL_WIN32
+  return FlushViewOfFile(data_, 0) != 0;
+#else
+  return ::msync(data_, std::size_t(size_), MS_SYNC) == 0;
+#endif
+}
@@ -0,0 +1,39 @@
+#ifndef bvxm_mmap_memory_chunk_h_
+#define bvxm_mmap_memory_chunk_h_
+//:
+// \file
+// \brief A bvxm_memory_chunk holding a shared, writable memory mapping of a file
+//
+// Writes to the memory go to the file: the system writes modified pages
+// back on its own, or when flush() is called.  The file must not be
+// truncated while it is mapped.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <vcl_compiler.h>
+#include "bvxm_memory_chunk.h"
+
+class bvxm_mmap_memory_chunk : public bvxm_memory_chunk
+{
+  // Mappings cannot be copied
+  bvxm_mmap_memory_chunk(const bvxm_mmap_memory_chunk&);
+  bvxm_mmap_memory_chunk& operator=(const bvxm_mmap_memory_chunk&);
+
+ public:
+  //: Map the whole of an existing file, for reading and writing.
+  // Check is_mapped() for success.
+  bvxm_mmap_memory_chunk(char const* filename);
+
+  //: Unmaps the file
+  virtual ~bvxm_mmap_memory_chunk();
+
+  //: True if the file was successfully mapped
+  bool is_mapped() const { return data_ != VXL_NULLPTR; }
+
+  //: Write the modified pages to the file, and wait until they are written
+  bool flush();
+};
+
+#endif // bvxm_mmap_memory_chunk_h_
@@ -13,6 +13,7 @@
 #include "bvxm_voxel_storage.h"
 #include "bvxm_voxel_storage_disk.h"
 #include "bvxm_voxel_storage_disk_cached.h"
+#include "bvxm_voxel_storage_mmap.h"
 #include "bvxm_voxel_storage_mem.h"
 #include "bvxm_voxel_storage_slab_mem.h"
 #include "bvxm_voxel_slab_iterator.h"
@@ -60,6 +61,11 @@ class bvxm_voxel_grid : public bvxm_voxel_grid_base
     storage_ = new bvxm_voxel_storage_slab_mem<T>(grid_size, num_slabs);
   }
 
+  //: Constructor for a voxel grid in the given storage, e.g. a bvxm_voxel_storage_mmap.
+  //  The grid takes ownership of \a storage.
+  bvxm_voxel_grid(bvxm_voxel_storage<T>* storage)
+    : bvxm_voxel_grid_base(vgl_vector_3d<unsigned int>(storage->nx(), storage->ny(), storage->nz())), storage_(storage) {}
+
   //: Destructor
   virtual ~bvxm_voxel_grid()
   {
@@ -2,10 +2,32 @@
 #define bvxm_voxel_storage_disk_cached_h_
 //:
 // \file
+// \brief Voxel storage on disk, holding a window of consecutive slices in memory
+//
+// When the memory budget holds at least three slices but not the whole
+// grid, it is split into three windows, and slices are read and written
+// on a background thread while the caller works on the current window:
+// the window after it, in the direction of the sweep, is read ahead, and
+// the window left behind is written while the next one is in use.  Slabs
+// thicker than a third of the budget switch the storage back to a single
+// window with synchronous reads and writes.  Without C++11 threads, all
+// reads and writes are synchronous.  A failed background write is reported
+// by the purge_cache() that hands over the next window.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
 
 #include <iostream>
 #include <string>
+#include <deque>
+#include <vector>
 #include <vcl_compiler.h>
+#if VXL_FULLCXX11SUPPORT
+# include <mutex>
+# include <condition_variable>
+# include <thread>
+#endif
 #ifdef BVXM_USE_FSTREAM64
 #include <vil/vil_stream_fstream64.h>
 #else
@@ -49,6 +71,61 @@ class bvxm_voxel_storage_disk_cached : public bvxm_voxel_storage<T>
 
    std::string storage_fname_;
 
+   //: Start reading the window after the current one, in the direction of the sweep
+   void prefetch();
+   //: Go back to one window of the whole budget, with synchronous reads and writes
+   void use_single_window();
+   //: Read (or write) slices first to last of the file into (or from) \a data
+   bool transfer(bool write, char* data, int first, int last);
+   //: Queue a read or write for the I/O thread; returns the number of the job
+   unsigned long queue_io(bool write, char* data, int first, int last);
+   //: Wait until the jobs up to number \a job are done
+   void wait_for_io(unsigned long job) const;
+   //: Wait until all queued jobs are done
+   void wait_for_io() const { wait_for_io(jobs_queued_); }
+   //: Wait until the jobs up to number \a job are done; false if the transfer of job \a job failed
+   bool io_ok(unsigned long job);
+
+   //: The number of slices the whole budget holds
+   unsigned n_budget_slices_;
+   //: True when reads and writes are done by the I/O thread
+   bool background_io_;
+   //: The window being read ahead
+   bvxm_memory_chunk_sptr prefetch_mem_;
+   int first_prefetch_slice_;
+   int last_prefetch_slice_;
+   unsigned long prefetch_job_;
+   //: The window being written behind
+   bvxm_memory_chunk_sptr write_mem_;
+   unsigned long write_job_;
+   //: The first slice and thickness of the last slab asked for, and whether the sweep goes towards slice 0
+   int last_slice_requested_;
+   unsigned last_thickness_;
+   bool descending_;
+
+   //: A read or write for the I/O thread
+   struct io_job
+   {
+     bool write;
+     char* data;
+     int first;
+     int last;
+   };
+   std::deque<io_job> io_queue_;
+   unsigned long jobs_queued_;
+   unsigned long jobs_done_;
+   //: The numbers of the jobs whose transfer failed, not yet reported by io_ok()
+   std::vector<unsigned long> failed_jobs_;
+#if VXL_FULLCXX11SUPPORT
+   //: The I/O thread: do the queued jobs in order, until told to stop and the queue is empty
+   void io_loop();
+
+   mutable std::mutex io_mutex_;
+   mutable std::condition_variable io_cond_;
+   std::thread io_thread_;
+   bool io_stop_;
+#endif
+
   // input and output file stream
 #ifdef BVXM_USE_FSTREAM64
   mutable vil_stream_fstream64 *fio_;
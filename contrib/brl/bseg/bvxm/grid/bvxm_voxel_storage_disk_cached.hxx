@@ -5,6 +5,8 @@
 
 #include <string>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 #include "bvxm_voxel_storage_disk_cached.h"
 //
 #include <vcl_compiler.h>
@@ -22,7 +24,13 @@
 
 template <class T>
 bvxm_voxel_storage_disk_cached<T>::bvxm_voxel_storage_disk_cached(std::string storage_filename, vgl_vector_3d<unsigned int> grid_size, vxl_int_64 max_cache_size)
-:  bvxm_voxel_storage<T>(grid_size), first_cache_slice_(-1), last_cache_slice_(-1), storage_fname_(storage_filename), fio_(0)
+:  bvxm_voxel_storage<T>(grid_size), first_cache_slice_(-1), last_cache_slice_(-1), storage_fname_(storage_filename),
+   background_io_(false), first_prefetch_slice_(-1), last_prefetch_slice_(-1), prefetch_job_(0), write_job_(0),
+   last_slice_requested_(-1), last_thickness_(1), descending_(false), jobs_queued_(0), jobs_done_(0),
+#if VXL_FULLCXX11SUPPORT
+   io_stop_(false),
+#endif
+   fio_(0)
 {
   //set up cache
   vxl_int_64 slice_size = sizeof(T)*grid_size.x()*grid_size.y();
@@ -30,14 +38,30 @@ bvxm_voxel_storage_disk_cached<T>::bvxm_voxel_storage_disk_cached(std::string st
   if (n_cache_slices_ > this->grid_size_.z()) {
     n_cache_slices_ = this->grid_size_.z();
   }
+  n_budget_slices_ = n_cache_slices_;
+#if VXL_FULLCXX11SUPPORT
+  // split the budget into the current, read-ahead and write-behind windows
+  if (n_cache_slices_ >= 3 && n_cache_slices_ < this->grid_size_.z()) {
+    n_cache_slices_ /= 3;
+    background_io_ = true;
+  }
+#endif
   vxl_int_64 cache_size = slice_size * n_cache_slices_;
 
-  std::cout << "allocating cache size of " << cache_size << " bytes ( " << n_cache_slices_ << " slices )." << std::endl;
+  std::cout << "allocating cache size of " << cache_size << " bytes ( " << n_cache_slices_ << " slices )"
+            << (background_io_ ? " for each of 3 windows." : ".") << std::endl;
 
   cache_mem_ = new bvxm_memory_chunk(cache_size);
   if (!cache_mem_) {
     std::cerr << "ERROR allocating cache memory!\n";
   }
+#if VXL_FULLCXX11SUPPORT
+  if (background_io_) {
+    prefetch_mem_ = new bvxm_memory_chunk(cache_size);
+    write_mem_ = new bvxm_memory_chunk(cache_size);
+    io_thread_ = std::thread(&bvxm_voxel_storage_disk_cached<T>::io_loop, this);
+  }
+#endif
 
   // check if file exists already or not
   if (vul_file::exists(storage_fname_))  {
@@ -81,6 +105,16 @@ bvxm_voxel_storage_disk_cached<T>::~bvxm_voxel_storage_disk_cached()
   // purge the cache
   std::cout << " ------------ destructor: purging cache --------------" << std::endl;
   purge_cache();
+#if VXL_FULLCXX11SUPPORT
+  if (io_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(io_mutex_);
+      io_stop_ = true;
+    }
+    io_cond_.notify_all();
+    io_thread_.join();
+  }
+#endif
 
   // this will delete the stream object
   if (fio_) {
@@ -114,6 +148,11 @@ bool bvxm_voxel_storage_disk_cached<T>::initialize_data(T const& value)
       return false;
     }
   }
+  // the file is about to be replaced: drop the windows instead of writing them
+  wait_for_io();
+  first_prefetch_slice_ = -1;
+  last_prefetch_slice_ = -1;
+
   // everything looks ok. open file for write and fill with data
 #ifdef BVXM_USE_FSTREAM64
   fio_ = new vil_stream_fstream64(storage_fname_.c_str(),"w");
@@ -162,6 +201,9 @@ bvxm_voxel_slab<T> bvxm_voxel_storage_disk_cached<T>::get_slab(unsigned slice_id
     bvxm_voxel_slab<T> slab;
     return slab;
   }
+  if (slab_thickness > n_cache_slices_ && slab_thickness <= n_budget_slices_) {
+    use_single_window();
+  }
   if (slab_thickness > n_cache_slices_) {
     std::cerr << "error: tried to get slab with thickness > cache size\n"
              << "  requested slab_thickness = " << slab_thickness << ", cache size = " << n_cache_slices_ << std::endl;
@@ -171,26 +213,56 @@ bvxm_voxel_slab<T> bvxm_voxel_storage_disk_cached<T>::get_slab(unsigned slice_id
 
   unsigned last_slice_idx = slice_idx + slab_thickness - 1;
 
+  // note which way the slabs are swept, to read ahead in that direction
+  if (last_slice_requested_ >= 0 && (int)slice_idx != last_slice_requested_)
+    descending_ = (int)slice_idx < last_slice_requested_;
+  last_slice_requested_ = slice_idx;
+  last_thickness_ = slab_thickness;
+
   // check to see if slab is already in cache
   T* first_voxel = 0;
-  if ( ((int)slice_idx < first_cache_slice_ ) || ((int)slice_idx > last_cache_slice_) ){
+  if ( ((int)slice_idx < first_cache_slice_ ) || ((int)last_slice_idx > last_cache_slice_) ){
     // slab is not in cache
-    purge_cache();
-    fill_cache(slice_idx);
+    if (((int)slice_idx >= first_prefetch_slice_) && ((int)last_slice_idx <= last_prefetch_slice_) &&
+        io_ok(prefetch_job_)) {
+      // slab was read ahead; the slices it shares with the current window may have changed since
+      int first = std::max(first_cache_slice_, first_prefetch_slice_);
+      int last = std::min(last_cache_slice_, last_prefetch_slice_);
+      if (first_cache_slice_ >= 0 && first <= last) {
+        vxl_uint_64 slice_size = vxl_uint_64(this->grid_size_.x())*this->grid_size_.y();
+        std::memcpy(reinterpret_cast<T*>(prefetch_mem_->data()) + (first - first_prefetch_slice_)*slice_size,
+                    reinterpret_cast<T*>(cache_mem_->data()) + (first - first_cache_slice_)*slice_size,
+                    std::size_t((last - first + 1)*slice_size*sizeof(T)));
+      }
+      purge_cache();
+      bvxm_memory_chunk_sptr mem = cache_mem_;
+      cache_mem_ = prefetch_mem_;
+      prefetch_mem_ = mem;
+      first_cache_slice_ = first_prefetch_slice_;
+      last_cache_slice_ = last_prefetch_slice_;
+    }
+    else {
+      purge_cache();
+      // a window that ends with the slab when sweeping towards slice 0, starts with it otherwise
+      int start_slice_idx = slice_idx;
+      if (descending_)
+        start_slice_idx = std::max((int)last_slice_idx - (int)n_cache_slices_ + 1, 0);
+      fill_cache(start_slice_idx);
+    }
+    // the window read ahead, if any, was for the old window; prefetch() may not start another
+    first_prefetch_slice_ = -1;
+    last_prefetch_slice_ = -1;
+    prefetch();
     // make sure fill cache was successful
     if ( ((int)slice_idx < first_cache_slice_ ) || ((int)last_slice_idx > last_cache_slice_) ) {
       std::cerr << "error: slices " << slice_idx << "through " << last_slice_idx << " still not in cache after fill.\n";
       bvxm_voxel_slab<T> slab;
       return slab;
     }
-    // fill was successful
-    first_voxel = reinterpret_cast<T*>(cache_mem_->data());
-  }
-  else {
-    // entire slab is already in cache.
-    vxl_uint_64 slice_size = this->grid_size_.x()*this->grid_size_.y();
-    first_voxel = reinterpret_cast<T*>(cache_mem_->data()) + ((slice_idx - first_cache_slice_)*slice_size);
   }
+  // entire slab is in cache.
+  vxl_uint_64 slice_size = this->grid_size_.x()*this->grid_size_.y();
+  first_voxel = reinterpret_cast<T*>(cache_mem_->data()) + ((slice_idx - first_cache_slice_)*slice_size);
   bvxm_voxel_slab<T> slab(this->grid_size_.x(),this->grid_size_.y(), slab_thickness, cache_mem_, first_voxel);
   return slab;
 }
@@ -205,6 +277,100 @@ bool bvxm_voxel_storage_disk_cached<T>::purge_cache()
     return true;
   }
 
+  bool ok = true;
+  if (background_io_) {
+    // hand the window to the I/O thread, and take over the memory of the one it wrote last;
+    // a failure to write that one is reported now
+    ok = io_ok(write_job_);
+    bvxm_memory_chunk_sptr mem = write_mem_;
+    write_mem_ = cache_mem_;
+    cache_mem_ = mem;
+    write_job_ = queue_io(true, reinterpret_cast<char*>(write_mem_->data()), first_cache_slice_, last_cache_slice_);
+  }
+  else {
+    wait_for_io();
+    ok = transfer(true, reinterpret_cast<char*>(cache_mem_->data()), first_cache_slice_, last_cache_slice_);
+  }
+
+  first_cache_slice_ = -1;
+  last_cache_slice_ = -1;
+
+  return ok;
+}
+
+
+template<class T>
+bool bvxm_voxel_storage_disk_cached<T>::fill_cache(unsigned start_slice_idx)
+{
+  unsigned last_slice_idx = start_slice_idx + n_cache_slices_ - 1;
+  if (last_slice_idx >= this->grid_size_.z()) {
+    last_slice_idx = this->grid_size_.z() - 1;
+  }
+  // read after the queued writes, which may hold some of these slices
+  bool ok = true;
+  if (background_io_)
+    ok = io_ok(queue_io(false, reinterpret_cast<char*>(cache_mem_->data()), start_slice_idx, last_slice_idx));
+  else {
+    wait_for_io();
+    ok = transfer(false, reinterpret_cast<char*>(cache_mem_->data()), start_slice_idx, last_slice_idx);
+  }
+  if (!ok)
+    return false;
+
+  first_cache_slice_ = start_slice_idx;
+  last_cache_slice_ = last_slice_idx;
+
+  return true;
+}
+
+
+template<class T>
+void bvxm_voxel_storage_disk_cached<T>::prefetch()
+{
+  if (!background_io_ || first_cache_slice_ < 0)
+    return;
+  // the next window holds the next slab that does not fit in the current one,
+  // so when slabs are thicker than one slice, the windows overlap
+  int overlap = (int)last_thickness_ - 1;
+  int first, last;
+  if (descending_) {
+    if (first_cache_slice_ == 0)
+      return;
+    last = std::min(first_cache_slice_ - 1 + overlap, last_cache_slice_ - 1);
+    first = std::max(last - (int)n_cache_slices_ + 1, 0);
+  }
+  else {
+    if (last_cache_slice_ + 1 >= (int)this->grid_size_.z())
+      return;
+    first = std::max(last_cache_slice_ + 1 - overlap, first_cache_slice_ + 1);
+    last = std::min(first + (int)n_cache_slices_ - 1, (int)this->grid_size_.z() - 1);
+  }
+  // the slices shared with the current window are copied from it when this window is taken
+  prefetch_job_ = queue_io(false, reinterpret_cast<char*>(prefetch_mem_->data()), first, last);
+  first_prefetch_slice_ = first;
+  last_prefetch_slice_ = last;
+}
+
+
+template<class T>
+void bvxm_voxel_storage_disk_cached<T>::use_single_window()
+{
+  std::cout << "bvxm_voxel_storage_disk_cached: switching to a single window of " << n_budget_slices_ << " slices." << std::endl;
+  purge_cache();
+  wait_for_io();
+  background_io_ = false;
+  first_prefetch_slice_ = -1;
+  last_prefetch_slice_ = -1;
+  prefetch_mem_ = 0;
+  write_mem_ = 0;
+  n_cache_slices_ = n_budget_slices_;
+  cache_mem_ = new bvxm_memory_chunk(vxl_int_64(sizeof(T))*this->grid_size_.x()*this->grid_size_.y()*n_cache_slices_);
+}
+
+
+template<class T>
+bool bvxm_voxel_storage_disk_cached<T>::transfer(bool write, char* data, int first, int last)
+{
   // check to see if file is already open
   if (!fio_) {
 #ifdef BVXM_USE_FSTREAM64
@@ -217,7 +383,7 @@ bool bvxm_voxel_storage_disk_cached<T>::purge_cache()
       return false;
     }
   }
-  vil_streampos slice_pos = slab_filepos(first_cache_slice_);
+  vil_streampos slice_pos = slab_filepos(first);
   vil_streampos file_pos = fio_->tell();
   if (slice_pos != file_pos) {
     fio_->seek(slice_pos);
@@ -227,50 +393,96 @@ bool bvxm_voxel_storage_disk_cached<T>::purge_cache()
       return false;
     }
   }
-  vil_streampos write_len = (last_cache_slice_ - first_cache_slice_ + 1)*this->grid_size_.x()*this->grid_size_.y()*sizeof(T);
-  fio_->write(reinterpret_cast<char*>(cache_mem_->data()),write_len);
-
-  first_cache_slice_ = -1;
-  last_cache_slice_ = -1;
+  vil_streampos len = vil_streampos(last - first + 1)*this->grid_size_.x()*this->grid_size_.y()*sizeof(T);
+  vil_streampos n = write ? fio_->write(data,len) : fio_->read(data,len);
+  if (n != len) {
+    std::cerr << "error " << (write ? "writing" : "reading") << " slices " << first << " to " << last
+              << " of " << storage_fname_ << std::endl;
+    return false;
+  }
 
   return true;
 }
 
 
 template<class T>
-bool bvxm_voxel_storage_disk_cached<T>::fill_cache(unsigned start_slice_idx)
+unsigned long bvxm_voxel_storage_disk_cached<T>::queue_io(bool write, char* data, int first, int last)
 {
-  // check to see if file is already open
-  if (!fio_) {
-#ifdef BVXM_USE_FSTREAM64
-    fio_ = new vil_stream_fstream64(storage_fname_.c_str(),"rw");
-#else
-    fio_ = new vil_stream_fstream(storage_fname_.c_str(),"rw");
-#endif
-    if (!fio_->ok()) {
-      std::cerr << "error opening file " << storage_fname_ << " for read/write!\n";
-      return false;
+  io_job job;
+  job.write = write;
+  job.data = data;
+  job.first = first;
+  job.last = last;
+#if VXL_FULLCXX11SUPPORT
+  if (io_thread_.joinable()) {
+    unsigned long n;
+    {
+      std::lock_guard<std::mutex> lock(io_mutex_);
+      io_queue_.push_back(job);
+      n = ++jobs_queued_;
     }
+    io_cond_.notify_all();
+    return n;
   }
-  vil_streampos slice_pos = this->slab_filepos(start_slice_idx);
-  vil_streampos file_pos = fio_->tell();
-  if (slice_pos != file_pos) {
-    fio_->seek(slice_pos);
-  }
-  unsigned last_slice_idx = start_slice_idx + n_cache_slices_ - 1;
-  if (last_slice_idx >= this->grid_size_.z()) {
-    last_slice_idx = this->grid_size_.z() - 1;
-  }
-  vil_streampos slice_size = this->grid_size_.x()*this->grid_size_.y()*sizeof(T);
-  vil_streampos read_size = (last_slice_idx - start_slice_idx + 1)*slice_size;
-  fio_->read(reinterpret_cast<char*>(cache_mem_->data()),read_size);
+#endif
+  jobs_done_ = ++jobs_queued_;
+  if (!transfer(job.write, job.data, job.first, job.last))
+    failed_jobs_.push_back(jobs_queued_);
+  return jobs_queued_;
+}
 
-  first_cache_slice_ = start_slice_idx;
-  last_cache_slice_ = last_slice_idx;
 
-  return true;
+template<class T>
+void bvxm_voxel_storage_disk_cached<T>::wait_for_io(unsigned long job) const
+{
+#if VXL_FULLCXX11SUPPORT
+  std::unique_lock<std::mutex> lock(io_mutex_);
+  while (jobs_done_ < job)
+    io_cond_.wait(lock);
+#else
+  (void)job;
+#endif
 }
 
+
+template<class T>
+bool bvxm_voxel_storage_disk_cached<T>::io_ok(unsigned long job)
+{
+  wait_for_io(job);
+#if VXL_FULLCXX11SUPPORT
+  std::lock_guard<std::mutex> lock(io_mutex_);
+#endif
+  std::vector<unsigned long>::iterator it = std::find(failed_jobs_.begin(), failed_jobs_.end(), job);
+  if (it == failed_jobs_.end())
+    return true;
+  failed_jobs_.erase(it);
+  return false;
+}
+
+
+#if VXL_FULLCXX11SUPPORT
+template<class T>
+void bvxm_voxel_storage_disk_cached<T>::io_loop()
+{
+  std::unique_lock<std::mutex> lock(io_mutex_);
+  while (true) {
+    while (io_queue_.empty() && !io_stop_)
+      io_cond_.wait(lock);
+    if (io_queue_.empty())
+      return;
+    io_job job = io_queue_.front();
+    lock.unlock();
+    bool ok = transfer(job.write, job.data, job.first, job.last);
+    lock.lock();
+    io_queue_.pop_front();
+    if (!ok)
+      failed_jobs_.push_back(jobs_done_ + 1);
+    ++jobs_done_;
+    io_cond_.notify_all();
+  }
+}
+#endif
+
 template <class T>
 void bvxm_voxel_storage_disk_cached<T>::put_slab()
 {
@@ -282,6 +494,8 @@ void bvxm_voxel_storage_disk_cached<T>::put_slab()
 template <class T>
 unsigned bvxm_voxel_storage_disk_cached<T>::num_observations() const
 {
+  // the I/O thread shares the stream
+  wait_for_io();
   // read header from disk
   // check to see if file is already open
   if (!fio_) {
@@ -313,6 +527,8 @@ unsigned bvxm_voxel_storage_disk_cached<T>::num_observations() const
 template <class T>
 void bvxm_voxel_storage_disk_cached<T>::increment_observations()
 {
+  // the I/O thread shares the stream
+  wait_for_io();
   // read header from disk
   // check to see if file is already open
   if (!fio_) {
@@ -357,6 +573,8 @@ void bvxm_voxel_storage_disk_cached<T>::increment_observations()
 template <class T>
 void bvxm_voxel_storage_disk_cached<T>::zero_observations()
 {
+  // the I/O thread shares the stream
+  wait_for_io();
   // read header from disk
   // check to see if file is already open
   if (!fio_) {
@@ -0,0 +1,66 @@
+#ifndef bvxm_voxel_storage_mmap_h_
+#define bvxm_voxel_storage_mmap_h_
+//:
+// \file
+// \brief Voxel storage in a memory mapped file
+//
+// The file has the same format as the files of bvxm_voxel_storage_disk and
+// bvxm_voxel_storage_disk_cached.  It is mapped as a whole, and slabs
+// point straight into the mapping, so no voxels are copied and slabs of
+// any thickness can be used at once; the system reads and writes the
+// pages as they are needed.  This suits grids that fit in the page cache;
+// larger grids are better kept in a bvxm_voxel_storage_disk_cached.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <iostream>
+#include <string>
+#include <vcl_compiler.h>
+#include <vgl/vgl_vector_3d.h>
+
+#include "bvxm_voxel_storage.h"
+#include "bvxm_voxel_storage_disk.h" // for header
+#include "bvxm_memory_chunk.h"
+
+
+//: object for reading and writing voxel data from a memory mapped file.
+template <class T>
+class bvxm_voxel_storage_mmap : public bvxm_voxel_storage<T>
+{
+ public:
+  //: The file is created by initialize_data() if it does not exist yet
+  bvxm_voxel_storage_mmap(std::string storage_filename, vgl_vector_3d<unsigned int> grid_size);
+  //: Constructor from an existing file; the grid size is read from it
+  bvxm_voxel_storage_mmap(std::string storage_filename);
+
+  virtual ~bvxm_voxel_storage_mmap() {}
+
+  virtual bool initialize_data(T const& value);
+  virtual bvxm_voxel_slab<T> get_slab(unsigned slice_idx, unsigned slab_thickness);
+  virtual void put_slab();
+
+  //: return number of observations
+  virtual unsigned num_observations() const;
+  //: increment the number of observations
+  virtual void increment_observations();
+  //: zero the number of observations
+  virtual void zero_observations();
+
+  //: write the modified voxels to the file now, instead of when the system chooses to
+  bool flush();
+
+ private:
+  //: map the file, if it holds a grid of the right size
+  bool map_file();
+  //: the header at the start of the mapping
+  bvxm_voxel_storage_header<T>* header() const;
+
+  std::string storage_fname_;
+
+  //: the mapping of the whole file; 0 until the file exists
+  bvxm_memory_chunk_sptr mem_;
+};
+
+#endif // bvxm_voxel_storage_mmap_h_
@@ -0,0 +1,210 @@
+#ifndef bvxm_voxel_storage_mmap_hxx_
+#define bvxm_voxel_storage_mmap_hxx_
+//:
+// \file
+
+#include <string>
+#include <iostream>
+#include "bvxm_voxel_storage_mmap.h"
+//
+#include <vcl_compiler.h>
+#ifdef BVXM_USE_FSTREAM64
+#include <vil/vil_stream_fstream64.h>
+#else
+#include <vil/vil_stream_fstream.h>
+#endif
+#include <vul/vul_file.h>
+#include <vgl/vgl_vector_3d.h>
+
+#include "bvxm_voxel_storage.h" // base class
+#include "bvxm_voxel_storage_disk.h" // for header
+#include "bvxm_voxel_slab.h"
+#include "bvxm_mmap_memory_chunk.h"
+
+template <class T>
+bvxm_voxel_storage_mmap<T>::bvxm_voxel_storage_mmap(std::string storage_filename, vgl_vector_3d<unsigned int> grid_size)
+: bvxm_voxel_storage<T>(grid_size), storage_fname_(storage_filename), mem_(0)
+{
+  // check if file exists already or not
+  if (vul_file::exists(storage_fname_))  {
+    // make sure filename is not a directory
+    if (vul_file::is_directory(storage_fname_)) {
+      std::cerr << "error: directory name " << storage_fname_ << " passed to bvxm_voxel_storage_mmap constructor.\n";
+      return;
+    }
+    map_file();
+  }
+  else {
+    // file does not yet exist. do nothing for now.
+  }
+}
+
+template <class T>
+bvxm_voxel_storage_mmap<T>::bvxm_voxel_storage_mmap(std::string storage_filename)
+: bvxm_voxel_storage<T>(), storage_fname_(storage_filename), mem_(0)
+{
+  // read the grid size from the header
+#ifdef BVXM_USE_FSTREAM64
+  vil_stream_fstream64 *fis = new vil_stream_fstream64(storage_fname_.c_str(),"r");
+#else
+  vil_stream_fstream *fis = new vil_stream_fstream(storage_fname_.c_str(),"r");
+#endif
+  fis->ref();
+  bvxm_voxel_storage_header<T> header;
+  bool ok = fis->ok() && fis->read(reinterpret_cast<char*>(&header),sizeof(header)) == (vil_streampos)sizeof(header);
+  // this will delete the stream object.
+  fis->unref();
+  if (!ok) {
+    std::cerr << "error: grid file " << storage_fname_ << " passed to bvxm_voxel_storage_mmap can not be read.\n";
+    return;
+  }
+  this->grid_size_ = vgl_vector_3d<unsigned int>(header.nx_, header.ny_, header.nz_);
+  map_file();
+}
+
+
+template <class T>
+bool bvxm_voxel_storage_mmap<T>::map_file()
+{
+  bvxm_mmap_memory_chunk* mem = new bvxm_mmap_memory_chunk(storage_fname_.c_str());
+  mem_ = mem;
+  vxl_uint_64 file_size = sizeof(bvxm_voxel_storage_header<T>) +
+    vxl_uint_64(this->grid_size_.x())*this->grid_size_.y()*this->grid_size_.z()*sizeof(T);
+  if (!mem->is_mapped() || mem->size() != file_size) {
+    // e.g. a file holding only a header, written by bvxm_voxel_storage_disk
+    std::cerr << "error: can not map " << storage_fname_ << " as a grid of size " << this->grid_size_ << std::endl;
+    mem_ = 0;
+    return false;
+  }
+  bvxm_voxel_storage_header<T>* h = header();
+  if ((h->nx_ != this->grid_size_.x()) || (h->ny_ != this->grid_size_.y()) || (h->nz_ != this->grid_size_.z())) {
+    std::cerr << "error: file on disk: " << storage_fname_<< " has size " << vgl_vector_3d<unsigned>(h->nx_,h->ny_,h->nz_) << std::endl
+             << "       size passed to constructor = " << this->grid_size_ << std::endl;
+    mem_ = 0;
+    return false;
+  }
+  return true;
+}
+
+
+template <class T>
+bvxm_voxel_storage_header<T>* bvxm_voxel_storage_mmap<T>::header() const
+{
+  return static_cast<bvxm_voxel_storage_header<T>*>(mem_->const_data());
+}
+
+
+template <class T>
+bool bvxm_voxel_storage_mmap<T>::initialize_data(T const& value)
+{
+  if (!mem_) {
+    // create the file, then map it
+    if (!vul_file::exists(storage_fname_)) {
+      // make sure base directory exists
+      std::string base_dir = vul_file::dirname(storage_fname_);
+      if (!vul_file::is_directory(base_dir)) {
+        std::cerr << "error: base directory " << base_dir << " does not exist.\n";
+        return false;
+      }
+    }
+    else if (vul_file::is_directory(storage_fname_)) {
+      std::cerr << "error: directory name " << storage_fname_ << " passed to bvxm_voxel_storage_mmap constructor.\n";
+      return false;
+    }
+#ifdef BVXM_USE_FSTREAM64
+    vil_stream_fstream64 *fos = new vil_stream_fstream64(storage_fname_.c_str(),"w");
+#else
+    vil_stream_fstream *fos = new vil_stream_fstream(storage_fname_.c_str(),"w");
+#endif
+    fos->ref();
+    if (!fos->ok()) {
+      std::cerr << " error opening file " << storage_fname_ << " for write.\n";
+      fos->unref();
+      return false;
+    }
+    bvxm_voxel_storage_header<T> header(this->grid_size_);
+    fos->write(reinterpret_cast<char*>(&header),sizeof(header));
+    bvxm_voxel_slab<T> init_slab(this->grid_size_.x(),this->grid_size_.y(),1);
+    init_slab.fill(value);
+    for (unsigned z=0; z <this->grid_size_.z(); z++) {
+      fos->write(reinterpret_cast<char*>(init_slab.first_voxel()),init_slab.size()*sizeof(T));
+    }
+    // this will close the file.
+    fos->unref();
+    return map_file();
+  }
+  // fill the mapped file in place
+  header()->nobservations_ = 0;
+  bvxm_voxel_slab<T> slab = get_slab(0, this->grid_size_.z());
+  slab.fill(value);
+  return true;
+}
+
+
+template <class T>
+bvxm_voxel_slab<T> bvxm_voxel_storage_mmap<T>::get_slab(unsigned slice_idx, unsigned slab_thickness)
+{
+  if (slice_idx + slab_thickness > this->grid_size_.z()) {
+    std::cerr << "error: tried to get slab " << slice_idx
+             << " with thickness " << slab_thickness
+             << "; grid_size_.z() = " << this->grid_size_.z() << std::endl;
+    bvxm_voxel_slab<T> slab;
+    return slab;
+  }
+  if (!mem_) {
+    std::cerr << "error: grid file " << storage_fname_ << " is not mapped\n";
+    bvxm_voxel_slab<T> slab;
+    return slab;
+  }
+  vxl_uint_64 slice_size = vxl_uint_64(this->grid_size_.x())*this->grid_size_.y();
+  T* first_voxel = reinterpret_cast<T*>(header() + 1) + slice_idx*slice_size;
+  bvxm_voxel_slab<T> slab(this->grid_size_.x(),this->grid_size_.y(), slab_thickness, mem_, first_voxel);
+  return slab;
+}
+
+
+template <class T>
+void bvxm_voxel_storage_mmap<T>::put_slab()
+{
+  // don't need to do anything here.
+  // the slab is the file's memory
+  return;
+}
+
+
+template <class T>
+unsigned bvxm_voxel_storage_mmap<T>::num_observations() const
+{
+  if (!mem_)
+    return 0;
+  return header()->nobservations_;
+}
+
+
+template <class T>
+void bvxm_voxel_storage_mmap<T>::increment_observations()
+{
+  if (mem_)
+    ++header()->nobservations_;
+}
+
+
+template <class T>
+void bvxm_voxel_storage_mmap<T>::zero_observations()
+{
+  if (mem_)
+    header()->nobservations_ = 0;
+}
+
+
+template <class T>
+bool bvxm_voxel_storage_mmap<T>::flush()
+{
+  bvxm_mmap_memory_chunk* mem = dynamic_cast<bvxm_mmap_memory_chunk*>(mem_.ptr());
+  return mem && mem->flush();
+}
+
+#define BVXM_VOXEL_STORAGE_MMAP_INSTANTIATE(T) \
+  template class bvxm_voxel_storage_mmap<T >
+
+#endif // bvxm_voxel_storage_mmap_hxx_
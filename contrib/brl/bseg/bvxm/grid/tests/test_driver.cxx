@@ -4,6 +4,7 @@ DECLARE( test_voxel_storage_mem );
 DECLARE( test_voxel_storage_slab_mem );
 DECLARE( test_voxel_storage_disk );
 DECLARE( test_voxel_storage_disk_cached );
+DECLARE( test_voxel_storage_mmap );
 DECLARE( test_voxel_grid );
 DECLARE( test_basic_ops );
 DECLARE( test_grid_to_image_stack );
@@ -15,6 +16,7 @@ void register_tests()
   REGISTER( test_voxel_storage_slab_mem );
   REGISTER( test_voxel_storage_disk );
   REGISTER( test_voxel_storage_disk_cached );
+  REGISTER( test_voxel_storage_mmap );
   REGISTER( test_voxel_grid );
   REGISTER( test_basic_ops );
   REGISTER( test_grid_to_image_stack );
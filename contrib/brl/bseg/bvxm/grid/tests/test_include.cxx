@@ -1,6 +1,7 @@
 #include <bvxm/grid/bvxm_voxel_grid_base_sptr.h>
 
 #include <bvxm/grid/bvxm_memory_chunk.h>
+#include <bvxm/grid/bvxm_mmap_memory_chunk.h>
 #include <bvxm/grid/bvxm_opinion.h>
 #include <bvxm/grid/bvxm_voxel_grid.h>
 #include <bvxm/grid/bvxm_voxel_grid_base.h>
@@ -13,5 +14,6 @@
 #include <bvxm/grid/bvxm_voxel_storage_disk.h>
 #include <bvxm/grid/bvxm_voxel_storage_disk_cached.h>
 #include <bvxm/grid/bvxm_voxel_storage_mem.h>
+#include <bvxm/grid/bvxm_voxel_storage_mmap.h>
 
 int main() { return 0; }
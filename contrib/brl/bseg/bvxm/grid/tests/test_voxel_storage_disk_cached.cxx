@@ -6,6 +6,7 @@
 #include <vgl/vgl_vector_3d.h>
 
 #include "../bvxm_voxel_storage.h"
+#include "../bvxm_voxel_storage_disk.h"
 #include "../bvxm_voxel_storage_disk_cached.h"
 #include "../bvxm_voxel_slab.h"
 
@@ -82,6 +83,70 @@ static void test_voxel_storage_disk_cached()
 
   } // end of block, storage should go out of scope here and files should close.
 
+  // sweeps up and down with read-ahead and write-behind: a budget of 12 slices, in 3 windows of 4
+  {
+    unsigned max_cache_size = grid_size.x()*grid_size.y()*12*sizeof(float);
+    bvxm_voxel_storage_disk_cached<float> storage(storage_fname,grid_size,max_cache_size);
+    storage.initialize_data(0.0f);
+    storage.zero_observations();
+
+    // downwards, then upwards in slabs of 3, adding the pass number to every voxel
+    bool sweep_check = true;
+    for (unsigned pass = 1; pass <= 4; ++pass) {
+      for (unsigned n=0; n+2 < storage.nz(); n++) {
+        unsigned i = (pass % 2) ? n : storage.nz() - 3 - n;
+        bvxm_voxel_slab<float> slab = storage.get_slab(i,3);
+        // the middle slice of each slab, so every slice but the first and last is updated once
+        float* v = slab.first_voxel() + slab.nx()*slab.ny();
+        for (unsigned c = 0; c < slab.nx()*slab.ny(); ++c)
+          v[c] += static_cast<float>(pass);
+        storage.put_slab();
+      }
+      storage.increment_observations();
+    }
+    TEST("observations counted between sweeps", storage.num_observations(), 4);
+
+    // a slab thicker than a window switches to a single window
+    bvxm_voxel_slab<float> slab = storage.get_slab(0,10);
+    TEST("slab thicker than a window", slab.nz(), 10);
+    for (unsigned k = 0; k < 10 && slab.nz() == 10; ++k) {
+      float expected = (k == 0) ? 0.0f : 10.0f;
+      if (slab(0,0,k) != expected || slab(299,299,k) != expected)
+        sweep_check = false;
+    }
+    for (unsigned i=10; i < storage.nz(); i++) {
+      bvxm_voxel_slab<float> s = storage.get_slab(i,1);
+      float expected = (i == storage.nz() - 1) ? 0.0f : 10.0f;
+      for (bvxm_voxel_slab<float>::iterator vit = s.begin(); vit != s.end(); ++vit)
+        if (*vit != expected)
+          sweep_check = false;
+    }
+    TEST("Voxel values after sweeps in both directions?",sweep_check,true);
+  }
+
+  // a window read ahead is not used once the slices it holds have been changed in another window
+  {
+    std::string small_fname("bvxm_voxel_storage_cached_test_small.vox");
+    vgl_vector_3d<unsigned> small_size(10,10,10);
+    // a budget of 9 slices, in 3 windows of 3
+    bvxm_voxel_storage_disk_cached<float> storage(small_fname,small_size,small_size.x()*small_size.y()*9*sizeof(float));
+    storage.initialize_data(0.0f);
+    storage.get_slab(5,1);   // slices 5 to 7, reading 8 and 9 ahead
+    bvxm_voxel_slab<float> slab = storage.get_slab(7,3); // slices 7 to 9, at the end: nothing to read ahead
+    slab.fill(1.0f);
+    storage.get_slab(0,1);   // slices 0 to 2, writing 7 to 9
+    slab = storage.get_slab(8,1);
+    TEST("changed slices are not taken from an old read ahead", slab.nz() == 1 && slab(3,4,0) == 1.0f, true);
+  }
+  vul_file::delete_file_glob("bvxm_voxel_storage_cached_test_small.vox");
+
+  // the values reach the file
+  {
+    bvxm_voxel_storage_disk<float> storage(storage_fname,grid_size);
+    bvxm_voxel_slab<float> slab = storage.get_slab(5,1);
+    TEST("values written to disk", slab(7,8) == 10.0f && storage.num_observations() == 4, true);
+  }
+
   // remove temporary file
   vul_file::delete_file_glob(storage_fname.c_str());
 }
@@ -0,0 +1,97 @@
+#include <iostream>
+#include <testlib/testlib_test.h>
+#include <vcl_compiler.h>
+#include <vul/vul_file.h>
+
+#include <vgl/vgl_vector_3d.h>
+
+#include "../bvxm_voxel_storage.h"
+#include "../bvxm_voxel_storage_disk.h"
+#include "../bvxm_voxel_storage_mmap.h"
+#include "../bvxm_voxel_grid.h"
+#include "../bvxm_voxel_slab.h"
+
+
+static void test_voxel_storage_mmap()
+{
+  // we need temporary disk storage for this test.
+  std::string storage_fname("bvxm_voxel_storage_mmap_test_temp.vox");
+  if (vul_file::exists(storage_fname)) // accidentally left from an earlier run
+    vul_file::delete_file_glob(storage_fname);
+  vgl_vector_3d<unsigned> grid_size(200,150,40);
+
+  bool init_check = true;
+  bool write_read_check = true;
+
+  // create block so storage goes out of scope and the file is unmapped at end of tests.
+  {
+    bvxm_voxel_storage_mmap<float> storage(storage_fname,grid_size);
+    TEST("no data before initialization", storage.num_observations(), 0);
+
+    // fill with test data
+    float init_val = 0.5f;
+    TEST("initialize", storage.initialize_data(init_val), true);
+    storage.increment_observations();
+    storage.increment_observations();
+
+    // read in each slice, check that init_val was set, and fill with new value
+    unsigned count = 0;
+    for (unsigned i=0; i < storage.nz(); i++) {
+      bvxm_voxel_slab<float> slab = storage.get_slab(i,1);
+      bvxm_voxel_slab<float>::iterator vit;
+      for (vit = slab.begin(); vit != slab.end(); vit++, count++) {
+        if (*vit != init_val)
+          init_check = false;
+        // write new value
+        *vit = static_cast<float>(count);
+      }
+      storage.put_slab();
+    }
+    TEST("Initialization correctly set voxel values?",init_check,true);
+
+    // slabs of any thickness point into the same memory
+    bvxm_voxel_slab<float> thick = storage.get_slab(3,10);
+    bvxm_voxel_slab<float> thin = storage.get_slab(7,1);
+    TEST("slabs share the mapped file", &thick(4,5,4) == &thin(4,5), true);
+    TEST("flush", storage.flush(), true);
+  }
+
+  // the file can be read by the other disk based storage
+  {
+    bvxm_voxel_storage_disk<float> storage(storage_fname,grid_size);
+    TEST("observations written to the file", storage.num_observations(), 2);
+    unsigned count = 0;
+    for (unsigned i=0; i < storage.nz(); i++) {
+      bvxm_voxel_slab<float> slab = storage.get_slab(i,1);
+      bvxm_voxel_slab<float>::iterator vit;
+      for (vit = slab.begin(); vit != slab.end(); vit++, count++) {
+        if (*vit != static_cast<float>(count))
+          write_read_check = false;
+      }
+    }
+    TEST("Read in voxel values match written values?",write_read_check,true);
+  }
+
+  // a grid in an existing file, its size read from the file
+  {
+    bvxm_voxel_grid<float> grid(new bvxm_voxel_storage_mmap<float>(storage_fname));
+    TEST("grid size read from the file", grid.grid_size(), grid_size);
+    TEST("observations read from the file", grid.num_observations(), 2);
+    bvxm_voxel_grid<float>::iterator slab_it = grid.slab_iterator(39);
+    TEST("values read through the grid", (*slab_it)(199,149), static_cast<float>(200*150*40-1));
+    grid.zero_observations();
+    TEST("initialize in place", grid.initialize_data(1.5f) && (*slab_it)(199,149) == 1.5f, true);
+    TEST("observations zeroed", grid.num_observations(), 0);
+  }
+
+  // a file of the wrong size is not mapped
+  {
+    bvxm_voxel_storage_mmap<float> storage(storage_fname,vgl_vector_3d<unsigned>(200,150,41));
+    TEST("wrong size", storage.get_slab(0,1).nz(), 0);
+  }
+
+  // remove temporary file
+  vul_file::delete_file_glob(storage_fname.c_str());
+}
+
+TESTMAIN( test_voxel_storage_mmap );
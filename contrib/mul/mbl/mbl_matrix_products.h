@@ -24,13 +24,11 @@ void mbl_matrix_product_a_bt(vnl_matrix<double>& ABt,
                              int n_cols);
 
 //: Compute AAt = A * A.transpose(), using only first nr x nc partition of A
-//  Uses symmetry of result to improve speed
 void mbl_matrix_product_a_at(vnl_matrix<double>& AAt,
                              const vnl_matrix<double>& A,
                              unsigned nr, unsigned nc);
 
 //: Compute AAt = A * A.transpose()
-//  Uses symmetry of result to improve speed
 void mbl_matrix_product_a_at(vnl_matrix<double>& AAt,
                              const vnl_matrix<double>& A);
 
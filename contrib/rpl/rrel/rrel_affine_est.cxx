@@ -166,6 +166,25 @@ rrel_affine_est::compute_residuals( const vnl_vector<double>& params,
 }
 
 
+void
+rrel_affine_est::compute_residuals_subset( const vnl_vector<double>& params,
+                                           const std::vector<int>& indices,
+                                           std::vector<double>& residuals ) const
+{
+  const vnl_matrix<double> A=this->A( params );
+  const vnl_vector<double> t=trans( params );
+
+  residuals.resize( indices.size() );
+  vnl_vector<double> diff;
+  for ( unsigned int k=0; k<indices.size(); ++k ) {
+    diff = A*from_pts_[indices[k]];
+    diff += t;
+    diff -= to_pts_[indices[k]];
+    residuals[k] = diff.two_norm();
+  }
+}
+
+
 bool
 rrel_affine_est::
 weighted_least_squares_fit( vnl_vector<double>& params,
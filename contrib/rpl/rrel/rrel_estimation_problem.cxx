@@ -4,6 +4,7 @@
 #include "rrel_estimation_problem.h"
 
 #include <rrel/rrel_wls_obj.h>
+#include <vnl/vnl_vector.h>
 
 #include <vcl_compiler.h>
 #include <vcl_cassert.h>
@@ -57,6 +58,27 @@ rrel_estimation_problem::compute_weights( const std::vector<double>& residuals,
 }
 
 
+void
+rrel_estimation_problem::prepare_subset( const vnl_vector<double>& params,
+                                         vnl_vector<double>& prepared ) const
+{
+  prepared = params;
+}
+
+
+void
+rrel_estimation_problem::compute_residuals_subset( const vnl_vector<double>& prepared,
+                                                   const std::vector<int>& indices,
+                                                   std::vector<double>& residuals ) const
+{
+  std::vector<double> all( num_samples() );
+  compute_residuals( prepared, all );
+  residuals.resize( indices.size() );
+  for ( unsigned int k=0; k<indices.size(); ++k )
+    residuals[k] = all[ indices[k] ];
+}
+
+
 const std::vector<double>&
 rrel_estimation_problem::prior_multiple_scales() const
 {
@@ -103,6 +103,24 @@ class rrel_estimation_problem
   virtual void compute_residuals( const vnl_vector<double>& params,
                                   std::vector<double>& residuals ) const = 0;
 
+  //: Prepare a parameter vector for compute_residuals_subset().
+  // Work that depends only on the parameters (e.g. inverting a
+  // homography) is done here, once per parameter vector, rather than in
+  // each compute_residuals_subset() call.  The default copies params.
+  virtual void prepare_subset( const vnl_vector<double>& params,
+                               vnl_vector<double>& prepared ) const;
+
+  //: Compute the residuals of some of the points.
+  // \p prepared is the result of prepare_subset() for the parameter
+  // vector.  residuals[k] is set to the residual of point indices[k], as
+  // compute_residuals() would give it.  The default computes all the
+  // residuals and picks out those asked for; problems should override it,
+  // since rrel_parallel_ran_sam_search uses it to reject hypotheses after
+  // looking at only a few points.
+  virtual void compute_residuals_subset( const vnl_vector<double>& prepared,
+                                         const std::vector<int>& indices,
+                                         std::vector<double>& residuals ) const;
+
   //: Compute the weights for the given residuals.
   // The residuals are essentially those returned by
   // compute_residuals(). The default behaviour is to apply obj->wgt()
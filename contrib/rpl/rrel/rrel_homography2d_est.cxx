@@ -99,11 +99,12 @@ rrel_homography2d_est :: fit_from_minimal_set( const std::vector<int>& point_ind
   }
 }
 
-void
-rrel_homography2d_est :: compute_residuals( const vnl_vector<double>& params,
-                                            std::vector<double>& residuals ) const
+//: The homography with parameters "params", and its inverse.
+static void
+rrel_homography2d_matrices( const vnl_vector<double>& params,
+                            vnl_matrix<double>& H, vnl_matrix<double>& H_inv )
 {
-  vnl_matrix< double > H(3,3);
+  H.set_size(3,3);
   int r,c;
   for ( r=0; r<3; ++r )
     for ( c=0; c<3; ++c )
@@ -112,32 +113,67 @@ rrel_homography2d_est :: compute_residuals( const vnl_vector<double>& params,
   vnl_svd< double > svd_H( H );
   if ( svd_H.rank() < 3 )
     std::cerr << "rrel_homography2d_est :: compute_residuals  rank(H) < 3!!";
-  vnl_matrix< double > H_inv( svd_H.inverse() );
+  H_inv = svd_H.inverse();
+}
+
+//: The symmetric transfer error of one correspondence.
+static double
+rrel_homography2d_residual( const vnl_matrix<double>& H, const vnl_matrix<double>& H_inv,
+                            const vnl_vector<double>& from_pt, const vnl_vector<double>& to_pt )
+{
+  vnl_vector< double > trans_pt = H * from_pt;
+  vnl_vector< double > inv_trans_pt = H_inv * to_pt;
+
+  if ( from_pt[ 2 ] == 0 || to_pt[ 2 ] == 0
+       || trans_pt[ 2 ] == 0 || inv_trans_pt[ 2 ] == 0 ) {
+    return 1e10;
+  }
+  double del_x = trans_pt[ 0 ] / trans_pt[ 2 ] - to_pt[ 0 ] / to_pt[ 2 ];
+  double del_y = trans_pt[ 1 ] / trans_pt[ 2 ] - to_pt[ 1 ] / to_pt[ 2 ];
+  double inv_del_x = inv_trans_pt[ 0 ] / inv_trans_pt[ 2 ] - from_pt[ 0 ] / from_pt[ 2 ];
+  double inv_del_y = inv_trans_pt[ 1 ] / inv_trans_pt[ 2 ] - from_pt[ 1 ] / from_pt[ 2 ];
+  return std::sqrt( vnl_math::sqr(del_x)     + vnl_math::sqr(del_y)
+                  + vnl_math::sqr(inv_del_x) + vnl_math::sqr(inv_del_y) );
+}
+
+void
+rrel_homography2d_est :: compute_residuals( const vnl_vector<double>& params,
+                                            std::vector<double>& residuals ) const
+{
+  vnl_matrix< double > H, H_inv;
+  rrel_homography2d_matrices( params, H, H_inv );
 
   if ( residuals.size() != from_pts_.size() )
     residuals.resize( from_pts_.size() );
 
-  vnl_vector< double > trans_pt( 3 ), inv_trans_pt( 3 );
-  double del_x, del_y, inv_del_x, inv_del_y;
-
   for ( unsigned int i=0; i<from_pts_.size(); ++i )
-  {
-    trans_pt = H * from_pts_[ i ];
-    inv_trans_pt = H_inv * to_pts_[ i ];
+    residuals[ i ] = rrel_homography2d_residual( H, H_inv, from_pts_[ i ], to_pts_[ i ] );
+}
 
-    if ( from_pts_[ i ][ 2 ] == 0 || to_pts_[ i ][ 2 ] == 0
-         || trans_pt[ 2 ] == 0 || inv_trans_pt[ 2 ] == 0 ) {
-      residuals[ i ] = 1e10;
-    }
-    else {
-      del_x = trans_pt[ 0 ] / trans_pt[ 2 ] - to_pts_[ i ][ 0 ] / to_pts_[ i ][ 2 ];
-      del_y = trans_pt[ 1 ] / trans_pt[ 2 ] - to_pts_[ i ][ 1 ] / to_pts_[ i ][ 2 ];
-      inv_del_x = inv_trans_pt[ 0 ] / inv_trans_pt[ 2 ] - from_pts_[ i ][ 0 ] / from_pts_[ i ][ 2 ];
-      inv_del_y = inv_trans_pt[ 1 ] / inv_trans_pt[ 2 ] - from_pts_[ i ][ 1 ] / from_pts_[ i ][ 2 ];
-      residuals [ i ] = std::sqrt( vnl_math::sqr(del_x)     + vnl_math::sqr(del_y)
-                                + vnl_math::sqr(inv_del_x) + vnl_math::sqr(inv_del_y) );
-    }
-  }
+void
+rrel_homography2d_est :: prepare_subset( const vnl_vector<double>& params,
+                                         vnl_vector<double>& prepared ) const
+{
+  // H and its inverse, row by row
+  vnl_matrix< double > H, H_inv;
+  rrel_homography2d_matrices( params, H, H_inv );
+  prepared.set_size( 18 );
+  prepared.update( vnl_vector<double>( H.data_block(), 9 ), 0 );
+  prepared.update( vnl_vector<double>( H_inv.data_block(), 9 ), 9 );
+}
+
+void
+rrel_homography2d_est :: compute_residuals_subset( const vnl_vector<double>& prepared,
+                                                   const std::vector<int>& indices,
+                                                   std::vector<double>& residuals ) const
+{
+  assert( prepared.size() == 18 );
+  const vnl_matrix< double > H( prepared.data_block(), 3, 3 );
+  const vnl_matrix< double > H_inv( prepared.data_block() + 9, 3, 3 );
+
+  residuals.resize( indices.size() );
+  for ( unsigned int k=0; k<indices.size(); ++k )
+    residuals[ k ] = rrel_homography2d_residual( H, H_inv, from_pts_[ indices[k] ], to_pts_[ indices[k] ] );
 }
 
 
@@ -72,6 +72,15 @@ class rrel_homography2d_est : public rrel_estimation_problem
   void compute_residuals( const vnl_vector<double>& params,
                           std::vector<double>& residuals ) const;
 
+  //: H and its inverse, so that they are computed once per hypothesis.
+  void prepare_subset( const vnl_vector<double>& params,
+                       vnl_vector<double>& prepared ) const;
+
+  //: Compute the residuals of the correspondences with the given indices.
+  void compute_residuals_subset( const vnl_vector<double>& prepared,
+                                 const std::vector<int>& indices,
+                                 std::vector<double>& residuals ) const;
+
   //: Weighted least squares parameter estimate.  The normalized covariance is not yet filled in.
   bool weighted_least_squares_fit( vnl_vector<double>& params,
                                    vnl_matrix<double>& norm_covar,
@@ -127,6 +127,18 @@ rrel_linear_regression::compute_residuals( const vnl_vector<double>& params,
 }
 
 
+void
+rrel_linear_regression::compute_residuals_subset( const vnl_vector<double>& params,
+                                                  const std::vector<int>& indices,
+                                                  std::vector<double>& residuals ) const
+{
+  residuals.resize( indices.size() );
+  for ( unsigned int k=0; k<indices.size(); ++k ) {
+    residuals[k] = rand_vars_[indices[k]] - dot_product( params, ind_vars_[indices[k]] );
+  }
+}
+
+
 bool
 rrel_linear_regression::weighted_least_squares_fit( vnl_vector<double>& params,
                                                     vnl_matrix<double>& norm_covar,
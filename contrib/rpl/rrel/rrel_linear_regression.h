@@ -73,6 +73,11 @@ public:
   void compute_residuals( const vnl_vector<double>& params,
                           std::vector<double>& residuals ) const;
 
+  //: Compute signed fit residuals of the points with the given indices.
+  void compute_residuals_subset( const vnl_vector<double>& params,
+                                 const std::vector<int>& indices,
+                                 std::vector<double>& residuals ) const;
+
   //: \brief Weighted least squares parameter estimate.
   bool weighted_least_squares_fit( vnl_vector<double>& params,
                                    vnl_matrix<double>& norm_covar,
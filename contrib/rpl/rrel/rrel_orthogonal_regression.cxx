@@ -100,6 +100,19 @@ rrel_orthogonal_regression::compute_residuals( const vnl_vector<double>& params,
 }
 
 
+void
+rrel_orthogonal_regression::compute_residuals_subset( const vnl_vector<double>& params,
+                                                      const std::vector<int>& indices,
+                                                      std::vector<double>& residuals ) const
+{
+  vnl_vector<double> norm( params.data_block(), params.size()-1 );
+  residuals.resize( indices.size() );
+  for ( unsigned int k=0; k<indices.size(); ++k ) {
+    residuals[k] = dot_product(norm, vars_.get_row(indices[k]) ) + params[params.size()-1];
+  }
+}
+
+
 // Compute a least-squares fit, using the weights if they are provided.
 // The cofact matrix is not used or set.
 bool
@@ -0,0 +1,288 @@
+// This is rpl/rrel/rrel_parallel_ran_sam_search.cxx
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <cstdlib>
+#include "rrel_parallel_ran_sam_search.h"
+#include <rrel/rrel_objective.h>
+#include <rrel/rrel_estimation_problem.h>
+
+#include <vnl/vnl_vector.h>
+#include <vnl/vnl_random.h>
+#include <vnl/vnl_parallel_for.h>
+
+#include <vcl_compiler.h>
+#include <vcl_cassert.h>
+
+//: Number of points whose residuals are computed at once by the early rejection test.
+static const unsigned int rrel_sprt_block_size = 64;
+
+
+//: Runs the streams [begin, end) of rrel_parallel_ran_sam_search::estimate().
+struct rrel_parallel_ran_sam_search_streams
+{
+  const rrel_parallel_ran_sam_search* search;
+  const rrel_estimation_problem* problem;
+  const rrel_objective* obj_fcn;
+  const std::vector<unsigned long>* seeds;
+  //: Stream t takes samples [(*firsts)[t], (*firsts)[t+1])
+  const std::vector<unsigned int>* firsts;
+  const std::vector<int>* point_order;
+  std::vector<rrel_parallel_ran_sam_search::stream_result>* results;
+
+  void operator()( unsigned int begin, unsigned int end ) const
+  {
+    for ( unsigned int t = begin; t < end; ++t )
+      search->run_stream( problem, obj_fcn, (*seeds)[t], (*firsts)[t],
+                          (*firsts)[t+1] - (*firsts)[t], *point_order, (*results)[t] );
+  }
+};
+
+
+rrel_parallel_ran_sam_search::rrel_parallel_ran_sam_search( )
+  : rrel_ran_sam_search( ),
+    num_streams_( 0 ),
+    early_rejection_( false ),
+    inlier_threshold_( 0 ), inlier_frac_( 0.5 ), bad_consistent_frac_( 0.05 ), fit_cost_( 200 ),
+    sprt_threshold_( 0 ),
+    samples_rejected_( 0 )
+{
+}
+
+rrel_parallel_ran_sam_search::rrel_parallel_ran_sam_search( int seed )
+  : rrel_ran_sam_search( seed ),
+    num_streams_( 0 ),
+    early_rejection_( false ),
+    inlier_threshold_( 0 ), inlier_frac_( 0.5 ), bad_consistent_frac_( 0.05 ), fit_cost_( 200 ),
+    sprt_threshold_( 0 ),
+    samples_rejected_( 0 )
+{
+}
+
+
+// ------------------------------------------------------------
+void
+rrel_parallel_ran_sam_search::set_early_rejection( double inlier_threshold,
+                                                   double inlier_frac,
+                                                   double bad_consistent_frac,
+                                                   double fit_cost )
+{
+  if ( !( 0 < bad_consistent_frac && bad_consistent_frac < inlier_frac && inlier_frac < 1 ) ) {
+    std::cerr << "rrel_parallel_ran_sam_search::set_early_rejection: need "
+             << "0 < bad_consistent_frac < inlier_frac < 1.  Early rejection disabled.\n";
+    early_rejection_ = false;
+    return;
+  }
+  early_rejection_ = true;
+  inlier_threshold_ = inlier_threshold;
+  inlier_frac_ = inlier_frac;
+  bad_consistent_frac_ = bad_consistent_frac;
+  fit_cost_ = fit_cost;
+
+  //  The threshold A minimising the expected time per hypothesis solves
+  //  A = fit_cost * C + 1 + log(A), where C is the Kullback-Leibler
+  //  divergence between the two Bernoulli distributions (Matas and Chum).
+  const double eps = inlier_frac_, delta = bad_consistent_frac_;
+  const double C = (1-delta) * std::log( (1-delta)/(1-eps) ) + delta * std::log( delta/eps );
+  const double A0 = fit_cost_ * C + 1;
+  double A = A0;
+  for ( unsigned int i = 0; i < 100; ++i ) {
+    const double next = A0 + std::log( A );
+    if ( std::abs( next - A ) < 1e-9 * A )
+      break;
+    A = next;
+  }
+  sprt_threshold_ = A;
+}
+
+
+// ------------------------------------------------------------
+bool
+rrel_parallel_ran_sam_search::estimate( const rrel_estimation_problem * problem,
+                                        const rrel_objective * obj_fcn )
+{
+  this->calc_num_samples( problem );
+  samples_rejected_ = 0;
+
+  if ( obj_fcn->requires_prior_scale() &&
+       problem->scale_type() == rrel_estimation_problem::NONE )
+  {
+    std::cerr << "ran_sam::estimate: Objective function requires a prior scale,"
+             << " and the problem does not provide one.\n"
+             << "                   Aborting estimation.\n";
+    return false;
+  }
+
+  scale_ = -1;
+  unsigned int num_streams = num_streams_ ? num_streams_ : vnl_parallel::max_threads();
+  if ( num_streams > samples_to_take_ )
+    num_streams = samples_to_take_ > 0 ? samples_to_take_ : 1;
+
+  //  Everything random is drawn from the search's generator here, in a
+  //  fixed order, so that the streams are independent of thread timing.
+  const unsigned int num_points = problem->num_samples();
+  std::vector<int> point_order;
+  if ( early_rejection_ ) {
+    point_order.resize( num_points );
+    for ( unsigned int i = 0; i < num_points; ++i )
+      point_order[i] = i;
+    for ( unsigned int i = num_points; i > 1; --i )
+      std::swap( point_order[i-1], point_order[ generator_->lrand32( 0, i-1 ) ] );
+  }
+  std::vector<unsigned long> seeds( num_streams );
+  std::vector<unsigned int> firsts( num_streams+1 );
+  for ( unsigned int t = 0; t < num_streams; ++t ) {
+    seeds[t] = generator_->lrand32();
+    firsts[t] = samples_to_take_ / num_streams * t + samples_to_take_ % num_streams * t / num_streams;
+  }
+  firsts[num_streams] = samples_to_take_;
+
+  std::vector<stream_result> results( num_streams );
+  rrel_parallel_ran_sam_search_streams streams = { this, problem, obj_fcn, &seeds, &firsts,
+                                                   &point_order, &results };
+  vnl_parallel_for( 0u, num_streams, streams, 1u );
+
+  //  Equally good hypotheses are resolved in favour of the earlier stream.
+  int best = -1;
+  for ( unsigned int t = 0; t < num_streams; ++t ) {
+    samples_rejected_ += results[t].rejected;
+    if ( results[t].found && ( best < 0 || results[t].obj < results[best].obj ) )
+      best = int(t);
+  }
+  if ( best < 0 )
+    return false;
+
+  min_obj_ = results[best].obj;
+  params_ = results[best].params;
+  indices_ = results[best].indices;
+  residuals_.resize( num_points );
+  problem->compute_residuals( params_, residuals_ );
+
+  return this->estimate_scale( problem, obj_fcn );
+}
+
+
+// ------------------------------------------------------------
+void
+rrel_parallel_ran_sam_search::run_stream( const rrel_estimation_problem* problem,
+                                          const rrel_objective* obj_fcn,
+                                          unsigned long seed,
+                                          unsigned int first,
+                                          unsigned int count,
+                                          const std::vector<int>& point_order,
+                                          stream_result& result ) const
+{
+  vnl_random generator( seed );
+  const unsigned int points_per = problem->num_samples_to_instantiate();
+  const unsigned int num_points = problem->num_samples();
+  std::vector<int> point_indices( points_per );
+  vnl_vector<double> new_params;
+  std::vector<double> residuals( num_points );
+  result.found = false;
+  result.obj = 0.0;
+  result.rejected = 0;
+
+  for ( unsigned int s = 0; s < count; ++s ) {
+    if ( generate_all_ ) {
+      if ( s == 0 )
+        nth_combination( first, num_points, point_indices, points_per );
+      else {
+        //  The next subset in lexicographic order.
+        unsigned int i=points_per-1;
+        unsigned int k=num_points-1;
+        while ( point_indices[i] == (int)k ) { --i; --k; }
+        k = ++ point_indices[i];
+        for ( ++k, ++i; i<points_per; ++i, ++k )
+          point_indices[i]=k;
+      }
+    }
+    else
+      draw_random_sample( generator, num_points, point_indices, points_per );
+
+    if ( !problem->fit_from_minimal_set( point_indices, new_params ) )
+      continue;
+    if ( early_rejection_ && !passes_sprt( problem, new_params, point_order ) ) {
+      ++result.rejected;
+      continue;
+    }
+
+    problem->compute_residuals( new_params, residuals );
+    double new_obj = 0.0;
+    switch ( problem->scale_type() ) {
+     case rrel_estimation_problem::NONE:
+      new_obj = obj_fcn->fcn( residuals.begin(), residuals.end(), -1.0, &new_params );
+      break;
+     case rrel_estimation_problem::SINGLE:
+      new_obj = obj_fcn->fcn( residuals.begin(), residuals.end(), problem->prior_scale(), &new_params );
+      break;
+     case rrel_estimation_problem::MULTIPLE:
+      new_obj = obj_fcn->fcn( residuals.begin(), residuals.end(), problem->prior_multiple_scales().begin(), &new_params );
+      break;
+     default:
+      std::cerr << __FILE__ << ": unknown scale type\n";
+      std::abort();
+    }
+    if ( !result.found || new_obj < result.obj ) {
+      result.found = true;
+      result.obj = new_obj;
+      result.params = new_params;
+      result.indices = point_indices;
+    }
+  }
+}
+
+
+// ------------------------------------------------------------
+bool
+rrel_parallel_ran_sam_search::passes_sprt( const rrel_estimation_problem* problem,
+                                           const vnl_vector<double>& params,
+                                           const std::vector<int>& point_order ) const
+{
+  const double log_consistent = std::log( bad_consistent_frac_ / inlier_frac_ );
+  const double log_inconsistent = std::log( (1-bad_consistent_frac_) / (1-inlier_frac_) );
+  const double log_threshold = std::log( sprt_threshold_ );
+  double log_ratio = 0.0;
+  std::vector<int> block;
+  std::vector<double> residuals;
+  vnl_vector<double> prepared;
+  problem->prepare_subset( params, prepared );
+  for ( unsigned int b = 0; b < point_order.size(); b += rrel_sprt_block_size ) {
+    const unsigned int e = b + rrel_sprt_block_size < point_order.size() ?
+                           b + rrel_sprt_block_size : (unsigned int)point_order.size();
+    block.assign( point_order.begin() + b, point_order.begin() + e );
+    problem->compute_residuals_subset( prepared, block, residuals );
+    for ( unsigned int k = 0; k < residuals.size(); ++k ) {
+      log_ratio += std::abs( residuals[k] ) <= inlier_threshold_ ? log_consistent : log_inconsistent;
+      if ( log_ratio > log_threshold )
+        return false;
+    }
+  }
+  return true;
+}
+
+
+// ------------------------------------------------------------
+void
+rrel_parallel_ran_sam_search::nth_combination( unsigned int taken,
+                                               unsigned int num_points,
+                                               std::vector<int>& sample,
+                                               unsigned int points_per_sample )
+{
+  assert( sample.size() == points_per_sample );
+  unsigned long rank = taken;
+  unsigned int x = 0;
+  for ( unsigned int i = 0; i < points_per_sample; ++i ) {
+    while ( true ) {
+      //  The number of subsets whose i-th element is x: C(num_points-x-1, points_per_sample-i-1)
+      const unsigned int n = num_points - x - 1, k = points_per_sample - i - 1;
+      unsigned long c = 1;
+      for ( unsigned int j = 1; j <= k; ++j )
+        c = c * ( n - k + j ) / j;
+      if ( rank < c )
+        break;
+      rank -= c;
+      ++x;
+    }
+    sample[i] = x++;
+  }
+}
@@ -0,0 +1,128 @@
+#ifndef rrel_parallel_ran_sam_search_h_
+#define rrel_parallel_ran_sam_search_h_
+//:
+// \file
+// \brief Random sampling search with concurrent hypothesis scoring and early rejection
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <vector>
+#include <rrel/rrel_ran_sam_search.h>
+#include <vcl_compiler.h>
+
+//: Random sampling search with concurrent hypothesis scoring and early rejection.
+//  The samples are split into a number of streams, each with its own
+//  random number generator seeded from the search's generator, and the
+//  streams are run concurrently by vnl_parallel_for.  Within a stream,
+//  and then across streams, the first of equally good hypotheses wins.
+//  The result therefore only depends on the seed and the number of
+//  streams (by default vnl_parallel::max_threads()), not on the timing
+//  of the threads.
+//
+//  The estimation problem and objective function are used from several
+//  threads at once, so their const member functions must be safe to call
+//  concurrently, as they are for the problems and objectives in rrel.
+//
+//  With set_early_rejection(), each hypothesis is first tested by Wald's
+//  sequential probability ratio test (Matas and Chum, "Randomized RANSAC
+//  with sequential probability ratio test", ICCV 2005).  Points, in a
+//  fixed random order, are classified as consistent with the hypothesis
+//  or not, and the hypothesis is rejected as soon as the likelihood ratio
+//  of "bad" to "good" exceeds a threshold chosen to minimise the expected
+//  running time.  Only hypotheses that pass are scored by the objective
+//  function.  The points are looked at in blocks through
+//  rrel_estimation_problem::compute_residuals_subset(), with the
+//  hypothesis prepared once by prepare_subset().  A good hypothesis
+//  is rejected with probability of about 1/threshold, so this is a trade
+//  of a small chance of a slightly worse answer for a large speed up.
+//
+//  Trace output is not produced by this class.
+
+class rrel_parallel_ran_sam_search : public rrel_ran_sam_search
+{
+ public:
+  //: Constructor using a non-deterministic random-sampling seed.
+  rrel_parallel_ran_sam_search( );
+
+  //: Constructor using a given random-sampling seed.
+  rrel_parallel_ran_sam_search( int seed );
+
+  //: Set the number of streams the samples are split into; 0 means vnl_parallel::max_threads().
+  void set_num_streams( unsigned int n ) { num_streams_ = n; }
+
+  //: The number of streams the samples are split into; 0 means vnl_parallel::max_threads().
+  unsigned int num_streams() const { return num_streams_; }
+
+  //: Reject hypotheses early by a sequential probability ratio test.
+  //  A point is consistent with a hypothesis if the absolute value of
+  //  its residual is at most \a inlier_threshold.  \a inlier_frac is the
+  //  (smallest expected) fraction of points consistent with a good
+  //  hypothesis, and \a bad_consistent_frac the fraction consistent with
+  //  a bad one.  \a fit_cost is the time to generate a hypothesis, in
+  //  units of the time to compute one residual.
+  void set_early_rejection( double inlier_threshold,
+                            double inlier_frac = 0.5,
+                            double bad_consistent_frac = 0.05,
+                            double fit_cost = 200.0 );
+
+  //: Score every hypothesis in full (the default).
+  void set_no_early_rejection() { early_rejection_ = false; }
+
+  //: \brief Estimation for an "ordinary" estimation problem.
+  virtual bool
+  estimate( const rrel_estimation_problem* problem,
+            const rrel_objective* obj_fcn );
+
+  //: The number of hypotheses rejected early in the last call to estimate().
+  unsigned int samples_rejected() const { return samples_rejected_; }
+
+  //: The SPRT decision threshold used by early rejection.
+  double sprt_threshold() const { return sprt_threshold_; }
+
+  //: The best hypothesis found by one stream (internal use).
+  struct stream_result
+  {
+    bool found;
+    double obj;
+    vnl_vector<double> params;
+    std::vector<int> indices;
+    unsigned int rejected;
+  };
+
+ protected:
+  //: Fill in "sample" with sample number "taken" of all C(num_points, points_per_sample) in lexicographic order.
+  static void
+  nth_combination( unsigned int taken, unsigned int num_points, std::vector<int>& sample,
+                   unsigned int points_per_sample );
+
+  //: Score the samples [first, first+count) of one stream.
+  void
+  run_stream( const rrel_estimation_problem* problem,
+              const rrel_objective* obj_fcn,
+              unsigned long seed,
+              unsigned int first,
+              unsigned int count,
+              const std::vector<int>& point_order,
+              stream_result& result ) const;
+
+  //: Return true if the hypothesis "params" passes the sequential probability ratio test.
+  bool
+  passes_sprt( const rrel_estimation_problem* problem,
+               const vnl_vector<double>& params,
+               const std::vector<int>& point_order ) const;
+
+  unsigned int num_streams_;
+  bool early_rejection_;
+  double inlier_threshold_;
+  double inlier_frac_;
+  double bad_consistent_frac_;
+  double fit_cost_;
+  double sprt_threshold_;
+  unsigned int samples_rejected_;
+
+  friend struct rrel_parallel_ran_sam_search_streams;
+};
+
+#endif // rrel_parallel_ran_sam_search_h_
@@ -186,6 +186,28 @@ rrel_quad_est::compute_residuals( const vnl_vector<double>& params,
 }
 
 
+void
+rrel_quad_est::compute_residuals_subset( const vnl_vector<double>& params,
+                                         const std::vector<int>& indices,
+                                         std::vector<double>& residuals ) const
+{
+  vnl_matrix<double> A( dim_, min_num_pts_ );
+  for ( unsigned ind=0,i=0; i<min_num_pts_; ++i )
+    for ( unsigned j=0; j<dim_; ++j )
+      A(j, i) = params(ind++);  // filling it column first
+
+  residuals.resize( indices.size() );
+  vnl_vector<double> diff;
+  vnl_vector<double> expanded( min_num_pts_, 0.0 );
+  for ( unsigned int k=0; k<indices.size(); ++k ) {
+    expand_quad( from_pts_[indices[k]], expanded );
+    diff = A * expanded;
+    diff -= to_pts_[indices[k]];
+    residuals[k] = diff.two_norm();
+  }
+}
+
+
 bool
 rrel_quad_est::
 weighted_least_squares_fit( vnl_vector<double>& params,
@@ -162,6 +162,16 @@ rrel_ran_sam_search::estimate( const rrel_estimation_problem * problem,
   //
   // Estimation succeeded.  Now, estimate scale and then return.
   //
+  return this->estimate_scale( problem, obj_fcn );
+}
+
+
+// ------------------------------------------------------------
+bool
+rrel_ran_sam_search::estimate_scale( const rrel_estimation_problem * problem,
+                                     const rrel_objective * obj_fcn )
+{
+  std::vector<double> residuals( problem->num_samples() );
   problem->compute_residuals( params_, residuals );
   if ( trace_level_ >= 1)
     std::cout << "\nOptimum fit = " << params_ << std::endl;
@@ -246,32 +256,42 @@ rrel_ran_sam_search::next_sample( unsigned int taken,
   }
 
   else {
-    if ( num_points == 1 ) {
-      sample[0] = 0;
-    } else {
-      unsigned int k=0, counter=0;
-      while ( k<points_per_sample ) // This might be an infinite loop!
+    draw_random_sample( *generator_, num_points, sample, points_per_sample );
+  }
+}
+
+// ------------------------------------------------------------
+void
+rrel_ran_sam_search::draw_random_sample( vnl_random& generator,
+                                         unsigned int num_points,
+                                         std::vector<int>& sample,
+                                         unsigned int points_per_sample )
+{
+  if ( num_points == 1 ) {
+    sample[0] = 0;
+  } else {
+    unsigned int k=0, counter=0;
+    while ( k<points_per_sample ) // This might be an infinite loop!
+    {
+      int id = generator.lrand32( 0, num_points-1 );
+      if ( id >= int(num_points) ) {   //  safety check
+        std::cerr << "rrel_ran_sam_search::next_sample --- "
+                 << "WARNING: random value out of range\n";
+      }
+      else
       {
-        int id = generator_->lrand32( 0, num_points-1 );
-        if ( id >= int(num_points) ) {   //  safety check
-          std::cerr << "rrel_ran_sam_search::next_sample --- "
-                   << "WARNING: random value out of range\n";
-        }
-        else
+        ++counter;
+        bool different = true;
+        for ( int i=k-1; i>=0 && different; --i )
+          different = (id != sample[i]);
+        if ( different )
+          sample[k++] = id, counter = 0;
+        else if (counter > 100)
         {
-          ++counter;
-          bool different = true;
-          for ( int i=k-1; i>=0 && different; --i )
-            different = (id != sample[i]);
-          if ( different )
-            sample[k++] = id, counter = 0;
-          else if (counter > 100)
-          {
-            std::cerr << "rrel_ran_sam_search::next_sample --- WARNING: "
-                     << "lrand32() generated 100x the same value "<< id
-                     << " from the range [0," << num_points-1 << "]\n";
-            sample[k++] = id+1;
-          }
+          std::cerr << "rrel_ran_sam_search::next_sample --- WARNING: "
+                   << "lrand32() generated 100x the same value "<< id
+                   << " from the range [0," << num_points-1 << "]\n";
+          sample[k++] = id+1;
         }
       }
     }
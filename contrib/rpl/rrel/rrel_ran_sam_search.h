@@ -114,6 +114,16 @@ class rrel_ran_sam_search
   next_sample( unsigned int taken, unsigned int num_points, std::vector<int>& sample,
                unsigned int points_per_sample );
 
+  //: Fill in "sample" with distinct random indices in [0,num_points), drawn from "generator".
+  static void
+  draw_random_sample( vnl_random& generator, unsigned int num_points, std::vector<int>& sample,
+                      unsigned int points_per_sample );
+
+  //: Estimate the scale from the residuals of params_, once params_ is set.
+  bool
+  estimate_scale( const rrel_estimation_problem* problem,
+                  const rrel_objective* obj_fcn );
+
  private:
 
   void trace_sample( const std::vector<int>& point_indices ) const;
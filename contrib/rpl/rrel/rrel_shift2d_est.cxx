@@ -83,6 +83,22 @@ rrel_shift2d_est::compute_residuals(
   }
 }
 
+void
+rrel_shift2d_est::compute_residuals_subset(
+    const vnl_vector<double>& params,
+    const std::vector<int>& indices,
+    std::vector<double>& residuals ) const
+{
+  assert (2 == params.size() );
+  residuals.resize( indices.size() );
+
+  for (unsigned k=0; k<indices.size(); k++) {
+      double del_x = del_pts_[indices[k]][0] - params[0];
+      double del_y = del_pts_[indices[k]][1] - params[1];
+      residuals[k] = std::sqrt( vnl_math::sqr(del_x) + vnl_math::sqr(del_y) );
+  }
+}
+
 bool
 rrel_shift2d_est::weighted_least_squares_fit(
     vnl_vector<double>& params,
@@ -107,6 +107,17 @@ similarity_from_matches::compute_residuals( const vnl_vector<double>& params,
 }
 
 
+void
+similarity_from_matches::compute_residuals_subset( const vnl_vector<double>& params,
+                                                   const std::vector<int>& indices,
+                                                   std::vector<double>& residuals ) const
+{
+  residuals.resize( indices.size() );
+  for ( unsigned int k =0; k<indices.size(); ++k )
+    residuals[k] = calc_residual( params, matches_[indices[k]] );
+}
+
+
 void
 similarity_from_matches::compute_weights( const std::vector<double>& residuals,
                                           const rrel_wls_obj* obj,
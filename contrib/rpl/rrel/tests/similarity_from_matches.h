@@ -49,6 +49,9 @@ class similarity_from_matches : public rrel_estimation_problem
                                      vnl_vector<double>& params ) const;
   virtual void compute_residuals( const vnl_vector<double>& params,
                                   std::vector<double>& residuals ) const;
+  virtual void compute_residuals_subset( const vnl_vector<double>& params,
+                                         const std::vector<int>& indices,
+                                         std::vector<double>& residuals ) const;
   virtual void compute_weights( const std::vector<double>& residuals,
                                 const rrel_wls_obj* obj,
                                 double scale,
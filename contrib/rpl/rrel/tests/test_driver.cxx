@@ -11,6 +11,7 @@ DECLARE( test_linear_reg );
 DECLARE( test_lms_lts );
 DECLARE( test_m_est_obj );
 DECLARE( test_orthogonal_regression );
+DECLARE( test_parallel_ran_sam_search );
 DECLARE( test_ran_sam_search );
 DECLARE( test_ransac_obj );
 DECLARE( test_robust_util );
@@ -27,6 +28,7 @@ register_tests()
   REGISTER( test_lms_lts );
   REGISTER( test_m_est_obj );
   REGISTER( test_orthogonal_regression );
+  REGISTER( test_parallel_ran_sam_search );
   REGISTER( test_ran_sam_search );
   REGISTER( test_ransac_obj );
   REGISTER( test_robust_util );
@@ -0,0 +1,211 @@
+// This is rpl/rrel/tests/test_parallel_ran_sam_search.cxx
+#include <iostream>
+#include <vector>
+#include <vcl_compiler.h>
+
+#include <vnl/vnl_double_3.h>
+#include <vnl/vnl_math.h>
+#include <vnl/vnl_random.h>
+#include <vnl/vnl_parallel_for.h>
+
+#include <vgl/vgl_homg_point_2d.h>
+
+#include <rrel/rrel_linear_regression.h>
+#include <rrel/rrel_affine_est.h>
+#include <rrel/rrel_quad_est.h>
+#include <rrel/rrel_shift2d_est.h>
+#include <rrel/rrel_homography2d_est.h>
+#include <rrel/rrel_orthogonal_regression.h>
+#include <rrel/rrel_lms_obj.h>
+#include <rrel/rrel_trunc_quad_obj.h>
+#include <rrel/rrel_ran_sam_search.h>
+#include <rrel/rrel_parallel_ran_sam_search.h>
+
+#include <testlib/testlib_test.h>
+
+//: Points on the plane z = a0 + a1 x + a2 y, with small noise, of which a fraction are gross outliers.
+static std::vector< vnl_vector<double> >
+plane_points( const vnl_double_3& a, unsigned int num_pts, double outlier_frac, unsigned long seed )
+{
+  vnl_random rand( seed );
+  std::vector< vnl_vector<double> > pts( num_pts );
+  for ( unsigned int i=0; i<num_pts; ++i ) {
+    double x = rand.drand64( -10, 10 ), y = rand.drand64( -10, 10 );
+    double z = a[0] + a[1]*x + a[2]*y + rand.normal() * 0.01;
+    if ( i < outlier_frac * num_pts )
+      z += rand.drand64( 2, 20 ) * ( rand.drand32() < 0.5 ? -1 : 1 );
+    pts[i] = vnl_double_3( x, y, z ).as_vector();
+  }
+  return pts;
+}
+
+static bool
+close_to( const vnl_vector<double>& est, const vnl_double_3& a )
+{
+  return est.size() == 3 &&
+         vnl_math::abs( est[0] - a[0] ) < 0.05 &&
+         vnl_math::abs( est[1] - a[1] ) < 0.01 &&
+         vnl_math::abs( est[2] - a[2] ) < 0.01;
+}
+
+//: True if compute_residuals_subset, after prepare_subset, gives the residuals of compute_residuals.
+// The parameters are fitted to the first few points.
+static bool
+subset_agrees( const rrel_estimation_problem& problem )
+{
+  std::vector<int> fit( problem.num_samples_to_instantiate() );
+  for ( unsigned int k=0; k<fit.size(); ++k )
+    fit[k] = int(k);
+  vnl_vector<double> params, prepared;
+  if ( !problem.fit_from_minimal_set( fit, params ) )
+    return false;
+  const int n = int(problem.num_samples());
+  std::vector<double> all( n ), some;
+  problem.compute_residuals( params, all );
+  std::vector<int> idx;
+  idx.push_back( n-1 ); idx.push_back( 0 ); idx.push_back( n/2 ); idx.push_back( n-1 );
+  problem.prepare_subset( params, prepared );
+  problem.compute_residuals_subset( prepared, idx, some );
+  return some.size() == 4 && some[0] == all[n-1] && some[1] == all[0] &&
+         some[2] == all[n/2] && some[3] == all[n-1];
+}
+
+static void test_parallel_ran_sam_search()
+{
+  vnl_double_3 true_params( 10.0, 0.5, -0.3 );
+  std::vector< vnl_vector<double> > pts = plane_points( true_params, 300, 0.4, 1234 );
+  rrel_linear_regression lr( pts, /*use_intercept=*/ true );
+  lr.set_prior_scale( 0.01 );
+  rrel_trunc_quad_obj obj( 2.5 );
+  rrel_lms_obj lms( lr.num_samples_to_instantiate() );
+
+  // compute_residuals_subset agrees with compute_residuals
+  {
+    vnl_vector<double> params = true_params.as_vector();
+    std::vector<double> all( pts.size() ), some;
+    lr.compute_residuals( params, all );
+    std::vector<int> idx;
+    idx.push_back( 7 ); idx.push_back( 0 ); idx.push_back( 299 ); idx.push_back( 7 );
+    vnl_vector<double> prepared;
+    lr.prepare_subset( params, prepared );
+    lr.compute_residuals_subset( prepared, idx, some );
+    TEST("compute_residuals_subset", some.size() == 4 && some[0] == all[7] && some[1] == all[0] &&
+                                     some[2] == all[299] && some[3] == all[7], true);
+  }
+
+  // and so it does for the other problems
+  {
+    vnl_random rand( 99 );
+    std::vector< vnl_vector<double> > from, to;
+    std::vector< vgl_homg_point_2d<double> > homg_from, homg_to;
+    for ( unsigned int i=0; i<40; ++i ) {
+      double x = rand.drand64( -10, 10 ), y = rand.drand64( -10, 10 );
+      double u = 1.1*x - 0.2*y + 3 + rand.normal(), v = 0.1*x + 0.9*y - 1 + rand.normal();
+      vnl_vector<double> p( 2 ), q( 2 );
+      p[0] = x; p[1] = y; q[0] = u; q[1] = v;
+      from.push_back( p );
+      to.push_back( q );
+      homg_from.push_back( vgl_homg_point_2d<double>( x, y ) );
+      homg_to.push_back( vgl_homg_point_2d<double>( u, v ) );
+    }
+    TEST("compute_residuals_subset, affine", subset_agrees( rrel_affine_est( from, to ) ), true);
+    TEST("compute_residuals_subset, quadratic", subset_agrees( rrel_quad_est( from, to ) ), true);
+    TEST("compute_residuals_subset, shift", subset_agrees( rrel_shift2d_est( homg_from, homg_to ) ), true);
+    TEST("compute_residuals_subset, homography",
+         subset_agrees( rrel_homography2d_est( homg_from, homg_to ) ), true);
+    TEST("compute_residuals_subset, orthogonal regression",
+         subset_agrees( rrel_orthogonal_regression( pts ) ), true);
+  }
+
+  const unsigned int saved_threads = vnl_parallel::max_threads();
+
+  // The result depends on the seed and the number of streams, not on the threads
+  {
+    vnl_parallel::set_max_threads( 1 );
+    rrel_parallel_ran_sam_search one( 42 );
+    one.set_num_streams( 4 );
+    TEST("estimate, one thread", one.estimate( &lr, &obj ), true);
+
+    vnl_parallel::set_max_threads( 4 );
+    rrel_parallel_ran_sam_search four( 42 );
+    four.set_num_streams( 4 );
+    TEST("estimate, four threads", four.estimate( &lr, &obj ), true);
+
+    std::cout << "estimate = " << four.params() << ", scale = " << four.scale()
+             << ", samples = " << four.samples_tested() << '\n';
+    TEST("accurate estimate", close_to( four.params(), true_params ), true);
+    TEST("same result for any number of threads",
+         one.params() == four.params() && one.index() == four.index() &&
+         one.scale() == four.scale() && one.residuals() == four.residuals(), true);
+
+    rrel_parallel_ran_sam_search again( 42 );
+    again.set_num_streams( 4 );
+    again.estimate( &lr, &obj );
+    TEST("same result for the same seed", again.params() == four.params(), true);
+
+    rrel_parallel_ran_sam_search lms_search( 7 );
+    TEST("estimate with lms", lms_search.estimate( &lr, &lms ), true);
+    TEST("accurate lms estimate", close_to( lms_search.params(), true_params ), true);
+  }
+
+  // Generating all samples finds the same, first, best sample as the serial search
+  {
+    std::vector< vnl_vector<double> > few = plane_points( true_params, 14, 0.3, 99 );
+    rrel_linear_regression few_lr( few, true );
+    few_lr.set_prior_scale( 0.01 );
+
+    rrel_ran_sam_search serial( 1 );
+    serial.set_gen_all_samples();
+    serial.estimate( &few_lr, &obj );
+
+    bool same = true;
+    for ( unsigned int streams = 1; streams <= 7; streams += 3 ) {
+      rrel_parallel_ran_sam_search all( 1 );
+      all.set_gen_all_samples();
+      all.set_num_streams( streams );
+      same = all.estimate( &few_lr, &obj ) && all.samples_tested() == serial.samples_tested() &&
+             all.index() == serial.index() && all.params() == serial.params() && same;
+    }
+    TEST("generate all samples matches the serial search", same, true);
+    TEST("number of samples", serial.samples_tested(), 364);
+
+    rrel_parallel_ran_sam_search many( 1 );
+    many.set_gen_all_samples();
+    many.set_num_streams( 1000 );
+    TEST("more streams than samples", many.estimate( &few_lr, &obj ) && many.params() == serial.params(), true);
+  }
+
+  // Early rejection
+  {
+    rrel_parallel_ran_sam_search sprt( 42 );
+    sprt.set_num_streams( 3 );
+    sprt.set_early_rejection( 0.05, 0.5, 0.05, 200 );
+    TEST("SPRT threshold", sprt.sprt_threshold() > 1, true);
+    TEST("estimate with early rejection", sprt.estimate( &lr, &obj ), true);
+    std::cout << "estimate = " << sprt.params() << ", rejected " << sprt.samples_rejected()
+             << " of " << sprt.samples_tested() << " samples\n";
+    TEST("many samples rejected", 2 * sprt.samples_rejected() > sprt.samples_tested(), true);
+    TEST("accurate estimate with early rejection", close_to( sprt.params(), true_params ), true);
+
+    vnl_parallel::set_max_threads( 1 );
+    rrel_parallel_ran_sam_search serial( 42 );
+    serial.set_num_streams( 3 );
+    serial.set_early_rejection( 0.05, 0.5, 0.05, 200 );
+    serial.estimate( &lr, &obj );
+    TEST("early rejection is reproducible", serial.params() == sprt.params() &&
+                                            serial.samples_rejected() == sprt.samples_rejected(), true);
+
+    sprt.set_no_early_rejection();
+    sprt.estimate( &lr, &obj );
+    TEST("no early rejection", sprt.samples_rejected(), 0);
+
+    rrel_parallel_ran_sam_search bad( 42 );
+    bad.set_early_rejection( 0.05, 0.05, 0.5 );
+    bad.estimate( &lr, &obj );
+    TEST("invalid early rejection parameters", bad.samples_rejected(), 0);
+  }
+
+  vnl_parallel::set_max_threads( saved_threads );
+}
+
+TESTMAIN(test_parallel_ran_sam_search);
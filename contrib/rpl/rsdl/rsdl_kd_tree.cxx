@@ -10,6 +10,7 @@
 
 #include <vnl/vnl_math.h>
 #include <vnl/vnl_numeric_traits.h>
+#include <vnl/vnl_parallel_for.h>
 
 #include <rsdl/rsdl_dist.h>
 
@@ -61,9 +62,11 @@ rsdl_kd_tree::rsdl_kd_tree( const std::vector< rsdl_point >& points,
   for ( unsigned int i=0; i<indices.size(); ++i ) indices[ i ] = i;
 
   leaf_count_ = internal_count_ = 0;
+  order_.reserve( points_.size() );
+  coords_.reserve( points_.size() * (Nc_+Na_) );
 
   // 3. call recursive function to do the real work
-  root_ = build_kd_tree( points_per_leaf, box, 0, indices );
+  this->build_kd_tree( points_per_leaf, box, 0, indices );
 }
 
 
@@ -75,10 +78,20 @@ namespace{
     {
       return left.first < right.first;
     }
+
+    void
+    append_box( std::vector< double >& boxes, const rsdl_bounding_box& box )
+    {
+      const unsigned int Nc = box.num_cartesian(), Na = box.num_angular();
+      for ( unsigned int i=0; i<Nc; ++i ) boxes.push_back( box.min_cartesian( i ) );
+      for ( unsigned int i=0; i<Na; ++i ) boxes.push_back( box.min_angular( i ) );
+      for ( unsigned int i=0; i<Nc; ++i ) boxes.push_back( box.max_cartesian( i ) );
+      for ( unsigned int i=0; i<Na; ++i ) boxes.push_back( box.max_angular( i ) );
+    }
 }
 
 
-rsdl_kd_node *
+int
 rsdl_kd_tree::build_kd_tree( int points_per_leaf,
                              const rsdl_bounding_box& outer_box,
                              int depth,
@@ -100,14 +113,27 @@ rsdl_kd_tree::build_kd_tree( int points_per_leaf,
   std::cout << "\n  inner bounding box:\n" << inner_box << std::endl;
 #endif
 
-  // 2. If the number of points is small enough, create and return a leaf node.
+  const int node = int(nodes_.size());
+  nodes_.push_back( rsdl_kd_node( depth, unsigned(order_.size()), unsigned(indices.size()) ) );
+  append_box( boxes_, inner_box );
+  append_box( boxes_, outer_box );
+
+  // 2. If the number of points is small enough, create and return a leaf
+  // node, copying its points dimension by dimension.
 
   if ( indices.size() <= (unsigned int)points_per_leaf ) {
 #ifdef DEBUG
     std::cout << "making leaf node" << std::endl;
 #endif
     leaf_count_ ++ ;
-    return new rsdl_kd_node ( outer_box, inner_box, depth, indices );
+    order_.insert( order_.end(), indices.begin(), indices.end() );
+    for ( unsigned int d=0; d<Nc_; ++d )
+      for ( i=0; i<indices.size(); ++i )
+        coords_.push_back( points_[ indices[i] ].cartesian( d ) );
+    for ( unsigned int d=0; d<Na_; ++d )
+      for ( i=0; i<indices.size(); ++i )
+        coords_.push_back( points_[ indices[i] ].angular( d ) );
+    return node;
   }
 
   // 3. Find the dimension along which there is the greatest variation
@@ -163,10 +189,11 @@ rsdl_kd_tree::build_kd_tree( int points_per_leaf,
   for ( i=0; i<=med_loc; ++i ) left_indices[i] = values[i].second;
   for ( ; i<indices.size(); ++i ) right_indices[i-med_loc-1] = values[i].second;
 
-  rsdl_kd_node * node = new rsdl_kd_node( outer_box, inner_box, depth );
   internal_count_ ++ ;
-  node->left_ = this->build_kd_tree( points_per_leaf, left_outer_box, depth+1, left_indices );
-  node->right_ = this->build_kd_tree( points_per_leaf, right_outer_box, depth+1, right_indices );
+  const int left = this->build_kd_tree( points_per_leaf, left_outer_box, depth+1, left_indices );
+  const int right = this->build_kd_tree( points_per_leaf, right_outer_box, depth+1, right_indices );
+  nodes_[ node ].left_ = left;
+  nodes_[ node ].right_ = right;
 
   return node;
 }
@@ -250,70 +277,148 @@ rsdl_kd_tree::greatest_variation( const std::vector<int>& indices,
 
 rsdl_kd_tree::~rsdl_kd_tree( )
 {
-  destroy_tree( root_ );
 }
 
-void
-rsdl_kd_tree::destroy_tree( rsdl_kd_node*&  p )
+
+//  Same as rsdl_dist_sq( const rsdl_point&, const rsdl_bounding_box& ),
+//  for a query and a box stored as arrays of Nc_ + Na_ values.
+double
+rsdl_kd_tree::sq_dist_to_box( const double* q, const double* box_min, const double* box_max ) const
 {
-  if ( p ) {
-    destroy_tree( p->left_ );
-    destroy_tree( p->right_ );
-    delete p;
-    p = VXL_NULLPTR;
+  double sum_sq = 0;
+
+  for ( unsigned int i=0; i<Nc_; ++i ) {
+    double x0 = box_min[i], x1 = box_max[i];
+    double x = q[i];
+    if ( x < x0 ) {
+      sum_sq += vnl_math::sqr( x0 - x );
+    }
+    else if ( x > x1 ) {
+      sum_sq += vnl_math::sqr( x1 - x );
+    }
   }
+
+  for ( unsigned int j=Nc_; j<Nc_+Na_; ++j ) {
+    double a0 = box_min[j], a1 = box_max[j];
+    double a = q[j];
+    if ( a0 > a1 ) {             // interval wraps around 0
+      if ( a < a0 && a > a1 ) {  // outside interval, calculate distance
+        sum_sq += vnl_math::sqr( std::min( a0-a, a-a1 ) );
+      }
+    }
+    else {                       // interval does not wrap around
+      if ( a > a1 ) {            // a is above a1
+        sum_sq += vnl_math::sqr( std::min( a - a1, vnl_math::twopi + a0 - a ) );
+      }
+      else if ( a0 > a ) {       // a is below a0
+        sum_sq += vnl_math::sqr( std::min( a0 - a, vnl_math::twopi + a - a1 ) );
+      }
+    }
+  }
+
+  return sum_sq;
 }
 
 
+//: Runs the queries of the batched rsdl_kd_tree::n_nearest().
+struct rsdl_kd_tree_n_nearest_batch
+{
+  const rsdl_kd_tree* tree;
+  const std::vector< rsdl_point >* query_points;
+  int n;
+  bool use_heap;
+  int max_leaves;
+  double eps;
+  std::vector< std::vector< int > >* indices;
+
+  void operator()( unsigned int begin, unsigned int end ) const
+  {
+    for ( unsigned int i=begin; i<end; ++i )
+      tree->n_nearest_indices( (*query_points)[i], n, (*indices)[i], use_heap, max_leaves, eps );
+  }
+};
+
+
 void
 rsdl_kd_tree::n_nearest( const rsdl_point& query_point,
                          int n,
                          std::vector< rsdl_point >& closest_points,
                          std::vector< int >& closest_indices,
                          bool use_heap,
-                         int max_leaves)
+                         int max_leaves,
+                         double eps ) const
+{
+  this->n_nearest_indices( query_point, n, closest_indices, use_heap, max_leaves, eps );
+
+  if ( closest_points.size() != closest_indices.size() )
+    closest_points.resize( closest_indices.size() );
+
+  for ( unsigned int i=0; i<closest_indices.size(); ++i ) {
+    closest_points[i] = points_[ closest_indices[i] ];
+  }
+}
+
+
+void
+rsdl_kd_tree::n_nearest( const std::vector< rsdl_point >& query_points,
+                         int n,
+                         std::vector< std::vector< int > >& indices,
+                         bool use_heap,
+                         int max_leaves,
+                         double eps ) const
+{
+  indices.resize( query_points.size() );
+  rsdl_kd_tree_n_nearest_batch batch = { this, &query_points, n, use_heap, max_leaves, eps, &indices };
+  vnl_parallel_for( 0u, (unsigned int)query_points.size(), batch, 16u );
+}
+
+
+//  Find the indices of the nearest points; closest_indices is resized
+//  to the number of points found.
+void
+rsdl_kd_tree::n_nearest_indices( const rsdl_point& query_point,
+                                 int n,
+                                 std::vector< int >& closest_indices,
+                                 bool use_heap,
+                                 int max_leaves,
+                                 double eps ) const
 {
   assert(n>0);
   assert( query_point.num_cartesian() == Nc_ );
   assert( query_point.num_angular() == Na_ );
+  assert( eps >= 0 );
 
   //if we are using approx query, then we must use heap
   assert(max_leaves == -1 || (max_leaves > 0 && use_heap));
 
+  // the query as a single array, cartesian before angular
+  std::vector< double > q( Nc_+Na_ );
+  for ( unsigned int i=0; i<Nc_; ++i ) q[i] = query_point.cartesian( i );
+  for ( unsigned int i=0; i<Na_; ++i ) q[Nc_+i] = query_point.angular( i );
+  const double eps_sq = (1+eps) * (1+eps);
+
   if ( closest_indices.size() != (unsigned int)n )
     closest_indices.resize( n );
-  std::vector< double > sq_distances( n, 1e+10 );  // could cache for (slight) efficiency gain
+  std::vector< double > sq_distances( n, 1e+10 );
   int num_found = 0;
 
-  leaves_examined_ = internal_examined_ = 0;
-
   if ( use_heap )
-    this->n_nearest_with_heap( query_point, n, root_, closest_indices, sq_distances, num_found, max_leaves );
+    this->n_nearest_with_heap( &q[0], n, eps_sq, closest_indices, sq_distances, num_found, max_leaves );
   else
-    this->n_nearest_with_stack( query_point, n, root_, closest_indices, sq_distances, num_found );
-#ifdef DEBUG
-  std::cout << "\nAfter n_nearest, leaves_examined_ = " << leaves_examined_
-           << ", fraction = " << float(leaves_examined_) / leaf_count_
-           << "\n     internal_examined_ = " << internal_examined_
-           << ", fraction = " << float(internal_examined_) / internal_count_ << std::endl;
-#endif
-  assert(num_found >= 0);
-  if ( closest_points.size() != (unsigned int)num_found )
-    closest_points.resize( num_found );
+    this->n_nearest_with_stack( &q[0], n, eps_sq, closest_indices, sq_distances, num_found );
 
-  for ( int i=0; i<num_found; ++i ) {
-    closest_points[i] = points_[ closest_indices[i] ];
-  }
+  assert(num_found >= 0);
+  closest_indices.resize( num_found );
 }
 
 
 void
-rsdl_kd_tree::n_nearest_with_stack( const rsdl_point& query_point,
+rsdl_kd_tree::n_nearest_with_stack( const double* q,
                                     int n,
-                                    rsdl_kd_node* root,
+                                    double eps_sq,
                                     std::vector< int >& closest_indices,
                                     std::vector< double >& sq_distances,
-                                    int & num_found )
+                                    int & num_found ) const
 {
   assert(n>0);
 #ifdef DEBUG
@@ -326,20 +431,20 @@ rsdl_kd_tree::n_nearest_with_stack( const rsdl_point& query_point,
   bool initial_path = true;
 
   //  Go down tree,
-  rsdl_kd_node* current = root;
+  int current = 0;
   sq_dist = 0;
 
   do {
 #ifdef DEBUG
-    std::cout << "\ncurrent -- sq_dist " << sq_dist << ", depth: " << current->depth_
-             << "\nouter_box: " << current->outer_box_
-             << "\ninner_box: " << current->inner_box_
+    std::cout << "\ncurrent -- sq_dist " << sq_dist << ", depth: " << nodes_[current].depth_
              << "\nstack size: " << stack_vec.size() << std::endl;
 #endif
+    const rsdl_kd_node& node = nodes_[ current ];
+
     // if the distance is too large, skip node and take the next node
     // from the stack
 
-    if ( num_found >= n && sq_dist >= sq_distances[ num_found-1 ] ) {
+    if ( num_found >= n && sq_dist * eps_sq >= sq_distances[ num_found-1 ] ) {
 #ifdef DEBUG
       std::cout << "skipping node" << std::endl;
 #endif
@@ -355,12 +460,11 @@ rsdl_kd_tree::n_nearest_with_stack( const rsdl_point& query_point,
     //  if this is a leaf node, update the set of closest points, and
     //  take the next node from the stack
 
-    else if ( ! current->left_ ) {
+    else if ( node.left_ < 0 ) {
 #ifdef DEBUG
       std::cout << "At a leaf" << std::endl;
 #endif
-      leaves_examined_ ++ ;
-      update_closest( query_point, n, current, closest_indices, sq_distances, num_found );
+      update_closest( q, n, current, closest_indices, sq_distances, num_found );
 
       //  If stack is empty then we're done.
       if ( stack_vec.size() == 0 )
@@ -376,7 +480,7 @@ rsdl_kd_tree::n_nearest_with_stack( const rsdl_point& query_point,
           std::cout << "First leaf" << std::endl;
 #endif
           initial_path = false ;
-          if ( this-> bounded_at_leaf( query_point, n, current, sq_distances, num_found ) )
+          if ( this-> bounded_at_leaf( q, n, current, sq_distances, num_found ) )
             return; //  done
         }
 
@@ -392,9 +496,8 @@ rsdl_kd_tree::n_nearest_with_stack( const rsdl_point& query_point,
 #ifdef DEBUG
       std::cout << "Internal node" << std::endl;
 #endif
-      internal_examined_ ++ ;
-      left_box_sq_dist = rsdl_dist_sq( query_point, current->left_->inner_box_ );
-      right_box_sq_dist = rsdl_dist_sq( query_point, current->right_->inner_box_ );
+      left_box_sq_dist = sq_dist_to_box( q, inner_min( node.left_ ), inner_max( node.left_ ) );
+      right_box_sq_dist = sq_dist_to_box( q, inner_min( node.right_ ), inner_max( node.right_ ) );
 #ifdef DEBUG
       std::cout << "left sq distance = " << left_box_sq_dist << std::endl
                << "right sq distance = " << right_box_sq_dist << std::endl;
@@ -405,15 +508,15 @@ rsdl_kd_tree::n_nearest_with_stack( const rsdl_point& query_point,
 #ifdef DEBUG
         std::cout << "going left, pushing right" << std::endl;
 #endif
-        stack_vec.push_back( rsdl_kd_heap_entry( right_box_sq_dist, current->right_ ) );
-        current = current->left_ ;
+        stack_vec.push_back( rsdl_kd_heap_entry( right_box_sq_dist, node.right_ ) );
+        current = node.left_ ;
       }
       else {
 #ifdef DEBUG
         std::cout << "going right, pushing left" << std::endl;
 #endif
-        stack_vec.push_back( rsdl_kd_heap_entry( left_box_sq_dist, current->left_ ) );
-        current = current->right_ ;
+        stack_vec.push_back( rsdl_kd_heap_entry( left_box_sq_dist, node.left_ ) );
+        current = node.right_ ;
       }
     }
   } while ( true );
@@ -421,13 +524,13 @@ rsdl_kd_tree::n_nearest_with_stack( const rsdl_point& query_point,
 
 
 void
-rsdl_kd_tree::n_nearest_with_heap( const rsdl_point& query_point,
+rsdl_kd_tree::n_nearest_with_heap( const double* q,
                                    int n,
-                                   rsdl_kd_node* root,
+                                   double eps_sq,
                                    std::vector< int >& closest_indices,
                                    std::vector< double >& sq_distances,
                                    int & num_found,
-                                   int max_leaves)
+                                   int max_leaves) const
 {
   assert(n>0);
 #ifdef DEBUG
@@ -437,21 +540,22 @@ rsdl_kd_tree::n_nearest_with_heap( const rsdl_point& query_point,
   heap_vec.reserve( 100 );
   double left_box_sq_dist, right_box_sq_dist;
   double sq_dist;
+  int leaves_examined = 0;
 
   //  Go down tree,
-  rsdl_kd_node* current = root;
-  while ( current->left_ ) {
-    internal_examined_ ++ ;
-
-    if ( rsdl_dist_sq( query_point, current-> left_ -> outer_box_ ) < 1.0e-5 ) {
-      right_box_sq_dist = rsdl_dist_sq( query_point, current->right_->inner_box_ );
-      heap_vec.push_back( rsdl_kd_heap_entry( right_box_sq_dist, current->right_ ) );
-      current = current->left_ ;
+  int current = 0;
+  while ( nodes_[ current ].left_ >= 0 ) {
+    const rsdl_kd_node& node = nodes_[ current ];
+
+    if ( sq_dist_to_box( q, outer_min( node.left_ ), outer_max( node.left_ ) ) < 1.0e-5 ) {
+      right_box_sq_dist = sq_dist_to_box( q, inner_min( node.right_ ), inner_max( node.right_ ) );
+      heap_vec.push_back( rsdl_kd_heap_entry( right_box_sq_dist, node.right_ ) );
+      current = node.left_ ;
     }
     else {
-      left_box_sq_dist = rsdl_dist_sq( query_point, current->left_->inner_box_ );
-      heap_vec.push_back( rsdl_kd_heap_entry( left_box_sq_dist, current->left_ ) );
-      current = current->right_ ;
+      left_box_sq_dist = sq_dist_to_box( q, inner_min( node.left_ ), inner_max( node.left_ ) );
+      heap_vec.push_back( rsdl_kd_heap_entry( left_box_sq_dist, node.left_ ) );
+      current = node.right_ ;
     }
   }
   std::make_heap( heap_vec.begin(), heap_vec.end() );
@@ -459,35 +563,34 @@ rsdl_kd_tree::n_nearest_with_heap( const rsdl_point& query_point,
 
 #ifdef DEBUG
   std::cout << "\nAfter initial trip down the tree, here's the heap\n";
-  for ( int i=0; i<heap_vec.size(); ++i )
+  for ( unsigned int i=0; i<heap_vec.size(); ++i )
     std::cout << "  " << i << ":  sq distance " << heap_vec[i].dist_
-             << ", node depth " << heap_vec[i].p_->depth_ << std::endl;
+             << ", node depth " << nodes_[ heap_vec[i].p_ ].depth_ << std::endl;
 #endif
   bool first_leaf = true;
 
   do {
 #ifdef DEBUG
-    std::cout << "\ncurrent -- sq_dist " << sq_dist << ", depth: " << current->depth_
-             << "\nouter_box: " << current->outer_box_
-             << "\ninner_box: " << current->inner_box_
+    std::cout << "\ncurrent -- sq_dist " << sq_dist << ", depth: " << nodes_[current].depth_
              << "\nheap size: " << heap_vec.size() << std::endl;
 #endif
-    if ( num_found < n || sq_dist < sq_distances[ num_found-1 ] ) {
-      if ( ! current->left_ ) {  // a leaf node
+    if ( num_found < n || sq_dist * eps_sq < sq_distances[ num_found-1 ] ) {
+      const rsdl_kd_node& node = nodes_[ current ];
+      if ( node.left_ < 0 ) {  // a leaf node
 #ifdef DEBUG
         std::cout << "Leaf" << std::endl;
 #endif
-        leaves_examined_ ++ ;
-        update_closest( query_point, n, current, closest_indices, sq_distances, num_found );
+        leaves_examined ++ ;
+        update_closest( q, n, current, closest_indices, sq_distances, num_found );
         if ( first_leaf ) {  // check if we can quit just at this leaf node.
 #ifdef DEBUG
           std::cout << "First leaf" << std::endl;
 #endif
           first_leaf = false;
-          if ( this-> bounded_at_leaf( query_point, n, current, sq_distances, num_found ) )
+          if ( this-> bounded_at_leaf( q, n, current, sq_distances, num_found ) )
             return;
         }
-        if (max_leaves != -1 && leaves_examined_ >= max_leaves)
+        if (max_leaves != -1 && leaves_examined >= max_leaves)
           return;
       }
 
@@ -495,29 +598,27 @@ rsdl_kd_tree::n_nearest_with_heap( const rsdl_point& query_point,
 #ifdef DEBUG
         std::cout << "Internal" << std::endl;
 #endif
-        internal_examined_ ++ ;
-
-        left_box_sq_dist = rsdl_dist_sq( query_point, current->left_->inner_box_ );
+        left_box_sq_dist = sq_dist_to_box( q, inner_min( node.left_ ), inner_max( node.left_ ) );
 #ifdef DEBUG
         std::cout << "left sq distance = " << left_box_sq_dist << std::endl;
 #endif
-        if ( num_found < n || sq_distances[ num_found-1 ] > left_box_sq_dist ) {
+        if ( num_found < n || sq_distances[ num_found-1 ] > left_box_sq_dist * eps_sq ) {
 #ifdef DEBUG
           std::cout << "pushing left onto the heap" << std::endl;
 #endif
-          heap_vec.push_back( rsdl_kd_heap_entry( left_box_sq_dist, current->left_ ) );
+          heap_vec.push_back( rsdl_kd_heap_entry( left_box_sq_dist, node.left_ ) );
           std::push_heap( heap_vec.begin(), heap_vec.end() );
         };
 
-        right_box_sq_dist = rsdl_dist_sq( query_point, current->right_->inner_box_ );
+        right_box_sq_dist = sq_dist_to_box( q, inner_min( node.right_ ), inner_max( node.right_ ) );
 #ifdef DEBUG
         std::cout << "right sq distance = " << right_box_sq_dist << std::endl;
 #endif
-        if ( num_found < n || sq_distances[ num_found-1 ] > right_box_sq_dist ) {
+        if ( num_found < n || sq_distances[ num_found-1 ] > right_box_sq_dist * eps_sq ) {
 #ifdef DEBUG
           std::cout << "pushing right onto the heap" << std::endl;
 #endif
-          heap_vec.push_back( rsdl_kd_heap_entry( right_box_sq_dist, current->right_ ) );
+          heap_vec.push_back( rsdl_kd_heap_entry( right_box_sq_dist, node.right_ ) );
           std::push_heap( heap_vec.begin(), heap_vec.end() );
         }
       }
@@ -538,24 +639,50 @@ rsdl_kd_tree::n_nearest_with_heap( const rsdl_point& query_point,
 }
 
 void
-rsdl_kd_tree::update_closest( const rsdl_point& query_point,
+rsdl_kd_tree::update_closest( const double* q,
                               int n,
-                              rsdl_kd_node* p,
+                              int p,
                               std::vector< int >& closest_indices,
                               std::vector< double >& sq_distances,
-                              int & num_found )
+                              int & num_found ) const
 {
   assert(n>0);
-#ifdef DEBUG
-  std::cout << "Update_closest for leaf\n query_point = " << query_point
-           << "\n inner bounding box =\n" << p->inner_box_
-           << "\n sq_dist = " << rsdl_dist_sq( query_point, p->inner_box_ )
-           << std::endl;
-#endif
+  const unsigned int first = nodes_[ p ].first_;
+  const unsigned int count = nodes_[ p ].count_;
+
+  // The distances to all the points of the leaf, a dimension at a time,
+  // in the same order of operations as rsdl_dist_sq(); the inner loops
+  // run over contiguous coordinates and have no branches, so that they
+  // are vectorized.
+  double sq_dist_buf[ 64 ];
+  std::vector< double > sq_dist_vec;
+  double* leaf_sq_dist = sq_dist_buf;
+  if ( count > 64 ) {
+    sq_dist_vec.resize( count );
+    leaf_sq_dist = &sq_dist_vec[0];
+  }
+  const double* coords = &coords_[ first * (Nc_+Na_) ];
+  for ( unsigned int i=0; i<count; ++i )
+    leaf_sq_dist[i] = 0;
+  for ( unsigned int d=0; d<Nc_; ++d, coords += count ) {
+    const double x = q[d];
+    for ( unsigned int i=0; i<count; ++i ) {
+      const double diff = x - coords[i];
+      leaf_sq_dist[i] += diff * diff;
+    }
+  }
+  for ( unsigned int d=Nc_; d<Nc_+Na_; ++d, coords += count ) {
+    const double a = q[d];
+    for ( unsigned int i=0; i<count; ++i ) {
+      double diff = std::abs( a - coords[i] );
+      diff = diff > vnl_math::pi ? vnl_math::twopi - diff : diff;
+      leaf_sq_dist[i] += diff * diff;
+    }
+  }
 
-  for ( unsigned int i=0; i < p->point_indices_.size(); ++i ) {  // check each id
-    int id = p->point_indices_[i];
-    double sq_dist = rsdl_dist_sq( query_point, points_[ id ] );
+  for ( unsigned int i=0; i < count; ++i ) {  // check each id
+    int id = order_[ first + i ];
+    double sq_dist = leaf_sq_dist[i];
 #ifdef DEBUG
     std::cout << "  id = " << id << ", point = " << points_[ id ]
              << ", sq_dist = " << sq_dist << std::endl;
@@ -602,11 +729,11 @@ rsdl_kd_tree::update_closest( const rsdl_point& query_point,
 //  points.
 
 bool
-rsdl_kd_tree :: bounded_at_leaf ( const rsdl_point& query_point,
+rsdl_kd_tree :: bounded_at_leaf ( const double* q,
                                   int n,
-                                  rsdl_kd_node* current,
+                                  int current,
                                   const std::vector< double >& sq_distances,
-                                  int & num_found )
+                                  int & num_found ) const
 {
   assert(n>0);
 #ifdef DEBUG
@@ -618,19 +745,12 @@ rsdl_kd_tree :: bounded_at_leaf ( const rsdl_point& query_point,
   }
 
   double radius = std::sqrt( sq_distances[ n-1 ] );
+  const double* box_min = outer_min( current );
+  const double* box_max = outer_max( current );
 
-  for ( unsigned int i = 0; i < Nc_; ++ i ) {
-    double x = query_point.cartesian( i );
-    if ( current -> outer_box_ . min_cartesian( i ) > x - radius ||
-         current -> outer_box_ . max_cartesian( i ) < x + radius ) {
-      return false;
-    }
-  }
-
-  for ( unsigned int i = 0; i < Na_; ++ i ) {
-    double a = query_point.angular( i );
-    if ( current -> outer_box_ . min_angular( i ) > a - radius ||
-         current -> outer_box_ . max_angular( i ) < a + radius ) {
+  for ( unsigned int i = 0; i < Nc_+Na_; ++ i ) {
+    double x = q[ i ];
+    if ( box_min[ i ] > x - radius || box_max[ i ] < x + radius ) {
       return false;
     }
   }
@@ -643,11 +763,11 @@ rsdl_kd_tree :: bounded_at_leaf ( const rsdl_point& query_point,
 void
 rsdl_kd_tree :: points_in_bounding_box( const rsdl_bounding_box& box,
                                         std::vector< rsdl_point >& points_in_box,
-                                        std::vector< int >& indices_in_box )
+                                        std::vector< int >& indices_in_box ) const
 {
   points_in_box.clear();
   indices_in_box.clear();
-  this -> points_in_bounding_box( root_, box, indices_in_box );
+  this -> points_in_bounding_box( 0, box, indices_in_box );
   for ( unsigned int i=0; i<indices_in_box.size(); ++i )
     points_in_box.push_back( this -> points_[ indices_in_box[i] ] );
 }
@@ -657,7 +777,7 @@ void
 rsdl_kd_tree :: points_in_radius( const rsdl_point& query_point,
                                   double radius,
                                   std::vector< rsdl_point >& points_within_radius,
-                                  std::vector< int >& indices_within_radius )
+                                  std::vector< int >& indices_within_radius ) const
 {
   //  Form a bounding box of width 2*radius, centered at the point.
   //  Start by creating the corner points of this box.
@@ -698,7 +818,7 @@ rsdl_kd_tree :: points_in_radius( const rsdl_point& query_point,
   std::vector< int > indices_in_box;
 
   //  Gather the points in the bounding box:
-  this -> points_in_bounding_box( this -> root_, box, indices_in_box );
+  this -> points_in_bounding_box( 0, box, indices_in_box );
 
   //  Clear out the result vectors in preparation
   points_within_radius.clear();
@@ -716,40 +836,81 @@ rsdl_kd_tree :: points_in_radius( const rsdl_point& query_point,
 }
 
 void
-rsdl_kd_tree :: points_in_bounding_box( rsdl_kd_node* current,
+rsdl_kd_tree :: points_in_bounding_box( int current,
                                         const rsdl_bounding_box& box,
-                                        std::vector< int >& indices_in_box )
+                                        std::vector< int >& indices_in_box ) const
 {
-  if ( ! current -> left_ ) {
-    for ( unsigned int i=0; i < current -> point_indices_ . size(); ++i ) {
-      int index = current -> point_indices_[ i ];
+  const rsdl_kd_node& node = nodes_[ current ];
+  if ( node.left_ < 0 ) {
+    for ( unsigned int i=0; i < node.count_; ++i ) {
+      int index = order_[ node.first_ + i ];
       if ( rsdl_dist_point_in_box( this -> points_[ index ], box ) )
         indices_in_box.push_back( index );
     }
   }
   else {
-    bool inside, intersects;
-    rsdl_dist_box_relation( current -> inner_box_, box, inside, intersects );
+    // as rsdl_dist_box_relation( inner box, box, inside, intersects )
+    const double* r_min = inner_min( current );
+    const double* r_max = inner_max( current );
+    bool inside = true, intersects = true;
+
+    for ( unsigned int i=0; i<Nc_ && intersects; ++i ) {
+      double x0 = r_min[i], x1 = r_max[i];
+      double y0 = box.min_cartesian(i), y1 = box.max_cartesian(i);
+
+      if ( x0 < y0 || y1 < x1 )
+        inside = false;
+
+      if ( y1 < x0 || x1 < y0 )
+        intersects = false;
+    }
+
+    for ( unsigned int j=0; j<Na_ && intersects; ++j ) {
+      double r0 = r_min[Nc_+j], r1 = r_max[Nc_+j];
+      double s0 = box.min_angular(j), s1 = box.max_angular(j);
+
+      if ( s0 <= s1 ) {    // outer angular interval doesn't wrap
+        if ( r0 <= r1 ) {  // inner angular interval doesn't wrap
+          if ( r0 < s0 || s1 < r1 )   // part of inner interval is outside
+            inside = false;
+          if ( r1 < s0 || r0 > s1 )   // all of inner interval is to the left or to the right
+            intersects = false;
+        }
+        else {             //  inner angular interval does wrap
+          inside = false;            // point of wrap-around is in inner but not in outer
+          if ( r1 < s0 && s1 < r0 )
+            intersects = false;
+        }
+      }
+      else {               // outer angular interval does wrap
+        if ( r0 <= r1 ) {  // inner angular interval doesn't wrap
+          if ( r1 > s1 && r0 < s0 )
+            inside = false;
+          if ( r0 > s1 && r1 < s0 )
+            intersects = false;
+        }
+        else {             // inner angular interval does wrap;  intersects must be true
+          if ( r1 > s1 || r0 < s0 )
+            inside = false;
+        }
+      }
+    }
+
     if ( inside )
       this -> report_all_in_subtree( current, indices_in_box );
     else if ( intersects ) {
-      this -> points_in_bounding_box( current -> left_, box, indices_in_box );
-      this -> points_in_bounding_box( current -> right_, box, indices_in_box );
+      this -> points_in_bounding_box( node.left_, box, indices_in_box );
+      this -> points_in_bounding_box( node.right_, box, indices_in_box );
     }
   }
 }
 
+//  The points below a node are contiguous in build order.
 void
-rsdl_kd_tree :: report_all_in_subtree( rsdl_kd_node* current,
-                                       std::vector< int >& indices )
+rsdl_kd_tree :: report_all_in_subtree( int current,
+                                       std::vector< int >& indices ) const
 {
-  if ( current -> left_ ) {
-    this -> report_all_in_subtree( current -> left_, indices );
-    this -> report_all_in_subtree( current -> right_, indices );
-  }
-  else {
-    for ( unsigned int i=0; i < current -> point_indices_ . size(); ++ i ) {
-      indices.push_back( current -> point_indices_[ i ] );
-    }
-  }
+  const rsdl_kd_node& node = nodes_[ current ];
+  indices.insert( indices.end(), order_.begin() + node.first_,
+                  order_.begin() + node.first_ + node.count_ );
 }
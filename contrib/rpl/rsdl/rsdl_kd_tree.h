@@ -2,6 +2,21 @@
 #define rsdl_kd_tree_h_
 //:
 // \file
+//
+// The nodes of the tree are held in one array, in depth-first order, and
+// refer to their children by index.  The points are copied in the order
+// in which the leaves hold them, so that each subtree covers a contiguous
+// range.  Within a leaf the coordinates are stored one dimension at a
+// time, so that the distances from a query to all the points of a leaf
+// are computed by loops over contiguous memory, which the compiler turns
+// into SIMD instructions.
+//
+// The queries do not modify the tree, so several may run at once; the
+// batched form of n_nearest() runs its queries in parallel.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
 
 #include <iostream>
 #include <vector>
@@ -13,33 +28,19 @@
 class rsdl_kd_node
 {
  public:
-  //: ctor for internal node
-  rsdl_kd_node( const rsdl_bounding_box& outer_box,
-                const rsdl_bounding_box& inner_box,
-                unsigned int depth )
-    : outer_box_(outer_box), inner_box_(inner_box), depth_(depth),
-      point_indices_(0), left_(0), right_(0) {}
-
-  //: ctor for leaf node
-  rsdl_kd_node( const rsdl_bounding_box& outer_box,
-                const rsdl_bounding_box& inner_box,
-                unsigned int depth,
-                const std::vector<int>& indices )
-    : outer_box_(outer_box), inner_box_(inner_box), depth_(depth),
-      point_indices_(indices), left_(0), right_(0) {}
-
-  //: outer bounding box in both cartesian and angular dimensions
-  rsdl_bounding_box outer_box_;
-  //: inner bounding box in both cartesian and angular dimensions
-  rsdl_bounding_box inner_box_;
+  rsdl_kd_node( unsigned int depth, unsigned int first, unsigned int count )
+    : depth_(depth), first_(first), count_(count), left_(-1), right_(-1) {}
+
   //: depth of node in the tree
   unsigned int depth_;
-  //: indices of the points stored at this leaf
-  std::vector< int > point_indices_;
-  //: left child
-  rsdl_kd_node* left_;
-  //: right child
-  rsdl_kd_node* right_;
+  //: position, in build order, of the first point below this node
+  unsigned int first_;
+  //: number of points below this node
+  unsigned int count_;
+  //: index of the left child in the node array, -1 at a leaf
+  int left_;
+  //: index of the right child in the node array, -1 at a leaf
+  int right_;
 };
 
 
@@ -47,13 +48,14 @@ class rsdl_kd_heap_entry
 {
  public:
   rsdl_kd_heap_entry() {}
-  rsdl_kd_heap_entry( double dist, rsdl_kd_node* p )
+  rsdl_kd_heap_entry( double dist, int p )
     : dist_(dist), p_(p) {}
   bool operator< ( const rsdl_kd_heap_entry& right ) const
   { return right.dist_ < this->dist_; }  // kludge because max heap
 
   double dist_;
-  rsdl_kd_node* p_;
+  //: index of the node in the node array
+  int p_;
 };
 
 
@@ -72,90 +74,127 @@ class rsdl_kd_tree : public vbl_ref_count
                 double min_angle = 0,
                 int points_per_leaf=4 );
 
-  //: dtor deletes the nodes in tree
+  //: dtor
   ~rsdl_kd_tree();
 
   //: find the n points nearest to the query point (and their associate indices).
   // max_leaves = -1 to not use approximate nearest neighbor queries;
-  // if max_leaves is not -1 then use_heap must be true
+  // if max_leaves is not -1 then use_heap must be true.
+  // With eps > 0 the search is also approximate: a subtree is skipped unless
+  // it could hold a point closer than 1/(1+eps) times the n-th distance so far.
   void n_nearest( const rsdl_point& query_point,
                   int n,
                   std::vector< rsdl_point >& closest_points,
                   std::vector< int >& indices,
                   bool use_heap = false,
-                  int max_leaves = -1 );
+                  int max_leaves = -1,
+                  double eps = 0 ) const;
+
+  //: find the n points nearest to each of the query points.
+  // indices[q] is set to the indices of the points nearest to
+  // query_points[q], nearest first, exactly as for a single query.  The
+  // queries are shared among threads with vnl_parallel_for.
+  void n_nearest( const std::vector< rsdl_point >& query_points,
+                  int n,
+                  std::vector< std::vector< int > >& indices,
+                  bool use_heap = false,
+                  int max_leaves = -1,
+                  double eps = 0 ) const;
 
   //: find all points within a query's bounding box
   void points_in_bounding_box( const rsdl_bounding_box& box,
                                std::vector< rsdl_point >& closest_points,
-                               std::vector< int >& indices );
+                               std::vector< int >& indices ) const;
 
   //: find all points within a given distance of the query_point.
   void points_in_radius( const rsdl_point& query_point,
                          double radius,
                          std::vector< rsdl_point >& points,
-                         std::vector< int >& indices );
+                         std::vector< int >& indices ) const;
 
  private:
-  rsdl_kd_node* root_;
+  //: nodes in depth-first order; the root is nodes_[0]
+  std::vector< rsdl_kd_node > nodes_;
+
+  //: inner and outer bounding box of each node, 4*(Nc_+Na_) values per node:
+  //  inner min, inner max, outer min, outer max, cartesian before angular.
+  std::vector< double > boxes_;
 
   std::vector< rsdl_point > points_;
 
+  //: index in points_ of each point, in build order
+  std::vector< int > order_;
+
+  //: coordinates of the points in build order, dimension by dimension within each leaf
+  std::vector< double > coords_;
+
   unsigned int Nc_, Na_; // number of cartesian and angular dimensions
   double min_angle_;
 
   int leaf_count_;
-  int leaves_examined_;
   int internal_count_;
-  int internal_examined_;
 
  private:
-  void destroy_tree( rsdl_kd_node*& p );
-
-  rsdl_kd_node* build_kd_tree( int points_per_leaf,
-                               const rsdl_bounding_box& outer_box,
-                               int depth,
-                               std::vector< int >& indices );
+  int build_kd_tree( int points_per_leaf,
+                     const rsdl_bounding_box& outer_box,
+                     int depth,
+                     std::vector< int >& indices );
 
   rsdl_bounding_box build_inner_box( const std::vector< int >& indices );
 
   void greatest_variation( const std::vector<int>& indices,
                            bool& use_cartesian, int& dim );
 
-  void n_nearest_with_stack( const rsdl_point& query_point,
+  const double* inner_min( int node ) const { return &boxes_[4*(Nc_+Na_)*node]; }
+  const double* inner_max( int node ) const { return inner_min( node ) + Nc_+Na_; }
+  const double* outer_min( int node ) const { return inner_min( node ) + 2*(Nc_+Na_); }
+  const double* outer_max( int node ) const { return inner_min( node ) + 3*(Nc_+Na_); }
+
+  double sq_dist_to_box( const double* q, const double* box_min, const double* box_max ) const;
+
+  void n_nearest_with_stack( const double* q,
                              int n,
-                             rsdl_kd_node* root,
+                             double eps_sq,
                              std::vector< int >& closest_indices,
                              std::vector< double >& sq_distances,
-                             int & num_found );
+                             int & num_found ) const;
 
-  void n_nearest_with_heap( const rsdl_point& query_point,
+  void n_nearest_with_heap( const double* q,
                             int n,
-                            rsdl_kd_node* root,
+                            double eps_sq,
                             std::vector< int >& closest_indices,
                             std::vector< double >& sq_distances,
                             int & num_found,
-                            int max_leaves);
+                            int max_leaves) const;
 
-  void update_closest( const rsdl_point& query_point,
+  void n_nearest_indices( const rsdl_point& query_point,
+                          int n,
+                          std::vector< int >& closest_indices,
+                          bool use_heap,
+                          int max_leaves,
+                          double eps ) const;
+
+  void update_closest( const double* q,
                        int n,
-                       rsdl_kd_node* p,
+                       int p,
                        std::vector< int >& closest_indices,
                        std::vector< double >& sq_distances,
-                       int & num_found );
+                       int & num_found ) const;
 
-  bool bounded_at_leaf ( const rsdl_point& query_point,
+  bool bounded_at_leaf ( const double* q,
                          int n,
-                         rsdl_kd_node* current,
+                         int current,
                          const std::vector< double >& sq_distances,
-                         int & num_found );
+                         int & num_found ) const;
 
-  void points_in_bounding_box( rsdl_kd_node* current,
+  void points_in_bounding_box( int current,
                                const rsdl_bounding_box& box,
-                               std::vector< int >& indices );
+                               std::vector< int >& indices ) const;
+
+  void report_all_in_subtree( int current,
+                              std::vector< int >& indices ) const;
 
-  void report_all_in_subtree( rsdl_kd_node* current,
-                              std::vector< int >& indices );
+  friend struct rsdl_kd_tree_n_nearest_batch;
 };
 
 #endif // rsdl_kd_tree_h_
@@ -5,6 +5,7 @@
 #include <vcl_compiler.h>
 #include <vnl/vnl_math.h>
 #include <vnl/vnl_random.h>
+#include <vnl/vnl_parallel_for.h>
 #include <testlib/testlib_test.h>
 
 #include <rsdl/rsdl_kd_tree.h>
@@ -17,6 +18,86 @@ static inline bool less_first( const std::pair<double,int>& left,
   return left.first < right.first;
 }
 
+//: Batched and approximate queries on points with only cartesian coordinates.
+static void test_kd_tree_batch()
+{
+  const int M = 20000, Q = 500, n = 6;
+  vnl_random rng(17);
+  std::vector< rsdl_point > points( M ), queries( Q );
+  for ( int i=0; i<M; ++i ) {
+    points[i].resize( 3, 0 );
+    for ( unsigned int d=0; d<3; ++d ) points[i].cartesian(d) = rng.drand64( 0, 10 );
+  }
+  for ( int q=0; q<Q; ++q ) {
+    queries[q].resize( 3, 0 );
+    for ( unsigned int d=0; d<3; ++d ) queries[q].cartesian(d) = rng.drand64( -1, 11 );
+  }
+
+  // more than 64 points per leaf uses a separate distance buffer
+  const int leaf_sizes[] = { 1, 8, 100 };
+  for ( unsigned int l=0; l<3; ++l ) {
+    rsdl_kd_tree tree( points, 0, leaf_sizes[l] );
+    std::vector< std::vector< int > > batch;
+    tree.n_nearest( queries, n, batch );
+    bool exact = batch.size() == (unsigned int)Q, same = exact;
+    std::vector< std::pair< double, int > > dist_pairs( M );
+    for ( int q=0; same && q<Q; ++q ) {
+      std::vector< rsdl_point > cpoints;
+      std::vector< int > cindices;
+      tree.n_nearest( queries[q], n, cpoints, cindices );
+      same = cindices == batch[q];
+      for ( int i=0; i<M; ++i )
+        dist_pairs[i] = std::pair<double,int>( rsdl_dist_sq( queries[q], points[i] ), i );
+      std::partial_sort( dist_pairs.begin(), dist_pairs.begin()+n, dist_pairs.end(), less_first );
+      for ( int i=0; exact && i<n; ++i )
+        exact = close( rsdl_dist_sq( queries[q], points[ batch[q][i] ] ), dist_pairs[i].first );
+    }
+    std::cout << "points per leaf " << leaf_sizes[l] << '\n';
+    TEST( "batched n_nearest matches single queries", same, true );
+    TEST( "batched n_nearest is exact", exact, true );
+  }
+
+  rsdl_kd_tree tree( points, 0, 8 );
+  const unsigned int old_threads = vnl_parallel::max_threads();
+  std::vector< std::vector< int > > batch1, batch4, heap1, heap4;
+  vnl_parallel::set_max_threads( 1 );
+  tree.n_nearest( queries, n, batch1 );
+  tree.n_nearest( queries, n, heap1, true, 3 );
+  vnl_parallel::set_max_threads( 4 );
+  tree.n_nearest( queries, n, batch4 );
+  tree.n_nearest( queries, n, heap4, true, 3 );
+  vnl_parallel::set_max_threads( old_threads );
+  TEST( "batched results identical with 1 and 4 threads", batch1 == batch4 && heap1 == heap4, true );
+
+  // approximate search: every result is within (1+eps) of the true distance
+  const double eps = 0.5;
+  std::vector< std::vector< int > > approx;
+  tree.n_nearest( queries, n, approx, false, -1, eps );
+  bool within = true;
+  for ( int q=0; within && q<Q; ++q ) {
+    within = approx[q].size() == (unsigned int)n;
+    for ( int i=0; within && i<n; ++i )
+      within = rsdl_dist( queries[q], points[ approx[q][i] ] )
+            <= (1+eps) * rsdl_dist( queries[q], points[ batch1[q][i] ] ) + 1e-12;
+  }
+  TEST( "eps-approximate n_nearest within (1+eps)", within, true );
+  tree.n_nearest( queries, n, approx, true, -1, eps );
+  within = true;
+  for ( int q=0; within && q<Q; ++q )
+    for ( int i=0; within && i<n; ++i )
+      within = rsdl_dist( queries[q], points[ approx[q][i] ] )
+            <= (1+eps) * rsdl_dist( queries[q], points[ batch1[q][i] ] ) + 1e-12;
+  TEST( "eps-approximate n_nearest with heap within (1+eps)", within, true );
+
+  // fewer points than asked for
+  std::vector< rsdl_point > few( points.begin(), points.begin()+3 );
+  rsdl_kd_tree small_tree( few, 0, 2 );
+  std::vector< rsdl_point > cpoints;
+  std::vector< int > cindices;
+  small_tree.n_nearest( queries[0], 5, cpoints, cindices );
+  TEST( "All points found when fewer than n", cpoints.size() == 3 && cindices.size() == 3, true );
+}
+
 static void test_kd_tree()
 {
   int Nc=2, Na=3;
@@ -304,6 +385,8 @@ static void test_kd_tree()
     testlib_test_perform( inside_count==radius_points.size() && disagree_pt==0
                           && disagree_index==0 );
   }
+
+  test_kd_tree_batch();
 }
 
 TESTMAIN(test_kd_tree);
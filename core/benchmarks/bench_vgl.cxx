@@ -0,0 +1,122 @@
+// This is core/benchmarks/bench_vgl.cxx
+//:
+// \file
+// \brief Benchmarks of vgl and vgl_algo
+
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <iosfwd>
+#include <vector>
+#include "vxl_benchmark.h"
+#include <vgl/vgl_point_2d.h>
+#include <vgl/vgl_point_3d.h>
+#include <vgl/vgl_polygon.h>
+#include <vgl/vgl_polygon_test.h>
+#include <vgl/algo/vgl_convex_hull_2d.h>
+#include <vgl/algo/vgl_fit_plane_3d.h>
+#include <vnl/vnl_random.h>
+
+static std::string vxl_benchmark_name(char const* function, unsigned size)
+{
+  std::ostringstream s;
+  s << function << "/double/" << size;
+  return s.str();
+}
+
+//: Base for benchmarks on a cloud of random 2d points
+class vgl_points_2d_benchmark : public vxl_benchmark
+{
+ public:
+  vgl_points_2d_benchmark(char const* function, unsigned size)
+  : vxl_benchmark(vxl_benchmark_name(function, size)), size_(size) {}
+  virtual void setup()
+  {
+    vnl_random rng(3141);
+    points_.clear();
+    for (unsigned k = 0; k < size_; ++k)
+      points_.push_back(vgl_point_2d<double>(rng.normal64(), rng.normal64()));
+  }
+  virtual void teardown() { points_.clear(); }
+  virtual double bytes_per_op() const { return double(size_) * sizeof(vgl_point_2d<double>); }
+ protected:
+  unsigned size_;
+  std::vector<vgl_point_2d<double> > points_;
+};
+
+class vgl_convex_hull_2d_benchmark : public vgl_points_2d_benchmark
+{
+ public:
+  vgl_convex_hull_2d_benchmark(unsigned size)
+  : vgl_points_2d_benchmark("vgl_convex_hull_2d", size) {}
+  virtual void run()
+  {
+    vgl_convex_hull_2d<double> hull(points_);
+    vxl_benchmark_keep(hull.hull().num_vertices());
+  }
+};
+
+//: Test every point against a star shaped polygon of 100 vertices
+class vgl_polygon_test_inside_benchmark : public vgl_points_2d_benchmark
+{
+ public:
+  vgl_polygon_test_inside_benchmark(unsigned size)
+  : vgl_points_2d_benchmark("vgl_polygon_test_inside", size) {}
+  virtual void setup()
+  {
+    vgl_points_2d_benchmark::setup();
+    xs_.clear(); ys_.clear();
+    for (unsigned k = 0; k < 100; ++k)
+    {
+      const double a = 2*3.14159265358979*k/100, r = k%2 ? 1.0 : 2.0;
+      xs_.push_back(r*std::cos(a));
+      ys_.push_back(r*std::sin(a));
+    }
+  }
+  virtual void run()
+  {
+    unsigned inside = 0;
+    for (unsigned k = 0; k < points_.size(); ++k)
+      inside += vgl_polygon_test_inside(&xs_[0], &ys_[0], 100, points_[k].x(), points_[k].y());
+    vxl_benchmark_keep(inside);
+  }
+ private:
+  std::vector<double> xs_, ys_;
+};
+
+class vgl_fit_plane_3d_benchmark : public vxl_benchmark
+{
+ public:
+  vgl_fit_plane_3d_benchmark(unsigned size)
+  : vxl_benchmark(vxl_benchmark_name("vgl_fit_plane_3d", size)), size_(size) {}
+  virtual void setup()
+  {
+    vnl_random rng(2718);
+    points_.clear();
+    for (unsigned k = 0; k < size_; ++k)
+    {
+      const double x = rng.drand64(-10, 10), y = rng.drand64(-10, 10);
+      points_.push_back(vgl_point_3d<double>(x, y, 0.5*x - 0.25*y + 3 + 0.01*rng.normal64()));
+    }
+  }
+  virtual void run()
+  {
+    vgl_fit_plane_3d<double> fitter;
+    for (unsigned k = 0; k < points_.size(); ++k)
+      fitter.add_point(points_[k].x(), points_[k].y(), points_[k].z());
+    std::ostream* no_output = VXL_NULLPTR;
+    vxl_benchmark_keep(fitter.fit(no_output));
+  }
+  virtual void teardown() { points_.clear(); }
+  virtual double bytes_per_op() const { return double(size_) * sizeof(vgl_point_3d<double>); }
+ private:
+  unsigned size_;
+  std::vector<vgl_point_3d<double> > points_;
+};
+
+void vxl_add_vgl_benchmarks(vxl_benchmark_registry& registry)
+{
+  registry.add(new vgl_convex_hull_2d_benchmark(10000));
+  registry.add(new vgl_polygon_test_inside_benchmark(10000));
+  registry.add(new vgl_fit_plane_3d_benchmark(10000));
+}
@@ -0,0 +1,165 @@
+// This is core/benchmarks/bench_vil.cxx
+//:
+// \file
+// \brief Benchmarks of vil and vil_algo
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include "vxl_benchmark.h"
+#include <vxl_config.h> // for vxl_byte
+#include <vil/vil_config.h> // for HAS_TIFF
+#include <vil/vil_image_view.h>
+#include <vil/vil_load.h>
+#include <vil/vil_save.h>
+#include <vil/vil_resample_bilin.h>
+#include <vil/vil_convert.h>
+#include <vil/algo/vil_gauss_reduce.h>
+#include <vil/algo/vil_gauss_filter.h>
+#include <vil/algo/vil_convolve_1d.h>
+#include <vul/vul_temp_filename.h>
+#include <vpl/vpl.h> // vpl_unlink()
+
+//: Fill an image with a reproducible pattern with some texture
+template <class T>
+static void vxl_benchmark_fill(vil_image_view<T>& im)
+{
+  unsigned x = 12345u;
+  for (unsigned p = 0; p < im.nplanes(); ++p)
+    for (unsigned j = 0; j < im.nj(); ++j)
+      for (unsigned i = 0; i < im.ni(); ++i)
+      {
+        x = x*1103515245u + 12345u;
+        im(i,j,p) = T(((i + 2*j + 50*p) & 0x7f) + ((x >> 16) & 0x3f));
+      }
+}
+
+static std::string vxl_benchmark_name(char const* function, char const* type, unsigned size)
+{
+  std::ostringstream s;
+  s << function << '/' << type << '/' << size;
+  return s.str();
+}
+
+//: Base for benchmarks on a square single plane source image
+template <class T>
+class vil_image_benchmark : public vxl_benchmark
+{
+ public:
+  vil_image_benchmark(char const* function, char const* type, unsigned size, unsigned nplanes = 1)
+  : vxl_benchmark(vxl_benchmark_name(function, type, size)), size_(size), nplanes_(nplanes) {}
+  virtual void setup() { src_.set_size(size_, size_, nplanes_); vxl_benchmark_fill(src_); }
+  virtual void teardown() { src_ = vil_image_view<T>(); }
+  virtual double bytes_per_op() const { return double(src_.size()) * sizeof(T); }
+ protected:
+  unsigned size_, nplanes_;
+  vil_image_view<T> src_;
+};
+
+template <class T>
+class vil_gauss_reduce_benchmark : public vil_image_benchmark<T>
+{
+ public:
+  vil_gauss_reduce_benchmark(char const* type, unsigned size)
+  : vil_image_benchmark<T>("vil_gauss_reduce", type, size) {}
+  virtual void run()
+  {
+    vil_gauss_reduce(this->src_, dest_, work_);
+    vxl_benchmark_keep(dest_(0,0));
+  }
+ private:
+  vil_image_view<T> dest_, work_;
+};
+
+template <class T>
+class vil_resample_bilin_benchmark : public vil_image_benchmark<T>
+{
+ public:
+  vil_resample_bilin_benchmark(char const* type, unsigned size)
+  : vil_image_benchmark<T>("vil_resample_bilin", type, size) {}
+  //: Scale by 0.75 with a small rotation
+  virtual void run()
+  {
+    const unsigned n = this->size_ * 3 / 4;
+    vil_resample_bilin(this->src_, dest_, 1.0, 2.0, 1.3, 0.02, 0.02, 1.3, n, n);
+    vxl_benchmark_keep(dest_(0,0));
+  }
+ private:
+  vil_image_view<T> dest_;
+};
+
+template <class T>
+class vil_gauss_filter_2d_benchmark : public vil_image_benchmark<T>
+{
+ public:
+  vil_gauss_filter_2d_benchmark(char const* type, unsigned size)
+  : vil_image_benchmark<T>("vil_gauss_filter_2d", type, size) {}
+  virtual void run()
+  {
+    vil_gauss_filter_2d(this->src_, dest_, 2.0, 6);
+    vxl_benchmark_keep(dest_(0,0));
+  }
+ private:
+  vil_image_view<T> dest_;
+};
+
+class vil_convolve_1d_benchmark : public vil_image_benchmark<float>
+{
+ public:
+  vil_convolve_1d_benchmark(unsigned size)
+  : vil_image_benchmark<float>("vil_convolve_1d", "float", size), kernel_(9, 1.0f/9) {}
+  virtual void run()
+  {
+    vil_convolve_1d(src_, dest_, &kernel_[4], -4, 4, float(),
+                    vil_convolve_constant_extend, vil_convolve_constant_extend);
+    vxl_benchmark_keep(dest_(0,0));
+  }
+ private:
+  std::vector<float> kernel_;
+  vil_image_view<float> dest_;
+};
+
+//: Save and load an RGB image through a file in a given format
+class vil_save_load_benchmark : public vil_image_benchmark<vxl_byte>
+{
+ public:
+  vil_save_load_benchmark(char const* format, unsigned size)
+  : vil_image_benchmark<vxl_byte>("vil_save_load", format, size, 3), format_(format) {}
+  virtual void setup()
+  {
+    vil_image_benchmark<vxl_byte>::setup();
+    filename_ = vul_temp_filename() + '.' + format_;
+  }
+  virtual void run()
+  {
+    vil_save(src_, filename_.c_str(), format_.c_str());
+    vil_image_view<vxl_byte> loaded = vil_load(filename_.c_str());
+    vxl_benchmark_keep(loaded(0,0));
+  }
+  virtual void teardown()
+  {
+    vpl_unlink(filename_.c_str());
+    vil_image_benchmark<vxl_byte>::teardown();
+  }
+ private:
+  std::string format_, filename_;
+};
+
+void vxl_add_vil_benchmarks(vxl_benchmark_registry& registry)
+{
+  const unsigned sizes[] = { 512, 2048 };
+  for (unsigned k = 0; k < 2; ++k)
+  {
+    registry.add(new vil_gauss_reduce_benchmark<vxl_byte>("byte", sizes[k]));
+    registry.add(new vil_gauss_reduce_benchmark<float>("float", sizes[k]));
+    registry.add(new vil_resample_bilin_benchmark<vxl_byte>("byte", sizes[k]));
+    registry.add(new vil_resample_bilin_benchmark<float>("float", sizes[k]));
+    registry.add(new vil_gauss_filter_2d_benchmark<vxl_byte>("byte", sizes[k]));
+    registry.add(new vil_gauss_filter_2d_benchmark<float>("float", sizes[k]));
+    registry.add(new vil_convolve_1d_benchmark(sizes[k]));
+  }
+  registry.add(new vil_save_load_benchmark("pnm", 1024));
+#if HAS_TIFF
+  registry.add(new vil_save_load_benchmark("tiff", 1024));
+#endif
+}
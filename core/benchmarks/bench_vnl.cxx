@@ -0,0 +1,114 @@
+// This is core/benchmarks/bench_vnl.cxx
+//:
+// \file
+// \brief Benchmarks of vnl and vnl_algo
+
+#include <sstream>
+#include <string>
+#include "vxl_benchmark.h"
+#include <vnl/vnl_matrix.h>
+#include <vnl/vnl_vector.h>
+#include <vnl/vnl_random.h>
+#include <vnl/algo/vnl_svd.h>
+#include <vnl/algo/vnl_qr.h>
+
+static std::string vxl_benchmark_name(char const* function, unsigned size)
+{
+  std::ostringstream s;
+  s << function << "/double/" << size;
+  return s.str();
+}
+
+//: Base for benchmarks on a random square matrix
+class vnl_matrix_benchmark : public vxl_benchmark
+{
+ public:
+  vnl_matrix_benchmark(char const* function, unsigned size)
+  : vxl_benchmark(vxl_benchmark_name(function, size)), size_(size) {}
+  virtual void setup()
+  {
+    vnl_random rng(9667566);
+    a_.set_size(size_, size_);
+    b_.set_size(size_, size_);
+    for (unsigned i = 0; i < size_; ++i)
+      for (unsigned j = 0; j < size_; ++j)
+      {
+        a_(i,j) = rng.drand64(-1.0, 1.0);
+        b_(i,j) = rng.drand64(-1.0, 1.0);
+      }
+  }
+  virtual void teardown() { a_.clear(); b_.clear(); }
+  virtual double bytes_per_op() const { return double(size_) * size_ * sizeof(double); }
+ protected:
+  unsigned size_;
+  vnl_matrix<double> a_, b_;
+};
+
+class vnl_matrix_multiply_benchmark : public vnl_matrix_benchmark
+{
+ public:
+  vnl_matrix_multiply_benchmark(unsigned size)
+  : vnl_matrix_benchmark("vnl_matrix_multiply", size) {}
+  virtual void run()
+  {
+    vnl_matrix<double> c = a_ * b_;
+    vxl_benchmark_keep(c(0,0));
+  }
+};
+
+class vnl_svd_benchmark : public vnl_matrix_benchmark
+{
+ public:
+  vnl_svd_benchmark(unsigned size) : vnl_matrix_benchmark("vnl_svd", size) {}
+  virtual void run()
+  {
+    vnl_svd<double> svd(a_);
+    vxl_benchmark_keep(svd.W(0));
+  }
+};
+
+class vnl_qr_solve_benchmark : public vnl_matrix_benchmark
+{
+ public:
+  vnl_qr_solve_benchmark(unsigned size) : vnl_matrix_benchmark("vnl_qr_solve", size) {}
+  virtual void run()
+  {
+    vnl_qr<double> qr(a_);
+    vnl_vector<double> x = qr.solve(b_.get_column(0));
+    vxl_benchmark_keep(x[0]);
+  }
+};
+
+class vnl_vector_dot_benchmark : public vxl_benchmark
+{
+ public:
+  vnl_vector_dot_benchmark(unsigned size)
+  : vxl_benchmark(vxl_benchmark_name("vnl_vector_dot", size)), size_(size) {}
+  virtual void setup()
+  {
+    vnl_random rng(1234);
+    a_.set_size(size_);
+    b_.set_size(size_);
+    for (unsigned i = 0; i < size_; ++i)
+    {
+      a_[i] = rng.drand64(-1.0, 1.0);
+      b_[i] = rng.drand64(-1.0, 1.0);
+    }
+  }
+  virtual void run() { vxl_benchmark_keep(dot_product(a_, b_)); }
+  virtual void teardown() { a_.clear(); b_.clear(); }
+  virtual double bytes_per_op() const { return 2.0 * size_ * sizeof(double); }
+ private:
+  unsigned size_;
+  vnl_vector<double> a_, b_;
+};
+
+void vxl_add_vnl_benchmarks(vxl_benchmark_registry& registry)
+{
+  registry.add(new vnl_matrix_multiply_benchmark(64));
+  registry.add(new vnl_matrix_multiply_benchmark(512));
+  registry.add(new vnl_svd_benchmark(20));
+  registry.add(new vnl_svd_benchmark(200));
+  registry.add(new vnl_qr_solve_benchmark(200));
+  registry.add(new vnl_vector_dot_benchmark(1000000));
+}
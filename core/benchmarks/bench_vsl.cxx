@@ -0,0 +1,127 @@
+// This is core/benchmarks/bench_vsl.cxx
+//:
+// \file
+// \brief Benchmarks of vsl binary i/o
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include "vxl_benchmark.h"
+#include <vsl/vsl_binary_io.h>
+#include <vsl/vsl_vector_io.h>
+#include <vnl/vnl_matrix.h>
+#include <vnl/vnl_random.h>
+#include <vnl/io/vnl_io_matrix.h>
+
+static std::string vxl_benchmark_name(char const* function, char const* type, unsigned size)
+{
+  std::ostringstream s;
+  s << function << '/' << type << '/' << size;
+  return s.str();
+}
+
+//: Write an object to a memory stream, or read it back
+template <class T>
+class vsl_io_benchmark : public vxl_benchmark
+{
+ public:
+  vsl_io_benchmark(char const* function, char const* type, unsigned size, bool read)
+  : vxl_benchmark(vxl_benchmark_name(function, type, size)), read_(read) {}
+  virtual void setup()
+  {
+    std::ostringstream buffer;
+    vsl_b_ostream os(&buffer);
+    vsl_b_write(os, data_);
+    bytes_ = buffer.str();
+  }
+  virtual void run()
+  {
+    if (read_)
+    {
+      std::istringstream buffer(bytes_);
+      vsl_b_istream is(&buffer);
+      T loaded;
+      vsl_b_read(is, loaded);
+      vxl_benchmark_keep(loaded.size());
+    }
+    else
+    {
+      std::ostringstream buffer;
+      vsl_b_ostream os(&buffer);
+      vsl_b_write(os, data_);
+      vxl_benchmark_keep(buffer.tellp());
+    }
+  }
+  virtual void teardown() { data_ = T(); bytes_.clear(); }
+  virtual double bytes_per_op() const { return double(bytes_.size()); }
+ protected:
+  bool read_;
+  T data_;
+  std::string bytes_;
+};
+
+class vsl_vector_double_benchmark : public vsl_io_benchmark<std::vector<double> >
+{
+ public:
+  vsl_vector_double_benchmark(unsigned size, bool read)
+  : vsl_io_benchmark<std::vector<double> >(read ? "vsl_b_read" : "vsl_b_write",
+                                           "vector_double", size, read), size_(size) {}
+  virtual void setup()
+  {
+    vnl_random rng(42);
+    data_.resize(size_);
+    for (unsigned k = 0; k < size_; ++k)
+      data_[k] = rng.normal64();
+    vsl_io_benchmark<std::vector<double> >::setup();
+  }
+ private:
+  unsigned size_;
+};
+
+//: Integers are written in a compressed form, so are slower than doubles
+class vsl_vector_int_benchmark : public vsl_io_benchmark<std::vector<int> >
+{
+ public:
+  vsl_vector_int_benchmark(unsigned size, bool read)
+  : vsl_io_benchmark<std::vector<int> >(read ? "vsl_b_read" : "vsl_b_write",
+                                        "vector_int", size, read), size_(size) {}
+  virtual void setup()
+  {
+    vnl_random rng(43);
+    data_.resize(size_);
+    for (unsigned k = 0; k < size_; ++k)
+      data_[k] = rng.lrand32(-100000, 100000);
+    vsl_io_benchmark<std::vector<int> >::setup();
+  }
+ private:
+  unsigned size_;
+};
+
+class vsl_vnl_matrix_benchmark : public vsl_io_benchmark<vnl_matrix<double> >
+{
+ public:
+  vsl_vnl_matrix_benchmark(unsigned size, bool read)
+  : vsl_io_benchmark<vnl_matrix<double> >(read ? "vsl_b_read" : "vsl_b_write",
+                                          "vnl_matrix_double", size, read), size_(size) {}
+  virtual void setup()
+  {
+    vnl_random rng(44);
+    data_.set_size(size_, size_);
+    for (unsigned i = 0; i < size_; ++i)
+      for (unsigned j = 0; j < size_; ++j)
+        data_(i,j) = rng.drand64();
+    vsl_io_benchmark<vnl_matrix<double> >::setup();
+  }
+ private:
+  unsigned size_;
+};
+
+void vxl_add_vsl_benchmarks(vxl_benchmark_registry& registry)
+{
+  for (unsigned read = 0; read < 2; ++read)
+  {
+    registry.add(new vsl_vector_double_benchmark(1000000, read != 0));
+    registry.add(new vsl_vector_int_benchmark(1000000, read != 0));
+    registry.add(new vsl_vnl_matrix_benchmark(512, read != 0));
+  }
+}
@@ -0,0 +1,267 @@
+// This is core/benchmarks/vxl_benchmark.cxx
+//:
+// \file
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include "vxl_benchmark.h"
+#include <vxl_version.h>
+#if VXL_FULLCXX11SUPPORT
+# include <chrono>
+# include <thread>
+#endif
+
+//: Wall clock time in seconds
+static double vxl_benchmark_now()
+{
+#if VXL_FULLCXX11SUPPORT
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+  return double(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+vxl_benchmark_registry::~vxl_benchmark_registry()
+{
+  for (unsigned i = 0; i < benchmarks_.size(); ++i)
+    delete benchmarks_[i];
+}
+
+std::vector<vxl_benchmark_result>
+vxl_benchmark_registry::run(std::string const& filter,
+                            vxl_benchmark_options const& options,
+                            std::ostream& progress) const
+{
+  std::vector<vxl_benchmark_result> results;
+  for (unsigned i = 0; i < benchmarks_.size(); ++i)
+  {
+    if (!filter.empty() && benchmarks_[i]->name().find(filter) == std::string::npos)
+      continue;
+    vxl_benchmark_result r = vxl_benchmark_run(*benchmarks_[i], options);
+    progress << std::left << std::setw(44) << r.name << std::right
+             << ' ' << std::setw(12) << std::setprecision(4) << r.ns_per_op << " ns/op"
+             << ' ' << std::setw(10) << std::setprecision(4) << r.bytes_per_second/1e6 << " MB/s"
+             << ' ' << std::setw(9) << std::setprecision(3) << r.allocations_per_op << " allocs/op\n"
+             << std::flush;
+    results.push_back(r);
+  }
+  return results;
+}
+
+vxl_benchmark_result vxl_benchmark_run(vxl_benchmark& b, vxl_benchmark_options const& options)
+{
+  vxl_benchmark_result r;
+  r.name = b.name();
+  b.setup();
+
+  // Find an iteration count taking at least min_time (this also warms up)
+  unsigned long n = 1;
+  for (;;)
+  {
+    const double t0 = vxl_benchmark_now();
+    for (unsigned long k = 0; k < n; ++k)
+      b.run();
+    const double t = vxl_benchmark_now() - t0;
+    if (t >= options.min_time || n >= (1ul << 30))
+      break;
+    // aim a little beyond min_time, but never more than a tenfold increase
+    unsigned long next = t > 0 ? (unsigned long)(n * 1.4 * options.min_time / t) : 10*n;
+    n = std::min(std::max(next, 2*n), 10*n);
+  }
+
+  const unsigned reps = std::max(1u, options.repetitions);
+  std::vector<double> ns(reps);
+  unsigned long allocations = 0;
+  for (unsigned rep = 0; rep < reps; ++rep)
+  {
+    const unsigned long a0 = vxl_benchmark_allocation_count();
+    const double t0 = vxl_benchmark_now();
+    for (unsigned long k = 0; k < n; ++k)
+      b.run();
+    ns[rep] = (vxl_benchmark_now() - t0) * 1e9 / double(n);
+    allocations += vxl_benchmark_allocation_count() - a0;
+  }
+  const double bytes = b.bytes_per_op();
+  b.teardown();
+
+  std::sort(ns.begin(), ns.end());
+  r.iterations = n;
+  r.repetitions = reps;
+  r.ns_per_op = reps % 2 ? ns[reps/2] : 0.5*(ns[reps/2-1] + ns[reps/2]);
+  r.ns_per_op_min = ns[0];
+  r.bytes_per_second = r.ns_per_op > 0 ? bytes * 1e9 / r.ns_per_op : 0.0;
+  r.allocations_per_op = double(allocations) / (double(n) * reps);
+  return r;
+}
+
+static std::string vxl_benchmark_quote(std::string const& s)
+{
+  std::string q("\"");
+  for (unsigned i = 0; i < s.size(); ++i)
+  {
+    if (s[i] == '"' || s[i] == '\\') q += '\\';
+    q += s[i];
+  }
+  return q + '"';
+}
+
+void vxl_benchmark_write_json(std::ostream& os, std::vector<vxl_benchmark_result> const& results)
+{
+  char date[32] = "";
+  std::time_t now = std::time(VXL_NULLPTR);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+  unsigned hardware_threads = 1;
+#if VXL_FULLCXX11SUPPORT
+  hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+#endif
+  std::ostringstream compiler;
+#if defined(__clang__)
+  compiler << "clang " << __clang_major__ << '.' << __clang_minor__;
+#elif defined(__GNUC__)
+  compiler << "gcc " << __GNUC__ << '.' << __GNUC_MINOR__;
+#elif defined(_MSC_VER)
+  compiler << "msvc " << _MSC_VER;
+#else
+  compiler << "unknown";
+#endif
+
+  os << "{\n  \"context\": {\n"
+     << "    \"vxl_version\": " << vxl_benchmark_quote(VXL_VERSION_STRING) << ",\n"
+     << "    \"compiler\": " << vxl_benchmark_quote(compiler.str()) << ",\n"
+#ifdef NDEBUG
+     << "    \"assertions\": false,\n"
+#else
+     << "    \"assertions\": true,\n"
+#endif
+     << "    \"hardware_threads\": " << hardware_threads << ",\n"
+     << "    \"date\": " << vxl_benchmark_quote(date) << "\n"
+     << "  },\n  \"benchmarks\": [";
+  std::streamsize old_precision = os.precision(10);
+  for (unsigned i = 0; i < results.size(); ++i)
+  {
+    vxl_benchmark_result const& r = results[i];
+    os << (i ? ",\n" : "\n")
+       << "    {\"name\": " << vxl_benchmark_quote(r.name)
+       << ", \"iterations\": " << r.iterations
+       << ", \"repetitions\": " << r.repetitions
+       << ", \"ns_per_op\": " << r.ns_per_op
+       << ", \"ns_per_op_min\": " << r.ns_per_op_min
+       << ", \"bytes_per_second\": " << r.bytes_per_second
+       << ", \"allocations_per_op\": " << r.allocations_per_op << '}';
+  }
+  os.precision(old_precision);
+  os << "\n  ]\n}\n";
+}
+
+//: Read a quoted string starting at s[i]; i is left after the closing quote
+static std::string vxl_benchmark_unquote(std::string const& s, std::size_t& i)
+{
+  std::string v;
+  for (++i; i < s.size() && s[i] != '"'; ++i)
+  {
+    if (s[i] == '\\' && i+1 < s.size()) ++i;
+    v += s[i];
+  }
+  ++i;
+  return v;
+}
+
+bool vxl_benchmark_read_json(std::istream& is, std::vector<vxl_benchmark_result>& results)
+{
+  std::string s((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+  std::size_t i = s.find("\"benchmarks\"");
+  if (i == std::string::npos || (i = s.find('[', i)) == std::string::npos)
+    return false;
+  // Each benchmark is a flat object of string and number members
+  while ((i = s.find_first_of("{]", i)) != std::string::npos && s[i] == '{')
+  {
+    std::map<std::string, std::string> members;
+    ++i;
+    while (i < s.size() && s[i] != '}')
+    {
+      if (s[i] != '"') { ++i; continue; }
+      std::string key = vxl_benchmark_unquote(s, i);
+      i = s.find_first_not_of(" \t\r\n:", i);
+      if (i == std::string::npos) return false;
+      if (s[i] == '"')
+        members[key] = vxl_benchmark_unquote(s, i);
+      else
+      {
+        std::size_t e = s.find_first_of(",}", i);
+        if (e == std::string::npos) return false;
+        members[key] = s.substr(i, e - i);
+        i = e;
+      }
+    }
+    if (members.find("name") == members.end() || members.find("ns_per_op") == members.end())
+      return false;
+    vxl_benchmark_result r;
+    r.name = members["name"];
+    r.iterations = std::strtoul(members["iterations"].c_str(), VXL_NULLPTR, 10);
+    r.repetitions = (unsigned)std::strtoul(members["repetitions"].c_str(), VXL_NULLPTR, 10);
+    r.ns_per_op = std::strtod(members["ns_per_op"].c_str(), VXL_NULLPTR);
+    r.ns_per_op_min = std::strtod(members["ns_per_op_min"].c_str(), VXL_NULLPTR);
+    r.bytes_per_second = std::strtod(members["bytes_per_second"].c_str(), VXL_NULLPTR);
+    r.allocations_per_op = std::strtod(members["allocations_per_op"].c_str(), VXL_NULLPTR);
+    results.push_back(r);
+  }
+  return i != std::string::npos;
+}
+
+unsigned vxl_benchmark_compare(std::vector<vxl_benchmark_result> const& baseline,
+                               std::vector<vxl_benchmark_result> const& current,
+                               double threshold, std::ostream& os)
+{
+  std::map<std::string, vxl_benchmark_result const*> base;
+  for (unsigned i = 0; i < baseline.size(); ++i)
+    base[baseline[i].name] = &baseline[i];
+
+  unsigned regressions = 0, improvements = 0, compared = 0;
+  os << std::left << std::setw(44) << "benchmark" << std::right
+     << std::setw(14) << "baseline ns" << std::setw(14) << "current ns"
+     << std::setw(10) << "change" << '\n';
+  for (unsigned i = 0; i < current.size(); ++i)
+  {
+    std::map<std::string, vxl_benchmark_result const*>::iterator it = base.find(current[i].name);
+    if (it == base.end())
+    {
+      os << std::left << std::setw(44) << current[i].name << "  (not in baseline)\n";
+      continue;
+    }
+    const double old_ns = it->second->ns_per_op, new_ns = current[i].ns_per_op;
+    const double old_allocations = it->second->allocations_per_op;
+    base.erase(it);
+    ++compared;
+    const double change = old_ns > 0 ? new_ns / old_ns - 1.0 : 0.0;
+    os << std::left << std::setw(44) << current[i].name << std::right << std::setprecision(4)
+       << std::setw(14) << old_ns << std::setw(14) << new_ns
+       << std::setw(9) << std::fixed << std::setprecision(1) << 100.0*change << '%'
+       << std::resetiosflags(std::ios::fixed);
+    if (change > threshold)
+    {
+      os << "  REGRESSION";
+      ++regressions;
+    }
+    else if (change < -threshold)
+    {
+      os << "  improved";
+      ++improvements;
+    }
+    if (current[i].allocations_per_op > old_allocations + 0.5)
+      os << "  (more allocations)";
+    os << '\n';
+  }
+  for (std::map<std::string, vxl_benchmark_result const*>::iterator it = base.begin();
+       it != base.end(); ++it)
+    os << std::left << std::setw(44) << it->first << "  (not in current results)\n";
+  os << std::right << compared << " compared, " << regressions << " regressions, "
+     << improvements << " improvements (threshold " << std::setprecision(3)
+     << 100.0*threshold << "%)\n";
+  return regressions;
+}
@@ -0,0 +1,148 @@
+// This is core/benchmarks/vxl_benchmark.h
+#ifndef vxl_benchmark_h_
+#define vxl_benchmark_h_
+//:
+// \file
+// \brief Minimal harness for timing the hot paths of the core libraries
+//
+// A benchmark is a class derived from vxl_benchmark.  setup() prepares
+// the data and run() performs the operation being timed once.  The
+// harness calls run() in a loop, doubling the iteration count until a
+// repetition takes at least the minimum time, then times several
+// repetitions and reports the median time per call.  The number of heap
+// allocations per call is counted as well, by the replacement operator
+// new of the vxl_benchmarks executable and by a vil_memory_allocator
+// which it installs to see the pixel buffers of vil images.
+//
+// Data are generated with fixed seeds, so runs on the same machine and
+// build are comparable.  Results are written as JSON and two result
+// files can be compared with vxl_benchmark_compare().
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <vcl_compiler.h>
+
+//: A single timed operation
+class vxl_benchmark
+{
+ public:
+  //: name is of the form library_function/pixel_type/size
+  vxl_benchmark(std::string const& name) : name_(name) {}
+  virtual ~vxl_benchmark() {}
+
+  std::string const& name() const { return name_; }
+
+  //: Prepare input data; called once before timing
+  virtual void setup() {}
+
+  //: The operation being timed
+  virtual void run() = 0;
+
+  //: Release the data made by setup()
+  virtual void teardown() {}
+
+  //: Bytes of input processed by one call of run(), or 0
+  virtual double bytes_per_op() const { return 0.0; }
+
+ private:
+  std::string name_;
+};
+
+//: The measurements of one benchmark
+struct vxl_benchmark_result
+{
+  vxl_benchmark_result()
+  : iterations(0), repetitions(0), ns_per_op(0.0), ns_per_op_min(0.0),
+    bytes_per_second(0.0), allocations_per_op(0.0) {}
+
+  std::string name;
+  //: calls of run() in each repetition
+  unsigned long iterations;
+  unsigned repetitions;
+  //: median over the repetitions
+  double ns_per_op;
+  //: fastest repetition
+  double ns_per_op_min;
+  //: from the median time; 0 if the benchmark gives no byte count
+  double bytes_per_second;
+  double allocations_per_op;
+};
+
+//: Controls how long each benchmark is run
+struct vxl_benchmark_options
+{
+  vxl_benchmark_options() : min_time(0.2), repetitions(5) {}
+  //: minimum duration of a repetition in seconds
+  double min_time;
+  unsigned repetitions;
+};
+
+//: Owns the benchmarks and runs those selected
+class vxl_benchmark_registry
+{
+ public:
+  ~vxl_benchmark_registry();
+
+  //: Take ownership of b
+  void add(vxl_benchmark* b) { benchmarks_.push_back(b); }
+
+  std::vector<vxl_benchmark*> const& benchmarks() const { return benchmarks_; }
+
+  //: Run each benchmark whose name contains filter (all if filter is empty)
+  std::vector<vxl_benchmark_result> run(std::string const& filter,
+                                        vxl_benchmark_options const& options,
+                                        std::ostream& progress) const;
+
+ private:
+  std::vector<vxl_benchmark*> benchmarks_;
+};
+
+//: Time one benchmark
+vxl_benchmark_result vxl_benchmark_run(vxl_benchmark& b, vxl_benchmark_options const& options);
+
+//: Number of heap allocations made so far (0 if not counted)
+unsigned long vxl_benchmark_allocation_count();
+
+//: Write results, with a description of the build and machine, as JSON
+void vxl_benchmark_write_json(std::ostream& os, std::vector<vxl_benchmark_result> const& results);
+
+//: Read the results from a file written by vxl_benchmark_write_json()
+bool vxl_benchmark_read_json(std::istream& is, std::vector<vxl_benchmark_result>& results);
+
+//: Print the change in time per call of the benchmarks in both sets.
+// A benchmark which became slower by more than the fraction threshold is
+// flagged as a regression; returns the number of regressions.
+unsigned vxl_benchmark_compare(std::vector<vxl_benchmark_result> const& baseline,
+                               std::vector<vxl_benchmark_result> const& current,
+                               double threshold, std::ostream& os);
+
+//: Stop the compiler from optimising away a computed value.
+// The compiler must assume that value, and any memory reachable from it,
+// is read here, so e.g. a whole output image is kept when one of its
+// pixels is passed.
+template <class T>
+inline void vxl_benchmark_keep(T const& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r"(&value) : "memory");
+#else
+  // read every byte of the value
+  static volatile unsigned char sink;
+  unsigned char const volatile* p = reinterpret_cast<unsigned char const volatile*>(&value);
+  for (unsigned i = 0; i < sizeof(T); ++i)
+    sink = p[i];
+#endif
+}
+
+// The benchmarks of each library
+void vxl_add_vil_benchmarks(vxl_benchmark_registry& registry);
+void vxl_add_vnl_benchmarks(vxl_benchmark_registry& registry);
+void vxl_add_vgl_benchmarks(vxl_benchmark_registry& registry);
+void vxl_add_vsl_benchmarks(vxl_benchmark_registry& registry);
+
+#endif // vxl_benchmark_h_
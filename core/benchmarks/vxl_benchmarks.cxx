@@ -0,0 +1,155 @@
+// This is core/benchmarks/vxl_benchmarks.cxx
+//:
+// \file
+// \brief Run the core library benchmarks, or compare two sets of results
+//
+// \verbatim
+//  vxl_benchmarks -list
+//  vxl_benchmarks [-filter vil_gauss] [-json results.json] [-min_time 0.2] [-repetitions 5]
+//  vxl_benchmarks -compare baseline.json -with current.json [-threshold 0.1]
+// \endverbatim
+// Running with -quick times each benchmark briefly, which is only useful
+// to check that they all work.  In comparison mode the exit status is 1
+// if any benchmark became slower by more than the threshold fraction.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include "vxl_benchmark.h"
+#include <vul/vul_arg.h>
+#include <vil/vil_memory_allocator.h>
+#if VXL_FULLCXX11SUPPORT
+# include <atomic>
+#endif
+
+// Count heap allocations by replacing the global operator new
+#if VXL_FULLCXX11SUPPORT
+static std::atomic<unsigned long> vxl_benchmark_allocations(0);
+#else
+static unsigned long vxl_benchmark_allocations = 0;
+#endif
+
+unsigned long vxl_benchmark_allocation_count()
+{
+  return vxl_benchmark_allocations;
+}
+
+void* operator new(std::size_t n)
+{
+  ++vxl_benchmark_allocations;
+  void* p = std::malloc(n ? n : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](std::size_t n)
+{
+  return operator new(n);
+}
+
+void operator delete(void* p) VXL_NOEXCEPT
+{
+  std::free(p);
+}
+
+void operator delete[](void* p) VXL_NOEXCEPT
+{
+  std::free(p);
+}
+
+//: Counts the pixel buffers of vil images, which do not come from operator new
+class vxl_benchmark_counting_allocator : public vil_memory_allocator
+{
+ public:
+  explicit vxl_benchmark_counting_allocator(vil_memory_allocator* upstream)
+  : upstream_(upstream) {}
+
+  virtual void* allocate(std::size_t n)
+  {
+    ++vxl_benchmark_allocations;
+    return upstream_->allocate(n);
+  }
+
+  virtual void deallocate(void* p, std::size_t n) { upstream_->deallocate(p, n); }
+
+ private:
+  vil_memory_allocator* upstream_;
+};
+
+static bool read_results(std::string const& filename, std::vector<vxl_benchmark_result>& results)
+{
+  std::ifstream is(filename.c_str());
+  if (!is || !vxl_benchmark_read_json(is, results))
+  {
+    std::cerr << "Unable to read benchmark results from " << filename << '\n';
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv)
+{
+  vul_arg<bool> list("-list", "List the benchmarks and exit", false);
+  vul_arg<std::string> filter("-filter", "Only run benchmarks whose name contains this", "");
+  vul_arg<std::string> json("-json", "Write the results to this JSON file", "");
+  vul_arg<double> min_time("-min_time", "Minimum time of each repetition (seconds)", 0.2);
+  vul_arg<unsigned> repetitions("-repetitions", "Number of timed repetitions", 5);
+  vul_arg<bool> quick("-quick", "Run each benchmark very briefly", false);
+  vul_arg<std::string> compare("-compare", "Baseline results to compare against", "");
+  vul_arg<std::string> with("-with", "Results to compare with the baseline (default: run now)", "");
+  vul_arg<double> threshold("-threshold", "Slow down counted as a regression (fraction)", 0.10);
+  vul_arg_parse(argc, argv);
+
+  // Every vil image allocated by the benchmarks goes through the counter.
+  // It is never destroyed, since images may outlive main().
+  vil_memory_allocator::set_default_allocator(
+    new vxl_benchmark_counting_allocator(vil_memory_allocator::default_allocator()));
+
+  vxl_benchmark_registry registry;
+  vxl_add_vil_benchmarks(registry);
+  vxl_add_vnl_benchmarks(registry);
+  vxl_add_vgl_benchmarks(registry);
+  vxl_add_vsl_benchmarks(registry);
+
+  if (list())
+  {
+    for (unsigned i = 0; i < registry.benchmarks().size(); ++i)
+      std::cout << registry.benchmarks()[i]->name() << '\n';
+    return 0;
+  }
+
+  std::vector<vxl_benchmark_result> baseline, current;
+  if (compare() != "" && !read_results(compare(), baseline))
+    return 2;
+
+  if (compare() != "" && with() != "")
+  {
+    if (!read_results(with(), current))
+      return 2;
+  }
+  else
+  {
+    vxl_benchmark_options options;
+    options.min_time = quick() ? 0.0 : min_time();
+    options.repetitions = quick() ? 1 : repetitions();
+    current = registry.run(filter(), options, std::cout);
+    if (json() != "")
+    {
+      std::ofstream os(json().c_str());
+      vxl_benchmark_write_json(os, current);
+      if (!os)
+      {
+        std::cerr << "Unable to write " << json() << '\n';
+        return 2;
+      }
+    }
+  }
+
+  if (compare() != "")
+    return vxl_benchmark_compare(baseline, current, threshold(), std::cout) > 0 ? 1 : 0;
+  return 0;
+}
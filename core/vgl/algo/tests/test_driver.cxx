@@ -15,6 +15,7 @@ DECLARE( test_h_matrix_3d );
 DECLARE( test_homg );
 DECLARE( test_intersection );
 DECLARE( test_orient_box_3d );
+DECLARE( test_packed_rtree );
 DECLARE( test_p_matrix );
 DECLARE( test_rotation_3d );
 DECLARE( test_rtree );
@@ -37,6 +38,7 @@ register_tests()
   REGISTER( test_homg );
   REGISTER( test_intersection );
   REGISTER( test_orient_box_3d );
+  REGISTER( test_packed_rtree );
   REGISTER( test_p_matrix );
   REGISTER( test_rotation_3d );
   REGISTER( test_rtree );
@@ -0,0 +1,224 @@
+// This is core/vgl/algo/tests/test_packed_rtree.cxx
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <vcl_compiler.h>
+#include <vgl/vgl_point_2d.h>
+#include <vgl/vgl_box_2d.h>
+#include <vgl/vgl_polygon.h>
+#include <vgl/algo/vgl_rtree.h>
+#include <vgl/algo/vgl_rtree_c.h>
+#include <vgl/algo/vgl_packed_rtree.h>
+#include <vnl/vnl_random.h>
+#include <vnl/vnl_parallel_for.h>
+#include <testlib/testlib_test.h>
+//:
+// \file
+// \brief Compare the queries of vgl_packed_rtree with brute force searches
+
+typedef vgl_rtree_point_box_2d<float> C_;
+typedef C_::v_type V_;
+typedef C_::b_type B_;
+
+static bool less_point(V_ const& a, V_ const& b)
+{
+  return a.x() < b.x() || (a.x() == b.x() && a.y() < b.y());
+}
+
+static std::vector<V_> random_points(unsigned n, vnl_random& rng)
+{
+  std::vector<V_> pts;
+  for (unsigned i = 0; i < n; ++i)
+    pts.push_back(V_(float(rng.drand64(0.0, 100.0)), float(rng.drand64(0.0, 100.0))));
+  return pts;
+}
+
+static B_ random_box(vnl_random& rng, double size)
+{
+  const double x = rng.drand64(-10.0, 100.0), y = rng.drand64(-10.0, 100.0);
+  return B_(float(x), float(x + rng.drand64(0.0, size)), float(y), float(y + rng.drand64(0.0, size)));
+}
+
+//: Check the structure: every node is at most full, and bounds what it refers to.
+static bool valid(vgl_packed_rtree<V_, B_, C_> const& tr)
+{
+  std::vector<vgl_packed_rtree<V_, B_, C_>::node> const& nodes = tr.node_array();
+  std::vector<bool> referred(tr.size(), false);
+  for (unsigned j = 0; j < nodes.size(); ++j) {
+    if (nodes[j].count == 0 || nodes[j].count > tr.fanout())
+      return false;
+    for (unsigned c = nodes[j].first; c < nodes[j].first + nodes[j].count; ++c) {
+      B_ const& b = j < tr.n_leaf_nodes() ? tr.element_bounds()[c] : nodes[c].bounds;
+      if (!nodes[j].bounds.contains(b))
+        return false;
+      if (j < tr.n_leaf_nodes())
+        referred[c] = true;
+    }
+  }
+  return std::find(referred.begin(), referred.end(), false) == referred.end();
+}
+
+static void test_point_box_queries()
+{
+  vnl_random rng(1234);
+  std::vector<V_> pts = random_points(5000, rng);
+  const unsigned fanouts[] = { 2, 4, 16, 64 };
+  for (unsigned f = 0; f < 4; ++f) {
+    vgl_packed_rtree<V_, B_, C_> tr(pts, fanouts[f]);
+    std::cout << "Fanout " << fanouts[f] << ": " << tr.nodes() << " nodes, "
+              << tr.n_leaf_nodes() << " leaves\n";
+    TEST("Size", tr.size(), pts.size());
+    TEST("Valid structure", valid(tr), true);
+    TEST("Leaves are full", tr.n_leaf_nodes(), (pts.size() + fanouts[f] - 1) / fanouts[f]);
+
+    bool range_ok = true;
+    for (unsigned q = 0; q < 100; ++q) {
+      B_ region = random_box(rng, 20.0);
+      std::vector<V_> found, expected;
+      tr.get(region, found);
+      for (unsigned i = 0; i < pts.size(); ++i)
+        if (C_::meet(region, pts[i]))
+          expected.push_back(pts[i]);
+      std::sort(found.begin(), found.end(), less_point);
+      std::sort(expected.begin(), expected.end(), less_point);
+      range_ok = range_ok && found == expected;
+    }
+    TEST("Range queries agree with brute force", range_ok, true);
+  }
+
+  vgl_packed_rtree<V_, B_, C_> tr(pts);
+  TEST("Contains an element", tr.contains(pts[1234]), true);
+  TEST("Does not contain another point", tr.contains(V_(-1.f, -1.f)), false);
+
+  // polygon probe
+  vgl_polygon<float> poly(1);
+  poly.push_back(10.f, 10.f); poly.push_back(60.f, 20.f); poly.push_back(30.f, 70.f);
+  vgl_rtree_polygon_probe<V_, B_, C_> probe(poly);
+  std::vector<V_> found;
+  tr.get(probe, found);
+  unsigned expected = 0;
+  for (unsigned i = 0; i < pts.size(); ++i)
+    if (probe.meets(pts[i]))
+      ++expected;
+  TEST("Polygon probe agrees with brute force", found.size(), expected);
+
+  // constructed from a dynamic rtree
+  vgl_rtree<V_, B_, C_> dyn;
+  for (unsigned i = 0; i < 500; ++i)
+    dyn.add(pts[i]);
+  vgl_packed_rtree<V_, B_, C_> from_dyn(dyn, 8);
+  std::vector<V_> all;
+  from_dyn.get_all(all);
+  std::sort(all.begin(), all.end(), less_point);
+  std::vector<V_> first(pts.begin(), pts.begin() + 500);
+  std::sort(first.begin(), first.end(), less_point);
+  TEST("Built from a vgl_rtree", all == first && valid(from_dyn), true);
+
+  // empty and tiny trees
+  vgl_packed_rtree<V_, B_, C_> empty(std::vector<V_>(), 8);
+  found.clear();
+  empty.get(B_(0.f, 100.f, 0.f, 100.f), found);
+  empty.nearest(V_(0.f, 0.f), 3, found);
+  TEST("Empty tree", empty.size() == 0 && empty.nodes() == 0 && found.empty() && !empty.contains(pts[0]), true);
+  vgl_packed_rtree<V_, B_, C_> one(std::vector<V_>(1, pts[0]), 8);
+  one.nearest(V_(0.f, 0.f), 3, found);
+  TEST("Single element", one.nodes() == 1 && found.size() == 1 && found[0] == pts[0], true);
+}
+
+static void test_nearest()
+{
+  vnl_random rng(42);
+  std::vector<V_> pts = random_points(3000, rng);
+  vgl_packed_rtree<V_, B_, C_> tr(pts, 12);
+  const unsigned k = 7;
+  bool ok = true;
+  for (unsigned q = 0; q < 200; ++q) {
+    V_ p(float(rng.drand64(-20.0, 120.0)), float(rng.drand64(-20.0, 120.0)));
+    std::vector<V_> found;
+    tr.nearest(p, k, found);
+    std::vector<double> d;
+    for (unsigned i = 0; i < pts.size(); ++i)
+      d.push_back(vgl_packed_rtree_sqr_distance(B_(pts[i], pts[i]), p));
+    std::sort(d.begin(), d.end());
+    ok = ok && found.size() == k;
+    for (unsigned i = 0; ok && i < k; ++i)
+      ok = vgl_packed_rtree_sqr_distance(B_(found[i], found[i]), p) == d[i];
+  }
+  TEST("k nearest agree with brute force", ok, true);
+  std::vector<V_> found;
+  tr.nearest(V_(50.f, 50.f), 5000, found);
+  TEST("k larger than size", found.size(), pts.size());
+}
+
+//: The batched queries must match single queries, with any number of threads.
+static void test_batch()
+{
+  vnl_random rng(7);
+  std::vector<V_> pts = random_points(40000, rng);
+  const unsigned old_threads = vnl_parallel::max_threads();
+  vnl_parallel::set_max_threads(1);
+  vgl_packed_rtree<V_, B_, C_> tr1(pts, 16);
+  vnl_parallel::set_max_threads(4);
+  vgl_packed_rtree<V_, B_, C_> tr4(pts, 16);
+  TEST("Same tree with 1 and 4 threads",
+       tr1.elements() == tr4.elements() && tr1.nodes() == tr4.nodes(), true);
+
+  std::vector<B_> regions;
+  std::vector<V_> points;
+  for (unsigned q = 0; q < 300; ++q) {
+    regions.push_back(random_box(rng, 5.0));
+    points.push_back(V_(float(rng.drand64(0.0, 100.0)), float(rng.drand64(0.0, 100.0))));
+  }
+  std::vector<std::vector<V_> > ranges4, nearest4, ranges1, nearest1;
+  tr4.get(regions, ranges4);
+  tr4.nearest(points, 5, nearest4);
+  vnl_parallel::set_max_threads(1);
+  tr4.get(regions, ranges1);
+  tr4.nearest(points, 5, nearest1);
+  vnl_parallel::set_max_threads(old_threads);
+
+  bool ok = ranges4.size() == regions.size() && nearest4.size() == points.size();
+  for (unsigned q = 0; ok && q < regions.size(); ++q) {
+    std::vector<V_> r, n;
+    tr4.get(regions[q], r);
+    tr4.nearest(points[q], 5, n);
+    ok = r == ranges4[q] && n == nearest4[q];
+  }
+  TEST("Batched queries match single queries", ok, true);
+  TEST("Batched queries identical with 1 and 4 threads", ranges1 == ranges4 && nearest1 == nearest4, true);
+}
+
+static void test_box_box()
+{
+  typedef vgl_rtree_box_box_2d<float> BC_;
+  typedef BC_::v_type BV_;
+  typedef BC_::b_type BB_;
+  vnl_random rng(99);
+  std::vector<BV_> boxes;
+  for (unsigned i = 0; i < 2000; ++i) {
+    const double x = rng.drand64(0.0, 100.0), y = rng.drand64(0.0, 100.0);
+    boxes.push_back(BV_(float(x), float(x + rng.drand64(0.0, 3.0)), float(y), float(y + rng.drand64(0.0, 3.0))));
+  }
+  vgl_packed_rtree<BV_, BB_, BC_> tr(boxes, 10);
+  std::vector<BV_> found;
+  tr.get(BB_(-1.f, 200.f, -1.f, 200.f), found);
+  TEST("All boxes found in a covering region", found.size(), boxes.size());
+  found.clear();
+  BB_ region(20.f, 30.f, 20.f, 30.f);
+  tr.get(region, found);
+  bool ok = !found.empty();
+  for (unsigned i = 0; i < found.size(); ++i)
+    ok = ok && BC_::meet(region, found[i]);
+  TEST("Boxes found meet the region", ok, true);
+  TEST("Contains a box", tr.contains(boxes[17]), true);
+}
+
+static void test_packed_rtree()
+{
+  test_point_box_queries();
+  test_nearest();
+  test_batch();
+  test_box_box();
+}
+
+TESTMAIN(test_packed_rtree);
@@ -0,0 +1,219 @@
+// This is core/vgl/algo/vgl_packed_rtree.h
+#ifndef vgl_packed_rtree_h_
+#define vgl_packed_rtree_h_
+//:
+// \file
+// \brief Read-only rtree, bulk loaded into flat arrays
+//
+// vgl_packed_rtree<V, B, C> holds the same kind of elements as
+// vgl_rtree<V, B, C> and answers the same queries, but it is built in one
+// go from all the elements by the Sort-Tile-Recursive method.  At each
+// level the entries are sorted on the x coordinate of the centre of their
+// bounds, cut into vertical slabs, sorted on y within each slab, and
+// packed into nodes of up to fanout() entries.  Nodes are therefore
+// (almost) full and spatially compact, which gives far fewer nodes to
+// visit per query than a tree grown one element at a time.
+//
+// The elements, their bounds and the nodes are stored in three arrays
+// rather than as separately allocated nodes, so a query walks contiguous
+// memory.  The nodes of each level refer to a contiguous range of the
+// level below; nodes [0, n_leaf_nodes()) refer to elements and the root is
+// the last node.  The tree cannot be modified after it is built, so all
+// the queries may run concurrently; the batched queries, and the sorting
+// while building, are themselves split across threads by vnl_parallel_for.
+//
+// B must provide centroid_x() and centroid_y(), as vgl_box_2d does; C must
+// provide init(B&, V const&), update(B&, B const&) and the two meet()
+// functions described in vgl_rtree.h.  The k-nearest queries additionally
+// need min_x(), max_x(), min_y() and max_y() on B; the distance to an
+// element is the distance to its bounds.
+//
+// vgl/io/vgl_io_packed_rtree.h writes and reads a packed tree, so that a
+// prebuilt index can be loaded without rebuilding it.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+#include <vcl_compiler.h>
+#include <vgl/algo/vgl_rtree.h>
+#include <vnl/vnl_parallel_for.h>
+
+//: Squared distance from point p to the box b (zero inside the box).
+template <class B, class P>
+inline double vgl_packed_rtree_sqr_distance(B const& b, P const& p)
+{
+  double dx = 0.0, dy = 0.0;
+  if (p.x() < b.min_x()) dx = double(b.min_x()) - double(p.x());
+  else if (p.x() > b.max_x()) dx = double(p.x()) - double(b.max_x());
+  if (p.y() < b.min_y()) dy = double(b.min_y()) - double(p.y());
+  else if (p.y() > b.max_y()) dy = double(p.y()) - double(b.max_y());
+  return dx*dx + dy*dy;
+}
+
+//: Read-only rtree, bulk loaded by Sort-Tile-Recursive into flat arrays.
+template <class V, class B, class C>
+class vgl_packed_rtree
+{
+ public:
+  //: A node: the bounds of, and a range of entries in, the level below.
+  struct node
+  {
+    B bounds;
+    unsigned first;
+    unsigned count;
+  };
+
+  //: Construct an empty tree.
+  vgl_packed_rtree() : fanout_(16), n_leaf_nodes_(0) {}
+
+  //: Bulk load the given elements, with at most \p fanout entries per node.
+  explicit vgl_packed_rtree(std::vector<V> const& vs, unsigned fanout = 16) { build(vs, fanout); }
+
+  //: Bulk load the elements of a dynamic rtree.
+  explicit vgl_packed_rtree(vgl_rtree<V, B, C> const& tree, unsigned fanout = 16);
+
+  //: Rebuild the tree from the given elements, with at most \p fanout entries per node.
+  void build(std::vector<V> const& vs, unsigned fanout = 16);
+
+  //: Set the arrays directly, e.g. when reading a stored tree.
+  void set(unsigned fanout, std::vector<V> const& elements, std::vector<B> const& element_bounds,
+           std::vector<node> const& nodes, unsigned n_leaf_nodes);
+
+  //: Number of elements stored in the tree.
+  unsigned size() const { return unsigned(elements_.size()); }
+
+  //: Return true iff the tree has no elements.
+  bool empty() const { return elements_.empty(); }
+
+  //: Number of nodes used by the tree.
+  unsigned nodes() const { return unsigned(nodes_.size()); }
+
+  //: Maximum number of entries per node.
+  unsigned fanout() const { return fanout_; }
+
+  //: Get elements which meet the given region, appended to \p vs.
+  void get(B const& region, std::vector<V>& vs) const;
+
+  //: Get elements which meet the given probe, appended to \p vs.
+  void get(vgl_rtree_probe<V, B, C> const& probe, std::vector<V>& vs) const;
+
+  //: Get the elements which meet each region; results[i] is set for regions[i].
+  void get(std::vector<B> const& regions, std::vector<std::vector<V> >& results) const;
+
+  //: Get all elements in the tree, appended to \p vs.
+  void get_all(std::vector<V>& vs) const { vs.insert(vs.end(), elements_.begin(), elements_.end()); }
+
+  //: Return true iff the tree contains an element equal to v.
+  bool contains(V const& v) const;
+
+  //: Set \p vs to the (up to) k elements nearest to point p, nearest first.
+  // Elements at equal distances are ordered as they are stored.
+  template <class P>
+  void nearest(P const& p, unsigned k, std::vector<V>& vs) const;
+
+  //: Set results[i] to the k elements nearest to points[i].
+  template <class P>
+  void nearest(std::vector<P> const& points, unsigned k, std::vector<std::vector<V> >& results) const;
+
+  //: The elements, in the order the leaf nodes refer to them.
+  std::vector<V> const& elements() const { return elements_; }
+
+  //: The bounds of each element.
+  std::vector<B> const& element_bounds() const { return element_bounds_; }
+
+  //: The nodes, from the leaves up to the root.
+  std::vector<node> const& node_array() const { return nodes_; }
+
+  //: Number of nodes whose entries are elements rather than nodes.
+  unsigned n_leaf_nodes() const { return n_leaf_nodes_; }
+
+ private:
+  unsigned fanout_;
+  std::vector<V> elements_;
+  std::vector<B> element_bounds_;
+  std::vector<node> nodes_;
+  unsigned n_leaf_nodes_;
+};
+
+//: Runs the range queries of vgl_packed_rtree::get() for a batch of regions.
+template <class V, class B, class C>
+struct vgl_packed_rtree_range_batch
+{
+  vgl_packed_rtree<V, B, C> const* tree;
+  std::vector<B> const* regions;
+  std::vector<std::vector<V> >* results;
+
+  void operator()(unsigned begin, unsigned end) const
+  {
+    for (unsigned i = begin; i < end; ++i) {
+      (*results)[i].clear();
+      tree->get((*regions)[i], (*results)[i]);
+    }
+  }
+};
+
+//: Runs the k-nearest queries of vgl_packed_rtree::nearest() for a batch of points.
+template <class V, class B, class C, class P>
+struct vgl_packed_rtree_nearest_batch
+{
+  vgl_packed_rtree<V, B, C> const* tree;
+  std::vector<P> const* points;
+  unsigned k;
+  std::vector<std::vector<V> >* results;
+
+  void operator()(unsigned begin, unsigned end) const
+  {
+    for (unsigned i = begin; i < end; ++i)
+      tree->nearest((*points)[i], k, (*results)[i]);
+  }
+};
+
+template <class V, class B, class C>
+template <class P>
+void vgl_packed_rtree<V, B, C>::nearest(P const& p, unsigned k, std::vector<V>& vs) const
+{
+  vs.clear();
+  if (nodes_.empty() || k == 0)
+    return;
+
+  // Best-first search.  An entry is (distance, index), where index < size()
+  // is an element and size()+j is node j; ties are taken in index order.
+  typedef std::pair<double, unsigned> entry;
+  std::priority_queue<entry, std::vector<entry>, std::greater<entry> > queue;
+  const unsigned n = size();
+  const unsigned root = unsigned(nodes_.size()) - 1;
+  queue.push(entry(vgl_packed_rtree_sqr_distance(nodes_[root].bounds, p), n + root));
+  while (!queue.empty() && vs.size() < k) {
+    const unsigned index = queue.top().second;
+    queue.pop();
+    if (index < n) {
+      vs.push_back(elements_[index]);
+      continue;
+    }
+    node const& nd = nodes_[index - n];
+    const bool leaf = index - n < n_leaf_nodes_;
+    for (unsigned c = nd.first; c < nd.first + nd.count; ++c) {
+      B const& b = leaf ? element_bounds_[c] : nodes_[c].bounds;
+      queue.push(entry(vgl_packed_rtree_sqr_distance(b, p), leaf ? c : n + c));
+    }
+  }
+}
+
+template <class V, class B, class C>
+template <class P>
+void vgl_packed_rtree<V, B, C>::nearest(std::vector<P> const& points, unsigned k,
+                                        std::vector<std::vector<V> >& results) const
+{
+  results.resize(points.size());
+  vgl_packed_rtree_nearest_batch<V, B, C, P> batch = { this, &points, k, &results };
+  vnl_parallel_for(0u, unsigned(points.size()), batch, 16u);
+}
+
+#define VGL_PACKED_RTREE_INSTANTIATE(V, B, C) extern "you must include vgl_packed_rtree.hxx first"
+
+#endif // vgl_packed_rtree_h_
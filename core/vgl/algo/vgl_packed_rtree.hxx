@@ -0,0 +1,318 @@
+// This is core/vgl/algo/vgl_packed_rtree.hxx
+#ifndef vgl_packed_rtree_hxx_
+#define vgl_packed_rtree_hxx_
+//:
+// \file
+
+#include <algorithm>
+#include <cmath>
+#include "vgl_packed_rtree.h"
+#include <vcl_cassert.h>
+
+//: Orders indices by key, ties by index, so that the order is unique.
+struct vgl_packed_rtree_key_less
+{
+  std::vector<double> const* key;
+  bool operator()(unsigned a, unsigned b) const
+  {
+    return (*key)[a] < (*key)[b] || ((*key)[a] == (*key)[b] && a < b);
+  }
+};
+
+//: Sorts each of the ranges [bounds[i], bounds[i+1]) of an index array.
+struct vgl_packed_rtree_sort_ranges
+{
+  std::vector<unsigned>* idx;
+  std::vector<unsigned> const* bounds;
+  vgl_packed_rtree_key_less less;
+
+  void operator()(unsigned begin, unsigned end) const
+  {
+    for (unsigned i = begin; i < end; ++i)
+      std::sort(idx->begin() + (*bounds)[i], idx->begin() + (*bounds)[i+1], less);
+  }
+};
+
+//: Merges pairs of adjacent sorted ranges, [bounds[2i], bounds[2i+1]) and [bounds[2i+1], bounds[2i+2]).
+struct vgl_packed_rtree_merge_ranges
+{
+  std::vector<unsigned>* idx;
+  std::vector<unsigned> const* bounds;
+  vgl_packed_rtree_key_less less;
+
+  void operator()(unsigned begin, unsigned end) const
+  {
+    for (unsigned i = begin; i < end; ++i)
+      std::inplace_merge(idx->begin() + (*bounds)[2*i], idx->begin() + (*bounds)[2*i+1],
+                         idx->begin() + (*bounds)[2*i+2], less);
+  }
+};
+
+//: Sort idx by key, sorting chunks in parallel and merging them pairwise.
+// The result does not depend on the number of threads, since the order is total.
+inline void vgl_packed_rtree_sort(std::vector<unsigned>& idx, std::vector<double> const& key)
+{
+  vgl_packed_rtree_key_less less = { &key };
+  const unsigned n = unsigned(idx.size());
+  const unsigned chunk = 8192;
+  if (n <= chunk || vnl_parallel::max_threads() < 2) {
+    std::sort(idx.begin(), idx.end(), less);
+    return;
+  }
+  std::vector<unsigned> bounds;
+  for (unsigned b = 0; b < n; b += chunk)
+    bounds.push_back(b);
+  bounds.push_back(n);
+  vgl_packed_rtree_sort_ranges sorter = { &idx, &bounds, less };
+  vnl_parallel_for(0u, unsigned(bounds.size()) - 1, sorter);
+  while (bounds.size() > 2) {
+    if (bounds.size() % 2 == 0)   // odd number of ranges: the last one waits
+      bounds.insert(bounds.end() - 1, n);
+    vgl_packed_rtree_merge_ranges merger = { &idx, &bounds, less };
+    vnl_parallel_for(0u, unsigned(bounds.size()) / 2, merger);
+    std::vector<unsigned> merged;
+    for (unsigned i = 0; i < bounds.size(); i += 2)
+      merged.push_back(bounds[i]);
+    if (merged.back() != n)
+      merged.push_back(n);
+    bounds.swap(merged);
+  }
+}
+
+//: The Sort-Tile-Recursive order of a set of bounds, packed \p fanout to a node.
+template <class B>
+std::vector<unsigned> vgl_packed_rtree_str_order(std::vector<B> const& bounds, unsigned fanout)
+{
+  const unsigned n = unsigned(bounds.size());
+  std::vector<unsigned> idx(n);
+  std::vector<double> cx(n), cy(n);
+  for (unsigned i = 0; i < n; ++i) {
+    idx[i] = i;
+    cx[i] = double(bounds[i].centroid_x());
+    cy[i] = double(bounds[i].centroid_y());
+  }
+  vgl_packed_rtree_sort(idx, cx);
+
+  // S vertical slabs of S nodes each, sorted on y within each slab
+  const unsigned n_nodes = (n + fanout - 1) / fanout;
+  const unsigned n_slabs = unsigned(std::ceil(std::sqrt(double(n_nodes))));
+  const unsigned slab = std::max(1u, (n_nodes + n_slabs - 1) / n_slabs) * fanout;
+  std::vector<unsigned> slab_bounds;
+  for (unsigned b = 0; b < n; b += slab)
+    slab_bounds.push_back(b);
+  slab_bounds.push_back(n);
+  vgl_packed_rtree_key_less less = { &cy };
+  vgl_packed_rtree_sort_ranges sorter = { &idx, &slab_bounds, less };
+  vnl_parallel_for(0u, unsigned(slab_bounds.size()) - 1, sorter);
+  return idx;
+}
+
+//: Computes the bounds of nodes [first, first+count) of a level from the level below.
+// Entry e of the level below has bounds below[e - offset].
+template <class V, class B, class C>
+struct vgl_packed_rtree_node_bounds
+{
+  typedef typename vgl_packed_rtree<V, B, C>::node node;
+  std::vector<node>* nodes;
+  std::vector<B> const* below;
+  unsigned first;
+  unsigned offset;
+
+  void operator()(unsigned begin, unsigned end) const
+  {
+    for (unsigned i = begin; i < end; ++i) {
+      node& nd = (*nodes)[first + i];
+      const unsigned b = nd.first - offset;
+      nd.bounds = (*below)[b];
+      for (unsigned c = b + 1; c < b + nd.count; ++c)
+        C::update(nd.bounds, (*below)[c]);
+    }
+  }
+};
+
+//: Computes the bounds of the elements.
+template <class V, class B, class C>
+struct vgl_packed_rtree_element_bounds
+{
+  std::vector<V> const* elements;
+  std::vector<B>* bounds;
+
+  void operator()(unsigned begin, unsigned end) const
+  {
+    for (unsigned i = begin; i < end; ++i)
+      C::init((*bounds)[i], (*elements)[i]);
+  }
+};
+
+template <class V, class B, class C>
+vgl_packed_rtree<V, B, C>::vgl_packed_rtree(vgl_rtree<V, B, C> const& tree, unsigned fanout)
+{
+  std::vector<V> vs;
+  tree.get_all(vs);
+  build(vs, fanout);
+}
+
+template <class V, class B, class C>
+void vgl_packed_rtree<V, B, C>::build(std::vector<V> const& vs, unsigned fanout)
+{
+  fanout_ = std::max(2u, fanout);
+  elements_.clear();
+  element_bounds_.clear();
+  nodes_.clear();
+  n_leaf_nodes_ = 0;
+  const unsigned n = unsigned(vs.size());
+  if (n == 0)
+    return;
+
+  // Elements in Sort-Tile-Recursive order
+  std::vector<B> bounds(n);
+  vgl_packed_rtree_element_bounds<V, B, C> element_bounds = { &vs, &bounds };
+  vnl_parallel_for(0u, n, element_bounds, 4096u);
+  std::vector<unsigned> order = vgl_packed_rtree_str_order(bounds, fanout_);
+  elements_.resize(n);
+  element_bounds_.resize(n);
+  for (unsigned i = 0; i < n; ++i) {
+    elements_[i] = vs[order[i]];
+    element_bounds_[i] = bounds[order[i]];
+  }
+
+  // Pack each level into nodes of fanout_ entries; the level above is
+  // then put in Sort-Tile-Recursive order of the node bounds.
+  std::vector<B> const* below = &element_bounds_;
+  std::vector<B> level_bounds;
+  unsigned level_first = 0, level_size = n;
+  while (true) {
+    const unsigned first = unsigned(nodes_.size());
+    const unsigned count = (level_size + fanout_ - 1) / fanout_;
+    nodes_.resize(first + count);
+    for (unsigned i = 0; i < count; ++i) {
+      nodes_[first + i].first = level_first + i*fanout_;
+      nodes_[first + i].count = std::min(fanout_, level_size - i*fanout_);
+    }
+    vgl_packed_rtree_node_bounds<V, B, C> node_bounds = { &nodes_, below, first, level_first };
+    vnl_parallel_for(0u, count, node_bounds, 1024u);
+    if (first == 0)
+      n_leaf_nodes_ = count;
+    if (count == 1)
+      break;
+
+    // reorder this level before packing the next one
+    level_bounds.resize(count);
+    for (unsigned i = 0; i < count; ++i)
+      level_bounds[i] = nodes_[first + i].bounds;
+    std::vector<unsigned> node_order = vgl_packed_rtree_str_order(level_bounds, fanout_);
+    std::vector<node> level(nodes_.begin() + first, nodes_.end());
+    for (unsigned i = 0; i < count; ++i) {
+      nodes_[first + i] = level[node_order[i]];
+      level_bounds[i] = level[node_order[i]].bounds;
+    }
+    below = &level_bounds;
+    level_first = first;
+    level_size = count;
+  }
+}
+
+template <class V, class B, class C>
+void vgl_packed_rtree<V, B, C>::set(unsigned fanout, std::vector<V> const& elements,
+                                    std::vector<B> const& element_bounds,
+                                    std::vector<node> const& nodes, unsigned n_leaf_nodes)
+{
+  assert(elements.size() == element_bounds.size());
+  assert(n_leaf_nodes <= nodes.size());
+  fanout_ = fanout;
+  elements_ = elements;
+  element_bounds_ = element_bounds;
+  nodes_ = nodes;
+  n_leaf_nodes_ = n_leaf_nodes;
+}
+
+template <class V, class B, class C>
+void vgl_packed_rtree<V, B, C>::get(B const& region, std::vector<V>& vs) const
+{
+  if (nodes_.empty())
+    return;
+  std::vector<unsigned> stack(1, unsigned(nodes_.size()) - 1);
+  while (!stack.empty()) {
+    const unsigned j = stack.back();
+    stack.pop_back();
+    node const& nd = nodes_[j];
+    if (!C::meet(region, nd.bounds))
+      continue;
+    if (j < n_leaf_nodes_) {
+      for (unsigned c = nd.first; c < nd.first + nd.count; ++c)
+        if (C::meet(region, elements_[c]))
+          vs.push_back(elements_[c]);
+    }
+    else {
+      // pushed in reverse so that children are visited in order
+      for (unsigned c = nd.first + nd.count; c-- > nd.first; )
+        stack.push_back(c);
+    }
+  }
+}
+
+template <class V, class B, class C>
+void vgl_packed_rtree<V, B, C>::get(vgl_rtree_probe<V, B, C> const& probe, std::vector<V>& vs) const
+{
+  if (nodes_.empty())
+    return;
+  std::vector<unsigned> stack(1, unsigned(nodes_.size()) - 1);
+  while (!stack.empty()) {
+    const unsigned j = stack.back();
+    stack.pop_back();
+    node const& nd = nodes_[j];
+    if (!probe.meets(nd.bounds))
+      continue;
+    if (j < n_leaf_nodes_) {
+      for (unsigned c = nd.first; c < nd.first + nd.count; ++c)
+        if (probe.meets(elements_[c]))
+          vs.push_back(elements_[c]);
+    }
+    else {
+      for (unsigned c = nd.first + nd.count; c-- > nd.first; )
+        stack.push_back(c);
+    }
+  }
+}
+
+template <class V, class B, class C>
+void vgl_packed_rtree<V, B, C>::get(std::vector<B> const& regions,
+                                    std::vector<std::vector<V> >& results) const
+{
+  results.resize(regions.size());
+  vgl_packed_rtree_range_batch<V, B, C> batch = { this, &regions, &results };
+  vnl_parallel_for(0u, unsigned(regions.size()), batch, 16u);
+}
+
+template <class V, class B, class C>
+bool vgl_packed_rtree<V, B, C>::contains(V const& v) const
+{
+  if (nodes_.empty())
+    return false;
+  B b;
+  C::init(b, v);
+  std::vector<unsigned> stack(1, unsigned(nodes_.size()) - 1);
+  while (!stack.empty()) {
+    const unsigned j = stack.back();
+    stack.pop_back();
+    node const& nd = nodes_[j];
+    if (!C::meet(nd.bounds, b))
+      continue;
+    if (j < n_leaf_nodes_) {
+      for (unsigned c = nd.first; c < nd.first + nd.count; ++c)
+        if (elements_[c] == v)
+          return true;
+    }
+    else {
+      for (unsigned c = nd.first; c < nd.first + nd.count; ++c)
+        stack.push_back(c);
+    }
+  }
+  return false;
+}
+
+#undef VGL_PACKED_RTREE_INSTANTIATE
+#define VGL_PACKED_RTREE_INSTANTIATE(V, B, C) \
+template class vgl_packed_rtree<V, B, C >
+
+#endif // vgl_packed_rtree_hxx_
@@ -18,6 +18,7 @@ DECLARE( test_point_2d_io );
 DECLARE( test_point_3d_io );
 DECLARE( test_plane_3d_io );
 DECLARE( test_polygon_io );
+DECLARE( test_packed_rtree_io );
 DECLARE( test_vector_2d_io );
 DECLARE( test_vector_3d_io );
 
@@ -42,6 +43,7 @@ register_tests()
   REGISTER( test_point_3d_io );
   REGISTER( test_plane_3d_io );
   REGISTER( test_polygon_io );
+  REGISTER( test_packed_rtree_io );
   REGISTER( test_vector_2d_io );
   REGISTER( test_vector_3d_io );
 }
@@ -14,6 +14,7 @@
 #include <vgl/io/vgl_io_line_3d_2_points.h>
 #include <vgl/io/vgl_io_line_segment_2d.h>
 #include <vgl/io/vgl_io_line_segment_3d.h>
+#include <vgl/io/vgl_io_packed_rtree.h>
 #include <vgl/io/vgl_io_plane_3d.h>
 #include <vgl/io/vgl_io_point_2d.h>
 #include <vgl/io/vgl_io_point_3d.h>
@@ -0,0 +1,103 @@
+// This is core/vgl/io/tests/test_packed_rtree_io.cxx
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <vcl_compiler.h>
+#include <vgl/io/vgl_io_packed_rtree.hxx>
+#include <vgl/io/vgl_io_point_2d.h>
+#include <vgl/io/vgl_io_box_2d.h>
+#include <vgl/algo/vgl_packed_rtree.hxx>
+#include <vgl/algo/vgl_rtree_c.h>
+#include <vsl/vsl_indent.h>
+#include <testlib/testlib_test.h>
+#include <vpl/vpl.h>
+
+typedef vgl_rtree_point_box_2d<float> C_;
+typedef C_::v_type V_;
+typedef C_::b_type B_;
+
+VGL_IO_PACKED_RTREE_INSTANTIATE(V_, B_, C_);
+
+typedef vgl_packed_rtree<V_, B_, C_> tree_;
+
+//: Write t as vsl_b_write does, with the given fanout and node k changed
+static bool read_corrupt(tree_ const& t, unsigned fanout, unsigned k, unsigned first, unsigned count)
+{
+  std::stringstream s;
+  vsl_b_ostream os(&s);
+  vsl_b_write(os, short(1));
+  vsl_b_write(os, fanout);
+  vsl_b_write(os, t.n_leaf_nodes());
+  vsl_b_write(os, t.size());
+  for (unsigned i = 0; i < t.size(); ++i) {
+    vsl_b_write(os, t.elements()[i]);
+    vsl_b_write(os, t.element_bounds()[i]);
+  }
+  vsl_b_write(os, t.nodes());
+  for (unsigned i = 0; i < t.nodes(); ++i) {
+    vsl_b_write(os, t.node_array()[i].bounds);
+    vsl_b_write(os, i == k ? first : t.node_array()[i].first);
+    vsl_b_write(os, i == k ? count : t.node_array()[i].count);
+  }
+  vsl_b_istream is(&s);
+  tree_ t_in;
+  vsl_b_read(is, t_in);
+  return !!is;
+}
+
+static void test_packed_rtree_io()
+{
+  std::cout << "*************************************\n"
+           << " Testing vgl_packed_rtree<point> io\n"
+           << "*************************************\n";
+
+  std::vector<V_> pts;
+  for (unsigned i = 0; i < 1000; ++i)
+    pts.push_back(V_(float((i * 37) % 101), float((i * 53) % 97)));
+  vgl_packed_rtree<V_, B_, C_> t_out(pts, 8), t_in;
+
+  vsl_b_ofstream bfs_out("vgl_packed_rtree_test_io.bvl.tmp",
+                         std::ios::out | std::ios::binary);
+  TEST ("Created vgl_packed_rtree_test_io.bvl.tmp for writing",
+        (!bfs_out), false);
+  vsl_b_write(bfs_out, t_out);
+  bfs_out.close();
+
+  vsl_b_ifstream bfs_in("vgl_packed_rtree_test_io.bvl.tmp",
+                        std::ios::in | std::ios::binary);
+  TEST ("Opened vgl_packed_rtree_test_io.bvl.tmp for reading",
+        (!bfs_in), false);
+  vsl_b_read(bfs_in, t_in);
+  TEST ("Finished reading file successfully", (!bfs_in), false);
+  bfs_in.close();
+
+  vpl_unlink ("vgl_packed_rtree_test_io.bvl.tmp");
+
+  TEST ("Same elements", t_out.elements() == t_in.elements(), true);
+  TEST ("Same structure", t_out.nodes() == t_in.nodes() && t_out.n_leaf_nodes() == t_in.n_leaf_nodes()
+                          && t_out.fanout() == t_in.fanout(), true);
+  std::vector<V_> r_out, r_in;
+  t_out.get(B_(10.f, 30.f, 20.f, 50.f), r_out);
+  t_in.get(B_(10.f, 30.f, 20.f, 50.f), r_in);
+  TEST ("Same query result", !r_out.empty() && r_out == r_in, true);
+  t_out.nearest(V_(50.f, 50.f), 4, r_out);
+  t_in.nearest(V_(50.f, 50.f), 4, r_in);
+  TEST ("Same nearest elements", r_out == r_in, true);
+
+  const unsigned leaf = 3, root = t_out.nodes() - 1;
+  const unsigned first = t_out.node_array()[leaf].first, count = t_out.node_array()[leaf].count;
+  TEST ("Unchanged stream read", read_corrupt(t_out, 8, leaf, first, count), true);
+  TEST ("Zero fanout rejected", read_corrupt(t_out, 0, leaf, first, count), false);
+  TEST ("Count above fanout rejected", read_corrupt(t_out, 4, leaf, first, count), false);
+  TEST ("Empty node rejected", read_corrupt(t_out, 8, leaf, first, 0), false);
+  TEST ("Leaf past the elements rejected", read_corrupt(t_out, 8, leaf, 998, 3), false);
+  TEST ("Overflowing leaf range rejected", read_corrupt(t_out, 8, leaf, ~0u, 2), false);
+  TEST ("Node referring to itself rejected", read_corrupt(t_out, 8, root, root, 1), false);
+  TEST ("Node referring to a later node rejected", read_corrupt(t_out, 8, t_out.n_leaf_nodes(), root, 1), false);
+
+  vsl_print_summary(std::cout, t_out);
+  std::cout << std::endl;
+  vsl_indent_clear_all_data();
+}
+
+TESTMAIN(test_packed_rtree_io);
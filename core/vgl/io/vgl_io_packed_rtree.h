@@ -0,0 +1,35 @@
+// This is core/vgl/io/vgl_io_packed_rtree.h
+#ifndef vgl_io_packed_rtree_h
+#define vgl_io_packed_rtree_h
+//:
+// \file
+// \brief Binary io for vgl_packed_rtree
+//
+// A stored tree is read back as it was built, without sorting again.
+// The element type V and the bounds type B need vsl_b_write() and
+// vsl_b_read() of their own, e.g. those in vgl_io_point_2d.h and
+// vgl_io_box_2d.h.  As the tree is a template on V, B and C, there are no
+// instantiations in vgl_io; include vgl_io_packed_rtree.hxx and use
+// VGL_IO_PACKED_RTREE_INSTANTIATE for the types required.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <iosfwd>
+#include <vgl/algo/vgl_packed_rtree.h>
+#include <vsl/vsl_binary_io.h>
+
+//: Binary save vgl_packed_rtree to stream.
+template <class V, class B, class C>
+void vsl_b_write(vsl_b_ostream &os, const vgl_packed_rtree<V, B, C> & t);
+
+//: Binary load vgl_packed_rtree from stream.
+template <class V, class B, class C>
+void vsl_b_read(vsl_b_istream &is, vgl_packed_rtree<V, B, C> & t);
+
+//: Print human readable summary of object to a stream
+template <class V, class B, class C>
+void vsl_print_summary(std::ostream& os, const vgl_packed_rtree<V, B, C> & t);
+
+#endif // vgl_io_packed_rtree_h
@@ -0,0 +1,118 @@
+// This is core/vgl/io/vgl_io_packed_rtree.hxx
+#ifndef vgl_io_packed_rtree_hxx_
+#define vgl_io_packed_rtree_hxx_
+//:
+// \file
+
+#include <iostream>
+#include <vector>
+#include "vgl_io_packed_rtree.h"
+#include <vsl/vsl_binary_io.h>
+
+//============================================================================
+//: Binary save self to stream.
+template <class V, class B, class C>
+void vsl_b_write(vsl_b_ostream &os, const vgl_packed_rtree<V, B, C> & t)
+{
+  typedef typename vgl_packed_rtree<V, B, C>::node node;
+  const short io_version_no = 1;
+  vsl_b_write(os, io_version_no);
+  vsl_b_write(os, t.fanout());
+  vsl_b_write(os, t.n_leaf_nodes());
+  vsl_b_write(os, t.size());
+  for (unsigned i = 0; i < t.size(); ++i) {
+    vsl_b_write(os, t.elements()[i]);
+    vsl_b_write(os, t.element_bounds()[i]);
+  }
+  vsl_b_write(os, t.nodes());
+  for (unsigned i = 0; i < t.nodes(); ++i) {
+    node const& nd = t.node_array()[i];
+    vsl_b_write(os, nd.bounds);
+    vsl_b_write(os, nd.first);
+    vsl_b_write(os, nd.count);
+  }
+}
+
+//: True if the nodes read from a stream form a tree over n elements.
+// Every node must have between 1 and fanout entries.  Leaf nodes must
+// refer to elements, and the other nodes to nodes before themselves, so a
+// query on a corrupt stream can neither index out of range nor loop.
+template <class N>
+bool vgl_io_packed_rtree_valid(unsigned fanout, unsigned n, std::vector<N> const& nodes,
+                               unsigned n_leaf_nodes)
+{
+  if (fanout < 2 || n_leaf_nodes > nodes.size() || nodes.empty() != (n == 0) ||
+      (!nodes.empty() && n_leaf_nodes == 0))
+    return false;
+  for (unsigned i = 0; i < nodes.size(); ++i) {
+    const unsigned limit = i < n_leaf_nodes ? n : i;
+    if (nodes[i].count == 0 || nodes[i].count > fanout ||
+        nodes[i].count > limit || nodes[i].first > limit - nodes[i].count)
+      return false;
+  }
+  return true;
+}
+
+//============================================================================
+//: Binary load self from stream.
+template <class V, class B, class C>
+void vsl_b_read(vsl_b_istream &is, vgl_packed_rtree<V, B, C> & t)
+{
+  if (!is) return;
+
+  typedef typename vgl_packed_rtree<V, B, C>::node node;
+  short v;
+  unsigned fanout, n_leaf_nodes, n;
+  vsl_b_read(is, v);
+  switch (v)
+  {
+   case 1:
+   {
+    vsl_b_read(is, fanout);
+    vsl_b_read(is, n_leaf_nodes);
+    vsl_b_read(is, n);
+    std::vector<V> elements(n);
+    std::vector<B> element_bounds(n);
+    for (unsigned i = 0; i < n && !!is; ++i) {
+      vsl_b_read(is, elements[i]);
+      vsl_b_read(is, element_bounds[i]);
+    }
+    unsigned n_nodes;
+    vsl_b_read(is, n_nodes);
+    std::vector<node> nodes(n_nodes);
+    for (unsigned i = 0; i < n_nodes && !!is; ++i) {
+      vsl_b_read(is, nodes[i].bounds);
+      vsl_b_read(is, nodes[i].first);
+      vsl_b_read(is, nodes[i].count);
+    }
+    if (!is || !vgl_io_packed_rtree_valid(fanout, n, nodes, n_leaf_nodes)) {
+      is.is().clear(std::ios::badbit); // Set an unrecoverable IO error on stream
+      return;
+    }
+    t.set(fanout, elements, element_bounds, nodes, n_leaf_nodes);
+    break;
+   }
+
+   default:
+    std::cerr << "I/O ERROR: vsl_b_read(vsl_b_istream&, vgl_packed_rtree<V, B, C>&)\n"
+             << "           Unknown version number "<< v << '\n';
+    is.is().clear(std::ios::badbit); // Set an unrecoverable IO error on stream
+    return;
+  }
+}
+
+//============================================================================
+//: Output a human readable summary to the stream
+template <class V, class B, class C>
+void vsl_print_summary(std::ostream& os, const vgl_packed_rtree<V, B, C> & t)
+{
+  os << "Packed rtree with " << t.size() << " elements in " << t.nodes()
+     << " nodes (" << t.n_leaf_nodes() << " leaves), fanout " << t.fanout() << '\n';
+}
+
+#define VGL_IO_PACKED_RTREE_INSTANTIATE(V, B, C) \
+template void vsl_print_summary(std::ostream &, const vgl_packed_rtree<V, B, C > &); \
+template void vsl_b_read(vsl_b_istream &, vgl_packed_rtree<V, B, C > &); \
+template void vsl_b_write(vsl_b_ostream &, const vgl_packed_rtree<V, B, C > &)
+
+#endif // vgl_io_packed_rtree_hxx_
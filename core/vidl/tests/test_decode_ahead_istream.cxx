@@ -0,0 +1,150 @@
+// This is core/vidl/tests/test_decode_ahead_istream.cxx
+#include <iostream>
+#include <vector>
+#include <testlib/testlib_test.h>
+#include <vcl_compiler.h>
+#include <vidl/vidl_decode_ahead_istream.h>
+#include <vidl/vidl_frame.h>
+#include <vul/vul_timer.h>
+
+//: A seekable stream of n mono frames, each filled with its frame number.
+// Like most decoders, it reuses one buffer for every frame.
+class test_counting_istream : public vidl_istream
+{
+ public:
+  test_counting_istream(unsigned n, unsigned ni, unsigned nj)
+    : n_(n), ni_(ni), nj_(nj), index_(unsigned(-1)), open_(true), buffer_(ni*nj) {}
+
+  virtual bool is_open() const { return open_; }
+  virtual bool is_valid() const { return open_ && index_ < n_; }
+  virtual bool is_seekable() const { return true; }
+  virtual int num_frames() const { return int(n_); }
+  virtual unsigned int frame_number() const { return index_; }
+  virtual unsigned int width() const { return ni_; }
+  virtual unsigned int height() const { return nj_; }
+  virtual vidl_pixel_format format() const { return VIDL_PIXEL_FORMAT_MONO_8; }
+  virtual double frame_rate() const { return 30.0; }
+  virtual double duration() const { return n_ / 30.0; }
+  virtual void close() { open_ = false; }
+  virtual bool advance()
+  {
+    if (!open_ || (index_ != unsigned(-1) && index_ >= n_)) return false;
+    ++index_;
+    fill();
+    return index_ < n_;
+  }
+  virtual vidl_frame_sptr read_frame() { advance(); return current_frame(); }
+  virtual vidl_frame_sptr current_frame()
+  {
+    if (!is_valid()) return NULL;
+    return new vidl_shared_frame(&buffer_[0], ni_, nj_, VIDL_PIXEL_FORMAT_MONO_8);
+  }
+  virtual bool seek_frame(unsigned int frame_number)
+  {
+    if (!open_ || frame_number >= n_) return false;
+    index_ = frame_number;
+    fill();
+    return true;
+  }
+
+ private:
+  void fill()
+  {
+    for (unsigned i = 0; i < buffer_.size(); ++i)
+      buffer_[i] = vxl_byte(index_ + i);
+  }
+
+  unsigned n_, ni_, nj_, index_;
+  bool open_;
+  std::vector<vxl_byte> buffer_;
+};
+
+//: Return true if frame holds frame number f of a test_counting_istream.
+static bool frame_is(const vidl_frame_sptr& frame, unsigned f)
+{
+  if (!frame || frame->pixel_format() != VIDL_PIXEL_FORMAT_MONO_8)
+    return false;
+  const vxl_byte* data = static_cast<const vxl_byte*>(frame->data());
+  for (unsigned i = 0; i < frame->size(); ++i)
+    if (data[i] != vxl_byte(f + i))
+      return false;
+  return true;
+}
+
+static void test_decode_ahead_istream()
+{
+  std::cout << "*************************************\n"
+           << " Testing vidl_decode_ahead_istream\n"
+           << "*************************************\n";
+
+  const unsigned n = 40;
+  {
+    vidl_decode_ahead_istream is(new test_counting_istream(n, 16, 8), 3);
+    TEST("Open", is.is_open() && !is.is_valid(), true);
+    TEST("Properties", is.width() == 16 && is.height() == 8 && is.num_frames() == int(n) &&
+                       is.is_seekable() && is.frame_rate() == 30.0, true);
+    TEST("Frames ahead", is.frames_ahead(), 3);
+
+    bool in_order = true;
+    unsigned count = 0;
+    vidl_frame_sptr frame;
+    while ((frame = is.read_frame()))
+    {
+      in_order = in_order && is.frame_number() == count && frame_is(frame, count);
+      ++count;
+    }
+    TEST("All frames delivered in order", in_order && count == n, true);
+    TEST("Invalid at the end", is.is_valid() || is.advance(), false);
+    TEST("Frames delivered", is.num_frames_delivered(), n);
+
+    TEST("Seek", is.seek_frame(25), true);
+    TEST("Frame after seek", is.frame_number() == 25 && frame_is(is.current_frame(), 25), true);
+    is.advance();
+    TEST("Next frame after seek", is.frame_number() == 26 && frame_is(is.current_frame(), 26), true);
+    TEST("Seek backwards", is.seek_frame(2) && frame_is(is.current_frame(), 2), true);
+    in_order = true;
+    for (unsigned f = 3; f < 10; ++f)
+      in_order = in_order && is.advance() && frame_is(is.current_frame(), f);
+    TEST("Frames in order after seeking backwards", in_order, true);
+    TEST("Seek past the end fails", is.seek_frame(n), false);
+    TEST("Invalid after a failed seek", is.is_valid(), false);
+    TEST("No frame number after a failed seek", is.frame_number(), static_cast<unsigned int>(-1));
+    TEST("No frames after a failed seek", is.advance(), false);
+    TEST("Seek after a failed seek", is.seek_frame(5) && frame_is(is.current_frame(), 5), true);
+    TEST("Continues after a failed seek", is.advance() && is.frame_number() == 6 &&
+                                          frame_is(is.current_frame(), 6), true);
+
+    is.close();
+    TEST("Closed", is.is_open() || is.advance(), false);
+  }
+
+  {
+    // Wrapping a stream that is already at a frame
+    vidl_istream_sptr source = new test_counting_istream(n, 4, 4);
+    source->seek_frame(7);
+    vidl_decode_ahead_istream is(source, 2);
+    TEST("Starts at the current frame", is.is_valid() && is.frame_number() == 7 &&
+                                        frame_is(is.current_frame(), 7), true);
+    TEST("Continues from there", is.advance() && frame_is(is.current_frame(), 8), true);
+  }
+
+  {
+    // With a slow consumer, the frames are decoded before they are needed
+    vidl_decode_ahead_istream is(new test_counting_istream(10, 64, 64), 4);
+    is.reset_statistics();
+    bool in_order = true;
+    for (unsigned f = 0; f < 10; ++f)
+    {
+      in_order = in_order && is.advance() && frame_is(is.current_frame(), f);
+      vul_timer t;
+      while (t.real() < 5) {}
+    }
+    std::cout << "Stalls: " << is.num_stalls() << ", stall time: " << is.stall_time() << "s\n";
+    TEST("Slow consumer gets frames in order", in_order, true);
+    // How often the consumer waits depends on the scheduler, but it waits at most once a frame
+    TEST("Statistics count each frame", is.num_frames_delivered() == 10 && is.num_stalls() <= 10 &&
+                                        is.stall_time() >= 0.0, true);
+  }
+}
+
+TESTMAIN(test_decode_ahead_istream);
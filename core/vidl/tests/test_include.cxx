@@ -11,6 +11,7 @@
 #include <vidl/vidl_istream_sptr.h>
 #include <vidl/vidl_istream_image_resource.h>
 #include <vidl/vidl_image_list_istream.h>
+#include <vidl/vidl_decode_ahead_istream.h>
 #include <vidl/vidl_ostream.h>
 #include <vidl/vidl_ostream_sptr.h>
 #include <vidl/vidl_image_list_ostream.h>
@@ -0,0 +1,402 @@
+// This is core/vidl/vidl_decode_ahead_istream.cxx
+#ifdef VCL_NEEDS_PRAGMA_INTERFACE
+#pragma implementation
+#endif
+//:
+// \file
+//
+//-----------------------------------------------------------------------------
+
+#include <cstring>
+#include <deque>
+#include <vector>
+#include "vidl_decode_ahead_istream.h"
+#include "vidl_frame.h"
+#include <vcl_compiler.h>
+#if VXL_FULLCXX11SUPPORT
+# include <condition_variable>
+# include <mutex>
+# include <thread>
+#endif
+#include <vil/vil_memory_chunk.h>
+#include <vul/vul_timer.h>
+
+//--------------------------------------------------------------------------------
+
+//: The ring of frame buffers, and the state shared with the decoding thread
+// Each slot is either free, decoded (waiting to be delivered), or current.
+// A slot is only written by whoever took it from the free list, so the
+// frame data is copied without holding the lock.
+struct vidl_decode_ahead_istream::ring
+{
+  struct slot
+  {
+    vil_memory_chunk_sptr memory;
+    unsigned int frame_number;
+    unsigned int ni;
+    unsigned int nj;
+    vidl_pixel_format format;
+  };
+
+  std::vector<slot> slots;
+  //: Decoded slots, in frame order
+  std::deque<unsigned> decoded;
+  std::vector<unsigned> free;
+  //: The slot of the current frame, or -1
+  int current;
+  //: True when the wrapped stream has no more frames
+  bool end;
+  //: True when the decoding thread should finish
+  bool stop;
+
+  unsigned long delivered;
+  unsigned long stalls;
+  double stall_seconds;
+
+#if VXL_FULLCXX11SUPPORT
+  std::mutex mutex;
+  std::condition_variable frame_decoded;
+  std::condition_variable slot_freed;
+  std::thread thread;
+#endif
+};
+
+//: Copy frame \p f of \p source into slot \p sl.
+// \returns false if there is no frame.
+static bool vidl_decode_ahead_copy(const vidl_istream& source, const vidl_frame_sptr& f,
+                                   vidl_decode_ahead_istream::ring::slot& sl)
+{
+  if (!f || !f->data() || f->size() == 0)
+    return false;
+  if (!sl.memory || sl.memory->size() < f->size())
+    sl.memory = new vil_memory_chunk(f->size(), VIL_PIXEL_FORMAT_BYTE);
+  std::memcpy(sl.memory->data(), f->data(), f->size());
+  sl.frame_number = source.frame_number();
+  sl.ni = f->ni();
+  sl.nj = f->nj();
+  sl.format = f->pixel_format();
+  return true;
+}
+
+#if VXL_FULLCXX11SUPPORT
+//: The decoding thread: fill free slots with the following frames until told to stop.
+static void vidl_decode_ahead_run(vidl_istream* source, vidl_decode_ahead_istream::ring* r)
+{
+  std::unique_lock<std::mutex> lock(r->mutex);
+  while (true)
+  {
+    while (!r->stop && (r->free.empty() || r->end))
+      r->slot_freed.wait(lock);
+    if (r->stop)
+      return;
+    const unsigned s = r->free.back();
+    r->free.pop_back();
+    lock.unlock();
+    const bool ok = vidl_decode_ahead_copy(*source, source->read_frame(), r->slots[s]);
+    lock.lock();
+    if (ok)
+      r->decoded.push_back(s);
+    else
+    {
+      r->free.push_back(s);
+      r->end = true;
+    }
+    r->frame_decoded.notify_one();
+  }
+}
+#endif // VXL_FULLCXX11SUPPORT
+
+
+//: Constructor
+vidl_decode_ahead_istream::
+vidl_decode_ahead_istream(const vidl_istream_sptr& source, unsigned frames_ahead)
+  : source_(source),
+    frames_ahead_(frames_ahead > 0 ? frames_ahead : 1),
+    ring_(new ring),
+    current_frame_(NULL),
+    open_(source && source->is_open()),
+    seekable_(false), num_frames_(-1),
+    frame_number_(static_cast<unsigned int>(-1)),
+    ni_(0), nj_(0), format_(VIDL_PIXEL_FORMAT_UNKNOWN),
+    frame_rate_(0.0), duration_(0.0)
+{
+  ring_->slots.resize(frames_ahead_ + 1);
+  for (unsigned s = frames_ahead_ + 1; s-- > 0; )
+    ring_->free.push_back(s);
+  ring_->current = -1;
+  ring_->end = false;
+  ring_->stop = false;
+  reset_statistics();
+  if (!open_)
+    return;
+
+  seekable_ = source_->is_seekable();
+  num_frames_ = source_->num_frames();
+  frame_number_ = source_->frame_number();
+  ni_ = source_->width();
+  nj_ = source_->height();
+  format_ = source_->format();
+  frame_rate_ = source_->frame_rate();
+  duration_ = source_->duration();
+
+  // The wrapped stream may already be positioned at a frame
+  if (source_->is_valid())
+  {
+    const unsigned s = ring_->free.back();
+    if (vidl_decode_ahead_copy(*source_, source_->current_frame(), ring_->slots[s]))
+    {
+      ring_->free.pop_back();
+      ring_->current = int(s);
+      set_current(int(s));
+    }
+  }
+  start();
+}
+
+
+//: Destructor
+// The wrapped stream is released, but not closed.
+vidl_decode_ahead_istream::
+~vidl_decode_ahead_istream()
+{
+  stop();
+  current_frame_ = NULL;
+  delete ring_;
+}
+
+
+//: Start the decoding thread, if there is one
+void
+vidl_decode_ahead_istream::
+start()
+{
+#if VXL_FULLCXX11SUPPORT
+  if (is_open())
+    ring_->thread = std::thread(vidl_decode_ahead_run, source_.as_pointer(), ring_);
+#endif
+}
+
+
+//: Stop the decoding thread, if there is one
+void
+vidl_decode_ahead_istream::
+stop()
+{
+#if VXL_FULLCXX11SUPPORT
+  if (!ring_->thread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(ring_->mutex);
+    ring_->stop = true;
+  }
+  ring_->slot_freed.notify_one();
+  ring_->thread.join();
+  ring_->stop = false;
+#endif
+}
+
+
+//: Make slot \p s the current frame
+void
+vidl_decode_ahead_istream::
+set_current(int s)
+{
+  if (s < 0)
+  {
+    current_frame_ = NULL;
+    return;
+  }
+  const ring::slot& sl = ring_->slots[s];
+  current_frame_ = new vidl_shared_frame(sl.memory->data(), sl.ni, sl.nj, sl.format);
+  frame_number_ = sl.frame_number;
+  ni_ = sl.ni;
+  nj_ = sl.nj;
+  format_ = sl.format;
+}
+
+
+//: Close the stream, and the wrapped stream
+void
+vidl_decode_ahead_istream::
+close()
+{
+  stop();
+  current_frame_ = NULL;
+  ring_->decoded.clear();
+  ring_->free.clear();
+  for (unsigned s = unsigned(ring_->slots.size()); s-- > 0; )
+    ring_->free.push_back(s);
+  ring_->current = -1;
+  ring_->end = true;
+  if (source_)
+    source_->close();
+  open_ = false;
+}
+
+
+//: Advance to the next frame (but don't acquire an image)
+bool
+vidl_decode_ahead_istream::
+advance()
+{
+  if (!is_open())
+    return false;
+  current_frame_ = NULL;
+  int s = -1;
+  {
+#if VXL_FULLCXX11SUPPORT
+    std::unique_lock<std::mutex> lock(ring_->mutex);
+    if (ring_->current >= 0)
+    {
+      ring_->free.push_back(unsigned(ring_->current));
+      ring_->current = -1;
+      ring_->slot_freed.notify_one();
+    }
+    if (ring_->decoded.empty() && !ring_->end)
+    {
+      ++ring_->stalls;
+      vul_timer timer;
+      while (ring_->decoded.empty() && !ring_->end)
+        ring_->frame_decoded.wait(lock);
+      ring_->stall_seconds += timer.real() / 1000.0;
+    }
+#else
+    if (ring_->current >= 0)
+    {
+      ring_->free.push_back(unsigned(ring_->current));
+      ring_->current = -1;
+    }
+    if (ring_->decoded.empty() && !ring_->end)
+    {
+      // decode on this thread
+      ++ring_->stalls;
+      vul_timer timer;
+      const unsigned f = ring_->free.back();
+      if (vidl_decode_ahead_copy(*source_, source_->read_frame(), ring_->slots[f]))
+      {
+        ring_->free.pop_back();
+        ring_->decoded.push_back(f);
+      }
+      else
+        ring_->end = true;
+      ring_->stall_seconds += timer.real() / 1000.0;
+    }
+#endif
+    if (!ring_->decoded.empty())
+    {
+      s = int(ring_->decoded.front());
+      ring_->decoded.pop_front();
+      ++ring_->delivered;
+    }
+    ring_->current = s;
+  }
+  set_current(s);
+  return s >= 0;
+}
+
+
+//: Read the next frame from the stream
+vidl_frame_sptr
+vidl_decode_ahead_istream::read_frame()
+{
+  if (advance())
+    return current_frame_;
+  return NULL;
+}
+
+
+//: Seek to the given frame number
+// \returns true if successful
+bool
+vidl_decode_ahead_istream::
+seek_frame(unsigned int frame_number)
+{
+  if (!is_open() || !seekable_)
+    return false;
+
+  // Discard the frames decoded so far; the wrapped stream is ours again
+  // once the decoding thread has stopped.
+  stop();
+  current_frame_ = NULL;
+  ring_->free.insert(ring_->free.end(), ring_->decoded.begin(), ring_->decoded.end());
+  ring_->decoded.clear();
+  if (ring_->current >= 0)
+    ring_->free.push_back(unsigned(ring_->current));
+  ring_->current = -1;
+  ring_->end = false;
+
+  bool ok = source_->seek_frame(frame_number);
+  if (ok)
+  {
+    const unsigned s = ring_->free.back();
+    ok = vidl_decode_ahead_copy(*source_, source_->current_frame(), ring_->slots[s]);
+    if (ok)
+    {
+      ring_->free.pop_back();
+      ring_->current = int(s);
+    }
+  }
+  if (!ok)
+  {
+    // The wrapped stream is at an unknown position, so decoding from
+    // there could skip frames.  Leave the stream invalid, with no frames
+    // to come, until a seek succeeds.
+    ring_->end = true;
+    set_current(-1);
+    frame_number_ = static_cast<unsigned int>(-1);
+    return false;
+  }
+  set_current(ring_->current);
+  start();
+  return true;
+}
+
+
+//: Number of frames delivered by advance()
+unsigned long
+vidl_decode_ahead_istream::
+num_frames_delivered() const
+{
+#if VXL_FULLCXX11SUPPORT
+  std::lock_guard<std::mutex> lock(ring_->mutex);
+#endif
+  return ring_->delivered;
+}
+
+
+//: Number of times advance() had to wait for a frame to be decoded
+unsigned long
+vidl_decode_ahead_istream::
+num_stalls() const
+{
+#if VXL_FULLCXX11SUPPORT
+  std::lock_guard<std::mutex> lock(ring_->mutex);
+#endif
+  return ring_->stalls;
+}
+
+
+//: Total time, in seconds, advance() has spent waiting for frames
+double
+vidl_decode_ahead_istream::
+stall_time() const
+{
+#if VXL_FULLCXX11SUPPORT
+  std::lock_guard<std::mutex> lock(ring_->mutex);
+#endif
+  return ring_->stall_seconds;
+}
+
+
+//: Reset the counts of frames delivered and stalls, and the stall time
+void
+vidl_decode_ahead_istream::
+reset_statistics()
+{
+#if VXL_FULLCXX11SUPPORT
+  std::lock_guard<std::mutex> lock(ring_->mutex);
+#endif
+  ring_->delivered = 0;
+  ring_->stalls = 0;
+  ring_->stall_seconds = 0.0;
+}
@@ -0,0 +1,140 @@
+// This is core/vidl/vidl_decode_ahead_istream.h
+#ifndef vidl_decode_ahead_istream_h_
+#define vidl_decode_ahead_istream_h_
+#ifdef VCL_NEEDS_PRAGMA_INTERFACE
+#pragma interface
+#endif
+//:
+// \file
+// \brief An input stream that decodes frames of another stream ahead of time
+//
+// vidl_decode_ahead_istream wraps any other vidl_istream.  A background
+// thread reads frames from the wrapped stream and copies them into a ring
+// of buffers, up to a given number of frames ahead of the caller, so that
+// decoding overlaps with whatever the caller does with each frame.  The
+// frames are delivered in order, exactly as the wrapped stream would
+// deliver them.  Seeking discards the frames decoded so far and restarts
+// the decoding from the new position.
+//
+// The buffers are allocated once and reused.  As with most streams, the
+// frame returned by read_frame() or current_frame() is only valid until
+// the next call to advance(), read_frame() or seek_frame(); copy it to
+// keep it longer.
+//
+// The wrapped stream must not be used directly while it is wrapped.
+// Without C++11 threads, the frames are decoded on the caller's thread
+// when they are needed.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include "vidl_istream.h"
+#include "vidl_istream_sptr.h"
+#include "vidl_frame_sptr.h"
+#include <vcl_compiler.h>
+
+//: An input stream that decodes frames of another stream on a background thread
+class vidl_decode_ahead_istream
+  : public vidl_istream
+{
+ public:
+  //: Wrap \p source, decoding up to \p frames_ahead frames ahead of the caller
+  vidl_decode_ahead_istream(const vidl_istream_sptr& source, unsigned frames_ahead = 4);
+
+  //: Destructor
+  virtual ~vidl_decode_ahead_istream();
+
+  //: Return true if the stream is open for reading
+  virtual bool is_open() const { return source_ && open_; }
+
+  //: Return true if the stream is in a valid state
+  virtual bool is_valid() const { return current_frame_.as_pointer() != VXL_NULLPTR; }
+
+  //: Return true if the stream supports seeking
+  virtual bool is_seekable() const { return seekable_; }
+
+  //: Return the number of frames if known
+  //  returns -1 for non-seekable streams
+  virtual int num_frames() const { return num_frames_; }
+
+  //: Return the current frame number
+  virtual unsigned int frame_number() const { return frame_number_; }
+
+  //: Return the width of each frame
+  virtual unsigned int width() const { return ni_; }
+
+  //: Return the height of each frame
+  virtual unsigned int height() const { return nj_; }
+
+  //: Return the pixel format
+  virtual vidl_pixel_format format() const { return format_; }
+
+  //: Return the frame rate (FPS, 0.0 if unspecified)
+  virtual double frame_rate() const { return frame_rate_; }
+
+  //: Return the duration in seconds (0.0 if unknown)
+  virtual double duration() const { return duration_; }
+
+  //: Close the stream, and the wrapped stream
+  virtual void close();
+
+  //: Advance to the next frame (but don't acquire an image)
+  virtual bool advance();
+
+  //: Read the next frame from the stream (advance and acquire)
+  virtual vidl_frame_sptr read_frame();
+
+  //: Return the current frame in the stream
+  virtual vidl_frame_sptr current_frame() { return current_frame_; }
+
+  //: Seek to the given frame number
+  // \returns true if successful.  After a failed seek the stream is
+  // invalid and delivers no frames until a later seek succeeds.
+  virtual bool seek_frame(unsigned int frame_number);
+
+  //: Maximum number of frames decoded ahead of the current one
+  unsigned frames_ahead() const { return frames_ahead_; }
+
+  //: Number of frames delivered by advance()
+  unsigned long num_frames_delivered() const;
+
+  //: Number of times advance() had to wait for a frame to be decoded
+  unsigned long num_stalls() const;
+
+  //: Total time, in seconds, advance() has spent waiting for frames
+  double stall_time() const;
+
+  //: Reset the counts of frames delivered and stalls, and the stall time
+  void reset_statistics();
+
+  //: Internal state shared with the decoding thread
+  struct ring;
+
+ private:
+  //: Make slot \p s the current frame
+  void set_current(int s);
+
+  //: Start the decoding thread, if there is one
+  void start();
+
+  //: Stop the decoding thread, if there is one
+  void stop();
+
+  vidl_istream_sptr source_;
+  unsigned frames_ahead_;
+  ring* ring_;
+  vidl_frame_sptr current_frame_;
+
+  bool open_;
+  bool seekable_;
+  int num_frames_;
+  unsigned int frame_number_;
+  unsigned int ni_;
+  unsigned int nj_;
+  vidl_pixel_format format_;
+  double frame_rate_;
+  double duration_;
+};
+
+#endif // vidl_decode_ahead_istream_h_
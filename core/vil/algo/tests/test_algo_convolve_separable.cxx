@@ -0,0 +1,137 @@
+// This is core/vil/algo/tests/test_algo_convolve_separable.cxx
+#include <vector>
+#include <iostream>
+#include <testlib/testlib_test.h>
+#include <vcl_compiler.h>
+#include <vxl_config.h> // for vxl_byte
+#include <vil/vil_image_view.h>
+#include <vil/vil_transpose.h>
+#include <vil/vil_crop.h>
+#include <vil/vil_parallel_for.h>
+#include <vil/algo/vil_convolve_1d.h>
+#include <vil/algo/vil_convolve_separable.h>
+#include <vil/algo/vil_gauss_filter.h>
+
+// The original two pass filter, applied one row at a time
+template <class srcT, class destT>
+static void two_pass(const vil_image_view<srcT>& src, vil_image_view<destT>& dest,
+                     const double* ki, int ki_lo, int ki_hi,
+                     const double* kj, int kj_lo, int kj_hi,
+                     vil_convolve_boundary_option bi, vil_convolve_boundary_option bj)
+{
+  vil_image_view<destT> work(src.ni(), src.nj(), src.nplanes());
+  dest.set_size(src.ni(), src.nj(), src.nplanes());
+  for (unsigned p=0;p<src.nplanes();++p)
+    for (unsigned j=0;j<src.nj();++j)
+      vil_convolve_1d(&src(0,j,p), src.ni(), src.istep(), &work(0,j,p), work.istep(),
+                      ki, ki_lo, ki_hi, float(), bi, bi);
+  for (unsigned p=0;p<src.nplanes();++p)
+    for (unsigned i=0;i<src.ni();++i)
+      vil_convolve_1d(&work(i,0,p), src.nj(), work.jstep(), &dest(i,0,p), dest.jstep(),
+                      kj, kj_lo, kj_hi, float(), bj, bj);
+}
+
+template <class T>
+static bool identical(const vil_image_view<T>& a, const vil_image_view<T>& b)
+{
+  if (a.ni()!=b.ni() || a.nj()!=b.nj() || a.nplanes()!=b.nplanes()) return false;
+  for (unsigned p=0;p<a.nplanes();++p)
+    for (unsigned j=0;j<a.nj();++j)
+      for (unsigned i=0;i<a.ni();++i)
+        if (!(a(i,j,p)==b(i,j,p))) return false;
+  return true;
+}
+
+static void test_sizes(unsigned ni, unsigned nj, unsigned np)
+{
+  std::cout << "Image " << ni << 'x' << nj << 'x' << np << '\n';
+  vil_image_view<vxl_byte> src(ni, nj, np);
+  for (unsigned p=0;p<np;++p)
+    for (unsigned j=0;j<nj;++j)
+      for (unsigned i=0;i<ni;++i)
+        src(i,j,p) = vxl_byte((i*37 + j*101 + p*7 + (i*j)%13) & 0xff);
+
+  // Asymmetric kernels, one of which does not include tap 0.
+  const double kernel_i[] = { 0.1, 0.25, 0.3, 0.2, 0.15 };
+  const double kernel_j[] = { 0.05, 0.1, 0.2, 0.3, 0.2, 0.1, 0.05 };
+  const vil_convolve_boundary_option options[] =
+    { vil_convolve_zero_extend, vil_convolve_constant_extend,
+      vil_convolve_reflect_extend, vil_convolve_trim, vil_convolve_no_extend,
+      vil_convolve_periodic_extend };
+  const char* names[] = { "zero", "constant", "reflect", "trim", "no_extend", "periodic" };
+
+  for (unsigned o=0;o<sizeof(options)/sizeof(options[0]);++o)
+  {
+    vil_image_view<float> expected, result;
+    two_pass(src, expected, kernel_i+2, -2, 2, kernel_j+4, -4, 2, options[o], options[0]);
+    vil_convolve_separable(src, result, kernel_i+2, -2, 2, kernel_j+4, -4, 2,
+                           float(), options[o], options[0]);
+    std::cout << "  i boundary " << names[o] << '\n';
+    TEST("Same as two passes", identical(expected, result), true);
+
+    two_pass(src, expected, kernel_i+2, -2, 2, kernel_j+1, -1, 5, options[0], options[o]);
+    vil_convolve_separable(src, result, kernel_i+2, -2, 2, kernel_j+1, -1, 5,
+                           float(), options[0], options[o]);
+    std::cout << "  j boundary " << names[o] << '\n';
+    TEST("Same as two passes", identical(expected, result), true);
+  }
+}
+
+static void test_algo_convolve_separable()
+{
+  std::cout << "********************************\n"
+           << " Testing vil_convolve_separable\n"
+           << "********************************\n";
+
+  test_sizes(7, 7, 1);
+  test_sizes(40, 9, 2);
+  test_sizes(300, 500, 1);
+  test_sizes(1200, 700, 3);
+
+  // Results must not depend on the number of threads, nor on the layout of
+  // the source view.
+  vil_image_view<float> src(513, 411, 2);
+  for (unsigned p=0;p<2;++p)
+    for (unsigned j=0;j<src.nj();++j)
+      for (unsigned i=0;i<src.ni();++i)
+        src(i,j,p) = float((i*i + 3*j + 17*p) % 251) / 7.0f;
+
+  const unsigned saved_threads = vil_parallel::max_threads();
+  vil_image_view<float> g1, g4, gt, expected;
+  vil_parallel::set_max_threads(1);
+  vil_gauss_filter_2d(src, g1, 2.0, 6, vil_convolve_reflect_extend);
+  vil_parallel::set_max_threads(4);
+  vil_gauss_filter_2d(src, g4, 2.0, 6, vil_convolve_reflect_extend);
+  vil_parallel::set_max_threads(saved_threads);
+  TEST("vil_gauss_filter_2d: same result with 1 and 4 threads", identical(g1, g4), true);
+
+  std::vector<double> filter(13);
+  vil_gauss_filter_gen_ntap(2.0, 0, filter);
+  two_pass(src, expected, &filter[6], -6, 6, &filter[6], -6, 6,
+           vil_convolve_reflect_extend, vil_convolve_reflect_extend);
+  TEST("vil_gauss_filter_2d: same as two passes", identical(g1, expected), true);
+
+  vil_image_view<float> src_t;
+  src_t.deep_copy(vil_transpose(src));
+  vil_gauss_filter_2d(vil_transpose(src_t), gt, 2.0, 6, vil_convolve_reflect_extend);
+  TEST("vil_gauss_filter_2d: same result for a view with non-unit istep",
+       identical(g1, gt), true);
+
+  vil_image_view<float> c1 = vil_crop(src, 3, 400, 5, 300), gc;
+  vil_gauss_filter_2d(c1, gc, 2.0, 6, vil_convolve_reflect_extend);
+  two_pass(c1, expected, &filter[6], -6, 6, &filter[6], -6, 6,
+           vil_convolve_reflect_extend, vil_convolve_reflect_extend);
+  TEST("vil_gauss_filter_2d: cropped view", identical(gc, expected), true);
+
+  // 5 tap filter
+  vil_gauss_filter_5tap_params params(1.0);
+  vil_image_view<float> f1, f4;
+  vil_parallel::set_max_threads(1);
+  vil_gauss_filter_5tap(src, f1, params);
+  vil_parallel::set_max_threads(4);
+  vil_gauss_filter_5tap(src, f4, params);
+  vil_parallel::set_max_threads(saved_threads);
+  TEST("vil_gauss_filter_5tap: same result with 1 and 4 threads", identical(f1, f4), true);
+}
+
+TESTMAIN(test_algo_convolve_separable);
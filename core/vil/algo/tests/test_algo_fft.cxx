@@ -1,12 +1,69 @@
 // This is core/vil/algo/tests/test_algo_fft.cxx
 #include <complex>
 #include <ctime>
+#include <iostream>
 #include <testlib/testlib_test.h>
 #include <vil/vil_math.h>
 #include <vil/vil_image_view.h>
+#include <vil/vil_parallel_for.h>
 #include <vil/algo/vil_fft.h>
 #include <vcl_compiler.h>
 
+//: Compare the real-input transforms with the complex ones.
+static void test_fft_real(unsigned ni, unsigned nj, unsigned np)
+{
+  std::cout << "Real FFT of " << ni << 'x' << nj << 'x' << np << " image\n";
+  vil_image_view<double> img(ni, nj, np);
+  vil_image_view<std::complex<double> > cimg(ni, nj, np);
+  unsigned int seed = 12345;
+  for (unsigned p=0; p<np; ++p)
+    for (unsigned j=0; j<nj; ++j)
+      for (unsigned i=0; i<ni; ++i, seed*=16807)
+        cimg(i,j,p) = img(i,j,p) = 1e-5*(seed%100000) - 0.5;
+
+  vil_image_view<std::complex<double> > spectrum;
+  vil_fft_2d_fwd_real(img, spectrum);
+  vil_fft_2d_fwd(cimg);
+  TEST("Spectrum size", spectrum.ni()==ni && spectrum.nj()==nj && spectrum.nplanes()==np, true);
+  double d = vil_math_ssd_complex(spectrum, cimg, double()) / spectrum.size();
+  TEST_NEAR("Real FFT agrees with complex FFT", d, 0.0, 1e-24);
+
+  vil_image_view<double> back;
+  vil_fft_2d_bwd_real(spectrum, back);
+  d = 0;
+  for (unsigned p=0; p<np; ++p)
+    for (unsigned j=0; j<nj; ++j)
+      for (unsigned i=0; i<ni; ++i)
+        d += (back(i,j,p)-img(i,j,p))*(back(i,j,p)-img(i,j,p));
+  TEST_NEAR("Real inverse FFT recovers image", d/img.size(), 0.0, 1e-24);
+}
+
+//: The result must not depend on the number of threads.
+static void test_fft_threads()
+{
+  vil_image_view<std::complex<float> > img(600, 400);
+  unsigned int seed = 1;
+  for (unsigned j=0; j<img.nj(); ++j)
+    for (unsigned i=0; i<img.ni(); ++i, seed*=16807)
+      img(i,j) = std::complex<float>(1e-5f*(seed%100000), 0.5f);
+  vil_image_view<std::complex<float> > img1, img4;
+  img1.deep_copy(img);
+  img4.deep_copy(img);
+
+  const unsigned old_threads = vil_parallel::max_threads();
+  vil_parallel::set_max_threads(1);
+  vil_fft_2d_fwd(img1);
+  vil_parallel::set_max_threads(4);
+  vil_fft_2d_fwd(img4);
+  vil_parallel::set_max_threads(old_threads);
+
+  bool same = true;
+  for (unsigned j=0; j<img.nj(); ++j)
+    for (unsigned i=0; i<img.ni(); ++i)
+      same = same && img1(i,j) == img4(i,j);
+  TEST("FFT identical with 1 and 4 threads", same, true);
+}
+
 static void test_algo_fft()
 {
   vil_image_view<std::complex<double> > img0(4, 8, 2);
@@ -45,6 +102,11 @@ static void test_algo_fft()
     if (i==0 && j==0) i=1;
     TEST_NEAR("any other FFT coeff. is 0", img0(i,j,p), 0.0, 1e-9);
   }
+
+  test_fft_real(16, 12, 1);
+  test_fft_real(15, 10, 2);
+  test_fft_real(1, 5, 1);
+  test_fft_threads();
 }
 
 TESTMAIN(test_algo_fft);
@@ -6,6 +6,7 @@ DECLARE( test_algo_correlate_1d );
 DECLARE( test_algo_convolve_1d );
 DECLARE( test_algo_correlate_2d );
 DECLARE( test_algo_convolve_2d );
+DECLARE( test_algo_convolve_separable );
 DECLARE( test_algo_exp_filter_1d );
 DECLARE( test_algo_gauss_filter );
 DECLARE( test_algo_exp_grad_filter_1d );
@@ -46,6 +47,7 @@ register_tests()
   REGISTER( test_algo_convolve_1d );
   REGISTER( test_algo_correlate_2d );
   REGISTER( test_algo_convolve_2d );
+  REGISTER( test_algo_convolve_separable );
   REGISTER( test_algo_exp_filter_1d );
   REGISTER( test_algo_gauss_filter );
   REGISTER( test_algo_exp_grad_filter_1d );
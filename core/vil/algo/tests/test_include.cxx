@@ -9,6 +9,7 @@
 #include <vil/algo/vil_colour_space.h>
 #include <vil/algo/vil_convolve_1d.h>
 #include <vil/algo/vil_convolve_2d.h>
+#include <vil/algo/vil_convolve_separable.h>
 #include <vil/algo/vil_corners.h>
 #include <vil/algo/vil_correlate_1d.h>
 #include <vil/algo/vil_correlate_2d.h>
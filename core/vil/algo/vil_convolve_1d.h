@@ -17,12 +17,14 @@
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
-#include <vcl_compiler.h>
+#include <vector>
 #include <vcl_compiler.h>
 #include <vcl_cassert.h>
 #include <vil/vil_image_view.h>
+#include <vil/vil_parallel_for.h>
 #include <vil/vil_image_resource.h>
 #include <vil/vil_property.h>
+#include <vul/vul_tracing.h>
 
 
 //: Available options for boundary behavior
@@ -235,6 +237,94 @@ inline void vil_convolve_1d(const srcT* src0, unsigned nx, std::ptrdiff_t s_step
                        kernel,-k_hi,-k_lo,-1,ac,end_option);
 }
 
+//: Convolve kernel[x] (x in [k_lo,k_hi]) with a row of unit-step pixels
+// Gives exactly the same result as vil_convolve_1d(src0,nx,1,dest0,1,...),
+// since each output sums its terms in the same order, but the interior is
+// accumulated one kernel tap at a time over the whole row. The inner loop
+// then runs over consecutive pixels, which compilers can vectorize.
+// \param acc workspace with room for nx values.
+template <class srcT, class destT, class kernelT, class accumT>
+inline void vil_convolve_1d_contiguous(const srcT* src0, unsigned nx,
+                                       destT* dest0,
+                                       const kernelT* kernel,
+                                       std::ptrdiff_t k_lo, std::ptrdiff_t k_hi,
+                                       accumT* acc,
+                                       vil_convolve_boundary_option start_option,
+                                       vil_convolve_boundary_option end_option)
+{
+  assert(k_hi - k_lo < int(nx));
+
+  vil_convolve_edge_1d(src0,nx,1,dest0,1,kernel,k_lo,k_hi,1,accumT(),start_option);
+
+  // Interior outputs are dest0[k_hi] .. dest0[nx+k_lo-1]
+  const std::ptrdiff_t n = std::ptrdiff_t(nx) + k_lo - k_hi;
+  destT* dest = dest0 + k_hi;
+  for (std::ptrdiff_t i=0;i<n;++i)
+    acc[i] = 0;
+  for (std::ptrdiff_t x=k_hi;x>=k_lo;--x)
+  {
+    const kernelT kx = kernel[x];
+    const srcT* s = src0 + k_hi - x;
+    for (std::ptrdiff_t i=0;i<n;++i)
+      acc[i] += (accumT)(kx*s[i]);
+  }
+  for (std::ptrdiff_t i=0;i<n;++i)
+    dest[i] = destT(acc[i]);
+
+  vil_convolve_edge_1d(src0+(nx-1),nx,-1,
+                       dest0+(nx-1),-1,
+                       kernel,-k_hi,-k_lo,-1,accumT(),end_option);
+}
+
+//: Convolve one row, choosing the fastest available loop for the steps.
+// \param acc workspace with room for nx values (only used for unit steps).
+template <class srcT, class destT, class kernelT, class accumT>
+inline void vil_convolve_1d_row(const srcT* src, unsigned nx, std::ptrdiff_t s_step,
+                                destT* dest, std::ptrdiff_t d_step,
+                                const kernelT* kernel,
+                                std::ptrdiff_t k_lo, std::ptrdiff_t k_hi,
+                                accumT* acc,
+                                vil_convolve_boundary_option start_option,
+                                vil_convolve_boundary_option end_option)
+{
+  if (s_step == 1 && d_step == 1)
+    vil_convolve_1d_contiguous(src,nx,dest,kernel,k_lo,k_hi,acc,start_option,end_option);
+  else if (s_step == 1)
+    vil_convolve_1d(src,nx,1,dest,d_step,kernel,k_lo,k_hi,accumT(),start_option,end_option);
+  else if (d_step == 1)
+    vil_convolve_1d(src,nx,s_step,dest,1,kernel,k_lo,k_hi,accumT(),start_option,end_option);
+  else
+    vil_convolve_1d(src,nx,s_step,dest,d_step,kernel,k_lo,k_hi,accumT(),start_option,end_option);
+}
+
+//: Convolves a range of rows of an image (helper for vil_convolve_1d).
+// Index r of the range refers to row (r % nj) of plane (r / nj).
+template <class srcT, class destT, class kernelT, class accumT>
+struct vil_convolve_1d_rows
+{
+  const vil_image_view<srcT>* src_im;
+  vil_image_view<destT>* dest_im;
+  const kernelT* kernel;
+  std::ptrdiff_t k_lo, k_hi;
+  vil_convolve_boundary_option start_option, end_option;
+
+  void operator()(unsigned r0, unsigned r1) const
+  {
+    VUL_TRACE_SCOPE("vil_convolve_1d rows");
+    const unsigned n_i = src_im->ni(), n_j = src_im->nj();
+    std::vector<accumT> acc(n_i);
+    for (unsigned r=r0;r<r1;++r)
+    {
+      const unsigned p = r / n_j, j = r % n_j;
+      vil_convolve_1d_row(src_im->top_left_ptr()+p*src_im->planestep()+j*src_im->jstep(),
+                          n_i, src_im->istep(),
+                          dest_im->top_left_ptr()+p*dest_im->planestep()+j*dest_im->jstep(),
+                          dest_im->istep(),
+                          kernel,k_lo,k_hi,&acc[0],start_option,end_option);
+    }
+  }
+};
+
 //: Convolve kernel[i] (i in [k_lo,k_hi]) with srcT in i-direction
 // On exit dest_im(i,j) = sum src(i-x,j)*kernel(x)  (x=k_lo..k_hi)
 // \note  This function reverses the kernel. If you don't want the
@@ -248,50 +338,24 @@ inline void vil_convolve_1d(const vil_image_view<srcT>& src_im,
                             vil_image_view<destT>& dest_im,
                             const kernelT* kernel,
                             std::ptrdiff_t k_lo, std::ptrdiff_t k_hi,
-                            accumT ac,
+                            accumT /*ac*/,
                             vil_convolve_boundary_option start_option,
                             vil_convolve_boundary_option end_option)
 {
+  VUL_TRACE_SCOPE("vil_convolve_1d");
   unsigned n_i = src_im.ni();
   unsigned n_j = src_im.nj();
   assert(k_hi - k_lo +1 <= (int) n_i);
-  std::ptrdiff_t s_istep = src_im.istep(), s_jstep = src_im.jstep();
+  VUL_TRACE_HISTOGRAM("vil_convolve_1d.pixels", double(n_i) * n_j * src_im.nplanes());
 
   dest_im.set_size(n_i,n_j,src_im.nplanes());
-  std::ptrdiff_t d_istep = dest_im.istep(),d_jstep = dest_im.jstep();
 
-  for (unsigned int p=0;p<src_im.nplanes();++p)
-  {
-    // Select first row of p-th plane
-    const srcT*  src_row  = src_im.top_left_ptr()+p*src_im.planestep();
-    destT* dest_row = dest_im.top_left_ptr()+p*dest_im.planestep();
-
-    // Apply convolution to each row in turn
-    // First check if either istep is 1 for speed optimisation.
-
-    if (s_istep == 1)
-    {
-      if (d_istep == 1)
-        for (unsigned int j=0;j<n_j;++j,src_row+=s_jstep,dest_row+=d_jstep)
-          vil_convolve_1d(src_row,n_i,1,  dest_row,1,
-                          kernel,k_lo,k_hi,ac,start_option,end_option);
-      else
-        for (unsigned int j=0;j<n_j;++j,src_row+=s_jstep,dest_row+=d_jstep)
-          vil_convolve_1d(src_row,n_i,1,  dest_row,d_istep,
-                          kernel,k_lo,k_hi,ac,start_option,end_option);
-    }
-    else
-    {
-      if (d_istep == 1)
-        for (unsigned int j=0;j<n_j;++j,src_row+=s_jstep,dest_row+=d_jstep)
-          vil_convolve_1d(src_row,n_i,s_istep,  dest_row,1,
-                          kernel,k_lo,k_hi,ac,start_option,end_option);
-      else
-        for (unsigned int j=0;j<n_j;++j,src_row+=s_jstep,dest_row+=d_jstep)
-          vil_convolve_1d(src_row,n_i,s_istep,  dest_row,d_istep,
-                          kernel,k_lo,k_hi,ac,start_option,end_option);
-    }
-  }
+  // Rows are independent, so large images are split into bands of rows
+  // which are processed in parallel.
+  vil_convolve_1d_rows<srcT,destT,kernelT,accumT> rows =
+    { &src_im, &dest_im, kernel, k_lo, k_hi, start_option, end_option };
+  const unsigned grain = 1 + 65536 / (n_i+1);
+  vil_parallel_for(0, n_j*src_im.nplanes(), rows, grain);
 }
 
 template <class destT, class kernelT, class accumT>
@@ -0,0 +1,173 @@
+// This is core/vil/algo/vil_convolve_separable.h
+#ifndef vil_convolve_separable_h_
+#define vil_convolve_separable_h_
+//:
+// \file
+// \brief Separable 2D convolution, fusing the i and j passes band by band
+//
+// vil_convolve_separable gives the same result as applying vil_convolve_1d
+// along i into a work image of type destT, followed by vil_convolve_1d
+// along j (on the transposed views) into the destination.  Instead of
+// building the whole intermediate image, the destination is processed in
+// bands of rows.  Each band filters the source rows it needs along i into
+// a scratch buffer small enough to stay in cache, then filters that buffer
+// along j straight into the destination.  Bands are independent and are
+// spread across threads with vil_parallel_for.
+//
+// The j pass accumulates one kernel tap at a time over whole rows, so the
+// inner loops run over consecutive pixels and vectorize, while each pixel
+// still sums its terms in the same order as vil_convolve_1d.
+
+#include <vector>
+#include <algorithm>
+#include <vcl_compiler.h>
+#include <vcl_cassert.h>
+#include <vil/vil_image_view.h>
+#include <vil/vil_transpose.h>
+#include <vil/vil_parallel_for.h>
+#include <vil/algo/vil_convolve_1d.h>
+
+//: Filters bands of rows of one image (helper for vil_convolve_separable).
+template <class srcT, class destT, class kernelT, class accumT>
+struct vil_convolve_separable_bands
+{
+  const vil_image_view<srcT>* src_im;
+  vil_image_view<destT>* dest_im;
+  const kernelT* kernel_i;
+  std::ptrdiff_t ki_lo, ki_hi;
+  const kernelT* kernel_j;
+  std::ptrdiff_t kj_lo, kj_hi;
+  vil_convolve_boundary_option boundary_i, boundary_j;
+  unsigned n_bands;
+
+  void operator()(unsigned b0, unsigned b1) const
+  {
+    const unsigned ni = src_im->ni(), nj = src_im->nj();
+    // The edge handling reads up to this many rows in from the boundary.
+    const std::ptrdiff_t reach = 1 + std::max(kj_hi - kj_lo, std::max(kj_hi, -kj_lo));
+    std::vector<accumT> acc(ni);
+    std::vector<destT> scratch;
+
+    for (unsigned b=b0;b<b1;++b)
+    {
+      // Output rows [j0,j1) of this band need input rows j-kj_hi .. j-kj_lo.
+      const std::ptrdiff_t j0 = std::ptrdiff_t(b) * nj / n_bands;
+      const std::ptrdiff_t j1 = std::ptrdiff_t(b+1) * nj / n_bands;
+      // The first and last bands also fill in the edge rows at j=0 and j=nj-1.
+      const bool top = b == 0, bottom = b+1 == n_bands;
+      std::ptrdiff_t s0 = std::max<std::ptrdiff_t>(0, j0 - kj_hi);
+      std::ptrdiff_t s1 = std::min<std::ptrdiff_t>(nj, j1 - kj_lo);
+      if (top) s0 = 0, s1 = std::max<std::ptrdiff_t>(s1, std::min<std::ptrdiff_t>(nj, reach));
+      if (bottom) s1 = nj, s0 = std::min<std::ptrdiff_t>(s0, std::max<std::ptrdiff_t>(0, nj - reach));
+
+      scratch.resize(std::size_t(s1-s0) * ni);
+      const std::ptrdiff_t s_jstep = ni;
+
+      for (unsigned p=0;p<src_im->nplanes();++p)
+      {
+        // Filter the rows of the band (plus margins) along i
+        const srcT* src_plane = src_im->top_left_ptr() + p*src_im->planestep();
+        for (std::ptrdiff_t j=s0;j<s1;++j)
+          vil_convolve_1d_row(src_plane + j*src_im->jstep(), ni, src_im->istep(),
+                              &scratch[(j-s0)*s_jstep], 1,
+                              kernel_i, ki_lo, ki_hi, &acc[0], boundary_i, boundary_i);
+
+        // Filter along j: interior rows one kernel tap at a time...
+        destT* dest_plane = dest_im->top_left_ptr() + p*dest_im->planestep();
+        const std::ptrdiff_t d_istep = dest_im->istep(), d_jstep = dest_im->jstep();
+        const std::ptrdiff_t r0 = std::max<std::ptrdiff_t>(j0, kj_hi);
+        const std::ptrdiff_t r1 = std::min<std::ptrdiff_t>(j1, std::ptrdiff_t(nj) + kj_lo);
+        for (std::ptrdiff_t j=r0;j<r1;++j)
+        {
+          for (unsigned i=0;i<ni;++i)
+            acc[i] = 0;
+          for (std::ptrdiff_t x=kj_hi;x>=kj_lo;--x)
+          {
+            const kernelT kx = kernel_j[x];
+            const destT* s = &scratch[(j-x-s0)*s_jstep];
+            for (unsigned i=0;i<ni;++i)
+              acc[i] += (accumT)(kx*s[i]);
+          }
+          destT* dest_row = dest_plane + j*d_jstep;
+          if (d_istep == 1)
+            for (unsigned i=0;i<ni;++i)
+              dest_row[i] = destT(acc[i]);
+          else
+            for (unsigned i=0;i<ni;++i)
+              dest_row[i*d_istep] = destT(acc[i]);
+        }
+
+        // ...and the boundary rows column by column, exactly as vil_convolve_1d does.
+        const destT* s_first = &scratch[0] - s0*s_jstep;           // image row 0
+        const destT* s_last = s_first + (std::ptrdiff_t(nj)-1)*s_jstep;  // image row nj-1
+        for (unsigned i=0;i<ni;++i)
+        {
+          if (top)
+            vil_convolve_edge_1d(s_first+i, nj, s_jstep,
+                                 dest_plane+i*d_istep, d_jstep,
+                                 kernel_j, kj_lo, kj_hi, 1, accumT(), boundary_j);
+          if (bottom)
+            vil_convolve_edge_1d(s_last+i, nj, -s_jstep,
+                                 dest_plane+i*d_istep+(std::ptrdiff_t(nj)-1)*d_jstep, -d_jstep,
+                                 kernel_j, -kj_hi, -kj_lo, -1, accumT(), boundary_j);
+        }
+      }
+    }
+  }
+};
+
+//: Convolve src_im with kernel_i along i and kernel_j along j.
+// Equivalent to
+// \code
+//   vil_image_view<destT> work;
+//   vil_convolve_1d(src_im, work, kernel_i, ki_lo, ki_hi, ac, boundary_i, boundary_i);
+//   vil_image_view<destT> dest_t = vil_transpose(dest_im);
+//   vil_convolve_1d(vil_transpose(work), dest_t, kernel_j, kj_lo, kj_hi, ac, boundary_j, boundary_j);
+// \endcode
+// but without allocating the full work image, and multithreaded.
+// \param kernel_i,kernel_j should point to tap 0.
+// \param dest_im will be resized to size of src_im.
+// \relatesalso vil_image_view
+template <class srcT, class destT, class kernelT, class accumT>
+inline void vil_convolve_separable(const vil_image_view<srcT>& src_im,
+                                   vil_image_view<destT>& dest_im,
+                                   const kernelT* kernel_i,
+                                   std::ptrdiff_t ki_lo, std::ptrdiff_t ki_hi,
+                                   const kernelT* kernel_j,
+                                   std::ptrdiff_t kj_lo, std::ptrdiff_t kj_hi,
+                                   accumT ac,
+                                   vil_convolve_boundary_option boundary_i,
+                                   vil_convolve_boundary_option boundary_j)
+{
+  const unsigned ni = src_im.ni(), nj = src_im.nj();
+  assert(ki_hi - ki_lo +1 <= (int) ni);
+  assert(kj_hi - kj_lo +1 <= (int) nj);
+  dest_im.set_size(ni, nj, src_im.nplanes());
+  if (ni == 0 || nj == 0)
+    return;
+
+  // Periodic extension along j needs the whole column; use two passes.
+  if (boundary_j == vil_convolve_periodic_extend)
+  {
+    vil_image_view<destT> work_im;
+    vil_convolve_1d(src_im, work_im, kernel_i, ki_lo, ki_hi, ac, boundary_i, boundary_i);
+    vil_image_view<destT> dest_im_t = vil_transpose(dest_im);
+    vil_convolve_1d(vil_transpose(work_im), dest_im_t, kernel_j, kj_lo, kj_hi, ac,
+                    boundary_j, boundary_j);
+    return;
+  }
+
+  // Aim for a scratch buffer of about 256kB, but make bands at least a few
+  // kernel widths high so that the margins are not filtered too often.
+  const unsigned min_height = 4 * unsigned(kj_hi - kj_lo + 1);
+  unsigned height = unsigned(262144 / (sizeof(destT) * ni + 1));
+  if (height < min_height) height = min_height;
+  const unsigned n_bands = std::max(1u, nj / height);
+
+  vil_convolve_separable_bands<srcT,destT,kernelT,accumT> bands =
+    { &src_im, &dest_im, kernel_i, ki_lo, ki_hi, kernel_j, kj_lo, kj_hi,
+      boundary_i, boundary_j, n_bands };
+  vil_parallel_for(0, n_bands, bands);
+}
+
+#endif // vil_convolve_separable_h_
@@ -27,4 +27,27 @@ template<class T>
 void
 vil_fft_2d_bwd (vil_image_view<std::complex<T> > & img);
 
+//: Forward FFT of a real image into its full complex spectrum.
+// Gives the same result and scaling as vil_fft_2d_fwd() applied to a
+// complex copy of \p src, for about half the work: each row is transformed
+// as real data and only ni/2+1 columns are transformed, the remaining
+// coefficients following from conjugate symmetry.
+// \relatesalso vil_image_view
+// \relatesalso vil_fft_2d_bwd_real
+template<class T>
+void
+vil_fft_2d_fwd_real (vil_image_view<T> const& src,
+                     vil_image_view<std::complex<T> > & dst);
+
+//: Backward FFT of the spectrum of a real image.
+// Only columns 0 to ni/2 of \p src are used; the others are assumed to be
+// conjugate-symmetric to them, as produced by vil_fft_2d_fwd_real().
+// Scaling is as for vil_fft_2d_bwd(), so the round trip recovers the image.
+// \relatesalso vil_image_view
+// \relatesalso vil_fft_2d_fwd_real
+template<class T>
+void
+vil_fft_2d_bwd_real (vil_image_view<std::complex<T> > const& src,
+                     vil_image_view<T> & dst);
+
 #endif // vil_fft_h_
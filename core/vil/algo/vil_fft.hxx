@@ -6,14 +6,75 @@
 // \brief Functions to apply the FFT to an image.
 // \author Fred Wheeler
 
+#include <algorithm>
 #include <complex>
 #include <vector>
 #include "vil_fft.h"
 #include <vcl_compiler.h>
 #include <vil/vil_image_view.h>
-#include <vnl/algo/vnl_fft_1d.h>
+#include <vil/vil_parallel_for.h>
+#include <vnl/algo/vnl_fft_plan.h>
+
+//: Transforms batches of the lines of vil_fft_2d_base.
+// Index t of the range is batch (t % n_batches) of plane (t / n_batches).
+template<class T>
+struct vil_fft_lines
+{
+  std::complex<T> * data;
+  vnl_fft_plan<T> const* plan;
+  unsigned n0, n1;
+  std::ptrdiff_t step0, step1, step2;
+  unsigned batch, n_batches;
+  int dir;
+  T factor;
+
+  void operator()(unsigned begin, unsigned end) const
+  {
+    std::vector<std::complex<T> > v;
+    for (unsigned t=begin; t<end; ++t)
+    {
+      const unsigned i2 = t / n_batches;
+      const unsigned i1_begin = (t % n_batches) * batch;
+      const unsigned lot = std::min(batch, n1 - i1_begin);
+      std::complex<T> * d0 = data + i1_begin*step1 + i2*step2;
+
+      if (step0 > 0 && step1 > 0) // use the data memory directly
+      {
+        plan->transform(d0, step0, step1, lot, dir);
+        if (dir >= 0)
+          for (unsigned l=0; l<lot; ++l)
+          {
+            std::complex<T> * d = d0 + l*step1;
+            for (unsigned i0=0; i0<n0; ++i0, d+=step0)
+              *d *= factor; // proper scaling for forward FFT
+          }
+      }
+      else // must copy the lines to a std::vector
+      {
+        v.resize(n0*lot);
+        for (unsigned l=0; l<lot; ++l)
+        {
+          std::complex<T> * d = d0 + l*step1;
+          for (unsigned i0=0; i0<n0; i0++, d+=step0)
+            v[l*n0 + i0] = *d;
+        }
+        plan->transform(&v[0], 1, n0, lot, dir);
+        // copy std::vector back to non-contiguous data memory
+        for (unsigned l=0; l<lot; ++l)
+        {
+          std::complex<T> * d = d0 + l*step1;
+          for (unsigned i0=0; i0<n0; i0++, d+=step0)
+            *d = v[l*n0 + i0]*factor; // proper scaling for forward FFT
+        }
+      }
+    }
+  }
+};
 
 //: Perform in place FFT in one dimension.
+// The n1 lines of each plane are transformed in batches, through the
+// shared vnl_fft_plan for length n0, and the batches are split across
+// threads when the image is large.
 template<class T>
 static void
 vil_fft_2d_base(std::complex<T> * data,
@@ -22,39 +83,75 @@ vil_fft_2d_base(std::complex<T> * data,
                 unsigned n2, std::ptrdiff_t step2, // nplanes, planestep
                 int dir)
 {
-  vnl_fft_1d<T> fft_1d(n0);
-  T factor = dir<0 ? T(1) : T(1)/static_cast<T>(n0);
+  if (n0 == 0 || n1 == 0 || n2 == 0)
+    return;
+  vil_fft_lines<T> lines;
+  lines.data = data;
+  lines.plan = &vnl_fft_plan<T>::get(n0);
+  lines.n0 = n0;       lines.n1 = n1;
+  lines.step0 = step0; lines.step1 = step1; lines.step2 = step2;
+  lines.batch = 64;
+  lines.n_batches = (n1 + lines.batch - 1) / lines.batch;
+  lines.dir = dir;
+  lines.factor = dir<0 ? T(1) : T(1)/static_cast<T>(n0);
 
-  if (1 == step0) // use contiguous data memory directly
+  // Keep at least about 64k pixels per thread.
+  const unsigned grain = 1 + 65536u / (lines.batch*n0);
+  vil_parallel_for(0, n2*lines.n_batches, lines, grain);
+}
+
+//: Transforms the rows of a real image, keeping the first ni/2+1 coefficients.
+// Index t of the range is row (t % nj) of plane (t / nj).
+template<class T>
+struct vil_fft_real_rows_fwd
+{
+  vil_image_view<T> const* src;
+  vil_image_view<std::complex<T> > * dst;
+  vnl_fft_plan<T> const* plan;
+
+  void operator()(unsigned begin, unsigned end) const
   {
-    // FFT every pixel row (or column) in every colour band:
-    for (unsigned i1=0; i1<n1; i1++)
-    for (unsigned i2=0; i2<n2; i2++)
+    const unsigned ni = src->ni(), nj = src->nj(), nh = ni/2 + 1;
+    const T factor = T(1)/static_cast<T>(ni);
+    std::vector<T> row(ni);
+    std::vector<std::complex<T> > spectrum(nh);
+    for (unsigned t=begin; t<end; ++t)
     {
-      std::complex<T> * d = data + i1*step1 + i2*step2;
-      fft_1d.transform(d, dir);
-      if (dir >= 0)
-        for (unsigned i0=0; i0<n0; ++i0)
-          d[i0] *= factor; // proper scaling for forward FFT
+      const unsigned j = t % nj, p = t / nj;
+      for (unsigned i=0; i<ni; ++i)
+        row[i] = (*src)(i, j, p);
+      plan->fwd_real(&row[0], &spectrum[0]);
+      for (unsigned i=0; i<nh; ++i)
+        (*dst)(i, j, p) = spectrum[i]*factor;
     }
   }
-  else // must copy non-contiguous data memory to a std::vector
+};
+
+//: Transforms the first ni/2+1 coefficients of each row back to real values.
+// Index t of the range is row (t % nj) of plane (t / nj).
+template<class T>
+struct vil_fft_real_rows_bwd
+{
+  vil_image_view<std::complex<T> > const* src;
+  vil_image_view<T> * dst;
+  vnl_fft_plan<T> const* plan;
+
+  void operator()(unsigned begin, unsigned end) const
   {
-    std::vector<std::complex<T> > v(n0);
-    for (unsigned i1=0; i1<n1; i1++)
-    for (unsigned i2=0; i2<n2; i2++)
+    const unsigned ni = dst->ni(), nj = dst->nj(), nh = ni/2 + 1;
+    std::vector<T> row(ni);
+    std::vector<std::complex<T> > spectrum(nh);
+    for (unsigned t=begin; t<end; ++t)
     {
-      std::complex<T> * d = data + i1*step1 + i2*step2;
-      for (unsigned i0=0; i0<n0; i0++, d+=step0)
-        v[i0] = *d;
-      fft_1d.transform(v, dir);
-      // copy std::vector back to non-contiguous data memory
-      d = data + i1*step1 + i2*step2;
-      for (unsigned i0=0; i0<n0; i0++, d+=step0)
-        *d = v[i0]*factor; // proper scaling for forward FFT
+      const unsigned j = t % nj, p = t / nj;
+      for (unsigned i=0; i<nh; ++i)
+        spectrum[i] = (*src)(i, j, p);
+      plan->bwd_real(&spectrum[0], &row[0]);
+      for (unsigned i=0; i<ni; ++i)
+        (*dst)(i, j, p) = row[i];
     }
   }
-}
+};
 
 template<class T>
 void
@@ -88,6 +185,69 @@ vil_fft_2d_bwd(vil_image_view<std::complex<T> >& img)
                   -1);
 }
 
+template<class T>
+void
+vil_fft_2d_fwd_real(vil_image_view<T> const& src,
+                    vil_image_view<std::complex<T> >& dst)
+{
+  const unsigned ni = src.ni(), nj = src.nj(), np = src.nplanes();
+  dst.set_size(ni, nj, np);
+  if (ni == 0 || nj == 0 || np == 0)
+    return;
+  const unsigned nh = ni/2 + 1;
+
+  // Rows: only the first nh coefficients are independent ...
+  vil_fft_real_rows_fwd<T> rows;
+  rows.src = &src;
+  rows.dst = &dst;
+  rows.plan = &vnl_fft_plan<T>::get(ni);
+  vil_parallel_for(0, nj*np, rows, 1 + 65536u/ni);
+
+  // ... so only those columns need transforming ...
+  vil_fft_2d_base(dst.top_left_ptr(),
+                  nj, dst.jstep(),
+                  nh, dst.istep(),
+                  np, dst.planestep(),
+                  1);
+
+  // ... and the rest follow from F(i,j) = conj(F(ni-i, nj-j)).
+  for (unsigned p=0; p<np; ++p)
+    for (unsigned j=0; j<nj; ++j)
+      for (unsigned i=nh; i<ni; ++i)
+        dst(i, j, p) = std::conj(dst(ni-i, j==0 ? 0 : nj-j, p));
+}
+
+template<class T>
+void
+vil_fft_2d_bwd_real(vil_image_view<std::complex<T> > const& src,
+                    vil_image_view<T>& dst)
+{
+  const unsigned ni = src.ni(), nj = src.nj(), np = src.nplanes();
+  dst.set_size(ni, nj, np);
+  if (ni == 0 || nj == 0 || np == 0)
+    return;
+  const unsigned nh = ni/2 + 1;
+
+  // Columns, of the independent half of the spectrum only
+  vil_image_view<std::complex<T> > half(nh, nj, np);
+  for (unsigned p=0; p<np; ++p)
+    for (unsigned j=0; j<nj; ++j)
+      for (unsigned i=0; i<nh; ++i)
+        half(i, j, p) = src(i, j, p);
+  vil_fft_2d_base(half.top_left_ptr(),
+                  nj, half.jstep(),
+                  nh, half.istep(),
+                  np, half.planestep(),
+                  -1);
+
+  // Rows, each of which now has conjugate-symmetric coefficients
+  vil_fft_real_rows_bwd<T> rows;
+  rows.src = &half;
+  rows.dst = &dst;
+  rows.plan = &vnl_fft_plan<T>::get(ni);
+  vil_parallel_for(0, nj*np, rows, 1 + 65536u/ni);
+}
+
 #undef VIL_FFT_INSTANTIATE
 #define VIL_FFT_INSTANTIATE(T) \
 template void vil_fft_2d_base(std::complex<T >* data, \
@@ -96,6 +256,10 @@ template void vil_fft_2d_base(std::complex<T >* data, \
                               unsigned n2, std::ptrdiff_t step2, \
                               int dir); \
 template void vil_fft_2d_fwd(vil_image_view<std::complex<T > >& img); \
-template void vil_fft_2d_bwd(vil_image_view<std::complex<T > >& img)
+template void vil_fft_2d_bwd(vil_image_view<std::complex<T > >& img); \
+template void vil_fft_2d_fwd_real(vil_image_view<T > const& src, \
+                                  vil_image_view<std::complex<T > >& dst); \
+template void vil_fft_2d_bwd_real(vil_image_view<std::complex<T > > const& src, \
+                                  vil_image_view<T >& dst)
 
 #endif // vil_fft_hxx_
@@ -9,6 +9,7 @@
 #include <iostream>
 #include "vil_gauss_filter.h"
 #include <vil/vil_transpose.h>
+#include <vil/vil_parallel_for.h>
 #include <vil/algo/vil_convolve_1d.h>
 #include <vcl_compiler.h>
 #include <vcl_cassert.h>
@@ -27,6 +28,100 @@ inline   signed long  vl_round(double x,   signed long  ) { return (  signed lon
 inline   double       vl_round(double x,   double       ) { return x; }
 inline    float       vl_round(double x,    float       ) { return (float)x; }
 
+//=======================================================================
+//: Rows of the horizontal and vertical passes of vil_gauss_filter_5tap.
+//  Each output row only depends on the input, so ranges of rows can be
+//  processed in parallel.
+template <class srcT, class destT>
+struct vil_gauss_filter_5tap_rows
+{
+  const srcT* src_im; std::ptrdiff_t src_istep, src_jstep;
+  destT* dest_im; std::ptrdiff_t dest_istep, dest_jstep;
+  unsigned nx;
+  const vil_gauss_filter_5tap_params* p;
+  destT* work; std::ptrdiff_t work_jstep;
+
+  //: Horizontal smoothing of src rows [y0,y1) into work
+  void horizontal(unsigned y0, unsigned y1) const
+  {
+    const vil_gauss_filter_5tap_params& params = *p;
+    for (unsigned int y=y0;y<y1;y++)
+    {
+      destT* work_row = work + y*work_jstep;
+      const srcT* src_col3  = src_im + y*src_jstep;
+      const srcT* src_col2  = src_col3 - src_istep;
+      const srcT* src_col1  = src_col3 - 2 * src_istep;
+      const srcT* src_col4  = src_col3 + src_istep;
+      const srcT* src_col5  = src_col3 + 2 * src_istep;
+
+      int x;
+      int nx2 = nx-2;
+      for (x=2;x<nx2;x++)
+        work_row[x] = vl_round( params.filt2() * src_col1[x*src_istep]
+                              + params.filt1() * src_col2[x*src_istep]
+                              + params.filt0() * src_col3[x*src_istep]
+                              + params.filt1() * src_col4[x*src_istep]
+                              + params.filt2() * src_col5[x*src_istep], (destT)0);
+
+      // Now deal with edge effects :
+      work_row[0] = vl_round( params.filt_edge0() * src_col3[0]
+                            + params.filt_edge1() * src_col4[0]
+                            + params.filt_edge2() * src_col5[0], (destT)0);
+
+      work_row[1] = vl_round( params.filt_pen_edge_n1() * src_col2[src_istep]
+                            + params.filt_pen_edge0() * src_col3[src_istep]
+                            + params.filt_pen_edge1() * src_col4[src_istep]
+                            + params.filt_pen_edge2() * src_col5[src_istep], (destT)0);
+
+      work_row[nx-2] = vl_round( params.filt_pen_edge2() * src_col1[(nx-2)*src_istep]
+                               + params.filt_pen_edge1() * src_col2[(nx-2)*src_istep]
+                               + params.filt_pen_edge0() * src_col3[(nx-2)*src_istep]
+                               + params.filt_pen_edge_n1() * src_col4[(nx-2)*src_istep], (destT)0);
+
+      work_row[nx-1] = vl_round( params.filt_edge2() * src_col1[(nx-1)*src_istep]
+                               + params.filt_edge1() * src_col2[(nx-1)*src_istep]
+                               + params.filt_edge0() * src_col3[(nx-1)*src_istep], (destT)0);
+    }
+  }
+
+  //: Vertical smoothing of work into dest rows [y0,y1), 2<=y0, y1<=ny-2
+  void vertical(unsigned y0, unsigned y1) const
+  {
+    const vil_gauss_filter_5tap_params& params = *p;
+    for (unsigned int y=y0;y<y1;y++)
+    {
+      destT* dest_row = dest_im + y*dest_jstep;
+
+      const destT* work_row3  = work + y*work_jstep;
+      const destT* work_row2  = work_row3 - work_jstep;
+      const destT* work_row1  = work_row3 - 2 * work_jstep;
+      const destT* work_row4  = work_row3 + work_jstep;
+      const destT* work_row5  = work_row3 + 2 * work_jstep;
+
+      for (unsigned int x=0; x<nx; x++)
+        dest_row[x*dest_istep] = vl_round( params.filt2() * work_row1[x]
+                                         + params.filt1() * work_row2[x]
+                                         + params.filt0() * work_row3[x]
+                                         + params.filt1() * work_row4[x]
+                                         + params.filt2() * work_row5[x], (destT)0);
+    }
+  }
+};
+
+template <class srcT, class destT>
+struct vil_gauss_filter_5tap_hpass
+{
+  const vil_gauss_filter_5tap_rows<srcT,destT>* rows;
+  void operator()(unsigned y0, unsigned y1) const { rows->horizontal(y0,y1); }
+};
+
+template <class srcT, class destT>
+struct vil_gauss_filter_5tap_vpass
+{
+  const vil_gauss_filter_5tap_rows<srcT,destT>* rows;
+  void operator()(unsigned y0, unsigned y1) const { rows->vertical(y0,y1); }
+};
+
 //=======================================================================
 //: Smooth and subsample src_im to produce dest_im
 //  Applies 5 pin filter in x and y, then samples
@@ -43,63 +138,16 @@ void vil_gauss_filter_5tap(const srcT* src_im, std::ptrdiff_t src_istep, std::pt
   // Convolve src with a 5 x 1 Gaussian filter,
   // placing result in work_
   // First perform horizontal smoothing
-  for (unsigned int y=0;y<ny;y++)
-  {
-    destT* work_row = work + y*work_jstep;
-    const srcT* src_col3  = src_im + y*src_jstep;
-    const srcT* src_col2  = src_col3 - src_istep;
-    const srcT* src_col1  = src_col3 - 2 * src_istep;
-    const srcT* src_col4  = src_col3 + src_istep;
-    const srcT* src_col5  = src_col3 + 2 * src_istep;
-
-    int x;
-    int nx2 = nx-2;
-    for (x=2;x<nx2;x++)
-      work_row[x] = vl_round( params.filt2() * src_col1[x*src_istep]
-                            + params.filt1() * src_col2[x*src_istep]
-                            + params.filt0() * src_col3[x*src_istep]
-                            + params.filt1() * src_col4[x*src_istep]
-                            + params.filt2() * src_col5[x*src_istep], (destT)0);
-
-    // Now deal with edge effects :
-    work_row[0] = vl_round( params.filt_edge0() * src_col3[0]
-                          + params.filt_edge1() * src_col4[0]
-                          + params.filt_edge2() * src_col5[0], (destT)0);
-
-    work_row[1] = vl_round( params.filt_pen_edge_n1() * src_col2[src_istep]
-                          + params.filt_pen_edge0() * src_col3[src_istep]
-                          + params.filt_pen_edge1() * src_col4[src_istep]
-                          + params.filt_pen_edge2() * src_col5[src_istep], (destT)0);
-
-    work_row[nx-2] = vl_round( params.filt_pen_edge2() * src_col1[(nx-2)*src_istep]
-                             + params.filt_pen_edge1() * src_col2[(nx-2)*src_istep]
-                             + params.filt_pen_edge0() * src_col3[(nx-2)*src_istep]
-                             + params.filt_pen_edge_n1() * src_col4[(nx-2)*src_istep], (destT)0);
-
-    work_row[nx-1] = vl_round( params.filt_edge2() * src_col1[(nx-1)*src_istep]
-                             + params.filt_edge1() * src_col2[(nx-1)*src_istep]
-                             + params.filt_edge0() * src_col3[(nx-1)*src_istep], (destT)0);
-  }
+  const vil_gauss_filter_5tap_rows<srcT,destT> rows =
+    { src_im, src_istep, src_jstep, dest_im, dest_istep, dest_jstep, nx, &params, work, work_jstep };
+  const unsigned grain = 1 + 65536 / nx;
+  const vil_gauss_filter_5tap_hpass<srcT,destT> hpass = { &rows };
+  vil_parallel_for(0, ny, hpass, grain);
 
 //  work_.print_all(std::cout);
   // Now perform vertical smoothing
-  for (unsigned int y=2;y<ny-2;y++)
-  {
-    destT* dest_row = dest_im + y*dest_jstep;
-
-    const destT* work_row3  = work + y*work_jstep;
-    const destT* work_row2  = work_row3 - work_jstep;
-    const destT* work_row1  = work_row3 - 2 * work_jstep;
-    const destT* work_row4  = work_row3 + work_jstep;
-    const destT* work_row5  = work_row3 + 2 * work_jstep;
-
-    for (unsigned int x=0; x<nx; x++)
-      dest_row[x*dest_istep] = vl_round( params.filt2() * work_row1[x]
-                                       + params.filt1() * work_row2[x]
-                                       + params.filt0() * work_row3[x]
-                                       + params.filt1() * work_row4[x]
-                                       + params.filt2() * work_row5[x], (destT)0);
-  }
+  const vil_gauss_filter_5tap_vpass<srcT,destT> vpass = { &rows };
+  vil_parallel_for(2, ny-2, vpass, grain);
 
   // Now deal with edge effects :
   //
@@ -22,6 +22,7 @@
 #include <vil/vil_image_resource.h>
 #include <vil/vil_image_view.h>
 #include <vil/vil_memory_chunk.h>
+#include <vil/vil_mmap_memory_chunk.h>
 #include <vil/vil_exception.h>
 
 #if 0 // see comment below
@@ -312,6 +313,27 @@ static bool operator>>(vil_stream& vs, int& a)
   return true;
 }
 
+vil_image_view_base_sptr vil_pnm_image::get_view(
+  unsigned x0, unsigned ni, unsigned y0, unsigned nj) const
+{
+  // Samples of raw files can be used in place if they need no unpacking or
+  // byte swapping; 16 bit samples are stored most significant byte first.
+  const bool in_place = magic_ > 4 && bits_per_component_ > 1 &&
+                        (bits_per_component_ <= 8 ||
+                         (VXL_BIG_ENDIAN && bits_per_component_ <= 16));
+  if (x0+ni > ni_ || y0+nj > nj_) return VXL_NULLPTR;
+  vil_memory_chunk_sptr mapped = vs_->mapped_memory();
+  if (in_place && mapped)
+  {
+    const unsigned bytes_per_pixel = nplanes() * ((bits_per_component_+7)/8);
+    vil_image_view_base_sptr view =
+      vil_mmap_image_view(mapped, std::size_t(start_of_data_) + (std::size_t(y0)*ni_ + x0) * bytes_per_pixel,
+                          format_, ni, nj, nplanes(), nplanes(), std::ptrdiff_t(ni_)*nplanes(), 1);
+    if (view) return view;
+  }
+  return get_copy_view(x0, ni, y0, nj);
+}
+
 vil_image_view_base_sptr vil_pnm_image::get_copy_view(
   unsigned x0, unsigned ni, unsigned y0, unsigned nj) const
 {
@@ -96,6 +96,12 @@ class vil_pnm_image : public vil_image_resource
   virtual vil_image_view_base_sptr get_copy_view(unsigned i0, unsigned ni,
                                                  unsigned j0, unsigned nj) const;
 
+  //: Create a view of the pixels in the file, if it is memory mapped.
+  // Raw pgm and ppm files read through a mapped stream return a view
+  // pointing into the mapping; otherwise this is the same as get_copy_view().
+  virtual vil_image_view_base_sptr get_view(unsigned i0, unsigned ni,
+                                            unsigned j0, unsigned nj) const;
+
   virtual bool put_view(const vil_image_view_base& im, unsigned i0, unsigned j0);
 
   char const* file_format() const;
@@ -0,0 +1,175 @@
+// This is core/vil/file_formats/vil_raw.cxx
+//:
+// \file
+
+#include <cstring>
+#include <vector>
+#include "vil_raw.h"
+#include <vcl_compiler.h>
+#include <vxl_config.h> // for vxl_byte
+#include <vil/vil_image_view.h>
+#include <vil/vil_memory_chunk.h>
+#include <vil/vil_mmap_memory_chunk.h>
+#include <vil/vil_stream_mmap.h>
+#include <vil/vil_stream_fstream.h>
+#include <vil/vil_exception.h>
+
+static char const* vil_raw_format_tag = "raw";
+
+//: True if pixels of this format can be stored in a raw file
+static bool vil_raw_format_ok(vil_pixel_format format)
+{
+  switch (format)
+  {
+#if VXL_HAS_INT_64
+   case VIL_PIXEL_FORMAT_UINT_64:
+   case VIL_PIXEL_FORMAT_INT_64:
+#endif
+   case VIL_PIXEL_FORMAT_UINT_32:
+   case VIL_PIXEL_FORMAT_INT_32:
+   case VIL_PIXEL_FORMAT_UINT_16:
+   case VIL_PIXEL_FORMAT_INT_16:
+   case VIL_PIXEL_FORMAT_BYTE:
+   case VIL_PIXEL_FORMAT_SBYTE:
+   case VIL_PIXEL_FORMAT_FLOAT:
+   case VIL_PIXEL_FORMAT_DOUBLE:
+    return true;
+   default:
+    return false;
+  }
+}
+
+char const* vil_raw_file_format::tag() const
+{
+  return vil_raw_format_tag;
+}
+
+vil_image_resource_sptr vil_raw_file_format::make_input_image(vil_stream*)
+{
+  return VXL_NULLPTR;
+}
+
+vil_image_resource_sptr vil_raw_file_format::make_output_image(vil_stream* vs,
+                                                               unsigned ni, unsigned nj, unsigned nplanes,
+                                                               vil_pixel_format format)
+{
+  // Multi-component pixels are stored as interleaved planes
+  nplanes *= vil_pixel_format_num_components(format);
+  format = vil_pixel_format_component_format(format);
+  if (!vil_raw_format_ok(format)) return VXL_NULLPTR;
+  return new vil_raw_image(vs, ni, nj, nplanes, format);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+vil_raw_image::vil_raw_image(vil_stream* vs, unsigned ni, unsigned nj, unsigned nplanes,
+                             vil_pixel_format format, vil_streampos offset)
+: vs_(vs), ni_(ni), nj_(nj), nplanes_(nplanes), format_(format), offset_(offset)
+{
+  vs_->ref();
+}
+
+vil_raw_image::~vil_raw_image()
+{
+  vs_->unref();
+}
+
+char const* vil_raw_image::file_format() const
+{
+  return vil_raw_format_tag;
+}
+
+bool vil_raw_image::get_property(char const * /*tag*/, void * /*prop*/) const
+{
+  return false;
+}
+
+vil_streampos vil_raw_image::size_bytes() const
+{
+  return vil_streampos(ni_) * nj_ * nplanes_ * vil_pixel_format_sizeof_components(format_);
+}
+
+vil_image_view_base_sptr vil_raw_image::get_copy_view(unsigned i0, unsigned ni,
+                                                      unsigned j0, unsigned nj) const
+{
+  if (i0+ni > ni_ || j0+nj > nj_) return VXL_NULLPTR;
+  const unsigned bytes_per_pixel = nplanes_ * vil_pixel_format_sizeof_components(format_);
+  const std::size_t row_bytes = std::size_t(ni) * bytes_per_pixel;
+  vil_memory_chunk_sptr buf = new vil_memory_chunk(row_bytes * nj, format_);
+  char* out = reinterpret_cast<char*>(buf->data());
+  for (unsigned j = 0; j < nj; ++j, out += row_bytes)
+  {
+    vs_->seek(offset_ + (vil_streampos(j0+j) * ni_ + i0) * bytes_per_pixel);
+    if (vs_->read(out, vil_streampos(row_bytes)) != vil_streampos(row_bytes))
+      return VXL_NULLPTR;
+  }
+  return vil_mmap_image_view(buf, 0, format_, ni, nj, nplanes_,
+                             nplanes_, std::ptrdiff_t(ni)*nplanes_, 1);
+}
+
+vil_image_view_base_sptr vil_raw_image::get_view(unsigned i0, unsigned ni,
+                                                 unsigned j0, unsigned nj) const
+{
+  vil_memory_chunk_sptr mapped = vs_->mapped_memory();
+  if (mapped && i0+ni <= ni_ && j0+nj <= nj_)
+  {
+    const unsigned bytes_per_pixel = nplanes_ * vil_pixel_format_sizeof_components(format_);
+    vil_image_view_base_sptr view =
+      vil_mmap_image_view(mapped, std::size_t(offset_) + (std::size_t(j0)*ni_ + i0) * bytes_per_pixel,
+                          format_, ni, nj, nplanes_, nplanes_, std::ptrdiff_t(ni_)*nplanes_, 1);
+    if (view) return view;
+  }
+  return get_copy_view(i0, ni, j0, nj);
+}
+
+bool vil_raw_image::put_view(vil_image_view_base const& buf, unsigned i0, unsigned j0)
+{
+  if (buf.pixel_format() != format_ || buf.nplanes() != nplanes_ || !view_fits(buf, i0, j0))
+  {
+    vil_exception_warning(vil_exception_out_of_bounds("vil_raw_image::put_view"));
+    return false;
+  }
+  // Any vil_image_view<T> can be walked as bytes using its steps
+  const unsigned sample_bytes = vil_pixel_format_sizeof_components(format_);
+  vil_image_view<vxl_byte> const& bbuf = reinterpret_cast<vil_image_view<vxl_byte> const&>(buf);
+  const vxl_byte* top_left = bbuf.top_left_ptr();
+  const std::ptrdiff_t istep = bbuf.istep()*sample_bytes, jstep = bbuf.jstep()*sample_bytes,
+                       pstep = bbuf.planestep()*sample_bytes;
+  const std::size_t row_bytes = std::size_t(buf.ni()) * nplanes_ * sample_bytes;
+  std::vector<vxl_byte> row(row_bytes);
+  for (unsigned j = 0; j < buf.nj(); ++j)
+  {
+    vxl_byte* out = row_bytes ? &row[0] : VXL_NULLPTR;
+    for (unsigned i = 0; i < buf.ni(); ++i)
+      for (unsigned p = 0; p < nplanes_; ++p, out += sample_bytes)
+        std::memcpy(out, top_left + j*jstep + i*istep + p*pstep, sample_bytes);
+    vs_->seek(offset_ + (vil_streampos(j0+j) * ni_ + i0) * nplanes_ * sample_bytes);
+    if (vs_->write(row_bytes ? &row[0] : VXL_NULLPTR, vil_streampos(row_bytes)) != vil_streampos(row_bytes))
+      return false;
+  }
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+vil_image_resource_sptr vil_raw_load_image_resource(char const* filename,
+                                                    unsigned ni, unsigned nj, unsigned nplanes,
+                                                    vil_pixel_format format,
+                                                    vil_streampos offset)
+{
+  if (!vil_raw_format_ok(format) || offset < 0) return VXL_NULLPTR;
+  vil_stream* vs = new vil_stream_mmap(filename);
+  vs->ref();
+  if (!vs->ok())
+  {
+    vs->unref();
+    vs = new vil_stream_fstream(filename, "r");
+    vs->ref();
+  }
+  const vil_streampos n = vil_streampos(ni) * nj * nplanes * vil_pixel_format_sizeof_components(format);
+  vil_image_resource_sptr im;
+  if (vs->ok() && vs->file_size() >= offset + n)
+    im = new vil_raw_image(vs, ni, nj, nplanes, format, offset);
+  vs->unref();
+  return im;
+}
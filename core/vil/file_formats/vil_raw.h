@@ -0,0 +1,87 @@
+// This is core/vil/file_formats/vil_raw.h
+#ifndef vil_raw_file_format_h_
+#define vil_raw_file_format_h_
+//:
+// \file
+// \brief Headerless files of raw pixel samples
+//
+// A raw file holds nothing but the pixel samples, optionally after a header
+// of known length which is skipped.  Samples are stored in native byte
+// order, one row after another, with the planes of each pixel interleaved.
+// Since there is no header, vil_load() cannot recognise such files; open
+// them with vil_raw_load_image_resource(), which memory maps the file when
+// possible so that get_view() returns views straight into the file.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <vil/vil_file_format.h>
+#include <vil/vil_image_resource.h>
+#include <vil/vil_stream.h>
+
+//: Writer for raw files.
+// make_input_image() always fails, as raw files carry no description of
+// their contents.
+class vil_raw_file_format : public vil_file_format
+{
+ public:
+  virtual char const* tag() const;
+  virtual vil_image_resource_sptr make_input_image(vil_stream* vs);
+  virtual vil_image_resource_sptr make_output_image(vil_stream* vs,
+                                                    unsigned ni, unsigned nj, unsigned nplanes,
+                                                    vil_pixel_format format);
+};
+
+//: Generic image implementation for raw files
+class vil_raw_image : public vil_image_resource
+{
+  vil_stream* vs_;
+  unsigned ni_;
+  unsigned nj_;
+  unsigned nplanes_;
+  vil_pixel_format format_;
+  //: Position in the stream of the first sample
+  vil_streampos offset_;
+
+ public:
+  //: Image of the given size and scalar format, starting offset bytes into the stream.
+  vil_raw_image(vil_stream* vs, unsigned ni, unsigned nj, unsigned nplanes,
+                vil_pixel_format format, vil_streampos offset = 0);
+  ~vil_raw_image();
+
+  virtual unsigned ni() const { return ni_; }
+  virtual unsigned nj() const { return nj_; }
+  virtual unsigned nplanes() const { return nplanes_; }
+
+  virtual enum vil_pixel_format pixel_format() const { return format_; }
+
+  //: Number of bytes in the file taken up by the pixels
+  vil_streampos size_bytes() const;
+
+  //: Return part of this as buffer
+  virtual vil_image_view_base_sptr get_copy_view(unsigned i0, unsigned ni,
+                                                 unsigned j0, unsigned nj) const;
+
+  //: Create a view of the pixels in the file, if it is memory mapped.
+  // Otherwise this is the same as get_copy_view().
+  virtual vil_image_view_base_sptr get_view(unsigned i0, unsigned ni,
+                                            unsigned j0, unsigned nj) const;
+
+  //: Write buf into this at position (i0,j0)
+  virtual bool put_view(vil_image_view_base const& buf, unsigned i0, unsigned j0);
+
+  char const* file_format() const;
+  bool get_property(char const *tag, void *prop = VXL_NULLPTR) const;
+};
+
+//: Open a raw file holding an image of known size and format.
+// The pixels start offset bytes into the file.  The file is memory mapped
+// if possible.  Returns a null pointer if the file cannot be opened, is too
+// short, or format is not a scalar pixel type.
+vil_image_resource_sptr vil_raw_load_image_resource(char const* filename,
+                                                    unsigned ni, unsigned nj, unsigned nplanes,
+                                                    vil_pixel_format format,
+                                                    vil_streampos offset = 0);
+
+#endif // vil_raw_file_format_h_
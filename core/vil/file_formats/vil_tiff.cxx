@@ -3,6 +3,7 @@
 #include <iostream>
 #include <algorithm>
 #include <sstream>
+#include <vector>
 #include "vil_tiff.h"
 //:
 // \file
@@ -23,10 +24,15 @@
 #include <vil/vil_property.h>
 #include <vil/vil_image_view.h>
 #include <vil/vil_memory_chunk.h>
+#include <vil/vil_mmap_memory_chunk.h>
 #include <vil/vil_copy.h>
 #include <vil/vil_image_list.h>
 #include "vil_tiff_header.h"
 #include <vil/vil_exception.h>
+#include <vil/vil_parallel_for.h>
+#if VXL_FULLCXX11SUPPORT
+# include <mutex>
+#endif
 //#define DEBUG
 
 // Constants
@@ -187,6 +193,279 @@ static TIFF* open_tiff(tif_stream_structures* tss, const char* mode)
     return tiff;
 }
 
+//: Extra TIFF handles on the stream of an input image.
+// A libtiff handle cannot be used by two threads at once, so each thread
+// decoding blocks borrows its own handle.  The handles share the stream but
+// keep their own file positions; only the stream access is serialized, so
+// the decompression itself runs concurrently.
+struct vil_tiff_decoder_pool
+{
+  vil_tiff_decoder_pool(vil_stream* vs) : vs_(vs) { vs_->ref(); }
+  ~vil_tiff_decoder_pool();
+
+  //: A handle showing directory \p index, or null if it can't be opened
+  TIFF* acquire(unsigned index);
+  //: Return a handle obtained from acquire()
+  void release(TIFF* tif);
+
+  vil_stream* vs_;
+  std::vector<TIFF*> free_;
+#if VXL_FULLCXX11SUPPORT
+  //: guards free_
+  std::mutex list_mutex_;
+  //: serializes seek/read on vs_
+  std::mutex stream_mutex_;
+#endif
+};
+
+//: Client data of a handle in a vil_tiff_decoder_pool
+struct tif_shared_stream
+{
+  tif_shared_stream(vil_tiff_decoder_pool* p) : pool(p), pos(0) {}
+  vil_tiff_decoder_pool* pool;
+  vil_streampos pos;
+};
+
+static tsize_t vil_tiff_shared_readproc(thandle_t h, tdata_t buf, tsize_t n)
+{
+  tif_shared_stream* p = (tif_shared_stream*)h;
+#if VXL_FULLCXX11SUPPORT
+  std::lock_guard<std::mutex> lock(p->pool->stream_mutex_);
+#endif
+  p->pool->vs_->seek(p->pos);
+  vil_streampos ret = p->pool->vs_->read(buf, n);
+  p->pos += ret;
+  return (tsize_t)ret;
+}
+
+static tsize_t vil_tiff_shared_writeproc(thandle_t, tdata_t, tsize_t)
+{
+  return 0; // decoder handles are read only
+}
+
+static toff_t vil_tiff_shared_seekproc(thandle_t h, toff_t offset, int whence)
+{
+  tif_shared_stream* p = (tif_shared_stream*)h;
+  if      (whence == SEEK_SET) p->pos = offset;
+  else if (whence == SEEK_CUR) p->pos += offset;
+  else if (whence == SEEK_END)
+  {
+#if VXL_FULLCXX11SUPPORT
+    std::lock_guard<std::mutex> lock(p->pool->stream_mutex_);
+#endif
+    p->pos = p->pool->vs_->file_size() + offset;
+  }
+  return (toff_t)p->pos;
+}
+
+static int vil_tiff_shared_closeproc(thandle_t h)
+{
+  delete (tif_shared_stream*)h;
+  return 0;
+}
+
+vil_tiff_decoder_pool::~vil_tiff_decoder_pool()
+{
+  for (unsigned k = 0; k < free_.size(); ++k)
+    TIFFClose(free_[k]);
+  vs_->unref();
+}
+
+TIFF* vil_tiff_decoder_pool::acquire(unsigned index)
+{
+  TIFF* tif = VXL_NULLPTR;
+  {
+#if VXL_FULLCXX11SUPPORT
+    std::lock_guard<std::mutex> lock(list_mutex_);
+#endif
+    if (!free_.empty())
+    {
+      tif = free_.back();
+      free_.pop_back();
+    }
+  }
+  if (!tif)
+  {
+    // opened the same way as the main handle, so that strips are chopped alike
+    tif = TIFFClientOpen("unknown filename", "rC",
+                         (thandle_t)new tif_shared_stream(this),
+                         vil_tiff_shared_readproc, vil_tiff_shared_writeproc,
+                         vil_tiff_shared_seekproc, vil_tiff_shared_closeproc,
+                         vil_tiff_sizeproc,
+                         vil_tiff_mapfileproc, vil_tiff_unmapfileproc);
+    if (!tif)
+      return VXL_NULLPTR;
+  }
+  if (TIFFCurrentDirectory(tif) != index && !TIFFSetDirectory(tif, (tdir_t)index))
+  {
+    TIFFClose(tif);
+    return VXL_NULLPTR;
+  }
+  return tif;
+}
+
+void vil_tiff_decoder_pool::release(TIFF* tif)
+{
+#if VXL_FULLCXX11SUPPORT
+  std::lock_guard<std::mutex> lock(list_mutex_);
+#endif
+  free_.push_back(tif);
+}
+
+//: Growable in-memory file used to compress a tile without writing it out
+struct tif_memory_file
+{
+  tif_memory_file() : pos(0) {}
+  std::vector<vxl_byte> data;
+  std::size_t pos;
+};
+
+static tsize_t vil_tiff_memory_readproc(thandle_t h, tdata_t buf, tsize_t n)
+{
+  tif_memory_file* m = (tif_memory_file*)h;
+  std::size_t k = m->pos < m->data.size() ? m->data.size() - m->pos : 0;
+  if (k > std::size_t(n)) k = std::size_t(n);
+  if (k) std::memcpy(buf, &m->data[m->pos], k);
+  m->pos += k;
+  return (tsize_t)k;
+}
+
+static tsize_t vil_tiff_memory_writeproc(thandle_t h, tdata_t buf, tsize_t n)
+{
+  tif_memory_file* m = (tif_memory_file*)h;
+  if (m->pos + std::size_t(n) > m->data.size())
+    m->data.resize(m->pos + std::size_t(n));
+  if (n > 0) std::memcpy(&m->data[m->pos], buf, std::size_t(n));
+  m->pos += std::size_t(n);
+  return n;
+}
+
+static toff_t vil_tiff_memory_seekproc(thandle_t h, toff_t offset, int whence)
+{
+  tif_memory_file* m = (tif_memory_file*)h;
+  if      (whence == SEEK_SET) m->pos = std::size_t(offset);
+  else if (whence == SEEK_CUR) m->pos += std::size_t(offset);
+  else if (whence == SEEK_END) m->pos = m->data.size() + std::size_t(offset);
+  return (toff_t)m->pos;
+}
+
+static int vil_tiff_memory_closeproc(thandle_t)
+{
+  return 0;
+}
+
+static toff_t vil_tiff_memory_sizeproc(thandle_t h)
+{
+  return (toff_t)((tif_memory_file*)h)->data.size();
+}
+
+//: The tile layout and codec settings of an output TIFF.
+// They are read once, before tiles are compressed concurrently, since
+// libtiff caches tag lookups in the handle and so even TIFFGetField must
+// not be called on a handle used by other threads.
+struct vil_tiff_tile_settings
+{
+  vxl_uint_32 tw, tl;
+  vxl_uint_16 bps, spp, fmt, photo, planar, compression;
+  bool has_predictor;
+  vxl_uint_16 predictor;
+  std::vector<vxl_uint_16> extra;
+  bool has_jpeg_quality, has_jpeg_colormode, has_zip_quality;
+  int jpeg_quality, jpeg_colormode, zip_quality;
+};
+
+static void vil_tiff_get_tile_settings(TIFF* tif, vil_tiff_tile_settings& st)
+{
+  st.tw = st.tl = 0;
+  st.bps = st.spp = st.fmt = st.photo = st.planar = st.compression = st.predictor = 0;
+  st.jpeg_quality = st.jpeg_colormode = st.zip_quality = 0;
+  TIFFGetField(tif, TIFFTAG_TILEWIDTH, &st.tw);
+  TIFFGetField(tif, TIFFTAG_TILELENGTH, &st.tl);
+  TIFFGetFieldDefaulted(tif, TIFFTAG_BITSPERSAMPLE, &st.bps);
+  TIFFGetFieldDefaulted(tif, TIFFTAG_SAMPLESPERPIXEL, &st.spp);
+  TIFFGetFieldDefaulted(tif, TIFFTAG_SAMPLEFORMAT, &st.fmt);
+  TIFFGetFieldDefaulted(tif, TIFFTAG_PLANARCONFIG, &st.planar);
+  TIFFGetFieldDefaulted(tif, TIFFTAG_COMPRESSION, &st.compression);
+  TIFFGetField(tif, TIFFTAG_PHOTOMETRIC, &st.photo);
+  st.has_predictor = TIFFGetField(tif, TIFFTAG_PREDICTOR, &st.predictor) != 0;
+  vxl_uint_16 n_extra = 0, *extra = VXL_NULLPTR;
+  st.extra.clear();
+  if (TIFFGetField(tif, TIFFTAG_EXTRASAMPLES, &n_extra, &extra) && extra)
+    st.extra.assign(extra, extra + n_extra);
+  // the codec pseudo-tags only exist once the codec is selected
+  const bool jpeg = st.compression == COMPRESSION_JPEG;
+  const bool zip = st.compression == COMPRESSION_ADOBE_DEFLATE ||
+                   st.compression == COMPRESSION_DEFLATE;
+  st.has_jpeg_quality = jpeg && TIFFGetField(tif, TIFFTAG_JPEGQUALITY, &st.jpeg_quality);
+  st.has_jpeg_colormode = jpeg && TIFFGetField(tif, TIFFTAG_JPEGCOLORMODE, &st.jpeg_colormode);
+  st.has_zip_quality = zip && TIFFGetField(tif, TIFFTAG_ZIPQUALITY, &st.zip_quality);
+}
+
+//: Compress one tile with the settings \p st of the output TIFF.
+// The tile is encoded by a temporary handle on a memory file with the same
+// tile layout and codec settings, so several tiles can be compressed at
+// once.  The result can then be stored with TIFFWriteRawTile.  JPEG tiles
+// carry their own tables, so they do not depend on the JPEGTables tag.
+static bool vil_tiff_encode_tile(vil_tiff_tile_settings const& st,
+                                 vxl_byte* buf, tsize_t n,
+                                 std::vector<vxl_byte>& encoded)
+{
+  tif_memory_file m;
+#if HAS_GEOTIFF
+  TIFF* enc = XTIFFClientOpen("memory", "w", (thandle_t)&m,
+                              vil_tiff_memory_readproc, vil_tiff_memory_writeproc,
+                              vil_tiff_memory_seekproc, vil_tiff_memory_closeproc,
+                              vil_tiff_memory_sizeproc,
+                              vil_tiff_mapfileproc, vil_tiff_unmapfileproc);
+#else
+  TIFF* enc = TIFFClientOpen("memory", "w", (thandle_t)&m,
+                             vil_tiff_memory_readproc, vil_tiff_memory_writeproc,
+                             vil_tiff_memory_seekproc, vil_tiff_memory_closeproc,
+                             vil_tiff_memory_sizeproc,
+                             vil_tiff_mapfileproc, vil_tiff_unmapfileproc);
+#endif // HAS_GEOTIFF
+  if (!enc)
+    return false;
+  bool ok = TIFFSetField(enc, TIFFTAG_IMAGEWIDTH, st.tw) &&
+            TIFFSetField(enc, TIFFTAG_IMAGELENGTH, st.tl) &&
+            TIFFSetField(enc, TIFFTAG_TILEWIDTH, st.tw) &&
+            TIFFSetField(enc, TIFFTAG_TILELENGTH, st.tl) &&
+            TIFFSetField(enc, TIFFTAG_BITSPERSAMPLE, st.bps) &&
+            TIFFSetField(enc, TIFFTAG_SAMPLESPERPIXEL, st.spp) &&
+            TIFFSetField(enc, TIFFTAG_SAMPLEFORMAT, st.fmt) &&
+            TIFFSetField(enc, TIFFTAG_PHOTOMETRIC, st.photo) &&
+            TIFFSetField(enc, TIFFTAG_PLANARCONFIG, st.planar) &&
+            TIFFSetField(enc, TIFFTAG_COMPRESSION, st.compression);
+  if (ok && st.has_predictor)
+    ok = TIFFSetField(enc, TIFFTAG_PREDICTOR, st.predictor) != 0;
+  if (ok && !st.extra.empty())
+    ok = TIFFSetField(enc, TIFFTAG_EXTRASAMPLES, (vxl_uint_16)st.extra.size(),
+                      const_cast<vxl_uint_16*>(&st.extra[0])) != 0;
+  if (ok && st.compression == COMPRESSION_JPEG)
+  {
+    if (st.has_jpeg_quality)
+      TIFFSetField(enc, TIFFTAG_JPEGQUALITY, st.jpeg_quality);
+    // e.g. YCbCr tiles are converted from RGB by the codec
+    if (st.has_jpeg_colormode)
+      ok = TIFFSetField(enc, TIFFTAG_JPEGCOLORMODE, st.jpeg_colormode) != 0;
+    TIFFSetField(enc, TIFFTAG_JPEGTABLESMODE, 0);
+  }
+  if (ok && st.has_zip_quality)
+    TIFFSetField(enc, TIFFTAG_ZIPQUALITY, st.zip_quality);
+  toff_t* offsets = VXL_NULLPTR;
+  toff_t* counts = VXL_NULLPTR;
+  ok = ok && TIFFWriteEncodedTile(enc, 0, buf, n) > 0 &&
+       TIFFGetField(enc, TIFFTAG_TILEOFFSETS, &offsets) && offsets &&
+       TIFFGetField(enc, TIFFTAG_TILEBYTECOUNTS, &counts) && counts &&
+       std::size_t(offsets[0] + counts[0]) <= m.data.size();
+  if (ok)
+    encoded.assign(m.data.begin() + std::size_t(offsets[0]),
+                   m.data.begin() + std::size_t(offsets[0] + counts[0]));
+  // discard the handle without writing a directory
+  TIFFCleanup(enc);
+  return ok;
+}
+
 vil_image_resource_sptr vil_tiff_file_format::make_input_image(vil_stream* is)
 {
   if (!vil_tiff_file_format_probe(is))
@@ -211,7 +490,10 @@ vil_image_resource_sptr vil_tiff_file_format::make_input_image(vil_stream* is)
   }
   unsigned n = nimg(tss->tif);
   tif_smart_ptr tif_sptr = new tif_ref_cnt(tss->tif);
-  return new vil_tiff_image(tif_sptr, h, n);
+  vil_tiff_image* im = new vil_tiff_image(tif_sptr, h, n);
+  im->mapped_ = is->mapped_memory();
+  im->decoders_ = new vil_tiff_decoder_pool(is);
+  return im;
 }
 
 vil_pyramid_image_resource_sptr
@@ -369,7 +651,7 @@ char const* vil_tiff_file_format::tag() const
 
 vil_tiff_image::vil_tiff_image(tif_smart_ptr const& tif_sptr,
                                vil_tiff_header* th, const unsigned nimages):
-    t_(tif_sptr), h_(th), index_(0), nimages_(nimages)
+    t_(tif_sptr), h_(th), index_(0), nimages_(nimages), decoders_(VXL_NULLPTR)
 {
 }
 
@@ -421,6 +703,7 @@ vil_pixel_format vil_tiff_image::pixel_format() const
 
 vil_tiff_image::~vil_tiff_image()
 {
+  delete decoders_;
   delete h_;
 }
 
@@ -670,6 +953,58 @@ view_from_buffer(vil_pixel_format& fmt, vil_memory_chunk_sptr const& buf,
   return view;
 }
 
+vil_image_view_base_sptr
+vil_tiff_image::get_view(unsigned i0, unsigned n_i, unsigned j0, unsigned n_j) const
+{
+  // Uncompressed strips of whole bytes can be used in place
+  const unsigned bps = h_->bits_per_sample.val;
+  const vil_pixel_format fmt = vil_pixel_format_component_format(h_->pix_fmt);
+  if (!mapped_ || nimages_ != 1 || !h_->is_striped() ||
+      i0+n_i > ni() || j0+n_j > nj() ||
+      (h_->compression.valid && h_->compression.val != COMPRESSION_NONE) ||
+      (nplanes() > 1 && h_->planar_config.valid &&
+       h_->planar_config.val != PLANARCONFIG_CONTIG) ||
+      bps != 8*vil_pixel_format_sizeof_components(fmt) ||
+      (bps > 8 && TIFFIsByteSwapped(t_.tif())))
+    return vil_blocked_image_resource::get_view(i0, n_i, j0, n_j);
+
+  // The strips must follow one another without gaps
+  toff_t* offsets = VXL_NULLPTR;
+  if (!TIFFGetField(t_.tif(), TIFFTAG_STRIPOFFSETS, &offsets) || !offsets)
+    return vil_blocked_image_resource::get_view(i0, n_i, j0, n_j);
+  const vxl_uint_32 bpl = h_->bytes_per_line();
+  const vxl_uint_32 rows = h_->rows_per_strip.valid ? h_->rows_per_strip.val : nj();
+  const tstrip_t nstrips = TIFFNumberOfStrips(t_.tif());
+  for (tstrip_t s = 1; s < nstrips; ++s)
+    if (offsets[s] != offsets[0] + toff_t(s) * rows * bpl)
+      return vil_blocked_image_resource::get_view(i0, n_i, j0, n_j);
+
+  const unsigned np = nplanes();
+  const std::size_t sample_bytes = vil_pixel_format_sizeof_components(fmt);
+  vil_image_view_base_sptr view =
+    vil_mmap_image_view(mapped_, std::size_t(offsets[0]) + std::size_t(j0)*bpl + std::size_t(i0)*np*sample_bytes,
+                        fmt, n_i, n_j, np, np, std::ptrdiff_t(bpl/sample_bytes), 1);
+  if (view) return view;
+  return vil_blocked_image_resource::get_view(i0, n_i, j0, n_j);
+}
+
+// If there are multiple images in the file it is
+// necessary to set the TIFF directory and file header corresponding to
+// this resource according to the index
+bool vil_tiff_image::select_directory() const
+{
+  if (nimages_<=1)
+    return true;
+  if (TIFFSetDirectory(t_.tif(), index_)<=0)
+    return false;
+  vil_tiff_header* h = new vil_tiff_header(t_.tif());
+  //Cast away const
+  vil_tiff_image* ti = (vil_tiff_image*)this;
+  delete h_;
+  ti->h_=h;
+  return true;
+}
+
 // this internal block accessor is used for both tiled and
 // striped encodings
 vil_image_view_base_sptr
@@ -678,22 +1013,17 @@ vil_tiff_image::get_block( unsigned block_index_i,
 {
   // the only two possibilities
   assert(h_->is_tiled() || h_->is_striped());
-  //
-  // If there are multiple images in the file it is
-  // necessary to set the TIFF directory and file header corresponding to
-  // this resource according to the index
-  //
-  if (nimages_>1)
-  {
-    if (TIFFSetDirectory(t_.tif(), index_)<=0)
-      return VXL_NULLPTR;
-    vil_tiff_header* h = new vil_tiff_header(t_.tif());
-    //Cast away const
-    vil_tiff_image* ti = (vil_tiff_image*)this;
-    delete h_;
-    ti->h_=h;
-  }
+  if (!this->select_directory())
+    return VXL_NULLPTR;
+  return this->decode_block(t_.tif(), block_index_i, block_index_j);
+}
 
+// Only reads h_, so blocks may be decoded concurrently through
+// different handles
+vil_image_view_base_sptr
+vil_tiff_image::decode_block(TIFF* tif, unsigned block_index_i,
+                             unsigned block_index_j) const
+{
   vil_image_view_base_sptr view = VXL_NULLPTR;
 
   //allocate input memory
@@ -716,7 +1046,7 @@ vil_tiff_image::get_block( unsigned block_index_i,
 
   if (h_->is_tiled())
   {
-    if (TIFFReadEncodedTile(t_.tif(), blk_indx, data, (tsize_t) -1)<=0)
+    if (TIFFReadEncodedTile(tif, blk_indx, data, (tsize_t) -1)<=0)
     {
       delete [] data;
       return view;
@@ -732,7 +1062,7 @@ vil_tiff_image::get_block( unsigned block_index_i,
 
   if (h_->is_striped())
   {
-    if (TIFFReadEncodedStrip(t_.tif(), blk_indx, data, (tsize_t) -1)<=0)
+    if (TIFFReadEncodedStrip(tif, blk_indx, data, (tsize_t) -1)<=0)
     {
       delete [] data;
       return view;
@@ -746,9 +1076,75 @@ vil_tiff_image::get_block( unsigned block_index_i,
     return this->fill_block_from_strip(buf);
   }
 
+  delete [] data;
   return view;
 }
 
+//: Decodes a contiguous part of a list of blocks through a borrowed handle
+struct vil_tiff_block_decoder
+{
+  vil_tiff_image const* im;
+  vil_tiff_decoder_pool* pool;
+  unsigned index;
+  unsigned bi0, bj0, nbi;
+  std::vector<vil_image_view_base_sptr>* result;
+  void operator()(unsigned b, unsigned e) const
+  {
+    TIFF* tif = pool->acquire(index);
+    if (!tif)
+      return; // the caller decodes the missing blocks itself
+    for (unsigned k = b; k < e; ++k)
+      (*result)[k] = im->decode_block(tif, bi0 + k % nbi, bj0 + k / nbi);
+    pool->release(tif);
+  }
+};
+
+bool vil_tiff_image::
+get_blocks(unsigned start_block_i, unsigned end_block_i,
+           unsigned start_block_j, unsigned end_block_j,
+           std::vector< std::vector< vil_image_view_base_sptr > >& blocks) const
+{
+  if (end_block_i < start_block_i || end_block_j < start_block_j)
+    return false;
+  const unsigned nbi = end_block_i - start_block_i + 1;
+  const unsigned nbj = end_block_j - start_block_j + 1;
+  // Uncompressed blocks are limited by the reads, which are serialized anyway
+  if (!decoders_ || nbi*nbj < 2 || vil_parallel::max_threads() < 2 ||
+      vil_parallel::in_parallel_region() ||
+      !h_->compression.valid || h_->compression.val == COMPRESSION_NONE)
+    return vil_blocked_image_resource::get_blocks(start_block_i, end_block_i,
+                                                  start_block_j, end_block_j, blocks);
+  if (!this->select_directory())
+    return false;
+
+  std::vector<vil_image_view_base_sptr> decoded(nbi*nbj);
+  vil_tiff_block_decoder decoder;
+  decoder.im = this;
+  decoder.pool = decoders_;
+  decoder.index = index_;
+  decoder.bi0 = start_block_i;
+  decoder.bj0 = start_block_j;
+  decoder.nbi = nbi;
+  decoder.result = &decoded;
+  vil_parallel_for(0, nbi*nbj, decoder);
+
+  for (unsigned bi = 0; bi < nbi; ++bi)
+  {
+    std::vector< vil_image_view_base_sptr > jblocks;
+    for (unsigned bj = 0; bj < nbj; ++bj)
+    {
+      vil_image_view_base_sptr view = decoded[bj*nbi + bi];
+      if (!view)
+        view = this->decode_block(t_.tif(), start_block_i + bi, start_block_j + bj);
+      if (!view)
+        return false;
+      jblocks.push_back(view);
+    }
+    blocks.push_back(jblocks);
+  }
+  return true;
+}
+
 //decode tiles: the tile is a contiguous raster scan of potentially
 //interleaved samples. This is an easy case since the tile is a
 //contiguous raster scan.
@@ -1035,14 +1431,16 @@ void vil_tiff_image::bitpack_block(unsigned bytes_per_block,
   delete [] bl;
 }
 
-//an internal form of put_block for convenience
-//write the indicated block to file, padding with zeros if necessary
+//make the block buffer for block (bi, bj) of a view placed at (i0, j0),
+//padding with zeros if necessary.
 //image view im is an arbitrary region of image that has to be decomposed into
 //blocks. The resource is written with zeros if the input view doesn't
 //correspond to exact block boundaries.  Subsequent put_view calls could
 //fill in the missing image data.
-bool vil_tiff_image::put_block(unsigned bi, unsigned bj, unsigned i0,
-                               unsigned j0, const vil_image_view_base& im)
+vxl_byte* vil_tiff_image::block_buffer_from_view(unsigned bi, unsigned bj,
+                                                 unsigned i0, unsigned j0,
+                                                 const vil_image_view_base& im,
+                                                 unsigned& bytes_per_block)
 {
   //Get the block offset and clipping parameters
 
@@ -1053,11 +1451,11 @@ bool vil_tiff_image::put_block(unsigned bi, unsigned bj, unsigned i0,
   //column offset into block. fill [0->ioff-1]
   if (bi*sbi<i0&&(bi+1)*sbi>i0)
     if (!block_i_offset(bi, i0, ioff))
-      return false;
+      return VXL_NULLPTR;
   //row offset into block fill [0->joff-1]
   if (bj*sbj<j0&&(bj+1)*sbj>j0)
     if (!block_j_offset(bj, j0, joff))
-      return false;
+      return VXL_NULLPTR;
 
   //iclip and jclip are the start of invalid data at the right and
   //bottom of partially filled blocks
@@ -1067,7 +1465,7 @@ bool vil_tiff_image::put_block(unsigned bi, unsigned bj, unsigned i0,
   {
     iclip = (i0+im.ni())-bi*sbi;
     if (iclip > sbi)
-      return false;
+      return VXL_NULLPTR;
   }
 
   //bottom block margin to be padded [jclip -> size_block_j()-1]
@@ -1075,12 +1473,12 @@ bool vil_tiff_image::put_block(unsigned bi, unsigned bj, unsigned i0,
   {
     jclip = (j0+im.nj())-bj*sbj;
     if (jclip > sbj)
-      return false;
+      return VXL_NULLPTR;
   }
   unsigned bps = h_->bytes_per_sample();
   unsigned bytes_per_pixel = bps*nplanes();
 
-  unsigned bytes_per_block = bytes_per_pixel*sbi*sbj;
+  bytes_per_block = bytes_per_pixel*sbi*sbj;
 
 
   //the data buffer for the block
@@ -1092,12 +1490,59 @@ bool vil_tiff_image::put_block(unsigned bi, unsigned bj, unsigned i0,
 
   this->fill_block_from_view(bi, bj, i0, j0, ioff, joff, iclip, jclip,
                              im, block_buf);
+  return block_buf;
+}
+
+//an internal form of put_block for convenience
+//write the indicated block to file, padding with zeros if necessary
+bool vil_tiff_image::put_block(unsigned bi, unsigned bj, unsigned i0,
+                               unsigned j0, const vil_image_view_base& im)
+{
+  unsigned bytes_per_block = 0;
+  vxl_byte* block_buf = this->block_buffer_from_view(bi, bj, i0, j0, im,
+                                                     bytes_per_block);
+  if (!block_buf)
+    return false;
   //write the block to the tiff file
   bool good_write = write_block_to_file(bi, bj, bytes_per_block, block_buf);
   delete [] block_buf;
   return good_write;
 }
 
+bool vil_tiff_image::parallel_encoding(unsigned n_blocks) const
+{
+  // Strips are left to libtiff, since the last strip is usually short.
+  // Packed bool blocks are not supported by the encoder.
+  return n_blocks > 1 && vil_parallel::max_threads() > 1 &&
+         !vil_parallel::in_parallel_region() &&
+         h_->is_tiled() && h_->compression.valid &&
+         h_->compression.val != COMPRESSION_NONE &&
+         h_->pix_fmt != VIL_PIXEL_FORMAT_BOOL;
+}
+
+//: Compresses a contiguous part of a batch of tiles
+struct vil_tiff_block_encoder
+{
+  vil_tiff_image* im;
+  const vil_tiff_tile_settings* settings;
+  const vil_image_view_base* view;
+  unsigned i0, j0;
+  const std::vector<std::pair<unsigned, unsigned> >* tiles;
+  std::vector<std::vector<vxl_byte> >* encoded;
+  std::vector<char>* ok;
+  void operator()(unsigned b, unsigned e) const
+  {
+    for (unsigned k = b; k < e; ++k)
+    {
+      unsigned nbytes = 0;
+      vxl_byte* buf = im->block_buffer_from_view((*tiles)[k].first, (*tiles)[k].second,
+                                                 i0, j0, *view, nbytes);
+      (*ok)[k] = buf && vil_tiff_encode_tile(*settings, buf, (tsize_t)nbytes, (*encoded)[k]);
+      delete [] buf;
+    }
+  }
+};
+
 bool vil_tiff_image::put_view(const vil_image_view_base& im,
                               unsigned i0, unsigned j0)
 {
@@ -1112,10 +1557,71 @@ bool vil_tiff_image::put_view(const vil_image_view_base& im,
     return false;
   unsigned  bi_start = i0/tw, bi_end = (i0+im.ni()-1)/tw;
   unsigned  bj_start = j0/tl, bj_end = (j0+im.nj()-1)/tl;
-  for (unsigned bi = bi_start; bi<=bi_end; ++bi)
-    for (unsigned bj = bj_start; bj<=bj_end; ++bj)
-      if (!this->put_block(bi, bj, i0, j0, im))
+  if (!this->parallel_encoding((bi_end-bi_start+1)*(bj_end-bj_start+1)))
+  {
+    for (unsigned bi = bi_start; bi<=bi_end; ++bi)
+      for (unsigned bj = bj_start; bj<=bj_end; ++bj)
+        if (!this->put_block(bi, bj, i0, j0, im))
+          return false;
+    return true;
+  }
+
+  // Compress batches of tiles concurrently, then write each batch in
+  // order.  The batch size bounds the memory held by compressed tiles.
+  std::vector<std::pair<unsigned, unsigned> > tiles;
+  for (unsigned bj = bj_start; bj<=bj_end; ++bj)
+    for (unsigned bi = bi_start; bi<=bi_end; ++bi)
+      tiles.push_back(std::pair<unsigned, unsigned>(bi, bj));
+  vil_tiff_tile_settings settings;
+  vil_tiff_get_tile_settings(t_.tif(), settings);
+  const unsigned batch = 4*vil_parallel::max_threads();
+  for (unsigned start = 0; start < tiles.size(); start += batch)
+  {
+    std::vector<std::pair<unsigned, unsigned> >
+      part(tiles.begin() + start,
+           tiles.begin() + std::min<std::size_t>(start + batch, tiles.size()));
+    std::vector<std::vector<vxl_byte> > encoded(part.size());
+    std::vector<char> ok(part.size(), 0);
+    vil_tiff_block_encoder encoder;
+    encoder.im = this;
+    encoder.settings = &settings;
+    encoder.view = &im;
+    encoder.i0 = i0;
+    encoder.j0 = j0;
+    encoder.tiles = &part;
+    encoder.encoded = &encoded;
+    encoder.ok = &ok;
+    vil_parallel_for(0, (unsigned)part.size(), encoder);
+    for (unsigned k = 0; k < part.size(); ++k)
+    {
+      const unsigned bi = part[k].first, bj = part[k].second;
+      if (ok[k] && !encoded[k].empty())
+      {
+        if (TIFFWriteRawTile(t_.tif(), this->block_index(bi, bj),
+                             &encoded[k][0], (tsize_t)encoded[k].size()) <= 0)
+          return false;
+      }
+      else if (!this->put_block(bi, bj, i0, j0, im)) // let libtiff try
         return false;
+    }
+  }
+  return true;
+}
+
+bool vil_tiff_image::set_compression(unsigned short compression, int quality)
+{
+  if (!TIFFIsCODECConfigured(compression) ||
+      !TIFFSetField(t_.tif(), TIFFTAG_COMPRESSION, compression))
+    return false;
+  h_->compression.val = compression;
+  h_->compression.valid = true;
+  if (quality >= 0)
+  {
+    if (compression == COMPRESSION_JPEG)
+      TIFFSetField(t_.tif(), TIFFTAG_JPEGQUALITY, quality);
+    else if (compression == COMPRESSION_ADOBE_DEFLATE || compression == COMPRESSION_DEFLATE)
+      TIFFSetField(t_.tif(), TIFFTAG_ZIPQUALITY, quality);
+  }
   return true;
 }
 
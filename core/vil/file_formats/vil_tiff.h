@@ -21,6 +21,8 @@
 //       compression schemes. Tiff files with separate color bands are not handled
 //   24 Mar 2007 J.L. Mundy - added smart pointer on TIFF handle to support
 //       multiple resources from a single tiff file; required for pyramid
+//   Compressed blocks are decoded and encoded on several threads when
+//       many are read or written at once, see get_blocks() and put_view()
 //   KNOWN BUG - 24bit samples for both nplanes = 1 and nplanes = 3
 //   KNOWN BUG - bool pixel format write - crashes due to incorrect block size
 // \endverbatim
@@ -88,6 +90,7 @@ class vil_tiff_file_format : public vil_file_format
 };
 
 struct tif_stream_structures;
+struct vil_tiff_decoder_pool;
 class vil_tiff_header;
 //Need to create a smartpointer mechanism for the tiff
 //file in order to handle multiple images, e.g. for pyramid
@@ -150,6 +153,8 @@ struct tif_smart_ptr
 class vil_tiff_image : public vil_blocked_image_resource
 {
   friend class vil_tiff_file_format;
+  friend struct vil_tiff_block_decoder;
+  friend struct vil_tiff_block_encoder;
  public:
 
   vil_tiff_image(tif_smart_ptr const& tif,
@@ -189,10 +194,37 @@ class vil_tiff_image : public vil_blocked_image_resource
   virtual vil_image_view_base_sptr get_block( unsigned  block_index_i,
                                               unsigned  block_index_j ) const;
 
+  //: Decode a range of blocks, in parallel if they are compressed.
+  // Each thread reads through its own TIFF handle on the input stream (only
+  // the stream access itself is serialized), so decompression of
+  // independent tiles or strips proceeds concurrently.  The number of
+  // threads is set by vil_parallel::max_threads().
+  virtual bool get_blocks(unsigned start_block_i, unsigned end_block_i,
+                          unsigned start_block_j, unsigned end_block_j,
+                          std::vector< std::vector< vil_image_view_base_sptr > >& blocks) const;
+
   virtual bool put_block( unsigned  block_index_i, unsigned  block_index_j,
                           const vil_image_view_base& blk );
 
+  //: Set the compression scheme of an image opened for writing.
+  // \p compression is a libtiff COMPRESSION_* value, e.g.
+  // COMPRESSION_LZW, COMPRESSION_ADOBE_DEFLATE or COMPRESSION_JPEG.
+  // If \p quality is non-negative it sets the JPEG quality (0-100) or the
+  // deflate level (1-9).  Must be called before any block is written.
+  // Returns false if libtiff was built without the codec.
+  bool set_compression(unsigned short compression, int quality = -1);
+
+  //: Create a view of the pixels in the file, if it is memory mapped.
+  // An uncompressed, striped, single image file read through a mapped
+  // stream returns a view pointing into the mapping, provided its strips
+  // are stored contiguously and its samples need no unpacking or byte
+  // swapping.  Otherwise the blocks are decoded into a copy as usual.
+  virtual vil_image_view_base_sptr get_view(unsigned i0, unsigned n_i,
+                                            unsigned j0, unsigned n_j) const;
+
   //: Put the data in this view back into the image source.
+  // When a compressed, tiled image is written, the tiles are compressed
+  // on several threads and then written in order.
   virtual bool put_view(const vil_image_view_base& im, unsigned i0, unsigned j0);
 
   //: Return true if the property given in the first argument has been set.
@@ -232,6 +264,10 @@ class vil_tiff_image : public vil_blocked_image_resource
   unsigned int index_;
   //: number of images in the file
   unsigned int nimages_;
+  //: the whole file, if it was opened through a memory mapped stream
+  vil_memory_chunk_sptr mapped_;
+  //: extra handles on the input stream for decoding on several threads
+  vil_tiff_decoder_pool* decoders_;
 #if 0
   //to keep the tiff file open during reuse of multiple tiff resources
   //in a single file otherwise the resource destructor would close the file
@@ -270,6 +306,22 @@ class vil_tiff_image : public vil_blocked_image_resource
   bool put_block(unsigned bi, unsigned bj, unsigned i0,
                  unsigned j0, const vil_image_view_base& im);
 
+  //: make the block (bi, bj) of a view placed at (i0, j0), ready for encoding.
+  // Returns a new[] allocated buffer of bytes_per_block bytes, or null.
+  vxl_byte* block_buffer_from_view(unsigned bi, unsigned bj, unsigned i0,
+                                   unsigned j0, const vil_image_view_base& im,
+                                   unsigned& bytes_per_block);
+
+  //: reload the header if the file holds several images. Not thread safe.
+  bool select_directory() const;
+
+  //: read and decode a block through the given handle
+  vil_image_view_base_sptr decode_block(TIFF* tif, unsigned block_index_i,
+                                        unsigned block_index_j) const;
+
+  //: true if put_view should compress tiles on several threads
+  bool parallel_encoding(unsigned n_blocks) const;
+
   unsigned block_index(unsigned block_i, unsigned block_j) const;
 
   //: fill out the block with leading zeros or trailing zeros if necessary
@@ -0,0 +1,183 @@
+// This is core/vil/tests/test_block_cache.cxx
+#include <iostream>
+#include <vector>
+#include <testlib/testlib_test.h>
+#include <vcl_compiler.h>
+#include <vxl_config.h> // for vxl_byte
+#include <vil/vil_block_cache.h>
+#include <vil/vil_blocked_image_facade.h>
+#include <vil/vil_cached_image_resource.h>
+#include <vil/vil_image_view.h>
+#include <vil/vil_new.h>
+#if VXL_FULLCXX11SUPPORT
+# include <thread>
+# include <atomic>
+#endif
+
+//: A block whose first pixel records its indices
+static vil_image_view_base_sptr make_block(unsigned bi, unsigned bj, unsigned n = 16)
+{
+  vil_image_view<vxl_uint_32>* blk = new vil_image_view<vxl_uint_32>(n, n);
+  blk->fill(0);
+  (*blk)(0,0) = bi*1000 + bj;
+  return blk;
+}
+
+static bool block_is(vil_image_view_base_sptr const& blk, unsigned bi, unsigned bj)
+{
+  if (!blk) return false;
+  vil_image_view<vxl_uint_32> v(blk);
+  return v && v(0,0) == bi*1000 + bj;
+}
+
+#if VXL_FULLCXX11SUPPORT
+struct block_cache_reader
+{
+  vil_block_cache* cache;
+  unsigned seed;
+  std::atomic<unsigned>* errors;
+  void operator()() const
+  {
+    unsigned x = seed;
+    for (unsigned k = 0; k < 20000; ++k)
+    {
+      x = x*1103515245u + 12345u;
+      const unsigned bi = (x >> 8) % 20, bj = (x >> 16) % 20;
+      vil_image_view_base_sptr blk;
+      if (cache->get_block(bi, bj, blk))
+      {
+        if (!block_is(blk, bi, bj)) ++*errors;
+      }
+      else
+        cache->add_block(bi, bj, make_block(bi, bj, 4));
+    }
+  }
+};
+#endif
+
+static void test_block_cache()
+{
+  std::cout << "**************************\n"
+           << " Testing vil_block_cache\n"
+           << "**************************\n";
+
+  // Least recently used blocks are evicted first
+  vil_block_cache cache(3);
+  TEST("Small cache has one shard", cache.n_shards(), 1);
+  for (unsigned b = 0; b < 3; ++b)
+    cache.add_block(b, 0, make_block(b, 0));
+  vil_image_view_base_sptr blk;
+  TEST("get block 0", cache.get_block(0, 0, blk) && block_is(blk, 0, 0), true);
+  cache.add_block(3, 0, make_block(3, 0)); // evicts block 1
+  TEST("block 1 evicted", cache.get_block(1, 0, blk), false);
+  TEST("block 0 kept", cache.get_block(0, 0, blk), true);
+  TEST("block 3 added", cache.get_block(3, 0, blk) && block_is(blk, 3, 0), true);
+  vil_block_cache_stats st = cache.stats();
+  TEST("hits", st.hits, 3);
+  TEST("misses", st.misses, 1);
+  TEST("evictions", st.evictions, 1);
+  TEST("n_blocks", st.n_blocks, 3);
+  TEST("bytes", st.bytes, 3*16*16*sizeof(vxl_uint_32));
+  TEST("contains", cache.contains(2, 0) && !cache.contains(1, 0), true);
+  TEST("contains is not counted", cache.stats().hits == 3 && cache.stats().misses == 1, true);
+  cache.add_block(4, 0, make_block(4, 0)); // evicts block 2, which contains() did not promote
+  TEST("contains does not promote", cache.contains(2, 0), false);
+  TEST("remove block", cache.remove_block(3, 0) && !cache.get_block(3, 0, blk), true);
+  cache.add_block(0, 0, make_block(7, 7));
+  TEST("add replaces", cache.get_block(0, 0, blk) && block_is(blk, 7, 7) &&
+       cache.stats().n_blocks == 2, true);
+  cache.clear();
+  TEST("clear", cache.stats().n_blocks == 0 && cache.stats().bytes == 0, true);
+
+  // Byte budget
+  const std::size_t bytes = vil_block_cache::block_bytes(*make_block(0, 0));
+  vil_block_cache bcache(0, 5*bytes, 1);
+  for (unsigned b = 0; b < 8; ++b)
+    bcache.add_block(b, b, make_block(b, b));
+  st = bcache.stats();
+  TEST("byte budget respected", st.bytes <= 5*bytes && st.n_blocks == 5, true);
+  TEST("newest blocks kept", bcache.get_block(7, 7, blk) && !bcache.get_block(2, 2, blk), true);
+  TEST("block bigger than budget rejected", bcache.add_block(9, 9, make_block(9, 9, 64)), false);
+
+  // The byte budget is shared by the shards, so blocks bigger than an
+  // equal part of it are still cached
+  const std::size_t big_bytes = vil_block_cache::block_bytes(*make_block(0, 0, 64));
+  vil_block_cache scache(0, 3*big_bytes);
+  TEST("Byte budget cache is sharded", scache.n_shards() > 3, true);
+  bool all_added = true;
+  for (unsigned b = 0; b < 6; ++b)
+    all_added = scache.add_block(b, 0, make_block(b, 0, 64)) && all_added;
+  st = scache.stats();
+  TEST("blocks bigger than budget/shards added", all_added, true);
+  TEST("shared byte budget respected", st.bytes <= 3*big_bytes && st.n_blocks == 3, true);
+  TEST("least recently used blocks evicted across shards",
+       scache.get_block(5, 0, blk) && scache.get_block(4, 0, blk) &&
+       scache.get_block(3, 0, blk) && !scache.get_block(2, 0, blk), true);
+  scache.get_block(3, 0, blk);
+  scache.add_block(6, 0, make_block(6, 0, 64)); // evicts block 5, the least recently used
+  TEST("use order kept across shards",
+       scache.get_block(3, 0, blk) && scache.get_block(6, 0, blk) &&
+       !scache.get_block(5, 0, blk), true);
+
+  // Large caches are sharded
+  vil_block_cache big(1000);
+  TEST("Large cache is sharded", big.n_shards() > 1, true);
+  for (unsigned bj = 0; bj < 20; ++bj)
+    for (unsigned bi = 0; bi < 30; ++bi)
+      big.add_block(bi, bj, make_block(bi, bj, 2));
+  bool all_found = true;
+  for (unsigned bj = 0; bj < 20; ++bj)
+    for (unsigned bi = 0; bi < 30; ++bi)
+      all_found = all_found && big.get_block(bi, bj, blk) && block_is(blk, bi, bj);
+  TEST("All blocks found in sharded cache", all_found, true);
+
+#if VXL_FULLCXX11SUPPORT
+  // Concurrent readers and writers
+  vil_block_cache shared(150, 0, 4);
+  std::atomic<unsigned> errors(0);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < 4; ++t)
+  {
+    block_cache_reader r = { &shared, 17*t + 1, &errors };
+    threads.push_back(std::thread(r));
+  }
+  for (unsigned t = 0; t < threads.size(); ++t)
+    threads[t].join();
+  st = shared.stats();
+  TEST("Concurrent access returns the right blocks", errors.load(), 0);
+  TEST("Concurrent access counted", st.hits + st.misses, 80000);
+  TEST("Concurrent access within capacity", st.n_blocks <= 152, true);
+#endif
+
+  // Caching facade
+  vil_image_resource_sptr mem = vil_new_image_resource(100, 70, 1, VIL_PIXEL_FORMAT_BYTE);
+  vil_image_view<vxl_byte> im(100, 70);
+  im.fill(1);
+  mem->put_view(im, 0, 0);
+  vil_blocked_image_facade* facade = new vil_blocked_image_facade(mem, 32, 32, 1<<20);
+  vil_blocked_image_resource_sptr fsptr = facade;
+  vil_image_view_base_sptr b0 = facade->get_block(1, 1), b1 = facade->get_block(1, 1);
+  TEST("Facade returns cached block", b0 && b0 == b1, true);
+  TEST("Facade cache hit", facade->cache()->stats().hits, 1);
+  vil_image_view<vxl_byte> patch(4, 4);
+  patch.fill(9);
+  facade->put_view(patch, 40, 40);
+  vil_image_view<vxl_byte> b2 = facade->get_block(1, 1);
+  TEST("Facade put_view invalidates the block", b2 && b2(8,8) == 9 && b2(0,0) == 1, true);
+  // a budget of two blocks
+  vil_blocked_image_facade* small_facade = new vil_blocked_image_facade(mem, 32, 32, 2*32*32);
+  vil_blocked_image_resource_sptr sfsptr = small_facade;
+  vil_image_view_base_sptr s0 = small_facade->get_block(0, 0), s1 = small_facade->get_block(1, 0);
+  TEST("Facade with a small budget caches blocks",
+       s0 && s1 && small_facade->get_block(0, 0) == s0 && small_facade->get_block(1, 0) == s1, true);
+
+  // Cached resource
+  vil_blocked_image_resource_sptr cached = vil_new_cached_image_resource(vil_new_blocked_image_facade(mem, 32, 32), 10);
+  vil_image_view<vxl_byte> c0 = cached->get_block(0, 0);
+  patch.fill(5);
+  cached->put_view(patch, 0, 0);
+  vil_image_view<vxl_byte> c1 = cached->get_block(0, 0);
+  TEST("Cached resource put_view invalidates the block", c1(0,0) == 5, true);
+}
+
+TESTMAIN(test_block_cache);
@@ -25,10 +25,14 @@ DECLARE( test_rotate_image );
 DECLARE( test_warp );
 DECLARE( test_math_value_range );
 DECLARE( test_blocked_image_resource );
+DECLARE( test_block_cache );
+DECLARE( test_prefetching_image_resource );
 DECLARE( test_pyramid_image_resource );
 DECLARE( test_image_list );
 DECLARE( test_border );
 DECLARE( test_4_plane_tiff );
+DECLARE( test_mmap_image_resource );
+DECLARE( test_tiff_parallel );
 DECLARE( test_math_median );
 DECLARE( test_round );
 DECLARE( test_pyramid_image_view );
@@ -62,10 +66,14 @@ register_tests()
   REGISTER( test_warp );
   REGISTER( test_math_value_range );
   REGISTER( test_blocked_image_resource );
+  REGISTER( test_block_cache );
+  REGISTER( test_prefetching_image_resource );
   REGISTER( test_pyramid_image_resource );
   REGISTER( test_image_list );
   REGISTER( test_border );
   REGISTER( test_4_plane_tiff );
+  REGISTER( test_mmap_image_resource );
+  REGISTER( test_tiff_parallel );
   REGISTER( test_math_median );
   REGISTER( test_round );
   REGISTER( test_pyramid_image_view );
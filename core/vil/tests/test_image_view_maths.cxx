@@ -8,6 +8,8 @@
 #include <vil/vil_copy.h>
 #include <vil/vil_math.h>
 #include <vil/vil_print.h>
+#include <vil/vil_transpose.h>
+#include <vil/vil_parallel_for.h>
 
 template<class T>
 static void test_image_abs_diff(unsigned ni, unsigned nj, T min, T max, T tol)
@@ -388,10 +390,164 @@ static void test_image_view_maths_float()
   test_image_abs_diff<vxl_byte>(2, 3, 100.0f, 113.0f, 1e-8);
 }
 
+//: Fill with a pattern which exercises rounding and the float/byte ranges
+template<class T>
+static void fill_pattern(vil_image_view<T>& im, unsigned seed)
+{
+  for (unsigned p=0;p<im.nplanes();++p)
+    for (unsigned j=0;j<im.nj();++j)
+      for (unsigned i=0;i<im.ni();++i)
+        im(i,j,p) = T((i*7 + j*13 + p*29 + seed) % 251) + T(((i+seed)%4)*0.25);
+}
+
+//: True if a and b are identical
+template<class T>
+static bool same_image(const vil_image_view<T>& a, const vil_image_view<T>& b)
+{
+  if (a.ni()!=b.ni() || a.nj()!=b.nj() || a.nplanes()!=b.nplanes()) return false;
+  for (unsigned p=0;p<a.nplanes();++p)
+    for (unsigned j=0;j<a.nj();++j)
+      for (unsigned i=0;i<a.ni();++i)
+        if (!(a(i,j,p)==b(i,j,p))) return false;
+  return true;
+}
+
+//: Compare the (threaded, SSE) elementwise operations with simple loops
+template<class T>
+static void test_elementwise_ops(const char* type_name, unsigned ni, unsigned nj, unsigned np)
+{
+  std::cout << "Elementwise operations on " << type_name << ' ' << ni << 'x' << nj << 'x' << np << '\n';
+  vil_image_view<T> imA(ni,nj,np), imB(ni,nj,np), dest, ref(ni,nj,np);
+  fill_pattern(imA, 3);
+  fill_pattern(imB, 17);
+
+  vil_math_image_sum(imA, imB, dest);
+  for (unsigned p=0;p<np;++p) for (unsigned j=0;j<nj;++j) for (unsigned i=0;i<ni;++i)
+    ref(i,j,p) = T(imA(i,j,p)+imB(i,j,p));
+  TEST("vil_math_image_sum", same_image(dest, ref), true);
+
+  vil_math_image_difference(imA, imB, dest);
+  for (unsigned p=0;p<np;++p) for (unsigned j=0;j<nj;++j) for (unsigned i=0;i<ni;++i)
+    ref(i,j,p) = T(imA(i,j,p)-imB(i,j,p));
+  TEST("vil_math_image_difference", same_image(dest, ref), true);
+
+  vil_math_image_product(imA, imB, dest);
+  for (unsigned p=0;p<np;++p) for (unsigned j=0;j<nj;++j) for (unsigned i=0;i<ni;++i)
+    ref(i,j,p) = T(imA(i,j,p)*imB(i,j,p));
+  TEST("vil_math_image_product", same_image(dest, ref), true);
+
+  // One plane of imB applied to every plane of imA
+  vil_image_view<T> imB0 = vil_plane(imB, 0);
+  vil_math_image_product(imA, imB0, dest);
+  for (unsigned p=0;p<np;++p) for (unsigned j=0;j<nj;++j) for (unsigned i=0;i<ni;++i)
+    ref(i,j,p) = T(imA(i,j,p)*imB(i,j,0));
+  TEST("vil_math_image_product with one plane", same_image(dest, ref), true);
+
+  vil_math_image_max(imA, imB, dest);
+  for (unsigned p=0;p<np;++p) for (unsigned j=0;j<nj;++j) for (unsigned i=0;i<ni;++i)
+    ref(i,j,p) = std::max(imA(i,j,p), imB(i,j,p));
+  TEST("vil_math_image_max", same_image(dest, ref), true);
+
+  // Running mean, in place
+  vil_image_view<T> run;
+  run.deep_copy(imA);
+  vil_math_add_image_fraction(run, 0.75f, imB, 0.25f);
+  for (unsigned p=0;p<np;++p) for (unsigned j=0;j<nj;++j) for (unsigned i=0;i<ni;++i)
+    ref(i,j,p) = T(0.75f*imA(i,j,p)+0.25f*imB(i,j,p));
+  TEST("vil_math_add_image_fraction", same_image(run, ref), true);
+
+  run.deep_copy(imA);
+  vil_math_scale_and_offset_values(run, 0.3, 7.0);
+  for (unsigned p=0;p<np;++p) for (unsigned j=0;j<nj;++j) for (unsigned i=0;i<ni;++i)
+    ref(i,j,p) = T(0.3*imA(i,j,p)+7.0);
+  TEST("vil_math_scale_and_offset_values", same_image(run, ref), true);
+
+  run.deep_copy(imA);
+  vil_math_truncate_range(run, T(20), T(200));
+  for (unsigned p=0;p<np;++p) for (unsigned j=0;j<nj;++j) for (unsigned i=0;i<ni;++i)
+    ref(i,j,p) = imA(i,j,p)<T(20) ? T(20) : (imA(i,j,p)>T(200) ? T(200) : imA(i,j,p));
+  TEST("vil_math_truncate_range", same_image(run, ref), true);
+
+  // Non-unit istep, through a transposed view
+  vil_image_view<T> tA = vil_transpose(imA), tB = vil_transpose(imB), tdest;
+  vil_math_image_sum(tA, tB, tdest);
+  vil_math_image_sum(imA, imB, dest);
+  TEST("vil_math_image_sum on transposed views", same_image(vil_transpose(tdest), dest), true);
+}
+
+//: Byte results of vil_math_add_image_fraction outside [0,255] saturate on every path
+static void test_add_image_fraction_saturation(unsigned ni, float fa, float fb)
+{
+  vil_image_view<vxl_byte> imA(ni,3,2), imB(ni,3,2), ref(ni,3,2);
+  fill_pattern(imA, 3);
+  fill_pattern(imB, 17);
+  for (unsigned p=0;p<2;++p) for (unsigned j=0;j<3;++j) for (unsigned i=0;i<ni;++i)
+  {
+    const float x = fa*imA(i,j,p)+fb*imB(i,j,p);
+    ref(i,j,p) = x > 255.0f ? vxl_byte(255) : x > 0.0f ? vxl_byte(x) : vxl_byte(0);
+  }
+  vil_image_view<vxl_byte> run;
+  run.deep_copy(imA);
+  vil_math_add_image_fraction(run, fa, imB, fb);
+  std::cout << "fa=" << fa << " fb=" << fb << " width " << ni << '\n';
+  TEST("vil_math_add_image_fraction saturates", same_image(run, ref), true);
+
+  // Non-unit istep, which does not use the row functions
+  vil_image_view<vxl_byte> tA;
+  tA.deep_copy(vil_transpose(imA));
+  vil_image_view<vxl_byte> t = vil_transpose(tA);
+  vil_math_add_image_fraction(t, fa, imB, fb);
+  TEST("vil_math_add_image_fraction saturates on strided views", same_image(t, ref), true);
+}
+
+static void test_image_view_maths_parallel()
+{
+  const unsigned old_threads = vil_parallel::max_threads();
+  for (unsigned threads = 1; threads <= 4; threads += 3)
+  {
+    vil_parallel::set_max_threads(threads);
+    std::cout << "Using up to " << threads << " threads\n";
+    test_elementwise_ops<vxl_byte>("vxl_byte", 301, 257, 2);
+    test_elementwise_ops<float>("float", 301, 257, 2);
+    test_elementwise_ops<float>("float", 3, 5, 1);
+    test_elementwise_ops<int>("int", 67, 45, 3);
+  }
+  // widths leaving a tail after the 16 pixel blocks
+  test_add_image_fraction_saturation(37, 0.9f, 0.6f);
+  test_add_image_fraction_saturation(37, 1.4f, -0.5f);
+  test_add_image_fraction_saturation(5, 0.9f, 0.6f);
+  test_add_image_fraction_saturation(5, 1.4f, -0.5f);
+
+  // Two operations fused into one pass
+  vil_image_view<float> im(123, 77, 2), fused, ref;
+  fill_pattern(im, 5);
+  fused.deep_copy(im);
+  vil_transform_parallel(fused, vil_transform_compose(vil_math_scale_functor(0.5),
+                                                      vil_math_sqrt_functor()));
+  ref.deep_copy(im);
+  vil_math_scale_values(ref, 0.5);
+  vil_math_sqrt(ref);
+  TEST("vil_transform_compose", same_image(fused, ref), true);
+
+  vil_image_view<vxl_byte> bytes;
+  vil_transform_parallel(im, bytes, vil_transform_compose(vil_math_truncate_range_functor<float>(10.f, 100.f),
+                                                          vil_math_scale_functor(2.0)));
+  bool ok = true;
+  for (unsigned p=0;p<im.nplanes();++p) for (unsigned j=0;j<im.nj();++j) for (unsigned i=0;i<im.ni();++i)
+  {
+    const float t = im(i,j,p)<10.f ? 10.f : (im(i,j,p)>100.f ? 100.f : im(i,j,p));
+    ok = ok && bytes(i,j,p) == vxl_byte(float(2.0*t));
+  }
+  TEST("vil_transform_compose to another pixel type", ok, true);
+
+  vil_parallel::set_max_threads(old_threads);
+}
+
 static void test_image_view_maths()
 {
   test_image_view_maths_byte();
   test_image_view_maths_float();
+  test_image_view_maths_parallel();
 }
 
 TESTMAIN(test_image_view_maths);
@@ -22,6 +22,7 @@
 #include <vil/vil_blocked_image_resource.h>
 #include <vil/vil_blocked_image_facade.h>
 #include <vil/vil_cached_image_resource.h>
+#include <vil/vil_prefetching_image_resource.h>
 #include <vil/vil_pyramid_image_resource_sptr.h>
 #include <vil/vil_pyramid_image_resource.h>
 #include <vil/vil_pyramid_image_view.h>
@@ -30,12 +31,15 @@
 #include <vil/vil_image_view_base.h>
 #include <vil/vil_load.h>
 #include <vil/vil_math.h>
+#include <vil/vil_memory_allocator.h>
 #include <vil/vil_memory_chunk.h>
+#include <vil/vil_mmap_memory_chunk.h>
 #include <vil/vil_memory_image.h>
 #include <vil/vil_nearest_interp.h>
 #include <vil/vil_new.h>
 #include <vil/vil_na.h>
 #include <vil/vil_open.h>
+#include <vil/vil_parallel_for.h>
 #include <vil/vil_pixel_format.h>
 #include <vil/vil_plane.h>
 #include <vil/vil_print.h>
@@ -60,6 +64,7 @@
 #include <vil/vil_stream_fstream.h>
 #include <vil/vil_stream_fstream64.h>
 #include <vil/vil_stream_section.h>
+#include <vil/vil_stream_mmap.h>
 #include <vil/vil_stream_url.h>
 #include <vil/vil_transform.h>
 #include <vil/vil_transpose.h>
@@ -79,6 +84,7 @@
 #include <vil/file_formats/vil_jpeg_source_mgr.h>
 #include <vil/file_formats/vil_jpeglib.h>
 #include <vil/file_formats/vil_mit.h>
+#include <vil/file_formats/vil_raw.h>
 #include <vil/file_formats/vil_nitf2.h>
 #include <vil/file_formats/vil_nitf2_array_field.h>
 #include <vil/file_formats/vil_nitf2_classification.h>
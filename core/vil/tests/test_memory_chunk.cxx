@@ -3,8 +3,10 @@
 #include <testlib/testlib_test.h>
 #include <vcl_compiler.h>
 #include <vil/vil_memory_chunk.h>
+#include <vil/vil_memory_allocator.h>
+#include <vil/vil_image_view.h>
 
-static void test_memory_chunk()
+static void test_chunk()
 {
   std::cout << "**************************\n"
            << " Testing vil_memory_chunk\n"
@@ -26,6 +28,84 @@ static void test_memory_chunk()
   TEST("format",chunk2.pixel_format(),VIL_PIXEL_FORMAT_DOUBLE);
   double* data2 = reinterpret_cast<double*>(chunk2.data());
   TEST_NEAR("Deep Copy",data1[3],data2[3],1e-8);
+
+  TEST("Data aligned", reinterpret_cast<std::size_t>(chunk1.data()) % VIL_MEMORY_ALIGNMENT, 0);
+  TEST("Copy aligned", reinterpret_cast<std::size_t>(chunk2.data()) % VIL_MEMORY_ALIGNMENT, 0);
+  vil_image_view<float> im(17,3,2);
+  TEST("Image view aligned", reinterpret_cast<std::size_t>(im.top_left_ptr()) % VIL_MEMORY_ALIGNMENT, 0);
+}
+
+static void test_memory_allocator()
+{
+  std::cout << "******************************\n"
+           << " Testing vil_memory_allocator\n"
+           << "******************************\n";
+
+  TEST("size_class(1)", vil_pooled_memory_allocator::size_class(1), 64);
+  TEST("size_class(65)", vil_pooled_memory_allocator::size_class(65), 80);
+  TEST("size_class(128)", vil_pooled_memory_allocator::size_class(128), 128);
+  TEST("size_class(1000)", vil_pooled_memory_allocator::size_class(1000), 1024);
+  TEST("size_class(1025)", vil_pooled_memory_allocator::size_class(1025), 1280);
+
+  vil_aligned_memory_allocator heap;
+  vil_pooled_memory_allocator pool(1<<20, &heap);
+
+  void* p1 = pool.allocate(1000);
+  TEST("Aligned", reinterpret_cast<std::size_t>(p1) % VIL_MEMORY_ALIGNMENT, 0);
+  TEST("Live bytes", pool.stats().live_bytes, 1000);
+  pool.deallocate(p1, 1000);
+  TEST("Released block cached", pool.stats().cached_bytes, 1024);
+  TEST("Nothing live", pool.stats().live_bytes, 0);
+
+  // A request in the same size class gets the same block back
+  void* p2 = pool.allocate(900);
+  TEST("Block reused", p2, p1);
+  TEST("Reuse counted", pool.stats().n_reused, 1);
+  TEST("Cache emptied", pool.stats().cached_bytes, 0);
+  void* p3 = pool.allocate(5000);
+  TEST("Peak bytes", pool.stats().peak_bytes, 5900);
+  TEST("Allocations", pool.stats().n_allocations, 3);
+  pool.deallocate(p2, 900);
+  pool.deallocate(p3, 5000);
+
+  // Blocks too big for the cache go straight back upstream
+  void* p4 = pool.allocate(600000);
+  pool.deallocate(p4, 600000);
+  TEST("Large block not cached", pool.stats().cached_bytes, 1024+5120);
+  pool.set_max_cached_bytes(2000);
+  TEST("Cache trimmed", pool.stats().cached_bytes <= 2000, true);
+  pool.release_cached();
+  TEST("Cache released", pool.stats().cached_bytes, 0);
+  TEST("Upstream holds nothing", heap.stats().live_bytes, 0);
+
+  pool.reset_stats();
+  TEST("Reset counters", pool.stats().n_allocations, 0);
+
+  // Huge pages
+  vil_aligned_memory_allocator huge(true);
+  const std::size_t big = 5<<20;
+  char* p5 = static_cast<char*>(huge.allocate(big));
+  p5[0] = 1; p5[big-1] = 2;
+  TEST("Huge page block aligned", reinterpret_cast<std::size_t>(p5) % VIL_MEMORY_ALIGNMENT, 0);
+  huge.deallocate(p5, big);
+
+  // Images use the default allocator
+  vil_memory_allocator::set_default_allocator(&pool);
+  {
+    vil_image_view<double> im(10,10);
+    TEST("Image allocated from pool", pool.stats().live_bytes, 800);
+    vil_memory_allocator::set_default_allocator(VXL_NULLPTR);
+    im.set_size(20,20);
+    TEST("Resized image released to pool", pool.stats().live_bytes, 0);
+  }
+  TEST("Default restored", vil_memory_allocator::default_allocator(), vil_memory_allocator::pool());
+  pool.release_cached();
+}
+
+static void test_memory_chunk()
+{
+  test_chunk();
+  test_memory_allocator();
 }
 
 TESTMAIN(test_memory_chunk);
@@ -0,0 +1,174 @@
+// This is core/vil/tests/test_mmap_image_resource.cxx
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <testlib/testlib_test.h>
+#include <vcl_compiler.h>
+#include <vxl_config.h> // for vxl_byte
+#include <vil/vil_config.h> // for HAS_TIFF
+#include <vul/vul_temp_filename.h>
+#include <vpl/vpl.h> // vpl_unlink()
+#include <vil/vil_image_view.h>
+#include <vil/vil_image_resource.h>
+#include <vil/vil_save.h>
+#include <vil/vil_load.h>
+#include <vil/vil_crop.h>
+#include <vil/vil_mmap_memory_chunk.h>
+#include <vil/vil_stream_mmap.h>
+#include <vil/file_formats/vil_raw.h>
+
+template <class T>
+static bool identical(const vil_image_view<T>& a, const vil_image_view<T>& b)
+{
+  if (a.ni()!=b.ni() || a.nj()!=b.nj() || a.nplanes()!=b.nplanes()) return false;
+  for (unsigned p=0;p<a.nplanes();++p)
+    for (unsigned j=0;j<a.nj();++j)
+      for (unsigned i=0;i<a.ni();++i)
+        if (!(a(i,j,p)==b(i,j,p))) return false;
+  return true;
+}
+
+template <class T>
+static bool is_mapped(const vil_image_view<T>& v)
+{
+  return dynamic_cast<vil_mmap_memory_chunk*>(v.memory_chunk().as_pointer()) != VXL_NULLPTR;
+}
+
+template <class T>
+static vil_image_view<T> make_image(unsigned ni, unsigned nj, unsigned np, T)
+{
+  vil_image_view<T> im(ni, nj, np);
+  for (unsigned p=0;p<np;++p)
+    for (unsigned j=0;j<nj;++j)
+      for (unsigned i=0;i<ni;++i)
+        im(i,j,p) = T((i*7 + j*13 + p*29) % 251);
+  return im;
+}
+
+//: Load a saved image through a mapped stream and check its views.
+template <class T>
+static void test_mapped(const vil_image_view<T>& im, std::string const& filename,
+                        char const* type, bool expect_mapped)
+{
+  std::cout << "Mapped " << type << " image, "
+            << vil_pixel_format_of(T()) << " x " << im.nplanes() << '\n';
+  vil_image_resource_sptr res = vil_load_image_resource_mapped(filename.c_str());
+  TEST("Loaded", !res, false);
+  if (!res) return;
+
+  vil_image_view<T> whole = res->get_view();
+  vil_image_view<T> copy = res->get_copy_view();
+  TEST("get_view() matches the original", identical(whole, im), true);
+  TEST("get_copy_view() matches the original", identical(copy, im), true);
+  TEST("get_view() points into the file", is_mapped(whole), expect_mapped);
+  TEST("get_copy_view() does not", is_mapped(copy), false);
+
+  vil_image_view<T> part = res->get_view(3, 10, 2, 7);
+  TEST("Cropped view", identical(part, vil_crop(im, 3, 10, 2, 7)), true);
+  TEST("Cropped view points into the file", is_mapped(part), expect_mapped);
+  TEST("Out of range view fails", !res->get_view(3, im.ni(), 0, 1), true);
+
+  // Writing to a mapped view must not change the file
+  if (whole) whole.fill(T(3));
+  vil_image_resource_sptr res2 = vil_load_image_resource(filename.c_str());
+  vil_image_view<T> reloaded = res2->get_view();
+  TEST("File unchanged after writing to a view", identical(reloaded, im), true);
+}
+
+static void test_mmap_image_resource()
+{
+  std::string fname = vul_temp_filename();
+
+  // vil_mmap_memory_chunk and vil_stream_mmap
+  {
+    std::ofstream f(fname.c_str(), std::ios::binary);
+    for (int i=0; i<10000; ++i) f.put(char(i%101));
+  }
+  vil_mmap_memory_chunk* c = new vil_mmap_memory_chunk(fname.c_str(), 5000, 100);
+  vil_memory_chunk_sptr chunk = c;
+  TEST("Map part of a file", c->is_mapped(), true);
+  TEST("Size", chunk->size(), 100);
+  TEST("Contents", static_cast<char*>(chunk->data())[7], char(5007%101));
+  TEST("Mapping beyond the end fails",
+       vil_mmap_memory_chunk(fname.c_str(), 9990, 100).is_mapped(), false);
+  TEST("Mapping a missing file fails",
+       vil_mmap_memory_chunk((fname+"_no_such_file").c_str()).is_mapped(), false);
+  vil_image_view_base_sptr v = vil_mmap_image_view(chunk, 10, VIL_PIXEL_FORMAT_BYTE, 9, 10, 1, 1, 9, 1);
+  TEST("View of the chunk", v && vil_image_view<vxl_byte>(v)(2,3) == vxl_byte(5039%101), true);
+  TEST("View beyond the chunk fails",
+       !vil_mmap_image_view(chunk, 10, VIL_PIXEL_FORMAT_BYTE, 9, 11, 1, 1, 9, 1), true);
+  chunk->set_size(20, VIL_PIXEL_FORMAT_BYTE);
+  TEST("set_size() releases the mapping", c->is_mapped() || chunk->size() != 20, false);
+  chunk = VXL_NULLPTR;
+
+  vil_stream* s = new vil_stream_mmap(fname.c_str());
+  s->ref();
+  TEST("vil_stream_mmap ok", s->ok(), true);
+  TEST("vil_stream_mmap file_size", s->file_size(), 10000);
+  TEST("vil_stream_mmap mapped_memory", s->mapped_memory() != VXL_NULLPTR, true);
+  char buf[4];
+  s->seek(9998);
+  TEST("vil_stream_mmap read at end", s->read(buf, 4), 2);
+  TEST("vil_stream_mmap contents", buf[1], char(9999%101));
+  TEST("vil_stream_mmap tell", s->tell(), 10000);
+  TEST("vil_stream_mmap is read-only", s->write(buf, 1), 0);
+  s->unref();
+  vpl_unlink(fname.c_str());
+
+  // PNM
+  vil_image_view<vxl_byte> rgb = make_image(37, 23, 3, vxl_byte());
+  vil_save(rgb, (fname+".ppm").c_str(), "pnm");
+  test_mapped(rgb, fname+".ppm", "pnm", true);
+  vpl_unlink((fname+".ppm").c_str());
+
+  vil_image_view<vxl_uint_16> grey16 = make_image(37, 23, 1, vxl_uint_16());
+  vil_save(grey16, (fname+".pgm").c_str(), "pnm");
+  test_mapped(grey16, fname+".pgm", "pnm", VXL_BIG_ENDIAN != 0); // most significant byte first
+  vpl_unlink((fname+".pgm").c_str());
+
+#if HAS_TIFF
+  vil_save(rgb, (fname+".tif").c_str(), "tiff");
+  test_mapped(rgb, fname+".tif", "tiff", true);
+  vpl_unlink((fname+".tif").c_str());
+
+  vil_image_view<float> grey_f = make_image(37, 23, 1, float());
+  vil_save(grey_f, (fname+".tif").c_str(), "tiff");
+  test_mapped(grey_f, fname+".tif", "tiff", true);
+  vpl_unlink((fname+".tif").c_str());
+#endif
+
+  // Raw files, with and without a header
+  vil_image_view<vxl_int_16> raw = make_image(37, 23, 2, vxl_int_16());
+  TEST("Save raw", vil_save(raw, (fname+".raw").c_str(), "raw"), true);
+  vil_image_resource_sptr r =
+    vil_raw_load_image_resource((fname+".raw").c_str(), 37, 23, 2, VIL_PIXEL_FORMAT_INT_16);
+  TEST("Load raw", !r, false);
+  vil_image_view<vxl_int_16> rv = r->get_view();
+  TEST("Raw get_view()", identical(rv, raw), true);
+  TEST("Raw get_view() points into the file", is_mapped(rv), true);
+  TEST("Raw get_copy_view()", identical(vil_image_view<vxl_int_16>(r->get_copy_view(5, 20, 1, 20)),
+                                       vil_crop(raw, 5, 20, 1, 20)), true);
+  TEST("Raw file too short",
+       !vil_raw_load_image_resource((fname+".raw").c_str(), 37, 24, 2, VIL_PIXEL_FORMAT_INT_16), true);
+  r = VXL_NULLPTR;
+  vpl_unlink((fname+".raw").c_str());
+
+  {
+    std::ofstream f((fname+".raw").c_str(), std::ios::binary);
+    f.write("header", 6);
+    for (unsigned j=0;j<rgb.nj();++j)
+      for (unsigned i=0;i<rgb.ni();++i)
+        for (unsigned p=0;p<3;++p)
+          f.put(char(rgb(i,j,p)));
+  }
+  r = vil_raw_load_image_resource((fname+".raw").c_str(), 37, 23, 3, VIL_PIXEL_FORMAT_BYTE, 6);
+  TEST("Load raw with header", !r, false);
+  vil_image_view<vxl_byte> rh = r->get_view();
+  TEST("Raw with header get_view()", identical(rh, rgb), true);
+  TEST("Raw with header points into the file", is_mapped(rh), true);
+  r = VXL_NULLPTR;
+  rh = vil_image_view<vxl_byte>();
+  vpl_unlink((fname+".raw").c_str());
+}
+
+TESTMAIN(test_mmap_image_resource);
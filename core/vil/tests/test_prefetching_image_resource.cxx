@@ -0,0 +1,150 @@
+// This is core/vil/tests/test_prefetching_image_resource.cxx
+#include <iostream>
+#include <vector>
+#include <utility>
+#include <testlib/testlib_test.h>
+#include <vcl_compiler.h>
+#include <vxl_config.h> // for vxl_uint_16
+#include <vil/vil_prefetching_image_resource.h>
+#include <vil/vil_blocked_image_facade.h>
+#include <vil/vil_image_view.h>
+#include <vil/vil_memory_image.h>
+#include <vil/vil_new.h>
+#if VXL_FULLCXX11SUPPORT
+# include <chrono>
+# include <thread>
+#endif
+
+//: A blocked resource which is slow to decode its blocks
+class slow_blocked_resource : public vil_blocked_image_facade
+{
+ public:
+  slow_blocked_resource(vil_image_resource_sptr const& src, unsigned sbi, unsigned sbj)
+  : vil_blocked_image_facade(src, sbi, sbj), n_reads(0) {}
+  virtual vil_image_view_base_sptr get_block(unsigned bi, unsigned bj) const
+  {
+    ++n_reads;
+#if VXL_FULLCXX11SUPPORT
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+#endif
+    return vil_blocked_image_facade::get_block(bi, bj);
+  }
+  mutable unsigned n_reads;
+};
+
+static bool block_ok(vil_image_view_base_sptr const& blk, unsigned bi, unsigned bj,
+                     unsigned sb, unsigned offset = 0)
+{
+  if (!blk) return false;
+  vil_image_view<vxl_uint_16> v(blk);
+  for (unsigned j = 0; j < v.nj(); ++j)
+    for (unsigned i = 0; i < v.ni(); ++i)
+      if (v(i,j) != (bi*sb+i) + 1000*(bj*sb+j) + offset)
+        return false;
+  return true;
+}
+
+static void test_prefetching_image_resource()
+{
+  std::cout << "*****************************************\n"
+           << " Testing vil_prefetching_image_resource\n"
+           << "*****************************************\n";
+
+  const unsigned sb = 8, ni = 64, nj = 48;
+  vil_image_view<vxl_uint_16> image(ni, nj);
+  for (unsigned j = 0; j < nj; ++j)
+    for (unsigned i = 0; i < ni; ++i)
+      image(i,j) = vxl_uint_16(i + 1000*j);
+  vil_image_resource_sptr mem = vil_new_image_resource_of_view(image);
+  slow_blocked_resource* slow = new slow_blocked_resource(mem, sb, sb);
+  vil_blocked_image_resource_sptr src = slow;
+
+  {
+    vil_prefetching_image_resource pf(src, 4, 1);
+    TEST("n_block_i", pf.n_block_i(), ni/sb);
+    TEST("n_block_j", pf.n_block_j(), nj/sb);
+
+    // Raster traversal, doing some work on each block
+    bool good = true;
+    for (unsigned bj = 0; bj < pf.n_block_j(); ++bj)
+      for (unsigned bi = 0; bi < pf.n_block_i(); ++bi)
+      {
+        vil_image_view_base_sptr blk = pf.get_block(bi, bj);
+        good = good && block_ok(blk, bi, bj, sb);
+#if VXL_FULLCXX11SUPPORT
+        std::this_thread::sleep_for(std::chrono::milliseconds(3));
+#endif
+      }
+    TEST("Raster traversal gives correct blocks", good, true);
+    TEST("Raster pattern detected", pf.get_access_pattern(),
+         vil_prefetching_image_resource::RASTER);
+    vil_block_cache_stats st = pf.cache_stats();
+    TEST("Only get_block calls are counted by the cache",
+         st.hits + st.misses, pf.n_block_i()*pf.n_block_j());
+#if VXL_FULLCXX11SUPPORT
+    std::cout << "prefetched " << pf.n_prefetched() << " of "
+              << pf.n_block_i()*pf.n_block_j() << " blocks\n";
+    TEST("Blocks were prefetched", pf.n_prefetched() > 0, true);
+    TEST("Each block decoded once", slow->n_reads, pf.n_block_i()*pf.n_block_j());
+#endif
+    TEST("Out of range block", !pf.get_block(pf.n_block_i(), 0), true);
+  }
+
+  {
+    // Column traversal
+    vil_prefetching_image_resource pf(src, 4, 2);
+    bool good = true;
+    for (unsigned bi = 0; bi < pf.n_block_i(); ++bi)
+      for (unsigned bj = 0; bj < pf.n_block_j(); ++bj)
+        good = good && block_ok(pf.get_block(bi, bj), bi, bj, sb);
+    TEST("Column traversal gives correct blocks", good, true);
+    TEST("Column pattern detected", pf.get_access_pattern(),
+         vil_prefetching_image_resource::COLUMN);
+  }
+
+  {
+    // An explicit list of blocks
+    vil_prefetching_image_resource pf(src, 3, 1);
+    std::vector<std::pair<unsigned, unsigned> > roi;
+    roi.push_back(std::make_pair(5u, 1u));
+    roi.push_back(std::make_pair(2u, 4u));
+    roi.push_back(std::make_pair(7u, 0u));
+    roi.push_back(std::make_pair(0u, 5u));
+    pf.set_prefetch_list(roi);
+    TEST("List pattern", pf.get_access_pattern(), vil_prefetching_image_resource::LIST);
+    bool good = true;
+    for (unsigned k = 0; k < roi.size(); ++k)
+      good = good && block_ok(pf.get_block(roi[k].first, roi[k].second),
+                              roi[k].first, roi[k].second, sb);
+    TEST("List traversal gives correct blocks", good, true);
+
+    // get_blocks and get_view through the blocks
+    std::vector< std::vector< vil_image_view_base_sptr > > blocks;
+    TEST("get_blocks", pf.get_blocks(1, 3, 2, 4, blocks), true);
+    good = blocks.size() == 3 && blocks[0].size() == 3;
+    for (unsigned i = 0; good && i < 3; ++i)
+      for (unsigned j = 0; j < 3; ++j)
+        good = good && block_ok(blocks[i][j], 1+i, 2+j, sb);
+    TEST("get_blocks gives correct blocks", good, true);
+    vil_image_view<vxl_uint_16> v = pf.get_view(3, 20, 5, 30);
+    TEST("get_view", v && v(0,0) == 3 + 1000*5 && v(19,29) == 22 + 1000*34, true);
+
+    // Writing discards prefetched blocks
+    vil_image_view<vxl_uint_16> patch(sb, sb);
+    for (unsigned j = 0; j < sb; ++j)
+      for (unsigned i = 0; i < sb; ++i)
+        patch(i,j) = vxl_uint_16((2*sb+i) + 1000*(4*sb+j) + 7);
+    pf.get_block(2, 4);
+    TEST("put_view", pf.put_view(patch, 2*sb, 4*sb), true);
+    TEST("Block updated after put_view", block_ok(pf.get_block(2, 4), 2, 4, sb, 7), true);
+    TEST("Neighbour unchanged", block_ok(pf.get_block(3, 4), 3, 4, sb), true);
+    vil_block_cache_stats st = pf.cache_stats();
+    TEST("Cache was used", st.hits + st.misses > 0, true);
+  }
+
+  // The factory function
+  vil_blocked_image_resource_sptr pf = vil_new_prefetching_image_resource(src, 2, 1);
+  TEST("vil_new_prefetching_image_resource", pf && block_ok(pf->get_block(1, 1), 1, 1, sb), true);
+}
+
+TESTMAIN(test_prefetching_image_resource);
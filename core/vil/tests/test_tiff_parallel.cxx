@@ -0,0 +1,107 @@
+// This is core/vil/tests/test_tiff_parallel.cxx
+#include <string>
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#include <testlib/testlib_test.h>
+#include <vcl_compiler.h>
+#include <vxl_config.h> // for vxl_byte
+#include <vil/vil_config.h> // for HAS_TIFF
+#include <vul/vul_file.h>
+#include <vul/vul_temp_filename.h>
+#include <vpl/vpl.h> // vpl_unlink()
+#include <vil/vil_image_view.h>
+#include <vil/vil_image_resource.h>
+#include <vil/vil_blocked_image_resource.h>
+#include <vil/vil_load.h>
+#include <vil/vil_new.h>
+#include <vil/vil_parallel_for.h>
+#if HAS_TIFF
+#include <vil/file_formats/vil_tiff.h>
+
+//: Largest absolute difference between two images
+static int max_difference(const vil_image_view<vxl_byte>& a, const vil_image_view<vxl_byte>& b)
+{
+  if (a.ni()!=b.ni() || a.nj()!=b.nj() || a.nplanes()!=b.nplanes()) return 256;
+  int d = 0;
+  for (unsigned p=0;p<a.nplanes();++p)
+    for (unsigned j=0;j<a.nj();++j)
+      for (unsigned i=0;i<a.ni();++i)
+        d = std::max(d, std::abs(int(a(i,j,p)) - int(b(i,j,p))));
+  return d;
+}
+
+//: Write image as tiled tiff with the given compression using n_threads
+static bool write_compressed(const std::string& path, const vil_image_view<vxl_byte>& image,
+                             unsigned short compression, int quality, unsigned n_threads)
+{
+  vil_parallel::set_max_threads(n_threads);
+  vil_blocked_image_resource_sptr bir =
+    vil_new_blocked_image_resource(path.c_str(), image.ni(), image.nj(), image.nplanes(),
+                                   VIL_PIXEL_FORMAT_BYTE, 64, 32, "tiff");
+  vil_tiff_image* tiff = dynamic_cast<vil_tiff_image*>(bir.ptr());
+  return tiff && tiff->set_compression(compression, quality) && bir->put_view(image, 0, 0);
+}
+
+//: Read the whole image back using n_threads
+static vil_image_view<vxl_byte> read_back(const std::string& path, unsigned n_threads)
+{
+  vil_parallel::set_max_threads(n_threads);
+  vil_image_resource_sptr ir = vil_load_image_resource(path.c_str());
+  if (!ir) return vil_image_view<vxl_byte>();
+  return ir->get_view();
+}
+
+static void test_codec(const vil_image_view<vxl_byte>& image, unsigned short compression,
+                       int quality, const char* name, int tolerance)
+{
+  std::string serial = vul_temp_filename() + ".tif";
+  std::string parallel = vul_temp_filename() + ".tif";
+  TEST((std::string("Write ") + name + " serially").c_str(),
+       write_compressed(serial, image, compression, quality, 1), true);
+  TEST((std::string("Write ") + name + " in parallel").c_str(),
+       write_compressed(parallel, image, compression, quality, 4), true);
+  std::cout << name << ": " << vul_file::size(serial) << " bytes serial, "
+            << vul_file::size(parallel) << " bytes parallel, "
+            << image.size() << " uncompressed\n";
+  TEST("Compressed", vul_file::size(parallel) < (unsigned long)image.size(), true);
+
+  vil_image_view<vxl_byte> s1 = read_back(serial, 1);
+  vil_image_view<vxl_byte> s4 = read_back(serial, 4);
+  vil_image_view<vxl_byte> p1 = read_back(parallel, 1);
+  vil_image_view<vxl_byte> p4 = read_back(parallel, 4);
+  TEST("Serial write close to original", max_difference(s1, image) <= tolerance, true);
+  TEST("Parallel decode matches serial decode", max_difference(s4, s1), 0);
+  TEST("Parallel write decodes serially", max_difference(p1, image) <= tolerance, true);
+  TEST("Parallel write decodes in parallel", max_difference(p4, p1), 0);
+
+  // A partial view spanning several tiles
+  vil_parallel::set_max_threads(4);
+  vil_image_resource_sptr ir = vil_load_image_resource(parallel.c_str());
+  vil_image_view<vxl_byte> part = ir ? ir->get_view(50, 100, 20, 70) : vil_image_view<vxl_byte>();
+  TEST("Partial view", part && part(0,0,1) == p1(50,20,1) && part(99,69,2) == p1(149,89,2), true);
+
+  vpl_unlink(serial.c_str());
+  vpl_unlink(parallel.c_str());
+}
+#endif // HAS_TIFF
+
+static void test_tiff_parallel()
+{
+#if HAS_TIFF
+  // vil_tiff writes pixel interleaved data, so use that layout
+  vil_image_view<vxl_byte> image(300, 200, 1, 3);
+  for (unsigned p=0;p<image.nplanes();++p)
+    for (unsigned j=0;j<image.nj();++j)
+      for (unsigned i=0;i<image.ni();++i)
+        image(i,j,p) = vxl_byte((i/2 + j + 40*p) & 0xff);
+
+  test_codec(image, COMPRESSION_LZW, -1, "LZW", 0);
+  test_codec(image, COMPRESSION_ADOBE_DEFLATE, 6, "deflate", 0);
+  if (TIFFIsCODECConfigured(COMPRESSION_JPEG))
+    test_codec(image, COMPRESSION_JPEG, 95, "JPEG", 12);
+  vil_parallel::set_max_threads(0);
+#endif // HAS_TIFF
+}
+
+TESTMAIN(test_tiff_parallel);
@@ -1,20 +1,149 @@
-#include <algorithm>
+#include <list>
 #include "vil_block_cache.h"
 //:
 // \file
 #include <vcl_compiler.h>
 #include <vcl_cassert.h>
+#include <vil/vil_pixel_format.h>
+#include <vxl_config.h> // for vxl_uint_32
+#if VXL_FULLCXX11SUPPORT
+# include <mutex>
+# include <unordered_map>
+#else
+# include <map>
+# include <utility>
+#endif
 
-unsigned long bcell::time_ = 0;
+//: One independently locked part of a vil_block_cache
+class vil_block_cache_shard
+{
+ public:
+#if VXL_FULLCXX11SUPPORT
+  //: The block indices packed into one word, so the index can hash them
+  typedef vxl_uint_64 key_type;
+  static key_type make_key(unsigned i, unsigned j) { return key_type(i) << 32 | j; }
+#else
+  typedef std::pair<unsigned, unsigned> key_type;
+  static key_type make_key(unsigned i, unsigned j) { return key_type(i, j); }
+#endif
+  struct entry
+  {
+    key_type key;
+    vil_image_view_base_sptr blk;
+    std::size_t bytes;
+    //: value of the cache clock when the block was last used
+    std::size_t used;
+  };
+  //: Most recently used block first
+  typedef std::list<entry> lru_list;
+#if VXL_FULLCXX11SUPPORT
+  typedef std::unordered_map<key_type, lru_list::iterator> index_type;
+#else
+  typedef std::map<key_type, lru_list::iterator> index_type;
+#endif
+
+  explicit vil_block_cache_shard(unsigned max_blocks)
+  : max_blocks_(max_blocks), bytes_(0),
+    hits_(0), misses_(0), evictions_(0) {}
+
+  unsigned max_blocks_;
+  std::size_t bytes_;
+  unsigned long hits_;
+  unsigned long misses_;
+  unsigned long evictions_;
+  lru_list lru_;
+  index_type index_;
+#if VXL_FULLCXX11SUPPORT
+  std::mutex mutex_;
+#endif
+
+  //: Remove an entry and return its size. Caller must hold the lock.
+  std::size_t erase(index_type::iterator it)
+  {
+    const std::size_t n = it->second->bytes;
+    bytes_ -= n;
+    lru_.erase(it->second);
+    index_.erase(it);
+    return n;
+  }
+
+  //: Evict the least recently used block and return its size. Caller must hold the lock.
+  std::size_t evict()
+  {
+    ++evictions_;
+    return erase(index_.find(lru_.back().key));
+  }
+};
+
+#if VXL_FULLCXX11SUPPORT
+# define VIL_BLOCK_CACHE_LOCK(s) std::lock_guard<std::mutex> lock((s).mutex_)
+#else
+# define VIL_BLOCK_CACHE_LOCK(s)
+#endif
+
+vil_block_cache::vil_block_cache(const unsigned block_capacity, std::size_t max_bytes,
+                                 unsigned n_shards)
+: nblocks_(block_capacity), max_bytes_(max_bytes), bytes_(0), clock_(0)
+{
+  if (n_shards == 0)
+  {
+    // Keep at least 16 blocks per shard, so that the eviction order stays
+    // close to that of a single LRU list.
+    n_shards = 8;
+    while (n_shards > 1 && block_capacity > 0 && block_capacity < 16*n_shards)
+      n_shards /= 2;
+  }
+  for (unsigned s = 0; s < n_shards; ++s)
+    shards_.push_back(new vil_block_cache_shard((block_capacity + n_shards - 1) / n_shards));
+}
 
 vil_block_cache::~vil_block_cache()
 {
-  for(std::vector<bcell*>::iterator bit = blocks_.begin();
-      bit != blocks_.end(); ++bit){
-    delete *bit;
-    *bit = VXL_NULLPTR;
+  for (unsigned s = 0; s < shards_.size(); ++s)
+    delete shards_[s];
+}
+
+vil_block_cache_shard& vil_block_cache::shard(unsigned block_index_i,
+                                              unsigned block_index_j) const
+{
+  // mix the indices (murmur3 finalizer) so neighbouring blocks spread out
+  vxl_uint_32 h = vxl_uint_32(block_index_i)*0x9e3779b1u ^ vxl_uint_32(block_index_j);
+  h ^= h >> 16; h *= 0x85ebca6bu;
+  h ^= h >> 13; h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return *shards_[h % shards_.size()];
+}
+
+std::size_t vil_block_cache::block_bytes(vil_image_view_base const& blk)
+{
+  return std::size_t(blk.ni()) * blk.nj() * blk.nplanes() *
+         vil_pixel_format_sizeof_components(blk.pixel_format()) *
+         vil_pixel_format_num_components(blk.pixel_format());
+}
+
+bool vil_block_cache::evict_oldest()
+{
+  // Blocks are stamped with the clock when used, so the least recently
+  // used block of the cache is the oldest of the shards' last blocks.
+  vil_block_cache_shard* oldest = VXL_NULLPTR;
+  std::size_t oldest_used = 0;
+  for (unsigned i = 0; i < shards_.size(); ++i)
+  {
+    vil_block_cache_shard& s = *shards_[i];
+    VIL_BLOCK_CACHE_LOCK(s);
+    if (!s.lru_.empty() && (!oldest || s.lru_.back().used < oldest_used))
+    {
+      oldest = &s;
+      oldest_used = s.lru_.back().used;
+    }
   }
-  blocks_.clear();//empty the index
+  if (!oldest)
+    return false;
+  VIL_BLOCK_CACHE_LOCK(*oldest);
+  // another thread may have emptied the shard in the meantime
+  if (!oldest->lru_.empty())
+    bytes_ -= oldest->evict();
+  return true;
 }
 
 //:add a block to the buffer.
@@ -22,14 +151,33 @@ bool vil_block_cache::add_block(const unsigned& block_index_i,
                                 const unsigned& block_index_j,
                                 vil_image_view_base_sptr const& blk)
 {
-  //create a cell
-
-  bcell* cell = new bcell(block_index_i, block_index_j, blk);
-  if (blocks_.size()>=nblocks_)
-    if (!this->remove_block())
+  if (!blk) return false;
+  const std::size_t n = block_bytes(*blk);
+  vil_block_cache_shard& s = shard(block_index_i, block_index_j);
+  const vil_block_cache_shard::key_type key =
+    vil_block_cache_shard::make_key(block_index_i, block_index_j);
+  {
+    VIL_BLOCK_CACHE_LOCK(s);
+    vil_block_cache_shard::index_type::iterator it = s.index_.find(key);
+    if (it != s.index_.end())
+      bytes_ -= s.erase(it);
+    if (max_bytes_ > 0 && n > max_bytes_)
       return false;
-  blocks_.push_back(cell);
-  std::sort(blocks_.begin(), blocks_.end(), bcell_less());
+    while (s.max_blocks_ > 0 && s.lru_.size() >= s.max_blocks_)
+      bytes_ -= s.evict();
+    vil_block_cache_shard::entry e;
+    e.key = key;
+    e.blk = blk;
+    e.bytes = n;
+    e.used = ++clock_;
+    s.lru_.push_front(e);
+    s.index_[key] = s.lru_.begin();
+    s.bytes_ += n;
+    bytes_ += n;
+  }
+  // The shard lock is released first, since eviction may lock any shard.
+  while (max_bytes_ > 0 && bytes_ > max_bytes_ && evict_oldest())
+    ;
   return true;
 }
 
@@ -37,31 +185,81 @@ bool vil_block_cache::get_block(const unsigned& block_index_i,
                                 const unsigned& block_index_j,
                                 vil_image_view_base_sptr& blk) const
 {
-  bool found = false;
-  for (std::vector<bcell*>::const_iterator bit=blocks_.begin(); bit!= blocks_.end()&&!found; ++bit)
+  vil_block_cache_shard& s = shard(block_index_i, block_index_j);
+  VIL_BLOCK_CACHE_LOCK(s);
+  vil_block_cache_shard::index_type::iterator it =
+    s.index_.find(vil_block_cache_shard::make_key(block_index_i, block_index_j));
+  if (it == s.index_.end())
   {
-    if ((*bit)->bindex_i_!=block_index_i||(*bit)->bindex_j_!=block_index_j)
-      continue;
-    else
-    {
-      found = true;
-      blk = (*bit)->blk_;
-      (*bit)->touch();//block is in demand so update the age to zero
-    }
+    ++s.misses_;
+    return false;
   }
-  return found;
+  ++s.hits_;
+  blk = it->second->blk;
+  // block is in demand so make it the most recently used
+  it->second->used = ++clock_;
+  s.lru_.splice(s.lru_.begin(), s.lru_, it->second);
+  return true;
 }
 
-//:remove the oldest priority block
-bool vil_block_cache::remove_block()
+bool vil_block_cache::contains(const unsigned& block_index_i,
+                               const unsigned& block_index_j) const
 {
-  if(!blocks_.size()){
-    std::cerr << "warning: attempt to remove block from empty cache\n";
+  vil_block_cache_shard& s = shard(block_index_i, block_index_j);
+  VIL_BLOCK_CACHE_LOCK(s);
+  return s.index_.count(vil_block_cache_shard::make_key(block_index_i, block_index_j)) > 0;
+}
+
+bool vil_block_cache::remove_block(const unsigned& block_index_i,
+                                   const unsigned& block_index_j)
+{
+  vil_block_cache_shard& s = shard(block_index_i, block_index_j);
+  VIL_BLOCK_CACHE_LOCK(s);
+  vil_block_cache_shard::index_type::iterator it =
+    s.index_.find(vil_block_cache_shard::make_key(block_index_i, block_index_j));
+  if (it == s.index_.end())
     return false;
-  }
-  // queue should already be sorted
-  // remove oldest
-  std::vector<bcell*>::iterator bit = blocks_.begin();
-  blocks_.erase(bit);
+  bytes_ -= s.erase(it);
   return true;
 }
+
+void vil_block_cache::clear()
+{
+  for (unsigned i = 0; i < shards_.size(); ++i)
+  {
+    vil_block_cache_shard& s = *shards_[i];
+    VIL_BLOCK_CACHE_LOCK(s);
+    bytes_ -= s.bytes_;
+    s.lru_.clear();
+    s.index_.clear();
+    s.bytes_ = 0;
+  }
+}
+
+vil_block_cache_stats vil_block_cache::stats() const
+{
+  vil_block_cache_stats st;
+  st.hits = st.misses = st.evictions = st.n_blocks = 0;
+  st.bytes = 0;
+  for (unsigned i = 0; i < shards_.size(); ++i)
+  {
+    vil_block_cache_shard& s = *shards_[i];
+    VIL_BLOCK_CACHE_LOCK(s);
+    st.hits += s.hits_;
+    st.misses += s.misses_;
+    st.evictions += s.evictions_;
+    st.n_blocks += (unsigned long)s.lru_.size();
+    st.bytes += s.bytes_;
+  }
+  return st;
+}
+
+void vil_block_cache::reset_stats()
+{
+  for (unsigned i = 0; i < shards_.size(); ++i)
+  {
+    vil_block_cache_shard& s = *shards_[i];
+    VIL_BLOCK_CACHE_LOCK(s);
+    s.hits_ = s.misses_ = s.evictions_ = 0;
+  }
+}
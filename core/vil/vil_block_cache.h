@@ -6,63 +6,68 @@
 #endif
 //:
 // \file
-// \brief A block cache with block population prioritized by age
+// \brief A thread safe cache of image blocks, evicting the least recently used
 // \author J. L. Mundy
 //
-#include <iostream>
-#include <queue>
-#include <vector>
-#include <vcl_compiler.h>
-#include <vil/vil_image_view_base.h>
-
+// The cache is split into shards, each with its own lock, index and
+// least-recently-used list.  A block is assigned to a shard by hashing its
+// indices, so readers working on different blocks rarely contend.  Both
+// the number of blocks and the number of bytes of pixel data held can be
+// limited.  Each shard gets an equal part of the block limit, but the
+// byte limit applies to the whole cache: when it is exceeded, the least
+// recently used block of any shard is evicted.  So any block no larger
+// than the byte limit can be cached, whatever the number of shards.
+// Small caches use a single shard, so eviction follows strict LRU order.
+//
 // \verbatim
 //  Modifications
 //   J.L. Mundy replaced priority queue with sort on block vector
 //   container for simplicity, January 01, 2012
+//   Replaced the sorted vector by sharded, indexed LRU lists with a byte
+//   budget and statistics; all methods may be called concurrently.
 // \endverbatim
 
-//container for blocks to maintain a timestamp
-//note that the larger value of time corresponds to the newest block
-struct bcell
-{
-  bcell(const unsigned bindex_i, const unsigned bindex_j,
-        vil_image_view_base_sptr const& blk) :
-    bindex_i_(bindex_i), bindex_j_(bindex_j), birthdate_(time_++), blk_(blk)
-  {}
-
-  //:block indices
-  unsigned bindex_i_;  unsigned bindex_j_;
-  //:the time of insertion into the queue
-  unsigned long birthdate_;
-  //:the block itself
-  vil_image_view_base_sptr blk_;
-  //:update the age of a block
-  void touch(){birthdate_=time_++;}
-  //: for debug
-  void print() const { std::cout << '[' << bindex_i_ << ' ' << bindex_j_
-                                << "](" << birthdate_ << ")\n"; }
- private:
-  static unsigned long time_; //static timekeeper
-};
-// the ordering predicate for block birthdate. Oldest block is at
-// blocks_.begin()
-class bcell_less
+#include <cstddef>
+#include <vector>
+#include <vcl_compiler.h>
+#include <vil/vil_image_view_base.h>
+#if VXL_FULLCXX11SUPPORT
+# include <atomic>
+#endif
+
+//: Counters describing the use of a vil_block_cache
+struct vil_block_cache_stats
 {
- public:
-  bcell_less(){}
-  //the predicate function
-  bool operator()(bcell* const& ba, bcell* const& bb) const
-  {
-    return ba->birthdate_ < bb->birthdate_;
-  }
+  //: Successful get_block() calls
+  unsigned long hits;
+  //: Unsuccessful get_block() calls
+  unsigned long misses;
+  //: Blocks removed to make room for others
+  unsigned long evictions;
+  //: Blocks currently held
+  unsigned long n_blocks;
+  //: Bytes of pixel data currently held
+  std::size_t bytes;
+
+  //: Fraction of get_block() calls which found their block
+  double hit_rate() const
+  { return hits+misses > 0 ? double(hits)/double(hits+misses) : 0.0; }
 };
+
+class vil_block_cache_shard;
+
 class vil_block_cache
 {
  public:
-  vil_block_cache(const unsigned block_capacity):nblocks_(block_capacity){}
+  //: Construct a cache holding at most block_capacity blocks and max_bytes bytes.
+  // A limit of zero means that limit is not applied.  If n_shards is zero
+  // a suitable number is chosen from the capacity.
+  vil_block_cache(const unsigned block_capacity, std::size_t max_bytes = 0,
+                  unsigned n_shards = 0);
   ~vil_block_cache();
 
-  //:add a block to the buffer
+  //:add a block to the buffer, replacing any block with the same indices.
+  // Returns false if the block is too big to be cached.
   bool add_block(const unsigned& block_index_i, const unsigned& block_index_j,
                  vil_image_view_base_sptr const& blk);
 
@@ -70,15 +75,62 @@ class vil_block_cache
   bool get_block(const unsigned& block_index_i, const unsigned& block_index_j,
                  vil_image_view_base_sptr& blk) const;
 
-  //:block capacity
+  //:true if the block is cached.
+  // Unlike get_block(), this is not counted as a hit or miss and does not
+  // make the block the most recently used.
+  bool contains(const unsigned& block_index_i, const unsigned& block_index_j) const;
+
+  //:remove a block from the buffer, e.g. because the image has changed.
+  // Returns false if the block was not cached.
+  bool remove_block(const unsigned& block_index_i, const unsigned& block_index_j);
+
+  //:remove all blocks
+  void clear();
+
+  //:block capacity (zero if unlimited)
   unsigned block_size() const{return nblocks_;}
+
+  //:byte capacity (zero if unlimited)
+  std::size_t max_bytes() const {return max_bytes_;}
+
+  //:number of independently locked parts of the cache
+  unsigned n_shards() const { return unsigned(shards_.size()); }
+
+  //:current contents and usage counters
+  vil_block_cache_stats stats() const;
+
+  //:zero the hit, miss and eviction counters
+  void reset_stats();
+
+  //:bytes of pixel data in a block
+  static std::size_t block_bytes(vil_image_view_base const& blk);
+
  private:
-  //:block index member
-  std::vector<bcell*> blocks_;
+  // Disallow copying
+  vil_block_cache(const vil_block_cache&);
+  vil_block_cache& operator=(const vil_block_cache&);
+
+  vil_block_cache_shard& shard(unsigned block_index_i, unsigned block_index_j) const;
+
+  //:evict the least recently used block of all the shards.
+  // Returns false if the cache is empty.
+  bool evict_oldest();
+
+#if VXL_FULLCXX11SUPPORT
+  typedef std::atomic<std::size_t> counter_type;
+#else
+  typedef std::size_t counter_type;
+#endif
+
   //:capacity in blocks
   unsigned nblocks_;
-  //:remove the lowest priority block
-  bool remove_block();
+  //:capacity in bytes
+  std::size_t max_bytes_;
+  //:bytes held by all the shards
+  counter_type bytes_;
+  //:incremented on each use of a block, to order blocks of different shards
+  mutable counter_type clock_;
+  std::vector<vil_block_cache_shard*> shards_;
 };
 
 #endif // vil_block_cache_h_
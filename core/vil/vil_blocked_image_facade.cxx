@@ -16,19 +16,38 @@
 
 static const unsigned vil_size_block_i = 256, vil_size_block_j = 256;
 
-vil_blocked_image_facade::vil_blocked_image_facade(const vil_image_resource_sptr &src, const unsigned sbi, const unsigned sbj):
-  src_(src)
+vil_blocked_image_facade::vil_blocked_image_facade(const vil_image_resource_sptr &src, const unsigned sbi, const unsigned sbj,
+                                                   const std::size_t cache_bytes):
+  src_(src), cache_(VXL_NULLPTR)
 {
   //cases
   // I the blocking is specified so use it
   if (sbi>0&&sbj>0)
   {
     sbi_ = sbi; sbj_=sbj;
-    return;
   }
   // II Use the default block size
-  sbi_ = vil_size_block_i;  sbj_ = vil_size_block_j;
+  else
+  {
+    sbi_ = vil_size_block_i;  sbj_ = vil_size_block_j;
+  }
   //set up the buffer
+  if (cache_bytes>0)
+    cache_ = new vil_block_cache(0, cache_bytes);
+}
+
+vil_blocked_image_facade::~vil_blocked_image_facade()
+{
+  delete cache_;
+}
+
+void vil_blocked_image_facade::invalidate(unsigned i0, unsigned ni,
+                                          unsigned j0, unsigned nj)
+{
+  if (!cache_ || ni==0 || nj==0) return;
+  for (unsigned bj = j0/sbj_; bj <= (j0+nj-1)/sbj_; ++bj)
+    for (unsigned bi = i0/sbi_; bi <= (i0+ni-1)/sbi_; ++bi)
+      cache_->remove_block(bi, bj);
 }
 
 vil_image_view_base_sptr
@@ -70,6 +89,9 @@ vil_blocked_image_facade::get_block( unsigned  block_index_i,
   unsigned ni = src_->ni(), nj = src_->nj();
   unsigned i0 = block_index_i*sbi_, j0 =  block_index_j*sbj_;
   if (i0>ni-1||j0>nj-1) return VXL_NULLPTR;
+  vil_image_view_base_sptr view;
+  if (cache_ && cache_->get_block(block_index_i, block_index_j, view))
+    return view;
   //check if the view that is supplied is smaller than a block
   unsigned icrop = ni-i0, jcrop = nj-j0;
   bool needs_fill = false;
@@ -82,18 +104,29 @@ vil_blocked_image_facade::get_block( unsigned  block_index_i,
     jcrop = sbj_;
   else
     needs_fill = true;
-  vil_image_view_base_sptr view = src_->get_view(i0, icrop, j0, jcrop);
-  if (needs_fill)
+  view = src_->get_view(i0, icrop, j0, jcrop);
+  if (needs_fill && view)
     view = fill_block(view);
+  if (cache_ && view)
+    cache_->add_block(block_index_i, block_index_j, view);
   return view;
 }
 
+bool vil_blocked_image_facade::put_view(const vil_image_view_base& im,
+                                        unsigned i0, unsigned j0)
+{
+  invalidate(i0, im.ni(), j0, im.nj());
+  return src_->put_view(im, i0, j0);
+}
+
 bool vil_blocked_image_facade::put_block(unsigned  block_index_i,
                                          unsigned  block_index_j,
                                          const vil_image_view_base& view)
 {
   // convert to image coordinates
   unsigned i0 = block_index_i*sbi_, j0 = block_index_j*sbj_;
+  if (cache_)
+    cache_->remove_block(block_index_i, block_index_j);
   // check if block is too big for the destination
   unsigned imax = i0 + sbi_, jmax = j0 + sbj_;
   unsigned icrop = sbi_, jcrop = sbj_;
@@ -9,18 +9,25 @@
 // \brief A blocked image facade for any image resource
 // \author J. L. Mundy
 //
-// this class "wraps" any image resource and provides blocking methods
+// this class "wraps" any image resource and provides blocking methods.
+// Optionally the blocks are kept in a vil_block_cache, so that repeated
+// requests for a block do not go back to the wrapped resource.
 //
 // not used? #include <vcl_compiler.h>
+#include <cstddef>
 #include <vector>
 #include <vil/vil_blocked_image_resource.h>
+#include <vil/vil_block_cache.h>
 
 class vil_blocked_image_facade : public vil_blocked_image_resource
 {
  public:
+  //: Wrap src, with blocks of sbi x sbj pixels (a default size if zero).
+  // If cache_bytes is non-zero, up to that many bytes of blocks are cached.
   vil_blocked_image_facade(const vil_image_resource_sptr &src,
-                           const unsigned sbi=0, const unsigned sbj=0);
-  virtual ~vil_blocked_image_facade() {}
+                           const unsigned sbi=0, const unsigned sbj=0,
+                           const std::size_t cache_bytes=0);
+  virtual ~vil_blocked_image_facade();
 
   inline virtual unsigned nplanes() const
   { return src_->nplanes();}
@@ -48,9 +55,8 @@ class vil_blocked_image_facade : public vil_blocked_image_resource
   get_copy_view(unsigned i0, unsigned n_i, unsigned j0, unsigned n_j) const
   { return src_->get_copy_view(i0, n_i, j0, n_j);}
 
-  inline virtual bool put_view(const vil_image_view_base& im,
-                               unsigned i0, unsigned j0)
-  { return src_->put_view(im, i0, j0);}
+  virtual bool put_view(const vil_image_view_base& im,
+                        unsigned i0, unsigned j0);
 
   //: Block access
   virtual vil_image_view_base_sptr get_block( unsigned  block_index_i,
@@ -65,6 +71,9 @@ class vil_blocked_image_facade : public vil_blocked_image_resource
   //: Extra property information
   virtual bool get_property(char const* tag, void* property_value = VXL_NULLPTR) const;
 
+  //: The block cache, or null if blocks are not cached
+  vil_block_cache const* cache() const { return cache_; }
+
  protected:
   //Internal functions
   vil_image_view_base_sptr fill_block(vil_image_view_base_sptr& view) const;
@@ -75,7 +84,13 @@ class vil_blocked_image_facade : public vil_blocked_image_resource
   unsigned sbi_;
   //:block size in j
   unsigned sbj_;
+  //:cached blocks, if caching is enabled
+  vil_block_cache* cache_;
+  //:discard cached blocks overlapping a region
+  void invalidate(unsigned i0, unsigned ni, unsigned j0, unsigned nj);
   vil_blocked_image_facade();//not meaningful
+  vil_blocked_image_facade(const vil_blocked_image_facade&);
+  vil_blocked_image_facade& operator=(const vil_blocked_image_facade&);
 };
 
 #endif // vil_blocked_image_facade_h_
@@ -20,9 +20,20 @@ vil_cached_image_resource::get_block( unsigned  block_index_i,
   blk = bir_->get_block(block_index_i, block_index_j);
   if (!blk)
     return blk; // get block failed
-  // put the block in the cache (cast away const since we are just caching)
-  vil_cached_image_resource* non_const = (vil_cached_image_resource*)this;
-  non_const->cache_.add_block(block_index_i, block_index_j, blk);
+  // put the block in the cache
+  cache_.add_block(block_index_i, block_index_j, blk);
   return blk;
 }
 
+bool vil_cached_image_resource::put_view(const vil_image_view_base& im,
+                                         unsigned i0, unsigned j0)
+{
+  // discard the cached blocks overlapped by the view
+  const unsigned sbi = size_block_i(), sbj = size_block_j();
+  if (sbi > 0 && sbj > 0 && im.ni() > 0 && im.nj() > 0)
+    for (unsigned bj = j0/sbj; bj <= (j0+im.nj()-1)/sbj; ++bj)
+      for (unsigned bi = i0/sbi; bi <= (i0+im.ni()-1)/sbi; ++bi)
+        cache_.remove_block(bi, bj);
+  return bir_->put_view(im, i0, j0);
+}
+
@@ -8,7 +8,11 @@
 // \file
 // \brief A cached and blocked representation of the image_resource
 // \author J. L. Mundy
+//
+// Blocks are kept in a vil_block_cache, so get_block() may be called from
+// several threads at once provided the underlying resource allows it.
 
+#include <cstddef>
 #include <vil/vil_blocked_image_resource.h>
 #include <vil/vil_block_cache.h>
 
@@ -16,9 +20,11 @@ class vil_cached_image_resource : public vil_blocked_image_resource
 {
  public:
 
+  //: Cache at most cache_size blocks, and at most max_bytes bytes if max_bytes is non-zero
   vil_cached_image_resource(vil_blocked_image_resource_sptr bir,
-                            const unsigned cache_size):
-    bir_(bir), cache_(vil_block_cache(cache_size)){}
+                            const unsigned cache_size,
+                            const std::size_t max_bytes = 0):
+    bir_(bir), cache_(cache_size, max_bytes){}
 
   virtual ~vil_cached_image_resource(){}
 
@@ -44,7 +50,8 @@ class vil_cached_image_resource : public vil_blocked_image_resource
  inline virtual enum vil_pixel_format pixel_format() const
     {return bir_->pixel_format();}
 
- inline virtual bool put_view(const vil_image_view_base& im, unsigned i0, unsigned j0) {return bir_->put_view(im, i0, j0);}
+ //: Put the data in this view back into the image source, discarding cached copies
+ virtual bool put_view(const vil_image_view_base& im, unsigned i0, unsigned j0);
 
   //: Block access
   virtual vil_image_view_base_sptr get_block( unsigned  block_index_i,
@@ -54,7 +61,11 @@ class vil_cached_image_resource : public vil_blocked_image_resource
   virtual bool put_block(unsigned  block_index_i,
                          unsigned  block_index_j,
                          const vil_image_view_base& view)
-    {return bir_->put_block(block_index_i, block_index_j, view);}
+    {cache_.remove_block(block_index_i, block_index_j);
+     return bir_->put_block(block_index_i, block_index_j, view);}
+
+  //: Hit, miss and eviction counts of the block cache
+  vil_block_cache_stats cache_stats() const {return cache_.stats();}
 
 
   //: Extra property information
@@ -63,7 +74,7 @@ class vil_cached_image_resource : public vil_blocked_image_resource
 
  protected:
   vil_blocked_image_resource_sptr bir_;
-  vil_block_cache cache_;
+  mutable vil_block_cache cache_;
 };
 
 #endif // vil_cached_image_resource_h_
@@ -48,6 +48,10 @@ vil_file_format::~vil_file_format()
 #include <vil/file_formats/vil_bmp.h>
 #endif
 
+#if HAS_RAW
+#include <vil/file_formats/vil_raw.h>
+#endif
+
 #if HAS_GIF
 #include <vil/file_formats/vil_gif.h>
 #endif
@@ -118,6 +122,9 @@ struct vil_file_format_storage
 #if HAS_GEN
     l[c++] = new vil_gen_file_format;
 #endif
+#if HAS_RAW
+    l[c++] = new vil_raw_file_format;
+#endif
 // the DCMTK based reader is more complete, so use try that
 // before the vil implementation
 #if HAS_DCMTK
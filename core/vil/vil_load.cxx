@@ -12,14 +12,17 @@
 #include <vil/vil_new.h>
 #include <vil/vil_file_format.h>
 #include <vil/vil_stream.h>
+#include <vil/vil_stream_mmap.h>
 #include <vil/vil_image_resource.h>
 #include <vil/vil_image_resource_plugin.h>
 #include <vil/vil_image_view.h>
 #include <vil/vil_exception.h>
+#include <vul/vul_tracing.h>
 
 vil_image_resource_sptr vil_load_image_resource_raw(vil_stream *is,
                                                     bool verbose)
 {
+  VUL_TRACE_SCOPE("vil_load_image_resource_raw");
   for (vil_file_format** p = vil_file_format::all(); *p; ++p) {
 #if 0 // debugging
     std::cerr << __FILE__ " : trying \'" << (*p)->tag() << "\'\n";
@@ -69,6 +72,18 @@ vil_image_resource_sptr vil_load_image_resource_raw(char const* filename,
   return isp;
 }
 
+vil_image_resource_sptr vil_load_image_resource_mapped(char const* filename,
+                                                       bool verbose)
+{
+  vil_smart_ptr<vil_stream> is = new vil_stream_mmap(filename);
+  if (!is->ok())
+    return vil_load_image_resource_raw(filename, verbose);
+  vil_image_resource_sptr isp = vil_load_image_resource_raw(is.as_pointer(), verbose);
+  if (!isp && verbose)
+    std::cerr << __FILE__ ": Failed to load [" << filename << "]\n";
+  return isp;
+}
+
 vil_image_resource_sptr vil_load_image_resource(char const* filename,
                                                 bool verbose)
 {
@@ -130,8 +145,11 @@ vil_load_pyramid_resource(char const* directory_or_file, bool verbose)
 //: Convenience function for loading an image into an image view.
 vil_image_view_base_sptr vil_load(const char *file, bool verbose)
 {
+  VUL_TRACE_SCOPE("vil_load");
   vil_image_resource_sptr data = vil_load_image_resource(file, verbose);
   if (!data) return VXL_NULLPTR;
+  VUL_TRACE_COUNTER("vil_load.images", 1);
+  VUL_TRACE_HISTOGRAM("vil_load.pixels", double(data->ni()) * data->nj() * data->nplanes());
   return data -> get_view();
 }
 
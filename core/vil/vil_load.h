@@ -47,6 +47,17 @@ vil_image_resource_sptr vil_load_image_resource_raw(vil_stream *,
 vil_image_resource_sptr vil_load_image_resource_raw(char const*,
                                                     bool verbose = true);
 
+//: Load an image resource object from a memory mapped file.
+// Resources for raw pgm/ppm files and uncompressed tiff files then return
+// views from get_view() which point straight into the mapped file, so
+// pixels are only read from disk when first used.  Writing to such a view
+// does not change the file.  The file must not be truncated while any
+// view of it exists.  Falls back to vil_load_image_resource_raw() if the
+// file cannot be mapped.  Won't use plugins.
+// \relatesalso vil_image_resource
+vil_image_resource_sptr vil_load_image_resource_mapped(char const* filename,
+                                                       bool verbose = true);
+
 //: Load from a filename with a plugin.
 // \relatesalso vil_image_resource
 vil_image_resource_sptr vil_load_image_resource_plugin(char const*);
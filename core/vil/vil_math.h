@@ -4,6 +4,10 @@
 // \file
 // \brief Various mathematical manipulations of 2D images
 // \author Tim Cootes
+//
+// The elementwise operations are applied with vil_transform_parallel, so
+// large images are processed in bands of rows on several threads, and
+// float and byte rows use SSE2 where it is available (vil_math_sse.hxx).
 
 #include <vector>
 #include <cmath>
@@ -16,7 +20,7 @@
 #include <vil/vil_transform.h>
 #include <vil/vil_config.h>
 
-#ifdef VXL_HAS_SSE2_HARDWARE_SUPPORT
+#if VXL_HAS_SSE2_HARDWARE_SUPPORT
 #include "vil_math_sse.h"
 #endif
 
@@ -334,10 +338,22 @@ class vil_math_sqrt_functor
 template<class T>
 inline void vil_math_sqrt(vil_image_view<T>& image)
 {
-  vil_transform(image,vil_math_sqrt_functor());
+  vil_transform_parallel(image,vil_math_sqrt_functor());
 }
 
 
+//: Functor class to truncate values to the range [min_v,max_v]
+template<class T>
+class vil_math_truncate_range_functor
+{
+  T min_v_, max_v_;
+ public:
+  vil_math_truncate_range_functor(T min_v, T max_v) : min_v_(min_v), max_v_(max_v) {}
+  T operator()(T x) const { return x<min_v_ ? min_v_ : (x>max_v_ ? max_v_ : x); }
+  T min_value() const { return min_v_; }
+  T max_value() const { return max_v_; }
+};
+
 //: Truncate each pixel value so it fits into range [min_v,max_v]
 //  If value < min_v value=min_v
 //  If value > max_v value=max_v
@@ -345,22 +361,7 @@ inline void vil_math_sqrt(vil_image_view<T>& image)
 template<class T>
 inline void vil_math_truncate_range(vil_image_view<T>& image, T min_v, T max_v)
 {
-  unsigned ni = image.ni(),nj = image.nj(),np = image.nplanes();
-  std::ptrdiff_t istep=image.istep(),jstep=image.jstep(),pstep = image.planestep();
-  T* plane = image.top_left_ptr();
-  for (unsigned p=0;p<np;++p,plane += pstep)
-  {
-    T* row = plane;
-    for (unsigned j=0;j<nj;++j,row += jstep)
-    {
-      T* pixel = row;
-      for (unsigned i=0;i<ni;++i,pixel+=istep)
-      {
-        if (*pixel<min_v) *pixel=min_v;
-        else if (*pixel>max_v) *pixel=max_v;
-      }
-    }
-  }
+  vil_transform_parallel(image, vil_math_truncate_range_functor<T>(min_v, max_v));
 }
 
 //: Functor class to scale by s
@@ -423,26 +424,30 @@ class vil_math_log_functor
 template<class T>
 inline void vil_math_scale_values(vil_image_view<T>& image, double scale)
 {
-  vil_transform(image,vil_math_scale_functor(scale));
+  vil_transform_parallel(image,vil_math_scale_functor(scale));
 }
 
+//: Functor class computing imT(s*x+t) (used by vil_math_scale_and_offset_values)
+// Unlike vil_math_scale_and_translate_functor this truncates rather than rounds.
+template<class imT, class offsetT>
+class vil_math_scale_and_offset_functor
+{
+ public:
+  vil_math_scale_and_offset_functor(double s, offsetT t) : s_(s), t_(t) {}
+  imT operator()(imT x) const { return imT(s_*x+t_); }
+  double scale() const { return s_; }
+  offsetT offset() const { return t_; }
+ private:
+  double s_;
+  offsetT t_;
+};
+
 //: Multiply values in-place in image view by scale and add offset
 // \relatesalso vil_image_view
 template<class imT, class offsetT>
 inline void vil_math_scale_and_offset_values(vil_image_view<imT>& image, double scale, offsetT offset)
 {
-  unsigned ni = image.ni(),nj = image.nj(),np = image.nplanes();
-  std::ptrdiff_t istep=image.istep(),jstep=image.jstep(),pstep = image.planestep();
-  imT* plane = image.top_left_ptr();
-  for (unsigned p=0;p<np;++p,plane += pstep)
-  {
-    imT* row = plane;
-    for (unsigned j=0;j<nj;++j,row += jstep)
-    {
-      imT* pixel = row;
-      for (unsigned i=0;i<ni;++i,pixel+=istep) *pixel = imT(scale*(*pixel)+offset);
-    }
-  }
+  vil_transform_parallel(image, vil_math_scale_and_offset_functor<imT,offsetT>(scale, offset));
 }
 
 //: Scale and offset values so their mean is zero and their variance is one.
@@ -602,6 +607,79 @@ void vil_math_sum_sqr(const vil_image_view<srcT>& src,
   }
 }
 
+//: Functor class computing sumT(a)+sumT(b)
+template<class sumT>
+struct vil_math_image_sum_functor
+{
+  template<class aT, class bT>
+  sumT operator()(aT a, bT b) const { return sumT(a)+sumT(b); }
+};
+
+//: Functor class computing sumT(a)-sumT(b)
+template<class sumT>
+struct vil_math_image_difference_functor
+{
+  template<class aT, class bT>
+  sumT operator()(aT a, bT b) const { return sumT(a)-sumT(b); }
+};
+
+//: Functor class computing sumT(a)*sumT(b)
+template<class sumT>
+struct vil_math_image_product_functor
+{
+  template<class aT, class bT>
+  sumT operator()(aT a, bT b) const { return sumT(a)*sumT(b); }
+};
+
+//: Functor class computing sumT(a)/sumT(b), or zero if b is zero
+template<class sumT>
+struct vil_math_image_ratio_functor
+{
+  template<class aT, class bT>
+  sumT operator()(aT a, bT b) const { return b==0 ? sumT(0) : sumT(sumT(a)/sumT(b)); }
+};
+
+//: Functor class computing maxT(max(a,b))
+template<class maxT>
+struct vil_math_image_max_functor
+{
+  template<class T>
+  maxT operator()(T a, T b) const { return maxT(std::max(a, b)); }
+};
+
+//: Functor class computing minT(min(a,b))
+template<class minT>
+struct vil_math_image_min_functor
+{
+  template<class T>
+  minT operator()(T a, T b) const { return minT(std::min(a, b)); }
+};
+
+//: Functor class computing aT(fa*a+fb*b) (used by vil_math_add_image_fraction)
+template<class aT, class scaleT>
+struct vil_math_add_image_fraction_functor
+{
+  scaleT fa, fb;
+  vil_math_add_image_fraction_functor(scaleT a, scaleT b) : fa(a), fb(b) {}
+  template<class bT>
+  aT operator()(aT a, bT b) const { return aT(fa*a+fb*b); }
+};
+
+//: Functor class computing fa*a+fb*b for bytes, saturated to [0,255]
+// Values are truncated towards zero, and NaN gives 0.
+template<>
+struct vil_math_add_image_fraction_functor<vxl_byte,float>
+{
+  float fa, fb;
+  vil_math_add_image_fraction_functor(float a, float b) : fa(a), fb(b) {}
+  template<class bT>
+  vxl_byte operator()(vxl_byte a, bT b) const
+  {
+    const float x = fa*a+fb*b;
+    return x > 255.0f ? vxl_byte(255) : x > 0.0f ? vxl_byte(x) : vxl_byte(0);
+  }
+};
+
 //: Compute sum of two images (im_sum = imA+imB)
 // \relatesalso vil_image_view
 template<class aT, class bT, class sumT>
@@ -609,30 +687,8 @@ inline void vil_math_image_sum(const vil_image_view<aT>& imA,
                                const vil_image_view<bT>& imB,
                                vil_image_view<sumT>& im_sum)
 {
-  unsigned ni = imA.ni(),nj = imA.nj(),np = imA.nplanes();
-  assert(imB.ni()==ni && imB.nj()==nj && imB.nplanes()==np);
-  im_sum.set_size(ni,nj,np);
-
-  std::ptrdiff_t istepA=imA.istep(),jstepA=imA.jstep(),pstepA = imA.planestep();
-  std::ptrdiff_t istepB=imB.istep(),jstepB=imB.jstep(),pstepB = imB.planestep();
-  std::ptrdiff_t istepS=im_sum.istep(),jstepS=im_sum.jstep(),pstepS = im_sum.planestep();
-  const aT* planeA = imA.top_left_ptr();
-  const bT* planeB = imB.top_left_ptr();
-  sumT* planeS     = im_sum.top_left_ptr();
-  for (unsigned p=0;p<np;++p,planeA += pstepA,planeB += pstepB,planeS += pstepS)
-  {
-    const aT* rowA   = planeA;
-    const bT* rowB   = planeB;
-    sumT* rowS = planeS;
-    for (unsigned j=0;j<nj;++j,rowA += jstepA,rowB += jstepB,rowS += jstepS)
-    {
-      const aT* pixelA = rowA;
-      const bT* pixelB = rowB;
-      sumT* pixelS = rowS;
-      for (unsigned i=0;i<ni;++i,pixelA+=istepA,pixelB+=istepB,pixelS+=istepS)
-        *pixelS = sumT(*pixelA)+sumT(*pixelB);
-    }
-  }
+  assert(imB.ni()==imA.ni() && imB.nj()==imA.nj() && imB.nplanes()==imA.nplanes());
+  vil_transform_parallel(imA, imB, im_sum, vil_math_image_sum_functor<sumT>());
 }
 
 //: Compute pixel-wise product of two images (im_prod(i,j) = imA(i,j)*imB(i,j)
@@ -645,36 +701,9 @@ inline void vil_math_image_product(const vil_image_view<aT>& imA,
                                    const vil_image_view<bT>& imB,
                                    vil_image_view<sumT>& im_product)
 {
-  unsigned ni = imA.ni(),nj = imA.nj(),np = imA.nplanes();
-  assert(imB.ni()==ni && imB.nj()==nj);
-  assert(imB.nplanes()==1 || imB.nplanes()==np);
-  im_product.set_size(ni,nj,np);
-
-  std::ptrdiff_t istepA=imA.istep(),jstepA=imA.jstep(),pstepA = imA.planestep();
-  std::ptrdiff_t istepB=imB.istep(),jstepB=imB.jstep(),pstepB = imB.planestep();
-  std::ptrdiff_t istepP=im_product.istep(),jstepP=im_product.jstep(),
-                pstepP = im_product.planestep();
-
-  // For one plane case, arrange that im_prod(i,j,p) = imA(i,j,p)*imB(i,j,0)
-  if (imB.nplanes()==1) pstepB=0;
-
-  const aT* planeA = imA.top_left_ptr();
-  const bT* planeB = imB.top_left_ptr();
-  sumT* planeP     = im_product.top_left_ptr();
-  for (unsigned p=0;p<np;++p,planeA += pstepA,planeB += pstepB,planeP += pstepP)
-  {
-    const aT* rowA   = planeA;
-    const bT* rowB   = planeB;
-    sumT* rowP = planeP;
-    for (unsigned j=0;j<nj;++j,rowA += jstepA,rowB += jstepB,rowP += jstepP)
-    {
-      const aT* pixelA = rowA;
-      const bT* pixelB = rowB;
-      sumT* pixelP = rowP;
-      for (unsigned i=0;i<ni;++i,pixelA+=istepA,pixelB+=istepB,pixelP+=istepP)
-        *pixelP = sumT(*pixelA)*sumT(*pixelB);
-    }
-  }
+  assert(imB.ni()==imA.ni() && imB.nj()==imA.nj());
+  assert(imB.nplanes()==1 || imB.nplanes()==imA.nplanes());
+  vil_transform_parallel(imA, imB, im_product, vil_math_image_product_functor<sumT>());
 }
 
 //: Compute the max of two images (im_max = max(imA, imB))
@@ -684,30 +713,8 @@ inline void vil_math_image_max(const vil_image_view<aT>& imA,
                                const vil_image_view<bT>& imB,
                                vil_image_view<maxT>& im_max)
 {
-  unsigned ni = imA.ni(),nj = imA.nj(),np = imA.nplanes();
-  assert(imB.ni()==ni && imB.nj()==nj && imB.nplanes()==np);
-  im_max.set_size(ni,nj,np);
-
-  std::ptrdiff_t istepA=imA.istep(),jstepA=imA.jstep(),pstepA = imA.planestep();
-  std::ptrdiff_t istepB=imB.istep(),jstepB=imB.jstep(),pstepB = imB.planestep();
-  std::ptrdiff_t istepS=im_max.istep(),jstepS=im_max.jstep(),pstepS = im_max.planestep();
-  const aT* planeA = imA.top_left_ptr();
-  const bT* planeB = imB.top_left_ptr();
-  maxT* planeS     = im_max.top_left_ptr();
-  for (unsigned p=0;p<np;++p,planeA += pstepA,planeB += pstepB,planeS += pstepS)
-  {
-    const aT* rowA   = planeA;
-    const bT* rowB   = planeB;
-    maxT* rowS = planeS;
-    for (unsigned j=0;j<nj;++j,rowA += jstepA,rowB += jstepB,rowS += jstepS)
-    {
-      const aT* pixelA = rowA;
-      const bT* pixelB = rowB;
-      maxT* pixelS = rowS;
-      for (unsigned i=0;i<ni;++i,pixelA+=istepA,pixelB+=istepB,pixelS+=istepS)
-        *pixelS = maxT(std::max(*pixelA, *pixelB));
-    }
-  }
+  assert(imB.ni()==imA.ni() && imB.nj()==imA.nj() && imB.nplanes()==imA.nplanes());
+  vil_transform_parallel(imA, imB, im_max, vil_math_image_max_functor<maxT>());
 }
 
 //: Compute the min of two images (im_min = min(imA, imB))
@@ -717,30 +724,8 @@ inline void vil_math_image_min(const vil_image_view<aT>& imA,
                                const vil_image_view<bT>& imB,
                                vil_image_view<minT>& im_min)
 {
-  unsigned ni = imA.ni(),nj = imA.nj(),np = imA.nplanes();
-  assert(imB.ni()==ni && imB.nj()==nj && imB.nplanes()==np);
-  im_min.set_size(ni,nj,np);
-
-  std::ptrdiff_t istepA=imA.istep(),jstepA=imA.jstep(),pstepA = imA.planestep();
-  std::ptrdiff_t istepB=imB.istep(),jstepB=imB.jstep(),pstepB = imB.planestep();
-  std::ptrdiff_t istepS=im_min.istep(),jstepS=im_min.jstep(),pstepS = im_min.planestep();
-  const aT* planeA = imA.top_left_ptr();
-  const bT* planeB = imB.top_left_ptr();
-  minT* planeS     = im_min.top_left_ptr();
-  for (unsigned p=0;p<np;++p,planeA += pstepA,planeB += pstepB,planeS += pstepS)
-  {
-    const aT* rowA   = planeA;
-    const bT* rowB   = planeB;
-    minT* rowS = planeS;
-    for (unsigned j=0;j<nj;++j,rowA += jstepA,rowB += jstepB,rowS += jstepS)
-    {
-      const aT* pixelA = rowA;
-      const bT* pixelB = rowB;
-      minT* pixelS = rowS;
-      for (unsigned i=0;i<ni;++i,pixelA+=istepA,pixelB+=istepB,pixelS+=istepS)
-        *pixelS = minT(std::min(*pixelA, *pixelB));
-    }
-  }
+  assert(imB.ni()==imA.ni() && imB.nj()==imA.nj() && imB.nplanes()==imA.nplanes());
+  vil_transform_parallel(imA, imB, im_min, vil_math_image_min_functor<minT>());
 }
 
 //: Compute pixel-wise ratio of two images : im_ratio(i,j) = imA(i,j)/imB(i,j)
@@ -756,38 +741,9 @@ inline void vil_math_image_ratio(const vil_image_view<aT>& imA,
                                  const vil_image_view<bT>& imB,
                                  vil_image_view<sumT>& im_ratio)
 {
-  unsigned ni = imA.ni(),nj = imA.nj(),np = imA.nplanes();
-  assert(imB.ni()==ni && imB.nj()==nj);
-  assert(imB.ni()==ni && imB.nj()==nj);
-  assert(imB.nplanes()==1 || imB.nplanes()==np);
-  im_ratio.set_size(ni,nj,np);
-
-  std::ptrdiff_t istepA=imA.istep(),jstepA=imA.jstep(),pstepA = imA.planestep();
-  std::ptrdiff_t istepB=imB.istep(),jstepB=imB.jstep(),pstepB = imB.planestep();
-  std::ptrdiff_t istepR=im_ratio.istep(),jstepR=im_ratio.jstep(),
-                pstepR = im_ratio.planestep();
-
-  // For one plane case, arrange that im_ratio(i,j,p) = imA(i,j,p)/imB(i,j,0)
-  if (imB.nplanes()==1) pstepB=0;
-
-  const aT* planeA = imA.top_left_ptr();
-  const bT* planeB = imB.top_left_ptr();
-  sumT* planeR     = im_ratio.top_left_ptr();
-  for (unsigned p=0;p<np;++p,planeA += pstepA,planeB += pstepB,planeR += pstepR)
-  {
-    const aT* rowA   = planeA;
-    const bT* rowB   = planeB;
-    sumT* rowR = planeR;
-    for (unsigned j=0;j<nj;++j,rowA += jstepA,rowB += jstepB,rowR += jstepR)
-    {
-      const aT* pixelA = rowA;
-      const bT* pixelB = rowB;
-      sumT* pixelR = rowR;
-      for (unsigned i=0;i<ni;++i,pixelA+=istepA,pixelB+=istepB,pixelR+=istepR)
-      if (*pixelB==0) *pixelR=0;
-      else *pixelR = sumT(*pixelA)/sumT(*pixelB);
-    }
-  }
+  assert(imB.ni()==imA.ni() && imB.nj()==imA.nj());
+  assert(imB.nplanes()==1 || imB.nplanes()==imA.nplanes());
+  vil_transform_parallel(imA, imB, im_ratio, vil_math_image_ratio_functor<sumT>());
 }
 
 //: Compute difference of two images (im_sum = imA-imB)
@@ -797,30 +753,8 @@ inline void vil_math_image_difference(const vil_image_view<aT>& imA,
                                       const vil_image_view<bT>& imB,
                                       vil_image_view<sumT>& im_sum)
 {
-  unsigned ni = imA.ni(),nj = imA.nj(),np = imA.nplanes();
-  assert(imB.ni()==ni && imB.nj()==nj && imB.nplanes()==np);
-  im_sum.set_size(ni,nj,np);
-
-  std::ptrdiff_t istepA=imA.istep(),jstepA=imA.jstep(),pstepA = imA.planestep();
-  std::ptrdiff_t istepB=imB.istep(),jstepB=imB.jstep(),pstepB = imB.planestep();
-  std::ptrdiff_t istepS=im_sum.istep(),jstepS=im_sum.jstep(),pstepS = im_sum.planestep();
-  const aT* planeA = imA.top_left_ptr();
-  const bT* planeB = imB.top_left_ptr();
-  sumT* planeS     = im_sum.top_left_ptr();
-  for (unsigned p=0;p<np;++p,planeA += pstepA,planeB += pstepB,planeS += pstepS)
-  {
-    const aT* rowA   = planeA;
-    const bT* rowB   = planeB;
-    sumT* rowS = planeS;
-    for (unsigned j=0;j<nj;++j,rowA += jstepA,rowB += jstepB,rowS += jstepS)
-    {
-      const aT* pixelA = rowA;
-      const bT* pixelB = rowB;
-      sumT* pixelS = rowS;
-      for (unsigned i=0;i<ni;++i,pixelA+=istepA,pixelB+=istepB,pixelS+=istepS)
-        *pixelS = sumT(*pixelA)-sumT(*pixelB);
-    }
-  }
+  assert(imB.ni()==imA.ni() && imB.nj()==imA.nj() && imB.nplanes()==imA.nplanes());
+  vil_transform_parallel(imA, imB, im_sum, vil_math_image_difference_functor<sumT>());
 }
 
 
@@ -965,25 +899,8 @@ template<class aT, class bT, class scaleT>
 inline void vil_math_add_image_fraction(vil_image_view<aT>& imA, scaleT fa,
                                         const vil_image_view<bT>& imB, scaleT fb)
 {
-  unsigned ni = imA.ni(),nj = imA.nj(),np = imA.nplanes();
-  assert(imB.ni()==ni && imB.nj()==nj && imB.nplanes()==np);
-
-  std::ptrdiff_t istepA=imA.istep(),jstepA=imA.jstep(),pstepA = imA.planestep();
-  std::ptrdiff_t istepB=imB.istep(),jstepB=imB.jstep(),pstepB = imB.planestep();
-  aT* planeA = imA.top_left_ptr();
-  const bT* planeB = imB.top_left_ptr();
-  for (unsigned p=0;p<np;++p,planeA += pstepA,planeB += pstepB)
-  {
-    aT* rowA   = planeA;
-    const bT* rowB   = planeB;
-    for (unsigned j=0;j<nj;++j,rowA += jstepA,rowB += jstepB)
-    {
-      aT* pixelA = rowA;
-      const bT* pixelB = rowB;
-      for (unsigned i=0;i<ni;++i,pixelA+=istepA,pixelB+=istepB)
-        *pixelA = aT(fa*(*pixelA)+fb*(*pixelB));
-    }
-  }
+  assert(imB.ni()==imA.ni() && imB.nj()==imA.nj() && imB.nplanes()==imA.nplanes());
+  vil_transform_parallel(imA, imB, imA, vil_math_add_image_fraction_functor<aT,scaleT>(fa, fb));
 }
 
 //: Compute integral image im_sum(i+1,j+1) = sum (x<=i,y<=j) imA(x,y)
@@ -1101,7 +1018,7 @@ inline void vil_math_integral_sqr_image(const vil_image_view<aT>& imA,
 }
 
 
-#ifdef VXL_HAS_SSE2_HARDWARE_SUPPORT
+#if VXL_HAS_SSE2_HARDWARE_SUPPORT
 #include "vil_math_sse.hxx"
 #endif
 
@@ -130,4 +130,128 @@ inline void vil_math_image_abs_difference_1d_sse<float,float,float>(
   }
 }
 
+//: im_sum = imA+imB on a row of floats
+inline void vil_transform_row(const float* pxA, const float* pxB, float* pxD, unsigned len,
+                              vil_math_image_sum_functor<float> const& f)
+{
+  unsigned i = 0;
+  for (; i+4 <= len; i += 4)
+    _mm_storeu_ps(pxD+i, _mm_add_ps(_mm_loadu_ps(pxA+i), _mm_loadu_ps(pxB+i)));
+  for (; i < len; ++i)
+    pxD[i] = f(pxA[i], pxB[i]);
+}
+
+//: im_diff = imA-imB on a row of floats
+inline void vil_transform_row(const float* pxA, const float* pxB, float* pxD, unsigned len,
+                              vil_math_image_difference_functor<float> const& f)
+{
+  unsigned i = 0;
+  for (; i+4 <= len; i += 4)
+    _mm_storeu_ps(pxD+i, _mm_sub_ps(_mm_loadu_ps(pxA+i), _mm_loadu_ps(pxB+i)));
+  for (; i < len; ++i)
+    pxD[i] = f(pxA[i], pxB[i]);
+}
+
+//: im_product = imA*imB on a row of floats
+inline void vil_transform_row(const float* pxA, const float* pxB, float* pxD, unsigned len,
+                              vil_math_image_product_functor<float> const& f)
+{
+  unsigned i = 0;
+  for (; i+4 <= len; i += 4)
+    _mm_storeu_ps(pxD+i, _mm_mul_ps(_mm_loadu_ps(pxA+i), _mm_loadu_ps(pxB+i)));
+  for (; i < len; ++i)
+    pxD[i] = f(pxA[i], pxB[i]);
+}
+
+//: imA = fa*imA + fb*imB on a row of floats
+inline void vil_transform_row(const float* pxA, const float* pxB, float* pxD, unsigned len,
+                              vil_math_add_image_fraction_functor<float,float> const& f)
+{
+  const __m128 fa = _mm_set1_ps(f.fa), fb = _mm_set1_ps(f.fb);
+  unsigned i = 0;
+  for (; i+4 <= len; i += 4)
+    _mm_storeu_ps(pxD+i, _mm_add_ps(_mm_mul_ps(fa, _mm_loadu_ps(pxA+i)),
+                                    _mm_mul_ps(fb, _mm_loadu_ps(pxB+i))));
+  for (; i < len; ++i)
+    pxD[i] = f(pxA[i], pxB[i]);
+}
+
+//: imA = fa*imA + fb*imB on a row of bytes, computed in float (e.g. a running mean).
+// Results outside [0,255] saturate, as in the functor.
+inline void vil_transform_row(const vxl_byte* pxA, const vxl_byte* pxB, vxl_byte* pxD, unsigned len,
+                              vil_math_add_image_fraction_functor<vxl_byte,float> const& f)
+{
+  const __m128 fa = _mm_set1_ps(f.fa), fb = _mm_set1_ps(f.fb);
+  const __m128 lo = _mm_setzero_ps(), hi = _mm_set1_ps(255.0f);
+  const __m128i zero = _mm_setzero_si128();
+  unsigned i = 0;
+  for (; i+16 <= len; i += 16)
+  {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pxA+i));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pxB+i));
+    const __m128i a_lo = _mm_unpacklo_epi8(a, zero), a_hi = _mm_unpackhi_epi8(a, zero);
+    const __m128i b_lo = _mm_unpacklo_epi8(b, zero), b_hi = _mm_unpackhi_epi8(b, zero);
+    __m128i r[4];
+    const __m128i as[4] = { _mm_unpacklo_epi16(a_lo, zero), _mm_unpackhi_epi16(a_lo, zero),
+                            _mm_unpacklo_epi16(a_hi, zero), _mm_unpackhi_epi16(a_hi, zero) };
+    const __m128i bs[4] = { _mm_unpacklo_epi16(b_lo, zero), _mm_unpackhi_epi16(b_lo, zero),
+                            _mm_unpacklo_epi16(b_hi, zero), _mm_unpackhi_epi16(b_hi, zero) };
+    // clamp before converting, so large values and NaN (which max_ps
+    // replaces by its second operand) saturate like the scalar version
+    for (unsigned k = 0; k < 4; ++k)
+      r[k] = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(fa, _mm_cvtepi32_ps(as[k])),
+                                                               _mm_mul_ps(fb, _mm_cvtepi32_ps(bs[k]))),
+                                                    lo), hi));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pxD+i),
+                     _mm_packus_epi16(_mm_packs_epi32(r[0], r[1]), _mm_packs_epi32(r[2], r[3])));
+  }
+  for (; i < len; ++i)
+    pxD[i] = f(pxA[i], pxB[i]);
+}
+
+//: float(s*x+t) on a row of floats, computed in double as the generic version does
+template<class offsetT>
+inline void vil_transform_row(const float* src, float* dest, unsigned len,
+                              vil_math_scale_and_offset_functor<float,offsetT> const& f)
+{
+  const __m128d s = _mm_set1_pd(f.scale()), t = _mm_set1_pd(double(f.offset()));
+  unsigned i = 0;
+  for (; i+4 <= len; i += 4)
+  {
+    const __m128 x = _mm_loadu_ps(src+i);
+    const __m128 lo = _mm_cvtpd_ps(_mm_add_pd(_mm_mul_pd(s, _mm_cvtps_pd(x)), t));
+    const __m128 hi = _mm_cvtpd_ps(_mm_add_pd(_mm_mul_pd(s, _mm_cvtps_pd(_mm_movehl_ps(x, x))), t));
+    _mm_storeu_ps(dest+i, _mm_movelh_ps(lo, hi));
+  }
+  for (; i < len; ++i)
+    dest[i] = f(src[i]);
+}
+
+//: Truncate a row of floats to [min_v,max_v]; NaNs are left unchanged
+inline void vil_transform_row(const float* src, float* dest, unsigned len,
+                              vil_math_truncate_range_functor<float> const& f)
+{
+  const __m128 lo = _mm_set1_ps(f.min_value()), hi = _mm_set1_ps(f.max_value());
+  unsigned i = 0;
+  for (; i+4 <= len; i += 4)
+    _mm_storeu_ps(dest+i, _mm_min_ps(hi, _mm_max_ps(lo, _mm_loadu_ps(src+i))));
+  for (; i < len; ++i)
+    dest[i] = f(src[i]);
+}
+
+//: Truncate a row of bytes to [min_v,max_v]
+inline void vil_transform_row(const vxl_byte* src, vxl_byte* dest, unsigned len,
+                              vil_math_truncate_range_functor<vxl_byte> const& f)
+{
+  const __m128i lo = _mm_set1_epi8(char(f.min_value())), hi = _mm_set1_epi8(char(f.max_value()));
+  unsigned i = 0;
+  for (; i+16 <= len; i += 16)
+  {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src+i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest+i), _mm_min_epu8(hi, _mm_max_epu8(lo, x)));
+  }
+  for (; i < len; ++i)
+    dest[i] = f(src[i]);
+}
+
 #endif // vil_math_sse_hxx_
@@ -0,0 +1,320 @@
+// This is core/vil/vil_memory_allocator.cxx
+//:
+// \file
+
+#include <new>
+#include <cstdlib>
+#include <ctime>
+#include "vil_memory_allocator.h"
+#include <vxl_config.h>
+#if VXL_HAS_ALIGNED_MALLOC || VXL_HAS_MINGW_ALIGNED_MALLOC || VXL_HAS_POSIX_MEMALIGN
+# include <malloc.h>
+#endif
+#if defined(__linux__)
+# include <sys/mman.h>
+#endif
+#if VXL_FULLCXX11SUPPORT
+# include <chrono>
+#endif
+
+//: Seconds from an arbitrary origin
+static double vil_memory_allocator_now()
+{
+#if VXL_FULLCXX11SUPPORT
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+  return double(std::time(VXL_NULLPTR));
+#endif
+}
+
+//=======================================================================
+// vil_memory_allocator
+
+vil_memory_allocator::vil_memory_allocator()
+: live_bytes_(0), peak_bytes_(0), n_allocations_(0), n_reused_(0),
+  reset_time_(vil_memory_allocator_now())
+{
+}
+
+vil_memory_allocator::~vil_memory_allocator()
+{
+}
+
+vil_memory_allocator_stats vil_memory_allocator::stats() const
+{
+  vil_memory_allocator_stats s;
+  s.live_bytes = live_bytes_;
+  s.peak_bytes = peak_bytes_;
+  s.cached_bytes = 0;
+  s.n_allocations = n_allocations_;
+  s.n_reused = n_reused_;
+  s.seconds = vil_memory_allocator_now() - reset_time_;
+  return s;
+}
+
+void vil_memory_allocator::reset_stats()
+{
+  n_allocations_ = 0;
+  n_reused_ = 0;
+  peak_bytes_ = std::size_t(live_bytes_);
+  reset_time_ = vil_memory_allocator_now();
+}
+
+void vil_memory_allocator::record_allocate(std::size_t n, bool reused)
+{
+  ++n_allocations_;
+  if (reused) ++n_reused_;
+#if VXL_FULLCXX11SUPPORT
+  const std::size_t live = (live_bytes_ += n);
+  std::size_t peak = peak_bytes_.load();
+  while (live > peak && !peak_bytes_.compare_exchange_weak(peak, live)) {}
+#else
+  live_bytes_ += n;
+  if (live_bytes_ > peak_bytes_) peak_bytes_ = live_bytes_;
+#endif
+}
+
+void vil_memory_allocator::record_deallocate(std::size_t n)
+{
+  live_bytes_ -= n;
+}
+
+#if VXL_FULLCXX11SUPPORT
+static std::atomic<vil_memory_allocator*> vil_memory_allocator_default(VXL_NULLPTR);
+#else
+static vil_memory_allocator* vil_memory_allocator_default = VXL_NULLPTR;
+#endif
+
+vil_memory_allocator* vil_memory_allocator::default_allocator()
+{
+  vil_memory_allocator* a = vil_memory_allocator_default;
+  return a ? a : pool();
+}
+
+void vil_memory_allocator::set_default_allocator(vil_memory_allocator* a)
+{
+  vil_memory_allocator_default = a;
+}
+
+// The built-in allocators are never destroyed, so that images held in
+// static variables can still release their memory during program exit.
+
+vil_memory_allocator* vil_memory_allocator::heap()
+{
+  static vil_aligned_memory_allocator* a = new vil_aligned_memory_allocator;
+  return a;
+}
+
+vil_pooled_memory_allocator* vil_memory_allocator::pool()
+{
+  static vil_pooled_memory_allocator* a = new vil_pooled_memory_allocator;
+  return a;
+}
+
+//=======================================================================
+// vil_aligned_memory_allocator
+
+//: Blocks at least this big may be backed by huge pages
+static const std::size_t vil_huge_page_size = std::size_t(2) << 20;
+
+static void* vil_aligned_malloc(std::size_t n, std::size_t alignment)
+{
+#if VXL_HAS_ALIGNED_MALLOC
+  return _aligned_malloc(n, alignment);
+#elif VXL_HAS_MINGW_ALIGNED_MALLOC
+  return __mingw_aligned_malloc(n, alignment);
+#elif VXL_HAS_POSIX_MEMALIGN
+  return memalign(alignment, n);
+#else
+  // Over-allocate, and keep the pointer to free just before the block.
+  char* base = static_cast<char*>(std::malloc(n + alignment + sizeof(void*)));
+  if (!base) return VXL_NULLPTR;
+  std::size_t addr = reinterpret_cast<std::size_t>(base + sizeof(void*));
+  char* p = reinterpret_cast<char*>((addr + alignment - 1) & ~(alignment - 1));
+  reinterpret_cast<void**>(p)[-1] = base;
+  return p;
+#endif
+}
+
+static void vil_aligned_free(void* p)
+{
+#if VXL_HAS_ALIGNED_MALLOC
+  _aligned_free(p);
+#elif VXL_HAS_MINGW_ALIGNED_MALLOC
+  __mingw_aligned_free(p);
+#elif VXL_HAS_POSIX_MEMALIGN
+  std::free(p);
+#else
+  if (p) std::free(reinterpret_cast<void**>(p)[-1]);
+#endif
+}
+
+void* vil_aligned_memory_allocator::allocate(std::size_t n)
+{
+  if (n == 0) return VXL_NULLPTR;
+  void* p;
+  if (huge_pages_ && n >= vil_huge_page_size)
+  {
+    p = vil_aligned_malloc(n, vil_huge_page_size);
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (p) madvise(p, n - n % vil_huge_page_size, MADV_HUGEPAGE);
+#endif
+  }
+  else
+    p = vil_aligned_malloc(n, VIL_MEMORY_ALIGNMENT);
+  if (!p) throw std::bad_alloc();
+  record_allocate(n, false);
+  return p;
+}
+
+void vil_aligned_memory_allocator::deallocate(void* p, std::size_t n)
+{
+  if (!p) return;
+  vil_aligned_free(p);
+  record_deallocate(n);
+}
+
+//=======================================================================
+// vil_pooled_memory_allocator
+
+//: Index of the size class holding n bytes, and the size of that class.
+// Sizes up to 64 bytes form class 0.  Above that, each interval
+// (2^k, 2^(k+1)] is split into four classes of equal width.
+static unsigned vil_pool_size_index(std::size_t n, std::size_t& size)
+{
+  if (n <= VIL_MEMORY_ALIGNMENT)
+  {
+    size = VIL_MEMORY_ALIGNMENT;
+    return 0;
+  }
+  unsigned k = 0;
+  for (std::size_t m = n - 1; m > 1; m >>= 1) ++k;  // 2^k < n <= 2^(k+1)
+  const std::size_t base = std::size_t(1) << k, step = base >> 2;
+  const std::size_t q = (n - base + step - 1) / step;  // 1..4
+  size = base + q * step;
+  return 4 * (k - 6) + unsigned(q);
+}
+
+//: Size of the blocks in class index (inverse of vil_pool_size_index)
+static std::size_t vil_pool_class_size(unsigned index)
+{
+  if (index == 0) return VIL_MEMORY_ALIGNMENT;
+  const std::size_t base = std::size_t(1) << ((index - 1) / 4 + 6);
+  return base + ((index - 1) % 4 + 1) * (base >> 2);
+}
+
+std::size_t vil_pooled_memory_allocator::size_class(std::size_t n)
+{
+  std::size_t size;
+  vil_pool_size_index(n, size);
+  return size;
+}
+
+vil_pooled_memory_allocator::vil_pooled_memory_allocator(std::size_t max_cached_bytes,
+                                                         vil_memory_allocator* upstream)
+: upstream_(upstream ? upstream : vil_memory_allocator::heap()),
+  max_cached_bytes_(max_cached_bytes), cached_bytes_(0)
+{
+}
+
+vil_pooled_memory_allocator::~vil_pooled_memory_allocator()
+{
+  release_cached();
+}
+
+void* vil_pooled_memory_allocator::allocate(std::size_t n)
+{
+  if (n == 0) return VXL_NULLPTR;
+  std::size_t size;
+  const unsigned index = vil_pool_size_index(n, size);
+  {
+#if VXL_FULLCXX11SUPPORT
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    if (index < free_.size() && !free_[index].empty())
+    {
+      void* p = free_[index].back();
+      free_[index].pop_back();
+      cached_bytes_ -= size;
+      record_allocate(n, true);
+      return p;
+    }
+  }
+  void* p = upstream_->allocate(size);
+  record_allocate(n, false);
+  return p;
+}
+
+void vil_pooled_memory_allocator::deallocate(void* p, std::size_t n)
+{
+  if (!p) return;
+  std::size_t size;
+  const unsigned index = vil_pool_size_index(n, size);
+  record_deallocate(n);
+  {
+#if VXL_FULLCXX11SUPPORT
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    if (2 * size <= max_cached_bytes_)
+    {
+      if (index >= free_.size()) free_.resize(index + 1);
+      free_[index].push_back(p);
+      cached_bytes_ += size;
+      if (cached_bytes_ > max_cached_bytes_)
+        trim(max_cached_bytes_);
+      return;
+    }
+  }
+  upstream_->deallocate(p, size);
+}
+
+void vil_pooled_memory_allocator::trim(std::size_t limit)
+{
+  // Release the largest blocks first; they are the cheapest to get back.
+  for (std::size_t i = free_.size(); i-- > 0 && cached_bytes_ > limit; )
+  {
+    const std::size_t size = vil_pool_class_size(unsigned(i));
+    std::vector<void*>& blocks = free_[i];
+    while (!blocks.empty() && cached_bytes_ > limit)
+    {
+      upstream_->deallocate(blocks.back(), size);
+      blocks.pop_back();
+      cached_bytes_ -= size;
+    }
+  }
+}
+
+vil_memory_allocator_stats vil_pooled_memory_allocator::stats() const
+{
+  vil_memory_allocator_stats s = vil_memory_allocator::stats();
+#if VXL_FULLCXX11SUPPORT
+  std::lock_guard<std::mutex> lock(mutex_);
+#endif
+  s.cached_bytes = cached_bytes_;
+  return s;
+}
+
+std::size_t vil_pooled_memory_allocator::max_cached_bytes() const
+{
+#if VXL_FULLCXX11SUPPORT
+  std::lock_guard<std::mutex> lock(mutex_);
+#endif
+  return max_cached_bytes_;
+}
+
+void vil_pooled_memory_allocator::set_max_cached_bytes(std::size_t n)
+{
+#if VXL_FULLCXX11SUPPORT
+  std::lock_guard<std::mutex> lock(mutex_);
+#endif
+  max_cached_bytes_ = n;
+  trim(n);
+}
+
+void vil_pooled_memory_allocator::release_cached()
+{
+#if VXL_FULLCXX11SUPPORT
+  std::lock_guard<std::mutex> lock(mutex_);
+#endif
+  trim(0);
+}
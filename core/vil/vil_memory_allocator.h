@@ -0,0 +1,186 @@
+// This is core/vil/vil_memory_allocator.h
+#ifndef vil_memory_allocator_h_
+#define vil_memory_allocator_h_
+//:
+// \file
+// \brief Allocators for the pixel buffers held by vil_memory_chunk
+//
+// All image memory allocated by vil_memory_chunk comes from
+// vil_memory_allocator::default_allocator().  Every allocator returns
+// blocks aligned to VIL_MEMORY_ALIGNMENT bytes, so the first pixel of a
+// freshly allocated vil_image_view is always suitably aligned for SIMD
+// loads.
+//
+// The default is a vil_pooled_memory_allocator, which keeps released
+// blocks in size classes and hands them out again, so chains of filters
+// creating temporary images do not repeatedly go back to the system heap.
+// It can be replaced (e.g. by vil_memory_allocator::heap(), which never
+// caches) with vil_memory_allocator::set_default_allocator().
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <cstddef>
+#include <vector>
+#include <vcl_compiler.h>
+#if VXL_FULLCXX11SUPPORT
+# include <atomic>
+# include <mutex>
+#endif
+
+//: Alignment in bytes of all blocks returned by a vil_memory_allocator.
+#define VIL_MEMORY_ALIGNMENT 64
+
+class vil_pooled_memory_allocator;
+
+//: Usage counters of a vil_memory_allocator.
+struct vil_memory_allocator_stats
+{
+  //: Bytes currently handed out to callers
+  std::size_t live_bytes;
+  //: Largest value of live_bytes since the counters were reset
+  std::size_t peak_bytes;
+  //: Bytes held for reuse but not handed out (pooled allocators only)
+  std::size_t cached_bytes;
+  //: Number of allocations since the counters were reset
+  unsigned long n_allocations;
+  //: Number of those allocations served from cached blocks
+  unsigned long n_reused;
+  //: Seconds since the counters were reset
+  double seconds;
+
+  //: Allocations per second since the counters were reset
+  double allocation_rate() const { return seconds > 0 ? n_allocations / seconds : 0.0; }
+};
+
+//: Abstract source of aligned memory blocks for vil_memory_chunk.
+// Implementations must be thread safe.  A block must be released by the
+// allocator which allocated it, passing the size originally requested.
+class vil_memory_allocator
+{
+ public:
+  vil_memory_allocator();
+  virtual ~vil_memory_allocator();
+
+  //: Allocate n bytes, aligned to VIL_MEMORY_ALIGNMENT.
+  // Returns a null pointer when n==0.  Throws std::bad_alloc on failure.
+  virtual void* allocate(std::size_t n) = 0;
+
+  //: Release a block returned by allocate(n).
+  virtual void deallocate(void* p, std::size_t n) = 0;
+
+  //: Current usage counters
+  virtual vil_memory_allocator_stats stats() const;
+
+  //: Zero the allocation count and set the peak to the current usage.
+  void reset_stats();
+
+  //: Allocator used by vil_memory_chunk for new blocks
+  static vil_memory_allocator* default_allocator();
+
+  //: Select the allocator used for subsequently allocated blocks.
+  // Blocks allocated earlier are still released to their own allocator,
+  // which must therefore outlive them.  Passing a null pointer restores
+  // the built-in pool().
+  static void set_default_allocator(vil_memory_allocator* a);
+
+  //: Built-in allocator taking every block straight from the heap
+  static vil_memory_allocator* heap();
+
+  //: Built-in pooled allocator (the initial default)
+  static vil_pooled_memory_allocator* pool();
+
+ protected:
+  //: Update the counters for a successful allocation of n bytes
+  void record_allocate(std::size_t n, bool reused);
+
+  //: Update the counters for a release of n bytes
+  void record_deallocate(std::size_t n);
+
+ private:
+  // Disallow copying
+  vil_memory_allocator(const vil_memory_allocator&);
+  vil_memory_allocator& operator=(const vil_memory_allocator&);
+
+#if VXL_FULLCXX11SUPPORT
+  std::atomic<std::size_t> live_bytes_;
+  std::atomic<std::size_t> peak_bytes_;
+  std::atomic<unsigned long> n_allocations_;
+  std::atomic<unsigned long> n_reused_;
+#else
+  std::size_t live_bytes_;
+  std::size_t peak_bytes_;
+  unsigned long n_allocations_;
+  unsigned long n_reused_;
+#endif
+  double reset_time_;
+};
+
+//: Allocates aligned blocks directly from the system.
+// If huge pages are requested, blocks of 2MB or more are aligned to 2MB
+// and (on Linux) marked as candidates for transparent huge pages, which
+// reduces TLB misses when scanning very large images.
+class vil_aligned_memory_allocator : public vil_memory_allocator
+{
+  bool huge_pages_;
+ public:
+  explicit vil_aligned_memory_allocator(bool huge_pages = false)
+    : huge_pages_(huge_pages) {}
+
+  virtual void* allocate(std::size_t n);
+  virtual void deallocate(void* p, std::size_t n);
+
+  //: True if large blocks are backed by huge pages where possible
+  bool huge_pages() const { return huge_pages_; }
+};
+
+//: Recycles released blocks by size class.
+// Sizes are rounded up to one of four classes per power of two, so a
+// recycled block wastes at most 25% of its size.  Released blocks are kept
+// until the total cached exceeds max_cached_bytes(); beyond that they are
+// returned to the upstream allocator.  Blocks larger than half the cache
+// limit are never cached.
+class vil_pooled_memory_allocator : public vil_memory_allocator
+{
+ public:
+  //: Construct a pool taking its blocks from upstream.
+  // upstream defaults to vil_memory_allocator::heap() and must outlive the pool.
+  explicit vil_pooled_memory_allocator(std::size_t max_cached_bytes = 256u<<20,
+                                       vil_memory_allocator* upstream = VXL_NULLPTR);
+
+  //: Returns all cached blocks to the upstream allocator
+  virtual ~vil_pooled_memory_allocator();
+
+  virtual void* allocate(std::size_t n);
+  virtual void deallocate(void* p, std::size_t n);
+  virtual vil_memory_allocator_stats stats() const;
+
+  //: Upper limit on the bytes kept for reuse
+  std::size_t max_cached_bytes() const;
+
+  //: Change the limit, releasing cached blocks if necessary.
+  void set_max_cached_bytes(std::size_t n);
+
+  //: Return all cached blocks to the upstream allocator.
+  void release_cached();
+
+  //: Size actually reserved for a request of n bytes
+  static std::size_t size_class(std::size_t n);
+
+ private:
+  // Release cached blocks until no more than limit bytes are cached.
+  // Caller must hold the lock.
+  void trim(std::size_t limit);
+
+  vil_memory_allocator* upstream_;
+  std::size_t max_cached_bytes_;
+  std::size_t cached_bytes_;
+  //: Free blocks, indexed by size class number
+  std::vector<std::vector<void*> > free_;
+#if VXL_FULLCXX11SUPPORT
+  mutable std::mutex mutex_;
+#endif
+};
+
+#endif // vil_memory_allocator_h_
@@ -10,14 +10,17 @@
 
 //: Dflt ctor
 vil_memory_chunk::vil_memory_chunk()
-: data_(VXL_NULLPTR), size_(0), pixel_format_(VIL_PIXEL_FORMAT_UNKNOWN), ref_count_(0)
+: data_(VXL_NULLPTR), size_(0), pixel_format_(VIL_PIXEL_FORMAT_UNKNOWN), ref_count_(0),
+  allocator_(vil_memory_allocator::default_allocator())
 {
 }
 
 //: Allocate n bytes of memory
 vil_memory_chunk::vil_memory_chunk(std::size_t n, vil_pixel_format pixel_form)
-: data_(new char[n]), size_(n), pixel_format_(pixel_form), ref_count_(0)
+: data_(VXL_NULLPTR), size_(n), pixel_format_(pixel_form), ref_count_(0),
+  allocator_(vil_memory_allocator::default_allocator())
 {
+  data_ = allocator_->allocate(n);
   assert(vil_pixel_format_num_components(pixel_form)==1
          || pixel_form==VIL_PIXEL_FORMAT_UNKNOWN );
 }
@@ -25,14 +28,16 @@ vil_memory_chunk::vil_memory_chunk(std::size_t n, vil_pixel_format pixel_form)
 //: Destructor
 vil_memory_chunk::~vil_memory_chunk()
 {
-  delete [] reinterpret_cast<char*>(data_);
+  allocator_->deallocate(data_,size_);
 }
 
 //: Copy ctor
 vil_memory_chunk::vil_memory_chunk(const vil_memory_chunk& d)
-: data_(new char[d.size()]), size_(d.size()), pixel_format_(d.pixel_format_), ref_count_(0)
+: data_(VXL_NULLPTR), size_(d.size()), pixel_format_(d.pixel_format_), ref_count_(0),
+  allocator_(vil_memory_allocator::default_allocator())
 {
-  std::memcpy(data_,d.data_,size_);
+  data_ = allocator_->allocate(size_);
+  if (size_>0) std::memcpy(data(),d.const_data(),size_);
 }
 
 //: Assignment operator
@@ -41,7 +46,7 @@ vil_memory_chunk& vil_memory_chunk::operator=(const vil_memory_chunk& d)
   if (this==&d) return *this;
 
   set_size(d.size(),d.pixel_format());
-  std::memcpy(data_,d.data_,size_);
+  if (size_>0) std::memcpy(data(),d.const_data(),size_);
   return *this;
 }
 
@@ -54,7 +59,7 @@ void vil_memory_chunk::unref()
   // lead to multiple smart pointers deleting the memory.
   if (--ref_count_==0)
   {
-    delete [] reinterpret_cast<char*>(data_); data_=VXL_NULLPTR;
+    allocator_->deallocate(data_,size_); data_=VXL_NULLPTR; size_=0;
     delete this;
   }
 }
@@ -70,10 +75,12 @@ void* vil_memory_chunk::const_data() const { return data_;}
 void vil_memory_chunk::set_size(unsigned long n, vil_pixel_format pixel_form)
 {
   if (size_==n) return;
-  delete [] reinterpret_cast<char*>(data_);
+  allocator_->deallocate(data_,size_);
   data_ = VXL_NULLPTR;
+  size_ = 0;
+  allocator_ = vil_memory_allocator::default_allocator();
   if (n>0)
-    data_ = new char[n];
+    data_ = allocator_->allocate(n);
   size_ = n;
   pixel_format_ = pixel_form;
 }
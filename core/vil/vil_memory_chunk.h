@@ -5,12 +5,16 @@
 //  \file
 //  \brief Ref. counted block of data on the heap
 //  \author Tim Cootes
+//
+//  The data are obtained from vil_memory_allocator::default_allocator(),
+//  so are aligned to VIL_MEMORY_ALIGNMENT bytes.
 
 #include <cstddef>
 #include <vcl_atomic_count.h>
 #include <vcl_compiler.h>
 #include <vil/vil_smart_ptr.h>
 #include <vil/vil_pixel_format.h>
+#include <vil/vil_memory_allocator.h>
 
 //: Ref. counted block of data on the heap.
 //  Image data block used by vil_image_view<T>.
@@ -30,6 +34,9 @@ class vil_memory_chunk
     //: Reference count
     vcl_atomic_count ref_count_;
 
+    //: Allocator which provided data_
+    vil_memory_allocator* allocator_;
+
  public:
     //: Dflt ctor
     vil_memory_chunk();
@@ -0,0 +1,162 @@
+// This is core/vil/vil_mmap_memory_chunk.cxx
+//:
+// \file
+
+#include "vil_mmap_memory_chunk.h"
+#include <vil/vil_image_view.h>
+#include <vil/vil_pixel_format.h>
+#include <vxl_config.h>
+#ifdef VCL_WIN32
+# include <windows.h>
+#else
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+vil_mmap_memory_chunk::vil_mmap_memory_chunk(char const* filename,
+                                             vil_streampos offset, vil_streampos n)
+: map_base_(VXL_NULLPTR), map_length_(0), begin_(VXL_NULLPTR)
+{
+  if (offset < 0 || n < 0) return;
+#ifdef VCL_WIN32
+  HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, VXL_NULLPTR,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, VXL_NULLPTR);
+  if (file == INVALID_HANDLE_VALUE) return;
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size)) { CloseHandle(file); return; }
+  vil_streampos fsize = file_size.QuadPart;
+  if (n == 0) n = fsize - offset;
+  if (n <= 0 || offset + n > fsize || vil_streampos(std::size_t(n)) != n)
+  { CloseHandle(file); return; }
+  HANDLE mapping = CreateFileMappingA(file, VXL_NULLPTR, PAGE_WRITECOPY, 0, 0, VXL_NULLPTR);
+  CloseHandle(file);
+  if (!mapping) return;
+  SYSTEM_INFO si;
+  GetSystemInfo(&si);
+  const vil_streampos map_offset = offset - offset % si.dwAllocationGranularity;
+  map_length_ = std::size_t(n + (offset - map_offset));
+  map_base_ = MapViewOfFile(mapping, FILE_MAP_COPY,
+                            DWORD(map_offset >> 32), DWORD(map_offset & 0xffffffff),
+                            map_length_);
+  CloseHandle(mapping); // the view keeps the mapping alive
+  if (!map_base_) return;
+#else
+  int fd = ::open(filename, O_RDONLY);
+  if (fd < 0) return;
+  struct stat st;
+  if (::fstat(fd, &st) != 0) { ::close(fd); return; }
+  const vil_streampos fsize = st.st_size;
+  if (n == 0) n = fsize - offset;
+  if (n <= 0 || offset + n > fsize || vil_streampos(std::size_t(n)) != n)
+  { ::close(fd); return; }
+  const long page = ::sysconf(_SC_PAGESIZE);
+  const vil_streampos map_offset = offset - offset % page;
+  map_length_ = std::size_t(n + (offset - map_offset));
+  // A private writable mapping: writes through views never reach the file.
+  void* p = ::mmap(VXL_NULLPTR, map_length_, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                   fd, off_t(map_offset));
+  ::close(fd); // the mapping keeps the file open
+  if (p == MAP_FAILED) { map_length_ = 0; return; }
+  map_base_ = p;
+#endif
+  begin_ = static_cast<char*>(map_base_) + (offset - map_offset);
+  size_ = std::size_t(n);
+  pixel_format_ = VIL_PIXEL_FORMAT_BYTE;
+}
+
+void vil_mmap_memory_chunk::unmap()
+{
+  if (map_base_)
+  {
+#ifdef VCL_WIN32
+    UnmapViewOfFile(map_base_);
+#else
+    ::munmap(map_base_, map_length_);
+#endif
+  }
+  map_base_ = VXL_NULLPTR;
+  map_length_ = 0;
+  begin_ = VXL_NULLPTR;
+  size_ = 0;
+}
+
+vil_mmap_memory_chunk::~vil_mmap_memory_chunk()
+{
+  unmap();
+}
+
+void* vil_mmap_memory_chunk::data() { return begin_ ? begin_ : data_; }
+
+void* vil_mmap_memory_chunk::const_data() const { return begin_ ? begin_ : data_; }
+
+void vil_mmap_memory_chunk::set_size(unsigned long n, vil_pixel_format pixel_format)
+{
+  if (size_ == n) return;
+  if (begin_) unmap();
+  vil_memory_chunk::set_size(n, pixel_format);
+}
+
+//=======================================================================
+
+template <class T>
+static vil_image_view_base_sptr vil_mmap_image_view(vil_memory_chunk_sptr const& chunk,
+                                                    std::size_t byte_offset,
+                                                    unsigned ni, unsigned nj, unsigned nplanes,
+                                                    std::ptrdiff_t istep, std::ptrdiff_t jstep,
+                                                    std::ptrdiff_t planestep, T*)
+{
+  char* base = static_cast<char*>(chunk->data());
+  if (!base || byte_offset % sizeof(T) != 0 ||
+      reinterpret_cast<std::size_t>(base) % sizeof(T) != 0)
+    return VXL_NULLPTR;
+  T* top_left = reinterpret_cast<T*>(base + byte_offset);
+  if (ni > 0 && nj > 0 && nplanes > 0)
+  {
+    // Check the first and last pixel components lie within the chunk
+    std::ptrdiff_t lo = 0, hi = 0;
+    const std::ptrdiff_t steps[3] = { istep, jstep, planestep };
+    const unsigned n[3] = { ni, nj, nplanes };
+    for (unsigned k = 0; k < 3; ++k)
+      (steps[k] < 0 ? lo : hi) += steps[k] * std::ptrdiff_t(n[k] - 1);
+    const std::ptrdiff_t first = std::ptrdiff_t(byte_offset / sizeof(T)) + lo;
+    const std::ptrdiff_t last = std::ptrdiff_t(byte_offset / sizeof(T)) + hi;
+    if (first < 0 || std::size_t(last + 1) * sizeof(T) > chunk->size())
+      return VXL_NULLPTR;
+  }
+  return new vil_image_view<T>(chunk, top_left, ni, nj, nplanes, istep, jstep, planestep);
+}
+
+vil_image_view_base_sptr vil_mmap_image_view(vil_memory_chunk_sptr const& chunk,
+                                             std::size_t byte_offset,
+                                             vil_pixel_format format,
+                                             unsigned ni, unsigned nj, unsigned nplanes,
+                                             std::ptrdiff_t istep, std::ptrdiff_t jstep,
+                                             std::ptrdiff_t planestep)
+{
+  if (!chunk) return VXL_NULLPTR;
+  switch (vil_pixel_format_component_format(format))
+  {
+#define macro( F , T ) \
+   case F: \
+    return vil_mmap_image_view(chunk, byte_offset, ni, nj, nplanes, \
+                               istep, jstep, planestep, static_cast<T*>(VXL_NULLPTR));
+#if VXL_HAS_INT_64
+    macro(VIL_PIXEL_FORMAT_UINT_64, vxl_uint_64 )
+    macro(VIL_PIXEL_FORMAT_INT_64, vxl_int_64 )
+#endif
+    macro(VIL_PIXEL_FORMAT_UINT_32, vxl_uint_32 )
+    macro(VIL_PIXEL_FORMAT_INT_32, vxl_int_32 )
+    macro(VIL_PIXEL_FORMAT_UINT_16, vxl_uint_16 )
+    macro(VIL_PIXEL_FORMAT_INT_16, vxl_int_16 )
+    macro(VIL_PIXEL_FORMAT_BYTE, vxl_byte )
+    macro(VIL_PIXEL_FORMAT_SBYTE, vxl_sbyte )
+    macro(VIL_PIXEL_FORMAT_FLOAT, float )
+    macro(VIL_PIXEL_FORMAT_DOUBLE, double )
+#undef macro
+   default:
+    return VXL_NULLPTR;
+  }
+}
@@ -0,0 +1,80 @@
+// This is core/vil/vil_mmap_memory_chunk.h
+#ifndef vil_mmap_memory_chunk_h_
+#define vil_mmap_memory_chunk_h_
+//:
+// \file
+// \brief A vil_memory_chunk holding a memory mapped section of a file
+//
+// Image views can point straight into the mapped pages, so pixels are
+// only read from disk when they are first touched, and views of large
+// files cost no copying.  The file is mapped copy-on-write: writing to a
+// view modifies a private copy of the affected pages, never the file.
+//
+// The mapping stays valid for as long as any view refers to the chunk.
+// The file must not be truncated while it is mapped; on most systems
+// reading a page beyond the new end of file raises a bus error.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <cstddef>
+#include <vcl_compiler.h>
+#include <vil/vil_memory_chunk.h>
+#include <vil/vil_image_view_base.h>
+#include <vil/vil_stream.h>
+
+//: Ref. counted, memory mapped section of a file
+class vil_mmap_memory_chunk : public vil_memory_chunk
+{
+  //: Start of the mapped pages
+  void* map_base_;
+  //: Length of the mapped pages
+  std::size_t map_length_;
+  //: First byte of the requested section
+  char* begin_;
+
+  void unmap();
+
+  // Mappings cannot be copied
+  vil_mmap_memory_chunk(const vil_mmap_memory_chunk&);
+  vil_mmap_memory_chunk& operator=(const vil_mmap_memory_chunk&);
+
+ public:
+  //: Map n bytes of a file starting at offset, read-only.
+  // If n is zero, everything from offset to the end of the file is mapped.
+  // Check is_mapped() for success.
+  vil_mmap_memory_chunk(char const* filename,
+                        vil_streampos offset = 0, vil_streampos n = 0);
+
+  //: Unmaps the file
+  virtual ~vil_mmap_memory_chunk();
+
+  //: True if the file was successfully mapped
+  bool is_mapped() const { return begin_ != VXL_NULLPTR; }
+
+  //: Pointer to first byte of the mapped section
+  virtual void* data();
+
+  //: Pointer to first byte of the mapped section
+  virtual void* const_data() const;
+
+  //: Create space for n bytes.
+  // Unless n is the current size, this releases the mapping and allocates
+  // ordinary memory instead.
+  virtual void set_size(unsigned long n, vil_pixel_format pixel_format);
+};
+
+//: A view of pixels stored in a chunk, starting byte_offset bytes into it.
+// Returns a null pointer if the format is not a scalar pixel type, if the
+// pixels would not be suitably aligned, or if the view would extend beyond
+// the end of the chunk.  The steps are in units of pixel components.
+// \relatesalso vil_mmap_memory_chunk
+vil_image_view_base_sptr vil_mmap_image_view(vil_memory_chunk_sptr const& chunk,
+                                             std::size_t byte_offset,
+                                             vil_pixel_format format,
+                                             unsigned ni, unsigned nj, unsigned nplanes,
+                                             std::ptrdiff_t istep, std::ptrdiff_t jstep,
+                                             std::ptrdiff_t planestep);
+
+#endif // vil_mmap_memory_chunk_h_
@@ -19,6 +19,7 @@
 #include <vil/vil_memory_image.h>
 #include <vil/vil_blocked_image_facade.h>
 #include <vil/vil_cached_image_resource.h>
+#include <vil/vil_prefetching_image_resource.h>
 #include <vil/vil_pyramid_image_resource.h>
 #include <vil/file_formats/vil_pyramid_image_list.h>
 // The first two functions really should be upgraded to create an image in
@@ -197,17 +198,28 @@ vil_new_blocked_image_resource(char const* filename, unsigned ni, unsigned nj,
 
 vil_blocked_image_resource_sptr
 vil_new_blocked_image_facade(const vil_image_resource_sptr& src,
-                             unsigned size_block_i, unsigned size_block_j)
+                             unsigned size_block_i, unsigned size_block_j,
+                             std::size_t cache_bytes)
 {
-  return new vil_blocked_image_facade(src, size_block_i, size_block_j);
+  return new vil_blocked_image_facade(src, size_block_i, size_block_j, cache_bytes);
 }
 
 
 vil_blocked_image_resource_sptr
 vil_new_cached_image_resource(const vil_blocked_image_resource_sptr& bir,
-                              const unsigned cache_size)
+                              const unsigned cache_size,
+                              const std::size_t max_bytes)
 {
-  return new vil_cached_image_resource(bir, cache_size);
+  return new vil_cached_image_resource(bir, cache_size, max_bytes);
+}
+
+vil_blocked_image_resource_sptr
+vil_new_prefetching_image_resource(const vil_blocked_image_resource_sptr& bir,
+                                   const unsigned queue_depth,
+                                   const unsigned n_threads,
+                                   const std::size_t cache_bytes)
+{
+  return new vil_prefetching_image_resource(bir, queue_depth, n_threads, cache_bytes);
 }
 
 vil_pyramid_image_resource_sptr
@@ -23,6 +23,7 @@
 //   30 Mar 2007 Peter Vanroose- Removed deprecated vil_new_image_view_j_i_plane
 // \endverbatim
 
+#include <cstddef>
 #include <vil/vil_fwd.h>
 #include <vil/vil_image_resource.h>
 #include <vil/vil_blocked_image_resource.h>
@@ -108,15 +109,29 @@ vil_new_blocked_image_resource(char const* filename, unsigned ni, unsigned nj,
                                char const* file_format = 0);
 
 //: create a blocked interface around any image resource
-// For zero size blocks, appropriate default blocking is created
+// For zero size blocks, appropriate default blocking is created.
+// If cache_bytes is non-zero, up to that many bytes of blocks are cached.
 vil_blocked_image_resource_sptr
 vil_new_blocked_image_facade(const vil_image_resource_sptr& src,
                              const unsigned size_block_i=0,
-                             const unsigned size_block_j=0);
+                             const unsigned size_block_j=0,
+                             const std::size_t cache_bytes=0);
 //: Make a new cached resource
+// At most cache_size blocks are cached, and if max_bytes is non-zero, at
+// most max_bytes bytes of blocks.
 vil_blocked_image_resource_sptr
 vil_new_cached_image_resource(const vil_blocked_image_resource_sptr& bir,
-                              const unsigned cache_size = 100);
+                              const unsigned cache_size = 100,
+                              const std::size_t max_bytes = 0);
+
+//: Make a resource which decodes the blocks of bir ahead of their use
+// Up to queue_depth blocks are decoded by n_threads background threads.
+// \sa vil_prefetching_image_resource
+vil_blocked_image_resource_sptr
+vil_new_prefetching_image_resource(const vil_blocked_image_resource_sptr& bir,
+                                   const unsigned queue_depth = 8,
+                                   const unsigned n_threads = 1,
+                                   const std::size_t cache_bytes = 0);
 
 
 //: Make a new pyramid image resource for writing.
@@ -0,0 +1,98 @@
+// This is core/vil/vil_parallel_for.h
+#ifndef vil_parallel_for_h_
+#define vil_parallel_for_h_
+//:
+// \file
+// \brief Split a loop over an index range across several threads
+//
+// vil_parallel_for(begin, end, f) calls f(b,e) on contiguous, disjoint
+// sub-ranges [b,e) which together cover [begin,end).  The sub-ranges are
+// processed concurrently when the compiler supports C++11 threads and
+// vil_parallel::max_threads() is larger than one; otherwise f(begin,end)
+// is simply called on the current thread.
+//
+// The split only depends on the length of the range, the grain size and
+// the number of threads, so a filter whose per-pixel work does not
+// depend on the sub-range boundaries gives identical results whatever
+// the thread count.
+//
+// The sub-ranges run on a pool of threads which is started on first use
+// and kept until the program exits.  Calls made from inside a worker run
+// serially.  vil keeps its own pool and settings (vil does not depend on
+// vnl), so vil_parallel::set_max_threads() does not affect
+// vnl_parallel_for, and a vil loop inside a vnl_parallel_for worker is
+// not recognised as nested.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <vcl_compiler.h>
+
+//: Global settings for vil's multithreaded routines.
+class vil_parallel
+{
+ public:
+  //: Maximum number of threads used by vil_parallel_for.
+  // Defaults to the number of hardware threads.
+  static unsigned max_threads();
+
+  //: Set the maximum number of threads; 1 disables multithreading.
+  // A value of 0 restores the default.
+  static void set_max_threads(unsigned n);
+
+  //: True when called from a sub-range of an enclosing vil_parallel_for.
+  static bool in_parallel_region();
+
+  //: Mark the current thread as running inside vil_parallel_for (internal use).
+  static void enter_region();
+
+  //: Undo enter_region() (internal use).
+  static void leave_region();
+
+  //: Call task(data,c) for c in [0,n_tasks), on the pool threads and the calling thread (internal use).
+  // Returns when all the calls have returned.
+  static void run(unsigned n_tasks, void (*task)(void*, unsigned), void* data);
+};
+
+//: The sub-ranges of a vil_parallel_for call, handed to vil_parallel::run()
+template <class F>
+struct vil_parallel_for_ranges
+{
+  F const* f;
+  unsigned begin, n, n_chunks;
+
+  //: Call f on sub-range \p chunk
+  static void run(void* ranges, unsigned chunk)
+  {
+    vil_parallel_for_ranges const& r = *static_cast<vil_parallel_for_ranges const*>(ranges);
+    const unsigned size = r.n / r.n_chunks, extra = r.n % r.n_chunks;
+    const unsigned b = r.begin + chunk*size + (chunk < extra ? chunk : extra);
+    (*r.f)(b, b + size + (chunk < extra ? 1u : 0u));
+  }
+};
+
+//: Call f(b,e) on sub-ranges of [begin,end), possibly concurrently.
+// Each sub-range contains at least \p grain indices (apart from when the
+// whole range is smaller).  \p f must be callable as a const object and
+// must not throw.
+template <class F>
+void vil_parallel_for(unsigned begin, unsigned end, F const& f, unsigned grain = 1)
+{
+  if (end <= begin)
+    return;
+  const unsigned n = end - begin;
+  if (grain == 0)
+    grain = 1;
+  unsigned n_chunks = vil_parallel::in_parallel_region() ? 1u : vil_parallel::max_threads();
+  if (n_chunks > n / grain)
+    n_chunks = n / grain;
+  if (n_chunks <= 1) {
+    f(begin, end);
+    return;
+  }
+  vil_parallel_for_ranges<F> ranges = { &f, begin, n, n_chunks };
+  vil_parallel::run(n_chunks, &vil_parallel_for_ranges<F>::run, &ranges);
+}
+
+#endif // vil_parallel_for_h_
@@ -0,0 +1,367 @@
+// This is core/vil/vil_prefetching_image_resource.cxx
+//:
+// \file
+
+#include <deque>
+#include <map>
+#include <set>
+#include "vil_prefetching_image_resource.h"
+#include <vil/vil_image_view_base.h>
+#if VXL_FULLCXX11SUPPORT
+# include <thread>
+# include <mutex>
+# include <condition_variable>
+#endif
+
+typedef std::pair<unsigned, unsigned> vil_prefetch_key;
+
+//: Everything shared with the background threads
+struct vil_prefetching_image_resource_state
+{
+  vil_prefetching_image_resource_state()
+  : stop(false), pattern(vil_prefetching_image_resource::AUTO),
+    detected(vil_prefetching_image_resource::AUTO),
+    have_last(false), last_i(0), last_j(0), generation(0), n_prefetched(0) {}
+
+  bool stop;
+  //: pattern requested by the user
+  vil_prefetching_image_resource::access_pattern pattern;
+  //: pattern detected from the requests, when pattern is AUTO
+  vil_prefetching_image_resource::access_pattern detected;
+  bool have_last;
+  unsigned last_i, last_j;
+  //: incremented whenever the image is written, to discard stale decodes
+  unsigned long generation;
+  unsigned long n_prefetched;
+  std::deque<vil_prefetch_key> queue;
+  std::set<vil_prefetch_key> queued;
+  std::set<vil_prefetch_key> in_flight;
+  std::vector<vil_prefetch_key> list;
+  std::map<vil_prefetch_key, std::size_t> list_pos;
+#if VXL_FULLCXX11SUPPORT
+  std::mutex mutex;
+  //: signalled when work is queued, or on shutdown
+  std::condition_variable work;
+  //: signalled when a block has been decoded
+  std::condition_variable done;
+  //: serializes calls to a source which is not thread safe
+  std::mutex source_mutex;
+  std::vector<std::thread> threads;
+#endif
+};
+
+#if VXL_FULLCXX11SUPPORT
+# define VIL_PREFETCH_LOCK std::unique_lock<std::mutex> lock(state_->mutex)
+#else
+# define VIL_PREFETCH_LOCK
+#endif
+
+vil_prefetching_image_resource::
+vil_prefetching_image_resource(vil_blocked_image_resource_sptr const& bir,
+                               unsigned queue_depth, unsigned n_threads,
+                               std::size_t cache_bytes, bool thread_safe_source)
+: bir_(bir),
+  cache_(cache_bytes > 0 ? 0u : 4*queue_depth + 16, cache_bytes),
+  queue_depth_(queue_depth), thread_safe_source_(thread_safe_source),
+  state_(new vil_prefetching_image_resource_state)
+{
+#if VXL_FULLCXX11SUPPORT
+  if (queue_depth_ > 0)
+    for (unsigned t = 0; t < n_threads; ++t)
+      state_->threads.push_back(std::thread(&vil_prefetching_image_resource::worker, this));
+#else
+  (void)n_threads;
+#endif
+}
+
+vil_prefetching_image_resource::~vil_prefetching_image_resource()
+{
+#if VXL_FULLCXX11SUPPORT
+  {
+    VIL_PREFETCH_LOCK;
+    state_->stop = true;
+  }
+  state_->work.notify_all();
+  for (unsigned t = 0; t < state_->threads.size(); ++t)
+    state_->threads[t].join();
+#endif
+  delete state_;
+}
+
+vil_image_view_base_sptr
+vil_prefetching_image_resource::read_block(unsigned bi, unsigned bj) const
+{
+#if VXL_FULLCXX11SUPPORT
+  if (!thread_safe_source_)
+  {
+    std::lock_guard<std::mutex> source_lock(state_->source_mutex);
+    return bir_->get_block(bi, bj);
+  }
+#endif
+  return bir_->get_block(bi, bj);
+}
+
+bool vil_prefetching_image_resource::enqueue(unsigned bi, unsigned bj) const
+{
+  if (state_->queue.size() + state_->in_flight.size() >= queue_depth_)
+    return false;
+  const vil_prefetch_key key(bi, bj);
+  if (state_->queued.count(key) || state_->in_flight.count(key))
+    return true;
+  if (cache_.contains(bi, bj))
+    return true;
+  state_->queue.push_back(key);
+  state_->queued.insert(key);
+  return true;
+}
+
+void vil_prefetching_image_resource::schedule(unsigned bi, unsigned bj) const
+{
+  vil_prefetching_image_resource_state& s = *state_;
+  const unsigned nbi = n_block_i(), nbj = n_block_j();
+
+  // Work out the pattern from consecutive requests
+  if (s.pattern == AUTO && s.have_last)
+  {
+    if ((bj == s.last_j && bi == s.last_i+1) || (bi == 0 && bj == s.last_j+1 && s.last_i+1 == nbi))
+      s.detected = RASTER;
+    else if ((bi == s.last_i && bj == s.last_j+1) || (bj == 0 && bi == s.last_i+1 && s.last_j+1 == nbj))
+      s.detected = COLUMN;
+  }
+  s.have_last = true;
+  s.last_i = bi;
+  s.last_j = bj;
+
+  const access_pattern p = s.pattern == AUTO ? s.detected : s.pattern;
+  if (p == RASTER)
+  {
+    for (unsigned long k = (unsigned long)bj*nbi + bi + 1;
+         k < (unsigned long)nbi*nbj && enqueue(unsigned(k % nbi), unsigned(k / nbi)); ++k)
+      if (k >= (unsigned long)bj*nbi + bi + queue_depth_) break;
+  }
+  else if (p == COLUMN)
+  {
+    for (unsigned long k = (unsigned long)bi*nbj + bj + 1;
+         k < (unsigned long)nbi*nbj && enqueue(unsigned(k / nbj), unsigned(k % nbj)); ++k)
+      if (k >= (unsigned long)bi*nbj + bj + queue_depth_) break;
+  }
+  else if (p == LIST)
+  {
+    std::map<vil_prefetch_key, std::size_t>::const_iterator it = s.list_pos.find(vil_prefetch_key(bi, bj));
+    if (it != s.list_pos.end())
+      for (std::size_t k = it->second + 1;
+           k < s.list.size() && k <= it->second + queue_depth_ &&
+           enqueue(s.list[k].first, s.list[k].second); ++k) {}
+  }
+#if VXL_FULLCXX11SUPPORT
+  if (!s.queue.empty())
+    s.work.notify_all();
+#endif
+}
+
+vil_image_view_base_sptr
+vil_prefetching_image_resource::get_block(unsigned block_index_i,
+                                          unsigned block_index_j) const
+{
+  if (block_index_i >= n_block_i() || block_index_j >= n_block_j())
+    return VXL_NULLPTR;
+  const vil_prefetch_key key(block_index_i, block_index_j);
+  vil_image_view_base_sptr blk;
+  unsigned long generation;
+  {
+    VIL_PREFETCH_LOCK;
+#if VXL_FULLCXX11SUPPORT
+    // If a background thread is decoding this block, wait for it
+    while (state_->in_flight.count(key))
+      state_->done.wait(lock);
+#endif
+    const bool hit = cache_.get_block(block_index_i, block_index_j, blk);
+    if (!hit && state_->queued.erase(key))
+    {
+      // decode it here rather than waiting for a background thread
+      for (std::deque<vil_prefetch_key>::iterator q = state_->queue.begin();
+           q != state_->queue.end(); ++q)
+        if (*q == key) { state_->queue.erase(q); break; }
+    }
+    if (!hit)
+      state_->in_flight.insert(key);
+    schedule(block_index_i, block_index_j);
+    if (hit)
+      return blk;
+    generation = state_->generation;
+  }
+  blk = read_block(block_index_i, block_index_j);
+  {
+    VIL_PREFETCH_LOCK;
+    if (blk && generation == state_->generation)
+      cache_.add_block(block_index_i, block_index_j, blk);
+    state_->in_flight.erase(key);
+  }
+#if VXL_FULLCXX11SUPPORT
+  state_->done.notify_all();
+#endif
+  return blk;
+}
+
+void vil_prefetching_image_resource::worker() const
+{
+#if VXL_FULLCXX11SUPPORT
+  vil_prefetching_image_resource_state& s = *state_;
+  std::unique_lock<std::mutex> lock(s.mutex);
+  for (;;)
+  {
+    while (!s.stop && s.queue.empty())
+      s.work.wait(lock);
+    if (s.stop)
+      return;
+    const vil_prefetch_key key = s.queue.front();
+    s.queue.pop_front();
+    s.queued.erase(key);
+    s.in_flight.insert(key);
+    const unsigned long generation = s.generation;
+    lock.unlock();
+    vil_image_view_base_sptr blk = read_block(key.first, key.second);
+    lock.lock();
+    if (blk && generation == s.generation)
+    {
+      cache_.add_block(key.first, key.second, blk);
+      ++s.n_prefetched;
+    }
+    s.in_flight.erase(key);
+    s.done.notify_all();
+  }
+#endif
+}
+
+bool vil_prefetching_image_resource::
+get_blocks(unsigned start_block_i, unsigned end_block_i,
+           unsigned start_block_j, unsigned end_block_j,
+           std::vector< std::vector< vil_image_view_base_sptr > >& blocks) const
+{
+  if (end_block_i < start_block_i || end_block_j < start_block_j)
+    return false;
+  // Prefetch the range in raster order, then collect the blocks in the
+  // same order so that they are decoded in sequence.
+  std::vector<vil_prefetch_key> order;
+  for (unsigned bj = start_block_j; bj <= end_block_j; ++bj)
+    for (unsigned bi = start_block_i; bi <= end_block_i; ++bi)
+      order.push_back(vil_prefetch_key(bi, bj));
+  access_pattern saved_pattern;
+  std::vector<vil_prefetch_key> saved_list;
+  {
+    VIL_PREFETCH_LOCK;
+    saved_pattern = state_->pattern;
+    saved_list.swap(state_->list);
+    state_->pattern = LIST;
+    state_->list = order;
+    state_->list_pos.clear();
+    for (std::size_t k = 0; k < order.size(); ++k)
+      state_->list_pos[order[k]] = k;
+  }
+  std::vector< std::vector< vil_image_view_base_sptr > >
+    result(end_block_i - start_block_i + 1,
+           std::vector< vil_image_view_base_sptr >(end_block_j - start_block_j + 1));
+  bool ok = true;
+  for (std::size_t k = 0; k < order.size() && ok; ++k)
+  {
+    vil_image_view_base_sptr view = get_block(order[k].first, order[k].second);
+    result[order[k].first - start_block_i][order[k].second - start_block_j] = view;
+    ok = !!view;
+  }
+  {
+    VIL_PREFETCH_LOCK;
+    state_->pattern = saved_pattern;
+    state_->list.swap(saved_list);
+    state_->list_pos.clear();
+    for (std::size_t k = 0; k < state_->list.size(); ++k)
+      state_->list_pos[state_->list[k]] = k;
+  }
+  if (ok)
+    blocks.insert(blocks.end(), result.begin(), result.end());
+  return ok;
+}
+
+void vil_prefetching_image_resource::invalidate(unsigned bi0, unsigned bi1,
+                                                unsigned bj0, unsigned bj1)
+{
+  VIL_PREFETCH_LOCK;
+  ++state_->generation;
+  for (unsigned bj = bj0; bj <= bj1; ++bj)
+    for (unsigned bi = bi0; bi <= bi1; ++bi)
+      cache_.remove_block(bi, bj);
+}
+
+bool vil_prefetching_image_resource::put_block(unsigned block_index_i,
+                                               unsigned block_index_j,
+                                               const vil_image_view_base& view)
+{
+  bool result;
+  {
+#if VXL_FULLCXX11SUPPORT
+    std::unique_lock<std::mutex> source_lock(state_->source_mutex, std::defer_lock);
+    if (!thread_safe_source_) source_lock.lock();
+#endif
+    result = bir_->put_block(block_index_i, block_index_j, view);
+  }
+  invalidate(block_index_i, block_index_i, block_index_j, block_index_j);
+  return result;
+}
+
+bool vil_prefetching_image_resource::put_view(const vil_image_view_base& im,
+                                              unsigned i0, unsigned j0)
+{
+  bool result;
+  {
+#if VXL_FULLCXX11SUPPORT
+    std::unique_lock<std::mutex> source_lock(state_->source_mutex, std::defer_lock);
+    if (!thread_safe_source_) source_lock.lock();
+#endif
+    result = bir_->put_view(im, i0, j0);
+  }
+  const unsigned sbi = size_block_i(), sbj = size_block_j();
+  if (sbi > 0 && sbj > 0 && im.ni() > 0 && im.nj() > 0)
+    invalidate(i0/sbi, (i0+im.ni()-1)/sbi, j0/sbj, (j0+im.nj()-1)/sbj);
+  return result;
+}
+
+void vil_prefetching_image_resource::set_access_pattern(access_pattern p)
+{
+  VIL_PREFETCH_LOCK;
+  state_->pattern = p;
+  state_->detected = AUTO;
+  state_->queue.clear();
+  state_->queued.clear();
+}
+
+vil_prefetching_image_resource::access_pattern
+vil_prefetching_image_resource::get_access_pattern() const
+{
+  VIL_PREFETCH_LOCK;
+  return state_->pattern == AUTO ? state_->detected : state_->pattern;
+}
+
+void vil_prefetching_image_resource::
+set_prefetch_list(std::vector<std::pair<unsigned, unsigned> > const& blocks)
+{
+  VIL_PREFETCH_LOCK;
+  state_->pattern = LIST;
+  state_->queue.clear();
+  state_->queued.clear();
+  state_->list = blocks;
+  state_->list_pos.clear();
+  for (std::size_t k = 0; k < blocks.size(); ++k)
+    if (!state_->list_pos.count(blocks[k]))
+      state_->list_pos[blocks[k]] = k;
+  // Start on the head of the list straight away
+  for (std::size_t k = 0; k < blocks.size() && k < queue_depth_ &&
+       enqueue(blocks[k].first, blocks[k].second); ++k) {}
+#if VXL_FULLCXX11SUPPORT
+  state_->work.notify_all();
+#endif
+}
+
+unsigned long vil_prefetching_image_resource::n_prefetched() const
+{
+  VIL_PREFETCH_LOCK;
+  return state_->n_prefetched;
+}
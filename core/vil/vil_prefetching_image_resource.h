@@ -0,0 +1,129 @@
+// This is core/vil/vil_prefetching_image_resource.h
+#ifndef vil_prefetching_image_resource_h_
+#define vil_prefetching_image_resource_h_
+//:
+// \file
+// \brief A blocked resource which decodes upcoming blocks in the background
+//
+// Wraps a blocked resource (e.g. a tiled tiff or nitf image) and, each time
+// a block is requested, predicts which blocks will be wanted next and
+// decodes them on background threads into a vil_block_cache.  When the
+// consumer asks for a predicted block it is usually already decoded, so
+// decoding overlaps with the consumer's own processing.
+//
+// The prediction follows the access pattern: raster order (along rows of
+// blocks), column order, or an explicit list of blocks given with
+// set_prefetch_list().  By default the pattern is detected from
+// consecutive requests.  get_blocks() prefetches the whole requested
+// range.  At most queue_depth blocks are queued or being decoded at once.
+//
+// Unless the wrapped resource is declared thread safe, calls to it are
+// serialized, so a single background thread is then most useful.  Without
+// C++11 thread support no background decoding is done and the resource
+// simply caches blocks.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <vcl_compiler.h>
+#include <vil/vil_blocked_image_resource.h>
+#include <vil/vil_block_cache.h>
+
+struct vil_prefetching_image_resource_state;
+
+class vil_prefetching_image_resource : public vil_blocked_image_resource
+{
+ public:
+  //: How the blocks to prefetch are predicted
+  enum access_pattern { AUTO, RASTER, COLUMN, LIST };
+
+  //: Wrap bir.
+  // \param queue_depth  maximum number of blocks queued or being prefetched
+  // \param n_threads  number of background decoding threads
+  // \param cache_bytes  byte budget of the block cache (0: limited to a few
+  //                     times queue_depth blocks only)
+  // \param thread_safe_source  true if bir->get_block() may be called concurrently
+  vil_prefetching_image_resource(vil_blocked_image_resource_sptr const& bir,
+                                 unsigned queue_depth = 8, unsigned n_threads = 1,
+                                 std::size_t cache_bytes = 0,
+                                 bool thread_safe_source = false);
+
+  //: Stops the background threads
+  virtual ~vil_prefetching_image_resource();
+
+  virtual unsigned nplanes() const { return bir_->nplanes(); }
+  virtual unsigned ni() const { return bir_->ni(); }
+  virtual unsigned nj() const { return bir_->nj(); }
+  virtual unsigned size_block_i() const { return bir_->size_block_i(); }
+  virtual unsigned size_block_j() const { return bir_->size_block_j(); }
+  virtual unsigned n_block_i() const { return bir_->n_block_i(); }
+  virtual unsigned n_block_j() const { return bir_->n_block_j(); }
+  virtual enum vil_pixel_format pixel_format() const { return bir_->pixel_format(); }
+  virtual bool get_property(char const* tag, void* property_value = VXL_NULLPTR) const
+  { return bir_->get_property(tag, property_value); }
+
+  //: Block access; also schedules the predicted next blocks
+  virtual vil_image_view_base_sptr get_block(unsigned block_index_i,
+                                             unsigned block_index_j) const;
+
+  //: the multiple blocks are in col row order, i.e. blocks[i][j]
+  // The whole range is prefetched in raster order.
+  virtual bool get_blocks(unsigned start_block_i, unsigned end_block_i,
+                          unsigned start_block_j, unsigned end_block_j,
+                          std::vector< std::vector< vil_image_view_base_sptr > >& blocks) const;
+
+  //: put the block into the resource, discarding any prefetched copy
+  virtual bool put_block(unsigned block_index_i, unsigned block_index_j,
+                         const vil_image_view_base& view);
+
+  //: Put the data in this view into the resource, discarding prefetched copies
+  virtual bool put_view(const vil_image_view_base& im, unsigned i0, unsigned j0);
+
+  //: Select how blocks to prefetch are predicted; discards queued predictions
+  void set_access_pattern(access_pattern p);
+
+  //: Current access pattern (AUTO until a pattern has been detected)
+  access_pattern get_access_pattern() const;
+
+  //: Prefetch blocks in the order given (pairs of block_index_i, block_index_j).
+  // Switches the access pattern to LIST.
+  void set_prefetch_list(std::vector<std::pair<unsigned, unsigned> > const& blocks);
+
+  //: Number of blocks decoded by the background threads
+  unsigned long n_prefetched() const;
+
+  //: Hit, miss and eviction counts of the block cache
+  vil_block_cache_stats cache_stats() const { return cache_.stats(); }
+
+ private:
+  // Disallow copying
+  vil_prefetching_image_resource(const vil_prefetching_image_resource&);
+  vil_prefetching_image_resource& operator=(const vil_prefetching_image_resource&);
+
+  //: Read a block from bir_, serialized unless the source is thread safe
+  vil_image_view_base_sptr read_block(unsigned bi, unsigned bj) const;
+
+  //: Queue the blocks expected after (bi,bj).  Caller must hold the lock.
+  void schedule(unsigned bi, unsigned bj) const;
+
+  //: Queue a block unless cached, queued or being decoded. Caller must hold the lock.
+  bool enqueue(unsigned bi, unsigned bj) const;
+
+  //: Background thread body
+  void worker() const;
+
+  //: Discard cached and queued blocks overlapping a region
+  void invalidate(unsigned bi0, unsigned bi1, unsigned bj0, unsigned bj1);
+
+  vil_blocked_image_resource_sptr bir_;
+  mutable vil_block_cache cache_;
+  unsigned queue_depth_;
+  bool thread_safe_source_;
+  vil_prefetching_image_resource_state* state_;
+};
+
+#endif // vil_prefetching_image_resource_h_
@@ -25,11 +25,15 @@
 #include <vil/vil_pixel_format.h>
 #include <vil/vil_image_resource.h>
 #include <vil/vil_image_view.h>
+#include <vul/vul_tracing.h>
 
 
 //: Send vil_image to disk.
 bool vil_save(const vil_image_view_base &im, char const* filename, char const* file_format)
 {
+  VUL_TRACE_SCOPE("vil_save");
+  VUL_TRACE_COUNTER("vil_save.images", 1);
+  VUL_TRACE_HISTOGRAM("vil_save.pixels", double(im.ni()) * im.nj() * im.nplanes());
   vil_stream* os = vil_open(filename, "w");
   if (!os || !os->ok()) {
     std::cerr << __FILE__ ": Invalid stream for \"" << filename << "\"\n";
@@ -129,6 +133,7 @@ bool vil_save(const vil_image_view_base & i, char const* filename)
 bool vil_save_image_resource(const vil_image_resource_sptr &ir, char const* filename,
                              char const* file_format)
 {
+  VUL_TRACE_SCOPE("vil_save_image_resource");
   vil_stream* os = vil_open(filename, "w");
   if (!os || !os->ok()) {
     std::cerr << __FILE__ ": Invalid stream for \"" << filename << "\"\n";
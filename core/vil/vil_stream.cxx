@@ -4,6 +4,7 @@
 #endif
 
 #include "vil_stream.h"
+#include <vcl_compiler.h>
 
 #include <vcl_cassert.h>
 
@@ -34,3 +35,8 @@ void vil_stream::unref()
   if (--refcount_ == 0)
     delete this;
 }
+
+vil_memory_chunk* vil_stream::mapped_memory() const
+{
+  return VXL_NULLPTR;
+}
@@ -19,6 +19,8 @@ typedef vxl_int_64 vil_streampos;
 typedef vxl_int_32 vil_streampos;
 #endif //VXL_HAS_INT_64
 
+class vil_memory_chunk;
+
 //: Stream interface for VIL image loaders
 // This allows the loaders to be used with any type of stream.
 class vil_stream
@@ -44,6 +46,13 @@ class vil_stream
   //: Amount of data in the stream
   virtual vil_streampos file_size() const = 0;
 
+  //: The whole stream as one block of memory, if it is memory mapped.
+  // Image resources can then return views straight into the stream's
+  // memory instead of reading a copy of the pixels.  The offset of a byte
+  // in the block is its stream position.
+  // Returns a null pointer (the default) if the stream is not mapped.
+  virtual vil_memory_chunk* mapped_memory() const;
+
   //: up/down the reference count
   void ref() { ++refcount_; }
 
@@ -0,0 +1,51 @@
+// This is core/vil/vil_stream_mmap.cxx
+//:
+// \file
+
+#include <cstring>
+#include <iostream>
+#include "vil_stream_mmap.h"
+#include <vil/vil_mmap_memory_chunk.h>
+
+vil_stream_mmap::vil_stream_mmap(char const* filename)
+: data_(VXL_NULLPTR), size_(0), pos_(0)
+{
+  vil_mmap_memory_chunk* chunk = new vil_mmap_memory_chunk(filename);
+  chunk_ = chunk;
+  if (chunk->is_mapped())
+  {
+    data_ = static_cast<char const*>(chunk->const_data());
+    size_ = vil_streampos(chunk->size());
+  }
+  else
+    chunk_ = VXL_NULLPTR;
+}
+
+vil_stream_mmap::~vil_stream_mmap()
+{
+}
+
+vil_streampos vil_stream_mmap::write(void const*, vil_streampos)
+{
+  std::cerr << "vil_stream_mmap: write() to a read-only stream\n";
+  return 0;
+}
+
+vil_streampos vil_stream_mmap::read(void* buf, vil_streampos n)
+{
+  if (n <= 0 || pos_ >= size_) return 0;
+  if (n > size_ - pos_) n = size_ - pos_;
+  std::memcpy(buf, data_ + pos_, std::size_t(n));
+  pos_ += n;
+  return n;
+}
+
+void vil_stream_mmap::seek(vil_streampos position)
+{
+  pos_ = position < 0 ? 0 : position;
+}
+
+vil_memory_chunk* vil_stream_mmap::mapped_memory() const
+{
+  return chunk_.as_pointer();
+}
@@ -0,0 +1,48 @@
+// This is core/vil/vil_stream_mmap.h
+#ifndef vil_stream_mmap_h_
+#define vil_stream_mmap_h_
+//:
+// \file
+// \brief A read-only vil_stream over a memory mapped file
+//
+// Reading from the stream copies bytes out of the mapping, so file format
+// readers work unchanged.  Image resources which know about mapped
+// streams (see vil_stream::mapped_memory()) can instead return views
+// pointing straight into the mapped file.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <vcl_compiler.h>
+#include <vil/vil_stream.h>
+#include <vil/vil_memory_chunk.h>
+
+//: A read-only vil_stream over a memory mapped file.
+class vil_stream_mmap : public vil_stream
+{
+ public:
+  //: Map the whole of the named file.  Check ok() for success.
+  vil_stream_mmap(char const* filename);
+
+  // implement virtual vil_stream interface:
+  bool ok() const { return size_ > 0; }
+  vil_streampos write(void const* buf, vil_streampos n);
+  vil_streampos read(void* buf, vil_streampos n);
+  vil_streampos tell() const { return pos_; }
+  void seek(vil_streampos position);
+  vil_streampos file_size() const { return size_; }
+
+  vil_memory_chunk* mapped_memory() const;
+
+ protected:
+  ~vil_stream_mmap();
+
+ private:
+  vil_memory_chunk_sptr chunk_;
+  char const* data_;
+  vil_streampos size_;
+  vil_streampos pos_;
+};
+
+#endif // vil_stream_mmap_h_
@@ -8,9 +8,31 @@
 // \file
 // \brief STL algorithm like methods.
 // \author Ian Scott.
+//
+// vil_transform() calls the functor on one pixel at a time in raster
+// order, so the functor may keep state between calls.  The
+// vil_transform_parallel() variants split large images into bands of rows
+// which are processed concurrently (see vil_parallel_for), so their
+// functors must be safe to call from several threads at once.  On rows
+// with unit istep they call vil_transform_row(), which can be overloaded
+// for a particular functor and pixel type to give a vectorised loop (see
+// vil_math_sse.hxx).
+//
+// Several elementwise operations can be fused into a single pass over the
+// image with vil_transform_compose(), e.g.
+// \code
+//   vil_transform_parallel(im, vil_transform_compose(vil_math_scale_functor(0.5),
+//                                                    vil_math_sqrt_functor()));
+// \endcode
+//
+// \verbatim
+//  Modifications
+//   Added vil_transform_parallel, vil_transform_row and vil_transform_compose.
+// \endverbatim
 
 #include <vcl_cassert.h>
 #include <vil/vil_image_view.h>
+#include <vil/vil_parallel_for.h>
 
 //: Apply a unary operation to each pixel in image.
 // \param functor should take a value of type T and return same type
@@ -162,5 +184,150 @@ inline void vil_transform(const vil_image_view<inA >&srcA,
         nc_dest(i,j,p) = functor(srcA(i,j,p),srcB(i,j,p));
 }
 
+//: Apply a unary operation to a contiguous row of n pixels.
+// dest may be the same as src.  Overload this for specific functors and
+// pixel types to provide a faster (e.g. SIMD) implementation.
+template <class inP, class outP, class Op >
+inline void vil_transform_row(const inP* src, outP* dest, unsigned n, Op const& functor)
+{
+  for (unsigned i = 0; i < n; ++i)
+    dest[i] = functor(src[i]);
+}
+
+//: Apply a binary operation to contiguous rows of n pixels.
+// dest may be the same as srcA or srcB.
+template <class inA, class inB, class outP, class BinOp >
+inline void vil_transform_row(const inA* srcA, const inB* srcB, outP* dest, unsigned n,
+                              BinOp const& functor)
+{
+  for (unsigned i = 0; i < n; ++i)
+    dest[i] = functor(srcA[i], srcB[i]);
+}
+
+//: Number of rows handled by each sub-range of vil_transform_parallel.
+// Bands of at least 64k pixels keep the threading overhead small.
+inline unsigned vil_transform_parallel_grain(unsigned ni)
+{
+  return 1 + 65536 / (ni + 1);
+}
+
+//: Applies a unary operation to a range of rows (helper for vil_transform_parallel).
+// Index r of the range refers to row (r % nj) of plane (r / nj).
+template <class inP, class outP, class Op >
+struct vil_transform_rows
+{
+  const vil_image_view<inP>* src;
+  vil_image_view<outP>* dest;
+  const Op* functor;
+
+  void operator()(unsigned r0, unsigned r1) const
+  {
+    const unsigned ni = src->ni(), nj = src->nj();
+    const std::ptrdiff_t s_istep = src->istep(), d_istep = dest->istep();
+    for (unsigned r = r0; r < r1; ++r)
+    {
+      const unsigned p = r / nj, j = r % nj;
+      const inP* s = src->top_left_ptr() + p*src->planestep() + j*src->jstep();
+      outP* d = dest->top_left_ptr() + p*dest->planestep() + j*dest->jstep();
+      if (s_istep == 1 && d_istep == 1)
+        vil_transform_row(s, d, ni, *functor);
+      else
+        for (unsigned i = 0; i < ni; ++i, s += s_istep, d += d_istep)
+          *d = (*functor)(*s);
+    }
+  }
+};
+
+//: Applies a binary operation to a range of rows (helper for vil_transform_parallel).
+// If srcB has one plane, it is used with every plane of srcA.
+template <class inA, class inB, class outP, class BinOp >
+struct vil_transform_rows2
+{
+  const vil_image_view<inA>* srcA;
+  const vil_image_view<inB>* srcB;
+  vil_image_view<outP>* dest;
+  const BinOp* functor;
+
+  void operator()(unsigned r0, unsigned r1) const
+  {
+    const unsigned ni = srcA->ni(), nj = srcA->nj();
+    const std::ptrdiff_t a_istep = srcA->istep(), b_istep = srcB->istep(), d_istep = dest->istep();
+    const std::ptrdiff_t b_pstep = srcB->nplanes() == 1 ? 0 : srcB->planestep();
+    for (unsigned r = r0; r < r1; ++r)
+    {
+      const unsigned p = r / nj, j = r % nj;
+      const inA* a = srcA->top_left_ptr() + p*srcA->planestep() + j*srcA->jstep();
+      const inB* b = srcB->top_left_ptr() + p*b_pstep + j*srcB->jstep();
+      outP* d = dest->top_left_ptr() + p*dest->planestep() + j*dest->jstep();
+      if (a_istep == 1 && b_istep == 1 && d_istep == 1)
+        vil_transform_row(a, b, d, ni, *functor);
+      else
+        for (unsigned i = 0; i < ni; ++i, a += a_istep, b += b_istep, d += d_istep)
+          *d = (*functor)(*a, *b);
+    }
+  }
+};
+
+//: Apply a unary operation to each pixel in image, using several threads for large images.
+// \param functor must be callable concurrently, and should take and return a value of type T.
+// \relatesalso vil_image_view
+template <class T, class F >
+inline void vil_transform_parallel(vil_image_view<T >& image, F functor)
+{
+  vil_transform_rows<T,T,F> rows = { &image, &image, &functor };
+  vil_parallel_for(0, image.nj()*image.nplanes(), rows, vil_transform_parallel_grain(image.ni()));
+}
+
+//: Apply a unary operation to each pixel in src to get dest, using several threads for large images.
+// \param functor must be callable concurrently, and should take a value of type
+// inP and return a value of type outP.
+// \relatesalso vil_image_view
+template <class inP, class outP, class Op >
+inline void vil_transform_parallel(const vil_image_view<inP >&src, vil_image_view<outP >&dest, Op functor)
+{
+  dest.set_size(src.ni(), src.nj(), src.nplanes());
+  vil_transform_rows<inP,outP,Op> rows = { &src, &dest, &functor };
+  vil_parallel_for(0, src.nj()*src.nplanes(), rows, vil_transform_parallel_grain(src.ni()));
+}
+
+//: Apply a binary operation to each pixel in srcA and srcB to get dest, using several threads.
+// dest may be the same image as srcA or srcB.  If srcB has only one plane
+// then it is combined with each plane of srcA.
+// \param functor must be callable concurrently.
+// \relatesalso vil_image_view
+template <class inA, class inB, class outP, class BinOp >
+inline void vil_transform_parallel(const vil_image_view<inA >&srcA,
+                                   const vil_image_view<inB >&srcB,
+                                   vil_image_view<outP >&dest,
+                                   BinOp functor)
+{
+  assert(srcB.ni() == srcA.ni() && srcA.nj() == srcB.nj());
+  assert(srcB.nplanes() == srcA.nplanes() || srcB.nplanes() == 1);
+  dest.set_size(srcA.ni(), srcA.nj(), srcA.nplanes());
+  vil_transform_rows2<inA,inB,outP,BinOp> rows = { &srcA, &srcB, &dest, &functor };
+  vil_parallel_for(0, srcA.nj()*srcA.nplanes(), rows, vil_transform_parallel_grain(srcA.ni()));
+}
+
+//: Functor applying f2 to the result of f1, so that two operations take one pass.
+// The result has the type of the argument, as needed by the in-place
+// vil_transform.  Compositions can be nested to fuse more operations.
+template <class F1, class F2 >
+class vil_transform_composed
+{
+ public:
+  vil_transform_composed(F1 const& f1, F2 const& f2) : f1_(f1), f2_(f2) {}
+  template <class T>
+  T operator()(T x) const { return T(f2_(T(f1_(x)))); }
+ private:
+  F1 f1_;
+  F2 f2_;
+};
+
+//: Fuse two unary operations into one functor which applies f1 and then f2.
+template <class F1, class F2 >
+inline vil_transform_composed<F1,F2> vil_transform_compose(F1 const& f1, F2 const& f2)
+{
+  return vil_transform_composed<F1,F2>(f1, f2);
+}
 
 #endif // vil_transform_h_
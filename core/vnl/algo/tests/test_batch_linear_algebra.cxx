@@ -0,0 +1,269 @@
+// This is core/vnl/algo/tests/test_batch_linear_algebra.cxx
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <testlib/testlib_test.h>
+//:
+// \file
+// \brief Compare the batched small-matrix solvers with the one-at-a-time ones
+
+#include <vnl/vnl_matrix_fixed.h>
+#include <vnl/vnl_matrix_fixed_batch.h>
+#include <vnl/vnl_inverse.h>
+#include <vnl/vnl_det.h>
+#include <vnl/vnl_random.h>
+#include <vnl/vnl_parallel_for.h>
+#include <vnl/algo/vnl_batch_linear_algebra.h>
+#include <vnl/algo/vnl_symmetric_eigensystem.h>
+#include <vnl/algo/vnl_svd.h>
+
+template <class T, unsigned int R, unsigned int C>
+static void fill_random(vnl_matrix_fixed_batch<T,R,C>& A, vnl_random& rng)
+{
+  for (unsigned int k = 0; k < A.size(); ++k)
+    for (unsigned int r = 0; r < R; ++r)
+      for (unsigned int c = 0; c < C; ++c)
+        A(k,r,c) = T(rng.drand64(-1.0, 1.0));
+}
+
+template <class T, unsigned int R, unsigned int C>
+static bool bitwise_equal(vnl_matrix_fixed_batch<T,R,C> const& A, vnl_matrix_fixed_batch<T,R,C> const& B)
+{
+  if (A.size() != B.size())
+    return false;
+  for (unsigned int k = 0; k < A.size(); ++k)
+    if (A.get(k) != B.get(k))
+      return false;
+  return true;
+}
+
+static void test_container()
+{
+  vnl_matrix_fixed_batch<double,2,3> A(5);
+  TEST("size", A.size(), 5);
+  vnl_matrix_fixed<double,2,3> m;
+  m(0,0) = 1; m(0,1) = 2; m(0,2) = 3; m(1,0) = 4; m(1,1) = 5; m(1,2) = 6;
+  A.set(3, m);
+  TEST("get(set())", A.get(3) == m, true);
+  TEST("Planes are contiguous across matrices", A.plane(1,2)[3] == 6.0 && &A(4,1,2) == A.plane(1,2) + 4, true);
+  TEST("get_column", A.get_column(3, 1)[1], 5.0);
+  TEST("Other matrices are zero", A.get(2).is_zero(), true);
+  A.set_size(5);
+  TEST("set_size to the same size keeps the contents", A.get(3) == m, true);
+  A.set_size(0);
+  TEST("Empty batch", A.size() == 0 && A.plane(0,0) == VXL_NULLPTR, true);
+}
+
+static void test_lu()
+{
+  vnl_random rng(5);
+  const unsigned int n = 1003;
+  vnl_matrix_fixed_batch<double,3,3> A(n);
+  vnl_matrix_fixed_batch<double,3,1> b(n), x;
+  fill_random(A, rng);
+  fill_random(b, rng);
+  A.set(17, vnl_matrix_fixed<double,3,3>(0.0));   // singular
+
+  TEST("One singular matrix", vnl_batch_lu_solve(A, b, x), 1);
+  double max_res = 0.0;
+  for (unsigned int k = 0; k < n; ++k) {
+    if (k == 17) continue;
+    const double res = (A.get(k) * x.get_column(k) - b.get_column(k)).inf_norm();
+    max_res = std::max(max_res, res / vnl_inverse(A.get(k)).absolute_value_max());
+  }
+  TEST_NEAR("LU solutions", max_res, 0.0, 1e-12);
+  TEST("Singular solution is zero", x.get_column(17).is_zero(), true);
+
+  std::vector<double> det;
+  vnl_batch_determinant(A, det);
+  double max_err = 0.0;
+  for (unsigned int k = 0; k < n; ++k)
+    max_err = std::max(max_err, std::abs(det[k] - vnl_det(A.get(k))));
+  TEST_NEAR("Determinants", max_err, 0.0, 1e-14);
+  TEST("Singular determinant", det[17], 0.0);
+
+  vnl_matrix_fixed_batch<double,4,4> A4(n), A4inv;
+  fill_random(A4, rng);
+  TEST("No singular 4x4", vnl_batch_inverse(A4, A4inv), 0);
+  max_err = 0.0;
+  for (unsigned int k = 0; k < n; ++k) {
+    vnl_matrix_fixed<double,4,4> I = A4.get(k) * A4inv.get(k);
+    I(0,0) -= 1; I(1,1) -= 1; I(2,2) -= 1; I(3,3) -= 1;
+    max_err = std::max(max_err, I.absolute_value_max() / vnl_inverse(A4.get(k)).absolute_value_max());
+  }
+  TEST_NEAR("4x4 inverses", max_err, 0.0, 1e-13);
+
+  // the answer for one matrix does not depend on the rest of the batch
+  vnl_matrix_fixed_batch<double,3,3> A1(1);
+  vnl_matrix_fixed_batch<double,3,1> b1(1), x1;
+  A1.set(0, A.get(100));
+  b1.set(0, b.get(100));
+  vnl_batch_lu_solve(A1, b1, x1);
+  TEST("Independent of the batch", x1.get(0) == x.get(100), true);
+
+  vnl_matrix_fixed_batch<float,2,2> F(3), Finv;
+  F(0,0,0) = 2; F(0,1,1) = 4; F(1,0,1) = 1; F(1,1,0) = 1; F(2,0,0) = 1; F(2,0,1) = 2; F(2,1,0) = 2; F(2,1,1) = 4;
+  TEST("Float: one singular", vnl_batch_inverse(F, Finv), 1);
+  TEST("Float: diagonal inverse", Finv(0,0,0) == 0.5f && Finv(0,1,1) == 0.25f, true);
+  TEST("Float: permutation inverse", Finv(1,0,1) == 1.f && Finv(1,1,0) == 1.f && Finv(1,0,0) == 0.f, true);
+}
+
+static void test_cholesky()
+{
+  vnl_random rng(6);
+  const unsigned int n = 500;
+  vnl_matrix_fixed_batch<double,6,6> A(n), S(n);
+  vnl_matrix_fixed_batch<double,6,2> b(n), x;
+  fill_random(A, rng);
+  fill_random(b, rng);
+  for (unsigned int k = 0; k < n; ++k) {
+    vnl_matrix_fixed<double,6,6> a = A.get(k);
+    S.set(k, a.transpose() * a + vnl_matrix_fixed<double,6,6>().set_identity()*0.1);
+  }
+  S(3,0,0) = -1.0; // not positive definite
+  TEST("One failure", vnl_batch_cholesky_solve(S, b, x), 1);
+  double max_res = 0.0;
+  for (unsigned int k = 0; k < n; ++k)
+    if (k != 3)
+      max_res = std::max(max_res, (S.get(k) * x.get(k) - b.get(k)).absolute_value_max());
+  TEST_NEAR("Cholesky solutions", max_res, 0.0, 1e-10);
+  TEST("Failed solution is zero", x.get(3).is_zero(), true);
+}
+
+static void test_eigensystem()
+{
+  vnl_random rng(7);
+  const unsigned int n = 777;
+  vnl_matrix_fixed_batch<double,3,3> A(n), V;
+  vnl_matrix_fixed_batch<double,3,1> D;
+  fill_random(A, rng);
+  for (unsigned int k = 0; k < n; ++k) {
+    vnl_matrix_fixed<double,3,3> a = A.get(k);
+    A.set(k, a + a.transpose());
+  }
+  A.set(5, vnl_matrix_fixed<double,3,3>().set_identity());  // repeated eigenvalues
+  vnl_batch_symmetric_eigensystem(A, V, D);
+
+  double max_val_err = 0.0, max_res = 0.0, max_orth = 0.0;
+  for (unsigned int k = 0; k < n; ++k) {
+    vnl_matrix<double> a = A.get(k).as_ref();
+    vnl_symmetric_eigensystem<double> eig(a);
+    for (unsigned int i = 0; i < 3; ++i)
+      max_val_err = std::max(max_val_err, std::abs(D(k,i,0) - eig.D(i,i)));
+    vnl_matrix_fixed<double,3,3> v = V.get(k);
+    vnl_matrix_fixed<double,3,3> d(0.0);
+    for (unsigned int i = 0; i < 3; ++i) d(i,i) = D(k,i,0);
+    max_res = std::max(max_res, (A.get(k) * v - v * d).absolute_value_max());
+    max_orth = std::max(max_orth, (v.transpose() * v - vnl_matrix_fixed<double,3,3>().set_identity()).absolute_value_max());
+  }
+  TEST_NEAR("Eigenvalues agree with vnl_symmetric_eigensystem", max_val_err, 0.0, 1e-12);
+  TEST_NEAR("A V = V D", max_res, 0.0, 1e-12);
+  TEST_NEAR("V orthonormal", max_orth, 0.0, 1e-12);
+  vnl_matrix_fixed<double,3,3> I;
+  I.set_identity();
+  TEST("Identity has unit eigenvectors", V.get(5) == I, true);
+}
+
+static void test_svd()
+{
+  vnl_random rng(8);
+  const unsigned int n = 300;
+  vnl_matrix_fixed_batch<double,4,3> A(n), U;
+  vnl_matrix_fixed_batch<double,3,1> W;
+  vnl_matrix_fixed_batch<double,3,3> V;
+  fill_random(A, rng);
+  for (unsigned int r = 0; r < 4; ++r)   // rank 2
+    A(9,r,2) = A(9,r,0) + A(9,r,1);
+  vnl_batch_svd(A, U, W, V);
+
+  double max_w_err = 0.0, max_res = 0.0;
+  for (unsigned int k = 0; k < n; ++k) {
+    vnl_matrix<double> a = A.get(k).as_ref();
+    vnl_svd<double> svd(a);
+    for (unsigned int i = 0; i < 3; ++i)
+      max_w_err = std::max(max_w_err, std::abs(W(k,i,0) - svd.W(i)));
+    vnl_matrix_fixed<double,3,3> w(0.0);
+    for (unsigned int i = 0; i < 3; ++i) w(i,i) = W(k,i,0);
+    max_res = std::max(max_res, (U.get(k) * w * V.get(k).transpose() - A.get(k)).absolute_value_max());
+  }
+  TEST_NEAR("Singular values agree with vnl_svd", max_w_err, 0.0, 1e-12);
+  TEST_NEAR("A = U W V'", max_res, 0.0, 1e-12);
+  TEST_NEAR("Rank deficient matrix", W(9,2,0), 0.0, 1e-12);
+}
+
+//: The results must not depend on the number of threads.
+static void test_threads()
+{
+  vnl_random rng(9);
+  const unsigned int n = 20000;
+  vnl_matrix_fixed_batch<double,3,3> A(n), V1, V4, I1, I4;
+  vnl_matrix_fixed_batch<double,3,1> D1, D4;
+  fill_random(A, rng);
+  const unsigned old_threads = vnl_parallel::max_threads();
+  vnl_parallel::set_max_threads(1);
+  vnl_batch_inverse(A, I1);
+  vnl_batch_symmetric_eigensystem(A, V1, D1);
+  vnl_parallel::set_max_threads(4);
+  vnl_batch_inverse(A, I4);
+  vnl_batch_symmetric_eigensystem(A, V4, D4);
+  vnl_parallel::set_max_threads(old_threads);
+  TEST("Inverses identical with 1 and 4 threads", bitwise_equal(I1, I4), true);
+  TEST("Eigensystems identical with 1 and 4 threads", bitwise_equal(V1, V4) && bitwise_equal(D1, D4), true);
+}
+
+//: Outputs which are also inputs give the same results as separate outputs
+static void test_aliasing()
+{
+  vnl_random rng(10);
+  const unsigned int n = 70;
+  vnl_matrix_fixed_batch<double,3,3> A(n), S(n), Ainv, V, X;
+  vnl_matrix_fixed_batch<double,3,1> b(n), x, D;
+  fill_random(A, rng);
+  fill_random(b, rng);
+  for (unsigned int k = 0; k < n; ++k) {
+    vnl_matrix_fixed<double,3,3> a = A.get(k);
+    S.set(k, a.transpose() * a + vnl_matrix_fixed<double,3,3>().set_identity());
+  }
+
+  vnl_batch_inverse(A, Ainv);
+  vnl_matrix_fixed_batch<double,3,3> B(A);
+  vnl_batch_inverse(B, B);
+  TEST("vnl_batch_inverse(A,A)", bitwise_equal(B, Ainv), true);
+
+  vnl_batch_lu_solve(A, b, x);
+  vnl_matrix_fixed_batch<double,3,1> c(b);
+  vnl_batch_lu_solve(A, c, c);
+  TEST("vnl_batch_lu_solve(A,B,B)", bitwise_equal(c, x), true);
+
+  vnl_batch_cholesky_solve(S, A, X);
+  B = A;
+  vnl_batch_cholesky_solve(S, B, B);
+  TEST("vnl_batch_cholesky_solve(A,B,B)", bitwise_equal(B, X), true);
+
+  vnl_batch_symmetric_eigensystem(S, V, D);
+  B = S;
+  vnl_matrix_fixed_batch<double,3,1> E;
+  vnl_batch_symmetric_eigensystem(B, B, E);
+  TEST("vnl_batch_symmetric_eigensystem(A,A,D)", bitwise_equal(B, V) && bitwise_equal(E, D), true);
+
+  vnl_matrix_fixed_batch<double,3,3> U, VV;
+  vnl_matrix_fixed_batch<double,3,1> W, W2;
+  vnl_batch_svd(A, U, W, VV);
+  B = A;
+  vnl_batch_svd(B, B, W2, V);
+  TEST("vnl_batch_svd(A,A,W,V)", bitwise_equal(B, U) && bitwise_equal(W2, W) && bitwise_equal(V, VV), true);
+}
+
+static void test_batch_linear_algebra()
+{
+  test_container();
+  test_lu();
+  test_cholesky();
+  test_eigensystem();
+  test_svd();
+  test_threads();
+  test_aliasing();
+}
+
+TESTMAIN(test_batch_linear_algebra);
@@ -1,6 +1,7 @@
 #include <testlib/testlib_register.h>
 
 DECLARE( test_amoeba );
+DECLARE( test_batch_linear_algebra );
 DECLARE( test_cholesky );
 DECLARE( test_complex_eigensystem );
 DECLARE( test_convolve );
@@ -10,6 +11,7 @@ DECLARE( test_rank );
 DECLARE( test_fft );
 DECLARE( test_fft1d );
 DECLARE( test_fft2d );
+DECLARE( test_fft_plan );
 DECLARE( test_functions );
 DECLARE( test_generalized_eigensystem );
 DECLARE( test_ldl_cholesky );
@@ -40,6 +42,7 @@ void
 register_tests()
 {
   REGISTER( test_amoeba );
+  REGISTER( test_batch_linear_algebra );
   REGISTER( test_cholesky );
   REGISTER( test_complex_eigensystem );
   REGISTER( test_convolve );
@@ -49,6 +52,7 @@ register_tests()
   REGISTER( test_fft );
   REGISTER( test_fft1d );
   REGISTER( test_fft2d );
+  REGISTER( test_fft_plan );
   REGISTER( test_functions );
   REGISTER( test_generalized_eigensystem );
   REGISTER( test_ldl_cholesky );
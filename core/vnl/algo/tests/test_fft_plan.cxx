@@ -0,0 +1,114 @@
+// This is core/vnl/algo/tests/test_fft_plan.cxx
+#include <complex>
+#include <iostream>
+#include <vector>
+#include <testlib/testlib_test.h>
+//:
+// \file
+// \brief Test vnl_fft_plan real transforms and batched vnl_fft_2d
+
+#include <vnl/vnl_matrix.h>
+#include <vnl/vnl_random.h>
+#include <vnl/vnl_parallel_for.h>
+#include <vnl/algo/vnl_fft_1d.h>
+#include <vnl/algo/vnl_fft_2d.h>
+#include <vnl/algo/vnl_fft_plan.h>
+
+template <class T>
+static void test_real(int N, double tol)
+{
+  vnl_random rng(N);
+  std::vector<T> x(N);
+  std::vector<std::complex<T> > c(N);
+  for (int k = 0; k < N; ++k)
+    c[k] = x[k] = T(rng.drand64(-1.0, 1.0));
+
+  vnl_fft_1d<T> fft(N);
+  fft.fwd_transform(c);
+
+  vnl_fft_plan<T> const& plan = vnl_fft_plan<T>::get(N);
+  std::vector<std::complex<T> > X(plan.real_size());
+  plan.fwd_real(&x[0], &X[0]);
+  double err = 0;
+  for (int k = 0; k < plan.real_size(); ++k)
+    err += std::norm(X[k] - c[k]);
+  std::cout << "N = " << N << ", forward error " << err << '\n';
+  TEST_NEAR("fwd_real agrees with complex transform", err, 0.0, tol);
+
+  std::vector<T> y(N);
+  plan.bwd_real(&X[0], &y[0]);
+  err = 0;
+  for (int k = 0; k < N; ++k)
+    err += (y[k] - N*x[k])*(y[k] - N*x[k]);
+  TEST_NEAR("bwd_real inverts fwd_real", err/(double(N)*N), 0.0, tol);
+}
+
+static void test_batched()
+{
+  const int N = 30, lot = 7;
+  vnl_random rng(3);
+  std::vector<std::complex<double> > data(N*lot);
+  for (unsigned k = 0; k < data.size(); ++k)
+    data[k] = std::complex<double>(rng.drand64(-1.0, 1.0), rng.drand64(-1.0, 1.0));
+
+  // lot signals stored as columns: element k of signal l at k*lot + l
+  std::vector<std::complex<double> > batched = data;
+  vnl_fft_plan<double>::get(N).transform(&batched[0], lot, 1, lot, +1);
+
+  vnl_fft_1d<double> fft(N);
+  bool same = true;
+  for (int l = 0; l < lot; ++l) {
+    std::vector<std::complex<double> > v(N);
+    for (int k = 0; k < N; ++k) v[k] = data[k*lot + l];
+    fft.fwd_transform(v);
+    for (int k = 0; k < N; ++k) same = same && v[k] == batched[k*lot + l];
+  }
+  TEST("Batched transform identical to one at a time", same, true);
+  TEST("Plans are cached", &vnl_fft_plan<double>::get(N) == &vnl_fft_plan<double>::get(N), true);
+}
+
+//: vnl_fft_2d gives the same bits as transforming each column, then each row.
+static void test_2d(unsigned threads)
+{
+  const unsigned old_threads = vnl_parallel::max_threads();
+  vnl_parallel::set_max_threads(threads);
+
+  const int M = 512, N = 480;
+  vnl_random rng(7);
+  vnl_matrix<std::complex<double> > signal(M, N);
+  for (int i = 0; i < M; ++i)
+    for (int j = 0; j < N; ++j)
+      signal(i, j) = std::complex<double>(rng.drand64(-1.0, 1.0), rng.drand64(-1.0, 1.0));
+
+  vnl_matrix<std::complex<double> > expected = signal;
+  vnl_fft_1d<double> fft_m(M), fft_n(N);
+  std::vector<std::complex<double> > v(M);
+  for (int j = 0; j < N; ++j) {
+    for (int i = 0; i < M; ++i) v[i] = expected(i, j);
+    fft_m.fwd_transform(v);
+    for (int i = 0; i < M; ++i) expected(i, j) = v[i];
+  }
+  for (int i = 0; i < M; ++i)
+    fft_n.fwd_transform(expected[i]);
+
+  vnl_fft_2d<double> fft(M, N);
+  fft.fwd_transform(signal);
+  std::cout << "2D transform with up to " << threads << " threads\n";
+  TEST("2D transform identical to 1D passes", signal == expected, true);
+
+  vnl_parallel::set_max_threads(old_threads);
+}
+
+static void test_fft_plan()
+{
+  const int sizes[] = { 1, 2, 3, 4, 5, 6, 8, 9, 10, 15, 16, 30, 60, 64, 90, 120, 1024 };
+  for (unsigned k = 0; k < sizeof(sizes)/sizeof(sizes[0]); ++k)
+    test_real<double>(sizes[k], 1e-18*sizes[k]*sizes[k]);
+  test_real<float>(256, 1e-6);
+  test_real<float>(75, 1e-6);
+  test_batched();
+  test_2d(1);
+  test_2d(4);
+}
+
+TESTMAIN(test_fft_plan);
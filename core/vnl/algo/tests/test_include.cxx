@@ -29,6 +29,7 @@
 #include <vnl/algo/vnl_lsqr.h>
 #include <vnl/algo/vnl_matrix_inverse.h>
 #include <vnl/algo/vnl_matrix_update.h>
+#include <vnl/algo/vnl_batch_linear_algebra.h>
 #include <vnl/algo/vnl_netlib.h>
 #include <vnl/algo/vnl_orthogonal_complement.h>
 #include <vnl/algo/vnl_powell.h>
@@ -49,5 +50,6 @@
 
 #include <vnl/algo/vnl_fft_base.h>
 #include <vnl/algo/vnl_fft_prime_factors.h>
+#include <vnl/algo/vnl_fft_plan.h>
 
 int main() { return 0; }
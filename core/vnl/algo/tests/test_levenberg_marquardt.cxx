@@ -6,6 +6,8 @@
 
 #include <testlib/testlib_test.h>
 #include <vnl/vnl_least_squares_function.h>
+#include <vnl/vnl_cost_function.h>
+#include <vnl/vnl_parallel_for.h>
 #include <vnl/algo/vnl_levenberg_marquardt.h>
 
 struct vnl_rosenbrock : public vnl_least_squares_function
@@ -123,6 +125,128 @@ void do_linear_test( bool with_grad )
   TEST_NEAR( "covariance approximation", (true_cov-covar).array_two_norm(), 0, 1e-5 );
 }
 
+// fit y = a*exp(-b*t)*cos(c*t+d) to samples; f may be called concurrently
+struct damped_cosine : public vnl_least_squares_function
+{
+  damped_cosine(unsigned int n, bool thread_safe)
+  : vnl_least_squares_function(4, n, no_gradient), t_(n), y_(n)
+  {
+    for (unsigned int i = 0; i < n; ++i) {
+      t_[i] = 0.1*i;
+      y_[i] = 2.0*std::exp(-0.3*t_[i])*std::cos(1.7*t_[i]+0.4) + 0.01*std::sin(13.0*i);
+    }
+    set_thread_safe(thread_safe);
+  }
+
+  void f(vnl_vector<double> const& x, vnl_vector<double>& r) {
+    for (unsigned int i = 0; i < t_.size(); ++i)
+      r[i] = x[0]*std::exp(-x[1]*t_[i])*std::cos(x[2]*t_[i]+x[3]) - y_[i];
+  }
+
+  vnl_vector<double> t_, y_;
+};
+
+struct damped_cosine_cost : public vnl_cost_function
+{
+  damped_cosine_cost(damped_cosine& lsq) : vnl_cost_function(4), lsq_(lsq) {}
+  double f(vnl_vector<double> const& x) {
+    vnl_vector<double> r(lsq_.get_number_of_residuals());
+    lsq_.f(x, r);
+    return r.squared_magnitude();
+  }
+  damped_cosine& lsq_;
+};
+
+// damped_cosine which signals a failure when c is moved away from 1.5
+struct failing_cosine : public damped_cosine
+{
+  failing_cosine(unsigned int n, bool thread_safe) : damped_cosine(n, thread_safe) {}
+  void f(vnl_vector<double> const& x, vnl_vector<double>& r) {
+    damped_cosine::f(x, r);
+    if (x[2] != 1.5)
+      throw_failure();
+  }
+};
+
+static bool bitwise_equal(vnl_vector<double> const& a, vnl_vector<double> const& b)
+{
+  if (a.size() != b.size())
+    return false;
+  for (unsigned int i = 0; i < a.size(); ++i)
+    if (a[i] != b[i])
+      return false;
+  return true;
+}
+
+static
+void do_parallel_fd_test(long maxfev)
+{
+  std::cout << "Parallel finite differences, maxfev = " << maxfev << std::endl;
+  const unsigned int old_threads = vnl_parallel::max_threads();
+  vnl_parallel::set_max_threads(4);
+
+  damped_cosine serial_f(200, false), parallel_f(200, true);
+  vnl_levenberg_marquardt serial_lm(serial_f), parallel_lm(parallel_f);
+  serial_lm.set_max_function_evals(maxfev);
+  parallel_lm.set_max_function_evals(maxfev);
+  serial_lm.set_epsilon_function(1e-10);
+  parallel_lm.set_epsilon_function(1e-10);
+
+  vnl_vector<double> x0(4);
+  x0[0] = 1.0; x0[1] = 0.1; x0[2] = 1.5; x0[3] = 0.0;
+  vnl_vector<double> xs(x0), xp(x0);
+  bool serial_ok = serial_lm.minimize_without_gradient(xs);
+  bool parallel_ok = parallel_lm.minimize_without_gradient(xp);
+  std::cout << "x = " << xs << " after " << serial_lm.get_num_evaluations() << " evaluations" << std::endl;
+
+  TEST("same outcome", parallel_ok, serial_ok);
+  TEST("same failure code", int(parallel_lm.get_failure_code()), int(serial_lm.get_failure_code()));
+  TEST("identical solution", bitwise_equal(xs, xp), true);
+  TEST("same number of evaluations", parallel_lm.get_num_evaluations(), serial_lm.get_num_evaluations());
+  TEST("same number of iterations", parallel_lm.get_num_iterations(), serial_lm.get_num_iterations());
+  TEST("same end error", parallel_lm.get_end_error(), serial_lm.get_end_error());
+  TEST("same JtJ", parallel_lm.get_JtJ() == serial_lm.get_JtJ(), true);
+
+  vnl_matrix<double> Js(200, 4), Jp(200, 4);
+  serial_f.fdgradf(x0, Js, 1e-4);
+  parallel_f.fdgradf(x0, Jp, 1e-4);
+  TEST("fdgradf identical", Js == Jp, true);
+  serial_f.ffdgradf(x0, Js, 1e-4);
+  parallel_f.ffdgradf(x0, Jp, 1e-4);
+  TEST("ffdgradf identical", Js == Jp, true);
+
+  damped_cosine_cost serial_cost(serial_f), parallel_cost(parallel_f);
+  parallel_cost.set_thread_safe(true);
+  vnl_vector<double> gs(4), gp(4);
+  serial_cost.fdgradf(x0, gs);
+  parallel_cost.fdgradf(x0, gp);
+  TEST("cost function fdgradf identical", bitwise_equal(gs, gp), true);
+
+  // failures signalled by the threads are set once the loop is done
+  failing_cosine serial_fail(200, false), parallel_fail(200, true);
+  parallel_fail.fdgradf(x0, Jp, 1e-4);
+  TEST("fdgradf failure", parallel_fail.failure, true);
+  parallel_fail.clear_failure();
+  parallel_fail.ffdgradf(x0, Jp, 1e-4);
+  TEST("ffdgradf failure", parallel_fail.failure, true);
+  parallel_fail.clear_failure();
+  damped_cosine_cost fail_cost(parallel_fail);
+  fail_cost.set_thread_safe(true);
+  fail_cost.fdgradf(x0, gp);
+  TEST("cost function fdgradf failure", parallel_fail.failure, true);
+  parallel_fail.clear_failure();
+  vnl_levenberg_marquardt serial_fail_lm(serial_fail), parallel_fail_lm(parallel_fail);
+  xs = x0; xp = x0;
+  serial_ok = serial_fail_lm.minimize_without_gradient(xs);
+  parallel_ok = parallel_fail_lm.minimize_without_gradient(xp);
+  TEST("failure stops the minimization", parallel_ok, false);
+  TEST("same outcome after failure", int(parallel_fail_lm.get_failure_code()),
+       int(serial_fail_lm.get_failure_code()));
+  TEST("failure cleared", parallel_fail.failure, false);
+
+  vnl_parallel::set_max_threads(old_threads);
+}
+
 static
 void test_levenberg_marquardt()
 {
@@ -131,6 +255,9 @@ void test_levenberg_marquardt()
 
   do_linear_test(true);
   do_linear_test(false);
+
+  do_parallel_fd_test(2000);
+  do_parallel_fd_test(23); // stops early, after the same number of evaluations
 }
 
 TESTMAIN(test_levenberg_marquardt);
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <cmath>
 #include <testlib/testlib_test.h>
 #include <vnl/vnl_sparse_lst_sqr_function.h>
 #include <vnl/algo/vnl_sparse_lm.h>
@@ -6,6 +7,7 @@
 #include <vcl_cassert.h>
 #include <vnl/vnl_random.h>
 #include <vnl/vnl_math.h>
+#include <vnl/vnl_parallel_for.h>
 
 
 // translate, scale, and rotate all cameras and points into a
@@ -796,12 +798,212 @@ void test_prob3()
   }
 }
 
+//----------------------------------------------------------------------------
+
+// a long strip of points seen by many cameras, each of which sees only the
+// points in front of it, so that most pairs of cameras share no points
+static void make_strip(unsigned int num_cam, unsigned int num_pts,
+                       vnl_vector<double>& a, vnl_vector<double>& b,
+                       std::vector<std::vector<bool> >& mask)
+{
+  vnl_random rnd(4321);
+  a.set_size(3*num_cam);
+  b.set_size(2*num_pts);
+  const double width = 2.0*num_cam;
+  for (unsigned int j=0; j<num_pts; ++j) {
+    b[2*j]   = width*j/num_pts + rnd.drand64(0.0,0.1);
+    b[2*j+1] = rnd.drand64(8.0,16.0);
+  }
+  mask.assign(num_cam, std::vector<bool>(num_pts,false));
+  for (unsigned int i=0; i<num_cam; ++i) {
+    const double x = 2.0*i;
+    a[3*i]   = rnd.drand64(-0.1,0.1);
+    a[3*i+1] = -x;
+    a[3*i+2] = rnd.drand64(-1.0,1.0);
+    for (unsigned int j=0; j<num_pts; ++j)
+      mask[i][j] = std::fabs(b[2*j]-x) < 6.0;
+  }
+}
+
+static bool bitwise_equal(vnl_vector<double> const& x, vnl_vector<double> const& y)
+{
+  if (x.size() != y.size())
+    return false;
+  for (unsigned int i=0; i<x.size(); ++i)
+    if (x[i] != y[i])
+      return false;
+  return true;
+}
+
+//: A bundle_2d whose residuals fail for one camera
+class bundle_2d_failing : public bundle_2d
+{
+ public:
+  bundle_2d_failing(unsigned int num_cam, unsigned int num_pts,
+                    const vnl_vector<double>& data,
+                    const std::vector<std::vector<bool> >& xmask,
+                    unsigned int failing_cam)
+   : bundle_2d(num_cam,num_pts,data,xmask), failing_cam_(failing_cam) {}
+
+  void fij(int i, int j,
+           vnl_vector<double> const& ai,
+           vnl_vector<double> const& bj,
+           vnl_vector<double> const& c,
+           vnl_vector<double>& fxij)
+  {
+    bundle_2d::fij(i,j,ai,bj,c,fxij);
+    if (i == int(failing_cam_))
+      throw_failure();
+  }
+
+  unsigned int failing_cam_;
+};
+
+void test_prob4()
+{
+  const unsigned int num_cam = 30, num_pts = 300;
+  vnl_vector<double> a, b, c;
+  std::vector<std::vector<bool> > mask;
+  make_strip(num_cam, num_pts, a, b, mask);
+
+  vnl_crs_index crs(mask);
+  vnl_vector<double> proj(crs.num_non_zero(),0.0);
+  bundle_2d gen_func(num_cam,num_pts,proj,mask,vnl_sparse_lst_sqr_function::use_gradient);
+  gen_func.f(a,b,c,proj);
+  std::cout << "strip problem with " << crs.num_non_zero() << " projections\n";
+
+  // perturbed initial conditions
+  vnl_random rnd(1234);
+  vnl_vector<double> a0(a), b0(b);
+  for (unsigned int i=0; i<a0.size(); ++i)
+    a0[i] += rnd.drand64(-0.01,0.01);
+  for (unsigned int i=0; i<b0.size(); ++i)
+    b0[i] += rnd.drand64(-0.1,0.1);
+
+  // thread safe evaluation of the residuals and Jacobians
+  {
+    bundle_2d serial_func(num_cam,num_pts,proj,mask);
+    bundle_2d parallel_func(num_cam,num_pts,proj,mask);
+    parallel_func.set_thread_safe(true);
+    TEST("thread safe is off by default", serial_func.is_thread_safe(), false);
+
+    const unsigned int old_threads = vnl_parallel::max_threads();
+    vnl_parallel::set_max_threads(4);
+    vnl_vector<double> e1(proj.size()), e2(proj.size());
+    serial_func.f(a0,b0,c,e1);
+    parallel_func.f(a0,b0,c,e2);
+    TEST("parallel residuals identical", bitwise_equal(e1,e2), true);
+
+    std::vector<vnl_matrix<double> > A1(crs.num_non_zero(), vnl_matrix<double>(1,3)), A2(A1);
+    std::vector<vnl_matrix<double> > B1(crs.num_non_zero(), vnl_matrix<double>(1,2)), B2(B1);
+    std::vector<vnl_matrix<double> > C1(crs.num_non_zero(), vnl_matrix<double>(1,0)), C2(C1);
+    serial_func.jac_blocks(a0,b0,c,A1,B1,C1);
+    parallel_func.jac_blocks(a0,b0,c,A2,B2,C2);
+    bool same = true;
+    for (unsigned int k=0; k<A1.size(); ++k)
+      same = same && A1[k] == A2[k] && B1[k] == B2[k];
+    TEST("parallel Jacobians identical", same, true);
+
+    serial_func.fd_jac_blocks(a0,b0,c,A1,B1,C1,1e-6);
+    parallel_func.fd_jac_blocks(a0,b0,c,A2,B2,C2,1e-6);
+    same = true;
+    for (unsigned int k=0; k<A1.size(); ++k)
+      same = same && A1[k] == A2[k] && B1[k] == B2[k];
+    TEST("parallel finite difference Jacobians identical", same, true);
+
+    // failures in any thread are reported once all have finished
+    bundle_2d_failing failing_func(num_cam,num_pts,proj,mask,num_cam-2);
+    failing_func.set_thread_safe(true);
+    failing_func.f(a0,b0,c,e2);
+    TEST("parallel failure reported", failing_func.failure, true);
+    failing_func.clear_failure();
+    failing_func.fd_jac_blocks(a0,b0,c,A2,B2,C2,1e-6);
+    TEST("parallel finite difference failure reported", failing_func.failure, true);
+    failing_func.clear_failure();
+    failing_func.jac_blocks(a0,b0,c,A2,B2,C2);
+    TEST("no failure from analytic Jacobians", failing_func.failure, false);
+    vnl_parallel::set_max_threads(old_threads);
+  }
+
+  // the dense solver gives the same result with any number of threads
+  vnl_vector<double> pa1(a0), pb1(b0), pa4(a0), pb4(b0), pc;
+  {
+    const unsigned int old_threads = vnl_parallel::max_threads();
+    bundle_2d my_func(num_cam,num_pts,proj,mask);
+    my_func.set_thread_safe(true);
+
+    vnl_parallel::set_max_threads(1);
+    vnl_sparse_lm slm1(my_func);
+    slm1.set_max_function_evals(10);
+    slm1.minimize(pa1,pb1,pc);
+
+    vnl_parallel::set_max_threads(4);
+    vnl_sparse_lm slm4(my_func);
+    slm4.set_max_function_evals(10);
+    slm4.minimize(pa4,pb4,pc);
+    vnl_parallel::set_max_threads(old_threads);
+
+    std::cout << "dense solver error: " << slm1.get_start_error()
+              << " -> " << slm1.get_end_error() << std::endl;
+    TEST("dense solver reduces the error", slm1.get_end_error() < 1e-3*slm1.get_start_error(), true);
+    TEST("same cameras with 1 and 4 threads", bitwise_equal(pa1,pa4), true);
+    TEST("same points with 1 and 4 threads", bitwise_equal(pb1,pb4), true);
+    TEST("same error with 1 and 4 threads", slm1.get_end_error(), slm4.get_end_error());
+  }
+
+  // the iterative solver takes the same steps, up to its tolerance
+  {
+    vnl_vector<double> pa(a0), pb(b0);
+    bundle_2d my_func(num_cam,num_pts,proj,mask);
+    my_func.set_thread_safe(true);
+    vnl_sparse_lm slm(my_func);
+    slm.set_max_function_evals(10);
+    slm.set_use_iterative_solver(true);
+    TEST("iterative solver set", slm.get_use_iterative_solver(), true);
+    slm.minimize(pa,pb,pc);
+    std::cout << "iterative solver error: " << slm.get_start_error()
+              << " -> " << slm.get_end_error() << " in "
+              << slm.get_iterative_solver_iterations() << " CG iterations" << std::endl;
+    TEST("iterative solver used", slm.get_iterative_solver_iterations() > 0, true);
+    TEST("iterative solver reduces the error", slm.get_end_error() < 1e-3*slm.get_start_error(), true);
+    double diff = (pa-pa1).inf_norm() + (pb-pb1).inf_norm();
+    std::cout << "difference from dense solver: " << diff << std::endl;
+    TEST("iterative solution close to dense", diff < 1e-6, true);
+  }
+
+  // the iterative solver with shared 'c' parameters
+  {
+    vnl_vector<double> sc(1,1.5), sproj(crs.num_non_zero(),0.0);
+    bundle_2d_shared gen_shared(num_cam,num_pts,sproj,mask);
+    gen_shared.f(a,b,sc,sproj);
+
+    vnl_vector<double> da(a0), db(b0), dc(1,1.4);
+    vnl_vector<double> ia(a0), ib(b0), ic(1,1.4);
+    bundle_2d_shared dense_func(num_cam,num_pts,sproj,mask);
+    bundle_2d_shared iter_func(num_cam,num_pts,sproj,mask);
+    vnl_sparse_lm dense_lm(dense_func), iter_lm(iter_func);
+    dense_lm.set_max_function_evals(100);
+    iter_lm.set_max_function_evals(100);
+    iter_lm.set_use_iterative_solver(true);
+    dense_lm.minimize(da,db,dc);
+    iter_lm.minimize(ia,ib,ic);
+    std::cout << "shared parameter error: dense " << dense_lm.get_end_error()
+              << " iterative " << iter_lm.get_end_error() << std::endl;
+    TEST("iterative solver with c reduces the error",
+         iter_lm.get_end_error() < 1e-3*iter_lm.get_start_error(), true);
+    TEST("iterative solver with c no worse than dense",
+         iter_lm.get_end_error() <= dense_lm.get_end_error(), true);
+    TEST_NEAR("iterative solver recovers c", ic[0], sc[0], 1e-6);
+  }
+}
+
 
 static void test_sparse_lm()
 {
   test_prob1();
   test_prob2();
   test_prob3();
+  test_prob4();
 }
 
 TESTMAIN(test_sparse_lm);
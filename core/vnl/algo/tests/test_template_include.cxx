@@ -6,6 +6,7 @@
 #include <vnl/algo/vnl_fft_2d.hxx>
 #include <vnl/algo/vnl_fft_base.hxx>
 #include <vnl/algo/vnl_fft_prime_factors.hxx>
+#include <vnl/algo/vnl_fft_plan.hxx>
 #include <vnl/algo/vnl_matrix_inverse.hxx>
 #include <vnl/algo/vnl_orthogonal_complement.hxx>
 #include <vnl/algo/vnl_qr.hxx>
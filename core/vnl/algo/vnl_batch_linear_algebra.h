@@ -0,0 +1,567 @@
+// This is core/vnl/algo/vnl_batch_linear_algebra.h
+#ifndef vnl_batch_linear_algebra_h_
+#define vnl_batch_linear_algebra_h_
+//:
+// \file
+// \brief Solve, invert and decompose many small matrices at once
+//
+// These functions apply the same small dense algorithm (LU or Cholesky
+// solve, inverse, determinant, symmetric eigensystem, SVD) to every
+// matrix of a vnl_matrix_fixed_batch.  The matrices are processed in tiles
+// of vnl_batch_lanes consecutive matrices which are copied into local
+// arrays, and every innermost loop runs across the matrices of a tile.
+// Choices which would normally be branches (pivot rows, whether a Jacobi
+// rotation is needed) are made with per-matrix selects instead, so the
+// loops vectorise and the cost per matrix falls with the SIMD width rather
+// than being dominated by call overhead.  Large batches are also split
+// across threads with vnl_parallel_for.
+//
+// Each matrix gives exactly the same result whatever the batch it is in
+// and whatever the number of threads.  Matrices for which a solve fails
+// (exactly singular for LU, not positive definite for Cholesky) give zero
+// results, like vnl_inverse(), and are counted in the return value.
+//
+// An output may be the same batch as an input of the same shape, e.g.
+// vnl_batch_inverse(A, A), since each tile is read before it is written.
+//
+// \code
+//   vnl_matrix_fixed_batch<double,3,3> H(n);
+//   vnl_matrix_fixed_batch<double,3,1> b(n), x;
+//   for (unsigned k = 0; k < n; ++k) { H.set(k, ...); b.set_column(k, ...); }
+//   unsigned n_singular = vnl_batch_lu_solve(H, b, x);
+// \endcode
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <vcl_compiler.h>
+#include <vnl/vnl_matrix_fixed_batch.h>
+#include <vnl/vnl_parallel_for.h>
+
+//: Number of matrices processed together in the innermost loops.
+const unsigned int vnl_batch_lanes = 32;
+
+//: Number of tiles of vnl_batch_lanes matrices, and a thread grain for matrices of size N.
+inline unsigned int vnl_batch_n_tiles(unsigned int n) { return (n + vnl_batch_lanes - 1) / vnl_batch_lanes; }
+inline unsigned int vnl_batch_grain(unsigned int N) { return 1 + 2048 / (N*N*N); }
+
+//: Copy matrices [k0, k0+w) of a batch into a tile.
+template <class T, unsigned int R, unsigned int C>
+inline void vnl_batch_load(vnl_matrix_fixed_batch<T,R,C> const& A, unsigned int k0, unsigned int w,
+                           T (&a)[R][C][vnl_batch_lanes])
+{
+  for (unsigned int r = 0; r < R; ++r)
+    for (unsigned int c = 0; c < C; ++c) {
+      T const* p = A.plane(r, c) + k0;
+      for (unsigned int l = 0; l < w; ++l)
+        a[r][c][l] = p[l];
+    }
+}
+
+//: Copy a tile into matrices [k0, k0+w) of a batch, zeroing those with ok[l] false.
+template <class T, unsigned int R, unsigned int C>
+inline void vnl_batch_store(T const (&a)[R][C][vnl_batch_lanes], bool const* ok, unsigned int k0, unsigned int w,
+                            vnl_matrix_fixed_batch<T,R,C>& A)
+{
+  for (unsigned int r = 0; r < R; ++r)
+    for (unsigned int c = 0; c < C; ++c) {
+      T* p = A.plane(r, c) + k0;
+      for (unsigned int l = 0; l < w; ++l)
+        p[l] = ok[l] ? a[r][c][l] : T(0);
+    }
+}
+
+//: Gaussian elimination with partial pivoting of w matrices a, applied to right hand sides b.
+// On return b holds the solutions and det the determinants; a is destroyed.
+template <class T, unsigned int N, unsigned int M>
+inline void vnl_batch_lu_tile(T (&a)[N][N][vnl_batch_lanes], T (&b)[N][M][vnl_batch_lanes],
+                              unsigned int w, T (&det)[vnl_batch_lanes])
+{
+  T inv_diag[N][vnl_batch_lanes];
+  unsigned int piv[vnl_batch_lanes];
+  T best[vnl_batch_lanes];
+  for (unsigned int l = 0; l < w; ++l)
+    det[l] = T(1);
+
+  for (unsigned int j = 0; j < N; ++j) {
+    for (unsigned int l = 0; l < w; ++l) {
+      piv[l] = j;
+      best[l] = std::abs(a[j][j][l]);
+    }
+    for (unsigned int r = j+1; r < N; ++r)
+      for (unsigned int l = 0; l < w; ++l) {
+        const T v = std::abs(a[r][j][l]);
+        const bool bigger = v > best[l];
+        best[l] = bigger ? v : best[l];
+        piv[l] = bigger ? r : piv[l];
+      }
+    // swap rows j and piv; the columns before j are no longer needed
+    for (unsigned int r = j+1; r < N; ++r) {
+      for (unsigned int c = j; c < N; ++c)
+        for (unsigned int l = 0; l < w; ++l) {
+          const bool s = piv[l] == r;
+          const T t = a[j][c][l], u = a[r][c][l];
+          a[j][c][l] = s ? u : t;
+          a[r][c][l] = s ? t : u;
+        }
+      for (unsigned int c = 0; c < M; ++c)
+        for (unsigned int l = 0; l < w; ++l) {
+          const bool s = piv[l] == r;
+          const T t = b[j][c][l], u = b[r][c][l];
+          b[j][c][l] = s ? u : t;
+          b[r][c][l] = s ? t : u;
+        }
+    }
+    for (unsigned int l = 0; l < w; ++l) {
+      const T d = a[j][j][l];
+      det[l] *= piv[l] == j ? d : -d;
+      inv_diag[j][l] = d != T(0) ? T(1)/d : T(0);
+    }
+    for (unsigned int r = j+1; r < N; ++r) {
+      T f[vnl_batch_lanes];
+      for (unsigned int l = 0; l < w; ++l)
+        f[l] = a[r][j][l] * inv_diag[j][l];
+      for (unsigned int c = j+1; c < N; ++c)
+        for (unsigned int l = 0; l < w; ++l)
+          a[r][c][l] -= f[l] * a[j][c][l];
+      for (unsigned int c = 0; c < M; ++c)
+        for (unsigned int l = 0; l < w; ++l)
+          b[r][c][l] -= f[l] * b[j][c][l];
+    }
+  }
+
+  // back substitution
+  for (unsigned int i = N; i-- > 0; )
+    for (unsigned int c = 0; c < M; ++c)
+      for (unsigned int l = 0; l < w; ++l) {
+        T s = b[i][c][l];
+        for (unsigned int k = i+1; k < N; ++k)
+          s -= a[i][k][l] * b[k][c][l];
+        b[i][c][l] = s * inv_diag[i][l];
+      }
+}
+
+//: Tiles of vnl_batch_lu_solve and vnl_batch_determinant.
+// When identity is set the right hand sides are the identity matrix, not *B.
+template <class T, unsigned int N, unsigned int M>
+struct vnl_batch_lu_tiles
+{
+  vnl_matrix_fixed_batch<T,N,N> const* A;
+  vnl_matrix_fixed_batch<T,N,M> const* B;
+  bool identity;
+  vnl_matrix_fixed_batch<T,N,M>* X;
+  std::vector<T>* det;
+  std::vector<unsigned int>* n_failed;
+
+  void operator()(unsigned int t0, unsigned int t1) const
+  {
+    const unsigned int n = A->size();
+    T a[N][N][vnl_batch_lanes], b[N][M][vnl_batch_lanes], d[vnl_batch_lanes];
+    bool ok[vnl_batch_lanes];
+    for (unsigned int t = t0; t < t1; ++t) {
+      const unsigned int k0 = t*vnl_batch_lanes, w = std::min(vnl_batch_lanes, n - k0);
+      vnl_batch_load(*A, k0, w, a);
+      if (B)
+        vnl_batch_load(*B, k0, w, b);
+      else
+        for (unsigned int r = 0; r < N; ++r)
+          for (unsigned int c = 0; c < M; ++c)
+            for (unsigned int l = 0; l < w; ++l)
+              b[r][c][l] = identity && r == c ? T(1) : T(0);
+      vnl_batch_lu_tile(a, b, w, d);
+      unsigned int failed = 0;
+      for (unsigned int l = 0; l < w; ++l) {
+        ok[l] = d[l] != T(0);
+        failed += ok[l] ? 0 : 1;
+      }
+      (*n_failed)[t] = failed;
+      if (X)
+        vnl_batch_store(b, ok, k0, w, *X);
+      if (det)
+        std::copy(d, d + w, det->begin() + k0);
+    }
+  }
+};
+
+//: Run the LU tiles over a batch; returns the number of singular matrices.
+template <class T, unsigned int N, unsigned int M>
+inline unsigned int vnl_batch_run_lu(vnl_batch_lu_tiles<T,N,M>& tiles)
+{
+  const unsigned int n_tiles = vnl_batch_n_tiles(tiles.A->size());
+  std::vector<unsigned int> n_failed(n_tiles, 0u);
+  tiles.n_failed = &n_failed;
+  vnl_parallel_for(0u, n_tiles, tiles, vnl_batch_grain(N));
+  unsigned int total = 0;
+  for (unsigned int t = 0; t < n_tiles; ++t)
+    total += n_failed[t];
+  return total;
+}
+
+//: Solve A[k] X[k] = B[k] for every k, by LU decomposition with partial pivoting.
+// Returns the number of exactly singular A[k], whose X[k] are set to zero.
+template <class T, unsigned int N, unsigned int M>
+unsigned int vnl_batch_lu_solve(vnl_matrix_fixed_batch<T,N,N> const& A,
+                                vnl_matrix_fixed_batch<T,N,M> const& B,
+                                vnl_matrix_fixed_batch<T,N,M>& X)
+{
+  X.set_size(A.size());
+  vnl_batch_lu_tiles<T,N,M> tiles = { &A, &B, false, &X, VXL_NULLPTR, VXL_NULLPTR };
+  return vnl_batch_run_lu(tiles);
+}
+
+//: Set Ainv[k] to the inverse of A[k] for every k.
+// Returns the number of exactly singular A[k], whose inverses are set to zero.
+template <class T, unsigned int N>
+unsigned int vnl_batch_inverse(vnl_matrix_fixed_batch<T,N,N> const& A,
+                               vnl_matrix_fixed_batch<T,N,N>& Ainv)
+{
+  Ainv.set_size(A.size());
+  vnl_batch_lu_tiles<T,N,N> tiles = { &A, VXL_NULLPTR, true, &Ainv, VXL_NULLPTR, VXL_NULLPTR };
+  return vnl_batch_run_lu(tiles);
+}
+
+//: Set det[k] to the determinant of A[k] for every k.
+template <class T, unsigned int N>
+void vnl_batch_determinant(vnl_matrix_fixed_batch<T,N,N> const& A, std::vector<T>& det)
+{
+  det.resize(A.size());
+  vnl_batch_lu_tiles<T,N,1> tiles = { &A, VXL_NULLPTR, false, VXL_NULLPTR, &det, VXL_NULLPTR };
+  vnl_batch_run_lu(tiles);
+}
+
+//: Tiles of vnl_batch_cholesky_solve.
+template <class T, unsigned int N, unsigned int M>
+struct vnl_batch_cholesky_tiles
+{
+  vnl_matrix_fixed_batch<T,N,N> const* A;
+  vnl_matrix_fixed_batch<T,N,M> const* B;
+  vnl_matrix_fixed_batch<T,N,M>* X;
+  std::vector<unsigned int>* n_failed;
+
+  void operator()(unsigned int t0, unsigned int t1) const
+  {
+    const unsigned int n = A->size();
+    T a[N][N][vnl_batch_lanes], b[N][M][vnl_batch_lanes], inv_diag[N][vnl_batch_lanes];
+    bool ok[vnl_batch_lanes];
+    for (unsigned int t = t0; t < t1; ++t) {
+      const unsigned int k0 = t*vnl_batch_lanes, w = std::min(vnl_batch_lanes, n - k0);
+      vnl_batch_load(*A, k0, w, a);
+      vnl_batch_load(*B, k0, w, b);
+      for (unsigned int l = 0; l < w; ++l)
+        ok[l] = true;
+
+      // A = L L', with L in the lower triangle of a
+      for (unsigned int j = 0; j < N; ++j) {
+        for (unsigned int l = 0; l < w; ++l) {
+          T d = a[j][j][l];
+          for (unsigned int k = 0; k < j; ++k)
+            d -= a[j][k][l] * a[j][k][l];
+          const bool positive = d > T(0);
+          ok[l] = ok[l] && positive;
+          const T ljj = std::sqrt(positive ? d : T(1));
+          a[j][j][l] = ljj;
+          inv_diag[j][l] = T(1) / ljj;
+        }
+        for (unsigned int r = j+1; r < N; ++r)
+          for (unsigned int l = 0; l < w; ++l) {
+            T s = a[r][j][l];
+            for (unsigned int k = 0; k < j; ++k)
+              s -= a[r][k][l] * a[j][k][l];
+            a[r][j][l] = s * inv_diag[j][l];
+          }
+      }
+
+      // L y = b, then L' x = y
+      for (unsigned int c = 0; c < M; ++c) {
+        for (unsigned int i = 0; i < N; ++i)
+          for (unsigned int l = 0; l < w; ++l) {
+            T s = b[i][c][l];
+            for (unsigned int k = 0; k < i; ++k)
+              s -= a[i][k][l] * b[k][c][l];
+            b[i][c][l] = s * inv_diag[i][l];
+          }
+        for (unsigned int i = N; i-- > 0; )
+          for (unsigned int l = 0; l < w; ++l) {
+            T s = b[i][c][l];
+            for (unsigned int k = i+1; k < N; ++k)
+              s -= a[k][i][l] * b[k][c][l];
+            b[i][c][l] = s * inv_diag[i][l];
+          }
+      }
+
+      unsigned int failed = 0;
+      for (unsigned int l = 0; l < w; ++l)
+        failed += ok[l] ? 0 : 1;
+      (*n_failed)[t] = failed;
+      vnl_batch_store(b, ok, k0, w, *X);
+    }
+  }
+};
+
+//: Solve A[k] X[k] = B[k] for every k, where the A[k] are symmetric positive definite.
+// Only the lower triangles of the A[k] are used.  Returns the number of
+// A[k] which are not numerically positive definite; their X[k] are set to zero.
+template <class T, unsigned int N, unsigned int M>
+unsigned int vnl_batch_cholesky_solve(vnl_matrix_fixed_batch<T,N,N> const& A,
+                                      vnl_matrix_fixed_batch<T,N,M> const& B,
+                                      vnl_matrix_fixed_batch<T,N,M>& X)
+{
+  X.set_size(A.size());
+  const unsigned int n_tiles = vnl_batch_n_tiles(A.size());
+  std::vector<unsigned int> n_failed(n_tiles, 0u);
+  vnl_batch_cholesky_tiles<T,N,M> tiles = { &A, &B, &X, &n_failed };
+  vnl_parallel_for(0u, n_tiles, tiles, vnl_batch_grain(N));
+  unsigned int total = 0;
+  for (unsigned int t = 0; t < n_tiles; ++t)
+    total += n_failed[t];
+  return total;
+}
+
+//: Apply the plane rotation (c, s) to columns p and q of w matrices a with R rows.
+template <class T, unsigned int R, unsigned int C>
+inline void vnl_batch_rotate_columns(T (&a)[R][C][vnl_batch_lanes], unsigned int p, unsigned int q,
+                                     T const* c, T const* s, unsigned int w)
+{
+  for (unsigned int k = 0; k < R; ++k)
+    for (unsigned int l = 0; l < w; ++l) {
+      const T akp = a[k][p][l], akq = a[k][q][l];
+      a[k][p][l] = c[l]*akp - s[l]*akq;
+      a[k][q][l] = s[l]*akp + c[l]*akq;
+    }
+}
+
+//: Swap columns p and q of w matrices a where swap[l] is set.
+template <class T, unsigned int R, unsigned int C>
+inline void vnl_batch_swap_columns(T (&a)[R][C][vnl_batch_lanes], unsigned int p, unsigned int q,
+                                   bool const* swap, unsigned int w)
+{
+  for (unsigned int k = 0; k < R; ++k)
+    for (unsigned int l = 0; l < w; ++l) {
+      const T akp = a[k][p][l], akq = a[k][q][l];
+      a[k][p][l] = swap[l] ? akq : akp;
+      a[k][q][l] = swap[l] ? akp : akq;
+    }
+}
+
+//: Tiles of vnl_batch_symmetric_eigensystem (cyclic Jacobi).
+template <class T, unsigned int N>
+struct vnl_batch_eigensystem_tiles
+{
+  vnl_matrix_fixed_batch<T,N,N> const* A;
+  vnl_matrix_fixed_batch<T,N,N>* V;
+  vnl_matrix_fixed_batch<T,N,1>* D;
+
+  void operator()(unsigned int t0, unsigned int t1) const
+  {
+    const unsigned int n = A->size();
+    const T eps = std::numeric_limits<T>::epsilon();
+    T a[N][N][vnl_batch_lanes], v[N][N][vnl_batch_lanes], d[N][1][vnl_batch_lanes];
+    T c[vnl_batch_lanes], s[vnl_batch_lanes], threshold[vnl_batch_lanes];
+    bool active[vnl_batch_lanes], ok[vnl_batch_lanes];
+    for (unsigned int t = t0; t < t1; ++t) {
+      const unsigned int k0 = t*vnl_batch_lanes, w = std::min(vnl_batch_lanes, n - k0);
+      // symmetric copy of the upper triangle
+      for (unsigned int r = 0; r < N; ++r)
+        for (unsigned int q = r; q < N; ++q) {
+          T const* p = A->plane(r, q) + k0;
+          for (unsigned int l = 0; l < w; ++l)
+            a[r][q][l] = a[q][r][l] = p[l];
+        }
+      for (unsigned int r = 0; r < N; ++r)
+        for (unsigned int q = 0; q < N; ++q)
+          for (unsigned int l = 0; l < w; ++l)
+            v[r][q][l] = r == q ? T(1) : T(0);
+      for (unsigned int l = 0; l < w; ++l) {
+        T norm = T(0);
+        for (unsigned int r = 0; r < N; ++r)
+          for (unsigned int q = 0; q < N; ++q)
+            norm += a[r][q][l] * a[r][q][l];
+        threshold[l] = eps * eps * norm;
+        ok[l] = true;
+      }
+
+      // A matrix is rotated only while its own off-diagonal part is
+      // significant; otherwise its rotations are exactly the identity.
+      for (unsigned int sweep = 0; sweep < 50; ++sweep) {
+        bool any = false;
+        for (unsigned int l = 0; l < w; ++l) {
+          T off = T(0);
+          for (unsigned int r = 0; r < N; ++r)
+            for (unsigned int q = r+1; q < N; ++q)
+              off += a[r][q][l] * a[r][q][l];
+          active[l] = off > threshold[l];
+          any = any || active[l];
+        }
+        if (!any)
+          break;
+        for (unsigned int p = 0; p < N; ++p)
+          for (unsigned int q = p+1; q < N; ++q) {
+            for (unsigned int l = 0; l < w; ++l) {
+              const T apq = a[p][q][l];
+              const bool rotate = active[l] && apq != T(0);
+              const T theta = (a[q][q][l] - a[p][p][l]) / (rotate ? 2*apq : T(1));
+              T tn = (theta >= T(0) ? T(1) : T(-1)) / (std::abs(theta) + std::sqrt(theta*theta + T(1)));
+              tn = rotate ? tn : T(0);
+              c[l] = T(1) / std::sqrt(tn*tn + T(1));
+              s[l] = tn * c[l];
+            }
+            // A <- J' A J and V <- V J
+            vnl_batch_rotate_columns(a, p, q, c, s, w);
+            for (unsigned int k = 0; k < N; ++k)
+              for (unsigned int l = 0; l < w; ++l) {
+                const T apk = a[p][k][l], aqk = a[q][k][l];
+                a[p][k][l] = c[l]*apk - s[l]*aqk;
+                a[q][k][l] = s[l]*apk + c[l]*aqk;
+              }
+            vnl_batch_rotate_columns(v, p, q, c, s, w);
+          }
+      }
+
+      // eigenvalues in increasing order, as vnl_symmetric_eigensystem
+      for (unsigned int r = 0; r < N; ++r)
+        for (unsigned int l = 0; l < w; ++l)
+          d[r][0][l] = a[r][r][l];
+      for (unsigned int i = 0; i+1 < N; ++i)
+        for (unsigned int j = 0; j+1 < N-i; ++j) {
+          bool swap[vnl_batch_lanes];
+          for (unsigned int l = 0; l < w; ++l)
+            swap[l] = d[j][0][l] > d[j+1][0][l];
+          vnl_batch_swap_columns(v, j, j+1, swap, w);
+          for (unsigned int l = 0; l < w; ++l) {
+            const T dj = d[j][0][l], dk = d[j+1][0][l];
+            d[j][0][l] = swap[l] ? dk : dj;
+            d[j+1][0][l] = swap[l] ? dj : dk;
+          }
+        }
+      vnl_batch_store(v, ok, k0, w, *V);
+      vnl_batch_store(d, ok, k0, w, *D);
+    }
+  }
+};
+
+//: Eigenvalues D[k] and eigenvectors (columns of V[k]) of the symmetric A[k], for every k.
+// Only the upper triangles of the A[k] are used.  As in
+// vnl_symmetric_eigensystem the eigenvalues are in increasing order.
+// Uses the cyclic Jacobi method, which is accurate for small matrices.
+template <class T, unsigned int N>
+void vnl_batch_symmetric_eigensystem(vnl_matrix_fixed_batch<T,N,N> const& A,
+                                     vnl_matrix_fixed_batch<T,N,N>& V,
+                                     vnl_matrix_fixed_batch<T,N,1>& D)
+{
+  V.set_size(A.size());
+  D.set_size(A.size());
+  vnl_batch_eigensystem_tiles<T,N> tiles = { &A, &V, &D };
+  vnl_parallel_for(0u, vnl_batch_n_tiles(A.size()), tiles, vnl_batch_grain(N));
+}
+
+//: Tiles of vnl_batch_svd (one-sided Jacobi).
+template <class T, unsigned int R, unsigned int C>
+struct vnl_batch_svd_tiles
+{
+  vnl_matrix_fixed_batch<T,R,C> const* A;
+  vnl_matrix_fixed_batch<T,R,C>* U;
+  vnl_matrix_fixed_batch<T,C,1>* W;
+  vnl_matrix_fixed_batch<T,C,C>* V;
+
+  void operator()(unsigned int t0, unsigned int t1) const
+  {
+    const unsigned int n = A->size();
+    const T eps = std::numeric_limits<T>::epsilon();
+    T a[R][C][vnl_batch_lanes], v[C][C][vnl_batch_lanes], sv[C][1][vnl_batch_lanes];
+    T c[vnl_batch_lanes], s[vnl_batch_lanes];
+    bool ok[vnl_batch_lanes];
+    for (unsigned int t = t0; t < t1; ++t) {
+      const unsigned int k0 = t*vnl_batch_lanes, w = std::min(vnl_batch_lanes, n - k0);
+      vnl_batch_load(*A, k0, w, a);
+      for (unsigned int r = 0; r < C; ++r)
+        for (unsigned int q = 0; q < C; ++q)
+          for (unsigned int l = 0; l < w; ++l)
+            v[r][q][l] = r == q ? T(1) : T(0);
+      for (unsigned int l = 0; l < w; ++l)
+        ok[l] = true;
+
+      // Rotate pairs of columns of A until they are all orthogonal; A V = U W.
+      for (unsigned int sweep = 0; sweep < 60; ++sweep) {
+        bool any = false;
+        for (unsigned int p = 0; p < C; ++p)
+          for (unsigned int q = p+1; q < C; ++q) {
+            for (unsigned int l = 0; l < w; ++l) {
+              T alpha = T(0), beta = T(0), gamma = T(0);
+              for (unsigned int i = 0; i < R; ++i) {
+                alpha += a[i][p][l] * a[i][p][l];
+                beta  += a[i][q][l] * a[i][q][l];
+                gamma += a[i][p][l] * a[i][q][l];
+              }
+              const bool rotate = std::abs(gamma) > eps * std::sqrt(alpha*beta);
+              any = any || rotate;
+              const T zeta = (beta - alpha) / (rotate ? 2*gamma : T(1));
+              T tn = (zeta >= T(0) ? T(1) : T(-1)) / (std::abs(zeta) + std::sqrt(zeta*zeta + T(1)));
+              tn = rotate ? tn : T(0);
+              c[l] = T(1) / std::sqrt(tn*tn + T(1));
+              s[l] = tn * c[l];
+            }
+            vnl_batch_rotate_columns(a, p, q, c, s, w);
+            vnl_batch_rotate_columns(v, p, q, c, s, w);
+          }
+        if (!any)
+          break;
+      }
+
+      // W = column norms, U = normalised columns
+      for (unsigned int q = 0; q < C; ++q)
+        for (unsigned int l = 0; l < w; ++l) {
+          T norm = T(0);
+          for (unsigned int i = 0; i < R; ++i)
+            norm += a[i][q][l] * a[i][q][l];
+          norm = std::sqrt(norm);
+          sv[q][0][l] = norm;
+          const T scale = norm > T(0) ? T(1)/norm : T(0);
+          for (unsigned int i = 0; i < R; ++i)
+            a[i][q][l] *= scale;
+        }
+
+      // singular values in decreasing order, as vnl_svd
+      for (unsigned int i = 0; i+1 < C; ++i)
+        for (unsigned int j = 0; j+1 < C-i; ++j) {
+          bool swap[vnl_batch_lanes];
+          for (unsigned int l = 0; l < w; ++l)
+            swap[l] = sv[j][0][l] < sv[j+1][0][l];
+          vnl_batch_swap_columns(a, j, j+1, swap, w);
+          vnl_batch_swap_columns(v, j, j+1, swap, w);
+          for (unsigned int l = 0; l < w; ++l) {
+            const T sj = sv[j][0][l], sk = sv[j+1][0][l];
+            sv[j][0][l] = swap[l] ? sk : sj;
+            sv[j+1][0][l] = swap[l] ? sj : sk;
+          }
+        }
+      vnl_batch_store(a, ok, k0, w, *U);
+      vnl_batch_store(sv, ok, k0, w, *W);
+      vnl_batch_store(v, ok, k0, w, *V);
+    }
+  }
+};
+
+//: Singular value decomposition A[k] = U[k] diag(W[k]) V[k]' for every k.
+// R must be at least C.  As in vnl_svd the singular values are in
+// decreasing order.  Uses the one-sided Jacobi method, which is accurate
+// for small matrices; columns of U for zero singular values are zero.
+template <class T, unsigned int R, unsigned int C>
+void vnl_batch_svd(vnl_matrix_fixed_batch<T,R,C> const& A,
+                   vnl_matrix_fixed_batch<T,R,C>& U,
+                   vnl_matrix_fixed_batch<T,C,1>& W,
+                   vnl_matrix_fixed_batch<T,C,C>& V)
+{
+  VXL_STATIC_ASSERT(R >= C);
+  U.set_size(A.size());
+  W.set_size(A.size());
+  V.set_size(A.size());
+  vnl_batch_svd_tiles<T,R,C> tiles = { &A, &U, &W, &V };
+  vnl_parallel_for(0u, vnl_batch_n_tiles(A.size()), tiles, vnl_batch_grain(C));
+}
+
+#endif // vnl_batch_linear_algebra_h_
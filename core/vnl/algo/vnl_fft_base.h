@@ -21,6 +21,8 @@ struct vnl_fft_base
   vnl_fft_base() { }
 
   //: dir = +1/-1 according to direction of transform.
+  // The signals along each dimension are transformed in batches, which
+  // are split across threads by vnl_parallel_for for large signals.
   void transform(std::complex<T> *signal, int dir);
 
  protected:
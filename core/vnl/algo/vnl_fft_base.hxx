@@ -4,14 +4,59 @@
   fsm
 */
 #include "vnl_fft_base.h"
+#include <algorithm>
+#include <vnl/vnl_parallel_for.h>
 #include <vnl/algo/vnl_fft.h>
 #include <vcl_cassert.h>
 
+//: Transforms a set of equally spaced signals, a batch at a time.
+// The signals are indexed by (o, l) with 0 <= o < n_outer, 0 <= l < n_inner;
+// signal (o, l) starts at signal[o*outer_step + l*jump] and its elements are
+// inc apart (all in units of std::complex<T>).  Index t of the range covers
+// signals l in [b*batch, (b+1)*batch) of o, where t = o*n_batches + b.
+template <class T>
+struct vnl_fft_base_lines
+{
+  std::complex<T>* signal;
+  vnl_fft_prime_factors<T> const* factors;
+  long inc, jump, outer_step;
+  int n_inner, batch, n_batches, dir;
+
+  void operator()(unsigned begin, unsigned end) const
+  {
+    for (unsigned t = begin; t < end; ++t) {
+      const int o = int(t) / n_batches;
+      const int l0 = (int(t) % n_batches) * batch;
+      const int lot = std::min(batch, n_inner - l0);
+      // This relies on the assumption that std::complex<T> is layout
+      // compatible with "struct { T real; T imag; }". It is probably
+      // a valid assumption for all sane C++ libraries.
+      T *data = (T *) (signal + o*outer_step + l0*jump);
+
+      long info = 0;
+      vnl_fft_gpfa (/* A */     data,
+                    /* B */     data + 1,
+                    /* TRIGS */ factors->trigs (),
+                    /* INC */   2*inc,
+                    /* JUMP */  2*jump,
+                    /* N */     factors->number (),
+                    /* LOT */   lot,
+                    /* ISIGN */ dir,
+                    /* NIPQ */  factors->pqr (),
+                    /* INFO */  &info);
+      assert(info != -1);
+    }
+  }
+};
+
 template <int D, class T>
 void vnl_fft_base<D, T>::transform(std::complex<T> *signal, int dir)
 {
   assert((dir == +1) || (dir == -1));
 
+  // Signals per call to the GPFA, whose inner loops run across the batch.
+  const int batch = 64;
+
   // transform along each dimension, i, in turn.
   for (int i=0; i<D; ++i) {
     int N1 = 1; // n[0] n[1] ... n[i-1]
@@ -25,31 +70,35 @@ void vnl_fft_base<D, T>::transform(std::complex<T> *signal, int dir)
     }
 
     // pretend the signal is N1xN2xN3. we want to transform
-    // along the second dimension.
-    for (int n1=0; n1<N1; ++n1) {
-      // FIXME: we could avoid one loop by using the LOT parameter
-      // but it's not entirely clear that would save us anything.
-
-      for (int n3=0; n3<N3; ++n3) {
-        // This relies on the assumption that std::complex<T> is layout
-        // compatible with "struct { T real; T imag; }". It is probably
-        // a valid assumption for all sane C++ libraries.
-        T *data = (T *) (signal + n1*N2*N3 + n3);
-
-        long info = 0;
-        vnl_fft_gpfa (/* A */     data,
-                      /* B */     data + 1,
-                      /* TRIGS */ factors_[i].trigs (),
-                      /* INC */   2*N3,
-                      /* JUMP */  0,
-                      /* N */     N2,
-                      /* LOT */   1,
-                      /* ISIGN */ dir,
-                      /* NIPQ */  factors_[i].pqr (),
-                      /* INFO */  &info);
-        assert(info != -1);
-      }
+    // along the second dimension.  The N3 signals of each n1 are
+    // adjacent, so batch those; along the last dimension batch over n1.
+    vnl_fft_base_lines<T> lines;
+    lines.signal = signal;
+    lines.factors = &factors_[i];
+    lines.batch = batch;
+    lines.dir = dir;
+    int n_outer;
+    if (N3 > 1) {
+      n_outer = N1;
+      lines.outer_step = long(N2)*N3;
+      lines.n_inner = N3;
+      lines.inc = N3;
+      lines.jump = 1;
     }
+    else {
+      n_outer = 1;
+      lines.outer_step = 0;
+      lines.n_inner = N1;
+      lines.inc = 1;
+      lines.jump = N2;
+    }
+    lines.n_batches = (lines.n_inner + batch - 1) / batch;
+
+    // Each batch is transformed independently, so the result does not
+    // depend on the number of threads.  Keep at least about 64k
+    // elements per thread.
+    const unsigned grain = 1 + 65536u / unsigned(batch*N2);
+    vnl_parallel_for(0u, unsigned(n_outer*lines.n_batches), lines, grain);
   }
 }
 
@@ -0,0 +1,83 @@
+// This is core/vnl/algo/vnl_fft_plan.h
+#ifndef vnl_fft_plan_h_
+#define vnl_fft_plan_h_
+//:
+// \file
+// \brief Reusable FFT plan for one signal length, with real transforms
+//
+// A vnl_fft_plan holds the twiddle factors for transforms of length N, so
+// that they are computed once rather than on every call.  vnl_fft_plan<T>::get(N)
+// returns a plan from a process-wide cache; the plans are immutable, so the
+// same plan may be used by several threads at once.
+//
+// Besides batches of complex transforms, a plan computes the transform of
+// a real signal.  For even N this is done with one complex transform of
+// length N/2 followed by an O(N) split, which is about half the work of
+// transforming the signal as complex data.  Only the N/2+1 non-redundant
+// coefficients are returned; the others are their complex conjugates.
+//
+// The sign convention is that of vnl_fft_1d: the forward transform is
+// X(k) = sum_n x(n) exp(+2 pi i n k/N), and neither direction is scaled.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <complex>
+#include <vector>
+#include <vcl_compiler.h>
+#include <vnl/algo/vnl_fft_prime_factors.h>
+#include "vnl/vnl_export.h"
+
+//: Twiddle factors and transforms for signals of one length.
+template <class T>
+class VNL_EXPORT vnl_fft_plan
+{
+ public:
+  //: Plan for signals of length N, which must be of the form 2^p 3^q 5^r.
+  explicit vnl_fft_plan(int N);
+
+  //: The shared plan for signals of length N, built on first use.
+  // The cache is guarded by a mutex when threads are available.
+  static vnl_fft_plan<T> const& get(int N);
+
+  //: Length of the signal.
+  int size() const { return n_; }
+
+  //: Number of coefficients in the transform of a real signal, N/2+1.
+  int real_size() const { return n_/2 + 1; }
+
+  //: Prime factorisation and twiddle factors for the complex transform.
+  vnl_fft_prime_factors<T> const& factors() const { return factors_; }
+
+  //: \p lot in-place complex transforms; dir = +1/-1 as for vnl_fft_1d.
+  // Element k of signal l is data[l*jump + k*inc], strides in units of
+  // std::complex<T>.  Batching the signals into one call lets the inner
+  // loops of the transform run across the batch.
+  void transform(std::complex<T>* data, long inc, long jump, long lot, int dir) const;
+
+  //: Forward transform of the N real values \p in into real_size() coefficients.
+  void fwd_real(T const* in, std::complex<T>* out) const;
+
+  //: Backward transform of real_size() coefficients into N real values.
+  // The coefficients are taken as one half of a conjugate-symmetric
+  // spectrum; \p in and \p out must not overlap.
+  void bwd_real(std::complex<T> const* in, T* out) const;
+
+ private:
+  int n_;
+  //: For the complex transform of length N.
+  vnl_fft_prime_factors<T> factors_;
+  //: For the complex transform of length N/2, when N is even and at least 4.
+  vnl_fft_prime_factors<T> half_factors_;
+  //: exp(2 pi i k/N) for k = 0 .. N/4, used to split the half-length transform.
+  std::vector<std::complex<T> > twiddles_;
+
+  bool use_half() const { return n_ % 2 == 0 && n_ >= 4; }
+
+  // disallow copying
+  vnl_fft_plan(vnl_fft_plan<T> const&);
+  vnl_fft_plan<T>& operator=(vnl_fft_plan<T> const&);
+};
+
+#endif // vnl_fft_plan_h_
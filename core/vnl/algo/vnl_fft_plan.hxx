@@ -0,0 +1,150 @@
+// This is core/vnl/algo/vnl_fft_plan.hxx
+#ifndef vnl_fft_plan_hxx_
+#define vnl_fft_plan_hxx_
+//:
+// \file
+
+#include <cmath>
+#include <map>
+#include "vnl_fft_plan.h"
+#include <vnl/algo/vnl_fft.h>
+#include <vcl_cassert.h>
+#if VXL_FULLCXX11SUPPORT
+# include <mutex>
+#endif
+
+//: The plans handed out by vnl_fft_plan<T>::get(), deleted at exit.
+template <class T>
+struct vnl_fft_plan_cache
+{
+  std::map<int, vnl_fft_plan<T>*> plans;
+#if VXL_FULLCXX11SUPPORT
+  std::mutex mutex;
+#endif
+
+  ~vnl_fft_plan_cache()
+  {
+    typename std::map<int, vnl_fft_plan<T>*>::iterator it = plans.begin();
+    for (; it != plans.end(); ++it)
+      delete it->second;
+  }
+};
+
+template <class T>
+vnl_fft_plan<T>::vnl_fft_plan(int N)
+  : n_(N)
+  , factors_(N)
+{
+  if (use_half()) {
+    const int M = N/2;
+    half_factors_.resize(M);
+    twiddles_.resize(M/2 + 1);
+    const double two_pi_over_n = 8.0*std::atan(1.0)/N;
+    for (int k = 0; k <= M/2; ++k)
+      twiddles_[k] = std::complex<T>(T(std::cos(two_pi_over_n*k)), T(std::sin(two_pi_over_n*k)));
+  }
+}
+
+template <class T>
+vnl_fft_plan<T> const& vnl_fft_plan<T>::get(int N)
+{
+  static vnl_fft_plan_cache<T> cache;
+#if VXL_FULLCXX11SUPPORT
+  std::lock_guard<std::mutex> lock(cache.mutex);
+#endif
+  vnl_fft_plan<T>*& plan = cache.plans[N];
+  if (!plan)
+    plan = new vnl_fft_plan<T>(N);
+  return *plan;
+}
+
+template <class T>
+void vnl_fft_plan<T>::transform(std::complex<T>* data, long inc, long jump, long lot, int dir) const
+{
+  assert((dir == +1) || (dir == -1));
+  // This relies on std::complex<T> being layout compatible with
+  // "struct { T real; T imag; }", as vnl_fft_base does.
+  T* a = reinterpret_cast<T*>(data);
+  long info = 0;
+  vnl_fft_gpfa(a, a + 1, factors_.trigs(), 2*inc, 2*jump, n_, lot, dir, factors_.pqr(), &info);
+  assert(info != -1);
+}
+
+template <class T>
+void vnl_fft_plan<T>::fwd_real(T const* in, std::complex<T>* out) const
+{
+  if (!use_half()) {
+    std::vector<std::complex<T> > buf(in, in + n_);
+    transform(&buf[0], 1, 0, 1, +1);
+    for (int k = 0; k < real_size(); ++k)
+      out[k] = buf[k];
+    return;
+  }
+
+  // Pack the even and odd samples as one complex signal z of length M
+  // and transform it: Z(k) = E(k) + i O(k), where E and O are the
+  // transforms of the even and odd samples.
+  const int M = n_/2;
+  for (int m = 0; m < M; ++m)
+    out[m] = std::complex<T>(in[2*m], in[2*m+1]);
+  T* a = reinterpret_cast<T*>(out);
+  long info = 0;
+  vnl_fft_gpfa(a, a + 1, half_factors_.trigs(), 2, 0, M, 1, +1, half_factors_.pqr(), &info);
+  assert(info != -1);
+
+  // X(k) = E(k) + w^k O(k) and X(M-k) = conj(E(k) - w^k O(k)).
+  const T re0 = out[0].real(), im0 = out[0].imag();
+  out[0] = std::complex<T>(re0 + im0, T(0));
+  out[M] = std::complex<T>(re0 - im0, T(0));
+  const std::complex<T> minus_half_i(T(0), T(-0.5));
+  for (int k = 1; 2*k <= M; ++k) {
+    const std::complex<T> zk = out[k], zj = std::conj(out[M-k]);
+    const std::complex<T> e = T(0.5)*(zk + zj);
+    const std::complex<T> wo = twiddles_[k] * (minus_half_i*(zk - zj));
+    out[k] = e + wo;
+    if (k != M-k)
+      out[M-k] = std::conj(e - wo);
+  }
+}
+
+template <class T>
+void vnl_fft_plan<T>::bwd_real(std::complex<T> const* in, T* out) const
+{
+  if (!use_half()) {
+    std::vector<std::complex<T> > buf(n_);
+    for (int k = 0; k < real_size(); ++k)
+      buf[k] = in[k];
+    for (int k = real_size(); k < n_; ++k)
+      buf[k] = std::conj(in[n_-k]);
+    transform(&buf[0], 1, 0, 1, -1);
+    for (int k = 0; k < n_; ++k)
+      out[k] = buf[k].real();
+    return;
+  }
+
+  // Rebuild Z(k) = E(k) + i O(k) (scaled by 2, which makes the result
+  // unnormalised with respect to N rather than M) and transform it back
+  // into the interleaved even and odd samples.
+  const int M = n_/2;
+  std::complex<T>* z = reinterpret_cast<std::complex<T>*>(out);
+  const std::complex<T> i(T(0), T(1));
+  z[0] = (in[0] + std::conj(in[M])) + i*(in[0] - std::conj(in[M]));
+  for (int k = 1; 2*k <= M; ++k) {
+    const std::complex<T> xk = in[k], xj = std::conj(in[M-k]);
+    const std::complex<T> e = xk + xj;
+    const std::complex<T> o = (xk - xj) * std::conj(twiddles_[k]);
+    z[k] = e + i*o;
+    if (k != M-k)
+      z[M-k] = std::conj(e) + i*std::conj(o);
+  }
+  long info = 0;
+  vnl_fft_gpfa(out, out + 1, half_factors_.trigs(), 2, 0, M, 1, -1, half_factors_.pqr(), &info);
+  assert(info != -1);
+}
+
+#undef VNL_FFT_PLAN_INSTANTIATE
+#define VNL_FFT_PLAN_INSTANTIATE(T) \
+template struct vnl_fft_plan_cache<T >; \
+template class VNL_EXPORT vnl_fft_plan<T >
+
+#endif // vnl_fft_plan_hxx_
@@ -10,6 +10,8 @@
 //-----------------------------------------------------------------------------
 
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 #include "vnl_levenberg_marquardt.h"
 
 #include <vcl_cassert.h>
@@ -22,6 +24,43 @@
 #include <vnl/vnl_matrix_ref.h>
 #include <vnl/vnl_least_squares_function.h>
 #include <vnl/algo/vnl_netlib.h> // lmdif_()
+#include <vul/vul_tracing.h>
+
+//: State shared with lmdif_parallel_lsqfun, which lmder calls in place of lmdif
+struct vnl_levenberg_marquardt_fd_state
+{
+  vnl_levenberg_marquardt* self;
+  long* maxfev;  // the limit seen by lmder, reduced by n for each Jacobian
+};
+
+//: Columns [j0,j1) of the forward difference Jacobian, exactly as in minpack's fdjac2
+struct vnl_levenberg_marquardt_fd_columns
+{
+  vnl_least_squares_function* f;
+  double const* x;
+  double const* fx;
+  double* fjac;  // m*n, column major
+  long m, n;
+  double eps;
+
+  void operator()(unsigned int j0, unsigned int j1) const
+  {
+    vnl_vector<double> tx(x, n), wa(m);
+    for (unsigned int j=j0; j<j1; ++j)
+    {
+      double temp = x[j];
+      double h = eps * std::fabs(temp);
+      if (h == 0.0)
+        h = eps;
+      tx[j] = temp + h;
+      f->f(tx, wa);
+      tx[j] = temp;
+      double* col = fjac + j*m;
+      for (long i=0; i<m; ++i)
+        col[i] = (wa[i] - fx[i]) / h;
+    }
+  }
+};
 
 // see header
 vnl_vector<double> vnl_levenberg_marquardt_minimize(vnl_least_squares_function& f,
@@ -93,7 +132,10 @@ void vnl_levenberg_marquardt::lmdif_lsqfun(long* n,     // I   Number of residua
 
     f->trace(self->num_iterations_, ref_x, ref_fx);
     ++(self->num_iterations_);
+    VUL_TRACE_COUNTER("vnl_levenberg_marquardt.iterations", 1);
+    VUL_TRACE_VALUE("vnl_levenberg_marquardt rms error", ref_fx.rms());
   } else {
+    VUL_TRACE_SCOPE("vnl_levenberg_marquardt f");
     f->f(ref_x, ref_fx);
   }
 
@@ -123,9 +165,47 @@ bool vnl_levenberg_marquardt::minimize(vnl_vector<double>& x)
 }
 
 
+//: lmder callback which computes the forward difference Jacobian in parallel
+void vnl_levenberg_marquardt::lmdif_parallel_lsqfun(long* n,     // I   Number of residuals
+                                                    long* p,     // I   Number of unknowns
+                                                    double* x,  // I   Solution vector, size n
+                                                    double* fx, // IO  Residual vector f(x)
+                                                    double* fJ, // O   m * n Jacobian f(x)
+                                                    long*,
+                                                    long* iflag, // I   1 -> calc fx, 2 -> calc fjac
+                                                    void* userdata)
+{
+  vnl_levenberg_marquardt_fd_state* state =
+    static_cast<vnl_levenberg_marquardt_fd_state*>(userdata);
+  vnl_levenberg_marquardt* self = state->self;
+  if (*iflag != 2) {
+    lmdif_lsqfun(n, p, x, fx, iflag, self);
+    return;
+  }
+
+  VUL_TRACE_SCOPE("vnl_levenberg_marquardt fdjac");
+  vnl_least_squares_function* f = self->f_;
+  // lmdif counts the n evaluations of each Jacobian towards maxfev
+  *state->maxfev -= *p;
+
+  // step length as in fdjac2
+  v3p_netlib_integer c__1 = 1;
+  const double epsmch = v3p_netlib_dpmpar_(&c__1);
+  const double eps = std::sqrt(std::max(self->epsfcn, epsmch));
+  vnl_levenberg_marquardt_fd_columns columns = { f, x, fx, fJ, *n, *p, eps };
+  vnl_least_squares_function_parallel_for(0, (unsigned int)(*p), columns);
+
+  if (f->failure) {
+    f->clear_failure();
+    *iflag = -1; // fsm
+  }
+}
+
+
 //
 bool vnl_levenberg_marquardt::minimize_without_gradient(vnl_vector<double>& x)
 {
+  VUL_TRACE_SCOPE("vnl_levenberg_marquardt::minimize_without_gradient");
   //fsm
   if (f_->has_gradient()) {
     std::cerr << __FILE__ " : WARNING. calling minimize_without_gradient(), but f_ has gradient.\n";
@@ -167,18 +247,42 @@ bool vnl_levenberg_marquardt::minimize_without_gradient(vnl_vector<double>& x)
   set_covariance_ = false;
   long info;
   start_error_ = 0; // Set to 0 so first call to lmdif_lsqfun will know to set it.
-  v3p_netlib_lmdif_(
-         lmdif_lsqfun, &m, &n,
-         x.data_block(),
-         fx.data_block(),
-         &ftol, &xtol, &gtol, &maxfev, &epsfcn,
-         &diag[0],
-         &user_provided_scale_factors, &factor, &nprint,
-         &info, &num_evaluations_,
-         fdjac_.data_block(), &m, ipvt_.data_block(),
-         &qtf[0],
-         &wa1[0], &wa2[0], &wa3[0], &wa4[0],
-         this);
+  if (f_->is_thread_safe())
+  {
+    // lmdif is lmder with the Jacobian from fdjac2, which evaluates the
+    // columns one after the other; compute them in parallel instead
+    long maxfev_left = maxfev, njev = 0;
+    vnl_levenberg_marquardt_fd_state state = { this, &maxfev_left };
+    v3p_netlib_lmder_(
+           lmdif_parallel_lsqfun, &m, &n,
+           x.data_block(),
+           fx.data_block(),
+           fdjac_.data_block(), &m,
+           &ftol, &xtol, &gtol, &maxfev_left,
+           &diag[0],
+           &user_provided_scale_factors, &factor, &nprint,
+           &info, &num_evaluations_, &njev,
+           ipvt_.data_block(),
+           &qtf[0],
+           &wa1[0], &wa2[0], &wa3[0], &wa4[0],
+           &state);
+    num_evaluations_ += njev * n;
+  }
+  else
+  {
+    v3p_netlib_lmdif_(
+           lmdif_lsqfun, &m, &n,
+           x.data_block(),
+           fx.data_block(),
+           &ftol, &xtol, &gtol, &maxfev, &epsfcn,
+           &diag[0],
+           &user_provided_scale_factors, &factor, &nprint,
+           &info, &num_evaluations_,
+           fdjac_.data_block(), &m, ipvt_.data_block(),
+           &qtf[0],
+           &wa1[0], &wa2[0], &wa3[0], &wa4[0],
+           this);
+  }
   failure_code_ = (ReturnCodes) info;
 
   // One more call to compute final error.
@@ -227,14 +331,18 @@ void vnl_levenberg_marquardt::lmder_lsqfun(long* n,     // I   Number of residua
                << x[0] << ", " << x[1] << ", " << x[2] << ", " << x[3] << ", "
                << x[4] << ", ... ] = " << ref_fx.magnitude() << '\n';
     f->trace(self->num_iterations_, ref_x, ref_fx);
+    VUL_TRACE_VALUE("vnl_levenberg_marquardt rms error", ref_fx.rms());
   }
   else if (*iflag == 1) {
+    VUL_TRACE_SCOPE("vnl_levenberg_marquardt f");
     f->f(ref_x, ref_fx);
     if (self->start_error_ == 0)
       self->start_error_ = ref_fx.rms();
     ++(self->num_iterations_);
+    VUL_TRACE_COUNTER("vnl_levenberg_marquardt.iterations", 1);
   }
   else if (*iflag == 2) {
+    VUL_TRACE_SCOPE("vnl_levenberg_marquardt gradf");
     f->gradf(ref_x, ref_fJ);
     ref_fJ.inplace_transpose();
 
@@ -283,6 +391,7 @@ void vnl_levenberg_marquardt::lmder_lsqfun(long* n,     // I   Number of residua
 //
 bool vnl_levenberg_marquardt::minimize_using_gradient(vnl_vector<double>& x)
 {
+  VUL_TRACE_SCOPE("vnl_levenberg_marquardt::minimize_using_gradient");
   //fsm
   if (! f_->has_gradient()) {
     std::cerr << __FILE__ ": called method minimize_using_gradient(), but f_ has no gradient.\n";
@@ -17,6 +17,7 @@
 //  RWMC 001097 Added verbose flag to get rid of all that blathering.
 //  AWF  151197 Added trace flag to increase blather.
 //   Feb.2002 - Peter Vanroose - brief doxygen comment placed on single line
+//   Finite difference Jacobians of thread safe functions are computed in parallel
 // \endverbatim
 //
 
@@ -38,6 +39,10 @@ class vnl_least_squares_function;
 //  one function evaluation per dimension, but is perfectly accurate.
 //  (See Hartley in ``Applications of Invariance in Computer Vision''
 //  for example).
+//
+//  If the function has been marked with set_thread_safe(true), those
+//  evaluations are done in parallel (see vnl_parallel_for), with the same
+//  result as lmdif would give.
 
 class vnl_levenberg_marquardt : public vnl_nonlinear_minimizer
 {
@@ -95,6 +100,9 @@ class vnl_levenberg_marquardt : public vnl_nonlinear_minimizer
   static void lmder_lsqfun(long* m, long* n, double* x,
                            double* fx, double* fJ, long*, long* iflag,
                            void* userdata);
+  static void lmdif_parallel_lsqfun(long* m, long* n, double* x,
+                                    double* fx, double* fJ, long*, long* iflag,
+                                    void* userdata);
 };
 
 //: Find minimum of "f", starting at "initial_estimate", and return.
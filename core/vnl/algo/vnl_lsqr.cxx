@@ -54,17 +54,11 @@ int vnl_lsqr::minimize(vnl_vector<double>& result)
   long leniw = 1;
   long* iw = VXL_NULLPTR;
   long lenrw = m;
-#if defined __GNUC__ && !defined __STRICT_ANSI__
-  double rw[m];
-  double v[n];
-  double w[n];
-  double se[n];
-#else
+  // Not on the stack: large sparse systems would overflow it.
   std::vector<double> rw(m);
   std::vector<double> v(n);
   std::vector<double> w(n);
   std::vector<double> se(n);
-#endif
   double atol = 0;
   double btol = 0;
   double conlim = 0;
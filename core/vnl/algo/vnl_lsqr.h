@@ -11,7 +11,9 @@
 // vnl_lsqr implements an algorithm for large, sparse linear systems and
 // sparse, linear least squares. It is a wrapper for the LSQR algorithm
 // of Paige and Saunders (ACM TOMS 583). The sparse system is encapsulated
-// by a vnl_linear_system.
+// by a vnl_linear_system; for an explicit sparse matrix, use a
+// vnl_sparse_matrix_linear_system built from a vnl_csr_matrix, whose
+// products are multithreaded.
 //
 // \author David Capel, capes@robots
 // \date   July 2000
@@ -20,6 +22,7 @@
 //  Modifications
 //   000705 capes@robots initial version.
 //   4/4/01 LSB (Manchester) Documentation tidied
+//   Workspace is always allocated on the heap, for large systems.
 // \endverbatim
 //-----------------------------------------------------------------------------
 
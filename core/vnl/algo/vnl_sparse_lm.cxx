@@ -12,6 +12,7 @@
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <map>
 #include "vnl_sparse_lm.h"
 
 #include <vcl_compiler.h>
@@ -21,12 +22,369 @@
 #include <vnl/vnl_fastops.h>
 #include <vnl/vnl_vector_ref.h>
 #include <vnl/vnl_crs_index.h>
+#include <vnl/vnl_parallel_for.h>
 #include <vnl/vnl_sparse_lst_sqr_function.h>
 
 #include <vnl/algo/vnl_cholesky.h>
 #include <vnl/algo/vnl_svd.h>
 
 
+//: Smallest number of a or b blocks worth giving to a thread.
+//  Aims for at least 256 residual blocks per sub-range.
+static unsigned vnl_sparse_lm_grain(unsigned n, unsigned num_nz)
+{
+  return 1u + unsigned(256.0 * double(n) / (double(num_nz) + 1.0));
+}
+
+//: Bodies for vnl_parallel_for over the a or b blocks of a vnl_sparse_lm.
+//  Each body only writes the blocks belonging to its own range of i or j.
+struct vnl_sparse_lm_parallel
+{
+  typedef vnl_crs_index::sparse_vector::iterator sv_itr;
+  typedef void (*body_fn)(vnl_sparse_lm_parallel const&, unsigned, unsigned);
+
+  vnl_sparse_lm* lm;
+  body_fn body;
+  // Arguments, used by some of the bodies
+  vnl_matrix<double>* Sa;
+  vnl_vector<double>* sea;
+  vnl_matrix<double> const* H;
+  vnl_vector<double> const* x;
+  vnl_vector<double> const* x2;
+  vnl_vector<double>* y;
+
+  void operator()(unsigned b, unsigned e) const { body(*this, b, e); }
+
+  vnl_sparse_lm_parallel(vnl_sparse_lm* l, body_fn fn)
+    : lm(l), body(fn), Sa(VXL_NULLPTR), sea(VXL_NULLPTR), H(VXL_NULLPTR),
+      x(VXL_NULLPTR), x2(VXL_NULLPTR), y(VXL_NULLPTR) {}
+
+  //: Run over all a blocks
+  void run_a() const
+  {
+    vnl_parallel_for(0, lm->num_a_, *this, vnl_sparse_lm_grain(lm->num_a_, lm->num_nz_));
+  }
+
+  //: Run over all b blocks
+  void run_b() const
+  {
+    vnl_parallel_for(0, lm->num_b_, *this, vnl_sparse_lm_grain(lm->num_b_, lm->num_nz_));
+  }
+
+  //: Run over pairs of a blocks, i and num_a-1-i.
+  //  Used when the work on block i decreases with i.
+  void run_a_pairs() const
+  {
+    const unsigned n = (lm->num_a_ + 1) / 2;
+    vnl_parallel_for(0, n, *this, vnl_sparse_lm_grain(n, lm->num_nz_));
+  }
+
+  //: Ui, Qi, Wij and ea_i
+  static void normal_a(vnl_sparse_lm_parallel const& p, unsigned i0, unsigned i1)
+  {
+    vnl_sparse_lm& lm = *p.lm;
+    vnl_sparse_lst_sqr_function* f = lm.f_;
+    const vnl_crs_index& crs = f->residual_indices();
+    for (unsigned int i=i0; i<i1; ++i)
+    {
+      vnl_matrix<double>& Ui = lm.U_[i];
+      Ui.fill(0.0);
+      vnl_matrix<double>& Qi = lm.Q_[i];
+      Qi.fill(0.0);
+      vnl_vector_ref<double> eai(f->number_of_params_a(i), lm.ea_.data_block()+f->index_a(i));
+
+      vnl_crs_index::sparse_vector row = crs.sparse_row(i);
+      for (sv_itr r_itr=row.begin(); r_itr!=row.end(); ++r_itr)
+      {
+        unsigned int k = r_itr->first;
+        vnl_matrix<double>& Aij = lm.A_[k];
+        vnl_fastops::inc_X_by_AtA(Ui,Aij);                  // Ui += A_ij^T * A_ij
+        vnl_fastops::AtB(lm.W_[k],Aij,lm.B_[k]);            // Wij = A_ij^T * B_ij
+        if (lm.size_c_ > 0)
+          vnl_fastops::inc_X_by_AtB(Qi,lm.C_[k],Aij);       // Qi += C_ij^T * A_ij
+        vnl_vector_ref<double> eij(f->number_of_residuals(k), lm.e_.data_block()+f->index_e(k));
+        vnl_fastops::inc_X_by_AtB(eai,Aij,eij);             // e_a_i += A_ij^T * e_ij
+      }
+    }
+  }
+
+  //: Vj, Rj and eb_j
+  static void normal_b(vnl_sparse_lm_parallel const& p, unsigned j0, unsigned j1)
+  {
+    vnl_sparse_lm& lm = *p.lm;
+    vnl_sparse_lst_sqr_function* f = lm.f_;
+    for (unsigned int j=j0; j<j1; ++j)
+    {
+      vnl_matrix<double>& Vj = lm.V_[j];
+      Vj.fill(0.0);
+      vnl_matrix<double>& Rj = lm.R_[j];
+      Rj.fill(0.0);
+      vnl_vector_ref<double> ebj(f->number_of_params_b(j), lm.eb_.data_block()+f->index_b(j));
+      for (unsigned int q=lm.col_start_[j]; q<lm.col_start_[j+1]; ++q)
+      {
+        unsigned int k = lm.col_k_[q];
+        vnl_matrix<double>& Bij = lm.B_[k];
+        vnl_fastops::inc_X_by_AtA(Vj,Bij);                  // Vj += B_ij^T * B_ij
+        if (lm.size_c_ > 0)
+          vnl_fastops::inc_X_by_AtB(Rj,lm.C_[k],Bij);       // Rj += C_ij^T * B_ij
+        vnl_vector_ref<double> eij(f->number_of_residuals(k), lm.e_.data_block()+f->index_e(k));
+        vnl_fastops::inc_X_by_AtB(ebj,Bij,eij);             // e_b_j += B_ij^T * e_ij
+      }
+    }
+  }
+
+  //: inv(Vj) and Yij
+  static void invV_Y(vnl_sparse_lm_parallel const& p, unsigned j0, unsigned j1)
+  {
+    vnl_sparse_lm& lm = *p.lm;
+    for (unsigned int j=j0; j<j1; ++j)
+    {
+      vnl_matrix<double>& inv_Vj = lm.inv_V_[j];
+      vnl_cholesky Vj_cholesky(lm.V_[j],vnl_cholesky::quiet);
+      // use SVD as a backup if Cholesky is deficient
+      if ( Vj_cholesky.rank_deficiency() > 0 )
+      {
+        vnl_svd<double> Vj_svd(lm.V_[j]);
+        inv_Vj = Vj_svd.inverse();
+      }
+      else
+        inv_Vj = Vj_cholesky.inverse();
+
+      for (unsigned int q=lm.col_start_[j]; q<lm.col_start_[j+1]; ++q)
+      {
+        unsigned int k = lm.col_k_[q];
+        lm.Y_[k] = lm.W_[k]*inv_Vj;  // Y_ij = W_ij * inv(V_j)
+      }
+    }
+  }
+
+  //: The rows of Sa for blocks i and num_a-1-i, with Z and sea
+  static void schur_pairs(vnl_sparse_lm_parallel const& p, unsigned t0, unsigned t1)
+  {
+    const unsigned n = p.lm->num_a_;
+    for (unsigned int t=t0; t<t1; ++t)
+    {
+      schur_row(p, t);
+      if (n-1-t != t)
+        schur_row(p, n-1-t);
+    }
+  }
+
+  //: Row i of Sa (or the inverse of its diagonal block), Z_i and se_i
+  static void schur_row(vnl_sparse_lm_parallel const& p, unsigned int i)
+  {
+    vnl_sparse_lm& lm = *p.lm;
+    vnl_sparse_lst_sqr_function* f = lm.f_;
+    vnl_crs_index::sparse_vector row_i = f->residual_indices().sparse_row(i);
+
+    if (lm.size_c_ > 0)
+    {
+      // compute Z = RYt-Q
+      vnl_matrix<double>& Zi = lm.Z_[i];
+      Zi.fill(0.0);
+      Zi -= lm.Q_[i];
+      for (sv_itr ri = row_i.begin(); ri != row_i.end();  ++ri)
+        vnl_fastops::inc_X_by_ABt(Zi,lm.R_[ri->second],lm.Y_[ri->first]);  // Z_i += R_j * Y_ij^T
+    }
+
+    // handle the diagonal blocks and computation of se separately
+    vnl_matrix<double> Sii(lm.U_[i]); // copy Ui to initialize Sii
+    for (sv_itr ri = row_i.begin(); ri != row_i.end();  ++ri)
+    {
+      unsigned int k = ri->first;
+      vnl_matrix<double>& Yij = lm.Y_[k];
+      vnl_fastops::dec_X_by_ABt(Sii,Yij,lm.W_[k]); // S_ii -= Y_ij * W_ij^T
+      if (p.sea)
+      {
+        vnl_vector_ref<double> sei(f->number_of_params_a(i),p.sea->data_block()+f->index_a(i));
+        vnl_vector_ref<double> ebj(Yij.cols(), lm.eb_.data_block()+f->index_b(ri->second));
+        sei -= Yij*ebj;  // se_i -= Y_ij * e_b_j
+      }
+    }
+
+    if (!p.Sa)
+    {
+      // block Jacobi preconditioner for the iterative solver
+      vnl_cholesky Sii_cholesky(Sii,vnl_cholesky::quiet);
+      if ( Sii_cholesky.rank_deficiency() > 0 )
+        lm.inv_S_[i] = vnl_svd<double>(Sii).inverse();
+      else
+        lm.inv_S_[i] = Sii_cholesky.inverse();
+      return;
+    }
+    p.Sa->update(Sii,f->index_a(i),f->index_a(i));
+
+    // handle the (symmetric) off diagonal blocks, for the a's which share
+    // a residual block with a_i; the others are zero
+    typedef std::map<unsigned int, vnl_matrix<double> > block_map;
+    block_map Sih;
+    for (sv_itr ri = row_i.begin(); ri != row_i.end();  ++ri)
+    {
+      unsigned int j = ri->second;
+      for (unsigned int q=lm.col_start_[j]; q<lm.col_start_[j+1]; ++q)
+      {
+        unsigned int h = lm.col_i_[q];
+        if (h <= i)
+          continue;
+        block_map::iterator s = Sih.find(h);
+        if (s == Sih.end())
+          s = Sih.insert(block_map::value_type(h, vnl_matrix<double>(f->number_of_params_a(i),
+                                                                     f->number_of_params_a(h), 0.0))).first;
+        // S_ih -= Y_ij * W_hj^T
+        vnl_fastops::dec_X_by_ABt(s->second,lm.Y_[ri->first],lm.W_[lm.col_k_[q]]);
+      }
+    }
+    for (block_map::const_iterator s = Sih.begin(); s != Sih.end(); ++s)
+    {
+      // this should also be a symmetric matrix
+      p.Sa->update(s->second,f->index_a(i),f->index_a(s->first));
+      p.Sa->update(s->second.transpose(),f->index_a(s->first),f->index_a(i));
+    }
+  }
+
+  //: Ma = ZH
+  static void Ma(vnl_sparse_lm_parallel const& p, unsigned i0, unsigned i1)
+  {
+    vnl_sparse_lm& lm = *p.lm;
+    vnl_sparse_lst_sqr_function* f = lm.f_;
+    vnl_matrix<double> Hik;
+    for (unsigned int i=i0; i<i1; ++i)
+    {
+      vnl_matrix<double>& Mai = lm.Ma_[i];
+      Mai.fill(0.0);
+
+      for (int k=0; k<lm.num_a_; ++k)
+      {
+        Hik.set_size(f->number_of_params_a(i), f->number_of_params_a(k));
+        p.H->extract(Hik,f->index_a(i), f->index_a(k));
+        vnl_fastops::inc_X_by_AB(Mai, lm.Z_[k], Hik);
+      }
+    }
+  }
+
+  //: Mb = (-R-MaW)inv(V)
+  static void Mb(vnl_sparse_lm_parallel const& p, unsigned j0, unsigned j1)
+  {
+    vnl_sparse_lm& lm = *p.lm;
+    vnl_matrix<double> temp;
+    for (unsigned int j=j0; j<j1; ++j)
+    {
+      temp.set_size(lm.size_c_,lm.f_->number_of_params_b(j));
+      temp.fill(0.0);
+      temp -= lm.R_[j];
+
+      for (unsigned int q=lm.col_start_[j]; q<lm.col_start_[j+1]; ++q)
+        vnl_fastops::dec_X_by_AB(temp,lm.Ma_[lm.col_i_[q]],lm.W_[lm.col_k_[q]]);
+      vnl_fastops::AB(lm.Mb_[j],temp,lm.inv_V_[j]);
+    }
+  }
+
+  //: sea from ea, Z, dc (in x), Y, and eb
+  static void sea_rows(vnl_sparse_lm_parallel const& p, unsigned i0, unsigned i1)
+  {
+    vnl_sparse_lm& lm = *p.lm;
+    vnl_sparse_lst_sqr_function* f = lm.f_;
+    const vnl_crs_index& crs = f->residual_indices();
+    for (unsigned int i=i0; i<i1; ++i)
+    {
+      vnl_vector_ref<double> sei(f->number_of_params_a(i),p.sea->data_block()+f->index_a(i));
+      vnl_crs_index::sparse_vector row_i = crs.sparse_row(i);
+
+      if (lm.size_c_ > 0)
+        vnl_fastops::inc_X_by_AtB(sei,lm.Z_[i],*p.x);
+
+      for (sv_itr ri = row_i.begin(); ri != row_i.end();  ++ri)
+      {
+        vnl_matrix<double>& Yij = lm.Y_[ri->first];
+        vnl_vector_ref<double> ebj(Yij.cols(), lm.eb_.data_block()+f->index_b(ri->second));
+        sei -= Yij*ebj;  // se_i -= Y_ij * e_b_j
+      }
+    }
+  }
+
+  //: db from da (in x) and dc (in x2)
+  static void backsolve(vnl_sparse_lm_parallel const& p, unsigned j0, unsigned j1)
+  {
+    vnl_sparse_lm& lm = *p.lm;
+    vnl_sparse_lst_sqr_function* f = lm.f_;
+    vnl_vector<double> const& da = *p.x;
+    for (unsigned int j=j0; j<j1; ++j)
+    {
+      vnl_vector<double> seb(lm.eb_.data_block()+f->index_b(j),f->number_of_params_b(j));
+      if ( lm.size_c_ > 0 )
+      {
+        vnl_fastops::dec_X_by_AtB(seb,lm.R_[j],*p.x2);
+      }
+      for (unsigned int q=lm.col_start_[j]; q<lm.col_start_[j+1]; ++q)
+      {
+        unsigned int i = lm.col_i_[q];
+        const vnl_vector_ref<double> dai(f->number_of_params_a(i),
+                                         const_cast<double*>(da.data_block()+f->index_a(i)));
+        vnl_fastops::dec_X_by_AtB(seb,lm.W_[lm.col_k_[q]],dai);
+      }
+      vnl_vector_ref<double> dbi(f->number_of_params_b(j),p.y->data_block()+f->index_b(j));
+      vnl_fastops::Ab(dbi,lm.inv_V_[j],seb);
+    }
+  }
+
+  //: t_j = sum_i W_ij^T x_i, the first half of multiplying by Sa
+  static void Wt_x(vnl_sparse_lm_parallel const& p, unsigned j0, unsigned j1)
+  {
+    vnl_sparse_lm& lm = *p.lm;
+    vnl_sparse_lst_sqr_function* f = lm.f_;
+    for (unsigned int j=j0; j<j1; ++j)
+    {
+      vnl_vector_ref<double> tj(f->number_of_params_b(j),p.y->data_block()+f->index_b(j));
+      tj.fill(0.0);
+      for (unsigned int q=lm.col_start_[j]; q<lm.col_start_[j+1]; ++q)
+      {
+        unsigned int i = lm.col_i_[q];
+        const vnl_vector_ref<double> xi(f->number_of_params_a(i),
+                                        const_cast<double*>(p.x->data_block()+f->index_a(i)));
+        vnl_fastops::inc_X_by_AtB(tj,lm.W_[lm.col_k_[q]],xi);
+      }
+    }
+  }
+
+  //: y_i = U_i x_i - sum_j Y_ij t_j, the second half of multiplying by Sa
+  static void U_x_minus_Y_t(vnl_sparse_lm_parallel const& p, unsigned i0, unsigned i1)
+  {
+    vnl_sparse_lm& lm = *p.lm;
+    vnl_sparse_lst_sqr_function* f = lm.f_;
+    const vnl_crs_index& crs = f->residual_indices();
+    for (unsigned int i=i0; i<i1; ++i)
+    {
+      const vnl_vector_ref<double> xi(f->number_of_params_a(i),
+                                      const_cast<double*>(p.x->data_block()+f->index_a(i)));
+      vnl_vector_ref<double> yi(f->number_of_params_a(i),p.y->data_block()+f->index_a(i));
+      vnl_fastops::Ab(yi,lm.U_[i],xi);
+      vnl_crs_index::sparse_vector row_i = crs.sparse_row(i);
+      for (sv_itr ri = row_i.begin(); ri != row_i.end();  ++ri)
+      {
+        vnl_matrix<double>& Yij = lm.Y_[ri->first];
+        const vnl_vector_ref<double> tj(Yij.cols(),
+                                        const_cast<double*>(p.x2->data_block()+f->index_b(ri->second)));
+        yi -= Yij*tj;
+      }
+    }
+  }
+
+  //: y_i = inv(S_ii) x_i, the block Jacobi preconditioner
+  static void precondition(vnl_sparse_lm_parallel const& p, unsigned i0, unsigned i1)
+  {
+    vnl_sparse_lm& lm = *p.lm;
+    vnl_sparse_lst_sqr_function* f = lm.f_;
+    for (unsigned int i=i0; i<i1; ++i)
+    {
+      const vnl_vector_ref<double> xi(f->number_of_params_a(i),
+                                      const_cast<double*>(p.x->data_block()+f->index_a(i)));
+      vnl_vector_ref<double> yi(f->number_of_params_a(i),p.y->data_block()+f->index_a(i));
+      vnl_fastops::Ab(yi,lm.inv_S_[i],xi);
+    }
+  }
+};
+
+
 //: Initialize with the function object that is to be minimized.
 vnl_sparse_lm::vnl_sparse_lm(vnl_sparse_lst_sqr_function& f)
  : num_a_(f.number_of_a()),
@@ -55,7 +413,12 @@ vnl_sparse_lm::vnl_sparse_lm(vnl_sparse_lst_sqr_function& f)
    Y_(num_nz_),
    Z_(num_a_),
    Ma_(num_a_),
-   Mb_(num_b_)
+   Mb_(num_b_),
+   inv_S_(num_a_),
+   use_iterative_solver_(false),
+   iterative_tol_(1e-10),
+   iterative_max_iterations_(0),
+   iterative_iterations_(0)
 {
   init(&f);
 }
@@ -102,8 +465,12 @@ bool vnl_sparse_lm::minimize(vnl_vector<double>& a,
     return false;
 
   //: Systems to solve will be Sc*dc=sec and Sa*da=sea
-  vnl_matrix<double> Sc(size_c_,size_c_), Sa(size_a_, size_a_);
-  vnl_vector<double> sec(size_c_), sea(size_a_);
+  //  Sa is only formed for the dense solver
+  vnl_matrix<double> Sa;
+  if (!use_iterative_solver_)
+    Sa.set_size(size_a_, size_a_);
+  vnl_vector<double> sea(size_a_);
+  iterative_iterations_ = 0;
   // update vectors
   vnl_vector<double> da(size_a_), db(size_b_), dc(size_c_);
 
@@ -178,7 +545,25 @@ bool vnl_sparse_lm::minimize(vnl_vector<double>& a,
       // compute inv(Vj) and Yij
       compute_invV_Y();
 
-      if ( size_c_ > 0 )
+      if ( size_c_ > 0 && use_iterative_solver_ )
+      {
+        // compute Z = RYt-Q and the preconditioner for Sa
+        compute_Z_inv_S(VXL_NULLPTR);
+
+        // construct Ma = Z*inv(Sa) without inverting Sa
+        compute_Ma_iterative();
+        // construct Mb = (R+MaW)inv(V)
+        compute_Mb();
+
+        // use Ma and Mb to solve for dc
+        solve_dc(dc);
+
+        // compute sea from ea, Z, dc, Y, and eb
+        compute_sea(dc,sea);
+
+        solve_Sa_iterative(sea, da);
+      }
+      else if ( size_c_ > 0 )
       {
         // compute Z = RYt-Q and Sa
         compute_Z_Sa(Sa);
@@ -214,6 +599,13 @@ bool vnl_sparse_lm::minimize(vnl_vector<double>& a,
           da = Sa_cholesky.solve(sea);
         delete Sa_svd;
       }
+      else if ( use_iterative_solver_ ) // size_c_ == 0
+      {
+        // compute sea and the preconditioner, and solve Sa*da = sea
+        // by conjugate gradients, without forming Sa
+        compute_Z_inv_S(&sea);
+        solve_Sa_iterative(sea, da);
+      }
       else // size_c_ == 0
       {
         // |I -W*inv(V)| * |U  W| * |da| = |I -W*inv(V)| * |ea|
@@ -390,6 +782,30 @@ void vnl_sparse_lm::allocate_matrices()
       Y_[k].set_size(ai_size, bj_size);
     }
   }
+  // the same indices by column, in increasing i
+  col_start_.assign(num_b_+1, 0u);
+  col_k_.resize(num_nz_);
+  col_i_.resize(num_nz_);
+  for (int i=0; i<num_a_; ++i)
+  {
+    vnl_crs_index::sparse_vector row = crs.sparse_row(i);
+    for (sv_itr r_itr=row.begin(); r_itr!=row.end(); ++r_itr)
+      ++col_start_[r_itr->second+1];
+  }
+  for (int j=0; j<num_b_; ++j)
+    col_start_[j+1] += col_start_[j];
+  std::vector<unsigned int> next(col_start_.begin(), col_start_.end()-1);
+  for (int i=0; i<num_a_; ++i)
+  {
+    vnl_crs_index::sparse_vector row = crs.sparse_row(i);
+    for (sv_itr r_itr=row.begin(); r_itr!=row.end(); ++r_itr)
+    {
+      const unsigned int q = next[r_itr->second]++;
+      col_k_[q] = r_itr->first;
+      col_i_[q] = i;
+    }
+  }
+
   for (int j=0; j<num_b_; ++j)
   {
     const unsigned int bj_size = f_->number_of_params_b(j);
@@ -413,48 +829,27 @@ void vnl_sparse_lm::compute_normal_equations()
   ea_.fill(0.0);
   eb_.fill(0.0);
   ec_.fill(0.0);
-  // clear the V for summation
-  for (unsigned int j=0; j<f_->number_of_b(); ++j)
-  {
-    V_[j].fill(0.0);
-    R_[j].fill(0.0);
-  }
-  T_.fill(0.0);
   // compute blocks T, Q, R, U, V, W, ea, eb, and ec
   // JtJ = |T  Q  R|
   //       |Qt U  W|  with U and V block diagonal
   //       |Rt Wt V|  and W with same sparsity as residuals
+  // U, Q, W and ea by rows, then V, R and eb by columns
+  vnl_sparse_lm_parallel(this, &vnl_sparse_lm_parallel::normal_a).run_a();
+  vnl_sparse_lm_parallel(this, &vnl_sparse_lm_parallel::normal_b).run_b();
+
+  T_.fill(0.0);
+  if (size_c_ == 0)
+    return;
   for (unsigned int i=0; i<f_->number_of_a(); ++i)
   {
-    vnl_matrix<double>& Ui = U_[i];
-    Ui.fill(0.0);
-    vnl_matrix<double>& Qi = Q_[i];
-    Qi.fill(0.0);
-    unsigned int ai_size = f_->number_of_params_a(i);
-    vnl_vector_ref<double> eai(ai_size, ea_.data_block()+f_->index_a(i));
-
     vnl_crs_index::sparse_vector row = crs.sparse_row(i);
     for (sv_itr r_itr=row.begin(); r_itr!=row.end(); ++r_itr)
     {
-      unsigned int j = r_itr->second;
-      unsigned int k = r_itr->first;;
-      vnl_matrix<double>& Aij = A_[k];
-      vnl_matrix<double>& Bij = B_[k];
+      unsigned int k = r_itr->first;
       vnl_matrix<double>& Cij = C_[k];
-      vnl_matrix<double>& Vj = V_[j];
-      vnl_matrix<double>& Rj = R_[j];
-      vnl_vector_ref<double> ebj(Bij.cols(), eb_.data_block()+f_->index_b(j));
-
       vnl_fastops::inc_X_by_AtA(T_, Cij);       // T = C^T * C
-      vnl_fastops::inc_X_by_AtA(Ui,Aij);       // Ui += A_ij^T * A_ij
-      vnl_fastops::inc_X_by_AtA(Vj,Bij);       // Vj += B_ij^T * B_ij
-      vnl_fastops::AtB(W_[k],Aij,Bij);          // Wij = A_ij^T * B_ij
-      vnl_fastops::inc_X_by_AtB(Qi,Cij,Aij);   // Qi += C_ij^T * A_ij
-      vnl_fastops::inc_X_by_AtB(Rj,Cij,Bij);   // Rj += C_ij^T * B_ij
 
       vnl_vector_ref<double> eij(f_->number_of_residuals(k), e_.data_block()+f_->index_e(k));
-      vnl_fastops::inc_X_by_AtB(eai,Aij,eij);  // e_a_i += A_ij^T * e_ij
-      vnl_fastops::inc_X_by_AtB(ebj,Bij,eij);  // e_b_j += B_ij^T * e_ij
       vnl_fastops::inc_X_by_AtB(ec_,Cij,eij);   // e_c   += C_ij^T * e_ij
     }
   }
@@ -506,90 +901,29 @@ void vnl_sparse_lm::set_diagonal(const vnl_vector<double>& diag)
 //: compute all inv(Vi) and Yij
 void vnl_sparse_lm::compute_invV_Y()
 {
-  // CRS matrix of indices into e, A, B, C, W, Y
-  const vnl_crs_index& crs = f_->residual_indices();
-  // sparse vector iterator
-  typedef vnl_crs_index::sparse_vector::iterator sv_itr;
-
-  for (int j=0; j<num_b_; ++j) {
-    vnl_matrix<double>& inv_Vj = inv_V_[j];
-    vnl_cholesky Vj_cholesky(V_[j],vnl_cholesky::quiet);
-    // use SVD as a backup if Cholesky is deficient
-    if ( Vj_cholesky.rank_deficiency() > 0 )
-    {
-      vnl_svd<double> Vj_svd(V_[j]);
-      inv_Vj = Vj_svd.inverse();
-    }
-    else
-      inv_Vj = Vj_cholesky.inverse();
-
-    vnl_crs_index::sparse_vector col = crs.sparse_col(j);
-    for (sv_itr c_itr=col.begin(); c_itr!=col.end(); ++c_itr)
-    {
-      unsigned int k = c_itr->first;
-      Y_[k] = W_[k]*inv_Vj;  // Y_ij = W_ij * inv(V_j)
-    }
-  }
+  vnl_sparse_lm_parallel(this, &vnl_sparse_lm_parallel::invV_Y).run_b();
 }
 
 
 // compute Z and Sa
 void vnl_sparse_lm::compute_Z_Sa(vnl_matrix<double>& Sa)
 {
-  // CRS matrix of indices into e, A, B, C, W, Y
-  const vnl_crs_index& crs = f_->residual_indices();
-  // sparse vector iterator
-  typedef vnl_crs_index::sparse_vector::iterator sv_itr;
+  // the blocks for pairs of a's which share no b are zero
+  Sa.fill(0.0);
+  vnl_sparse_lm_parallel body(this, &vnl_sparse_lm_parallel::schur_pairs);
+  body.Sa = &Sa;
+  body.run_a_pairs();
+}
 
-  // compute Z = RYt-Q and Sa
-  for (int i=0; i<num_a_; ++i)
-  {
-    vnl_crs_index::sparse_vector row_i = crs.sparse_row(i);
-    vnl_matrix<double>& Zi = Z_[i];
-    Zi.fill(0.0);
-    Zi -= Q_[i];
 
-    // handle the diagonal blocks separately
-    vnl_matrix<double> Sii(U_[i]); // copy Ui to initialize Sii
-    for (sv_itr ri = row_i.begin(); ri != row_i.end();  ++ri)
-    {
-      unsigned int j = ri->second;
-      unsigned int k = ri->first;
-      vnl_matrix<double>& Yij = Y_[k];
-      vnl_fastops::dec_X_by_ABt(Sii,Yij,W_[k]); // S_ii -= Y_ij * W_ij^T
-      vnl_fastops::inc_X_by_ABt(Zi,R_[j],Yij);  // Z_i  += R_j * Y_ij^T
-    }
-    Sa.update(Sii,f_->index_a(i),f_->index_a(i));
-
-    // handle the (symmetric) off diagonal blocks
-    for (int h=i+1; h<num_a_; ++h)
-    {
-      vnl_crs_index::sparse_vector row_h = crs.sparse_row(h);
-      vnl_matrix<double> Sih(f_->number_of_params_a(i),
-                             f_->number_of_params_a(h), 0.0);
-
-      // iterate through both sparse rows finding matching columns
-      bool row_done = false;
-      for (sv_itr ri = row_i.begin(), rh = row_h.begin();
-           ri != row_i.end() && rh != row_h.end();  ++ri, ++rh)
-      {
-        while (!row_done && ri->second != rh->second)
-        {
-          while (!row_done && ri->second < rh->second)
-            row_done = (++ri == row_i.end());
-          while (!row_done && rh->second < ri->second)
-            row_done = (++rh == row_h.end());
-        }
-        if (row_done)
-          break;
-        // S_ih -= Y_ij * W_hj^T
-        vnl_fastops::dec_X_by_ABt(Sih,Y_[ri->first],W_[rh->first]);
-      }
-      // this should also be a symmetric matrix
-      Sa.update(Sih,f_->index_a(i),f_->index_a(h));
-      Sa.update(Sih.transpose(),f_->index_a(h),f_->index_a(i));
-    }
-  }
+//: compute Z, sea if requested, and the inverse diagonal blocks of Sa
+void vnl_sparse_lm::compute_Z_inv_S(vnl_vector<double>* sea)
+{
+  if (sea)
+    *sea = ea_; // initialize se to ea_
+  vnl_sparse_lm_parallel body(this, &vnl_sparse_lm_parallel::schur_pairs);
+  body.sea = sea;
+  body.run_a_pairs();
 }
 
 
@@ -597,18 +931,86 @@ void vnl_sparse_lm::compute_Z_Sa(vnl_matrix<double>& Sa)
 void vnl_sparse_lm::compute_Ma(const vnl_matrix<double>& H)
 {
   // construct Ma = ZH
-  vnl_matrix<double> Hik;
-  for (int i=0; i<num_a_; ++i)
+  vnl_sparse_lm_parallel body(this, &vnl_sparse_lm_parallel::Ma);
+  body.H = &H;
+  body.run_a();
+}
+
+
+//: compute Ma by solving Sa*Ma' = Z' iteratively
+void vnl_sparse_lm::compute_Ma_iterative()
+{
+  // H is symmetric, so row r of Ma = ZH is the solution of Sa*x = z_r,
+  // where z_r is row r of Z
+  vnl_vector<double> z(size_a_), x(size_a_);
+  for (int r=0; r<size_c_; ++r)
   {
-    vnl_matrix<double>& Mai = Ma_[i];
-    Mai.fill(0.0);
+    for (int i=0; i<num_a_; ++i)
+      for (unsigned int ii=0; ii<Z_[i].cols(); ++ii)
+        z[f_->index_a(i)+ii] = Z_[i](r,ii);
+    solve_Sa_iterative(z, x);
+    for (int i=0; i<num_a_; ++i)
+      for (unsigned int ii=0; ii<Ma_[i].cols(); ++ii)
+        Ma_[i](r,ii) = x[f_->index_a(i)+ii];
+  }
+}
 
-    for (int k=0; k<num_a_; ++k)
-    {
-      Hik.set_size(f_->number_of_params_a(i), f_->number_of_params_a(k));
-      H.extract(Hik,f_->index_a(i), f_->index_a(k));
-      vnl_fastops::inc_X_by_AB(Mai, Z_[k], Hik);
-    }
+
+//: y = Sa*x, without forming Sa
+void vnl_sparse_lm::multiply_Sa(vnl_vector<double> const& x, vnl_vector<double>& y)
+{
+  // Sa = U - W*inv(V)*Wt = U - Y*Wt
+  vnl_vector<double> t(size_b_);
+  vnl_sparse_lm_parallel Wt_x(this, &vnl_sparse_lm_parallel::Wt_x);
+  Wt_x.x = &x;
+  Wt_x.y = &t;
+  Wt_x.run_b();
+
+  y.set_size(size_a_);
+  vnl_sparse_lm_parallel U_x_minus_Y_t(this, &vnl_sparse_lm_parallel::U_x_minus_Y_t);
+  U_x_minus_Y_t.x = &x;
+  U_x_minus_Y_t.x2 = &t;
+  U_x_minus_Y_t.y = &y;
+  U_x_minus_Y_t.run_a();
+}
+
+
+//: solve Sa*x = rhs by preconditioned conjugate gradients
+void vnl_sparse_lm::solve_Sa_iterative(vnl_vector<double> const& rhs, vnl_vector<double>& x)
+{
+  x.set_size(size_a_);
+  x.fill(0.0);
+  const double rhs_norm = rhs.two_norm();
+  if (rhs_norm == 0.0)
+    return;
+
+  vnl_sparse_lm_parallel precondition(this, &vnl_sparse_lm_parallel::precondition);
+  vnl_vector<double> r(rhs), z(size_a_), q(size_a_);
+  precondition.x = &r;
+  precondition.y = &z;
+  precondition.run_a();
+  vnl_vector<double> p(z);
+  double rz = dot_product(r,z);
+
+  const unsigned int max_iter = iterative_max_iterations_ > 0 ? iterative_max_iterations_
+                                                              : (unsigned int)(size_a_);
+  for (unsigned int iter=0; iter<max_iter; ++iter)
+  {
+    ++iterative_iterations_;
+    multiply_Sa(p, q);
+    const double pq = dot_product(p,q);
+    if (pq <= 0.0) // Sa should be positive definite
+      break;
+    const double alpha = rz / pq;
+    x += alpha*p;
+    r -= alpha*q;
+    if (r.two_norm() <= iterative_tol_*rhs_norm)
+      break;
+    precondition.run_a();
+    const double rz_new = dot_product(r,z);
+    p *= rz_new / rz;
+    p += z;
+    rz = rz_new;
   }
 }
 
@@ -616,28 +1018,8 @@ void vnl_sparse_lm::compute_Ma(const vnl_matrix<double>& H)
 //: compute Mb
 void vnl_sparse_lm::compute_Mb()
 {
-  // CRS matrix of indices into e, A, B, C, W, Y
-  const vnl_crs_index& crs = f_->residual_indices();
-  // sparse vector iterator
-  typedef vnl_crs_index::sparse_vector::iterator sv_itr;
-
-  vnl_matrix<double> temp;
   // construct Mb = (-R-MaW)inv(V)
-  for (int j=0; j<num_b_; ++j)
-  {
-    temp.set_size(size_c_,f_->number_of_params_b(j));
-    temp.fill(0.0);
-    temp -= R_[j];
-
-    vnl_crs_index::sparse_vector col = crs.sparse_col(j);
-    for (sv_itr c_itr=col.begin(); c_itr!=col.end(); ++c_itr)
-    {
-      unsigned int k = c_itr->first;
-      unsigned int i = c_itr->second;
-      vnl_fastops::dec_X_by_AB(temp,Ma_[i],W_[k]);
-    }
-    vnl_fastops::AB(Mb_[j],temp,inv_V_[j]);
-  }
+  vnl_sparse_lm_parallel(this, &vnl_sparse_lm_parallel::Mb).run_b();
 }
 
 
@@ -686,27 +1068,11 @@ void vnl_sparse_lm::solve_dc(vnl_vector<double>& dc)
 void vnl_sparse_lm::compute_sea(vnl_vector<double> const& dc,
                                 vnl_vector<double>& sea)
 {
-  // CRS matrix of indices into e, A, B, C, W, Y
-  const vnl_crs_index& crs = f_->residual_indices();
-  // sparse vector iterator
-  typedef vnl_crs_index::sparse_vector::iterator sv_itr;
-
   sea = ea_; // initialize se to ea_
-  for (int i=0; i<num_a_; ++i)
-  {
-    vnl_vector_ref<double> sei(f_->number_of_params_a(i),sea.data_block()+f_->index_a(i));
-    vnl_crs_index::sparse_vector row_i = crs.sparse_row(i);
-
-    vnl_fastops::inc_X_by_AtB(sei,Z_[i],dc);
-
-    for (sv_itr ri = row_i.begin(); ri != row_i.end();  ++ri)
-    {
-      unsigned int k = ri->first;
-      vnl_matrix<double>& Yij = Y_[k];
-      vnl_vector_ref<double> ebj(Yij.cols(), eb_.data_block()+f_->index_b(ri->second));
-      sei -= Yij*ebj;  // se_i -= Y_ij * e_b_j
-    }
-  }
+  vnl_sparse_lm_parallel body(this, &vnl_sparse_lm_parallel::sea_rows);
+  body.x = &dc;
+  body.sea = &sea;
+  body.run_a();
 }
 
 
@@ -715,57 +1081,13 @@ void vnl_sparse_lm::compute_sea(vnl_vector<double> const& dc,
 void vnl_sparse_lm::compute_Sa_sea(vnl_matrix<double>& Sa,
                                    vnl_vector<double>& sea)
 {
-  // CRS matrix of indices into e, A, B, C, W, Y
-  const vnl_crs_index& crs = f_->residual_indices();
-  // sparse vector iterator
-  typedef vnl_crs_index::sparse_vector::iterator sv_itr;
-
   sea = ea_; // initialize se to ea_
-  for (int i=0; i<num_a_; ++i)
-  {
-    vnl_vector_ref<double> sei(f_->number_of_params_a(i),sea.data_block()+f_->index_a(i));
-    vnl_crs_index::sparse_vector row_i = crs.sparse_row(i);
-
-    // handle the diagonal blocks and computation of se separately
-    vnl_matrix<double> Sii(U_[i]); // copy Ui to initialize Sii
-    for (sv_itr ri = row_i.begin(); ri != row_i.end();  ++ri)
-    {
-      unsigned int k = ri->first;
-      vnl_matrix<double>& Yij = Y_[k];
-      vnl_fastops::dec_X_by_ABt(Sii,Yij,W_[k]); // S_ii -= Y_ij * W_ij^T
-      vnl_vector_ref<double> ebj(Yij.cols(), eb_.data_block()+f_->index_b(ri->second));
-      sei -= Yij*ebj;  // se_i -= Y_ij * e_b_j
-    }
-    Sa.update(Sii,f_->index_a(i),f_->index_a(i));
-
-    // handle the (symmetric) off diagonal blocks
-    for (int h=i+1; h<num_a_; ++h)
-    {
-      vnl_crs_index::sparse_vector row_h = crs.sparse_row(h);
-      vnl_matrix<double> Sih(f_->number_of_params_a(i),f_->number_of_params_a(h),0.0);
-
-      // iterate through both sparse rows finding matching columns
-      bool row_done = false;
-      for (sv_itr ri = row_i.begin(), rh = row_h.begin();
-           ri != row_i.end() && rh != row_h.end();  ++ri, ++rh)
-      {
-        while (!row_done && ri->second != rh->second)
-        {
-          while (!row_done && ri->second < rh->second)
-            row_done = (++ri == row_i.end());
-          while (!row_done && rh->second < ri->second)
-            row_done = (++rh == row_h.end());
-        }
-        if (row_done)
-          break;
-        // S_ih -= Y_ij * W_hj^T
-        vnl_fastops::dec_X_by_ABt(Sih,Y_[ri->first],W_[rh->first]);
-      }
-      // this should also be a symmetric matrix
-      Sa.update(Sih,f_->index_a(i),f_->index_a(h));
-      Sa.update(Sih.transpose(),f_->index_a(h),f_->index_a(i));
-    }
-  }
+  // the blocks for pairs of a's which share no b are zero
+  Sa.fill(0.0);
+  vnl_sparse_lm_parallel body(this, &vnl_sparse_lm_parallel::schur_pairs);
+  body.Sa = &Sa;
+  body.sea = &sea;
+  body.run_a_pairs();
 }
 
 
@@ -774,30 +1096,11 @@ void vnl_sparse_lm::backsolve_db(vnl_vector<double> const& da,
                                  vnl_vector<double> const& dc,
                                  vnl_vector<double>& db)
 {
-  // CRS matrix of indices into e, A, B, C, W, Y
-  const vnl_crs_index& crs = f_->residual_indices();
-  // sparse vector iterator
-  typedef vnl_crs_index::sparse_vector::iterator sv_itr;
-
-  for (int j=0; j<num_b_; ++j)
-  {
-    vnl_vector<double> seb(eb_.data_block()+f_->index_b(j),f_->number_of_params_b(j));
-    vnl_crs_index::sparse_vector col = crs.sparse_col(j);
-    if ( size_c_ > 0 )
-    {
-      vnl_fastops::dec_X_by_AtB(seb,R_[j],dc);
-    }
-    for (sv_itr c_itr=col.begin(); c_itr!=col.end(); ++c_itr)
-    {
-      unsigned int k = c_itr->first;
-      unsigned int i = c_itr->second;
-      const vnl_vector_ref<double> dai(f_->number_of_params_a(i),
-                                       const_cast<double*>(da.data_block()+f_->index_a(i)));
-      vnl_fastops::dec_X_by_AtB(seb,W_[k],dai);
-    }
-    vnl_vector_ref<double> dbi(f_->number_of_params_b(j),db.data_block()+f_->index_b(j));
-    vnl_fastops::Ab(dbi,inv_V_[j],seb);
-  }
+  vnl_sparse_lm_parallel body(this, &vnl_sparse_lm_parallel::backsolve);
+  body.x = &da;
+  body.x2 = &dc;
+  body.y = &db;
+  body.run_b();
 }
 
 //------------------------------------------------------------------------------
@@ -861,3 +1164,4 @@ vnl_matrix<double> const& vnl_sparse_lm::get_JtJ()
 {
   return inv_covar_;
 }
+
@@ -13,6 +13,8 @@
 // \verbatim
 //  Modifications
 //   Mar 15, 2010  MJL - Modified to handle 'c' parameters (globals)
+//   Normal equations, Schur complement and back substitution are split
+//   across vnl_parallel_for; the reduced system may be solved iteratively.
 // \endverbatim
 //
 
@@ -31,6 +33,19 @@ class vnl_sparse_lst_sqr_function;
 //  the Hartley and Zisserman "Multiple View Geometry" book and further
 //  described in a technical report on sparse bundle adjustment available
 //  at http://www.ics.forth.gr/~lourakis/sba
+//
+//  Each step eliminates the b parameters to give a reduced system in the a
+//  parameters, with one block for each pair of a's which share a residual.
+//  By default this is formed as a dense matrix and solved by Cholesky
+//  decomposition, which costs O(size_a^2) memory and O(size_a^3) time.
+//  For problems with many a's, set_use_iterative_solver() instead solves it
+//  by conjugate gradients preconditioned with the inverses of its diagonal
+//  blocks, multiplying by the reduced matrix in its factored form, so that
+//  memory and time per iteration grow with the number of residual blocks.
+//
+//  The work on the blocks is divided between threads with vnl_parallel_for.
+//  With the default solver the result does not depend on the number of
+//  threads.
 class vnl_sparse_lm : public vnl_nonlinear_minimizer
 {
  public:
@@ -67,6 +82,20 @@ class vnl_sparse_lm : public vnl_nonlinear_minimizer
   //: Access the final weights after optimization
   const vnl_vector<double>& get_weights() const { return weights_; }
 
+  //: Solve the reduced system by preconditioned conjugate gradients.
+  //  The default is a dense Cholesky decomposition.
+  void set_use_iterative_solver(bool use) { use_iterative_solver_ = use; }
+  bool get_use_iterative_solver() const { return use_iterative_solver_; }
+
+  //: Stop the conjugate gradient iterations when |residual| <= tol*|rhs|.
+  void set_iterative_solver_tolerance(double tol) { iterative_tol_ = tol; }
+
+  //: Maximum conjugate gradient iterations per solve (0 means size_a).
+  void set_iterative_solver_max_iterations(unsigned int n) { iterative_max_iterations_ = n; }
+
+  //: Total number of conjugate gradient iterations in the last minimize().
+  unsigned int get_iterative_solver_iterations() const { return iterative_iterations_; }
+
 protected:
 
   //: used to compute the initial damping
@@ -80,6 +109,7 @@ protected:
   void init(vnl_sparse_lst_sqr_function* f);
 
 private:
+  friend struct vnl_sparse_lm_parallel;
 
   //: allocate matrix memory by setting all the matrix sizes
   void allocate_matrices();
@@ -104,6 +134,19 @@ private:
   //: compute Z and Sa
   void compute_Z_Sa(vnl_matrix<double>& Sa);
 
+  //: compute Z (if there are c parameters), sea if requested, and the
+  //  inverse diagonal blocks of Sa for the iterative solver
+  void compute_Z_inv_S(vnl_vector<double>* sea);
+
+  //: compute Ma by solving Sa*Ma' = Z' iteratively
+  void compute_Ma_iterative();
+
+  //: y = Sa*x, without forming Sa
+  void multiply_Sa(vnl_vector<double> const& x, vnl_vector<double>& y);
+
+  //: solve Sa*x = rhs by preconditioned conjugate gradients
+  void solve_Sa_iterative(vnl_vector<double> const& rhs, vnl_vector<double>& x);
+
   //: compute Ma
   void compute_Ma(const vnl_matrix<double>& H);
 
@@ -136,6 +179,11 @@ private:
   const int size_c_;
   const int size_e_;
 
+  //: Residual blocks by column: k and i for each j, in increasing i
+  std::vector<unsigned int> col_start_;
+  std::vector<unsigned int> col_k_;
+  std::vector<unsigned int> col_i_;
+
   //: Storage for each of the Jacobians A_ij, B_ij, and C_ij
   std::vector<vnl_matrix<double> > A_;
   std::vector<vnl_matrix<double> > B_;
@@ -167,7 +215,13 @@ private:
   std::vector<vnl_matrix<double> > Z_;
   std::vector<vnl_matrix<double> > Ma_;
   std::vector<vnl_matrix<double> > Mb_;
+  // inverse diagonal blocks of Sa, the iterative solver's preconditioner
+  std::vector<vnl_matrix<double> > inv_S_;
 
+  bool use_iterative_solver_;
+  double iterative_tol_;
+  unsigned int iterative_max_iterations_;
+  unsigned int iterative_iterations_;
 };
 
 
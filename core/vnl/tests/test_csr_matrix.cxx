@@ -0,0 +1,165 @@
+// This is core/vnl/tests/test_csr_matrix.cxx
+#include <iostream>
+#include <vector>
+#include <testlib/testlib_test.h>
+//:
+// \file
+// \brief Compare vnl_csr_matrix with vnl_sparse_matrix
+
+#include <vnl/vnl_csr_matrix.h>
+#include <vnl/vnl_sparse_matrix.h>
+#include <vnl/vnl_sparse_matrix_linear_system.h>
+#include <vnl/vnl_parallel_for.h>
+#include <vnl/vnl_random.h>
+
+template <class T>
+static bool bitwise_equal(vnl_vector<T> const& a, vnl_vector<T> const& b)
+{
+  if (a.size() != b.size())
+    return false;
+  for (unsigned i = 0; i < a.size(); ++i)
+    if (a[i] != b[i])
+      return false;
+  return true;
+}
+
+//: A random matrix with about \p per_row entries in each row, and some empty rows.
+static vnl_sparse_matrix<double> random_sparse(unsigned r, unsigned c, unsigned per_row, vnl_random& rng)
+{
+  vnl_sparse_matrix<double> A(r, c);
+  for (unsigned i = 0; i < r; ++i) {
+    if (i % 17 == 5)
+      continue;
+    for (unsigned k = 0; k < per_row; ++k)
+      A(i, rng.lrand32(0, c-1)) += rng.drand64(-1.0, 1.0);
+  }
+  return A;
+}
+
+static void test_construction()
+{
+  vnl_csr_matrix<double> empty;
+  TEST("Default is 0x0", empty.rows() == 0 && empty.cols() == 0 && empty.nnz() == 0, true);
+
+  vnl_csr_matrix_builder<double> builder(3, 4);
+  builder.add(2, 3, 1.0);
+  builder.add(0, 1, 2.0);
+  builder.add(2, 0, 3.0);
+  builder.add(0, 1, 0.5);   // duplicate, summed
+  builder.add(1, 2, -1.0);
+  vnl_csr_matrix<double> A(builder);
+  TEST("rows", A.rows(), 3);
+  TEST("cols", A.cols(), 4);
+  TEST("Duplicates merged", A.nnz(), 4);
+  TEST("Duplicates summed", A(0,1), 2.5);
+  TEST("get", A.get(2,0) == 3.0 && A.get(2,3) == 1.0 && A.get(1,2) == -1.0, true);
+  TEST("Missing entries are zero", A.get(0,0) == 0.0 && A.get(1,3) == 0.0, true);
+  TEST("Row sorted by column", A.col_index()[A.row_start()[2]] == 0 && A.col_index()[A.row_start()[2]+1] == 3, true);
+  TEST("Column index", A.col_start()[4] == 4 && A.row_index()[A.col_start()[3]] == 2, true);
+
+  vnl_sparse_matrix<double> S = A.as_sparse_matrix();
+  TEST("as_sparse_matrix", S.get(0,1) == 2.5 && S.get(2,0) == 3.0 && S.get(1,2) == -1.0 && S.get(1,1) == 0.0, true);
+  TEST("Round trip", vnl_csr_matrix<double>(S) == A, true);
+
+  vnl_csr_matrix<double> At = A.transpose();
+  TEST("transpose size", At.rows() == 4 && At.cols() == 3, true);
+  TEST("transpose content", At(1,0) == 2.5 && At(0,2) == 3.0 && At(3,2) == 1.0, true);
+  TEST("transpose twice", At.transpose() == A, true);
+
+  std::vector<unsigned> r(2, 1u), c(2, 1u);
+  std::vector<double> v(2, 1.0);
+  vnl_csr_matrix<double> B(2, 2, r, c, v);
+  TEST("Triplet constructor", B.nnz() == 1 && B(1,1) == 2.0, true);
+  TEST("operator!=", B != A, true);
+}
+
+static void test_products(unsigned threads)
+{
+  std::cout << "Products with up to " << threads << " threads\n";
+  const unsigned old_threads = vnl_parallel::max_threads();
+  vnl_parallel::set_max_threads(threads);
+
+  vnl_random rng(1234);
+  vnl_sparse_matrix<double> S = random_sparse(3001, 1203, 12, rng);
+  vnl_csr_matrix<double> A(S);
+
+  vnl_vector<double> x(A.cols()), y(A.rows());
+  for (unsigned i = 0; i < x.size(); ++i) x[i] = rng.drand64(-1.0, 1.0);
+  for (unsigned i = 0; i < y.size(); ++i) y[i] = rng.drand64(-1.0, 1.0);
+
+  vnl_vector<double> expected, got;
+  S.mult(x, expected);
+  A.mult(x, got);
+  TEST("mult identical to vnl_sparse_matrix", bitwise_equal(got, expected), true);
+
+  S.pre_mult(y, expected);
+  A.pre_mult(y, got);
+  TEST("pre_mult identical to vnl_sparse_matrix", bitwise_equal(got, expected), true);
+
+  S.diag_AtA(expected);
+  A.diag_AtA(got);
+  TEST("diag_AtA identical to vnl_sparse_matrix", bitwise_equal(got, expected), true);
+
+  // A'A from the sparse matrix product
+  vnl_sparse_matrix<double> StS = S.transpose() * S;
+  vnl_csr_matrix<double> AtA = A.AtA();
+  TEST("AtA size", AtA.rows() == A.cols() && AtA.cols() == A.cols(), true);
+  TEST("AtA identical to vnl_sparse_matrix product", AtA == vnl_csr_matrix<double>(StS), true);
+  TEST("AtA symmetric", AtA.transpose() == AtA, true);
+
+  // Triplet assembly agrees with element-by-element insertion
+  vnl_csr_matrix_builder<double> builder(A.rows(), A.cols());
+  vnl_sparse_matrix<double> P(A.rows(), A.cols());
+  for (unsigned k = 0; k < 40000; ++k) {
+    const unsigned i = rng.lrand32(0, A.rows()-1), j = rng.lrand32(0, A.cols()-1);
+    const double v = rng.drand64(-1.0, 1.0);
+    builder.add(i, j, v);
+    P(i, j) += v;
+  }
+  TEST("Builder identical to vnl_sparse_matrix", vnl_csr_matrix<double>(builder) == vnl_csr_matrix<double>(P), true);
+
+  vnl_parallel::set_max_threads(old_threads);
+}
+
+static void test_linear_system()
+{
+  // Least squares fit through a frozen matrix and a float matrix
+  vnl_random rng(99);
+  vnl_sparse_matrix<double> S = random_sparse(200, 50, 6, rng);
+  vnl_csr_matrix<double> A(S);
+  vnl_vector<double> b(200, 1.0), x(50, 2.0), y1, y2;
+
+  vnl_sparse_matrix_linear_system<double> ls_sparse(S, b);
+  vnl_sparse_matrix_linear_system<double> ls_csr(A, b);
+  ls_sparse.multiply(x, y1);
+  ls_csr.multiply(x, y2);
+  TEST("Linear systems agree", bitwise_equal(y1, y2), true);
+  ls_sparse.transpose_multiply(b, y1);
+  ls_csr.transpose_multiply(b, y2);
+  TEST("Transposed linear systems agree", bitwise_equal(y1, y2), true);
+
+  vnl_vector<double> d;
+  A.diag_AtA(d);
+  vnl_vector<double> px(50);
+  ls_csr.apply_preconditioner(x, px);
+  TEST_NEAR("Jacobi preconditioner", px[7], d[7] == 0.0 ? px[7] : 2.0/d[7], 1e-12);
+
+  vnl_csr_matrix_builder<float> fb(2, 2);
+  fb.add(0, 0, 2.f); fb.add(1, 1, 4.f);
+  vnl_csr_matrix<float> F(fb);
+  vnl_vector<float> fbv(2, 1.f);
+  vnl_sparse_matrix_linear_system<float> ls_float(F, fbv);
+  vnl_vector<double> fx(2, 1.0), fy(2);
+  ls_float.multiply(fx, fy);
+  TEST("Float linear system", fy[0] == 2.0 && fy[1] == 4.0, true);
+}
+
+static void test_csr_matrix()
+{
+  test_construction();
+  test_products(1);
+  test_products(4);
+  test_linear_system();
+}
+
+TESTMAIN(test_csr_matrix);
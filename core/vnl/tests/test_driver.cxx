@@ -28,6 +28,8 @@ DECLARE( test_rotation_matrix );
 DECLARE( test_sym_matrix );
 DECLARE( test_transpose );
 DECLARE( test_fastops );
+DECLARE( test_gemm );
+DECLARE( test_parallel_for );
 DECLARE( test_vector );
 DECLARE( test_vector_fixed_ref );
 DECLARE( test_gamma );
@@ -40,6 +42,7 @@ DECLARE( test_bessel );
 DECLARE( test_crs_index );
 DECLARE( test_sparse_lst_sqr_function );
 DECLARE( test_sparse_matrix );
+DECLARE( test_csr_matrix );
 DECLARE( test_pow_log );
 DECLARE( test_vnl_index_sort );
 
@@ -73,6 +76,8 @@ register_tests()
   REGISTER( test_sym_matrix );
   REGISTER( test_transpose );
   REGISTER( test_fastops );
+  REGISTER( test_gemm );
+  REGISTER( test_parallel_for );
   REGISTER( test_vector );
   REGISTER( test_vector_fixed_ref );
   REGISTER( test_gamma );
@@ -85,6 +90,7 @@ register_tests()
   REGISTER( test_crs_index );
   REGISTER( test_sparse_lst_sqr_function );
   REGISTER( test_sparse_matrix );
+  REGISTER( test_csr_matrix );
   REGISTER( test_pow_log );
   REGISTER( test_vnl_index_sort );
 }
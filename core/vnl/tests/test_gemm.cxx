@@ -0,0 +1,112 @@
+// This is core/vnl/tests/test_gemm.cxx
+#include <iostream>
+#include <testlib/testlib_test.h>
+//:
+// \file
+// \brief Compare vnl_gemm with the simple triple loop
+
+#include <vnl/vnl_matrix.h>
+#include <vnl/vnl_gemm.h>
+#include <vnl/vnl_parallel_for.h>
+#include <vnl/vnl_fastops.h>
+#include <vnl/vnl_random.h>
+
+template <class T>
+static vnl_matrix<T> reference_product(vnl_matrix<T> const& A, vnl_matrix<T> const& B)
+{
+  vnl_matrix<T> C(A.rows(), B.cols());
+  for (unsigned i = 0; i < A.rows(); ++i)
+    for (unsigned j = 0; j < B.cols(); ++j) {
+      T sum(0);
+      for (unsigned k = 0; k < A.cols(); ++k)
+        sum += T(A(i,k) * B(k,j));
+      C(i,j) = sum;
+    }
+  return C;
+}
+
+template <class T>
+static bool bitwise_equal(vnl_matrix<T> const& A, vnl_matrix<T> const& B)
+{
+  if (A.rows() != B.rows() || A.cols() != B.cols())
+    return false;
+  for (unsigned i = 0; i < A.rows(); ++i)
+    for (unsigned j = 0; j < A.cols(); ++j)
+      if (A(i,j) != B(i,j))
+        return false;
+  return true;
+}
+
+template <class T>
+static void test_gemm_type(char const* type_name)
+{
+  std::cout << "Testing vnl_gemm<" << type_name << ">\n";
+  vnl_random rng(9667566ul);
+
+  // Sizes chosen to hit full tiles, edge tiles and more than one cache block.
+  const unsigned sizes[][3] = { { 1, 1, 1 }, { 3, 5, 7 }, { 17, 33, 9 },
+                                { 64, 64, 64 }, { 131, 97, 517 }, { 203, 4113, 11 },
+                                { 7, 0, 3 }, { 5, 4, 0 } };
+  for (unsigned s = 0; s < sizeof sizes / sizeof sizes[0]; ++s) {
+    const unsigned m = sizes[s][0], k = sizes[s][1], n = sizes[s][2];
+    vnl_matrix<T> A(m, k), B(k, n);
+    for (unsigned i = 0; i < m; ++i)
+      for (unsigned j = 0; j < k; ++j)
+        A(i,j) = T(rng.drand32(-1.0, 1.0));
+    for (unsigned i = 0; i < k; ++i)
+      for (unsigned j = 0; j < n; ++j)
+        B(i,j) = T(rng.drand32(-1.0, 1.0));
+    vnl_matrix<T> ref = reference_product(A, B);
+
+    std::cout << "  " << m << 'x' << k << " times " << k << 'x' << n << '\n';
+    TEST("operator* is bitwise identical to the triple loop", bitwise_equal(A*B, ref), true);
+
+    vnl_matrix<T> At = A.transpose(), Bt = B.transpose();
+    vnl_matrix<T> C(m, n);
+    vnl_gemm(true, false, m, n, k, At.data_array(), B.data_array(), C.data_array());
+    TEST("vnl_gemm(At,B)", bitwise_equal(C, ref), true);
+    vnl_gemm(false, true, m, n, k, A.data_array(), Bt.data_array(), C.data_array());
+    TEST("vnl_gemm(A,Bt)", bitwise_equal(C, ref), true);
+    vnl_gemm(true, true, m, n, k, At.data_array(), Bt.data_array(), C.data_array());
+    TEST("vnl_gemm(At,Bt)", bitwise_equal(C, ref), true);
+  }
+
+  // The result must not depend on the number of threads.
+  vnl_matrix<T> A(300, 200), B(200, 250);
+  for (unsigned i = 0; i < A.size(); ++i) A.data_block()[i] = T(rng.drand32(-1.0, 1.0));
+  for (unsigned i = 0; i < B.size(); ++i) B.data_block()[i] = T(rng.drand32(-1.0, 1.0));
+  const unsigned saved_threads = vnl_parallel::max_threads();
+  vnl_parallel::set_max_threads(1);
+  vnl_matrix<T> C1 = A*B;
+  vnl_parallel::set_max_threads(3);
+  vnl_matrix<T> C3 = A*B;
+  vnl_parallel::set_max_threads(saved_threads);
+  TEST("Same result with 1 and 3 threads", bitwise_equal(C1, C3), true);
+  TEST("Threaded result matches the triple loop", bitwise_equal(C3, reference_product(A, B)), true);
+
+  // Fused multiply-add mode is only required to be close.
+  vnl_gemm_set_deterministic(false);
+  vnl_matrix<T> Cf = A*B;
+  vnl_gemm_set_deterministic(true);
+  TEST_NEAR("Non-deterministic mode", (Cf - C1).absolute_value_max(), 0.0, 1e-3);
+}
+
+static void test_gemm()
+{
+  test_gemm_type<double>("double");
+  test_gemm_type<float>("float");
+
+  // vnl_fastops goes through the same kernel.
+  vnl_random rng(1234ul);
+  vnl_matrix<double> A(150, 70), B(150, 90), out;
+  for (unsigned i = 0; i < A.size(); ++i) A.data_block()[i] = rng.drand32(-1.0, 1.0);
+  for (unsigned i = 0; i < B.size(); ++i) B.data_block()[i] = rng.drand32(-1.0, 1.0);
+  vnl_fastops::AtA(out, A);
+  TEST("vnl_fastops::AtA", bitwise_equal(out, reference_product(A.transpose(), A)), true);
+  vnl_fastops::AtB(out, A, B);
+  TEST("vnl_fastops::AtB", bitwise_equal(out, reference_product(A.transpose(), B)), true);
+  vnl_fastops::ABt(out, A.transpose(), B.transpose());
+  TEST("vnl_fastops::ABt", bitwise_equal(out, reference_product(A.transpose(), B)), true);
+}
+
+TESTMAIN(test_gemm);
@@ -16,6 +16,7 @@
 #include <vnl/vnl_copy.h>
 #include <vnl/vnl_cross.h>
 #include <vnl/vnl_crs_index.h>
+#include <vnl/vnl_csr_matrix.h>
 #include <vnl/vnl_cost_function.h>
 #include <vnl/vnl_cross_product_matrix.h>
 #include <vnl/vnl_decnum.h>
@@ -45,6 +46,7 @@
 #include <vnl/vnl_file_matrix.h>
 #include <vnl/vnl_file_vector.h>
 #include <vnl/vnl_finite.h>
+#include <vnl/vnl_gemm.h>
 #include <vnl/vnl_float_1x1.h>
 #include <vnl/vnl_float_1x2.h>
 #include <vnl/vnl_float_1x3.h>
@@ -93,10 +95,12 @@
 #include <vnl/vnl_matrix_fixed.h>
 #include <vnl/vnl_matrix_ref.h>
 #include <vnl/vnl_matrix_fixed_ref.h>
+#include <vnl/vnl_matrix_fixed_batch.h>
 #include <vnl/vnl_na.h>
 #include <vnl/vnl_nonlinear_minimizer.h>
 #include <vnl/vnl_numeric_traits.h>
 #include <vnl/vnl_operators.h>
+#include <vnl/vnl_parallel_for.h>
 #include <vnl/vnl_polynomial.h>
 #include <vnl/vnl_power.h>
 #include <vnl/vnl_quaternion.h>
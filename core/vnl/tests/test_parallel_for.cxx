@@ -0,0 +1,115 @@
+// This is core/vnl/tests/test_parallel_for.cxx
+#include <iostream>
+#include <vector>
+#include <testlib/testlib_test.h>
+//:
+// \file
+// \brief Test the sub-ranges, nesting and thread reuse of vnl_parallel_for
+
+#include <vcl_compiler.h>
+#include <vnl/vnl_parallel_for.h>
+#if VXL_FULLCXX11SUPPORT
+# include <chrono>
+# include <mutex>
+# include <set>
+# include <thread>
+#endif
+
+//: Counts how often each index is visited, and records which sub-ranges ran in a parallel region
+struct count_visits
+{
+  std::vector<unsigned>* visits;
+  std::vector<bool>* in_region;
+
+  void operator()(unsigned b, unsigned e) const
+  {
+    for (unsigned i = b; i < e; ++i)
+      ++(*visits)[i];
+    // so a loop started from here runs serially
+    (*in_region)[b] = vnl_parallel::in_parallel_region();
+  }
+};
+
+static bool each_once(std::vector<unsigned> const& visits, unsigned b, unsigned e)
+{
+  for (unsigned i = 0; i < visits.size(); ++i)
+    if (visits[i] != ((i >= b && i < e) ? 1u : 0u))
+      return false;
+  return true;
+}
+
+#if VXL_FULLCXX11SUPPORT
+//: Records the threads sub-ranges run on
+struct record_threads
+{
+  std::set<std::thread::id>* ids;
+  std::mutex* mutex;
+
+  void operator()(unsigned, unsigned) const
+  {
+    // long enough for the pool threads to take some of the sub-ranges
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::lock_guard<std::mutex> lock(*mutex);
+    ids->insert(std::this_thread::get_id());
+  }
+};
+
+//: Sums [0,n) in parallel, many times over
+static void sum_many_times(unsigned n, unsigned rounds, bool* ok)
+{
+  *ok = true;
+  for (unsigned r = 0; r < rounds; ++r) {
+    std::vector<unsigned> visits(n, 0u);
+    std::vector<bool> in_region(n, false);
+    count_visits f = { &visits, &in_region };
+    vnl_parallel_for(0, n, f);
+    *ok = *ok && each_once(visits, 0, n);
+  }
+}
+#endif
+
+static void test_parallel_for()
+{
+  const unsigned saved_threads = vnl_parallel::max_threads();
+  vnl_parallel::set_max_threads(4);
+
+  std::vector<unsigned> visits(103, 0u);
+  std::vector<bool> in_region(103, false);
+  count_visits f = { &visits, &in_region };
+  vnl_parallel_for(3, 100, f);
+  TEST("every index visited once", each_once(visits, 3, 100), true);
+  TEST("sub-ranges run in a parallel region", in_region[3] && !vnl_parallel::in_parallel_region(), true);
+
+  visits.assign(103, 0u);
+  vnl_parallel_for(0, 103, f, 50);
+  TEST("with a grain size", each_once(visits, 0, 103), true);
+
+  visits.assign(103, 0u);
+  vnl_parallel_for(10, 10, f);
+  TEST("empty range", each_once(visits, 0, 0), true);
+
+#if VXL_FULLCXX11SUPPORT
+  // The sub-ranges of many loops run on the same few threads
+  std::set<std::thread::id> ids;
+  std::mutex mutex;
+  record_threads r = { &ids, &mutex };
+  for (unsigned i = 0; i < 200; ++i)
+    vnl_parallel_for(0, 4, r);
+  std::cout << ids.size() << " threads used by 200 loops\n";
+  TEST("threads are reused", ids.size() <= 4, true);
+
+  // Several threads starting loops at the same time
+  const unsigned n_callers = 3;
+  bool ok[n_callers];
+  std::vector<std::thread> callers;
+  for (unsigned t = 0; t < n_callers; ++t)
+    callers.push_back(std::thread(sum_many_times, 1000 + t, 50, &ok[t]));
+  for (unsigned t = 0; t < n_callers; ++t)
+    callers[t].join();
+  TEST("concurrent callers", ok[0] && ok[1] && ok[2], true);
+#endif
+
+  vnl_parallel::set_max_threads(saved_threads);
+}
+
+TESTMAIN(test_parallel_for);
@@ -11,8 +11,15 @@
 
 #include "vnl_cost_function.h"
 #include <vcl_cassert.h>
+#include <vcl_compiler.h>
+#include <vnl/vnl_least_squares_function.h>
 
+// f() and gradf() may be called concurrently by fdgradf()
+#if VXL_FULLCXX11SUPPORT
+static thread_local bool f_calling_compute;
+#else
 static bool f_calling_compute;
+#endif
 
 void vnl_cost_function::compute(vnl_vector<double> const& x, double *val, vnl_vector<double>* g)
 {
@@ -43,25 +50,41 @@ void vnl_cost_function::gradf(vnl_vector<double> const& x, vnl_vector<double>& g
   f_calling_compute = false;
 }
 
+//: Elements [i0,i1) of a central difference gradient
+struct vnl_cost_function_fd_gradient
+{
+  vnl_cost_function* fn;
+  vnl_vector<double> const* x;
+  vnl_vector<double>* gradient;
+  double h;
+
+  void operator()(unsigned int i0, unsigned int i1) const
+  {
+    vnl_vector<double> tx = *x;
+    for (unsigned int i = i0; i < i1; ++i) {
+      double tplus = (*x)[i] + h;
+      tx[i] = tplus;
+      double fplus = fn->f(tx);
+
+      double tminus = (*x)[i] - h;
+      tx[i] = tminus;
+      double fminus = fn->f(tx);
+
+      (*gradient)[i] = (fplus - fminus) / (tplus - tminus);
+      tx[i] = (*x)[i];
+    }
+  }
+};
+
 //: Compute fd gradient
 void vnl_cost_function::fdgradf(vnl_vector<double> const& x,
                                 vnl_vector<double> &  gradient,
                                 double stepsize )
 {
-  vnl_vector<double> tx = x;
-  double h = stepsize;
-  for (int i = 0; i < dim; ++i) {
-    double tplus = x[i] + h;
-    tx[i] = tplus;
-    double fplus = this->f(tx);
-
-    double tminus = x[i] - h;
-    tx[i] = tminus;
-    double fminus = this->f(tx);
-
-    gradient[i] = (fplus - fminus) / (tplus - tminus);
-    tx[i] = x[i];
-  }
+  vnl_cost_function_fd_gradient elements = { this, &x, &gradient, stepsize };
+  // f() may evaluate a least squares function (e.g. vnl_least_squares_cost_function),
+  // whose failure flag must not be set by the workers
+  vnl_least_squares_function_parallel_for(0, dim, elements, thread_safe_);
 }
 
 vnl_vector<double> vnl_cost_function::gradf(vnl_vector<double> const& x)
@@ -15,6 +15,7 @@
 //  971023 AWF Initial version.
 //  LSB (Manchester) 26/3/01 Tidied documentation
 //   Feb.2002 - Peter Vanroose - brief doxygen comment placed on single line
+//   set_thread_safe() lets fdgradf() evaluate f in parallel
 // \endverbatim
 //
 //-----------------------------------------------------------------------------
@@ -31,10 +32,10 @@ class VNL_EXPORT vnl_cost_function : public vnl_unary_function<double, vnl_vecto
  public:
 
   //! Default constructor
-  vnl_cost_function():dim(0) {}
+  vnl_cost_function():dim(0), thread_safe_(false) {}
 
   //! Construct with a specified number of unknowns
-  vnl_cost_function(int number_of_unknowns):dim(number_of_unknowns) {}
+  vnl_cost_function(int number_of_unknowns):dim(number_of_unknowns), thread_safe_(false) {}
 
   virtual ~vnl_cost_function() {}
 
@@ -52,6 +53,7 @@ class VNL_EXPORT vnl_cost_function : public vnl_unary_function<double, vnl_vecto
   int get_number_of_unknowns() const { return dim; }
 
   //:  Compute finite-difference gradient
+  //   The elements are computed in parallel if is_thread_safe().
   void fdgradf(vnl_vector<double> const& x, vnl_vector<double>& gradient, double stepsize = 1e-5);
 
   //:  Called when error is printed for user.
@@ -61,6 +63,15 @@ class VNL_EXPORT vnl_cost_function : public vnl_unary_function<double, vnl_vecto
   vnl_vector<double> gradf(vnl_vector<double> const& x);
   vnl_vector<double> fdgradf(vnl_vector<double> const& x);
 
+  //:  Declare that f() may be called concurrently from several threads.
+  //   If so, fdgradf() evaluates f at the perturbed parameter vectors in
+  //   parallel, using vnl_parallel_for.  The result is identical to the
+  //   serial one.  Off by default.
+  void set_thread_safe(bool safe) { thread_safe_ = safe; }
+
+  //:  Return true if f() may be called concurrently
+  bool is_thread_safe() const { return thread_safe_; }
+
 protected:
 
     //! Set number of unknowns.
@@ -68,6 +79,9 @@ protected:
 
 public:
     int dim;
+
+protected:
+    bool thread_safe_;
 };
 
 #endif // vnl_cost_function_h_
@@ -0,0 +1,173 @@
+// This is core/vnl/vnl_csr_matrix.h
+#ifndef vnl_csr_matrix_h_
+#define vnl_csr_matrix_h_
+//:
+// \file
+// \brief Immutable sparse matrix in compressed row (and column) form
+//
+// vnl_csr_matrix is a "frozen" vnl_sparse_matrix.  The non-zero entries are
+// held in three flat arrays (row offsets, column indices and values) rather
+// than one std::vector per row, and the same entries are also indexed by
+// column, so that both A*x and A'*y are computed by gathering along
+// contiguous memory without any scatter.
+//
+// The matrix cannot be changed after construction, so all the const
+// methods may be called concurrently.  mult(), pre_mult(), diag_AtA() and
+// AtA() are themselves split across vnl_parallel_for when the matrix is
+// large enough.  Each output element is accumulated in the same order as
+// in the corresponding vnl_sparse_matrix method, so the results are bitwise
+// identical to those, whatever the number of threads.
+//
+// A matrix is built either from a vnl_sparse_matrix or, without the cost
+// of inserting elements one at a time, from (row, column, value) triplets:
+// \code
+//   vnl_csr_matrix_builder<double> builder(n_residuals, n_unknowns);
+//   builder.reserve(9*n_residuals);
+//   for (...)
+//     builder.add(r, c, v);    // duplicates are summed
+//   vnl_csr_matrix<double> A(builder);
+// \endcode
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <vector>
+#include <vnl/vnl_vector.h>
+#include <vnl/vnl_sparse_matrix.h>
+#include "vnl/vnl_export.h"
+
+template <class T> class vnl_csr_matrix_builder;
+
+//: Immutable sparse matrix in compressed row form, with a column index.
+template <class T>
+class VNL_EXPORT vnl_csr_matrix
+{
+ public:
+  //: Construct an empty 0x0 matrix
+  vnl_csr_matrix();
+
+  //: Copy the non-zero entries of a vnl_sparse_matrix.
+  //  Explicitly stored zeros are kept.
+  explicit vnl_csr_matrix(vnl_sparse_matrix<T> const& A);
+
+  //: Assemble from the triplets collected by a builder.
+  explicit vnl_csr_matrix(vnl_csr_matrix_builder<T> const& builder);
+
+  //: Assemble an r*c matrix from triplets (row[k], col[k], value[k]).
+  //  Entries with the same row and column are summed.
+  vnl_csr_matrix(unsigned int r, unsigned int c,
+                 std::vector<unsigned int> const& row,
+                 std::vector<unsigned int> const& col,
+                 std::vector<T> const& value);
+
+  //: Get the number of rows in the matrix.
+  unsigned int rows() const { return rs_; }
+
+  //: Get the number of columns in the matrix.
+  unsigned int cols() const { return cs_; }
+
+  //: Get the number of columns in the matrix.
+  unsigned int columns() const { return cs_; }
+
+  //: Number of stored entries.
+  unsigned int nnz() const { return (unsigned int)(values_.size()); }
+
+  //: Get an entry in the matrix (zero if it is not stored).
+  T get(unsigned int r, unsigned int c) const;
+
+  //: Get the value of an entry in the matrix.
+  T operator()(unsigned int r, unsigned int c) const { return get(r, c); }
+
+  //: Multiply this*rhs, where rhs is a vector.
+  void mult(vnl_vector<T> const& rhs, vnl_vector<T>& result) const;
+
+  //: Multiplies lhs*this, where lhs is a vector, i.e. this'*lhs.
+  void pre_mult(vnl_vector<T> const& lhs, vnl_vector<T>& result) const;
+
+  //: Get diag(A_transpose * A).
+  // Useful for forming Jacobi preconditioners for linear solvers.
+  void diag_AtA(vnl_vector<T>& result) const;
+
+  //: Return A_transpose * A, which is symmetric.
+  vnl_csr_matrix<T> AtA() const;
+
+  //: Return the transpose of this matrix.
+  vnl_csr_matrix<T> transpose() const;
+
+  //: Copy into a vnl_sparse_matrix.
+  vnl_sparse_matrix<T> as_sparse_matrix() const;
+
+  //: Comparison of the sizes and the stored entries.
+  bool operator==(vnl_csr_matrix<T> const& rhs) const;
+
+  //: Inequality
+  bool operator!=(vnl_csr_matrix<T> const& rhs) const { return !operator==(rhs); }
+
+  // Access to the compressed arrays.  The entries of row r are
+  // [row_start()[r], row_start()[r+1]) in col_index() and row_value(), in
+  // increasing column order; likewise for column c in col_start(),
+  // row_index() and col_value(), in increasing row order.
+
+  std::vector<unsigned int> const& row_start() const { return row_start_; }
+  std::vector<unsigned int> const& col_index() const { return col_index_; }
+  std::vector<T> const& row_value() const { return values_; }
+  std::vector<unsigned int> const& col_start() const { return col_start_; }
+  std::vector<unsigned int> const& row_index() const { return row_index_; }
+  std::vector<T> const& col_value() const { return col_values_; }
+
+ private:
+  unsigned int rs_, cs_;
+  std::vector<unsigned int> row_start_;
+  std::vector<unsigned int> col_index_;
+  std::vector<T> values_;
+  std::vector<unsigned int> col_start_;
+  std::vector<unsigned int> row_index_;
+  std::vector<T> col_values_;
+
+  //: Fill the column index from the row arrays.
+  void build_column_index();
+
+  //: Sort and sum (row, col, value) triplets into the row arrays.
+  void assemble(std::vector<unsigned int> const& row,
+                std::vector<unsigned int> const& col,
+                std::vector<T> const& value);
+};
+
+//: Collects (row, column, value) triplets for a vnl_csr_matrix.
+//  Adding a triplet is an amortised O(1) append; the sorting and summing
+//  of duplicates happens once, when the vnl_csr_matrix is constructed.
+template <class T>
+class vnl_csr_matrix_builder
+{
+ public:
+  //: Start an empty r*c matrix
+  vnl_csr_matrix_builder(unsigned int r, unsigned int c) : rs_(r), cs_(c) {}
+
+  //: Allocate room for \a n triplets.
+  void reserve(unsigned int n) { row_.reserve(n); col_.reserve(n); value_.reserve(n); }
+
+  //: Add \a v to the entry at (r, c).
+  void add(unsigned int r, unsigned int c, T const& v)
+  {
+    row_.push_back(r); col_.push_back(c); value_.push_back(v);
+  }
+
+  //: Forget all the triplets added so far.
+  void clear() { row_.clear(); col_.clear(); value_.clear(); }
+
+  unsigned int rows() const { return rs_; }
+  unsigned int cols() const { return cs_; }
+  unsigned int size() const { return (unsigned int)(value_.size()); }
+
+  std::vector<unsigned int> const& row() const { return row_; }
+  std::vector<unsigned int> const& col() const { return col_; }
+  std::vector<T> const& value() const { return value_; }
+
+ private:
+  unsigned int rs_, cs_;
+  std::vector<unsigned int> row_, col_;
+  std::vector<T> value_;
+};
+
+#endif // vnl_csr_matrix_h_
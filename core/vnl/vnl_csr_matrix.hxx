@@ -0,0 +1,391 @@
+// This is core/vnl/vnl_csr_matrix.hxx
+#ifndef vnl_csr_matrix_hxx_
+#define vnl_csr_matrix_hxx_
+//:
+// \file
+
+#include <algorithm>
+#include "vnl_csr_matrix.h"
+#include <vcl_cassert.h>
+#include <vcl_compiler.h>
+#include <vnl/vnl_parallel_for.h>
+
+//: Smallest number of rows (or columns) worth giving to a thread.
+//  Aims for at least 16384 stored entries per sub-range.
+inline unsigned vnl_csr_matrix_grain(unsigned n, unsigned nnz)
+{
+  return 1u + unsigned(16384.0 * double(n) / (double(nnz) + 1.0));
+}
+
+//: Orders triplet positions by column.
+struct vnl_csr_matrix_column_less
+{
+  std::vector<unsigned int> const* col;
+  bool operator()(unsigned int a, unsigned int b) const { return (*col)[a] < (*col)[b]; }
+};
+
+//: y = A*x over a range of rows.
+template <class T>
+struct vnl_csr_matrix_mult_rows
+{
+  unsigned int const* start;
+  unsigned int const* index;
+  T const* value;
+  T const* x;
+  T* y;
+
+  void operator()(unsigned r0, unsigned r1) const
+  {
+    for (unsigned r = r0; r < r1; ++r) {
+      T sum(0);
+      for (unsigned k = start[r]; k < start[r+1]; ++k)
+        sum += x[index[k]] * value[k];
+      y[r] = sum;
+    }
+  }
+};
+
+//: diag(A'*A) over a range of columns.
+template <class T>
+struct vnl_csr_matrix_diag_AtA_cols
+{
+  unsigned int const* start;
+  T const* value;
+  T* d;
+
+  void operator()(unsigned c0, unsigned c1) const
+  {
+    for (unsigned c = c0; c < c1; ++c) {
+      T sum(0);
+      for (unsigned k = start[c]; k < start[c+1]; ++k)
+        sum += value[k] * value[k];
+      d[c] = sum;
+    }
+  }
+};
+
+//: Rows of A'*A over a range of columns of A.
+template <class T>
+struct vnl_csr_matrix_AtA_rows
+{
+  vnl_csr_matrix<T> const* A;
+  std::vector<std::vector<unsigned int> >* cols;
+  std::vector<std::vector<T> >* vals;
+
+  void operator()(unsigned i0, unsigned i1) const
+  {
+    std::vector<unsigned int> const& col_start = A->col_start();
+    std::vector<unsigned int> const& row_index = A->row_index();
+    std::vector<T> const& col_value = A->col_value();
+    std::vector<unsigned int> const& row_start = A->row_start();
+    std::vector<unsigned int> const& col_index = A->col_index();
+    std::vector<T> const& row_value = A->row_value();
+
+    // Dense accumulator for one row of the result, with a list of the
+    // columns which have been touched.
+    std::vector<T> acc(A->cols(), T(0));
+    std::vector<bool> used(A->cols(), false);
+    std::vector<unsigned int> touched;
+    for (unsigned i = i0; i < i1; ++i) {
+      touched.clear();
+      for (unsigned k = col_start[i]; k < col_start[i+1]; ++k) {
+        const unsigned r = row_index[k];
+        const T a = col_value[k];
+        for (unsigned q = row_start[r]; q < row_start[r+1]; ++q) {
+          const unsigned j = col_index[q];
+          if (!used[j]) {
+            used[j] = true;
+            touched.push_back(j);
+          }
+          acc[j] += a * row_value[q];
+        }
+      }
+      std::sort(touched.begin(), touched.end());
+      std::vector<unsigned int>& ci = (*cols)[i];
+      std::vector<T>& vi = (*vals)[i];
+      ci = touched;
+      vi.resize(touched.size());
+      for (unsigned t = 0; t < touched.size(); ++t) {
+        vi[t] = acc[touched[t]];
+        acc[touched[t]] = T(0);
+        used[touched[t]] = false;
+      }
+    }
+  }
+};
+
+//: Sort each row's triplets by column and sum the duplicates, in place.
+//  The number of distinct entries in row r is written to count[r].
+template <class T>
+struct vnl_csr_matrix_assemble_rows
+{
+  unsigned int const* start;
+  std::vector<unsigned int>* col;
+  std::vector<T>* value;
+  unsigned int* count;
+
+  void operator()(unsigned r0, unsigned r1) const
+  {
+    std::vector<unsigned int> order;
+    std::vector<unsigned int> c;
+    std::vector<T> v;
+    vnl_csr_matrix_column_less less;
+    less.col = col;
+    for (unsigned r = r0; r < r1; ++r) {
+      const unsigned b = start[r], e = start[r+1];
+      order.resize(e - b);
+      for (unsigned k = b; k < e; ++k)
+        order[k-b] = k;
+      // Stable, so that duplicates are summed in the order they were added
+      std::stable_sort(order.begin(), order.end(), less);
+      c.clear(); v.clear();
+      for (unsigned k = 0; k < order.size(); ++k) {
+        const unsigned ck = (*col)[order[k]];
+        if (!c.empty() && c.back() == ck)
+          v.back() += (*value)[order[k]];
+        else {
+          c.push_back(ck);
+          v.push_back((*value)[order[k]]);
+        }
+      }
+      for (unsigned k = 0; k < c.size(); ++k) {
+        (*col)[b+k] = c[k];
+        (*value)[b+k] = v[k];
+      }
+      count[r] = (unsigned int)(c.size());
+    }
+  }
+};
+
+//------------------------------------------------------------
+
+template <class T>
+vnl_csr_matrix<T>::vnl_csr_matrix()
+  : rs_(0), cs_(0), row_start_(1, 0u), col_start_(1, 0u)
+{
+}
+
+template <class T>
+vnl_csr_matrix<T>::vnl_csr_matrix(vnl_sparse_matrix<T> const& A)
+  : rs_(A.rows()), cs_(A.columns()), row_start_(A.rows()+1, 0u)
+{
+  vnl_sparse_matrix<T>& a = const_cast<vnl_sparse_matrix<T>&>(A); // get_row() is not const
+  for (unsigned r = 0; r < rs_; ++r)
+    row_start_[r+1] = row_start_[r] + (unsigned int)(a.get_row(r).size());
+  col_index_.resize(row_start_[rs_]);
+  values_.resize(row_start_[rs_]);
+  for (unsigned r = 0; r < rs_; ++r) {
+    typename vnl_sparse_matrix<T>::row const& rw = a.get_row(r);
+    for (unsigned k = 0; k < rw.size(); ++k) {
+      col_index_[row_start_[r]+k] = rw[k].first;
+      values_[row_start_[r]+k] = rw[k].second;
+    }
+  }
+  build_column_index();
+}
+
+template <class T>
+vnl_csr_matrix<T>::vnl_csr_matrix(vnl_csr_matrix_builder<T> const& builder)
+  : rs_(builder.rows()), cs_(builder.cols())
+{
+  assemble(builder.row(), builder.col(), builder.value());
+}
+
+template <class T>
+vnl_csr_matrix<T>::vnl_csr_matrix(unsigned int r, unsigned int c,
+                                  std::vector<unsigned int> const& row,
+                                  std::vector<unsigned int> const& col,
+                                  std::vector<T> const& value)
+  : rs_(r), cs_(c)
+{
+  assemble(row, col, value);
+}
+
+template <class T>
+void vnl_csr_matrix<T>::assemble(std::vector<unsigned int> const& row,
+                                 std::vector<unsigned int> const& col,
+                                 std::vector<T> const& value)
+{
+  assert(row.size() == col.size() && row.size() == value.size());
+  const unsigned n = (unsigned int)(row.size());
+
+  // Counting sort of the triplets by row.
+  std::vector<unsigned int> start(rs_+1, 0u);
+  for (unsigned k = 0; k < n; ++k) {
+    assert(row[k] < rs_ && col[k] < cs_);
+    ++start[row[k]+1];
+  }
+  for (unsigned r = 0; r < rs_; ++r)
+    start[r+1] += start[r];
+  std::vector<unsigned int> c(n);
+  std::vector<T> v(n);
+  std::vector<unsigned int> next(start.begin(), start.end()-1);
+  for (unsigned k = 0; k < n; ++k) {
+    const unsigned p = next[row[k]]++;
+    c[p] = col[k];
+    v[p] = value[k];
+  }
+
+  // Sort each row by column and merge duplicates.
+  std::vector<unsigned int> count(rs_, 0u);
+  vnl_csr_matrix_assemble_rows<T> body = { &start[0], &c, &v, rs_ ? &count[0] : VXL_NULLPTR };
+  vnl_parallel_for(0, rs_, body, vnl_csr_matrix_grain(rs_, n));
+
+  // Close up the gaps left by the duplicates.
+  row_start_.assign(rs_+1, 0u);
+  for (unsigned r = 0; r < rs_; ++r)
+    row_start_[r+1] = row_start_[r] + count[r];
+  col_index_.resize(row_start_[rs_]);
+  values_.resize(row_start_[rs_]);
+  for (unsigned r = 0; r < rs_; ++r)
+    for (unsigned k = 0; k < count[r]; ++k) {
+      col_index_[row_start_[r]+k] = c[start[r]+k];
+      values_[row_start_[r]+k] = v[start[r]+k];
+    }
+  build_column_index();
+}
+
+template <class T>
+void vnl_csr_matrix<T>::build_column_index()
+{
+  const unsigned n = nnz();
+  col_start_.assign(cs_+1, 0u);
+  for (unsigned k = 0; k < n; ++k)
+    ++col_start_[col_index_[k]+1];
+  for (unsigned c = 0; c < cs_; ++c)
+    col_start_[c+1] += col_start_[c];
+  row_index_.resize(n);
+  col_values_.resize(n);
+  std::vector<unsigned int> next(col_start_.begin(), col_start_.end()-1);
+  // Rows are visited in order, so each column's entries are sorted by row.
+  for (unsigned r = 0; r < rs_; ++r)
+    for (unsigned k = row_start_[r]; k < row_start_[r+1]; ++k) {
+      const unsigned p = next[col_index_[k]]++;
+      row_index_[p] = r;
+      col_values_[p] = values_[k];
+    }
+}
+
+template <class T>
+T vnl_csr_matrix<T>::get(unsigned int r, unsigned int c) const
+{
+  assert(r < rows() && c < columns());
+  std::vector<unsigned int>::const_iterator b = col_index_.begin() + row_start_[r];
+  std::vector<unsigned int>::const_iterator e = col_index_.begin() + row_start_[r+1];
+  std::vector<unsigned int>::const_iterator p = std::lower_bound(b, e, c);
+  if (p == e || *p != c)
+    return T(0);
+  return values_[p - col_index_.begin()];
+}
+
+//------------------------------------------------------------
+
+template <class T>
+void vnl_csr_matrix<T>::mult(vnl_vector<T> const& rhs, vnl_vector<T>& result) const
+{
+  assert(rhs.size() == columns());
+  assert(&rhs != &result);
+  result.set_size(rows());
+  if (rs_ == 0)
+    return;
+  vnl_csr_matrix_mult_rows<T> body = { &row_start_[0], nnz() ? &col_index_[0] : VXL_NULLPTR,
+                                       nnz() ? &values_[0] : VXL_NULLPTR,
+                                       rhs.data_block(), result.data_block() };
+  vnl_parallel_for(0, rs_, body, vnl_csr_matrix_grain(rs_, nnz()));
+}
+
+template <class T>
+void vnl_csr_matrix<T>::pre_mult(vnl_vector<T> const& lhs, vnl_vector<T>& result) const
+{
+  assert(lhs.size() == rows());
+  assert(&lhs != &result);
+  result.set_size(columns());
+  if (cs_ == 0)
+    return;
+  // Gather along the columns, so that no two threads write to the same element.
+  vnl_csr_matrix_mult_rows<T> body = { &col_start_[0], nnz() ? &row_index_[0] : VXL_NULLPTR,
+                                       nnz() ? &col_values_[0] : VXL_NULLPTR,
+                                       lhs.data_block(), result.data_block() };
+  vnl_parallel_for(0, cs_, body, vnl_csr_matrix_grain(cs_, nnz()));
+}
+
+template <class T>
+void vnl_csr_matrix<T>::diag_AtA(vnl_vector<T>& result) const
+{
+  result.set_size(columns());
+  if (cs_ == 0)
+    return;
+  vnl_csr_matrix_diag_AtA_cols<T> body = { &col_start_[0], nnz() ? &col_values_[0] : VXL_NULLPTR,
+                                           result.data_block() };
+  vnl_parallel_for(0, cs_, body, vnl_csr_matrix_grain(cs_, nnz()));
+}
+
+template <class T>
+vnl_csr_matrix<T> vnl_csr_matrix<T>::AtA() const
+{
+  std::vector<std::vector<unsigned int> > cols(cs_);
+  std::vector<std::vector<T> > vals(cs_);
+  vnl_csr_matrix_AtA_rows<T> body = { this, &cols, &vals };
+  // Each stored entry is multiplied by about nnz/rows others.
+  const double work = double(nnz()) * (1.0 + double(nnz()) / (double(rs_) + 1.0));
+  vnl_parallel_for(0, cs_, body, 1u + unsigned(16384.0 * double(cs_) / (work + 1.0)));
+
+  vnl_csr_matrix<T> result;
+  result.rs_ = result.cs_ = cs_;
+  result.row_start_.assign(cs_+1, 0u);
+  for (unsigned i = 0; i < cs_; ++i)
+    result.row_start_[i+1] = result.row_start_[i] + (unsigned int)(cols[i].size());
+  result.col_index_.reserve(result.row_start_[cs_]);
+  result.values_.reserve(result.row_start_[cs_]);
+  for (unsigned i = 0; i < cs_; ++i) {
+    result.col_index_.insert(result.col_index_.end(), cols[i].begin(), cols[i].end());
+    result.values_.insert(result.values_.end(), vals[i].begin(), vals[i].end());
+  }
+  result.build_column_index();
+  return result;
+}
+
+template <class T>
+vnl_csr_matrix<T> vnl_csr_matrix<T>::transpose() const
+{
+  vnl_csr_matrix<T> result;
+  result.rs_ = cs_;
+  result.cs_ = rs_;
+  result.row_start_ = col_start_;
+  result.col_index_ = row_index_;
+  result.values_ = col_values_;
+  result.col_start_ = row_start_;
+  result.row_index_ = col_index_;
+  result.col_values_ = values_;
+  return result;
+}
+
+template <class T>
+vnl_sparse_matrix<T> vnl_csr_matrix<T>::as_sparse_matrix() const
+{
+  vnl_sparse_matrix<T> result(rs_, cs_);
+  std::vector<int> c;
+  std::vector<T> v;
+  for (unsigned r = 0; r < rs_; ++r) {
+    if (row_start_[r] == row_start_[r+1])
+      continue;
+    c.assign(col_index_.begin() + row_start_[r], col_index_.begin() + row_start_[r+1]);
+    v.assign(values_.begin() + row_start_[r], values_.begin() + row_start_[r+1]);
+    result.set_row(r, c, v);
+  }
+  return result;
+}
+
+template <class T>
+bool vnl_csr_matrix<T>::operator==(vnl_csr_matrix<T> const& rhs) const
+{
+  return rs_ == rhs.rs_ && cs_ == rhs.cs_ &&
+         row_start_ == rhs.row_start_ &&
+         col_index_ == rhs.col_index_ &&
+         values_ == rhs.values_;
+}
+
+#define VNL_CSR_MATRIX_INSTANTIATE(T) \
+template class VNL_EXPORT vnl_csr_matrix<T >
+
+#endif // vnl_csr_matrix_hxx_
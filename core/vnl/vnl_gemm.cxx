@@ -0,0 +1,338 @@
+// This is core/vnl/vnl_gemm.cxx
+//:
+// \file
+//
+// The structure follows the usual layout of high performance GEMM codes:
+// C is computed in column blocks of width NC; for each block of KC inner
+// indices a KC x NC panel of op(B) is packed into NR-wide strips, then for
+// each MC-row block of C the matching MC x KC panel of op(A) is packed into
+// MR-high strips and an MR x NR micro-kernel accumulates one register tile
+// of C at a time.  Zero padding of the packed panels takes care of the
+// edges, which are written back through a small temporary tile.
+
+#include <vector>
+#include "vnl_gemm.h"
+#include "vnl_parallel_for.h"
+
+#include <vcl_compiler.h>
+#include <vxl_config.h>
+
+#if VXL_HAS_EMMINTRIN_H && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+# define VNL_GEMM_SSE2 1
+# include <emmintrin.h>
+# if defined(__AVX__)
+#  define VNL_GEMM_AVX 1
+#  include <immintrin.h>
+# endif
+#endif
+
+static bool vnl_gemm_deterministic_ = true;
+
+bool vnl_gemm_deterministic() { return vnl_gemm_deterministic_; }
+
+void vnl_gemm_set_deterministic(bool deterministic) { vnl_gemm_deterministic_ = deterministic; }
+
+//------------------------------------------------------------------------------
+// SIMD register abstractions used by the micro-kernel.
+
+//: Plain scalar "register", used when no SIMD instruction set is available.
+template <class T>
+struct vnl_gemm_scalar
+{
+  typedef T reg;
+  enum { width = 1 };
+  static reg zero() { return T(0); }
+  static reg load(T const* p) { return *p; }
+  static void store(T* p, reg r) { *p = r; }
+  static reg broadcast(T const* p) { return *p; }
+  static reg mul_add(reg c, reg a, reg b) { return c + T(a*b); }
+  static reg fused_mul_add(reg c, reg a, reg b) { return c + a*b; }
+};
+
+#if VNL_GEMM_SSE2
+struct vnl_gemm_sse2_double
+{
+  typedef __m128d reg;
+  enum { width = 2 };
+  static reg zero() { return _mm_setzero_pd(); }
+  static reg load(double const* p) { return _mm_loadu_pd(p); }
+  static void store(double* p, reg r) { _mm_storeu_pd(p, r); }
+  static reg broadcast(double const* p) { return _mm_load1_pd(p); }
+  static reg mul_add(reg c, reg a, reg b) { return _mm_add_pd(c, _mm_mul_pd(a, b)); }
+  static reg fused_mul_add(reg c, reg a, reg b) { return mul_add(c, a, b); }
+};
+
+struct vnl_gemm_sse2_float
+{
+  typedef __m128 reg;
+  enum { width = 4 };
+  static reg zero() { return _mm_setzero_ps(); }
+  static reg load(float const* p) { return _mm_loadu_ps(p); }
+  static void store(float* p, reg r) { _mm_storeu_ps(p, r); }
+  static reg broadcast(float const* p) { return _mm_load1_ps(p); }
+  static reg mul_add(reg c, reg a, reg b) { return _mm_add_ps(c, _mm_mul_ps(a, b)); }
+  static reg fused_mul_add(reg c, reg a, reg b) { return mul_add(c, a, b); }
+};
+#endif // VNL_GEMM_SSE2
+
+#if VNL_GEMM_AVX
+struct vnl_gemm_avx_double
+{
+  typedef __m256d reg;
+  enum { width = 4 };
+  static reg zero() { return _mm256_setzero_pd(); }
+  static reg load(double const* p) { return _mm256_loadu_pd(p); }
+  static void store(double* p, reg r) { _mm256_storeu_pd(p, r); }
+  static reg broadcast(double const* p) { return _mm256_broadcast_sd(p); }
+  static reg mul_add(reg c, reg a, reg b) { return _mm256_add_pd(c, _mm256_mul_pd(a, b)); }
+# if defined(__FMA__)
+  static reg fused_mul_add(reg c, reg a, reg b) { return _mm256_fmadd_pd(a, b, c); }
+# else
+  static reg fused_mul_add(reg c, reg a, reg b) { return mul_add(c, a, b); }
+# endif
+};
+
+struct vnl_gemm_avx_float
+{
+  typedef __m256 reg;
+  enum { width = 8 };
+  static reg zero() { return _mm256_setzero_ps(); }
+  static reg load(float const* p) { return _mm256_loadu_ps(p); }
+  static void store(float* p, reg r) { _mm256_storeu_ps(p, r); }
+  static reg broadcast(float const* p) { return _mm256_broadcast_ss(p); }
+  static reg mul_add(reg c, reg a, reg b) { return _mm256_add_ps(c, _mm256_mul_ps(a, b)); }
+# if defined(__FMA__)
+  static reg fused_mul_add(reg c, reg a, reg b) { return _mm256_fmadd_ps(a, b, c); }
+# else
+  static reg fused_mul_add(reg c, reg a, reg b) { return mul_add(c, a, b); }
+# endif
+};
+#endif // VNL_GEMM_AVX
+
+//: Register set and blocking parameters for each element type.
+// The micro-tile is MR rows by NV SIMD registers; MC, KC and NC are the
+// cache block sizes (MC must be a multiple of MR).
+template <class T> struct vnl_gemm_traits;
+
+template <> struct vnl_gemm_traits<double>
+{
+#if VNL_GEMM_AVX
+  typedef vnl_gemm_avx_double simd;
+#elif VNL_GEMM_SSE2
+  typedef vnl_gemm_sse2_double simd;
+#else
+  typedef vnl_gemm_scalar<double> simd;
+#endif
+  enum { MR = 4, NV = 2, NR = NV * simd::width, MC = 96, KC = 256, NC = 2048 };
+};
+
+template <> struct vnl_gemm_traits<float>
+{
+#if VNL_GEMM_AVX
+  typedef vnl_gemm_avx_float simd;
+#elif VNL_GEMM_SSE2
+  typedef vnl_gemm_sse2_float simd;
+#else
+  typedef vnl_gemm_scalar<float> simd;
+#endif
+  enum { MR = 4, NV = 2, NR = NV * simd::width, MC = 128, KC = 384, NC = 4096 };
+};
+
+//------------------------------------------------------------------------------
+
+//: Accumulate one MR x NR tile: c += a * b over kc packed inner indices.
+// \p a holds kc groups of MR values, \p b kc groups of NR values. c[i] points
+// to column 0 of the tile in row i. If \p load_c is false the tile starts
+// from zero instead of the current contents of c.
+template <class T, bool fused>
+static void vnl_gemm_micro_kernel(unsigned kc, T const* a, T const* b,
+                                  T* const* c, bool load_c)
+{
+  typedef vnl_gemm_traits<T> traits;
+  typedef typename traits::simd simd;
+  typedef typename simd::reg reg;
+  const unsigned MR = traits::MR, NV = traits::NV, NR = traits::NR, W = simd::width;
+
+  reg acc[MR][NV];
+  for (unsigned i = 0; i < MR; ++i)
+    for (unsigned v = 0; v < NV; ++v)
+      acc[i][v] = load_c ? simd::load(c[i] + v*W) : simd::zero();
+
+  for (unsigned p = 0; p < kc; ++p, a += MR, b += NR) {
+    reg bv[NV];
+    for (unsigned v = 0; v < NV; ++v)
+      bv[v] = simd::load(b + v*W);
+    for (unsigned i = 0; i < MR; ++i) {
+      const reg ai = simd::broadcast(a + i);
+      for (unsigned v = 0; v < NV; ++v)
+        acc[i][v] = fused ? simd::fused_mul_add(acc[i][v], ai, bv[v])
+                          : simd::mul_add(acc[i][v], ai, bv[v]);
+    }
+  }
+
+  for (unsigned i = 0; i < MR; ++i)
+    for (unsigned v = 0; v < NV; ++v)
+      simd::store(c[i] + v*W, acc[i][v]);
+}
+
+//: Pack rows [i0,i0+mc) and inner indices [p0,p0+kc) of op(A) into MR-high strips.
+template <class T>
+static void vnl_gemm_pack_A(bool trans, T const* const* A,
+                            unsigned i0, unsigned mc, unsigned p0, unsigned kc, T* dst)
+{
+  const unsigned MR = vnl_gemm_traits<T>::MR;
+  for (unsigned ir = 0; ir < mc; ir += MR) {
+    const unsigned mr = mc-ir < MR ? mc-ir : MR;
+    for (unsigned p = 0; p < kc; ++p, dst += MR) {
+      unsigned i = 0;
+      if (trans)
+        for (T const* row = A[p0+p] + i0+ir; i < mr; ++i)
+          dst[i] = row[i];
+      else
+        for (; i < mr; ++i)
+          dst[i] = A[i0+ir+i][p0+p];
+      for (; i < MR; ++i)
+        dst[i] = T(0);
+    }
+  }
+}
+
+//: Pack inner indices [p0,p0+kc) and columns [j0,j0+nc) of op(B) into NR-wide strips.
+template <class T>
+static void vnl_gemm_pack_B(bool trans, T const* const* B,
+                            unsigned p0, unsigned kc, unsigned j0, unsigned nc, T* dst)
+{
+  const unsigned NR = vnl_gemm_traits<T>::NR;
+  for (unsigned jr = 0; jr < nc; jr += NR) {
+    const unsigned nr = nc-jr < NR ? nc-jr : NR;
+    for (unsigned p = 0; p < kc; ++p, dst += NR) {
+      unsigned j = 0;
+      if (trans)
+        for (; j < nr; ++j)
+          dst[j] = B[j0+jr+j][p0+p];
+      else
+        for (T const* row = B[p0+p] + j0+jr; j < nr; ++j)
+          dst[j] = row[j];
+      for (; j < NR; ++j)
+        dst[j] = T(0);
+    }
+  }
+}
+
+//: Compute rows [r0,r1) of C using the blocked algorithm.
+template <class T, bool fused>
+static void vnl_gemm_blocked(bool transA, bool transB, unsigned r0, unsigned r1,
+                             unsigned n, unsigned k,
+                             T const* const* A, T const* const* B, T* const* C)
+{
+  typedef vnl_gemm_traits<T> traits;
+  const unsigned MR = traits::MR, NR = traits::NR;
+  const unsigned MC = traits::MC, KC = traits::KC, NC = traits::NC;
+
+  std::vector<T> Apack(std::size_t(MC) * KC);
+  std::vector<T> Bpack(std::size_t(KC) * ((NC < n ? NC : n) + NR));
+  T tile[MR*NR];
+  T* tile_rows[MR];
+  for (unsigned i = 0; i < MR; ++i)
+    tile_rows[i] = tile + i*NR;
+  T* c_rows[MR];
+
+  for (unsigned jc = 0; jc < n; jc += NC) {
+    const unsigned nc = n-jc < NC ? n-jc : NC;
+    for (unsigned pc = 0; pc < k; pc += KC) {
+      const unsigned kc = k-pc < KC ? k-pc : KC;
+      const bool load_c = pc > 0;
+      vnl_gemm_pack_B(transB, B, pc, kc, jc, nc, &Bpack[0]);
+      for (unsigned ic = r0; ic < r1; ic += MC) {
+        const unsigned mc = r1-ic < MC ? r1-ic : MC;
+        vnl_gemm_pack_A(transA, A, ic, mc, pc, kc, &Apack[0]);
+        for (unsigned jr = 0; jr < nc; jr += NR) {
+          const unsigned nr = nc-jr < NR ? nc-jr : NR;
+          T const* b = &Bpack[0] + std::size_t(jr) * kc;
+          for (unsigned ir = 0; ir < mc; ir += MR) {
+            const unsigned mr = mc-ir < MR ? mc-ir : MR;
+            T const* a = &Apack[0] + std::size_t(ir) * kc;
+            const unsigned col = jc + jr;
+            if (mr == MR && nr == NR) {
+              for (unsigned i = 0; i < MR; ++i)
+                c_rows[i] = C[ic+ir+i] + col;
+              vnl_gemm_micro_kernel<T, fused>(kc, a, b, c_rows, load_c);
+            }
+            else {
+              // Edge tile: go through a full-size temporary.
+              if (load_c)
+                for (unsigned i = 0; i < mr; ++i)
+                  for (unsigned j = 0; j < nr; ++j)
+                    tile_rows[i][j] = C[ic+ir+i][col+j];
+              vnl_gemm_micro_kernel<T, fused>(kc, a, b, tile_rows, load_c);
+              for (unsigned i = 0; i < mr; ++i)
+                for (unsigned j = 0; j < nr; ++j)
+                  C[ic+ir+i][col+j] = tile_rows[i][j];
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+//: Row-range body handed to vnl_parallel_for.
+template <class T, bool fused>
+struct vnl_gemm_rows
+{
+  bool transA, transB;
+  unsigned n, k;
+  T const* const* A;
+  T const* const* B;
+  T* const* C;
+
+  void operator()(unsigned r0, unsigned r1) const
+  {
+    vnl_gemm_blocked<T, fused>(transA, transB, r0, r1, n, k, A, B, C);
+  }
+};
+
+template <class T>
+static void vnl_gemm_impl(bool transA, bool transB,
+                          unsigned m, unsigned n, unsigned k,
+                          T const* const* A, T const* const* B, T* const* C)
+{
+  if (m == 0 || n == 0)
+    return;
+
+  // Small products are not worth packing.
+  const double work = double(m) * double(n) * double(k);
+  if (k == 0 || work < 32768.0) {
+    for (unsigned i = 0; i < m; ++i)
+      for (unsigned j = 0; j < n; ++j) {
+        T sum(0);
+        for (unsigned p = 0; p < k; ++p)
+          sum += T((transA ? A[p][i] : A[i][p]) * (transB ? B[j][p] : B[p][j]));
+        C[i][j] = sum;
+      }
+    return;
+  }
+
+  // Below about 128^3 the cost of starting threads is not recovered.
+  const unsigned grain = work < 2097152.0 ? m : unsigned(vnl_gemm_traits<T>::MC);
+  if (vnl_gemm_deterministic_) {
+    vnl_gemm_rows<T, false> body = { transA, transB, n, k, A, B, C };
+    vnl_parallel_for(0, m, body, grain);
+  }
+  else {
+    vnl_gemm_rows<T, true> body = { transA, transB, n, k, A, B, C };
+    vnl_parallel_for(0, m, body, grain);
+  }
+}
+
+void vnl_gemm(bool transA, bool transB, unsigned m, unsigned n, unsigned k,
+              double const* const* A, double const* const* B, double* const* C)
+{
+  vnl_gemm_impl(transA, transB, m, n, k, A, B, C);
+}
+
+void vnl_gemm(bool transA, bool transB, unsigned m, unsigned n, unsigned k,
+              float const* const* A, float const* const* B, float* const* C)
+{
+  vnl_gemm_impl(transA, transB, m, n, k, A, B, C);
+}
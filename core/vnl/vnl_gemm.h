@@ -0,0 +1,52 @@
+// This is core/vnl/vnl_gemm.h
+#ifndef vnl_gemm_h_
+#define vnl_gemm_h_
+//:
+// \file
+// \brief Cache-blocked general matrix product for float and double
+//
+// vnl_gemm computes C = op(A) * op(B), where op(X) is either X or its
+// transpose, for matrices stored as arrays of row pointers (the layout of
+// vnl_matrix::data_array()).  op(A) is m x k, op(B) is k x n and C is m x n.
+//
+// The product is computed in register tiles by SSE2 or AVX micro-kernels
+// (depending on the instruction set the library is compiled for) over
+// operand panels that are packed to fit the caches.  Large products are
+// split by rows of C across vnl_parallel_for.
+//
+// In deterministic mode (the default) every element of C is accumulated
+// in the same order, and with the same separate multiply and add
+// operations, as the textbook triple loop, so the result is bitwise
+// identical to that loop whatever the blocking or number of threads.
+// Switching deterministic mode off allows fused multiply-add when the
+// library is compiled with FMA support, which is faster but rounds
+// differently.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include "vnl/vnl_export.h"
+
+//: Compute C = op(A) * op(B) for double matrices given as row pointers.
+// If \p transA is true, A is stored as a k x m matrix and op(A) is its
+// transpose; likewise for \p transB (B stored as n x k).
+// C must already have m rows of n elements; it may not alias A or B.
+VNL_EXPORT void vnl_gemm(bool transA, bool transB,
+                         unsigned m, unsigned n, unsigned k,
+                         double const* const* A, double const* const* B,
+                         double* const* C);
+
+//: Compute C = op(A) * op(B) for float matrices given as row pointers.
+VNL_EXPORT void vnl_gemm(bool transA, bool transB,
+                         unsigned m, unsigned n, unsigned k,
+                         float const* const* A, float const* const* B,
+                         float* const* C);
+
+//: Whether vnl_gemm results are bitwise identical to the simple triple loop.
+VNL_EXPORT bool vnl_gemm_deterministic();
+
+//: Choose between bitwise reproducible (default) and fused multiply-add kernels.
+VNL_EXPORT void vnl_gemm_set_deterministic(bool deterministic);
+
+#endif // vnl_gemm_h_
@@ -12,6 +12,85 @@
 #include <vcl_compiler.h>
 #include <vcl_cassert.h>
 
+//: Columns [i0,i1) of a central (or, if fcentre is set, forward) difference Jacobian
+struct vnl_least_squares_function_fd_columns
+{
+  vnl_least_squares_function* fn;
+  vnl_vector<double> const* x;
+  vnl_vector<double> const* fcentre;
+  vnl_matrix<double>* jacobian;
+  double stepsize;
+
+  void operator()(unsigned int i0, unsigned int i1) const
+  {
+    const unsigned int n = jacobian->rows();
+    vnl_vector<double> tx = *x;
+    vnl_vector<double> fplus(n);
+    vnl_vector<double> fminus(n);
+    for (unsigned int i = i0; i < i1; ++i)
+    {
+      // calculate f just to the right of x[i]
+      double tplus = tx[i] = (*x)[i] + stepsize;
+      fn->f(tx, fplus);
+
+      if (fcentre)
+      {
+        double h = 1.0 / (tplus - (*x)[i]);
+        for (unsigned int j = 0; j < n; ++j)
+          (*jacobian)(j,i) = (fplus[j] - (*fcentre)[j]) * h;
+      }
+      else
+      {
+        // calculate f just to the left of x[i]
+        double tminus = tx[i] = (*x)[i] - stepsize;
+        fn->f(tx, fminus);
+
+        double h = 1.0 / (tplus - tminus);
+        for (unsigned int j = 0; j < n; ++j)
+          (*jacobian)(j,i) = (fplus[j] - fminus[j]) * h;
+      }
+
+      // restore tx
+      tx[i] = (*x)[i];
+    }
+  }
+};
+
+//: Where the calling thread records throw_failure() calls, if anywhere
+#if VXL_FULLCXX11SUPPORT
+static thread_local vnl_least_squares_function_failures::record_type* vnl_least_squares_function_record = VXL_NULLPTR;
+#else
+static vnl_least_squares_function_failures::record_type* vnl_least_squares_function_record = VXL_NULLPTR;
+#endif
+
+vnl_least_squares_function_failures::record_type*
+vnl_least_squares_function_failures::start(record_type* r)
+{
+  record_type* saved = vnl_least_squares_function_record;
+  vnl_least_squares_function_record = r;
+  return saved;
+}
+
+void vnl_least_squares_function_failures::stop(record_type* saved)
+{
+  vnl_least_squares_function_record = saved;
+}
+
+void vnl_least_squares_function_failures::apply()
+{
+  for (unsigned int i = 0; i < failed_.size(); ++i)
+    for (unsigned int k = 0; k < failed_[i].size(); ++k)
+      failed_[i][k]->failure = true;
+}
+
+void vnl_least_squares_function::throw_failure()
+{
+  if (vnl_least_squares_function_record)
+    vnl_least_squares_function_record->push_back(this);
+  else
+    failure = true;
+}
+
 void vnl_least_squares_function::dim_warning(unsigned int number_of_unknowns,
                                              unsigned int number_of_residuals)
 {
@@ -33,31 +112,12 @@ void vnl_least_squares_function::fdgradf(vnl_vector<double> const& x,
                                          double stepsize)
 {
   unsigned int dim = x.size();
-  unsigned int n = jacobian.rows();
   assert(dim == get_number_of_unknowns());
-  assert(n == get_number_of_residuals());
+  assert(jacobian.rows() == get_number_of_residuals());
   assert(dim == jacobian.columns());
 
-  vnl_vector<double> tx = x;
-  vnl_vector<double> fplus(n);
-  vnl_vector<double> fminus(n);
-  for (unsigned int i = 0; i < dim; ++i)
-  {
-    // calculate f just to the right of x[i]
-    double tplus = tx[i] = x[i] + stepsize;
-    this->f(tx, fplus);
-
-    // calculate f just to the left of x[i]
-    double tminus = tx[i] = x[i] - stepsize;
-    this->f(tx, fminus);
-
-    double h = 1.0 / (tplus - tminus);
-    for (unsigned int j = 0; j < n; ++j)
-      jacobian(j,i) = (fplus[j] - fminus[j]) * h;
-
-    // restore tx
-    tx[i] = x[i];
-  }
+  vnl_least_squares_function_fd_columns columns = { this, &x, VXL_NULLPTR, &jacobian, stepsize };
+  vnl_least_squares_function_parallel_for(0, dim, columns, thread_safe_);
 }
 
 
@@ -72,23 +132,10 @@ void vnl_least_squares_function::ffdgradf(vnl_vector<double> const& x,
   assert(n == get_number_of_residuals());
   assert(dim == jacobian.columns());
 
-  vnl_vector<double> tx = x;
-  vnl_vector<double> fplus(n);
   vnl_vector<double> fcentre(n);
   this->f(x, fcentre);
-  for (unsigned int i = 0; i < dim; ++i)
-  {
-    // calculate f just to the right of x[i]
-    double tplus = tx[i] = x[i] + stepsize;
-    this->f(tx, fplus);
-
-    double h = 1.0 / (tplus - x[i]);
-    for (unsigned int j = 0; j < n; ++j)
-      jacobian(j,i) = (fplus[j] - fcentre[j]) * h;
-
-    // restore tx
-    tx[i] = x[i];
-  }
+  vnl_least_squares_function_fd_columns columns = { this, &x, &fcentre, &jacobian, stepsize };
+  vnl_least_squares_function_parallel_for(0, dim, columns, thread_safe_);
 }
 
 void vnl_least_squares_function::trace(int /* iteration */,
@@ -17,12 +17,16 @@
 //   20 Apr 1999 FSM Added failure flag so that f() and grad() may signal failure to the caller.
 //   23/3/01 LSB (Manchester) Tidied documentation
 //   Feb.2002 - Peter Vanroose - brief doxygen comment placed on single line
+//   set_thread_safe() lets finite difference Jacobians be evaluated in parallel
+//   throw_failure() on the threads of such a loop is applied once the loop is done
 // \endverbatim
 //
 // not used? #include <vcl_compiler.h>
 #include <string>
+#include <vector>
 #include <vnl/vnl_vector.h>
 #include <vnl/vnl_matrix.h>
+#include <vnl/vnl_parallel_for.h>
 #include "vnl/vnl_export.h"
 
 //:  Abstract base for minimising functions.
@@ -53,13 +57,15 @@ class VNL_EXPORT vnl_least_squares_function
                              unsigned int number_of_residuals,
                              UseGradient g = use_gradient)
   : failure(false), p_(number_of_unknowns), n_(number_of_residuals),
-    use_gradient_(g == use_gradient)
+    use_gradient_(g == use_gradient), thread_safe_(false)
   { dim_warning(p_,n_); }
 
   virtual ~vnl_least_squares_function() {}
 
   // the virtuals may call this to signal a failure.
-  void throw_failure() { failure = true; }
+  // Inside vnl_least_squares_function_parallel_for, the failure is
+  // recorded for the calling thread, and failure is set once the loop is done.
+  void throw_failure();
   void clear_failure() { failure = false; }
 
   //: The main function.
@@ -71,11 +77,13 @@ class VNL_EXPORT vnl_least_squares_function
   virtual void gradf(vnl_vector<double> const& x, vnl_matrix<double>& jacobian);
 
   //: Use this to compute a finite-difference gradient other than lmdif
+  //  The columns are computed in parallel if is_thread_safe().
   void fdgradf(vnl_vector<double> const& x, vnl_matrix<double>& jacobian,
                double stepsize);
 
   //: Use this to compute a finite-forward-difference gradient other than lmdif
-  // This takes about half as many estimates as fdgradf
+  // This takes about half as many estimates as fdgradf.
+  // The columns are computed in parallel if is_thread_safe().
   void ffdgradf(vnl_vector<double> const& x, vnl_matrix<double>& jacobian,
                 double stepsize);
 
@@ -96,10 +104,21 @@ class VNL_EXPORT vnl_least_squares_function
   //: Return true if the derived class has indicated that gradf has been implemented
   bool has_gradient() const { return use_gradient_; }
 
+  //: Declare that f() may be called concurrently from several threads.
+  //  If so, finite difference Jacobians (fdgradf, ffdgradf and those of
+  //  vnl_levenberg_marquardt) evaluate f at the perturbed parameter vectors
+  //  in parallel, using vnl_parallel_for.  The results are identical to
+  //  the serial ones.  Off by default.
+  void set_thread_safe(bool safe) { thread_safe_ = safe; }
+
+  //: Return true if f() may be called concurrently
+  bool is_thread_safe() const { return thread_safe_; }
+
  protected:
   unsigned int p_;
   unsigned int n_;
   bool use_gradient_;
+  bool thread_safe_;
 
   void init(unsigned int number_of_unknowns, unsigned int number_of_residuals)
   { p_ = number_of_unknowns; n_ = number_of_residuals; dim_warning(p_,n_); }
@@ -107,4 +126,68 @@ class VNL_EXPORT vnl_least_squares_function
   void dim_warning(unsigned int n_unknowns, unsigned int n_residuals);
 };
 
+//: The throw_failure() calls made by the sub-ranges of a parallel loop.
+// failure is shared by all threads, so the workers must not set it.  Each
+// sub-range instead runs with its own list of the functions which failed,
+// and apply() sets their failure flags once the loop is done.
+class VNL_EXPORT vnl_least_squares_function_failures
+{
+ public:
+  typedef std::vector<vnl_least_squares_function*> record_type;
+
+  //: Room for the sub-ranges of a loop over [begin,end)
+  vnl_least_squares_function_failures(unsigned int begin, unsigned int end)
+  : begin_(begin), failed_(end - begin) {}
+
+  //: Call f(i0,i1), recording the throw_failure() calls made meanwhile on this thread
+  template <class F>
+  void run(F const& f, unsigned int i0, unsigned int i1)
+  {
+    // i0 is the first index of only this sub-range
+    record_type* saved = start(&failed_[i0 - begin_]);
+    f(i0, i1);
+    stop(saved);
+  }
+
+  //: Set failure on the functions which failed. Call after the loop.
+  void apply();
+
+ private:
+  //: Make r the current thread's record, returning the previous one
+  static record_type* start(record_type* r);
+  //: Restore the record returned by start()
+  static void stop(record_type* saved);
+
+  unsigned int begin_;
+  std::vector<record_type> failed_;
+};
+
+//: Runs a sub-range of a parallel loop with its own failure record
+template <class F>
+struct vnl_least_squares_function_worker
+{
+  F const* f;
+  vnl_least_squares_function_failures* failures;
+
+  void operator()(unsigned int i0, unsigned int i1) const { failures->run(*f, i0, i1); }
+};
+
+//: vnl_parallel_for(begin, end, f), for loops which evaluate least squares functions.
+// throw_failure() calls made by f only take effect once all the
+// sub-ranges are done.  The loop runs serially if \p parallel is false.
+template <class F>
+void vnl_least_squares_function_parallel_for(unsigned int begin, unsigned int end,
+                                             F const& f, bool parallel = true)
+{
+  if (end <= begin)
+    return;
+  vnl_least_squares_function_failures failures(begin, end);
+  vnl_least_squares_function_worker<F> worker = { &f, &failures };
+  if (parallel)
+    vnl_parallel_for(begin, end, worker, 1);
+  else
+    worker(begin, end);
+  failures.apply();
+}
+
 #endif // vnl_least_squares_function_h_
@@ -93,6 +93,7 @@
 #include <vnl/vnl_vector.h>
 #include <vnl/vnl_c_vector.h>
 #include <vnl/vnl_numeric_traits.h>
+#include <vnl/vnl_gemm.h>
 //--------------------------------------------------------------------------------
 
 #if VCL_HAS_SLICED_DESTRUCTOR_BUG
@@ -331,6 +332,36 @@ vnl_matrix<T>::vnl_matrix (vnl_matrix<T> const &M, T s, vnl_tag_sub)
     dst[i] = T(m[i] - s);
 }
 
+//: Compute c = a * b for an l x m matrix a and an m x n matrix b.
+// This is the plain triple loop; float and double use vnl_gemm instead.
+template <class T>
+inline void vnl_matrix_multiply(T const* const* a, T const* const* b, T* const* c,
+                                unsigned int l, unsigned int m, unsigned int n)
+{
+  for (unsigned int i=0; i<l; ++i) {
+    for (unsigned int k=0; k<n; ++k) {
+      T sum(0);
+      for (unsigned int j=0; j<m; ++j)
+        sum += T(a[i][j] * b[j][k]);
+      c[i][k] = sum;
+    }
+  }
+}
+
+//: Cache-blocked product; bitwise identical to the triple loop unless vnl_gemm_set_deterministic(false).
+inline void vnl_matrix_multiply(double const* const* a, double const* const* b, double* const* c,
+                                unsigned int l, unsigned int m, unsigned int n)
+{
+  vnl_gemm(false, false, l, n, m, a, b, c);
+}
+
+//: Cache-blocked product; bitwise identical to the triple loop unless vnl_gemm_set_deterministic(false).
+inline void vnl_matrix_multiply(float const* const* a, float const* const* b, float* const* c,
+                                unsigned int l, unsigned int m, unsigned int n)
+{
+  vnl_gemm(false, false, l, n, m, a, b, c);
+}
+
 template <class T>
 vnl_matrix<T>::vnl_matrix (vnl_matrix<T> const &A, vnl_matrix<T> const &B, vnl_tag_mul)
 : num_rows(A.num_rows), num_cols(B.num_cols)
@@ -347,14 +378,7 @@ vnl_matrix<T>::vnl_matrix (vnl_matrix<T> const &A, vnl_matrix<T> const &B, vnl_t
   vnl_matrix_construct_hack();
   vnl_matrix_alloc_blah();
 
-  for (unsigned int i=0; i<l; ++i) {
-    for (unsigned int k=0; k<n; ++k) {
-      T sum(0);
-      for (unsigned int j=0; j<m; ++j)
-        sum += T(A.data[i][j] * B.data[j][k]);
-      this->data[i][k] = sum;
-    }
-  }
+  vnl_matrix_multiply(A.data, B.data, this->data, l, m, n);
 }
 
 //------------------------------------------------------------
@@ -0,0 +1,104 @@
+// This is core/vnl/vnl_matrix_fixed_batch.h
+#ifndef vnl_matrix_fixed_batch_h_
+#define vnl_matrix_fixed_batch_h_
+//:
+// \file
+// \brief Many small fixed-size matrices, stored element by element
+//
+// vnl_matrix_fixed_batch<T,R,C> holds n matrices of size RxC in
+// "structure of arrays" order: entry (r,c) of all n matrices is stored
+// contiguously, in the plane returned by plane(r,c).  Loops which perform
+// the same arithmetic on every matrix of a batch then run over contiguous
+// memory in their innermost index, which the compiler can turn into SIMD
+// instructions working on several matrices at once.
+//
+// The batched solvers in vnl/algo/vnl_batch_linear_algebra.h take their
+// arguments in this form.  A batch of vectors is a batch of Rx1 matrices.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <vector>
+#include <vcl_compiler.h>
+#include <vnl/vnl_matrix_fixed.h>
+#include <vnl/vnl_vector_fixed.h>
+
+//: n matrices of size RxC in structure of arrays order.
+template <class T, unsigned int R, unsigned int C>
+class vnl_matrix_fixed_batch
+{
+ public:
+  //: Construct an empty batch.
+  vnl_matrix_fixed_batch() : n_(0) {}
+
+  //: Construct a batch of n matrices, all zero.
+  explicit vnl_matrix_fixed_batch(unsigned int n) : n_(n), data_(R*C*n, T(0)) {}
+
+  //: Number of matrices in the batch.
+  unsigned int size() const { return n_; }
+
+  //: Change the number of matrices.
+  // If n differs from the current size, the contents are set to zero.
+  // If n is the current size the contents are kept, so a batch can be both
+  // an input and the output of the functions in vnl_batch_linear_algebra.h.
+  void set_size(unsigned int n)
+  {
+    if (n == n_ && data_.size() == R*C*n)
+      return;
+    n_ = n;
+    data_.assign(R*C*n, T(0));
+  }
+
+  //: Entry (r,c) of matrix k.
+  T& operator()(unsigned int k, unsigned int r, unsigned int c) { return data_[(r*C+c)*n_ + k]; }
+
+  //: Entry (r,c) of matrix k.
+  T const& operator()(unsigned int k, unsigned int r, unsigned int c) const { return data_[(r*C+c)*n_ + k]; }
+
+  //: Entry (r,c) of all matrices, size() values in a row.
+  T* plane(unsigned int r, unsigned int c) { return n_ ? &data_[(r*C+c)*n_] : VXL_NULLPTR; }
+
+  //: Entry (r,c) of all matrices, size() values in a row.
+  T const* plane(unsigned int r, unsigned int c) const { return n_ ? &data_[(r*C+c)*n_] : VXL_NULLPTR; }
+
+  //: Copy matrix k out of the batch.
+  vnl_matrix_fixed<T,R,C> get(unsigned int k) const
+  {
+    vnl_matrix_fixed<T,R,C> m;
+    for (unsigned int r = 0; r < R; ++r)
+      for (unsigned int c = 0; c < C; ++c)
+        m(r,c) = (*this)(k,r,c);
+    return m;
+  }
+
+  //: Set matrix k of the batch.
+  void set(unsigned int k, vnl_matrix_fixed<T,R,C> const& m)
+  {
+    for (unsigned int r = 0; r < R; ++r)
+      for (unsigned int c = 0; c < C; ++c)
+        (*this)(k,r,c) = m(r,c);
+  }
+
+  //: Copy column c of matrix k out of the batch.
+  vnl_vector_fixed<T,R> get_column(unsigned int k, unsigned int c = 0) const
+  {
+    vnl_vector_fixed<T,R> v;
+    for (unsigned int r = 0; r < R; ++r)
+      v[r] = (*this)(k,r,c);
+    return v;
+  }
+
+  //: Set column c of matrix k of the batch.
+  void set_column(unsigned int k, vnl_vector_fixed<T,R> const& v, unsigned int c = 0)
+  {
+    for (unsigned int r = 0; r < R; ++r)
+      (*this)(k,r,c) = v[r];
+  }
+
+ private:
+  unsigned int n_;
+  std::vector<T> data_;
+};
+
+#endif // vnl_matrix_fixed_batch_h_
@@ -0,0 +1,173 @@
+// This is core/vnl/vnl_parallel_for.cxx
+//:
+// \file
+
+#include <algorithm>
+#include "vnl_parallel_for.h"
+#if VXL_FULLCXX11SUPPORT
+# include <atomic>
+# include <condition_variable>
+# include <deque>
+# include <mutex>
+# include <thread>
+# include <vector>
+#endif
+
+#if VXL_FULLCXX11SUPPORT
+
+static unsigned vnl_parallel_default_threads()
+{
+  const unsigned n = std::thread::hardware_concurrency();
+  return n == 0 ? 1u : n;
+}
+
+static std::atomic<unsigned>& vnl_parallel_max_threads_storage()
+{
+  static std::atomic<unsigned> n(vnl_parallel_default_threads());
+  return n;
+}
+
+static thread_local unsigned vnl_parallel_region_depth = 0;
+
+unsigned vnl_parallel::max_threads()
+{
+  return vnl_parallel_max_threads_storage().load();
+}
+
+void vnl_parallel::set_max_threads(unsigned n)
+{
+  vnl_parallel_max_threads_storage().store(n == 0 ? vnl_parallel_default_threads() : n);
+}
+
+bool vnl_parallel::in_parallel_region()
+{
+  return vnl_parallel_region_depth > 0;
+}
+
+void vnl_parallel::enter_region()
+{
+  ++vnl_parallel_region_depth;
+}
+
+void vnl_parallel::leave_region()
+{
+  --vnl_parallel_region_depth;
+}
+
+namespace
+{
+  //: The tasks of one vnl_parallel::run() call
+  struct vnl_parallel_job
+  {
+    void (*task)(void*, unsigned);
+    void* data;
+    unsigned n_tasks;
+    //: the next task to hand out
+    unsigned next;
+    //: the number of tasks which have returned
+    unsigned done;
+  };
+
+  //: Threads kept for vnl_parallel::run(), which take tasks from a queue of jobs
+  class vnl_parallel_pool
+  {
+   public:
+    vnl_parallel_pool() : stop_(false) {}
+
+    ~vnl_parallel_pool()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      work_.notify_all();
+      for (unsigned t = 0; t < threads_.size(); ++t)
+        threads_[t].join();
+    }
+
+    void run(vnl_parallel_job& job)
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      // one thread fewer than tasks, as the calling thread takes tasks too
+      while (threads_.size() + 1 < job.n_tasks)
+        threads_.push_back(std::thread(&vnl_parallel_pool::work, this));
+      jobs_.push_back(&job);
+      work_.notify_all();
+
+      vnl_parallel::enter_region();
+      while (job.next < job.n_tasks) {
+        const unsigned t = take(job);
+        lock.unlock();
+        job.task(job.data, t);
+        lock.lock();
+        ++job.done;
+      }
+      vnl_parallel::leave_region();
+      while (job.done < job.n_tasks)
+        done_.wait(lock);
+    }
+
+   private:
+    //: Hand out the next task of \p job; the mutex must be locked
+    unsigned take(vnl_parallel_job& job)
+    {
+      const unsigned t = job.next++;
+      if (job.next == job.n_tasks)
+        jobs_.erase(std::find(jobs_.begin(), jobs_.end(), &job));
+      return t;
+    }
+
+    //: The loop of a pool thread
+    void work()
+    {
+      // nested loops in the tasks run serially
+      vnl_parallel::enter_region();
+      std::unique_lock<std::mutex> lock(mutex_);
+      for (;;) {
+        while (!stop_ && jobs_.empty())
+          work_.wait(lock);
+        if (stop_)
+          return;
+        vnl_parallel_job& job = *jobs_.front();
+        const unsigned t = take(job);
+        lock.unlock();
+        job.task(job.data, t);
+        lock.lock();
+        if (++job.done == job.n_tasks)
+          done_.notify_all();
+      }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable work_;
+    std::condition_variable done_;
+    std::deque<vnl_parallel_job*> jobs_;
+    std::vector<std::thread> threads_;
+    bool stop_;
+  };
+}
+
+void vnl_parallel::run(unsigned n_tasks, void (*task)(void*, unsigned), void* data)
+{
+  if (n_tasks == 0)
+    return;
+  static vnl_parallel_pool pool;
+  vnl_parallel_job job = { task, data, n_tasks, 0, 0 };
+  pool.run(job);
+}
+
+#else // no C++11 threads: everything runs on the calling thread
+
+unsigned vnl_parallel::max_threads() { return 1; }
+void vnl_parallel::set_max_threads(unsigned) {}
+bool vnl_parallel::in_parallel_region() { return false; }
+void vnl_parallel::enter_region() {}
+void vnl_parallel::leave_region() {}
+
+void vnl_parallel::run(unsigned n_tasks, void (*task)(void*, unsigned), void* data)
+{
+  for (unsigned t = 0; t < n_tasks; ++t)
+    task(data, t);
+}
+
+#endif
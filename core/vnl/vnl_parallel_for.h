@@ -0,0 +1,100 @@
+// This is core/vnl/vnl_parallel_for.h
+#ifndef vnl_parallel_for_h_
+#define vnl_parallel_for_h_
+//:
+// \file
+// \brief Split a loop over an index range across several threads
+//
+// vnl_parallel_for(begin, end, f) calls f(b,e) on contiguous, disjoint
+// sub-ranges [b,e) which together cover [begin,end).  The sub-ranges are
+// processed concurrently when the compiler supports C++11 threads and
+// vnl_parallel::max_threads() is larger than one; otherwise f(begin,end)
+// is simply called on the current thread.
+//
+// The split only depends on the length of the range, the grain size and
+// the number of threads, so an algorithm whose per-index work does not
+// depend on the sub-range boundaries gives identical results whatever
+// the thread count.
+//
+// Calls made from inside a worker are run serially, so nested use (e.g.
+// a matrix product inside a parallel loop) does not oversubscribe the
+// machine.
+//
+// The sub-ranges run on a pool of threads which is started on first use
+// and kept until the program exits, so a loop does not pay for thread
+// creation.  vil keeps a pool of its own (see vil_parallel_for).
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <vcl_compiler.h>
+#include "vnl/vnl_export.h"
+
+//: Global settings for vnl's multithreaded routines.
+class VNL_EXPORT vnl_parallel
+{
+ public:
+  //: Maximum number of threads used by vnl_parallel_for.
+  // Defaults to the number of hardware threads.
+  static unsigned max_threads();
+
+  //: Set the maximum number of threads; 1 disables multithreading.
+  // A value of 0 restores the default.
+  static void set_max_threads(unsigned n);
+
+  //: True when called from a sub-range of an enclosing vnl_parallel_for.
+  static bool in_parallel_region();
+
+  //: Mark the current thread as running inside vnl_parallel_for (internal use).
+  static void enter_region();
+
+  //: Undo enter_region() (internal use).
+  static void leave_region();
+
+  //: Call task(data,c) for c in [0,n_tasks), on the pool threads and the calling thread (internal use).
+  // Returns when all the calls have returned.
+  static void run(unsigned n_tasks, void (*task)(void*, unsigned), void* data);
+};
+
+//: The sub-ranges of a vnl_parallel_for call, handed to vnl_parallel::run()
+template <class F>
+struct vnl_parallel_for_ranges
+{
+  F const* f;
+  unsigned begin, n, n_chunks;
+
+  //: Call f on sub-range \p chunk
+  static void run(void* ranges, unsigned chunk)
+  {
+    vnl_parallel_for_ranges const& r = *static_cast<vnl_parallel_for_ranges const*>(ranges);
+    const unsigned size = r.n / r.n_chunks, extra = r.n % r.n_chunks;
+    const unsigned b = r.begin + chunk*size + (chunk < extra ? chunk : extra);
+    (*r.f)(b, b + size + (chunk < extra ? 1u : 0u));
+  }
+};
+
+//: Call f(b,e) on sub-ranges of [begin,end), possibly concurrently.
+// Each sub-range contains at least \p grain indices (apart from when the
+// whole range is smaller).  \p f must be callable as a const object and
+// must not throw.
+template <class F>
+void vnl_parallel_for(unsigned begin, unsigned end, F const& f, unsigned grain = 1)
+{
+  if (end <= begin)
+    return;
+  const unsigned n = end - begin;
+  if (grain == 0)
+    grain = 1;
+  unsigned n_chunks = vnl_parallel::in_parallel_region() ? 1u : vnl_parallel::max_threads();
+  if (n_chunks > n / grain)
+    n_chunks = n / grain;
+  if (n_chunks <= 1) {
+    f(begin, end);
+    return;
+  }
+  vnl_parallel_for_ranges<F> ranges = { &f, begin, n, n_chunks };
+  vnl_parallel::run(n_chunks, &vnl_parallel_for_ranges<F>::run, &ranges);
+}
+
+#endif // vnl_parallel_for_h_
@@ -9,10 +9,153 @@
 
 
 #include <iostream>
+#include <algorithm>
 #include "vnl_sparse_lst_sqr_function.h"
 #include <vcl_compiler.h>
 #include <vcl_cassert.h>
 #include <vnl/vnl_vector_ref.h>
+#include <vnl/vnl_parallel_for.h>
+
+//: Rows [i0,i1) of residual blocks, for vnl_sparse_lst_sqr_function::f
+struct vnl_sparse_lst_sqr_function_f_rows
+{
+  vnl_sparse_lst_sqr_function* fn;
+  vnl_vector<double> const* a;
+  vnl_vector<double> const* b;
+  vnl_vector<double> const* c;
+  vnl_vector<double>* e;
+
+  void operator()(unsigned int i0, unsigned int i1) const
+  {
+    typedef vnl_crs_index::sparse_vector::iterator sv_itr;
+    for (unsigned int i=i0; i<i1; ++i)
+    {
+      // This is semi const incorrect - there is no vnl_vector_ref_const
+      const vnl_vector_ref<double> ai(fn->number_of_params_a(i),
+                                      const_cast<double*>(a->data_block())+fn->index_a(i));
+
+      vnl_crs_index::sparse_vector row = fn->residual_indices().sparse_row(i);
+      for (sv_itr r_itr=row.begin(); r_itr!=row.end(); ++r_itr)
+      {
+        unsigned int j = r_itr->second;
+        unsigned int k = r_itr->first;
+        const vnl_vector_ref<double> bj(fn->number_of_params_b(j),
+                                        const_cast<double*>(b->data_block())+fn->index_b(j));
+        vnl_vector_ref<double> eij(fn->number_of_residuals(k), e->data_block()+fn->index_e(k));
+        fn->fij(i,j,ai,bj,*c,eij);        // compute residual vector e_ij
+      }
+    }
+  }
+};
+
+//: Rows [i0,i1) of Jacobian blocks, for jac_blocks and fd_jac_blocks
+struct vnl_sparse_lst_sqr_function_jac_rows
+{
+  vnl_sparse_lst_sqr_function* fn;
+  vnl_vector<double> const* a;
+  vnl_vector<double> const* b;
+  vnl_vector<double> const* c;
+  std::vector<vnl_matrix<double> >* A;
+  std::vector<vnl_matrix<double> >* B;
+  std::vector<vnl_matrix<double> >* C;
+  //: Use finite differences rather than the analytic Jacobians
+  bool finite_difference;
+  //: Step size for finite differences
+  double stepsize;
+
+  void operator()(unsigned int i0, unsigned int i1) const
+  {
+    typedef vnl_crs_index::sparse_vector::iterator sv_itr;
+    for (unsigned int i=i0; i<i1; ++i)
+    {
+      // This is semi const incorrect - there is no vnl_vector_ref_const
+      const vnl_vector_ref<double> ai(fn->number_of_params_a(i),
+                                      const_cast<double*>(a->data_block())+fn->index_a(i));
+
+      vnl_crs_index::sparse_vector row = fn->residual_indices().sparse_row(i);
+      for (sv_itr r_itr=row.begin(); r_itr!=row.end(); ++r_itr)
+      {
+        unsigned int j = r_itr->second;
+        unsigned int k = r_itr->first;
+        const vnl_vector_ref<double> bj(fn->number_of_params_b(j),
+                                        const_cast<double*>(b->data_block())+fn->index_b(j));
+
+        if (finite_difference)
+        {
+          fn->fd_jac_Aij(i,j,ai,bj,*c,(*A)[k],stepsize);  // compute Jacobian A_ij with finite differences
+          fn->fd_jac_Bij(i,j,ai,bj,*c,(*B)[k],stepsize);  // compute Jacobian B_ij with finite differences
+          fn->fd_jac_Cij(i,j,ai,bj,*c,(*C)[k],stepsize);  // compute Jacobian C_ij with finite differences
+        }
+        else
+        {
+          fn->jac_Aij(i,j,ai,bj,*c,(*A)[k]);  // compute Jacobian A_ij
+          fn->jac_Bij(i,j,ai,bj,*c,(*B)[k]);  // compute Jacobian B_ij
+          fn->jac_Cij(i,j,ai,bj,*c,(*C)[k]);  // compute Jacobian C_ij
+        }
+      }
+    }
+  }
+};
+
+#if VXL_FULLCXX11SUPPORT
+//: The function whose blocks the calling thread is evaluating in parallel, if any
+static thread_local vnl_sparse_lst_sqr_function* vnl_sparse_lst_sqr_worker_fn = VXL_NULLPTR;
+//: Where that thread records a call of throw_failure()
+static thread_local bool* vnl_sparse_lst_sqr_worker_failure = VXL_NULLPTR;
+
+//: Evaluates rows [i0,i1) on one thread, with its own failure flag
+template <class rows_type>
+struct vnl_sparse_lst_sqr_function_worker
+{
+  rows_type const* rows;
+  std::vector<char>* failed;
+
+  void operator()(unsigned int i0, unsigned int i1) const
+  {
+    vnl_sparse_lst_sqr_function* saved_fn = vnl_sparse_lst_sqr_worker_fn;
+    bool* saved_failure = vnl_sparse_lst_sqr_worker_failure;
+    bool failure = false;
+    vnl_sparse_lst_sqr_worker_fn = rows->fn;
+    vnl_sparse_lst_sqr_worker_failure = &failure;
+    (*rows)(i0, i1);
+    vnl_sparse_lst_sqr_worker_fn = saved_fn;
+    vnl_sparse_lst_sqr_worker_failure = saved_failure;
+    // i0 is the first row of only this sub-range
+    (*failed)[i0] = failure;
+  }
+};
+#endif
+
+//: Evaluate all the rows, in parallel if the function is thread safe
+template <class rows_type>
+static void vnl_sparse_lst_sqr_function_run(rows_type const& rows)
+{
+  vnl_sparse_lst_sqr_function* fn = rows.fn;
+#if VXL_FULLCXX11SUPPORT
+  if (fn->is_thread_safe())
+  {
+    std::vector<char> failed(fn->number_of_a(), 0);
+    vnl_sparse_lst_sqr_function_worker<rows_type> worker = { &rows, &failed };
+    vnl_parallel_for(0, fn->number_of_a(), worker, 1);
+    if (std::find(failed.begin(), failed.end(), char(1)) != failed.end())
+      fn->failure = true;
+    return;
+  }
+#endif
+  rows(0, fn->number_of_a());
+}
+
+void vnl_sparse_lst_sqr_function::throw_failure()
+{
+#if VXL_FULLCXX11SUPPORT
+  if (vnl_sparse_lst_sqr_worker_fn == this)
+  {
+    *vnl_sparse_lst_sqr_worker_failure = true;
+    return;
+  }
+#endif
+  failure = true;
+}
 
 void vnl_sparse_lst_sqr_function::dim_warning(unsigned int nr_of_unknowns,
                                               unsigned int nr_of_residuals)
@@ -46,7 +189,8 @@ vnl_sparse_lst_sqr_function::vnl_sparse_lst_sqr_function(
    num_params_c_(num_params_c),
    indices_e_(num_a*num_b+1,0),
    use_gradient_(g == use_gradient),
-   use_weights_(w == use_weights)
+   use_weights_(w == use_weights),
+   thread_safe_(false)
 {
   unsigned int k = num_params_per_a;
   for (unsigned int i=1; i<indices_a_.size(); ++i, k+=num_params_per_a)
@@ -86,7 +230,8 @@ vnl_sparse_lst_sqr_function::vnl_sparse_lst_sqr_function(
    num_params_c_(num_params_c),
    indices_e_(residual_indices_.num_non_zero()+1,0),
    use_gradient_(g == use_gradient),
-   use_weights_(w == use_weights)
+   use_weights_(w == use_weights),
+   thread_safe_(false)
 {
   unsigned int k = num_params_per_a;
   for (unsigned int i=1; i<indices_a_.size(); ++i, k+=num_params_per_a)
@@ -129,7 +274,8 @@ vnl_sparse_lst_sqr_function::vnl_sparse_lst_sqr_function(
    num_params_c_(num_params_c),
    indices_e_(e_sizes.size()+1,0),
    use_gradient_(g == use_gradient),
-   use_weights_(w == use_weights)
+   use_weights_(w == use_weights),
+   thread_safe_(false)
 {
   assert(residual_indices_.num_non_zero() == (int)e_sizes.size());
   assert(residual_indices_.num_rows() == (int)a_sizes.size());
@@ -161,25 +307,8 @@ vnl_sparse_lst_sqr_function::f(vnl_vector<double> const& a,
                                vnl_vector<double> const& c,
                                vnl_vector<double>& e)
 {
-  typedef vnl_crs_index::sparse_vector::iterator sv_itr;
-  for (unsigned int i=0; i<number_of_a(); ++i)
-  {
-    // This is semi const incorrect - there is no vnl_vector_ref_const
-    const vnl_vector_ref<double> ai(number_of_params_a(i),
-                                    const_cast<double*>(a.data_block())+index_a(i));
-
-    vnl_crs_index::sparse_vector row = residual_indices_.sparse_row(i);
-    for (sv_itr r_itr=row.begin(); r_itr!=row.end(); ++r_itr)
-    {
-      unsigned int j = r_itr->second;
-      unsigned int k = r_itr->first;
-      // This is semi const incorrect - there is no vnl_vector_ref_const
-      const vnl_vector_ref<double> bj(number_of_params_b(j),
-                                      const_cast<double*>(b.data_block())+index_b(j));
-      vnl_vector_ref<double> eij(number_of_residuals(k), e.data_block()+index_e(k));
-      fij(i,j,ai,bj,c,eij);        // compute residual vector e_ij
-    }
-  }
+  vnl_sparse_lst_sqr_function_f_rows rows = { this, &a, &b, &c, &e };
+  vnl_sparse_lst_sqr_function_run(rows);
 }
 
 
@@ -199,27 +328,8 @@ vnl_sparse_lst_sqr_function::jac_blocks(vnl_vector<double> const& a,
                                         std::vector<vnl_matrix<double> >& B,
                                         std::vector<vnl_matrix<double> >& C)
 {
-  typedef vnl_crs_index::sparse_vector::iterator sv_itr;
-  for (unsigned int i=0; i<number_of_a(); ++i)
-  {
-    // This is semi const incorrect - there is no vnl_vector_ref_const
-    const vnl_vector_ref<double> ai(number_of_params_a(i),
-                                    const_cast<double*>(a.data_block())+index_a(i));
-
-    vnl_crs_index::sparse_vector row = residual_indices_.sparse_row(i);
-    for (sv_itr r_itr=row.begin(); r_itr!=row.end(); ++r_itr)
-    {
-      unsigned int j = r_itr->second;
-      unsigned int k = r_itr->first;
-      // This is semi const incorrect - there is no vnl_vector_ref_const
-      const vnl_vector_ref<double> bj(number_of_params_b(j),
-                                      const_cast<double*>(b.data_block())+index_b(j));
-
-      jac_Aij(i,j,ai,bj,c,A[k]);  // compute Jacobian A_ij
-      jac_Bij(i,j,ai,bj,c,B[k]);  // compute Jacobian B_ij
-      jac_Cij(i,j,ai,bj,c,C[k]);  // compute Jacobian C_ij
-    }
-  }
+  vnl_sparse_lst_sqr_function_jac_rows rows = { this, &a, &b, &c, &A, &B, &C, false, 0.0 };
+  vnl_sparse_lst_sqr_function_run(rows);
 }
 
 
@@ -240,27 +350,8 @@ vnl_sparse_lst_sqr_function::fd_jac_blocks(vnl_vector<double> const& a,
                                            std::vector<vnl_matrix<double> >& C,
                                            double stepsize)
 {
-  typedef vnl_crs_index::sparse_vector::iterator sv_itr;
-  for (unsigned int i=0; i<number_of_a(); ++i)
-  {
-    // This is semi const incorrect - there is no vnl_vector_ref_const
-    const vnl_vector_ref<double> ai(number_of_params_a(i),
-                                    const_cast<double*>(a.data_block())+index_a(i));
-
-    vnl_crs_index::sparse_vector row = residual_indices_.sparse_row(i);
-    for (sv_itr r_itr=row.begin(); r_itr!=row.end(); ++r_itr)
-    {
-      unsigned int j = r_itr->second;
-      unsigned int k = r_itr->first;
-      // This is semi const incorrect - there is no vnl_vector_ref_const
-      const vnl_vector_ref<double> bj(number_of_params_b(j),
-                                      const_cast<double*>(b.data_block())+index_b(j));
-
-      fd_jac_Aij(i,j,ai,bj,c,A[k],stepsize);  // compute Jacobian A_ij with finite differences
-      fd_jac_Bij(i,j,ai,bj,c,B[k],stepsize);  // compute Jacobian B_ij with finite differences
-      fd_jac_Cij(i,j,ai,bj,c,C[k],stepsize);  // compute Jacobian C_ij with finite differences
-    }
-  }
+  vnl_sparse_lst_sqr_function_jac_rows rows = { this, &a, &b, &c, &A, &B, &C, true, stepsize };
+  vnl_sparse_lst_sqr_function_run(rows);
 }
 
 
@@ -14,6 +14,7 @@
 //  Modifications
 //   Apr 13, 2005  MJL - Modified from vnl_least_squares_function
 //   Mar 15, 2010  MJL - Modified to add 'c' parameters (globals)
+//   f() and the Jacobians may evaluate blocks in parallel, see set_thread_safe()
 // \endverbatim
 //
 #include <vnl/vnl_vector.h>
@@ -113,7 +114,9 @@ class VNL_EXPORT vnl_sparse_lst_sqr_function
   virtual ~vnl_sparse_lst_sqr_function() {}
 
   // the virtuals may call this to signal a failure.
-  void throw_failure() { failure = true; }
+  // When the blocks are evaluated in parallel, each thread records the
+  // failure separately, and failure is set once all the threads are done.
+  void throw_failure();
   void clear_failure() { failure = false; }
 
   //: Compute all residuals.
@@ -318,6 +321,16 @@ class VNL_EXPORT vnl_sparse_lst_sqr_function
   //  \a apply_weights or \a apply_weight_ij have been implemented
   bool has_weights() const { return use_weights_; }
 
+  //: Declare that fij, jac_Aij, jac_Bij and jac_Cij may be called concurrently.
+  //  If so, the default f(), jac_blocks() and fd_jac_blocks() evaluate the
+  //  rows of residual blocks in parallel (see vnl_parallel_for).  Each block is written by
+  //  exactly one call, so the results do not depend on the number of threads.
+  //  Off by default, since derived classes may keep state in these methods.
+  void set_thread_safe(bool safe) { thread_safe_ = safe; }
+
+  //: Return true if fij and the block Jacobians may be called concurrently
+  bool is_thread_safe() const { return thread_safe_; }
+
   //: Return a const reference to the residual indexer
   const vnl_crs_index& residual_indices() const { return residual_indices_; }
 
@@ -330,6 +343,7 @@ class VNL_EXPORT vnl_sparse_lst_sqr_function
 
   bool use_gradient_;
   bool use_weights_;
+  bool thread_safe_;
 
  private:
   void dim_warning(unsigned int n_unknowns, unsigned int n_residuals);
@@ -28,11 +28,8 @@ void vnl_sparse_matrix_linear_system<float>::get_rhs(vnl_vector<double>& b) cons
 VCL_DEFINE_SPECIALIZATION
 void vnl_sparse_matrix_linear_system<float>::transpose_multiply(vnl_vector<double> const& b, vnl_vector<double> & x) const
 {
-  static vnl_vector<float> x_float;
-  static vnl_vector<float> b_float;
-
-  if (x_float.size() != x.size()) x_float = vnl_vector<float> (x.size());
-  if (b_float.size() != b.size()) b_float = vnl_vector<float> (b.size());
+  vnl_vector<float> x_float(x.size());
+  vnl_vector<float> b_float(b.size());
 
   vnl_copy(b, b_float);
   A_.pre_mult(b_float,x_float);
@@ -49,11 +46,8 @@ void vnl_sparse_matrix_linear_system<double>::multiply(vnl_vector<double> const&
 VCL_DEFINE_SPECIALIZATION
 void vnl_sparse_matrix_linear_system<float>::multiply(vnl_vector<double> const& x, vnl_vector<double> & b) const
 {
-  static vnl_vector<float> x_float;
-  static vnl_vector<float> b_float;
-
-  if (x_float.size() != x.size()) x_float = vnl_vector<float> (x.size());
-  if (b_float.size() != b.size()) b_float = vnl_vector<float> (b.size());
+  vnl_vector<float> x_float(x.size());
+  vnl_vector<float> b_float(b.size());
 
   vnl_copy(x, x_float);
   A_.mult(x_float,b_float);
@@ -74,7 +68,7 @@ void vnl_sparse_matrix_linear_system<T>::apply_preconditioner(vnl_vector<double>
       const_cast<vnl_vector<double> &>(jacobi_precond_)[i] = 1.0 / double(tmp[i]);
   }
 
-  px = dot_product(x,jacobi_precond_);
+  px = element_product(x,jacobi_precond_);
 }
 
 template class vnl_sparse_matrix_linear_system<double>;
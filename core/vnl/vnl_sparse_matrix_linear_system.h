@@ -10,18 +10,24 @@
 //
 //  An adaptor that converts a vnl_sparse_matrix<T> to a vnl_linear_system
 //
+//  The matrix is used in vnl_csr_matrix form, so multiply() and
+//  transpose_multiply() are multithreaded and may be called concurrently.
+//
 //  \author David Capel, capes@robots
 //  \date   July 2000
 //
 // \verbatim
 //  Modifications
 //  LSB (Manchester) 19/3/01 Documentation tidied
+//  Added constructor from vnl_csr_matrix; a vnl_sparse_matrix is now
+//  copied into that form on construction.
 // \endverbatim
 //
 //-----------------------------------------------------------------------------
 
 #include <vnl/vnl_linear_system.h>
 #include <vnl/vnl_sparse_matrix.h>
+#include <vnl/vnl_csr_matrix.h>
 #include "vnl/vnl_export.h"
 
 //: vnl_sparse_matrix -> vnl_linear_system adaptor
@@ -31,9 +37,15 @@ class VNL_EXPORT vnl_sparse_matrix_linear_system : public vnl_linear_system
 {
  public:
   //::Constructor from vnl_sparse_matrix<double> for system Ax = b
-  // Keeps a reference to the original sparse matrix A and vector b so DO NOT DELETE THEM!!
+  // A is copied into compressed form, so later changes to it are not seen.
+  // Keeps a reference to the original vector b so DO NOT DELETE IT!!
   vnl_sparse_matrix_linear_system(vnl_sparse_matrix<T> const& A, vnl_vector<T> const& b) :
-    vnl_linear_system(A.columns(), A.rows()), A_(A), b_(b), jacobi_precond_() {}
+    vnl_linear_system(A.columns(), A.rows()), frozen_(A), A_(frozen_), b_(b), jacobi_precond_() {}
+
+  //::Constructor from vnl_csr_matrix<double> for system Ax = b
+  // Keeps a reference to the original matrix A and vector b so DO NOT DELETE THEM!!
+  vnl_sparse_matrix_linear_system(vnl_csr_matrix<T> const& A, vnl_vector<T> const& b) :
+    vnl_linear_system(A.columns(), A.rows()), frozen_(), A_(A), b_(b), jacobi_precond_() {}
 
   //:  Implementations of the vnl_linear_system virtuals.
   void multiply(vnl_vector<double> const& x, vnl_vector<double> & b) const;
@@ -45,9 +57,15 @@ class VNL_EXPORT vnl_sparse_matrix_linear_system : public vnl_linear_system
   void apply_preconditioner(vnl_vector<double> const& x, vnl_vector<double> & px) const;
 
  protected:
-  vnl_sparse_matrix<T> const& A_;
+  vnl_csr_matrix<T> frozen_;
+  vnl_csr_matrix<T> const& A_;
   vnl_vector<T> const& b_;
   vnl_vector<double> jacobi_precond_;
+
+ private:
+  // A_ may refer to frozen_, so disallow copying
+  vnl_sparse_matrix_linear_system(vnl_sparse_matrix_linear_system<T> const&);
+  vnl_sparse_matrix_linear_system<T>& operator=(vnl_sparse_matrix_linear_system<T> const&);
 };
 
 VCL_DEFINE_SPECIALIZATION
@@ -72,9 +72,10 @@ void vpgl_ba_shared_k_lsqr::jac_Aij(unsigned int i,
   // -----------------
   // This is semi const incorrect - there is no vnl_vector_ref_const
   const vnl_vector_ref<double> r(3,const_cast<double*>(ai.data_block()));
-  Km_(0,0) = c[0];
-  Km_(1,1) = c[0] * K_.y_scale();
-  jac_camera_rotation(Km_,C,r,bj,Aij);
+  vnl_double_3x3 Km(Km_);
+  Km(0,0) = c[0];
+  Km(1,1) = c[0] * K_.y_scale();
+  jac_camera_rotation(Km,C,r,bj,Aij);
 }
 
 //: compute the Jacobian Bij
@@ -131,10 +132,11 @@ vpgl_ba_shared_k_lsqr::param_to_cam(int i,
                                     const double* ai,
                                     const vnl_vector<double>& c) const
 {
-  K_.set_focal_length(c[0]);
+  vpgl_calibration_matrix<double> K(K_);
+  K.set_focal_length(c[0]);
   vnl_vector<double> w(ai,3);
   vgl_homg_point_3d<double> t(ai[3], ai[4], ai[5]);
-  return vpgl_perspective_camera<double>(K_,t,vgl_rotation_3d<double>(w));
+  return vpgl_perspective_camera<double>(K,t,vgl_rotation_3d<double>(w));
 }
 
 //: compute a 3x4 camera matrix of camera \param i from a pointer to the i-th parameters of \param a and parameters \param c
@@ -143,10 +145,11 @@ vpgl_ba_shared_k_lsqr::param_to_cam_matrix(int i,
                                            const double* ai,
                                            const vnl_vector<double>& c) const
 {
-  Km_(0,0) = c[0];
-  Km_(1,1) = c[0] * K_.y_scale();
+  vnl_double_3x3 Km(Km_);
+  Km(0,0) = c[0];
+  Km(1,1) = c[0] * K_.y_scale();
   const vnl_vector_ref<double> r(3,const_cast<double*>(ai));
-  vnl_double_3x3 M = Km_*rod_to_matrix(r);
+  vnl_double_3x3 M = Km*rod_to_matrix(r);
   vnl_double_3x4 P;
   P.update(M);
   const vnl_vector_ref<double> center(3,const_cast<double*>(ai+3));
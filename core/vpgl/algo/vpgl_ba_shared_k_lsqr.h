@@ -102,9 +102,11 @@ class vpgl_ba_shared_k_lsqr : public vpgl_bundle_adjust_lsqr
 
  protected:
   //: The shared internal camera calibration
-  mutable vpgl_calibration_matrix<double> K_;
+  //  The focal length is taken from the c parameters; these members are not
+  //  changed while evaluating, so that the function is thread safe.
+  vpgl_calibration_matrix<double> K_;
   //: The shared internal camera calibration in matrix form
-  mutable vnl_double_3x3 Km_;
+  vnl_double_3x3 Km_;
 };
 
 
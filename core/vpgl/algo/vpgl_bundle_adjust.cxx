@@ -29,6 +29,7 @@ vpgl_bundle_adjust::vpgl_bundle_adjust()
     x_tol_(1e-8),
     g_tol_(1e-8),
     epsilon_(1e-3),
+    use_iterative_solver_(false),
     start_error_(0.0),
     end_error_(0.0)
 {
@@ -205,6 +206,8 @@ vpgl_bundle_adjust::optimize(std::vector<vpgl_perspective_camera<double> >& came
 
   // apply normalization to the scale of residuals
   ba_func_->set_residual_scale(m_estimator_scale_/ns);
+  // the projections of each camera are independent
+  ba_func_->set_thread_safe(true);
 
   // do the bundle adjustment
   vnl_sparse_lm lm(*ba_func_);
@@ -215,6 +218,7 @@ vpgl_bundle_adjust::optimize(std::vector<vpgl_perspective_camera<double> >& came
   lm.set_x_tolerance(x_tol_);
   lm.set_g_tolerance(g_tol_);
   lm.set_epsilon_function(epsilon_);
+  lm.set_use_iterative_solver(use_iterative_solver_);
   if (!lm.minimize(a_,b_,c_,use_gradient_,use_m_estimator_) &&
       lm.get_num_iterations() < int(max_iterations_))
   {
@@ -9,6 +9,7 @@
 // \verbatim
 //  Modifications
 //   Mar 23, 2010  MJL - Separate file for least square function class
+//   Residuals and Jacobians are evaluated in parallel; optional iterative solver
 // \endverbatim
 
 
@@ -41,6 +42,9 @@ class vpgl_bundle_adjust
   void set_g_tolerence(double gtol) { g_tol_ = gtol; }
   //: step size for finite differencing operations
   void set_epsilon(double eps) { epsilon_ = eps; }
+  //: Solve the reduced camera system by conjugate gradients (see vnl_sparse_lm).
+  //  Recommended for large numbers of cameras.
+  void set_use_iterative_solver(bool iterative) { use_iterative_solver_ = iterative; }
 
   //: Return the ending error
   double end_error() const { return end_error_; }
@@ -127,6 +131,7 @@ class vpgl_bundle_adjust
   double x_tol_;
   double g_tol_;
   double epsilon_;
+  bool use_iterative_solver_;
 
   double start_error_;
   double end_error_;
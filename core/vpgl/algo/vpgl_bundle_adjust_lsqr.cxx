@@ -7,11 +7,34 @@
 
 #include <vnl/vnl_vector_ref.h>
 #include <vnl/vnl_double_3.h>
+#include <vnl/vnl_parallel_for.h>
 
 #include <vcl_compiler.h>
 #include <vcl_cassert.h>
 
 
+//: Residuals (if e is set) or Jacobian blocks for a range of cameras
+struct vpgl_bundle_adjust_lsqr_rows
+{
+  vpgl_bundle_adjust_lsqr* fn;
+  vnl_vector<double> const* a;
+  vnl_vector<double> const* b;
+  vnl_vector<double> const* c;
+  vnl_vector<double>* e;
+  std::vector<vnl_matrix<double> >* A;
+  std::vector<vnl_matrix<double> >* B;
+  std::vector<vnl_matrix<double> >* C;
+
+  void operator()(unsigned int i0, unsigned int i1) const
+  {
+    if (e)
+      fn->f_rows(i0, i1, *a, *b, *c, *e);
+    else
+      fn->jac_rows(i0, i1, *a, *b, *c, *A, *B, *C);
+  }
+};
+
+
 //: Constructor
 vpgl_bundle_adjust_lsqr::
 vpgl_bundle_adjust_lsqr(unsigned int num_params_per_a,
@@ -87,9 +110,25 @@ vpgl_bundle_adjust_lsqr::f(vnl_vector<double> const& a,
                            vnl_vector<double> const& b,
                            vnl_vector<double> const& c,
                            vnl_vector<double>& e)
+{
+  vpgl_bundle_adjust_lsqr_rows rows = { this, &a, &b, &c, &e, VXL_NULLPTR, VXL_NULLPTR, VXL_NULLPTR };
+  if (is_thread_safe())
+    vnl_parallel_for(0, number_of_a(), rows, 1);
+  else
+    rows(0, number_of_a());
+}
+
+
+//: Compute the residuals for cameras [i0,i1)
+void
+vpgl_bundle_adjust_lsqr::f_rows(unsigned int i0, unsigned int i1,
+                                vnl_vector<double> const& a,
+                                vnl_vector<double> const& b,
+                                vnl_vector<double> const& c,
+                                vnl_vector<double>& e)
 {
   typedef vnl_crs_index::sparse_vector::iterator sv_itr;
-  for (unsigned int i=0; i<number_of_a(); ++i)
+  for (unsigned int i=i0; i<i1; ++i)
   {
     //: Construct the ith camera
     vnl_double_3x4 Pi = param_to_cam_matrix(i,a,c);
@@ -161,9 +200,27 @@ vpgl_bundle_adjust_lsqr::jac_blocks(vnl_vector<double> const& a,
                                     std::vector<vnl_matrix<double> >& A,
                                     std::vector<vnl_matrix<double> >& B,
                                     std::vector<vnl_matrix<double> >& C)
+{
+  vpgl_bundle_adjust_lsqr_rows rows = { this, &a, &b, &c, VXL_NULLPTR, &A, &B, &C };
+  if (is_thread_safe())
+    vnl_parallel_for(0, number_of_a(), rows, 1);
+  else
+    rows(0, number_of_a());
+}
+
+
+//: Compute the Jacobian blocks for cameras [i0,i1)
+void
+vpgl_bundle_adjust_lsqr::jac_rows(unsigned int i0, unsigned int i1,
+                                  vnl_vector<double> const& a,
+                                  vnl_vector<double> const& b,
+                                  vnl_vector<double> const& c,
+                                  std::vector<vnl_matrix<double> >& A,
+                                  std::vector<vnl_matrix<double> >& B,
+                                  std::vector<vnl_matrix<double> >& C)
 {
   typedef vnl_crs_index::sparse_vector::iterator sv_itr;
-  for (unsigned int i=0; i<number_of_a(); ++i)
+  for (unsigned int i=i0; i<i1; ++i)
   {
     //: Construct the ith camera
     vnl_double_3x4 Pi = param_to_cam_matrix(i,a,c);
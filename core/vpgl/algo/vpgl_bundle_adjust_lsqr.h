@@ -73,6 +73,8 @@ class vpgl_bundle_adjust_lsqr : public vnl_sparse_lst_sqr_function
                    vnl_vector<double>& fij);
 
   //: Compute the sparse Jacobian in block form.
+  //  Both f() and jac_blocks() are split across cameras with
+  //  vnl_parallel_for when set_thread_safe(true) has been called.
   virtual void jac_blocks(vnl_vector<double> const& a,
                           vnl_vector<double> const& b,
                           vnl_vector<double> const& c,
@@ -221,6 +223,25 @@ class vpgl_bundle_adjust_lsqr : public vnl_sparse_lst_sqr_function
   double scale2_;
 
   int iteration_count_;
+
+ private:
+  friend struct vpgl_bundle_adjust_lsqr_rows;
+
+  //: Compute the residuals for cameras [i0,i1)
+  void f_rows(unsigned int i0, unsigned int i1,
+              vnl_vector<double> const& a,
+              vnl_vector<double> const& b,
+              vnl_vector<double> const& c,
+              vnl_vector<double>& e);
+
+  //: Compute the Jacobian blocks for cameras [i0,i1)
+  void jac_rows(unsigned int i0, unsigned int i1,
+                vnl_vector<double> const& a,
+                vnl_vector<double> const& b,
+                vnl_vector<double> const& c,
+                std::vector<vnl_matrix<double> >& A,
+                std::vector<vnl_matrix<double> >& B,
+                std::vector<vnl_matrix<double> >& C);
 };
 
 
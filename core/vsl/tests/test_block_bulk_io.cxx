@@ -0,0 +1,171 @@
+// This is core/vsl/tests/test_block_bulk_io.cxx
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <vcl_compiler.h>
+#include <vsl/vsl_binary_io.h>
+#include <vsl/vsl_block_binary.h>
+#include <testlib/testlib_test.h>
+#include <vxl_config.h>
+
+//: Write v in the given form, read it back, and check it is unchanged.
+// \return the number of bytes written.
+template <class T>
+static std::size_t round_trip(const std::vector<T>& v, vsl_b_ostream::block_format_type format,
+                              const char* name)
+{
+  std::ostringstream ss;
+  vsl_b_ostream bos(&ss, format);
+  vsl_block_binary_write(bos, &v[0], v.size());
+  vsl_b_write(bos, 12345); // check that the block is read to its end
+  const std::size_t length = ss.str().size();
+
+  std::istringstream iss(ss.str());
+  vsl_b_istream bis(&iss);
+  std::vector<T> w(v.size());
+  vsl_block_binary_read(bis, &w[0], w.size());
+  int end_marker = 0;
+  vsl_b_read(bis, end_marker);
+  TEST(name, !!bis && end_marker == 12345 && v == w, true);
+  return length;
+}
+
+template <class T>
+static void test_all_formats(const std::vector<T>& v, const std::string& type)
+{
+  round_trip(v, vsl_b_ostream::compact_blocks, (type + " compact round trip").c_str());
+  round_trip(v, vsl_b_ostream::raw_blocks, (type + " raw round trip").c_str());
+  round_trip(v, vsl_b_ostream::compressed_blocks, (type + " compressed round trip").c_str());
+}
+
+static void test_block_bulk_io()
+{
+  std::cout << "***********************************************\n"
+           << " Testing raw and compressed vsl_block_binary io\n"
+           << "***********************************************\n";
+
+  // Over a megabyte of smooth data, so that there are several chunks
+  const unsigned n = 300000;
+  std::vector<double> v_double(n);
+  std::vector<float> v_float(n);
+  std::vector<int> v_int(n);
+  std::vector<unsigned> v_unsigned(n);
+  std::vector<short> v_short(n);
+  std::vector<long> v_long(n);
+  std::vector<vxl_int_64> v_int64(n);
+  std::vector<unsigned char> v_uchar(n);
+  for (unsigned i = 0; i < n; ++i)
+  {
+    v_double[i] = std::sin(i * 0.001) * 100.0;
+    v_float[i] = float(i % 1000) * 0.25f;
+    v_int[i] = int(i / 7) - 20000;
+    v_unsigned[i] = i * 3;
+    v_short[i] = short(i % 600 - 300);
+    v_long[i] = long(i) * 11 - 1000000;
+    v_int64[i] = vxl_int_64(i) << 20;
+    v_uchar[i] = (unsigned char)(i / 100);
+  }
+  test_all_formats(v_double, "double");
+  test_all_formats(v_float, "float");
+  test_all_formats(v_int, "int");
+  test_all_formats(v_unsigned, "unsigned");
+  test_all_formats(v_short, "short");
+  test_all_formats(v_long, "long");
+  test_all_formats(v_int64, "vxl_int_64");
+  test_all_formats(v_uchar, "unsigned char");
+
+  // Chunks that do not compress are stored as is
+  std::vector<unsigned> v_noise(1000);
+  unsigned seed = 12345;
+  for (unsigned i = 0; i < v_noise.size(); ++i)
+    v_noise[i] = seed = seed * 1103515245u + 12345u;
+  std::size_t raw = round_trip(v_noise, vsl_b_ostream::raw_blocks, "noise raw round trip");
+  std::size_t packed = round_trip(v_noise, vsl_b_ostream::compressed_blocks, "noise compressed round trip");
+  TEST("Compressed form is never much bigger", packed < raw + 16, true);
+
+  std::vector<double> v_empty(1);
+  {
+    std::ostringstream ss;
+    vsl_b_ostream bos(&ss, vsl_b_ostream::compressed_blocks);
+    vsl_block_binary_write(bos, &v_empty[0], 0);
+    std::istringstream iss(ss.str());
+    vsl_b_istream bis(&iss);
+    vsl_block_binary_read(bis, &v_empty[0], 0);
+    TEST("Empty compressed block", !!bis, true);
+  }
+
+  std::size_t compact_length = round_trip(v_double, vsl_b_ostream::compact_blocks, "double compact");
+  std::size_t raw_length = round_trip(v_double, vsl_b_ostream::raw_blocks, "double raw");
+  std::size_t compressed_length = round_trip(v_double, vsl_b_ostream::compressed_blocks, "double compressed");
+  std::cout << "double: compact " << compact_length << " raw " << raw_length
+           << " compressed " << compressed_length << std::endl;
+  TEST("Raw doubles are the same size as compact", raw_length, compact_length + 1);
+  raw_length = round_trip(v_int, vsl_b_ostream::raw_blocks, "int raw");
+  compressed_length = round_trip(v_int, vsl_b_ostream::compressed_blocks, "int compressed");
+  std::cout << "int: raw " << raw_length << " compressed " << compressed_length << std::endl;
+  TEST("Smooth ints compress", compressed_length < raw_length / 2, true);
+  raw_length = round_trip(v_uchar, vsl_b_ostream::raw_blocks, "uchar raw");
+  compressed_length = round_trip(v_uchar, vsl_b_ostream::compressed_blocks, "uchar compressed");
+  TEST("Smooth bytes compress", compressed_length < raw_length / 10, true);
+
+  {
+    std::cout << "\n\n****** Reading with the wrong integer width\n\n";
+    std::ostringstream ss;
+    vsl_b_ostream bos(&ss, vsl_b_ostream::raw_blocks);
+    vsl_block_binary_write(bos, &v_short[0], 10);
+    std::istringstream iss(ss.str());
+    vsl_b_istream bis(&iss);
+    vsl_block_binary_read(bis, &v_int[0], 10);
+    TEST("Width mismatch detected", !bis, true);
+  }
+
+  {
+    std::cout << "\n\n****** Reading corrupted compressed data\n\n";
+    std::ostringstream ss;
+    vsl_b_ostream bos(&ss, vsl_b_ostream::compressed_blocks);
+    vsl_block_binary_write(bos, &v_int[0], 10000);
+    std::string data = ss.str();
+    for (std::size_t i = data.size() - 200; i < data.size(); ++i)
+      data[i] = char(data[i] ^ 0x5a);
+    std::istringstream iss(data);
+    vsl_b_istream bis(&iss);
+    std::vector<int> w(10000);
+    vsl_block_binary_read(bis, &w[0], w.size());
+    TEST("Corruption detected", !bis, true);
+  }
+
+  {
+    std::ostringstream compact, raw;
+    vsl_b_ostream bos_compact(&compact), bos_raw(&raw, vsl_b_ostream::raw_blocks);
+    std::istringstream iss_compact(compact.str()), iss_raw(raw.str());
+    vsl_b_istream bis_compact(&iss_compact), bis_raw(&iss_raw);
+    TEST("Compact stream is version 1", bis_compact.version_no(), 1);
+    TEST("Raw stream is version 2", bis_raw.version_no(), 2);
+
+    std::cout << "\n\n****** Reading a raw block from a version 1 stream\n\n";
+    std::ostringstream ss;
+    vsl_b_ostream bos(&ss, vsl_b_ostream::raw_blocks);
+    vsl_block_binary_write(bos, &v_int[0], 10);
+    std::string data = ss.str();
+    data[0] = 1; // the low byte of the version number
+    std::istringstream iss(data);
+    vsl_b_istream bis(&iss);
+    vsl_block_binary_read(bis, &v_int[0], 10);
+    TEST("Raw block in a version 1 stream rejected", !bis, true);
+  }
+
+  {
+    std::cout << "\n\n****** Reading unspecialised data with the specialised reader\n\n";
+    std::ostringstream ss;
+    vsl_b_ostream bos(&ss);
+    vsl_b_write(bos, false);
+    std::istringstream iss(ss.str());
+    vsl_b_istream bis(&iss);
+    vsl_block_binary_read(bis, &v_int[0], 10);
+    TEST("Unspecialised block detected", !bis, true);
+  }
+}
+
+TESTMAIN(test_block_bulk_io);
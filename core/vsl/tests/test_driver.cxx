@@ -15,6 +15,8 @@ DECLARE(test_string_io);
 DECLARE(test_vector_io);
 DECLARE(test_vlarge_block_io);
 DECLARE(test_block_rle_io);
+DECLARE(test_block_bulk_io);
+DECLARE(test_indexed_archive);
 
 void
 register_tests()
@@ -34,6 +36,8 @@ register_tests()
   REGISTER(test_vector_io);
   REGISTER(test_vlarge_block_io);
   REGISTER(test_block_rle_io);
+  REGISTER(test_block_bulk_io);
+  REGISTER(test_indexed_archive);
 }
 
 DEFINE_MAIN;
@@ -11,6 +11,7 @@
 #include <vsl/vsl_complex_io.h>
 #include <vsl/vsl_deque_io.h>
 #include <vsl/vsl_indent.h>
+#include <vsl/vsl_indexed_archive.h>
 #include <vsl/vsl_list_io.h>
 #include <vsl/vsl_map_io.h>
 #include <vsl/vsl_pair_io.h>
@@ -0,0 +1,120 @@
+// This is core/vsl/tests/test_indexed_archive.cxx
+#include <iostream>
+#include <string>
+#include <vector>
+#include <vcl_compiler.h>
+#include <vxl_config.h>
+#include <vsl/vsl_binary_io.h>
+#include <vsl/vsl_binary_explicit_io.h>
+#include <vsl/vsl_indexed_archive.h>
+#include <vsl/vsl_string_io.h>
+#include <vsl/vsl_vector_io.h>
+#include <testlib/testlib_test.h>
+#include <vpl/vpl.h>
+
+//: Write an archive of one record by hand, and try to open it.
+// If overflow is set, the record's length is such that offset + length
+// wraps round to a position before the table of contents.
+static bool open_hand_written_archive(bool overflow)
+{
+  {
+    vsl_b_ofstream out("vsl_indexed_archive_hand.bvl.tmp");
+    vsl_b_write_uint_16(out, 1); // archive version
+    vsl_b_write_uint_16(out, 0x5849); vsl_b_write_uint_16(out, 0x1a76);
+    const vxl_uint_64 offset = vxl_uint_64(out.os().tellp());
+    vsl_b_write(out, 42);
+    vxl_uint_64 table = vxl_uint_64(out.os().tellp());
+    vsl_b_write(out, 1u);
+    vsl_b_write(out, std::string("record"));
+    vsl_b_write(out, offset);
+    vsl_b_write(out, overflow ? vxl_uint_64(0) - offset + 1 : table - offset);
+    vsl_swap_bytes((char *)&table, sizeof(table));
+    out.os().write((char *)&table, sizeof(table));
+    vsl_b_write_uint_16(out, 0x5849); vsl_b_write_uint_16(out, 0x1a76);
+  }
+  vsl_indexed_ifstream in("vsl_indexed_archive_hand.bvl.tmp");
+  return !(!in) && in.n_records() == 1;
+}
+
+void test_indexed_archive()
+{
+  std::cout << "*****************************\n"
+           << " Testing vsl_indexed_archive\n"
+           << "*****************************\n";
+
+  std::vector<int> v_int(1000);
+  for (unsigned i = 0; i < v_int.size(); ++i) v_int[i] = int(i*i) - 500;
+  std::vector<double> v_double(300);
+  for (unsigned i = 0; i < v_double.size(); ++i) v_double[i] = 0.5*i;
+  const std::string text = "a string record";
+
+  {
+    vsl_indexed_ofstream out("vsl_indexed_archive_test.bvl.tmp");
+    TEST("Created vsl_indexed_archive_test.bvl.tmp for writing", (!out), false);
+    vsl_indexed_write(out, "ints", v_int);
+    vsl_indexed_write(out, "text", text);
+    out.begin_record("pair");
+    vsl_b_write(out, 17);
+    vsl_b_write(out, v_double);
+    out.end_record();
+    vsl_indexed_write(out, "empty", std::vector<int>());
+    TEST("Number of records written", out.n_records(), 4);
+    out.close();
+  }
+
+  vsl_indexed_ifstream in("vsl_indexed_archive_test.bvl.tmp");
+  TEST("Opened vsl_indexed_archive_test.bvl.tmp for reading", (!in), false);
+  TEST("Number of records read", in.n_records(), 4);
+  TEST("Record names in order", in.name(0) == "ints" && in.name(1) == "text" &&
+                                in.name(2) == "pair" && in.name(3) == "empty", true);
+  TEST("contains()", in.contains("text") && !in.contains("missing"), true);
+  TEST("Archive version", in.archive_version(), 1);
+
+  // Read the records out of order
+  int n = 0;
+  std::vector<double> v_double_in;
+  TEST("Seek to pair", in.seek_record("pair"), true);
+  vsl_b_read(in, n);
+  vsl_b_read(in, v_double_in);
+  TEST("Read pair", !(!in) && in.at_record_end() && n == 17 && v_double_in == v_double, true);
+
+  std::string text_in;
+  TEST("Read text", vsl_indexed_read(in, "text", text_in) && text_in == text, true);
+  std::vector<int> v_int_in;
+  TEST("Read ints", vsl_indexed_read(in, "ints", v_int_in) && v_int_in == v_int, true);
+  std::vector<int> empty_in(3);
+  TEST("Read empty", vsl_indexed_read(in, "empty", empty_in) && empty_in.empty(), true);
+  TEST("Read ints again", vsl_indexed_read(in, "ints", v_int_in) && v_int_in == v_int, true);
+
+  std::cout << "\n\n****** Reading a record of the wrong type\n\n";
+  TEST("Partial read detected", vsl_indexed_read(in, "pair", n), false);
+  TEST("Missing record", vsl_indexed_read(in, "missing", n), false);
+  TEST("Missing record length", in.record_length("missing"), -1);
+  TEST("Stream usable after errors", vsl_indexed_read(in, "text", text_in) && text_in == text, true);
+  in.close();
+
+  {
+    // The archive is still a normal binary vsl file
+    vsl_b_ifstream plain("vsl_indexed_archive_test.bvl.tmp");
+    TEST("Archive opens as a vsl file", (!plain), false);
+  }
+
+  {
+    std::cout << "\n\n****** Opening a file that is not an indexed archive\n\n";
+    vsl_b_ofstream out("vsl_indexed_archive_plain.bvl.tmp");
+    vsl_b_write(out, v_int);
+    out.close();
+    vsl_indexed_ifstream bad("vsl_indexed_archive_plain.bvl.tmp");
+    TEST("Plain vsl file rejected", !bad && bad.n_records() == 0, true);
+  }
+
+  std::cout << "\n\n****** Opening an archive with an overflowing record length\n\n";
+  TEST("Hand written archive opens", open_hand_written_archive(false), true);
+  TEST("Overflowing record length rejected", open_hand_written_archive(true), false);
+
+  vpl_unlink("vsl_indexed_archive_test.bvl.tmp");
+  vpl_unlink("vsl_indexed_archive_plain.bvl.tmp");
+  vpl_unlink("vsl_indexed_archive_hand.bvl.tmp");
+}
+
+TESTMAIN(test_indexed_archive);
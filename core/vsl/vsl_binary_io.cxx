@@ -195,7 +195,7 @@ void vsl_b_read(vsl_b_istream &is,double& n )
 }
 
 
-const unsigned short vsl_b_ostream::version_no_ = 1;
+const unsigned short vsl_b_ostream::version_no_ = 2;
 const std::streamoff vsl_b_ostream::header_length = 6;
 static const unsigned short vsl_magic_number_part_1=0x2c4e;
 static const unsigned short vsl_magic_number_part_2=0x472b;
@@ -205,10 +205,11 @@ static const unsigned short vsl_magic_number_part_2=0x472b;
 // The stream (os) must be open (i.e. ready to be written to) so that the
 // IO version number can be written by this constructor.
 // User is responsible for deleting os after deleting the adaptor
-vsl_b_ostream::vsl_b_ostream(std::ostream *o_s): os_(o_s)
+vsl_b_ostream::vsl_b_ostream(std::ostream *o_s, block_format_type f): os_(o_s), block_format_(f)
 {
   assert(os_ != 0);
-  vsl_b_write_uint_16(*this, version_no_);
+  // Only raw and compressed blocks need a reader that knows version 2
+  vsl_b_write_uint_16(*this, f == compact_blocks ? 1 : version_no_);
   vsl_b_write_uint_16(*this, vsl_magic_number_part_1);
   vsl_b_write_uint_16(*this, vsl_magic_number_part_2);
 }
@@ -344,11 +345,11 @@ vsl_b_istream::vsl_b_istream(std::istream *i_s): is_(i_s)
     is_->clear(std::ios::badbit); // Set an unrecoverable IO error on stream
   }
 
-  if (v != 1)
+  if (v != 1 && v != 2)
   {
     std::cerr << "\nI/O ERROR: vsl_b_istream::vsl_b_istream(std::istream *is)\n"
              << "             The stream's leading version number is "
-             << v << ". Expected value 1.\n";
+             << v << ". Expected value 1 or 2.\n";
     is_->clear(std::ios::badbit); // Set an unrecoverable IO error on stream
   }
   version_no_ = (unsigned short)v;
@@ -487,7 +488,7 @@ bool vsl_b_istream_test(std::istream &is)
 
   is.seekg(0);
 
-  if (!is || m2 != vsl_magic_number_part_2 || m1 != vsl_magic_number_part_1 || v>1)
+  if (!is || m2 != vsl_magic_number_part_2 || m1 != vsl_magic_number_part_1 || v<1 || v>2)
     return false;
 
 
@@ -35,12 +35,25 @@
 class vsl_b_ostream
 {
  public:
+  //: How vsl_block_binary_write() stores blocks of fundamental types.
+  // - compact_blocks: the default, readable by all versions of vsl.  Integers
+  //   are stored in the variable length form of vsl_convert_to_arbitrary_length().
+  // - raw_blocks: the values are stored in their native width, little endian,
+  //   written straight from memory on little endian machines.  Much faster
+  //   for integers, but the reader must use the same integer widths.
+  // - compressed_blocks: as raw_blocks, but in chunks, with the bytes of each
+  //   chunk grouped by significance and compressed by an LZ77 byte codec.
+  // A stream with raw or compressed blocks is marked as version 2, so that
+  // older versions of vsl refuse to read it.  The reader recognises all
+  // three forms.
+  enum block_format_type { compact_blocks, raw_blocks, compressed_blocks };
+
   //: Create this adaptor using an existing stream
   // The stream (os) must be open (i.e. ready to receive insertions)
   // so that the
   // IO version and magic number can be written by this constructor.
   // User is responsible for deleting os after deleting the adaptor
-  vsl_b_ostream(std::ostream *os);
+  vsl_b_ostream(std::ostream *os, block_format_type f = compact_blocks);
 
   //: A reference to the adaptor's stream
   std::ostream& os() const;
@@ -90,10 +103,16 @@ class vsl_b_ostream
   // the first real data item.
   static VSL_EXPORT const std::streamoff header_length;
 
+  //: How vsl_block_binary_write() stores blocks of fundamental types.
+  block_format_type block_format() const { return block_format_; }
+
  protected:
   //: The member stream
   std::ostream *os_;
 
+  //: How blocks of fundamental types are stored.
+  block_format_type block_format_;
+
   // Design notes: IMS
   // I used to think that a pointer and class name were needed to identify an
   // object. This is true if class your_class{my_class A}; your_class B;
@@ -115,6 +134,7 @@ class vsl_b_ostream
   serialisation_records_type serialisation_records_;
 
   //: The version number of the IO scheme.
+  // Streams with only compact blocks are written as version 1.
   static const unsigned short version_no_;
 };
 
@@ -126,14 +146,16 @@ class vsl_b_ofstream: public vsl_b_ostream
   //: Create this adaptor from a file.
   // The adapter will delete the internal stream automatically on destruction.
   vsl_b_ofstream(const std::string &filename,
-                 std::ios::openmode mode = std::ios::out | std::ios::trunc):
-    vsl_b_ostream(new std::ofstream(filename.c_str(), mode | std::ios::binary)) {}
+                 std::ios::openmode mode = std::ios::out | std::ios::trunc,
+                 block_format_type f = compact_blocks):
+    vsl_b_ostream(new std::ofstream(filename.c_str(), mode | std::ios::binary), f) {}
 
   //: Create this adaptor from a file.
   // The adapter will delete the internal stream automatically on destruction.
   vsl_b_ofstream(const char *filename,
-                 std::ios::openmode mode = std::ios::out | std::ios::trunc) :
-    vsl_b_ostream(new std::ofstream(filename, mode | std::ios::binary)) {}
+                 std::ios::openmode mode = std::ios::out | std::ios::trunc,
+                 block_format_type f = compact_blocks) :
+    vsl_b_ostream(new std::ofstream(filename, mode | std::ios::binary), f) {}
 
   //: Virtual destructor.
   virtual ~vsl_b_ofstream();
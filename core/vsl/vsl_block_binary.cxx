@@ -5,12 +5,15 @@
 // \author Ian Scott, ISBE Manchester, Feb 2003
 
 #include <cstddef>
+#include <cstring>
 #include <new>
 #include <algorithm>
 #include <cstdlib>
+#include <vector>
 #include "vsl_block_binary.h"
 #include <vcl_compiler.h>
 #include <vcl_cassert.h>
+#include <vxl_config.h>
 
 struct vsl_block_t
 {
@@ -42,6 +45,26 @@ vsl_block_t allocate_up_to(std::size_t nbytes)
 }
 
 
+static void vsl_block_binary_report_mismatch(vsl_b_istream &is, bool specialised)
+{
+  std::cerr << "I/O ERROR: vsl_block_binary_read()\n";
+  if (specialised)
+    std::cerr << "           Data was saved using unspecialised slow form and is being loaded\n"
+             << "           using specialised fast form.\n\n";
+  else
+    std::cerr << "           Data was saved using specialised fast form and is being loaded\n"
+             << "           using unspecialised slow form.\n\n";
+
+  is.is().clear(std::ios::badbit); // Set an unrecoverable IO error on stream
+}
+
+static void vsl_block_binary_report_corruption(vsl_b_istream &is)
+{
+  std::cerr << "\nI/O ERROR: vsl_block_binary_read()"
+           << " Corrupted data stream\n";
+  is.is().clear(std::ios::badbit); // Set an unrecoverable IO error on stream
+}
+
 //: Error checking.
 void vsl_block_binary_read_confirm_specialisation(vsl_b_istream &is, bool specialised)
 {
@@ -49,17 +72,328 @@ void vsl_block_binary_read_confirm_specialisation(vsl_b_istream &is, bool specia
   bool b;
   vsl_b_read(is, b);
   if (b != specialised)
+    vsl_block_binary_report_mismatch(is, specialised);
+}
+
+
+/////////////////////////////////////////////////////////////////////////
+// Raw and compressed blocks.
+//
+// Each specialised block starts with a tag.  The original fast form is
+// tagged by a bool (true is stored as -1).  Older readers would take any
+// other non-zero tag as that bool, so the later forms are only written to
+// streams marked as version 2, which older readers refuse to open, and are
+// only accepted from such streams.  Both later forms then
+// store sizeof(T), and the values little endian in their native width.
+// A compressed block is split into chunks of up to vsl_block_chunk_bytes;
+// each chunk is stored as its packed size (0 when the chunk did not
+// compress and is stored as is) followed by the packed bytes.  Before
+// packing, the bytes of a chunk are grouped by significance (the first byte
+// of every value, then the second...), which gives the codec long runs to
+// work with in numerical data.
+//
+// The codec is a simple LZ77 byte coder in the manner of LZ4.  A packed
+// chunk is a series of sequences, each a token byte (the number of literal
+// bytes in the top 4 bits and the match length less 4 in the bottom 4 bits,
+// where 15 means that further bytes follow, each added until one is less
+// than 255), the literal bytes, and a 2 byte little endian match offset.
+// The final sequence has literals only.
+
+static const signed char vsl_block_tag_compact = -1;
+static const signed char vsl_block_tag_raw = 2;
+static const signed char vsl_block_tag_compressed = 3;
+static const std::size_t vsl_block_chunk_bytes = 1 << 20;
+
+static void vsl_block_lz_write_length(unsigned char*& out, std::size_t n)
+{
+  while (n >= 255)
+  {
+    *out++ = 255;
+    n -= 255;
+  }
+  *out++ = (unsigned char)n;
+}
+
+//: Add one sequence to the packed data, if there is room.
+static bool vsl_block_lz_emit(unsigned char*& out, const unsigned char* out_end,
+                              const unsigned char* literals, std::size_t n_literals,
+                              std::size_t offset, std::size_t match)
+{
+  const std::size_t worst = 1 + n_literals/255 + 1 + n_literals + 2 + match/255 + 1;
+  if (std::size_t(out_end - out) < worst)
+    return false;
+  unsigned char* token = out++;
+  *token = (unsigned char)((n_literals < 15 ? n_literals : 15) << 4);
+  if (n_literals >= 15)
+    vsl_block_lz_write_length(out, n_literals - 15);
+  std::memcpy(out, literals, n_literals);
+  out += n_literals;
+  if (match == 0)
+    return true;
+  *out++ = (unsigned char)(offset & 255);
+  *out++ = (unsigned char)(offset >> 8);
+  const std::size_t m = match - 4;
+  *token |= (unsigned char)(m < 15 ? m : 15);
+  if (m >= 15)
+    vsl_block_lz_write_length(out, m - 15);
+  return true;
+}
+
+//: Pack n bytes into at most capacity bytes.
+// \return the packed size, or 0 if it would not fit.
+static std::size_t vsl_block_lz_compress(const unsigned char* src, std::size_t n,
+                                         unsigned char* dst, std::size_t capacity)
+{
+  const unsigned hash_bits = 14;
+  std::vector<std::size_t> table(std::size_t(1) << hash_bits, 0); // position+1 of last occurrence
+  unsigned char* out = dst;
+  const unsigned char* out_end = dst + capacity;
+  std::size_t anchor = 0, i = 0;
+  while (i + 4 <= n)
+  {
+    vxl_uint_32 v;
+    std::memcpy(&v, src + i, 4);
+    const std::size_t h = vxl_uint_32(v * 2654435761u) >> (32 - hash_bits);
+    const std::size_t candidate = table[h];
+    table[h] = i + 1;
+    if (candidate && i + 1 - candidate <= 65535 &&
+        std::memcmp(src + candidate - 1, src + i, 4) == 0)
+    {
+      const std::size_t c = candidate - 1;
+      std::size_t len = 4;
+      while (i + len < n && src[c + len] == src[i + len])
+        ++len;
+      if (!vsl_block_lz_emit(out, out_end, src + anchor, i - anchor, i - c, len))
+        return 0;
+      i += len;
+      anchor = i;
+    }
+    else // step faster through data that does not compress
+      i += 1 + ((i - anchor) >> 6);
+  }
+  if (!vsl_block_lz_emit(out, out_end, src + anchor, n - anchor, 0, 0))
+    return 0;
+  return std::size_t(out - dst);
+}
+
+static bool vsl_block_lz_read_length(const unsigned char*& p, const unsigned char* end, std::size_t& n)
+{
+  unsigned char b;
+  do
+  {
+    if (p == end)
+      return false;
+    b = *p++;
+    n += b;
+  } while (b == 255);
+  return true;
+}
+
+//: Unpack n bytes into exactly dst_n bytes.
+// \return false if the packed data is corrupt.
+static bool vsl_block_lz_decompress(const unsigned char* src, std::size_t n,
+                                    unsigned char* dst, std::size_t dst_n)
+{
+  const unsigned char* p = src;
+  const unsigned char* end = src + n;
+  unsigned char* out = dst;
+  unsigned char* out_end = dst + dst_n;
+  while (p < end)
+  {
+    const unsigned token = *p++;
+    std::size_t n_literals = token >> 4;
+    if (n_literals == 15 && !vsl_block_lz_read_length(p, end, n_literals))
+      return false;
+    if (std::size_t(end - p) < n_literals || std::size_t(out_end - out) < n_literals)
+      return false;
+    std::memcpy(out, p, n_literals);
+    p += n_literals;
+    out += n_literals;
+    if (p == end)
+      break;
+    if (end - p < 2)
+      return false;
+    const std::size_t offset = std::size_t(p[0]) | (std::size_t(p[1]) << 8);
+    p += 2;
+    std::size_t match = token & 15;
+    if (match == 15 && !vsl_block_lz_read_length(p, end, match))
+      return false;
+    match += 4;
+    if (offset == 0 || offset > std::size_t(out - dst) || std::size_t(out_end - out) < match)
+      return false;
+    const unsigned char* from = out - offset;
+    for (std::size_t k = 0; k < match; ++k) // the ranges may overlap
+      out[k] = from[k];
+    out += match;
+  }
+  return out == out_end;
+}
+
+//: Group the bytes of n values of the given size by significance.
+static void vsl_block_shuffle(const unsigned char* src, unsigned char* dst, unsigned size, std::size_t n)
+{
+  for (unsigned k = 0; k < size; ++k)
+    for (std::size_t i = 0; i < n; ++i)
+      dst[k*n + i] = src[i*size + k];
+}
+
+//: Undo vsl_block_shuffle().
+static void vsl_block_unshuffle(const unsigned char* src, unsigned char* dst, unsigned size, std::size_t n)
+{
+  for (unsigned k = 0; k < size; ++k)
+    for (std::size_t i = 0; i < n; ++i)
+      dst[i*size + k] = src[k*n + i];
+}
+
+//: Write a block in its native width, little endian.
+template <class T>
+static void vsl_block_binary_write_raw(vsl_b_ostream &os, const T* begin, std::size_t nelems)
+{
+  vsl_b_write(os, vsl_block_tag_raw);
+  vsl_b_write(os, (unsigned char) sizeof(T));
+#if VXL_LITTLE_ENDIAN
+  os.os().write((const char*) begin, nelems*sizeof(T));
+#else
+  const std::size_t items_per_chunk = vsl_block_chunk_bytes / sizeof(T);
+  std::vector<char> buffer(std::min(nelems, items_per_chunk) * sizeof(T) + 1);
+  while (nelems > 0)
+  {
+    std::size_t items = std::min(items_per_chunk, nelems);
+    vsl_swap_bytes_to_buffer((const char *)begin, &buffer[0], sizeof(T), items);
+    os.os().write(&buffer[0], items*sizeof(T));
+    begin += items;
+    nelems -= items;
+  }
+#endif
+}
+
+//: Write a block in compressed chunks.
+template <class T>
+static void vsl_block_binary_write_compressed(vsl_b_ostream &os, const T* begin, std::size_t nelems)
+{
+  vsl_b_write(os, vsl_block_tag_compressed);
+  vsl_b_write(os, (unsigned char) sizeof(T));
+  const std::size_t items_per_chunk = vsl_block_chunk_bytes / sizeof(T);
+  const std::size_t buffer_bytes = std::min(nelems, items_per_chunk) * sizeof(T) + 1;
+  std::vector<unsigned char> little_endian(buffer_bytes), shuffled(buffer_bytes), packed(buffer_bytes);
+  while (nelems > 0)
   {
-    std::cerr << "I/O ERROR: vsl_block_binary_read()\n";
-    if (specialised)
-      std::cerr << "           Data was saved using unspecialised slow form and is being loaded\n"
-               << "           using specialised fast form.\n\n";
+    const std::size_t items = std::min(items_per_chunk, nelems);
+    const std::size_t bytes = items * sizeof(T);
+    vsl_swap_bytes_to_buffer((const char *)begin, (char *)&little_endian[0], sizeof(T), items);
+    vsl_block_shuffle(&little_endian[0], &shuffled[0], sizeof(T), items);
+    // only keep the packed form if it is smaller
+    const std::size_t packed_bytes = vsl_block_lz_compress(&shuffled[0], bytes, &packed[0], bytes - 1);
+    vsl_b_write(os, packed_bytes);
+    if (packed_bytes)
+      os.os().write((const char *)&packed[0], packed_bytes);
     else
-      std::cerr << "           Data was saved using specialised fast form and is being loaded\n"
-               << "           using unspecialised slow form.\n\n";
+      os.os().write((const char *)&shuffled[0], bytes);
+    begin += items;
+    nelems -= items;
+  }
+}
 
+//: Read a block written by vsl_block_binary_write_raw(), after its tag.
+template <class T>
+static void vsl_block_binary_read_raw(vsl_b_istream &is, T* begin, std::size_t nelems)
+{
+  unsigned char size;
+  vsl_b_read(is, size);
+  if (!is) return;
+  if (size != sizeof(T))
+  {
+    std::cerr << "I/O ERROR: vsl_block_binary_read()\n"
+             << "           Values of " << int(size) << " bytes are being loaded into "
+             << sizeof(T) << " bytes.\n\n";
     is.is().clear(std::ios::badbit); // Set an unrecoverable IO error on stream
+    return;
   }
+  is.is().read((char*) begin, nelems*sizeof(T));
+  vsl_swap_bytes((char *)begin, sizeof(T), nelems);
+}
+
+//: Read a block written by vsl_block_binary_write_compressed(), after its tag.
+template <class T>
+static void vsl_block_binary_read_compressed(vsl_b_istream &is, T* begin, std::size_t nelems)
+{
+  unsigned char size;
+  vsl_b_read(is, size);
+  if (!is) return;
+  if (size != sizeof(T))
+  {
+    std::cerr << "I/O ERROR: vsl_block_binary_read()\n"
+             << "           Values of " << int(size) << " bytes are being loaded into "
+             << sizeof(T) << " bytes.\n\n";
+    is.is().clear(std::ios::badbit); // Set an unrecoverable IO error on stream
+    return;
+  }
+  const std::size_t items_per_chunk = vsl_block_chunk_bytes / sizeof(T);
+  const std::size_t buffer_bytes = std::min(nelems, items_per_chunk) * sizeof(T) + 1;
+  std::vector<unsigned char> shuffled(buffer_bytes), packed(buffer_bytes);
+  while (nelems > 0)
+  {
+    const std::size_t items = std::min(items_per_chunk, nelems);
+    const std::size_t bytes = items * sizeof(T);
+    std::size_t packed_bytes;
+    vsl_b_read(is, packed_bytes);
+    if (!is) return;
+    if (packed_bytes >= bytes)
+    {
+      vsl_block_binary_report_corruption(is);
+      return;
+    }
+    if (packed_bytes == 0)
+      is.is().read((char *)&shuffled[0], bytes);
+    else
+    {
+      is.is().read((char *)&packed[0], packed_bytes);
+      if (!is) return;
+      if (!vsl_block_lz_decompress(&packed[0], packed_bytes, &shuffled[0], bytes))
+      {
+        vsl_block_binary_report_corruption(is);
+        return;
+      }
+    }
+    if (!is) return;
+    vsl_block_unshuffle(&shuffled[0], (unsigned char *)begin, sizeof(T), items);
+    vsl_swap_bytes((char *)begin, sizeof(T), items);
+    begin += items;
+    nelems -= items;
+  }
+}
+
+//: Read the tag of a specialised block, and the block itself if it is raw or compressed.
+// \return true if the block is in the original fast form, which the caller should read.
+template <class T>
+static bool vsl_block_binary_read_tag(vsl_b_istream &is, T* begin, std::size_t nelems)
+{
+  if (!is) return false;
+  signed char tag;
+  vsl_b_read(is, tag);
+  if (!is) return false;
+  switch (tag)
+  {
+   case vsl_block_tag_compact:
+    return true;
+   case vsl_block_tag_raw:
+    if (is.version_no() < 2)
+      break;
+    vsl_block_binary_read_raw(is, begin, nelems);
+    return false;
+   case vsl_block_tag_compressed:
+    if (is.version_no() < 2)
+      break;
+    vsl_block_binary_read_compressed(is, begin, nelems);
+    return false;
+   case 0:
+    vsl_block_binary_report_mismatch(is, true);
+    return false;
+   default:
+    break;
+  }
+  vsl_block_binary_report_corruption(is);
+  return false;
 }
 
 
@@ -69,8 +403,17 @@ void vsl_block_binary_read_confirm_specialisation(vsl_b_istream &is, bool specia
 template <class T>
 void vsl_block_binary_write_float_impl(vsl_b_ostream &os, const T* begin, std::size_t nelems)
 {
+  if (os.block_format() == vsl_b_ostream::raw_blocks)
+    return vsl_block_binary_write_raw(os, begin, nelems);
+  if (os.block_format() == vsl_b_ostream::compressed_blocks)
+    return vsl_block_binary_write_compressed(os, begin, nelems);
+
   vsl_b_write(os, true); // Error check that this is a specialised version
 
+#if VXL_LITTLE_ENDIAN
+  // The stored form is the memory layout, so no copy is needed.
+  os.os().write((const char *)begin, nelems * sizeof(T));
+#else
   const std::size_t wanted = sizeof(T) * nelems;
   vsl_block_t block = allocate_up_to(wanted);
 
@@ -92,6 +435,7 @@ void vsl_block_binary_write_float_impl(vsl_b_ostream &os, const T* begin, std::s
 #else
   std::free(block.ptr);
 #endif
+#endif // VXL_LITTLE_ENDIAN
 }
 
 //: Read a block of floats from a vsl_b_ostream
@@ -100,8 +444,7 @@ void vsl_block_binary_read_float_impl(vsl_b_istream &is, T* begin, std::size_t n
 {
   // There are no complications here, to deal with low memory,
   // because the byte swapping can be done in place.
-  vsl_block_binary_read_confirm_specialisation(is, true);
-  if (!is) return;
+  if (!vsl_block_binary_read_tag(is, begin, nelems)) return;
   is.is().read((char*) begin, nelems*sizeof(T));
   vsl_swap_bytes((char *)begin, sizeof(T), nelems);
 }
@@ -111,6 +454,10 @@ void vsl_block_binary_read_float_impl(vsl_b_istream &is, T* begin, std::size_t n
 template <class T>
 void vsl_block_binary_write_int_impl(vsl_b_ostream &os, const T* begin, std::size_t nelems)
 {
+  if (os.block_format() == vsl_b_ostream::raw_blocks)
+    return vsl_block_binary_write_raw(os, begin, nelems);
+  if (os.block_format() == vsl_b_ostream::compressed_blocks)
+    return vsl_block_binary_write_compressed(os, begin, nelems);
 
   vsl_b_write(os, true); // Error check that this is a specialised version
 
@@ -171,8 +518,7 @@ void vsl_block_binary_write_int_impl(vsl_b_ostream &os, const T* begin, std::siz
 template <class T>
 void vsl_block_binary_read_int_impl(vsl_b_istream &is, T* begin, std::size_t nelems)
 {
-  vsl_block_binary_read_confirm_specialisation(is, true);
-  if (!is) return;
+  if (!vsl_block_binary_read_tag(is, begin, nelems)) return;
   std::size_t nbytes;
   vsl_b_read(is, nbytes);
   if (nbytes==0) return;
@@ -256,6 +602,10 @@ void vsl_block_binary_read_int_impl(vsl_b_istream &is, T* begin, std::size_t nel
 template <class T>
 void vsl_block_binary_write_byte_impl(vsl_b_ostream &os, const T* begin, std::size_t nelems)
 {
+  // raw_blocks is the same as compact_blocks for bytes
+  if (os.block_format() == vsl_b_ostream::compressed_blocks)
+    return vsl_block_binary_write_compressed(os, begin, nelems);
+
   vsl_b_write(os, true); // Error check that this is a specialised version
   os.os().write((char*) begin, nelems);
 }
@@ -266,8 +616,7 @@ void vsl_block_binary_read_byte_impl(vsl_b_istream &is, T* begin, std::size_t ne
 {
   // There are no complications here, to deal with low memory,
   // because the load is done in place.
-  vsl_block_binary_read_confirm_specialisation(is, true);
-  if (!is) return;
+  if (!vsl_block_binary_read_tag(is, begin, nelems)) return;
   is.is().read((char*) begin, nelems);
 }
 
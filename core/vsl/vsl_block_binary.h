@@ -5,6 +5,11 @@
 // \file
 // \brief Set of functions to do binary IO on a block of values.
 // \author Ian Scott, ISBE Manchester, Feb 2003
+//
+// The form in which the specialised functions store a block is chosen when
+// the vsl_b_ostream is created: compact, raw (native width, little endian)
+// or compressed.  The reader handles all of them.  Streams with raw or
+// compressed blocks are marked as version 2, which older readers reject.
 
 #include <vsl/vsl_binary_io.h>
 #include <vsl/vsl_binary_explicit_io.h>
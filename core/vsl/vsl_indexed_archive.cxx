@@ -0,0 +1,198 @@
+// This is core/vsl/vsl_indexed_archive.cxx
+#include <iostream>
+#include "vsl_indexed_archive.h"
+//:
+// \file
+
+#include <vcl_compiler.h>
+#include <vxl_config.h>
+#include <vsl/vsl_binary_explicit_io.h>
+#include <vsl/vsl_string_io.h>
+
+static const unsigned short vsl_indexed_archive_version = 1;
+static const unsigned short vsl_indexed_magic_number_part_1 = 0x5849;
+static const unsigned short vsl_indexed_magic_number_part_2 = 0x1a76;
+
+//: Length of the footer: the table offset, and the magic number.
+static const std::streamoff vsl_indexed_footer_length = 12;
+
+// The table offset is stored in a fixed width, so that it can be
+// found from the end of the file.
+static void vsl_indexed_write_uint_64(vsl_b_ostream &os, vxl_uint_64 n)
+{
+  vsl_swap_bytes((char *)&n, sizeof(n));
+  os.os().write((char *)&n, sizeof(n));
+}
+
+static void vsl_indexed_read_uint_64(vsl_b_istream &is, vxl_uint_64 &n)
+{
+  is.is().read((char *)&n, sizeof(n));
+  vsl_swap_bytes((char *)&n, sizeof(n));
+}
+
+static void vsl_indexed_write_magic(vsl_b_ostream &os)
+{
+  vsl_b_write_uint_16(os, vsl_indexed_magic_number_part_1);
+  vsl_b_write_uint_16(os, vsl_indexed_magic_number_part_2);
+}
+
+static bool vsl_indexed_read_magic(vsl_b_istream &is)
+{
+  unsigned long m1 = 0, m2 = 0;
+  vsl_b_read_uint_16(is, m1);
+  vsl_b_read_uint_16(is, m2);
+  return !(!is) && m1 == vsl_indexed_magic_number_part_1 && m2 == vsl_indexed_magic_number_part_2;
+}
+
+//=========================================================================
+
+vsl_indexed_ofstream::vsl_indexed_ofstream(const std::string &filename)
+  : vsl_b_ofstream(filename), in_record_(false), closed_(false)
+{
+  vsl_b_write_uint_16(*this, vsl_indexed_archive_version);
+  vsl_indexed_write_magic(*this);
+}
+
+vsl_indexed_ofstream::~vsl_indexed_ofstream()
+{
+  close();
+}
+
+void vsl_indexed_ofstream::begin_record(const std::string &name)
+{
+  end_record();
+  clear_serialisation_records();
+  names_.push_back(name);
+  offsets_.push_back(os().tellp());
+  in_record_ = true;
+}
+
+void vsl_indexed_ofstream::end_record()
+{
+  if (!in_record_)
+    return;
+  lengths_.push_back(os().tellp() - offsets_.back());
+  in_record_ = false;
+}
+
+void vsl_indexed_ofstream::close()
+{
+  if (closed_)
+    return;
+  end_record();
+  clear_serialisation_records();
+  const std::streamoff table = os().tellp();
+  vsl_b_write(*this, n_records());
+  for (unsigned i = 0; i < n_records(); ++i)
+  {
+    vsl_b_write(*this, names_[i]);
+    vsl_b_write(*this, vxl_uint_64(offsets_[i]));
+    vsl_b_write(*this, vxl_uint_64(lengths_[i]));
+  }
+  vsl_indexed_write_uint_64(*this, vxl_uint_64(table));
+  vsl_indexed_write_magic(*this);
+  closed_ = true;
+  vsl_b_ofstream::close();
+}
+
+//=========================================================================
+
+vsl_indexed_ifstream::vsl_indexed_ifstream(const std::string &filename)
+  : vsl_b_ifstream(filename), record_end_(-1), archive_version_(0)
+{
+  if (!(*this)) return;
+  unsigned long v = 0;
+  vsl_b_read_uint_16(*this, v);
+  if (!vsl_indexed_read_magic(*this))
+  {
+    std::cerr << "\nI/O ERROR: vsl_indexed_ifstream::vsl_indexed_ifstream()\n"
+             << "           " << filename << " does not appear to be an indexed archive.\n"
+             << "           Can't find correct magic number.\n";
+    is().clear(std::ios::badbit); // Set an unrecoverable IO error on stream
+    return;
+  }
+  archive_version_ = (unsigned short)v;
+  if (v != 1)
+  {
+    std::cerr << "\nI/O ERROR: vsl_indexed_ifstream::vsl_indexed_ifstream()\n"
+             << "           Unknown archive version " << v << ". Expected value 1.\n";
+    is().clear(std::ios::badbit); // Set an unrecoverable IO error on stream
+    return;
+  }
+  read_table_of_contents();
+}
+
+void vsl_indexed_ifstream::read_table_of_contents()
+{
+  const std::streamoff records_start = is().tellg();
+  is().seekg(0, std::ios::end);
+  const std::streamoff file_end = is().tellg();
+  bool ok = file_end >= records_start + vsl_indexed_footer_length;
+  vxl_uint_64 table = 0;
+  if (ok)
+  {
+    is().seekg(file_end - vsl_indexed_footer_length);
+    vsl_indexed_read_uint_64(*this, table);
+    ok = vsl_indexed_read_magic(*this) && std::streamoff(table) >= records_start &&
+         std::streamoff(table) < file_end - vsl_indexed_footer_length;
+  }
+  if (ok)
+  {
+    is().seekg(std::streamoff(table));
+    unsigned n = 0;
+    vsl_b_read(*this, n);
+    for (unsigned i = 0; ok && i < n; ++i)
+    {
+      std::string name;
+      vxl_uint_64 offset = 0, length = 0;
+      vsl_b_read(*this, name);
+      vsl_b_read(*this, offset);
+      vsl_b_read(*this, length);
+      // compared unsigned, and without offset + length, which may overflow
+      ok = !(!*this) && offset >= vxl_uint_64(records_start) &&
+           offset <= table && length <= table - offset;
+      names_.push_back(name);
+      offsets_.push_back(std::streamoff(offset));
+      lengths_.push_back(std::streamoff(length));
+      index_[name] = i;
+    }
+  }
+  if (!ok)
+  {
+    std::cerr << "\nI/O ERROR: vsl_indexed_ifstream::read_table_of_contents()\n"
+             << "           The archive's table of contents is missing or corrupt.\n";
+    names_.clear();
+    offsets_.clear();
+    lengths_.clear();
+    index_.clear();
+    is().clear(std::ios::badbit); // Set an unrecoverable IO error on stream
+  }
+}
+
+std::streamoff vsl_indexed_ifstream::record_length(const std::string &name) const
+{
+  std::map<std::string, unsigned>::const_iterator it = index_.find(name);
+  return it == index_.end() ? std::streamoff(-1) : lengths_[it->second];
+}
+
+bool vsl_indexed_ifstream::seek_record(const std::string &name)
+{
+  std::map<std::string, unsigned>::const_iterator it = index_.find(name);
+  if (it == index_.end())
+  {
+    is().setstate(std::ios::failbit);
+    return false;
+  }
+  // Records are independent, so a failure while reading one need not stop
+  // the others being read.
+  is().clear();
+  clear_serialisation_records();
+  is().seekg(offsets_[it->second]);
+  record_end_ = offsets_[it->second] + lengths_[it->second];
+  return !(!*this);
+}
+
+bool vsl_indexed_ifstream::at_record_end()
+{
+  return !(!*this) && is().tellg() == record_end_;
+}
@@ -0,0 +1,137 @@
+// This is core/vsl/vsl_indexed_archive.h
+#ifndef vsl_indexed_archive_h_
+#define vsl_indexed_archive_h_
+//:
+// \file
+// \brief Binary files of named records, any of which can be read on its own.
+//
+// A normal binary vsl file can only be read from the start, so reading one
+// object near its end means reading everything before it.  An indexed
+// archive holds a sequence of named records, followed by a table of the
+// name, offset and length of each record.  The reader loads only the table
+// when it is opened, and seeks straight to a record when it is asked for.
+//
+// Each record is written with its own serialisation records, so that
+// pointers shared between records are saved in full in each of them.
+//
+// The file is a normal binary vsl stream: the vsl header, then the archive
+// version and magic number, the records, the table, and finally the offset
+// of the table and the magic number again, in a fixed width so that the
+// reader can find them from the end of the file.
+// \code
+//   vsl_indexed_ofstream out("models.bvl");
+//   vsl_indexed_write(out, "face", face_model);
+//   vsl_indexed_write(out, "hand", hand_model);
+//   out.close();
+//
+//   vsl_indexed_ifstream in("models.bvl");
+//   vsl_indexed_read(in, "hand", hand_model); // face_model is not read
+// \endcode
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <string>
+#include <vector>
+#include <map>
+#include <vcl_compiler.h>
+#include <vsl/vsl_binary_io.h>
+
+//: Writes an indexed archive of named records to a file.
+class vsl_indexed_ofstream: public vsl_b_ofstream
+{
+ public:
+  //: Create the archive file.
+  vsl_indexed_ofstream(const std::string &filename);
+
+  //: Writes the table of contents and closes the file, if not already done.
+  virtual ~vsl_indexed_ofstream();
+
+  //: Start a new record; data written to this stream until end_record() belongs to it.
+  // Ends any record still open.  Names should be unique; a reader finds
+  // the last record of a given name.
+  void begin_record(const std::string &name);
+
+  //: End the current record.
+  void end_record();
+
+  //: Number of records written so far.
+  unsigned n_records() const { return unsigned(names_.size()); }
+
+  //: Write the table of contents and close the file.
+  void close();
+
+ private:
+  std::vector<std::string> names_;
+  std::vector<std::streamoff> offsets_;
+  std::vector<std::streamoff> lengths_;
+  bool in_record_;
+  bool closed_;
+};
+
+//: Reads records, in any order, from an indexed archive.
+class vsl_indexed_ifstream: public vsl_b_ifstream
+{
+ public:
+  //: Open an archive, and read its table of contents.
+  // If the file is not an indexed archive, an error is reported and the
+  // stream's fail bit is set.
+  vsl_indexed_ifstream(const std::string &filename);
+
+  //: Number of records in the archive.
+  unsigned n_records() const { return unsigned(names_.size()); }
+
+  //: Name of record i, in the order they were written.
+  const std::string& name(unsigned i) const { return names_[i]; }
+
+  //: Return true iff the archive has a record of the given name.
+  bool contains(const std::string &name) const { return index_.find(name) != index_.end(); }
+
+  //: Length in bytes of the named record, or -1 if there is none.
+  std::streamoff record_length(const std::string &name) const;
+
+  //: Position the stream at the start of the named record.
+  // \return false, and sets the fail bit, if there is no such record.
+  bool seek_record(const std::string &name);
+
+  //: Return true iff the stream is positioned at the end of the record last sought.
+  // Useful for checking that a record has been read in full.
+  bool at_record_end();
+
+  //: Version number of the archive format of the file being read.
+  unsigned short archive_version() const { return archive_version_; }
+
+ private:
+  void read_table_of_contents();
+
+  std::vector<std::string> names_;
+  std::vector<std::streamoff> offsets_;
+  std::vector<std::streamoff> lengths_;
+  //: Index in names_ of the last record of each name.
+  std::map<std::string, unsigned> index_;
+  std::streamoff record_end_;
+  unsigned short archive_version_;
+};
+
+//: Write \p data to \p os as a record called \p name.
+template <class T>
+inline void vsl_indexed_write(vsl_indexed_ofstream &os, const std::string &name, const T &data)
+{
+  os.begin_record(name);
+  vsl_b_write(os, data);
+  os.end_record();
+}
+
+//: Read \p data from the record called \p name of \p is, without reading any other record.
+// \return false if there is no such record, or it could not be read in full.
+template <class T>
+inline bool vsl_indexed_read(vsl_indexed_ifstream &is, const std::string &name, T &data)
+{
+  if (!is.seek_record(name))
+    return false;
+  vsl_b_read(is, data);
+  return !(!is) && is.at_record_end();
+}
+
+#endif // vsl_indexed_archive_h_
@@ -20,6 +20,7 @@
 #include <vul/vul_timer.h>
 #include <vul/vul_timestamp.h>
 #include <vul/vul_trace.h>
+#include <vul/vul_tracing.h>
 #include <vul/vul_user_info.h>
 #include <vul/vul_url.h>
 
@@ -0,0 +1,163 @@
+// This is core/vul/tests/test_tracing.cxx
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <vcl_compiler.h>
+#include <vul/vul_tracing.h>
+#include <testlib/testlib_test.h>
+#if VXL_FULLCXX11SUPPORT
+# include <atomic>
+# include <thread>
+#endif
+
+static unsigned count_occurrences(std::string const& s, std::string const& pattern)
+{
+  unsigned n = 0;
+  for (std::string::size_type p = s.find(pattern); p != std::string::npos; p = s.find(pattern, p+1))
+    ++n;
+  return n;
+}
+
+static std::string chrome_json()
+{
+  std::ostringstream os;
+  vul_tracing::write_chrome_json(os);
+  return os.str();
+}
+
+static void record_zones(unsigned n)
+{
+  for (unsigned k = 0; k < n; ++k)
+  {
+    vul_tracing_scope zone("test_tracing worker");
+  }
+}
+
+#if VXL_FULLCXX11SUPPORT
+//: Record n zones, not exiting until all n_threads threads have recorded one.
+// So none of the threads can reuse the buffer of another.
+static void record_zones_together(std::atomic<unsigned>* started, unsigned n_threads, unsigned n)
+{
+  record_zones(1);
+  ++*started;
+  while (*started < n_threads)
+    std::this_thread::yield();
+  record_zones(n-1);
+}
+#endif
+
+void test_tracing()
+{
+  // Counters and histograms must outlive their use
+  static vul_tracing_counter counter("test_tracing.counter");
+  static vul_tracing_histogram histogram("test_tracing.histogram");
+
+  vul_tracing::clear();
+  vul_tracing::enable(false);
+  {
+    vul_tracing_scope zone("test_tracing disabled");
+    counter.add(3);
+    histogram.add(5);
+  }
+  TEST("Nothing recorded while disabled", vul_tracing::n_events(), 0);
+  TEST("Counter unchanged while disabled", counter.value(), 0.0);
+  TEST("Histogram unchanged while disabled", histogram.count(), 0);
+
+  vul_tracing::enable();
+  TEST("enabled()", vul_tracing::enabled(), true);
+  {
+    vul_tracing_scope outer("test_tracing outer");
+    {
+      vul_tracing_scope inner("test_tracing \"inner\"");
+    }
+    vul_tracing_scope named(std::string("test_tracing named"));
+  }
+  TEST("Three zones recorded", vul_tracing::n_events(), 3);
+
+  counter.add(2);
+  counter.add(3.5);
+  TEST("Counter total", counter.value(), 5.5);
+  TEST("Counter samples recorded", vul_tracing::n_events(), 5);
+
+  TEST("Bucket of 0.5", vul_tracing_histogram::bucket_index(0.5), 0);
+  TEST("Bucket of 1", vul_tracing_histogram::bucket_index(1.0), 1);
+  TEST("Bucket of 3", vul_tracing_histogram::bucket_index(3.0), 2);
+  TEST("Bucket of 4", vul_tracing_histogram::bucket_index(4.0), 3);
+  TEST("Bucket of 1e300", vul_tracing_histogram::bucket_index(1e300), vul_tracing_histogram::n_buckets-1);
+  histogram.add(3);
+  histogram.add(2);
+  histogram.add(100);
+  TEST("Histogram count", histogram.count(), 3);
+  TEST("Histogram bucket [2,4)", histogram.bucket(2), 2);
+  TEST("Histogram bucket [64,128)", histogram.bucket(7), 1);
+  TEST("Histogram sum", histogram.sum(), 105.0);
+  TEST("Histogram min", histogram.min_value(), 2.0);
+  TEST("Histogram max", histogram.max_value(), 100.0);
+
+  std::string json = chrome_json();
+  std::cout << json;
+  TEST("JSON object", json.substr(0, 16), "{\"traceEvents\":[");
+  TEST("Outer zone written", count_occurrences(json, "\"test_tracing outer\",\"cat\":\"vxl\",\"ph\":\"X\""), 1);
+  TEST("Quotes escaped", count_occurrences(json, "\"test_tracing \\\"inner\\\"\""), 1);
+  TEST("Named zone written", count_occurrences(json, "\"test_tracing named\""), 1);
+  TEST("Disabled zone not written", count_occurrences(json, "test_tracing disabled"), 0);
+  TEST("Counter samples written", count_occurrences(json, "\"test_tracing.counter\",\"ph\":\"C\""), 2);
+  TEST("Counter total written", count_occurrences(json, "\"test_tracing.counter\":5.5"), 1);
+  TEST("Histogram written", count_occurrences(json, "\"test_tracing.histogram\":{\"count\":3"), 1);
+  TEST("Balanced braces", count_occurrences(json, "{"), count_occurrences(json, "}"));
+
+  std::ostringstream summary;
+  vul_tracing::print_summary(summary);
+  TEST("Summary has counter", count_occurrences(summary.str(), "test_tracing.counter: 5.5"), 1);
+
+  // Only the most recent events are kept
+  vul_tracing::set_buffer_size(4);
+  vul_tracing::clear();
+  TEST("clear() resets counters", counter.value(), 0.0);
+  TEST("clear() resets histograms", histogram.count(), 0);
+  for (unsigned k = 0; k < 10; ++k)
+    counter.add(1);
+  TEST("Ring buffer is bounded", vul_tracing::n_events(), 4);
+  json = chrome_json();
+  TEST("Oldest samples dropped", count_occurrences(json, "\"args\":{\"value\":6}"), 0);
+  TEST("Newest samples kept", count_occurrences(json, "\"args\":{\"value\":7}") +
+                              count_occurrences(json, "\"args\":{\"value\":10}"), 2);
+  TEST("Counter total kept", counter.value(), 10.0);
+
+#if VXL_FULLCXX11SUPPORT
+  vul_tracing::set_buffer_size(1000);
+  vul_tracing::clear();
+  std::vector<std::thread> threads;
+  std::atomic<unsigned> started(0);
+  for (unsigned t = 0; t < 4; ++t)
+    threads.push_back(std::thread(record_zones_together, &started, 4u, 100u));
+  for (unsigned t = 0; t < threads.size(); ++t)
+    threads[t].join();
+  TEST("Zones from all threads", vul_tracing::n_events(), 400);
+  json = chrome_json();
+  TEST("Threads recorded separately", count_occurrences(json, "\"thread_name\"") >= 5, true);
+  // buffers of threads which have exited are reused, keeping their events
+  const unsigned n_buffers = count_occurrences(json, "\"thread_name\"");
+  for (unsigned t = 0; t < 8; ++t)
+    std::thread(record_zones, 10).join();
+  json = chrome_json();
+  TEST("Buffers of finished threads reused", count_occurrences(json, "\"thread_name\""), n_buffers);
+  TEST("Events of finished threads kept", vul_tracing::n_events(), 480);
+#else
+  record_zones(100);
+#endif
+
+  vul_tracing::clear();
+  VUL_TRACE_SCOPE("test_tracing macro");
+  VUL_TRACE_COUNTER("test_tracing.macro_counter", 1);
+  VUL_TRACE_HISTOGRAM("test_tracing.macro_histogram", 1);
+  VUL_TRACE_VALUE("test_tracing macro value", 1);
+  TEST("Macros record only when compiled in", vul_tracing::n_events(), VXL_ENABLE_TRACING ? 2 : 0);
+
+  vul_tracing::enable(false);
+  vul_tracing::set_buffer_size(65536);
+  vul_tracing::clear();
+}
+
+TEST_MAIN(test_tracing);
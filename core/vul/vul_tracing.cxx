@@ -0,0 +1,487 @@
+// This is core/vul/vul_tracing.cxx
+//:
+// \file
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <set>
+#include <string>
+#include <vector>
+#include "vul_tracing.h"
+#if VXL_FULLCXX11SUPPORT
+# include <chrono>
+# include <mutex>
+#else
+# include <vul/vul_timer.h>
+#endif
+
+//: One zone ('X') or counter sample ('C')
+struct vul_tracing_event
+{
+  char const* name;
+  double time;
+  double value; // duration of a zone, or the counter value
+  char phase;
+};
+
+//: The ring buffer of events recorded by one thread
+struct vul_tracing_buffer
+{
+  std::vector<vul_tracing_event> events;
+  std::size_t next;
+  std::size_t size;
+  unsigned tid;
+#if VXL_FULLCXX11SUPPORT
+  std::mutex mutex_;
+#endif
+
+  vul_tracing_buffer(unsigned capacity, unsigned id)
+  : events(capacity), next(0), size(0), tid(id) {}
+};
+
+struct vul_tracing_state
+{
+#if VXL_FULLCXX11SUPPORT
+  std::mutex mutex_;
+  std::chrono::steady_clock::time_point origin;
+#else
+  vul_timer timer;
+#endif
+  unsigned buffer_size;
+  std::vector<vul_tracing_buffer*> buffers;
+  //: Buffers of threads which have exited, for reuse by new threads
+  std::vector<vul_tracing_buffer*> free_buffers;
+  std::vector<vul_tracing_counter*> counters;
+  std::vector<vul_tracing_histogram*> histograms;
+  std::set<std::string> names;
+
+  vul_tracing_state()
+  : buffer_size(65536)
+  {
+#if VXL_FULLCXX11SUPPORT
+    origin = std::chrono::steady_clock::now();
+#endif
+  }
+};
+
+#if VXL_FULLCXX11SUPPORT
+# define VUL_TRACING_LOCK(s) std::lock_guard<std::mutex> lock((s).mutex_)
+#else
+# define VUL_TRACING_LOCK(s)
+#endif
+
+// Never destroyed, so that the trace can still be written by an atexit() handler
+static vul_tracing_state& vul_tracing_global()
+{
+  static vul_tracing_state* state = new vul_tracing_state;
+  return *state;
+}
+
+#if VXL_FULLCXX11SUPPORT
+static std::atomic<bool> vul_tracing_on(false);
+#else
+static bool vul_tracing_on = false;
+#endif
+
+#if VXL_FULLCXX11SUPPORT
+//: Holds a thread's buffer, and returns it to the free list when the thread exits.
+// The buffer keeps its events, so they are still written, until a new
+// thread takes it over.
+struct vul_tracing_buffer_holder
+{
+  vul_tracing_buffer* buffer;
+
+  vul_tracing_buffer_holder() : buffer(VXL_NULLPTR) {}
+  ~vul_tracing_buffer_holder()
+  {
+    if (!buffer)
+      return;
+    vul_tracing_state& s = vul_tracing_global();
+    VUL_TRACING_LOCK(s);
+    s.free_buffers.push_back(buffer);
+  }
+};
+#endif
+
+//: The calling thread's buffer, taken from the free list or created on first use
+static vul_tracing_buffer& vul_tracing_thread_buffer()
+{
+#if VXL_FULLCXX11SUPPORT
+  static thread_local vul_tracing_buffer_holder holder;
+  vul_tracing_buffer*& buffer = holder.buffer;
+#else
+  static vul_tracing_buffer* buffer = VXL_NULLPTR;
+#endif
+  if (!buffer)
+  {
+    vul_tracing_state& s = vul_tracing_global();
+    VUL_TRACING_LOCK(s);
+    if (!s.free_buffers.empty())
+    {
+      buffer = s.free_buffers.back();
+      s.free_buffers.pop_back();
+    }
+    else
+    {
+      buffer = new vul_tracing_buffer(s.buffer_size, unsigned(s.buffers.size()));
+      s.buffers.push_back(buffer);
+    }
+  }
+  return *buffer;
+}
+
+static void vul_tracing_push(char phase, char const* name, double time, double value)
+{
+  vul_tracing_buffer& b = vul_tracing_thread_buffer();
+#if VXL_FULLCXX11SUPPORT
+  std::lock_guard<std::mutex> lock(b.mutex_);
+#endif
+  const std::size_t capacity = b.events.size();
+  if (capacity == 0)
+    return;
+  vul_tracing_event& e = b.events[b.next];
+  e.name = name;
+  e.time = time;
+  e.value = value;
+  e.phase = phase;
+  b.next = (b.next + 1) % capacity;
+  if (b.size < capacity)
+    ++b.size;
+}
+
+#if VXL_FULLCXX11SUPPORT
+//: Add to an atomic double, which has no fetch_add() before C++20
+static double vul_tracing_atomic_add(std::atomic<double>& a, double delta)
+{
+  double old = a.load();
+  while (!a.compare_exchange_weak(old, old + delta))
+    ;
+  return old + delta;
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// vul_tracing
+
+void vul_tracing::enable(bool on)
+{
+  vul_tracing_global(); // start the clock
+  vul_tracing_on = on;
+}
+
+bool vul_tracing::enabled()
+{
+  return vul_tracing_on;
+}
+
+void vul_tracing::set_buffer_size(unsigned n_events)
+{
+  vul_tracing_state& s = vul_tracing_global();
+  VUL_TRACING_LOCK(s);
+  s.buffer_size = n_events;
+}
+
+void vul_tracing::clear()
+{
+  vul_tracing_state& s = vul_tracing_global();
+  VUL_TRACING_LOCK(s);
+  for (unsigned i = 0; i < s.buffers.size(); ++i)
+  {
+    vul_tracing_buffer& b = *s.buffers[i];
+#if VXL_FULLCXX11SUPPORT
+    std::lock_guard<std::mutex> buffer_lock(b.mutex_);
+#endif
+    b.events.assign(s.buffer_size, vul_tracing_event());
+    b.next = b.size = 0;
+  }
+  for (unsigned i = 0; i < s.counters.size(); ++i)
+    s.counters[i]->reset();
+  for (unsigned i = 0; i < s.histograms.size(); ++i)
+    s.histograms[i]->reset();
+}
+
+double vul_tracing::now()
+{
+  vul_tracing_state& s = vul_tracing_global();
+#if VXL_FULLCXX11SUPPORT
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - s.origin).count();
+#else
+  return 1000.0 * s.timer.real();
+#endif
+}
+
+void vul_tracing::record_zone(char const* name, double start, double end)
+{
+  vul_tracing_push('X', name, start, end - start);
+}
+
+void vul_tracing::record_counter(char const* name, double value)
+{
+  vul_tracing_push('C', name, now(), value);
+}
+
+char const* vul_tracing::intern(std::string const& name)
+{
+  vul_tracing_state& s = vul_tracing_global();
+  VUL_TRACING_LOCK(s);
+  return s.names.insert(name).first->c_str();
+}
+
+unsigned long vul_tracing::n_events()
+{
+  vul_tracing_state& s = vul_tracing_global();
+  VUL_TRACING_LOCK(s);
+  unsigned long n = 0;
+  for (unsigned i = 0; i < s.buffers.size(); ++i)
+  {
+#if VXL_FULLCXX11SUPPORT
+    std::lock_guard<std::mutex> buffer_lock(s.buffers[i]->mutex_);
+#endif
+    n += (unsigned long)s.buffers[i]->size;
+  }
+  return n;
+}
+
+//: Write a string with the characters JSON needs escaped
+static void vul_tracing_write_string(std::ostream& os, char const* s)
+{
+  os << '"';
+  for (; s && *s; ++s)
+  {
+    const unsigned char c = (unsigned char)*s;
+    if (c == '"' || c == '\\')
+      os << '\\' << *s;
+    else if (c < 0x20)
+      os << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 0xf];
+    else
+      os << *s;
+  }
+  os << '"';
+}
+
+bool vul_tracing::write_chrome_json(std::ostream& os)
+{
+  vul_tracing_state& s = vul_tracing_global();
+  VUL_TRACING_LOCK(s);
+  const std::streamsize old_precision = os.precision(15);
+
+  os << "{\"traceEvents\":[\n"
+     << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"vxl\"}}";
+  for (unsigned i = 0; i < s.buffers.size(); ++i)
+  {
+    vul_tracing_buffer& b = *s.buffers[i];
+#if VXL_FULLCXX11SUPPORT
+    std::lock_guard<std::mutex> buffer_lock(b.mutex_);
+#endif
+    os << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b.tid
+       << ",\"args\":{\"name\":\"thread " << b.tid << "\"}}";
+    const std::size_t capacity = b.events.size();
+    for (std::size_t k = 0; k < b.size; ++k)
+    {
+      // Oldest first
+      const vul_tracing_event& e = b.events[(b.next + capacity - b.size + k) % capacity];
+      os << ",\n{\"name\":";
+      vul_tracing_write_string(os, e.name);
+      if (e.phase == 'X')
+        os << ",\"cat\":\"vxl\",\"ph\":\"X\",\"ts\":" << e.time << ",\"dur\":" << e.value
+           << ",\"pid\":1,\"tid\":" << b.tid << '}';
+      else
+        os << ",\"ph\":\"C\",\"ts\":" << e.time << ",\"pid\":1,\"tid\":" << b.tid
+           << ",\"args\":{\"value\":" << e.value << "}}";
+    }
+  }
+  os << "\n],\n\"displayTimeUnit\":\"ms\",\n\"otherData\":{\"counters\":{";
+  for (unsigned i = 0; i < s.counters.size(); ++i)
+  {
+    os << (i ? "," : "") << '\n';
+    vul_tracing_write_string(os, s.counters[i]->name());
+    os << ':' << s.counters[i]->value();
+  }
+  os << "},\n\"histograms\":{";
+  for (unsigned i = 0; i < s.histograms.size(); ++i)
+  {
+    const vul_tracing_histogram& h = *s.histograms[i];
+    os << (i ? "," : "") << '\n';
+    vul_tracing_write_string(os, h.name());
+    os << ":{\"count\":" << h.count() << ",\"sum\":" << h.sum()
+       << ",\"min\":" << h.min_value() << ",\"max\":" << h.max_value() << ",\"buckets\":[";
+    bool first = true;
+    for (unsigned k = 0; k < vul_tracing_histogram::n_buckets; ++k)
+    {
+      if (h.bucket(k) == 0)
+        continue;
+      os << (first ? "" : ",") << "{\"lower\":" << (k ? std::ldexp(1.0, int(k) - 1) : 0.0)
+         << ",\"upper\":" << std::ldexp(1.0, int(k)) << ",\"count\":" << h.bucket(k) << '}';
+      first = false;
+    }
+    os << "]}";
+  }
+  os << "}}\n}\n";
+
+  os.precision(old_precision);
+  return os.good();
+}
+
+bool vul_tracing::write_chrome_json(char const* filename)
+{
+  std::ofstream os(filename);
+  if (!os)
+    return false;
+  return write_chrome_json(os);
+}
+
+void vul_tracing::print_summary(std::ostream& os)
+{
+  vul_tracing_state& s = vul_tracing_global();
+  VUL_TRACING_LOCK(s);
+  for (unsigned i = 0; i < s.counters.size(); ++i)
+    os << s.counters[i]->name() << ": " << s.counters[i]->value() << '\n';
+  for (unsigned i = 0; i < s.histograms.size(); ++i)
+  {
+    const vul_tracing_histogram& h = *s.histograms[i];
+    os << h.name() << ": count " << h.count();
+    if (h.count() > 0)
+      os << ", mean " << h.sum() / h.count()
+         << ", min " << h.min_value() << ", max " << h.max_value();
+    os << '\n';
+  }
+}
+
+//-----------------------------------------------------------------------------
+// vul_tracing_counter
+
+vul_tracing_counter::vul_tracing_counter(char const* name)
+: name_(name), value_(0.0)
+{
+  vul_tracing_state& s = vul_tracing_global();
+  VUL_TRACING_LOCK(s);
+  s.counters.push_back(this);
+}
+
+void vul_tracing_counter::add(double delta)
+{
+  if (!vul_tracing::enabled())
+    return;
+#if VXL_FULLCXX11SUPPORT
+  const double v = vul_tracing_atomic_add(value_, delta);
+#else
+  const double v = (value_ += delta);
+#endif
+  vul_tracing::record_counter(name_, v);
+}
+
+double vul_tracing_counter::value() const
+{
+  return value_;
+}
+
+void vul_tracing_counter::reset()
+{
+  value_ = 0.0;
+}
+
+//-----------------------------------------------------------------------------
+// vul_tracing_histogram
+
+vul_tracing_histogram::vul_tracing_histogram(char const* name)
+: name_(name)
+{
+  reset();
+  vul_tracing_state& s = vul_tracing_global();
+  VUL_TRACING_LOCK(s);
+  s.histograms.push_back(this);
+}
+
+unsigned vul_tracing_histogram::bucket_index(double value)
+{
+  if (!(value >= 1.0)) // also catches NaN
+    return 0;
+  int e = 0;
+  std::frexp(value, &e); // value in [2^(e-1), 2^e)
+  return e < int(n_buckets) ? unsigned(e) : unsigned(n_buckets) - 1;
+}
+
+void vul_tracing_histogram::add(double value)
+{
+  if (!vul_tracing::enabled())
+    return;
+  ++buckets_[bucket_index(value)];
+  ++count_;
+#if VXL_FULLCXX11SUPPORT
+  vul_tracing_atomic_add(sum_, value);
+  double old = min_.load();
+  while (value < old && !min_.compare_exchange_weak(old, value))
+    ;
+  old = max_.load();
+  while (value > old && !max_.compare_exchange_weak(old, value))
+    ;
+#else
+  sum_ += value;
+  if (value < min_) min_ = value;
+  if (value > max_) max_ = value;
+#endif
+}
+
+unsigned long vul_tracing_histogram::count() const
+{
+  return count_;
+}
+
+unsigned long vul_tracing_histogram::bucket(unsigned k) const
+{
+  return k < n_buckets ? (unsigned long)buckets_[k] : 0ul;
+}
+
+double vul_tracing_histogram::sum() const
+{
+  return sum_;
+}
+
+double vul_tracing_histogram::min_value() const
+{
+  return count_ > 0 ? double(min_) : 0.0;
+}
+
+double vul_tracing_histogram::max_value() const
+{
+  return count_ > 0 ? double(max_) : 0.0;
+}
+
+void vul_tracing_histogram::reset()
+{
+  for (unsigned k = 0; k < n_buckets; ++k)
+    buckets_[k] = 0;
+  count_ = 0;
+  sum_ = 0.0;
+  min_ = std::numeric_limits<double>::max();
+  max_ = -std::numeric_limits<double>::max();
+}
+
+//-----------------------------------------------------------------------------
+// Start recording when VXL_TRACE_FILE is set, and write the file on exit
+
+static void vul_tracing_write_at_exit()
+{
+  char const* filename = std::getenv("VXL_TRACE_FILE");
+  if (filename && *filename && !vul_tracing::write_chrome_json(filename))
+    std::cerr << "vul_tracing: unable to write " << filename << '\n';
+}
+
+struct vul_tracing_startup
+{
+  vul_tracing_startup()
+  {
+    char const* filename = std::getenv("VXL_TRACE_FILE");
+    if (filename && *filename)
+    {
+      vul_tracing::enable();
+      std::atexit(vul_tracing_write_at_exit);
+    }
+  }
+};
+
+static vul_tracing_startup vul_tracing_startup_instance;
@@ -0,0 +1,201 @@
+// This is core/vul/vul_tracing.h
+#ifndef vul_tracing_h_
+#define vul_tracing_h_
+//:
+// \file
+// \brief Low overhead scoped zones, counters and histograms for profiling
+//
+// Hot paths are instrumented with these macros:
+// \code
+//   VUL_TRACE_SCOPE("vil_load");                    // time the enclosing block
+//   VUL_TRACE_COUNTER("vil_load.images", 1);        // add to a named counter
+//   VUL_TRACE_HISTOGRAM("vil_load.pixels", ni*nj);  // record a value
+//   VUL_TRACE_VALUE("rms error", e);                // plot a value over time
+// \endcode
+// These expand to nothing unless VXL was configured with VXL_ENABLE_TRACING,
+// so a normal build pays nothing for them.  When they are compiled in they
+// record nothing until tracing is switched on, either with
+// vul_tracing::enable() or by setting the environment variable
+// VXL_TRACE_FILE, in which case the trace is also written to that file
+// when the program exits.
+//
+// Each thread records zones and counter samples into its own fixed size
+// ring buffer, so that only the most recent events are kept.  The buffer of
+// a thread which has exited is reused by the next new thread, so each
+// thread id in the trace may stand for several threads which ran one after
+// the other, and memory use is bounded by the number of threads running at
+// once.  Counters and histograms also keep running totals.  The result is
+// written as Chrome trace event JSON, which can be viewed in chrome://tracing
+// or Perfetto.
+//
+// Zone, counter and histogram names passed to the macros must be string
+// literals (or otherwise live for the rest of the program).
+// VUL_TRACE_SCOPE_NAME() takes a std::string instead, at the cost of a
+// lookup each time the zone is entered with tracing on.
+//
+// \verbatim
+//  Modifications
+// \endverbatim
+
+#include <iosfwd>
+#include <string>
+#include <vxl_config.h> // for VXL_ENABLE_TRACING
+#include <vcl_compiler.h>
+#if VXL_FULLCXX11SUPPORT
+# include <atomic>
+#endif
+
+//: Global control of the trace recorder
+class vul_tracing
+{
+ public:
+  //: Switch recording on or off.
+  static void enable(bool on = true);
+
+  //: True if events are being recorded.
+  static bool enabled();
+
+  //: Number of events kept in each thread's ring buffer (default 65536).
+  //  Takes effect for buffers created or cleared after the call.
+  static void set_buffer_size(unsigned n_events);
+
+  //: Discard all recorded events and reset the counters and histograms.
+  static void clear();
+
+  //: Microseconds since the first use of the recorder.
+  static double now();
+
+  //: Write the recorded events, counters and histograms as Chrome trace JSON.
+  static bool write_chrome_json(std::ostream& os);
+
+  //: Write the Chrome trace JSON to a file.
+  static bool write_chrome_json(char const* filename);
+
+  //: Print the counter totals and histogram summaries.
+  static void print_summary(std::ostream& os);
+
+  //: Number of events currently held in all ring buffers.
+  static unsigned long n_events();
+
+  //: Record a complete zone on the calling thread.
+  static void record_zone(char const* name, double start, double end);
+
+  //: Record a counter value on the calling thread.
+  static void record_counter(char const* name, double value);
+
+  //: A copy of \a name that lives for the rest of the program.
+  static char const* intern(std::string const& name);
+};
+
+//: Times the lifetime of the object as a zone named \a name.
+class vul_tracing_scope
+{
+ public:
+  explicit vul_tracing_scope(char const* name)
+  : name_(name), start_(vul_tracing::enabled() ? vul_tracing::now() : -1.0) {}
+
+  explicit vul_tracing_scope(std::string const& name)
+  : name_(VXL_NULLPTR), start_(-1.0)
+  {
+    if (vul_tracing::enabled()) {
+      name_ = vul_tracing::intern(name);
+      start_ = vul_tracing::now();
+    }
+  }
+
+  ~vul_tracing_scope()
+  {
+    if (start_ >= 0.0)
+      vul_tracing::record_zone(name_, start_, vul_tracing::now());
+  }
+
+ private:
+  char const* name_;
+  double start_;
+  // Disallow copying
+  vul_tracing_scope(vul_tracing_scope const&);
+  vul_tracing_scope& operator=(vul_tracing_scope const&);
+};
+
+//: A named running total.
+//  Counters register themselves on construction and must not be destroyed
+//  while the recorder is in use, so they are normally function statics.
+class vul_tracing_counter
+{
+ public:
+  explicit vul_tracing_counter(char const* name);
+
+  //: Add \a delta to the total and record a sample, if tracing is enabled.
+  void add(double delta);
+
+  char const* name() const { return name_; }
+  double value() const;
+  void reset();
+
+ private:
+  char const* name_;
+#if VXL_FULLCXX11SUPPORT
+  std::atomic<double> value_;
+#else
+  double value_;
+#endif
+};
+
+//: Counts of values in power of two buckets, with the count, sum and range.
+//  Bucket 0 holds values below 1, and bucket k>0 holds values in [2^(k-1),2^k).
+class vul_tracing_histogram
+{
+ public:
+  enum { n_buckets = 64 };
+
+  explicit vul_tracing_histogram(char const* name);
+
+  //: Record \a value, if tracing is enabled.
+  void add(double value);
+
+  char const* name() const { return name_; }
+  unsigned long count() const;
+  unsigned long bucket(unsigned k) const;
+  double sum() const;
+  double min_value() const;
+  double max_value() const;
+  void reset();
+
+  //: Index of the bucket holding \a value.
+  static unsigned bucket_index(double value);
+
+ private:
+  char const* name_;
+#if VXL_FULLCXX11SUPPORT
+  std::atomic<unsigned long> buckets_[n_buckets];
+  std::atomic<unsigned long> count_;
+  std::atomic<double> sum_, min_, max_;
+#else
+  unsigned long buckets_[n_buckets];
+  unsigned long count_;
+  double sum_, min_, max_;
+#endif
+};
+
+#if VXL_ENABLE_TRACING
+# define VUL_TRACE_CONCAT_(a, b) a##b
+# define VUL_TRACE_CONCAT(a, b) VUL_TRACE_CONCAT_(a, b)
+# define VUL_TRACE_SCOPE(name) \
+  vul_tracing_scope VUL_TRACE_CONCAT(vul_trace_scope_, __LINE__)(name)
+# define VUL_TRACE_SCOPE_NAME(name) \
+  vul_tracing_scope VUL_TRACE_CONCAT(vul_trace_scope_, __LINE__)((std::string const&)(name))
+# define VUL_TRACE_COUNTER(name, delta) \
+  do { static vul_tracing_counter vul_trace_counter_(name); vul_trace_counter_.add(double(delta)); } while (false)
+# define VUL_TRACE_HISTOGRAM(name, value) \
+  do { static vul_tracing_histogram vul_trace_histogram_(name); vul_trace_histogram_.add(double(value)); } while (false)
+# define VUL_TRACE_VALUE(name, value) \
+  do { if (vul_tracing::enabled()) vul_tracing::record_counter(name, double(value)); } while (false)
+#else
+# define VUL_TRACE_SCOPE(name) do {} while (false)
+# define VUL_TRACE_SCOPE_NAME(name) do {} while (false)
+# define VUL_TRACE_COUNTER(name, delta) do {} while (false)
+# define VUL_TRACE_HISTOGRAM(name, value) do {} while (false)
+# define VUL_TRACE_VALUE(name, value) do {} while (false)
+#endif
+
+#endif // vul_tracing_h_